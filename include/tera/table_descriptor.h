@@ -82,6 +82,12 @@ enum StoreType {
     kInMemory = 2,
 };
 
+// Describes compaction style for a locality group
+enum CompactionStyle {
+    kLeveledCompaction = 0,
+    kTieredCompaction = 1,
+};
+
 class LocalityGroupDescriptor {
 public:
     // Returns name of this locality group
@@ -99,6 +105,10 @@ public:
     virtual int32_t SstSize() const = 0;
     virtual void SetSstSize(int32_t sst_size) = 0;
 
+    // Set/get compaction style.
+    virtual void SetCompactionStyle(CompactionStyle style) = 0;
+    virtual CompactionStyle GetCompactionStyle() const = 0;
+
     // Set/get compress type.
     virtual void SetCompress(CompressType type) = 0;
     virtual CompressType Compress() const = 0;
@@ -200,6 +210,12 @@ public:
     void EnableTxn();
     bool IsTxnEnabled() const;
 
+    // Enable/disable the notification index of this table: rows with
+    // notifications are also listed in the table <table>_notify_index,
+    // which observers scan instead of this table.
+    void EnableNotifyIndex();
+    bool IsNotifyIndexEnabled() const;
+
     // Set/get admin of this table.
     void SetAdmin(const std::string& name);
     std::string Admin() const;
@@ -5,7 +5,15 @@
 // Author: baorenyi@baidu.com
 
 #include "benchmark/tpcc/driver.h"
+
+#include <math.h>
+
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
 #include "benchmark/tpcc/tpccdb.h"
+#include "common/this_thread.h"
 #include "common/thread_pool.h"
 #include "common/timer.h"
 
@@ -13,6 +21,12 @@ DECLARE_int32(driver_wait_times);
 DECLARE_int32(warehouses_count);
 DECLARE_int32(tpcc_run_gtxn_thread_pool_size);
 DECLARE_int64(transactions_count);
+DECLARE_int32(tpcc_terminals_per_warehouse);
+DECLARE_int32(tpcc_keying_time_ms);
+DECLARE_int32(tpcc_think_time_ms);
+DECLARE_int32(tpcc_warmup_seconds);
+DECLARE_int32(tpcc_run_seconds);
+DECLARE_int32(tpcc_report_interval_seconds);
 
 namespace tera {
 namespace tpcc {
@@ -22,7 +36,9 @@ Driver::Driver(RandomGenerator* rand_gen, TpccDb* db)
       rand_gen_(rand_gen), 
       db_(db), 
       now_datatime_(get_curtime_str()),
-      thread_pool_(FLAGS_tpcc_run_gtxn_thread_pool_size) {
+      thread_pool_(FLAGS_tpcc_run_gtxn_thread_pool_size),
+      measuring_(true),
+      stop_(false) {
 }
 
 void Driver::PrintJoinTimeoutInfo(int need_cnt, int table_enum_num) {
@@ -37,7 +53,118 @@ void Driver::PrintJoinTimeoutInfo(int need_cnt, int table_enum_num) {
 
 void Driver::RunTransactions() {
     for (int64_t i = 0; i < FLAGS_transactions_count; ++i) {
-        RunOneTransaction();
+        RunOneTransaction(rand_gen_, FindWareHouse(rand_gen_));
+    }
+}
+
+void Driver::RunTerminals() {
+    int32_t terminal_num = FLAGS_warehouses_count * FLAGS_tpcc_terminals_per_warehouse;
+    int64_t interval_us = FLAGS_tpcc_report_interval_seconds * 1000000LL;
+    if (interval_us <= 0) {
+        interval_us = 1000000;
+    }
+    NURandConstant constant = rand_gen_->GetRandomConstant();
+    LOG(INFO) << "run " << terminal_num << " terminals, warmup "
+              << FLAGS_tpcc_warmup_seconds << "s, measure " << FLAGS_tpcc_run_seconds << "s";
+
+    measuring_ = FLAGS_tpcc_warmup_seconds <= 0;
+    stop_ = false;
+    common::ThreadPool terminal_pool(terminal_num);
+    for (int32_t i = 0; i < terminal_num; ++i) {
+        terminal_pool.AddTask(std::bind(&Driver::RunTerminal, this, i, constant));
+    }
+
+    int64_t start_us = get_micros();
+    int64_t warmup_end_us = start_us + FLAGS_tpcc_warmup_seconds * 1000000LL;
+    int64_t measure_start_us = measuring_ ? start_us : warmup_end_us;
+    int64_t end_us = measure_start_us + FLAGS_tpcc_run_seconds * 1000000LL;
+    int64_t last_report_us = start_us;
+    while (true) {
+        int64_t now_us = get_micros();
+        if (!measuring_ && now_us >= warmup_end_us) {
+            PrintInterval(now_us - last_report_us, "warmup");
+            last_report_us = now_us;
+            measure_start_us = now_us;
+            end_us = measure_start_us + FLAGS_tpcc_run_seconds * 1000000LL;
+            measuring_ = true;
+        }
+        if (now_us >= end_us) {
+            break;
+        }
+        int64_t next_us = std::min(last_report_us + interval_us, measuring_ ? end_us : warmup_end_us);
+        if (next_us > now_us) {
+            ThisThread::Sleep((next_us - now_us + 999) / 1000);
+            continue;
+        }
+        PrintInterval(now_us - last_report_us, measuring_ ? "measure" : "warmup");
+        last_report_us = now_us;
+    }
+    // the transactions finishing from now on are not measured
+    measuring_ = false;
+    int64_t measure_us = get_micros() - measure_start_us;
+    PrintInterval(get_micros() - last_report_us, "measure");
+    stop_ = true;
+    terminal_pool.Stop(false);
+    PrintSummary(measure_us);
+}
+
+void Driver::RunTerminal(int32_t terminal_id, const NURandConstant& constant) {
+    RandomGenerator rand_gen(static_cast<unsigned int>(get_micros()) + terminal_id);
+    rand_gen.CopyRandomConstant(constant);
+    // terminals are spread over the warehouses evenly
+    int32_t warehouse_id = terminal_id % FLAGS_warehouses_count + 1;
+    while (!stop_) {
+        if (FLAGS_tpcc_keying_time_ms > 0) {
+            ThisThread::Sleep(FLAGS_tpcc_keying_time_ms);
+        }
+        RunOneTransaction(&rand_gen, warehouse_id);
+        if (FLAGS_tpcc_think_time_ms > 0) {
+            ThinkTime(&rand_gen, FLAGS_tpcc_think_time_ms);
+        }
+    }
+}
+
+void Driver::ThinkTime(RandomGenerator* rand_gen, int32_t mean_ms) {
+    // r in (0, 1], the time is limited to 10 times of the mean
+    double r = rand_gen->GetRandom(1, 1000000) / 1000000.0;
+    int64_t ms = static_cast<int64_t>(-log(r) * mean_ms);
+    ThisThread::Sleep(std::min<int64_t>(ms, 10LL * mean_ms));
+}
+
+void Driver::PrintInterval(int64_t interval_us, const char* phase) {
+    int64_t txns = interval_txns_.Clear();
+    int64_t new_orders = interval_new_orders_.Clear();
+    if (interval_us <= 0) {
+        return;
+    }
+    std::cout << "[" << get_curtime_str() << "] " << phase
+              << " tpmC: " << std::fixed << std::setprecision(1)
+              << new_orders * 60000000.0 / interval_us
+              << " tps: " << txns * 1000000.0 / interval_us << std::endl;
+}
+
+void Driver::PrintSummary(int64_t measure_us) {
+    std::cout << std::left << std::setw(12) << "TYPE"
+              << std::setw(10) << "SUCC" << std::setw(10) << "FAIL"
+              << std::setw(10) << "P50(us)" << std::setw(10) << "P90(us)"
+              << std::setw(10) << "P99(us)" << std::setw(10) << "P99.9(us)"
+              << "MAX(us)" << std::endl;
+    for (int i = 0; i < kTpccTxnTypeCnt; ++i) {
+        LogLinearHistogram::Snapshot snapshot;
+        stats_[i].latency.TakeSnapshot(&snapshot, false);
+        std::cout << std::left << std::setw(12) << kTpccTxnTypes[i]
+                  << std::setw(10) << stats_[i].succ.Get()
+                  << std::setw(10) << stats_[i].fail.Get()
+                  << std::setw(10) << static_cast<int64_t>(snapshot.Percentile(50))
+                  << std::setw(10) << static_cast<int64_t>(snapshot.Percentile(90))
+                  << std::setw(10) << static_cast<int64_t>(snapshot.Percentile(99))
+                  << std::setw(10) << static_cast<int64_t>(snapshot.Percentile(99.9))
+                  << static_cast<int64_t>(snapshot.Percentile(100)) << std::endl;
+    }
+    if (measure_us > 0) {
+        std::cout << "tpmC: " << std::fixed << std::setprecision(1)
+                  << stats_[kNewOrderTxn].succ.Get() * 60000000.0 / measure_us
+                  << std::endl;
     }
 }
 
@@ -48,59 +175,84 @@ void Driver::Join() {
     }
 }
 
-void Driver::RunOneTransaction() {
-    int rand_num = rand_gen_->GetRandom(1, 100);
+void Driver::RunOneTransaction(RandomGenerator* rand_gen, int32_t warehouse_id) {
+    int rand_num = rand_gen->GetRandom(1, 100);
+    TpccTxnType type = kNewOrderTxn;
+    int64_t start_us = get_micros();
+    bool succ = false;
     if (rand_num <= kTpccTransactionRatios[0]) {        //  %4 do stock_level
-        RunStockLevelTxn();
+        type = kStockLevelTxn;
+        succ = RunStockLevelTxn(rand_gen, warehouse_id);
     } else if (rand_num <= kTpccTransactionRatios[1]) { //  %4 do order_status
-        RunOrderStatusTxn();
+        type = kOrderStatusTxn;
+        succ = RunOrderStatusTxn(rand_gen, warehouse_id);
     } else if (rand_num <= kTpccTransactionRatios[2]) { //  %4 do delivery
-        RunDeliveryTxn();
+        type = kDeliveryTxn;
+        succ = RunDeliveryTxn(rand_gen, warehouse_id);
     } else if (rand_num <= kTpccTransactionRatios[3]) { // %43 do payment
-        RunPaymentTxn();
+        type = kPaymentTxn;
+        succ = RunPaymentTxn(rand_gen, warehouse_id);
     } else {                                            // %45 do new_order
-        RunNewOrderTxn();
+        type = kNewOrderTxn;
+        succ = RunNewOrderTxn(rand_gen, warehouse_id);
+    }
+    int64_t latency_us = get_micros() - start_us;
+
+    interval_txns_.Inc();
+    if (succ && type == kNewOrderTxn) {
+        interval_new_orders_.Inc();
+    }
+    if (measuring_) {
+        TxnStat& stat = stats_[type];
+        if (succ) {
+            stat.succ.Inc();
+        } else {
+            stat.fail.Inc();
+        }
+        stat.latency.Add(latency_us);
     }
-} 
+}
 
-void Driver::RunStockLevelTxn() {
-    int32_t threshold = rand_gen_->GetRandom(kMinStockLevelThreshold, kMaxStockLevelThreshold); 
+bool Driver::RunStockLevelTxn(RandomGenerator* rand_gen, int32_t warehouse_id) {
+    int32_t threshold = rand_gen->GetRandom(kMinStockLevelThreshold, kMaxStockLevelThreshold); 
     StockLevelResult ret;
-    db_->StockLevelTxn(FindWareHouse(), FindDistrict(), threshold, &ret);
+    db_->StockLevelTxn(warehouse_id, FindDistrict(rand_gen), threshold, &ret);
+    return ret.State();
 }
 
-void Driver::RunOrderStatusTxn() {
-    int x = rand_gen_->GetRandom(1, 100);
+bool Driver::RunOrderStatusTxn(RandomGenerator* rand_gen, int32_t warehouse_id) {
+    int x = rand_gen->GetRandom(1, 100);
     OrderStatusResult ret;
     if (x <= 60) {
         // 60% order_status by lastname
-        std::string last_name = GenLastName(rand_gen_, kCustomerCountPerDistrict);
-        db_->OrderStatusTxn(true, FindWareHouse(), FindDistrict(), 
+        std::string last_name = GenLastName(rand_gen, kCustomerCountPerDistrict);
+        db_->OrderStatusTxn(true, warehouse_id, FindDistrict(rand_gen), 
                 -1, last_name, &ret);
     } else {
         // 40% order_status by customer_id
-        db_->OrderStatusTxn(false, FindWareHouse(), FindDistrict(), 
-                FindCustomerId(), "", &ret);
+        db_->OrderStatusTxn(false, warehouse_id, FindDistrict(rand_gen), 
+                FindCustomerId(rand_gen), "", &ret);
     }
+    return ret.State();
 }
 
-void Driver::RunDeliveryTxn() {
-    int32_t carrier_id = rand_gen_->GetRandom(kMinCarrierId, kMaxCarrierId);
+bool Driver::RunDeliveryTxn(RandomGenerator* rand_gen, int32_t warehouse_id) {
+    int32_t carrier_id = rand_gen->GetRandom(kMinCarrierId, kMaxCarrierId);
     DeliveryResult ret;;
-    db_->DeliveryTxn(FindWareHouse(), carrier_id, get_curtime_str(), &ret); 
+    db_->DeliveryTxn(warehouse_id, carrier_id, get_curtime_str(), &ret); 
+    return ret.State();
 }
 
-void Driver::RunPaymentTxn() {
-    int32_t warehouse_id = FindWareHouse();
-    int32_t district_id = FindDistrict();
+bool Driver::RunPaymentTxn(RandomGenerator* rand_gen, int32_t warehouse_id) {
+    int32_t district_id = FindDistrict(rand_gen);
 
-    float h_amount = rand_gen_->MakeFloat(kRuntimeMinAmount, kRuntimeMaxAmount, 
+    float h_amount = rand_gen->MakeFloat(kRuntimeMinAmount, kRuntimeMaxAmount, 
             kRuntimeAmountDigits);
 
     int32_t customer_warehouse_id = -1;
     int32_t customer_district_id = -1;
 
-    int x = rand_gen_->GetRandom(1, 100);
+    int x = rand_gen->GetRandom(1, 100);
     
     // set customer c_w_id and c_d_id 
     if (FLAGS_warehouses_count == 1 && x <= 85) {
@@ -110,34 +262,33 @@ void Driver::RunPaymentTxn() {
     } else {
         // 15% payment through remote warehouse
         customer_warehouse_id = 
-            rand_gen_->GetRandom(1, FLAGS_warehouses_count, warehouse_id);
-        customer_district_id = FindDistrict(); 
+            rand_gen->GetRandom(1, FLAGS_warehouses_count, warehouse_id);
+        customer_district_id = FindDistrict(rand_gen); 
     }
 
-    x = rand_gen_->GetRandom(1, 100);
+    x = rand_gen->GetRandom(1, 100);
     PaymentResult ret;
     if (x <= 60) {
         // 60% payment by lastname
-        std::string last_name = GenLastName(rand_gen_, kCustomerCountPerDistrict);
+        std::string last_name = GenLastName(rand_gen, kCustomerCountPerDistrict);
         db_->PaymentTxn(true, warehouse_id, district_id, 
                 customer_warehouse_id, customer_district_id, -1,
                 last_name, h_amount, &ret);
     } else {
         // 40% payment by customer_id
         db_->PaymentTxn(false, warehouse_id, district_id, 
-                customer_warehouse_id, customer_district_id, FindCustomerId(),
+                customer_warehouse_id, customer_district_id, FindCustomerId(rand_gen),
                 "", h_amount, &ret);
     }
+    return ret.State();
 }
 
-void Driver::RunNewOrderTxn() {
-    int32_t warehouse_id = FindWareHouse();
-
+bool Driver::RunNewOrderTxn(RandomGenerator* rand_gen, int32_t warehouse_id) {
     // init NewOrderInfo
     NewOrderInfo info;
     // 1% of new_order transactions will be failed
-    info.need_failed = rand_gen_->GetRandom(1,100) == 1 ? true : false; 
-    info.o_ol_cnt = rand_gen_->GetRandom(kMinOrderLineCnt, kMaxOrderLineCnt);
+    info.need_failed = rand_gen->GetRandom(1,100) == 1 ? true : false; 
+    info.o_ol_cnt = rand_gen->GetRandom(kMinOrderLineCnt, kMaxOrderLineCnt);
 
     info.ol_supply_w_ids.reserve(info.o_ol_cnt);
     info.ol_i_ids.reserve(info.o_ol_cnt);
@@ -145,21 +296,22 @@ void Driver::RunNewOrderTxn() {
     info.o_all_local = 1;
     for (int32_t i = 0; i < info.o_ol_cnt; ++i) {
         // 1% of orderlines will be remote order
-        bool remote = rand_gen_->GetRandom(1, 100) == 1 ? true : false;
+        bool remote = rand_gen->GetRandom(1, 100) == 1 ? true : false;
         if (FLAGS_warehouses_count > 1 && remote) {
             info.ol_supply_w_ids.emplace_back(
-                    rand_gen_->GetRandom(1, FLAGS_warehouses_count, warehouse_id));
+                    rand_gen->GetRandom(1, FLAGS_warehouses_count, warehouse_id));
             info.o_all_local = 0;
         } else {
             info.ol_supply_w_ids.emplace_back(warehouse_id);
         }
-        info.ol_i_ids.emplace_back(FindItemId());
+        info.ol_i_ids.emplace_back(FindItemId(rand_gen));
         info.ol_quantities.emplace_back(
-                rand_gen_->GetRandom(1, kMaxOrderLineQuantity));
+                rand_gen->GetRandom(1, kMaxOrderLineQuantity));
     }
 
     NewOrderResult ret;
-    db_->NewOrderTxn(warehouse_id, FindDistrict(), FindCustomerId(), info, &ret);
+    db_->NewOrderTxn(warehouse_id, FindDistrict(rand_gen), FindCustomerId(rand_gen), info, &ret);
+    return ret.State();
 }
 
 void Driver::PushToInsertQueue(const ThreadPool::Task& task) {
@@ -170,20 +322,20 @@ void Driver::PushToInsertQueue(const ThreadPool::Task& task) {
     VLOG(12) << "thread_pool pending num = " << thread_pool_.PendingNum();
 }
 
-int32_t Driver::FindWareHouse() {
-    return rand_gen_->GetRandom(1, FLAGS_warehouses_count);
+int32_t Driver::FindWareHouse(RandomGenerator* rand_gen) {
+    return rand_gen->GetRandom(1, FLAGS_warehouses_count);
 }
 
-int32_t Driver::FindDistrict() {
-    return rand_gen_->GetRandom(1, kDistrictCountPerWarehouse);
+int32_t Driver::FindDistrict(RandomGenerator* rand_gen) {
+    return rand_gen->GetRandom(1, kDistrictCountPerWarehouse);
 }
 
-int32_t Driver::FindCustomerId() {
-    return rand_gen_->NURand(1023, 1, kCustomerCountPerDistrict);
+int32_t Driver::FindCustomerId(RandomGenerator* rand_gen) {
+    return rand_gen->NURand(1023, 1, kCustomerCountPerDistrict);
 }
 
-int32_t Driver::FindItemId() {
-    return rand_gen_->NURand(8191, 1, kItemCount); 
+int32_t Driver::FindItemId(RandomGenerator* rand_gen) {
+    return rand_gen->NURand(8191, 1, kItemCount); 
 }
 
 } // namespace tpcc
@@ -7,6 +7,7 @@
 #ifndef TERA_BENCHMARK_TPCC_DRIVER_H
 #define TERA_BENCHMARK_TPCC_DRIVER_H
 
+#include <atomic>
 #include <stdint.h>
 #include <string>
 
@@ -14,6 +15,7 @@
 #include "benchmark/tpcc/tpccdb.h"
 #include "common/counter.h"
 #include "common/event.h"
+#include "common/metric/log_linear_histogram.h"
 #include "common/thread_pool.h"
 
 namespace tera {
@@ -23,43 +25,78 @@ class Driver {
 public:
     Driver(RandomGenerator* random_gen, TpccDb* db);
     ~Driver(){}
+
+    // run --transactions_count transactions one by one
     void RunTransactions();
     void Join();
 
+    // Run --warehouses_count * --tpcc_terminals_per_warehouse terminals
+    // for a warmup phase and a measure phase, each terminal runs
+    // transactions of its home warehouse one by one with keying and
+    // think times between them.  The tpmC of every report interval is
+    // printed while running.
+    void RunTerminals();
+
+    // print the count and latency percentiles of each type of the
+    // measured transactions, and the tpmC of the measure phase
+    void PrintSummary(int64_t measure_us);
+
 private:
+    struct TxnStat {
+        Counter succ;
+        Counter fail;
+        // latency in us of both the succeeded and failed transactions
+        LogLinearHistogram latency;
+    };
+
     void PrintJoinTimeoutInfo(int need_cnt, int table_enum_num);
 
     // for run transaction
-    void RunOneTransaction();
+    void RunOneTransaction(RandomGenerator* rand_gen, int32_t warehouse_id);
+
+    void RunTerminal(int32_t terminal_id, const NURandConstant& constant);
+
+    void PrintInterval(int64_t interval_us, const char* phase);
     //
-    void RunStockLevelTxn();
+    bool RunStockLevelTxn(RandomGenerator* rand_gen, int32_t warehouse_id);
 
-    void RunOrderStatusTxn();
+    bool RunOrderStatusTxn(RandomGenerator* rand_gen, int32_t warehouse_id);
 
-    void RunDeliveryTxn();
+    bool RunDeliveryTxn(RandomGenerator* rand_gen, int32_t warehouse_id);
 
-    void RunPaymentTxn();
+    bool RunPaymentTxn(RandomGenerator* rand_gen, int32_t warehouse_id);
 
-    void RunNewOrderTxn();
+    bool RunNewOrderTxn(RandomGenerator* rand_gen, int32_t warehouse_id);
 
     // for async run txn
     void PushToInsertQueue(const ThreadPool::Task& task);
 
-    int32_t FindWareHouse();
+    int32_t FindWareHouse(RandomGenerator* rand_gen);
+
+    int32_t FindDistrict(RandomGenerator* rand_gen);
+
+    int32_t FindCustomerId(RandomGenerator* rand_gen);
 
-    int32_t FindDistrict();
-    
-    int32_t FindCustomerId();
-    
-    int32_t FindItemId();
+    int32_t FindItemId(RandomGenerator* rand_gen);
+
+    // sleep a negative exponential distributed time of "mean_ms"
+    void ThinkTime(RandomGenerator* rand_gen, int32_t mean_ms);
 private:
-    typedef std::vector<std::pair<Counter, Counter>> TxnStates; 
+    typedef std::vector<std::pair<Counter, Counter>> TxnStates;
     CompletedEvent event_;
     RandomGenerator* rand_gen_;
     TpccDb* db_;
     TxnStates states_;
     std::string now_datatime_;
     common::ThreadPool thread_pool_;
+
+    // only the transactions of the measure phase are counted in stats_
+    std::atomic<bool> measuring_;
+    std::atomic<bool> stop_;
+    TxnStat stats_[kTpccTxnTypeCnt];
+    // transactions finished in the current report interval
+    Counter interval_txns_;
+    Counter interval_new_orders_;
 };
 
 } // namespace tpcc
@@ -6,13 +6,24 @@
 
 #include "benchmark/tpcc/mock_tpccdb.h"
 
+#include <unistd.h>
+
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+DECLARE_int64(tpcc_mock_txn_latency_us);
+
 namespace tera {
 namespace tpcc {
 
 MockTpccDb::MockTpccDb() : flag_(true) {}
 
+void MockTpccDb::MockTxn(TxnResult* ret) {
+    if (FLAGS_tpcc_mock_txn_latency_us > 0) {
+        usleep(FLAGS_tpcc_mock_txn_latency_us);
+    }
+    ret->SetState(flag_);
+}
+
 } // namespace tpcc
 } // namespace tera
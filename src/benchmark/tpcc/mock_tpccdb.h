@@ -62,18 +62,24 @@ public:
 
     virtual void StockLevelTxn(int32_t warehouse_id, int32_t district_id, 
                                int32_t threshold, 
-                               StockLevelResult* ret) {}
+                               StockLevelResult* ret) {
+        MockTxn(ret);
+    }
 
     virtual void DeliveryTxn(int32_t warehouse_id, 
                              int32_t carrier_id, 
                              const std::string& delivery_datetime,
-                             DeliveryResult* ret) {}
+                             DeliveryResult* ret) {
+        MockTxn(ret);
+    }
 
     virtual void OrderStatusTxn(bool by_last_name,
                                 int32_t warehouse_id, int32_t district_id, 
                                 int32_t c_customer_id, 
                                 const std::string& last_name,
-                                OrderStatusResult* ret) {}
+                                OrderStatusResult* ret) {
+        MockTxn(ret);
+    }
 
     virtual void PaymentTxn(bool by_last_name,
                             int32_t warehouse_id, int32_t district_id, 
@@ -81,12 +87,20 @@ public:
                             int32_t c_customer_id, 
                             const std::string& last_name,
                             int32_t h_amount,
-                            PaymentResult* ret) {}
+                            PaymentResult* ret) {
+        MockTxn(ret);
+    }
 
     virtual void NewOrderTxn(int32_t warehouse_id, 
                              int32_t district_id, 
                              int32_t customer_id, const NewOrderInfo& info,
-                             NewOrderResult* ret) {}
+                             NewOrderResult* ret) {
+        MockTxn(ret);
+    }
+
+private:
+    // a transaction takes --tpcc_mock_txn_latency_us and results in flag_
+    void MockTxn(TxnResult* ret);
 
 private:
     bool flag_;
@@ -7,17 +7,22 @@
 #include "benchmark/tpcc/random_generator.h"
 
 #include <assert.h>
+#include <string.h>
 
 namespace tera {
 namespace tpcc {
 
 RandomGenerator::RandomGenerator():c_({0,0,0}) {
-    InitRandomState();
+    InitRandomState(static_cast<unsigned int>(time(NULL)));
 }
 
-void RandomGenerator::InitRandomState() {
+RandomGenerator::RandomGenerator(unsigned int seed):c_({0,0,0}) {
+    InitRandomState(seed);
+}
+
+void RandomGenerator::InitRandomState(unsigned int seed) {
     memset(&rand_state_, 0, sizeof(rand_state_));
-    int ret = initstate_r(static_cast<unsigned int>(time(NULL)),
+    int ret = initstate_r(seed,
                           rand_state_buf_,
                           sizeof(rand_state_buf_),
                           &rand_state_);
@@ -34,6 +39,10 @@ void RandomGenerator::SetRandomConstant() {
     c_.ol_i_id = GetRandom(0, 8191);
 }
 
+void RandomGenerator::CopyRandomConstant(const NURandConstant& constant_for_run) {
+    c_ = constant_for_run;
+}
+
 inline bool VarfiyConstantAvailableForRun(int run_last, int load_last) {
     int delta = run_last - load_last;
     delta = delta > 0 ? delta : -1 * delta;
@@ -25,11 +25,15 @@ struct NURandConstant {
 class RandomGenerator {
 public:
     RandomGenerator();
+    // generators created in the same second need different seeds
+    explicit RandomGenerator(unsigned int seed);
     virtual ~RandomGenerator(){}
 
     NURandConstant GetRandomConstant() const;
     void SetRandomConstant();
     void SetRandomConstant(const NURandConstant& constant_for_load);
+    // use the same constant as another generator of the run
+    void CopyRandomConstant(const NURandConstant& constant_for_run);
 
     // make a string A len=rand[lower_len, upper_len] A[x] = set(a..z)
     std::string MakeAString(int lower_len, int upper_len);
@@ -48,7 +52,7 @@ public:
 
     int GetRandom(int lower, int upper, int exclude);
 private:
-    void InitRandomState();
+    void InitRandomState(unsigned int seed);
 private:
     // for system call random_r and initstate_r
     char rand_state_buf_[kRandomStateSize];
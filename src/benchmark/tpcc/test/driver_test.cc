@@ -0,0 +1,95 @@
+// Copyright (c) 2015-2017, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "benchmark/tpcc/driver.h"
+#include "benchmark/tpcc/mock_tpccdb.h"
+#include "benchmark/tpcc/random_generator.h"
+
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+
+DECLARE_int32(warehouses_count);
+DECLARE_int64(transactions_count);
+DECLARE_int32(tpcc_terminals_per_warehouse);
+DECLARE_int32(tpcc_think_time_ms);
+DECLARE_int32(tpcc_warmup_seconds);
+DECLARE_int32(tpcc_run_seconds);
+DECLARE_int64(tpcc_mock_txn_latency_us);
+
+namespace tera {
+namespace tpcc {
+
+class DriverTest : public ::testing::Test {
+public:
+    DriverTest() {
+        random_gen_.SetRandomConstant();
+        driver_ = new Driver(&random_gen_, &mdb_);
+    }
+
+    ~DriverTest() {
+        delete driver_;
+    }
+
+    int64_t SuccCount() {
+        int64_t cnt = 0;
+        for (int i = 0; i < kTpccTxnTypeCnt; ++i) {
+            cnt += driver_->stats_[i].succ.Get();
+        }
+        return cnt;
+    }
+
+    int64_t FailCount() {
+        int64_t cnt = 0;
+        for (int i = 0; i < kTpccTxnTypeCnt; ++i) {
+            cnt += driver_->stats_[i].fail.Get();
+        }
+        return cnt;
+    }
+
+private:
+    RandomGenerator random_gen_;
+    MockTpccDb mdb_;
+    Driver* driver_;
+};
+
+TEST_F(DriverTest, RunTransactions) {
+    FLAGS_transactions_count = 1000;
+    mdb_.flag_ = true;
+    driver_->RunTransactions();
+    EXPECT_EQ(SuccCount(), 1000);
+    EXPECT_EQ(FailCount(), 0);
+    // about 45% new orders
+    int64_t new_orders = driver_->stats_[kNewOrderTxn].succ.Get();
+    EXPECT_GT(new_orders, 300);
+    EXPECT_LT(new_orders, 600);
+
+    mdb_.flag_ = false;
+    driver_->RunTransactions();
+    EXPECT_EQ(SuccCount(), 1000);
+    EXPECT_EQ(FailCount(), 1000);
+}
+
+TEST_F(DriverTest, RunTerminals) {
+    FLAGS_warehouses_count = 2;
+    FLAGS_tpcc_terminals_per_warehouse = 4;
+    FLAGS_tpcc_think_time_ms = 1;
+    FLAGS_tpcc_warmup_seconds = 1;
+    FLAGS_tpcc_run_seconds = 1;
+    FLAGS_tpcc_mock_txn_latency_us = 1000;
+    mdb_.flag_ = true;
+    driver_->RunTerminals();
+    EXPECT_GT(SuccCount(), 0);
+    EXPECT_EQ(FailCount(), 0);
+    // no more than 8 terminals * 1s / 1ms transactions are measured
+    EXPECT_LT(SuccCount(), 8 * 1000);
+
+    LogLinearHistogram::Snapshot snapshot;
+    driver_->stats_[kNewOrderTxn].latency.TakeSnapshot(&snapshot, false);
+    EXPECT_EQ(static_cast<int64_t>(snapshot.Num()), driver_->stats_[kNewOrderTxn].succ.Get());
+    EXPECT_GE(snapshot.Percentile(50), 1000);
+    FLAGS_tpcc_mock_txn_latency_us = 0;
+}
+
+} // namespace tpcc
+} // namespace tera
@@ -10,8 +10,15 @@ DEFINE_int64(transactions_count, 200, "the count of transactions");
 DEFINE_int32(warehouses_count, 2, "the count of warsehouses");
 DEFINE_int32(tpcc_thread_pool_size, 20, "size of tpcc thread pool");
 DEFINE_int32(tpcc_run_gtxn_thread_pool_size, 20, "size of tpcc run global transactions thread pool");
-DEFINE_string(db_type, "tera", "test db type");
+DEFINE_string(db_type, "tera", "test db type, [tera | mock], mock runs without a cluster");
 DEFINE_string(tera_client_flagfile, "./tera.flag", "the flag file path of tera client");
 DEFINE_string(tera_table_schema_dir, "./tpcc_schemas/", "table schema directory");
 DEFINE_int32(generate_data_wait_times, 3600000, "(ms) generate data wait times, default 1h");
 DEFINE_int32(driver_wait_times, 3600000, "(ms) driver wait times, default 1h");
+DEFINE_int32(tpcc_terminals_per_warehouse, 10, "the count of terminals per warehouse, each terminal runs transactions one by one");
+DEFINE_int32(tpcc_keying_time_ms, 0, "(ms) keying time of terminals before each transaction");
+DEFINE_int32(tpcc_think_time_ms, 0, "(ms) mean think time of terminals after each transaction, negative exponential distributed");
+DEFINE_int32(tpcc_warmup_seconds, 0, "(s) transactions of the warmup phase are not measured");
+DEFINE_int32(tpcc_run_seconds, 0, "(s) measure phase of terminals, 0 means run --transactions_count transactions in one thread");
+DEFINE_int32(tpcc_report_interval_seconds, 1, "(s) interval to print the tpmC while running terminals");
+DEFINE_int64(tpcc_mock_txn_latency_us, 0, "(us) latency of each transaction of --db_type=mock");
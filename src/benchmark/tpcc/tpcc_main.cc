@@ -21,6 +21,7 @@
 DECLARE_int64(transactions_count);
 DECLARE_int32(warehouses_count);
 DECLARE_string(db_type);
+DECLARE_int32(tpcc_run_seconds);
 
 int main(int argc, char *argv[]) {
     // load conf from flags
@@ -40,6 +41,10 @@ int main(int argc, char *argv[]) {
     random_gen.SetRandomConstant();
 
     tera::tpcc::TpccDb* db = tera::tpcc::TpccDb::NewTpccDb(FLAGS_db_type);
+    if (db == NULL) {
+        LOG(ERROR) << "--db_type=" << FLAGS_db_type << " is not supported";
+        return -1;
+    }
     // do clean tables
     if (argc == 2 && strcmp(argv[1], "clean") == 0) {
         if(!db->CleanTables()) {
@@ -68,11 +73,16 @@ int main(int argc, char *argv[]) {
     random_gen.SetRandomConstant(constant);
     tera::tpcc::Driver driver(&random_gen, db);
     // run test
-    int64_t beg_txn_ts = tera::get_micros();
-    driver.RunTransactions();
-    driver.Join();
-    int64_t cost_txn_t = tera::get_micros() - beg_txn_ts;
-    LOG(INFO) << "RunTransactions Cost:" << cost_txn_t << "us";
+    if (FLAGS_tpcc_run_seconds > 0) {
+        driver.RunTerminals();
+    } else {
+        int64_t beg_txn_ts = tera::get_micros();
+        driver.RunTransactions();
+        driver.Join();
+        int64_t cost_txn_t = tera::get_micros() - beg_txn_ts;
+        LOG(INFO) << "RunTransactions Cost:" << cost_txn_t << "us";
+        driver.PrintSummary(cost_txn_t);
+    }
     delete db;
     return 0;
 }
@@ -32,6 +32,19 @@ const char* const kTpccTables[] = {"t_item", "t_warehouse", "t_district",
 // NewOrder   45% 100
 const int kTpccTransactionRatios[] = {4, 8, 12, 55, 100};
 
+const int kTpccTxnTypeCnt = 5;
+
+enum TpccTxnType {
+    kStockLevelTxn  = 0,
+    kOrderStatusTxn = 1,
+    kDeliveryTxn    = 2,
+    kPaymentTxn     = 3,
+    kNewOrderTxn    = 4
+};
+
+const char* const kTpccTxnTypes[] = {"StockLevel", "OrderStatus", "Delivery",
+                                     "Payment", "NewOrder"};
+
 // http://www.man7.org/linux/man-pages/man3/initstate.3.html
 // Current "optimal" values for the size of the state array n 
 // are 8, 32, 64, 128, and 256 bytes;
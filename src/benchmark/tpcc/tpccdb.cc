@@ -349,6 +349,8 @@ void NewOrderResult::SetSingleLine(const RetTuples& single_line) {
 TpccDb* TpccDb::NewTpccDb(const std::string& db_type) {
     if (db_type == "tera") {
         return new TeraTpccDb();
+    } else if (db_type == "mock") {
+        return new MockTpccDb();
     } else {
         LOG(ERROR) << "not support db:" << db_type;
     }
@@ -282,6 +282,7 @@ enum TpccTables
 
 class TxnResult {
 public:
+    TxnResult() : status_(false) {}
     void SetState(bool status);
     bool State() const;
     void SetReason(const std::string& reason);
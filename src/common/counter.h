@@ -7,6 +7,8 @@
 
 #include <stdio.h>
 
+#include <atomic>
+
 #include "common/atomic.h"
 #include "common/timer.h"
 
@@ -41,6 +43,68 @@ private:
     volatile int64_t val_;
 };
 
+// A counter updated by many threads and read rarely, e.g. a process-wide
+// metric updated for every row.  Each thread adds to a shard padded to a
+// cache line, Get() and Clear() sum up the shards; unlike Counter, the
+// updates do not return the new value.  A counter takes 1 KB, keep
+// per-tablet or per-table counters on Counter.
+class StripedCounter {
+public:
+    static const int kShardNum = 16;
+
+    StripedCounter() {
+        for (int i = 0; i < kShardNum; ++i) {
+            shards_[i].val = 0;
+        }
+    }
+    void Add(int64_t v) {
+        atomic_add64(&shards_[ThreadShard()].val, v);
+    }
+    void Sub(int64_t v) {
+        Add(-v);
+    }
+    void Inc() {
+        Add(1);
+    }
+    void Dec() {
+        Add(-1);
+    }
+    int64_t Get() {
+        int64_t sum = 0;
+        for (int i = 0; i < kShardNum; ++i) {
+            sum += shards_[i].val;
+        }
+        return sum;
+    }
+    int64_t Set(int64_t v) {
+        int64_t old = atomic_swap64(&shards_[0].val, v);
+        for (int i = 1; i < kShardNum; ++i) {
+            old += atomic_swap64(&shards_[i].val, 0);
+        }
+        return old;
+    }
+    int64_t Clear() {
+        return Set(0);
+    }
+
+private:
+    // threads are spread over the shards round-robin at their first update
+    static int ThreadShard() {
+        static std::atomic<uint32_t> next_shard(0);
+        static thread_local int shard = next_shard.fetch_add(1) % kShardNum;
+        return shard;
+    }
+
+    // padded to a cache line, so that neighbouring shards do not share one
+    // as long as the counter itself starts a line; not aligned by alignas,
+    // which "new" of the holder does not honor without -faligned-new
+    struct Shard {
+        volatile int64_t val;
+        char pad[64 - sizeof(int64_t)];
+    };
+    Shard shards_[kShardNum];
+};
+
 class AutoCounter {
 public:
     AutoCounter(Counter* counter, const char* msg1, const char* msg2 = NULL)
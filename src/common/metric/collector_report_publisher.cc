@@ -20,6 +20,7 @@ CollectorReportPublisher& CollectorReportPublisher::GetInstance() {
 
 CollectorReportPublisher::CollectorReportPublisher():
     last_report_timestamp_(get_millis()),
+    refresh_generation_(0),
     last_collector_report_(new CollectorReport) {
     AddHardwareCollectors();
 }
@@ -49,6 +50,7 @@ std::shared_ptr<CollectorReport> CollectorReportPublisher::GetCollectorReport()
 
 void CollectorReportPublisher::Refresh() {
     std::lock_guard<std::recursive_mutex> lock(mutex_);
+    ++refresh_generation_;
 
     std::shared_ptr<CollectorReport> new_report(new CollectorReport());
     int64_t start_ts = new_report->timestamp_ms;
@@ -5,6 +5,7 @@
 #ifndef TERA_COMMON_METRIC_METRICS_H_
 #define TERA_COMMON_METRIC_METRICS_H_
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <stdexcept>
@@ -38,6 +39,9 @@ public:
     static CollectorReportPublisher& GetInstance();
     
     void Refresh();
+    /// the number of Refresh() started, collectors of several metrics of
+    /// one source use it to collect the source once per refresh
+    int64_t RefreshGeneration() const { return refresh_generation_; }
     /// report the instant values of collectors
     std::shared_ptr<CollectorReport> GetCollectorReport();
     std::shared_ptr<SubscriberReport> GetSubscriberReport();
@@ -78,6 +82,7 @@ private:
     SubscriberMap subscribers_;
 
     int64_t last_report_timestamp_;
+    std::atomic<int64_t> refresh_generation_;
 
     std::shared_ptr<CollectorReport> last_collector_report_;
 };
@@ -18,19 +18,29 @@ public:
     explicit CounterCollector(Counter* counter, 
                               bool is_periodic = true):
         counter_(counter), 
+        striped_counter_(NULL),
+        is_periodic_(is_periodic) {}
+
+    explicit CounterCollector(StripedCounter* counter,
+                              bool is_periodic = true):
+        counter_(NULL),
+        striped_counter_(counter),
         is_periodic_(is_periodic) {}
 
     ~CounterCollector() override {}
 
     int64_t Collect() override {
-        if (counter_ == NULL) {
-            return -1;
-        } else {
+        if (counter_ != NULL) {
             return is_periodic_ ? counter_->Clear() : counter_->Get();
+        } else if (striped_counter_ != NULL) {
+            return is_periodic_ ? striped_counter_->Clear() : striped_counter_->Get();
+        } else {
+            return -1;
         }
     }
 private:
     Counter* const counter_;
+    StripedCounter* const striped_counter_;
     const bool is_periodic_;
 };
 } // end namespace tera
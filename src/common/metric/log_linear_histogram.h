@@ -0,0 +1,147 @@
+#pragma once
+// Copyright (c) 2017, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace tera {
+
+// A histogram of non-negative int64 values (e.g. latency in us) which can be
+// fed by many threads at the same time.
+//
+// Buckets are log-linear: values below 16 have a bucket of their own, and
+// each power of 2 above is split into 16 equal buckets, so the relative
+// error of a percentile is below 1/16.  Values above 2^kMaxExponent fall
+// into the last bucket.
+//
+// Add() increments one bucket of the shard of the calling thread without
+// any lock; TakeSnapshot() merges the shards, and with "reset" moves the
+// counts out atomically bucket by bucket, so every value is counted by
+// exactly one snapshot.
+class LogLinearHistogram {
+public:
+    static const int kSubBucketBits = 4;
+    static const int kSubBucketNum = 1 << kSubBucketBits;
+    static const int kMaxExponent = 40;
+    static const int kBucketNum = (kMaxExponent - kSubBucketBits + 2) * kSubBucketNum;
+    static const int kShardNum = 8;
+
+    class Snapshot {
+    public:
+        Snapshot() : counts_(kBucketNum, 0), num_(0) {}
+
+        uint64_t Num() const { return num_; }
+
+        void Clear() {
+            counts_.assign(kBucketNum, 0);
+            num_ = 0;
+        }
+
+        void Merge(const Snapshot& other) {
+            for (int i = 0; i < kBucketNum; ++i) {
+                counts_[i] += other.counts_[i];
+            }
+            num_ += other.num_;
+        }
+
+        // "p" in [0, 100], return -1 if the snapshot is empty
+        double Percentile(double p) const {
+            if (num_ == 0) {
+                return -1;
+            }
+            double threshold = num_ * (p / 100.0);
+            uint64_t sum = 0;
+            for (int i = 0; i < kBucketNum; ++i) {
+                if (counts_[i] == 0) {
+                    continue;
+                }
+                sum += counts_[i];
+                if (sum >= threshold) {
+                    // interpolate in the bucket
+                    double left_sum = sum - counts_[i];
+                    double pos = (threshold - left_sum) / counts_[i];
+                    return BucketLower(i) + BucketWidth(i) * pos;
+                }
+            }
+            return BucketLower(kBucketNum - 1);
+        }
+
+    private:
+        friend class LogLinearHistogram;
+        std::vector<uint64_t> counts_;
+        uint64_t num_;
+    };
+
+    LogLinearHistogram() {
+        for (int s = 0; s < kShardNum; ++s) {
+            for (int i = 0; i < kBucketNum; ++i) {
+                shards_[s].counts[i].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void Add(int64_t value) {
+        shards_[ThreadShard()].counts[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void TakeSnapshot(Snapshot* snapshot, bool reset) {
+        snapshot->Clear();
+        for (int s = 0; s < kShardNum; ++s) {
+            for (int i = 0; i < kBucketNum; ++i) {
+                std::atomic<uint64_t>& count = shards_[s].counts[i];
+                uint64_t n = reset ? count.exchange(0, std::memory_order_relaxed)
+                                   : count.load(std::memory_order_relaxed);
+                snapshot->counts_[i] += n;
+                snapshot->num_ += n;
+            }
+        }
+    }
+
+    static int BucketIndex(int64_t value) {
+        if (value < kSubBucketNum) {
+            return value < 0 ? 0 : static_cast<int>(value);
+        }
+        int exponent = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+        if (exponent > kMaxExponent) {
+            return kBucketNum - 1;
+        }
+        int shift = exponent - kSubBucketBits;
+        return ((shift + 1) << kSubBucketBits) + static_cast<int>((value >> shift) & (kSubBucketNum - 1));
+    }
+
+    static int64_t BucketLower(int index) {
+        if (index < kSubBucketNum) {
+            return index;
+        }
+        int shift = (index >> kSubBucketBits) - 1;
+        return static_cast<int64_t>(kSubBucketNum + (index & (kSubBucketNum - 1))) << shift;
+    }
+
+    static int64_t BucketWidth(int index) {
+        if (index < kSubBucketNum) {
+            return 1;
+        }
+        return 1LL << ((index >> kSubBucketBits) - 1);
+    }
+
+    // Never copied
+    LogLinearHistogram(const LogLinearHistogram&) = delete;
+    LogLinearHistogram& operator=(const LogLinearHistogram&) = delete;
+
+private:
+    // threads are spread over the shards round-robin at their first Add()
+    static int ThreadShard() {
+        static std::atomic<uint32_t> next_shard(0);
+        static thread_local int shard = next_shard.fetch_add(1) % kShardNum;
+        return shard;
+    }
+
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counts[kBucketNum];
+    };
+    Shard shards_[kShardNum];
+};
+
+} // namespace tera
@@ -11,13 +11,16 @@
 #include "common/counter.h"
 
 namespace tera{
-class MetricCounter : public Counter {
+
+// A counter registered as a metric, CounterType is Counter or StripedCounter.
+template <typename CounterType>
+class BasicMetricCounter : public CounterType {
 public:
     // create a metric with empty label
-    explicit MetricCounter(const std::string& name,
-                           SubscriberTypeList type_list = {SubscriberType::LATEST},
-                           bool is_periodic = true):
-            Counter(),
+    explicit BasicMetricCounter(const std::string& name,
+                                SubscriberTypeList type_list = {SubscriberType::LATEST},
+                                bool is_periodic = true):
+            CounterType(),
             registered_(false),
             metric_id_(name),
             type_list_(type_list),
@@ -35,11 +38,11 @@ public:
     // create a metric with name and label
     // label_str format: k1:v1,k2:v2,...
     // can build by LabelStringBuilder().Append("k1", "v1").Append("k2","v2").ToString();
-    MetricCounter(const std::string& name,
-                  const std::string& label_str,
-                  SubscriberTypeList type_list = {SubscriberType::LATEST},
-                  bool is_periodic = true):
-            Counter(),
+    BasicMetricCounter(const std::string& name,
+                       const std::string& label_str,
+                       SubscriberTypeList type_list = {SubscriberType::LATEST},
+                       bool is_periodic = true):
+            CounterType(),
             registered_(false),
             type_list_(type_list),
             is_periodic_(is_periodic) {
@@ -52,7 +55,7 @@ public:
             type_list);
     }
 
-    MetricCounter(MetricCounter&& counter) {
+    BasicMetricCounter(BasicMetricCounter&& counter) {
         // parse metric id
         if (counter.registered_) {
             CollectorReportPublisher::GetInstance().DeleteCollector(counter.metric_id_);
@@ -61,7 +64,7 @@ public:
         metric_id_ = counter.metric_id_;
         is_periodic_ = counter.is_periodic_;
         type_list_ = counter.type_list_;
-        Set(counter.Get());
+        this->Set(counter.Get());
         counter.registered_ = false;
         registered_ = CollectorReportPublisher::GetInstance().AddCollector(
             metric_id_,
@@ -69,7 +72,7 @@ public:
             type_list_);
     }
 
-    virtual ~MetricCounter() {
+    virtual ~BasicMetricCounter() {
         if (registered_) {
             // do unregister
             CollectorReportPublisher::GetInstance().DeleteCollector(metric_id_);
@@ -81,8 +84,8 @@ public:
     }
 
     //Never copyied
-    MetricCounter(const MetricCounter&) = delete;
-    MetricCounter& operator=(const MetricCounter&) = delete;
+    BasicMetricCounter(const BasicMetricCounter&) = delete;
+    BasicMetricCounter& operator=(const BasicMetricCounter&) = delete;
 
 private:
     bool registered_;
@@ -90,4 +93,8 @@ private:
     SubscriberTypeList type_list_;
     bool is_periodic_;
 };
+
+typedef BasicMetricCounter<Counter> MetricCounter;
+// for metrics updated on hot paths and only read by the collector
+typedef BasicMetricCounter<StripedCounter> StripedMetricCounter;
 }
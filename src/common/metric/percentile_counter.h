@@ -2,10 +2,14 @@
 // Copyright (c) 2017, Baidu.com, Inc. All Rights Reserved
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
+#include <mutex>
+#include <sstream>
+#include <vector>
+
 #include "common/metric/collector.h"
 #include "common/metric/subscriber.h"
 #include "common/metric/collector_report_publisher.h"
-#include "leveldb/util/histogram.h"
+#include "common/metric/log_linear_histogram.h"
 
 namespace tera{
 
@@ -15,15 +19,20 @@ class PercentileCollector : public Collector {
 public:
     virtual ~PercentileCollector() {}
     // return a instant value of the metric for tera to dump log and other usage
-    PercentileCollector(PercentileCounter* pc):
-        pc_(pc) {};
+    PercentileCollector(PercentileCounter* pc, size_t index = 0):
+        pc_(pc), index_(index) {};
 
     inline virtual int64_t Collect() override;
 
 private:
     PercentileCounter* pc_;
+    size_t index_;
 };
 
+// Append() is thread safe and lock free, see LogLinearHistogram.
+// A counter may export several percentiles of the same values, each as a
+// metric with an extra label "percentile:<p>"; they are all computed from
+// one snapshot of the values appended since the last collection.
 class PercentileCounter {
 public:
     // create a metric with name and label
@@ -33,8 +42,9 @@ public:
                       const std::string& label_str,
                       double percentile,
                       SubscriberTypeList type_list = {SubscriberType::LATEST}):
-            percentile_(percentile),
-            registered_(false) {
+            percentiles_(1, percentile),
+            registered_(false),
+            collect_generation_(-1) {
         // parse metric id
         MetricId::ParseFromStringWithThrow(name, label_str, &metric_id_);
         // legal label str format, do register
@@ -42,13 +52,17 @@ public:
             metric_id_,
             std::unique_ptr<Collector>(new PercentileCollector(this)),
             type_list);
+        if (registered_) {
+            metric_ids_.push_back(metric_id_);
+        }
     }
 
     PercentileCounter(const std::string& name,
                       double percentile,
                       SubscriberTypeList type_list = {SubscriberType::LATEST}):
-            percentile_(percentile),
-            registered_(false) {
+            percentiles_(1, percentile),
+            registered_(false),
+            collect_generation_(-1) {
         // parse metric id
         MetricId::ParseFromStringWithThrow(name, "", &metric_id_);
         // legal label str format, do register
@@ -56,12 +70,50 @@ public:
             metric_id_,
             std::unique_ptr<Collector>(new PercentileCollector(this)),
             type_list);
+        if (registered_) {
+            metric_ids_.push_back(metric_id_);
+        }
+    }
+
+    // one metric for each of "percentiles", labeled by
+    // "<label_str>,percentile:<p>"
+    PercentileCounter(const std::string& name,
+                      const std::string& label_str,
+                      const std::vector<double>& percentiles,
+                      SubscriberTypeList type_list = {SubscriberType::LATEST}):
+            percentiles_(percentiles),
+            registered_(false),
+            collect_generation_(-1) {
+        if (percentiles_.empty()) {
+            throw std::invalid_argument("percentiles");
+        }
+        std::vector<MetricId> metric_ids(percentiles_.size());
+        for (size_t i = 0; i < percentiles_.size(); ++i) {
+            std::ostringstream label;
+            if (!label_str.empty()) {
+                label << label_str << ",";
+            }
+            label << "percentile:" << percentiles_[i];
+            MetricId::ParseFromStringWithThrow(name, label.str(), &metric_ids[i]);
+        }
+        metric_id_ = metric_ids[0];
+        registered_ = true;
+        for (size_t i = 0; i < metric_ids.size(); ++i) {
+            if (CollectorReportPublisher::GetInstance().AddCollector(
+                    metric_ids[i],
+                    std::unique_ptr<Collector>(new PercentileCollector(this, i)),
+                    type_list)) {
+                metric_ids_.push_back(metric_ids[i]);
+            } else {
+                registered_ = false;
+            }
+        }
     }
 
     virtual ~PercentileCounter() {
-        if (registered_) {
-            // do unregister
-            CollectorReportPublisher::GetInstance().DeleteCollector(metric_id_);
+        // do unregister
+        for (size_t i = 0; i < metric_ids_.size(); ++i) {
+            CollectorReportPublisher::GetInstance().DeleteCollector(metric_ids_[i]);
         }
     }
 
@@ -69,20 +121,37 @@ public:
         return registered_;
     }
 
+    // the first percentile of the values appended since the last collection
     int64_t Get() {
-        double percentile_value = hist_.Percentile(percentile_);
-        if (isnan(percentile_value)) {
-            return -1;
-        }
-        return (int64_t) percentile_value;
+        return Get(percentiles_[0]);
+    }
+
+    int64_t Get(double percentile) {
+        LogLinearHistogram::Snapshot snapshot;
+        hist_.TakeSnapshot(&snapshot, false);
+        return (int64_t)snapshot.Percentile(percentile);
     }
 
     void Clear() {
-        hist_.Clear();
+        LogLinearHistogram::Snapshot snapshot;
+        hist_.TakeSnapshot(&snapshot, true);
     }
 
     void Append(int64_t v) {
-        hist_.Add((double)v);
+        hist_.Add(v);
+    }
+
+    // Called by the collector of "percentiles_[index]".  The first
+    // collector of a refresh of the publisher takes and resets the
+    // snapshot, the others of the same refresh share it.
+    int64_t Collect(size_t index) {
+        int64_t generation = CollectorReportPublisher::GetInstance().RefreshGeneration();
+        std::lock_guard<std::mutex> lock(collect_mutex_);
+        if (collect_generation_ != generation) {
+            hist_.TakeSnapshot(&collect_snapshot_, true);
+            collect_generation_ = generation;
+        }
+        return (int64_t)collect_snapshot_.Percentile(percentiles_[index]);
     }
 
     //Never copyied
@@ -90,15 +159,18 @@ public:
     PercentileCounter& operator=(const PercentileCounter&) = delete;
 
 private:
-    double percentile_;
+    std::vector<double> percentiles_;
     bool registered_;
     MetricId metric_id_;
-    leveldb::Histogram hist_;
+    std::vector<MetricId> metric_ids_;
+    LogLinearHistogram hist_;
+
+    std::mutex collect_mutex_;
+    int64_t collect_generation_;     // refresh of collect_snapshot_
+    LogLinearHistogram::Snapshot collect_snapshot_;
 };
 
 int64_t PercentileCollector::Collect() {
-    int64_t val = (int64_t)pc_->Get();
-    pc_->Clear();
-    return val;
+    return pc_->Collect(index_);
+}
 }
-}
\ No newline at end of file
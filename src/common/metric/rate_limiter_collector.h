@@ -0,0 +1,61 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TERA_COMMON_METRIC_RATE_LIMITER_COLLECTOR_H_
+#define TERA_COMMON_METRIC_RATE_LIMITER_COLLECTOR_H_
+
+#include "common/metric/collector.h"
+#include "leveldb/rate_limiter.h"
+
+namespace tera {
+
+enum class RateLimiterCollectType {
+    kBytes,         // bytes requested since the last collection
+    kWaitMicros,    // microseconds waited since the last collection
+    kBytesPerSecond,
+};
+
+class RateLimiterCollector : public Collector {
+public:
+    RateLimiterCollector(leveldb::RateLimiter* limiter,
+                         leveldb::IOPriority pri,
+                         RateLimiterCollectType type)
+        : limiter_(limiter), pri_(pri), type_(type), last_total_(0) {}
+
+    virtual ~RateLimiterCollector() {}
+
+    virtual int64_t Collect() {
+        if (limiter_ == NULL) {
+            return 0;
+        }
+        switch (type_) {
+            case RateLimiterCollectType::kBytes:
+                return Delta(limiter_->TotalBytes(pri_));
+            case RateLimiterCollectType::kWaitMicros:
+                return Delta(limiter_->TotalWaitMicros(pri_));
+            case RateLimiterCollectType::kBytesPerSecond:
+                return limiter_->GetBytesPerSecond(pri_);
+            default:
+                return 0;
+        }
+    }
+
+private:
+    int64_t Delta(int64_t total) {
+        int64_t delta = total - last_total_;
+        last_total_ = total;
+        return delta;
+    }
+
+    leveldb::RateLimiter* limiter_;
+    leveldb::IOPriority pri_;
+    RateLimiterCollectType type_;
+    int64_t last_total_;
+};
+
+} // end namespace tera
+
+#endif // TERA_COMMON_METRIC_RATE_LIMITER_COLLECTOR_H_
+
+/* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
@@ -6,6 +6,9 @@
 #include <stdio.h>
 
 #include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -20,7 +23,8 @@ int ref = 0;
 int loop_num = 100000;
 int thread_num = 1000;
 
-void callback_add(Counter* counter) {
+template <typename CounterType>
+void callback_add(CounterType* counter) {
     for (int i = 0; i < loop_num; ++i) {
         counter->Add(100000);
     }
@@ -29,7 +33,8 @@ void callback_add(Counter* counter) {
     ref--;
 }
 
-void callback_sub(Counter* counter) {
+template <typename CounterType>
+void callback_sub(CounterType* counter) {
     for (int i = 0; i < loop_num; ++i) {
         counter->Sub(100000);
     }
@@ -38,7 +43,8 @@ void callback_sub(Counter* counter) {
     ref--;
 }
 
-void callback_inc(Counter* counter) {
+template <typename CounterType>
+void callback_inc(CounterType* counter) {
     for (int i = 0; i < loop_num; ++i) {
         counter->Inc();
     }
@@ -47,7 +53,8 @@ void callback_inc(Counter* counter) {
     ref--;
 }
 
-void callback_dec(Counter* counter) {
+template <typename CounterType>
+void callback_dec(CounterType* counter) {
     for (int i = 0; i < loop_num; ++i) {
         counter->Dec();
     }
@@ -70,16 +77,16 @@ TEST(CounterTest, Basic) {
     ThreadPool* pool = new ThreadPool(thread_num);
     for (int i = 0; i < thread_num / 4; ++i) {
         std::function<void (int64_t)> callback =
-            std::bind(&callback_add, &counter);
+            std::bind(&callback_add<Counter>, &counter);
         pool->AddTask(callback);
 
-        callback = std::bind(&callback_sub, &counter);
+        callback = std::bind(&callback_sub<Counter>, &counter);
         pool->AddTask(callback);
 
-        callback = std::bind(&callback_inc, &counter);
+        callback = std::bind(&callback_inc<Counter>, &counter);
         pool->AddTask(callback);
 
-        callback = std::bind(&callback_dec, &counter);
+        callback = std::bind(&callback_dec<Counter>, &counter);
         pool->AddTask(callback);
 
         MutexLock locker(&mutex);
@@ -100,10 +107,10 @@ TEST(CounterTest, Clear) {
     ThreadPool* pool = new ThreadPool(thread_num);
     for (int i = 0; i < thread_num / 3; ++i) {
         std::function<void (int64_t)> callback =
-            std::bind(&callback_add, &counter);
+            std::bind(&callback_add<Counter>, &counter);
         pool->AddTask(callback);
 
-        callback = std::bind(&callback_inc, &counter);
+        callback = std::bind(&callback_inc<Counter>, &counter);
         pool->AddTask(callback);
 
         callback = std::bind(&callback_clear, &counter);
@@ -123,4 +130,66 @@ TEST(CounterTest, Clear) {
     delete pool;
 }
 
+TEST(StripedCounterTest, Basic) {
+    StripedCounter counter;
+    ThreadPool* pool = new ThreadPool(thread_num);
+    for (int i = 0; i < thread_num / 4; ++i) {
+        pool->AddTask(std::bind(&callback_add<StripedCounter>, &counter));
+        pool->AddTask(std::bind(&callback_sub<StripedCounter>, &counter));
+        pool->AddTask(std::bind(&callback_inc<StripedCounter>, &counter));
+        pool->AddTask(std::bind(&callback_dec<StripedCounter>, &counter));
+        MutexLock locker(&mutex);
+        ref += 4;
+    }
+    while (1) {
+        MutexLock locker(&mutex);
+        if (ref == 0) {
+            break;
+        }
+    }
+    ASSERT_EQ(counter.Get(), 0);
+    delete pool;
+
+    counter.Add(10);
+    ASSERT_EQ(counter.Set(3), 10);
+    ASSERT_EQ(counter.Get(), 3);
+    ASSERT_EQ(counter.Clear(), 3);
+    ASSERT_EQ(counter.Get(), 0);
+}
+
+template <typename CounterType>
+void IncLoop(CounterType* counter, int64_t num) {
+    for (int64_t i = 0; i < num; ++i) {
+        counter->Inc();
+    }
+}
+
+template <typename CounterType>
+int64_t IncPerSecond(int thread_num, int64_t num) {
+    CounterType counter;
+    std::vector<std::thread> threads;
+    int64_t start_us = get_micros();
+    for (int i = 0; i < thread_num; ++i) {
+        threads.push_back(std::thread(&IncLoop<CounterType>, &counter, num));
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    int64_t cost_us = get_micros() - start_us + 1;
+    EXPECT_EQ(counter.Get(), thread_num * num);
+    return thread_num * num * 1000000 / cost_us;
+}
+
+// updates per second of many threads on one counter
+TEST(StripedCounterTest, ScaleBench) {
+    const int64_t kIncNum = 10000000;
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        int64_t num = kIncNum / threads;
+        std::cout << "threads: " << threads
+                  << ", Counter: " << IncPerSecond<Counter>(threads, num) << "/s"
+                  << ", StripedCounter: " << IncPerSecond<StripedCounter>(threads, num) << "/s"
+                  << std::endl;
+    }
+}
+
 } // namespace tera
@@ -5,12 +5,16 @@
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "gflags/gflags.h"
 #include "glog/logging.h"
 #include "gtest/gtest.h"
  
 #include "common/metric/percentile_counter.h" 
+#include "common/timer.h"
+#include "leveldb/util/histogram.h"
  
 namespace tera { 
  
@@ -110,6 +114,140 @@ TEST_F(PercentileCounterTest, CounterTest) {
     
 }
  
+TEST_F(PercentileCounterTest, MultiPercentileTest) {
+    PercentileCounter counter("MultiPercent", label_str_, std::vector<double>{50, 99, 99.9});
+    EXPECT_TRUE(counter.IsRegistered());
+    for (int i = 1; i <= 1000; ++i) {
+        counter.Append(i);
+    }
+    EXPECT_EQ(counter.Get(), counter.Get(50));
+
+    CollectorReportPublisher::GetInstance().Refresh();
+    auto report = CollectorReportPublisher::GetInstance().GetCollectorReport();
+    int64_t p50 = report->FindMetricValue(MetricId("MultiPercent", label_str_ + ",percentile:50"));
+    int64_t p99 = report->FindMetricValue(MetricId("MultiPercent", label_str_ + ",percentile:99"));
+    int64_t p999 = report->FindMetricValue(MetricId("MultiPercent", label_str_ + ",percentile:99.9"));
+    // relative error of the buckets is below 1/16
+    EXPECT_NEAR(p50, 500, 500 / 16);
+    EXPECT_NEAR(p99, 990, 990 / 16);
+    EXPECT_NEAR(p999, 999, 999 / 16);
+    // all the percentiles come from one snapshot
+    EXPECT_EQ(counter.Get(), -1);
+}
+
+TEST_F(PercentileCounterTest, CollectPerRefreshTest) {
+    PercentileCounter counter("PerRefresh", label_str_, std::vector<double>{50, 99});
+    for (int i = 1; i <= 100; ++i) {
+        counter.Append(i);
+    }
+    // a collection out of a refresh does not shift the snapshots of refreshes
+    EXPECT_NEAR(counter.Collect(1), 99, 99 / 16);
+    for (int i = 1001; i <= 1100; ++i) {
+        counter.Append(i);
+    }
+    CollectorReportPublisher::GetInstance().Refresh();
+    auto report = CollectorReportPublisher::GetInstance().GetCollectorReport();
+    EXPECT_NEAR(report->FindMetricValue(MetricId("PerRefresh", label_str_ + ",percentile:50")),
+                1050, 1050 / 16);
+    EXPECT_NEAR(report->FindMetricValue(MetricId("PerRefresh", label_str_ + ",percentile:99")),
+                1099, 1099 / 16);
+
+    CollectorReportPublisher::GetInstance().Refresh();
+    report = CollectorReportPublisher::GetInstance().GetCollectorReport();
+    EXPECT_EQ(report->FindMetricValue(MetricId("PerRefresh", label_str_ + ",percentile:50")), -1);
+    EXPECT_EQ(report->FindMetricValue(MetricId("PerRefresh", label_str_ + ",percentile:99")), -1);
+}
+
+TEST(LogLinearHistogramTest, BucketTest) {
+    int last_index = -1;
+    for (int64_t v = 0; v < (1LL << 20); ++v) {
+        int index = LogLinearHistogram::BucketIndex(v);
+        EXPECT_TRUE(index == last_index || index == last_index + 1) << v;
+        EXPECT_LE(LogLinearHistogram::BucketLower(index), v);
+        EXPECT_GT(LogLinearHistogram::BucketLower(index) + LogLinearHistogram::BucketWidth(index), v);
+        last_index = index;
+    }
+    EXPECT_EQ(0, LogLinearHistogram::BucketIndex(-1));
+    EXPECT_EQ(LogLinearHistogram::kBucketNum - 1, LogLinearHistogram::BucketIndex(INT64_MAX));
+}
+
+void AppendValues(LogLinearHistogram* hist, int64_t num) {
+    for (int64_t i = 0; i < num; ++i) {
+        hist->Add(i);
+    }
+}
+
+// no value is lost or counted twice while snapshots are taken
+TEST(LogLinearHistogramTest, ConcurrentSnapshotTest) {
+    const int kThreadNum = 8;
+    const int64_t kValueNum = 200000;
+    LogLinearHistogram hist;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreadNum; ++i) {
+        threads.push_back(std::thread(&AppendValues, &hist, kValueNum));
+    }
+    LogLinearHistogram::Snapshot total;
+    LogLinearHistogram::Snapshot snapshot;
+    for (int i = 0; i < 100; ++i) {
+        hist.TakeSnapshot(&snapshot, true);
+        total.Merge(snapshot);
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    hist.TakeSnapshot(&snapshot, true);
+    total.Merge(snapshot);
+    EXPECT_EQ(static_cast<uint64_t>(kThreadNum * kValueNum), total.Num());
+}
+
+void AppendCounter(PercentileCounter* counter, int64_t num) {
+    for (int64_t i = 0; i < num; ++i) {
+        counter->Append(i & 0xffff);
+    }
+}
+
+void AppendHistogram(leveldb::Histogram* hist, int64_t num) {
+    for (int64_t i = 0; i < num; ++i) {
+        hist->Add(i & 0xffff);
+    }
+}
+
+// appends per second of many threads, against leveldb::Histogram which
+// PercentileCounter used to wrap
+TEST(LogLinearHistogramTest, ContentionBench) {
+    const int64_t kAppendNum = 1000000;
+    for (int thread_num = 1; thread_num <= 16; thread_num *= 2) {
+        int64_t num = kAppendNum / thread_num;
+        PercentileCounter counter("ContentionBench", 99, {});
+        leveldb::Histogram hist;
+
+        std::vector<std::thread> threads;
+        int64_t start_us = get_micros();
+        for (int i = 0; i < thread_num; ++i) {
+            threads.push_back(std::thread(&AppendCounter, &counter, num));
+        }
+        for (size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+        int64_t counter_us = get_micros() - start_us + 1;
+
+        threads.clear();
+        start_us = get_micros();
+        for (int i = 0; i < thread_num; ++i) {
+            threads.push_back(std::thread(&AppendHistogram, &hist, num));
+        }
+        for (size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+        int64_t hist_us = get_micros() - start_us + 1;
+
+        std::cout << "threads: " << thread_num
+                  << ", PercentileCounter: " << num * thread_num * 1000000 / counter_us << "/s"
+                  << ", leveldb::Histogram: " << num * thread_num * 1000000 / hist_us << "/s"
+                  << std::endl;
+    }
+}
+
 } // end namespace tera 
  
 /* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
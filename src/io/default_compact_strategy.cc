@@ -2,22 +2,66 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include "io/default_compact_strategy.h"
+
+#include <algorithm>
+
 #include "db/dbformat.h"
 #include "io/atomic_merge_strategy.h"
-#include "io/default_compact_strategy.h"
 #include "leveldb/slice.h"
 
 namespace tera {
 namespace io {
 
-DefaultCompactStrategy::DefaultCompactStrategy(const TableSchema& schema,
-                                               const std::map<std::string, int32_t>& cf_indexs,
+namespace {
+
+bool ColumnFamilyLess(const CompactSchema::ColumnFamily& cf, const Slice& name) {
+    return cf.name.compare(name) < 0;
+}
+
+} // namespace
+
+CompactSchema::CompactSchema(const TableSchema& schema) {
+    std::vector<int32_t> sorted(schema.column_families_size());
+    for (int32_t i = 0; i < schema.column_families_size(); ++i) {
+        sorted[i] = i;
+    }
+    std::sort(sorted.begin(), sorted.end(), [&schema](int32_t a, int32_t b) {
+        return schema.column_families(a).name() < schema.column_families(b).name();
+    });
+
+    // the slices point into names_, fill it before taking any of them
+    std::vector<size_t> offsets;
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        offsets.push_back(names_.size());
+        names_.append(schema.column_families(sorted[i]).name());
+    }
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const ColumnFamilySchema& cf_schema = schema.column_families(sorted[i]);
+        ColumnFamily cf;
+        cf.name = Slice(names_.data() + offsets[i], cf_schema.name().size());
+        cf.ttl_us = cf_schema.time_to_live() * 1000000LL;
+        cf.max_versions = static_cast<uint32_t>(cf_schema.max_versions());
+        cfs_.push_back(cf);
+    }
+}
+
+const CompactSchema::ColumnFamily* CompactSchema::Find(const Slice& name) const {
+    std::vector<ColumnFamily>::const_iterator it =
+        std::lower_bound(cfs_.begin(), cfs_.end(), name, ColumnFamilyLess);
+    if (it == cfs_.end() || it->name != name) {
+        return NULL;
+    }
+    return &*it;
+}
+
+DefaultCompactStrategy::DefaultCompactStrategy(const std::shared_ptr<const CompactSchema>& schema,
                                                const leveldb::RawKeyOperator& raw_key_operator,
                                                leveldb::Comparator* cmp)
     : schema_(schema),
-      cf_indexs_(cf_indexs),
       raw_key_operator_(raw_key_operator),
       cmp_(cmp),
+      now_us_(get_micros()),
       last_ts_(-1), last_type_(leveldb::TKT_FORSEEK), cur_type_(leveldb::TKT_FORSEEK),
       del_row_ts_(-1), del_col_ts_(-1), del_qual_ts_(-1), cur_ts_(-1),
       del_row_seq_(0), del_col_seq_(0), del_qual_seq_(0), version_num_(0),
@@ -52,18 +96,22 @@ bool DefaultCompactStrategy::Drop(const Slice& tera_key, uint64_t n,
 
     cur_type_ = type;
     cur_ts_ = ts;
-    int32_t cf_id = -1;
-    if (type != leveldb::TKT_DEL && DropIllegalColumnFamily(col.ToString(), &cf_id)) {
+    const CompactSchema::ColumnFamily* cf = NULL;
+    if (type != leveldb::TKT_DEL && (cf = schema_->Find(col)) == NULL) {
         // drop illegal column family
         return true;
     }
 
-    if (type >= leveldb::TKT_VALUE && DropByLifeTime(cf_id, ts)) {
+    bool new_row = key.compare(last_key_) != 0;
+    if (new_row) {
+        now_us_ = get_micros();
+    }
+    if (type >= leveldb::TKT_VALUE && DropByLifeTime(cf, ts)) {
         // drop illegal column family
         return true;
     }
 
-    if (key.compare(last_key_) != 0) {
+    if (new_row) {
         // reach a new row
         last_key_.assign(key.data(), key.size());
         last_col_.assign(col.data(), col.size());
@@ -139,7 +187,7 @@ bool DefaultCompactStrategy::Drop(const Slice& tera_key, uint64_t n,
     if (type == leveldb::TKT_VALUE) {
         has_put_ = true;
         if (n <= snapshot_) {
-            if (++version_num_ > static_cast<uint32_t>(schema_.column_families(cf_id).max_versions())) {
+            if (++version_num_ > cf->max_versions) {
                 // drop out-of-range version
                 VLOG(20) << "compact drop true: " << key.ToString()
                     << ", version " << version_num_
@@ -151,8 +199,7 @@ bool DefaultCompactStrategy::Drop(const Slice& tera_key, uint64_t n,
     
     if (type == leveldb::TKT_DEL_QUALIFIER) {
         if (n <= snapshot_) {
-            uint32_t max_versions = static_cast<uint32_t>(schema_.column_families(cf_id).max_versions());
-            if (version_num_ >= max_versions) {
+            if (version_num_ >= cf->max_versions) {
                 // drop out-of-range delete qualifier mark
                 VLOG(20) << "compact drop true: " << key.ToString()
                          << ", version " << version_num_ 
@@ -277,18 +324,22 @@ bool DefaultCompactStrategy::ScanDrop(const Slice& tera_key, uint64_t n) {
     cur_type_ = type;
     last_ts_ = cur_ts_;
     cur_ts_ = ts;
-    int32_t cf_id = -1;
-    if (type != leveldb::TKT_DEL && DropIllegalColumnFamily(col.ToString(), &cf_id)) {
+    const CompactSchema::ColumnFamily* cf = NULL;
+    if (type != leveldb::TKT_DEL && (cf = schema_->Find(col)) == NULL) {
         // drop illegal column family
         return true;
     }
 
-    if (type >= leveldb::TKT_VALUE && DropByLifeTime(cf_id, ts)) {
+    bool new_row = key.compare(last_key_) != 0;
+    if (new_row) {
+        now_us_ = get_micros();
+    }
+    if (type >= leveldb::TKT_VALUE && DropByLifeTime(cf, ts)) {
         // drop out-of-life-time record
         return true;
     }
 
-    if (key.compare(last_key_) != 0) {
+    if (new_row) {
         // reach a new row
         last_key_.assign(key.data(), key.size());
         last_col_.assign(col.data(), col.size());
@@ -370,15 +421,14 @@ bool DefaultCompactStrategy::ScanDrop(const Slice& tera_key, uint64_t n) {
         return true;
     }
 
-    CHECK(cf_id >= 0) << "illegel column family";
+    CHECK(cf != NULL) << "illegel column family";
     if (type == leveldb::TKT_VALUE) {
         if (cur_ts_ == last_ts_ && key_col_qual_same) {
             // this is the same key, do not chang version num
         } else {
             version_num_++;
         }
-        if (version_num_ >
-            static_cast<uint32_t>(schema_.column_families(cf_id).max_versions())) {
+        if (version_num_ > cf->max_versions) {
             // drop out-of-range version
             VLOG(20) << "scan drop true: " << key.ToString()
                 << ", version " << version_num_
@@ -392,27 +442,14 @@ bool DefaultCompactStrategy::ScanDrop(const Slice& tera_key, uint64_t n) {
     return false;
 }
 
-bool DefaultCompactStrategy::DropIllegalColumnFamily(const std::string& column_family,
-                                                int32_t* cf_idx) const {
-    std::map<std::string, int32_t>::const_iterator it =
-        cf_indexs_.find(column_family);
-    if (it == cf_indexs_.end()) {
-        return true;
-    }
-    if (cf_idx) {
-        *cf_idx = it->second;
-    }
-    return false;
-}
-
-bool DefaultCompactStrategy::DropByLifeTime(int32_t cf_idx, int64_t timestamp) const {
-    int64_t ttl = schema_.column_families(cf_idx).time_to_live() * 1000000LL;
+bool DefaultCompactStrategy::DropByLifeTime(const CompactSchema::ColumnFamily* cf,
+                                            int64_t timestamp) const {
+    int64_t ttl = cf->ttl_us;
     if (ttl <= 0) {
         // do not drop
         return false;
     }
-    int64_t cur_time = get_micros();
-    if (timestamp + ttl > cur_time) {
+    if (timestamp + ttl > now_us_) {
         return false;
     } else {
         return true;
@@ -437,19 +474,31 @@ bool DefaultCompactStrategy::CheckTag(const Slice& tera_key, bool* del_tag, int6
         type == leveldb::TKT_DEL_QUALIFIER) {
         *del_tag = true;
     }
-    int32_t cf = -1;
-    int64_t ttl = -1;
-    if (!DropIllegalColumnFamily(col.ToString(), &cf) &&
-        schema_.column_families(cf).time_to_live() > 0) {
-        ttl = schema_.column_families(cf).time_to_live();
-        *ttl_tag = ts + ttl * 1000000LL;
+    const CompactSchema::ColumnFamily* cf = schema_->Find(col);
+    if (cf != NULL && cf->ttl_us > 0) {
+        *ttl_tag = ts + cf->ttl_us;
     }
     VLOG(11) << "default strategy, del " << *del_tag << ", key_ts " << ts
-             << ", ttl " << ttl
+             << ", ttl_us " << (cf != NULL ? cf->ttl_us : -1)
              << ", ttl_tag " << *ttl_tag;
     return true;
 }
 
+bool DefaultCompactStrategy::ExtractCell(const Slice& tera_key, Slice* family,
+                                         int64_t* ts, leveldb::TeraKeyType* type) {
+    return raw_key_operator_.ExtractTeraKey(tera_key, NULL, family, NULL, ts, type);
+}
+
+int64_t DefaultCompactStrategy::FamilyExpireTime(const Slice& family, int64_t max_ts,
+                                                 int64_t expire_ts) {
+    const CompactSchema::ColumnFamily* cf = schema_->Find(family);
+    if (cf == NULL) {
+        // dropped column family, its cells are dropped by compactions anyway
+        return expire_ts;
+    }
+    return cf->ttl_us > 0 ? max_ts + cf->ttl_us : 0;
+}
+
 bool DefaultCompactStrategy::CheckCompactLowerBound(const Slice& cur_key,
                                                     const std::string& lower_bound) {
     if (lower_bound.empty()) {
@@ -468,13 +517,9 @@ bool DefaultCompactStrategy::CheckCompactLowerBound(const Slice& cur_key,
 
 DefaultCompactStrategyFactory::DefaultCompactStrategyFactory(const TableSchema& schema)
     : schema_(schema),
+      compact_schema_(new CompactSchema(schema_)),
       raw_key_operator_(GetRawKeyOperatorFromSchema(schema_)),
       cmp_(NewRowKeyComparator(raw_key_operator_)) {
-    // build index at tablet io loading
-    for (int32_t i = 0; i < schema_.column_families_size(); ++i) {
-        const std::string& name = schema_.column_families(i).name();
-        cf_indexs_[name] = i;
-    }
 }
 
 DefaultCompactStrategyFactory::~DefaultCompactStrategyFactory() {
@@ -484,11 +529,13 @@ DefaultCompactStrategyFactory::~DefaultCompactStrategyFactory() {
 void DefaultCompactStrategyFactory::SetArg(const void* arg) {
     MutexLock lock(&mutex_);
     schema_.CopyFrom(*(TableSchema*)arg);
+    // running compactions keep the schema they started with
+    compact_schema_.reset(new CompactSchema(schema_));
 }
 
 DefaultCompactStrategy* DefaultCompactStrategyFactory::NewInstance() {
     MutexLock lock(&mutex_);
-    return new DefaultCompactStrategy(schema_, cf_indexs_, *raw_key_operator_, cmp_);
+    return new DefaultCompactStrategy(compact_schema_, *raw_key_operator_, cmp_);
 }
 
 } // namespace io
@@ -5,6 +5,10 @@
 #ifndef TERA_IO_DEFAULT_COMPACT_STRATEGY_H_
 #define TERA_IO_DEFAULT_COMPACT_STRATEGY_H_
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "leveldb/compact_strategy.h"
 #include "leveldb/comparator.h"
 #include "leveldb/slice.h"
@@ -18,10 +22,34 @@ namespace io {
 
 using leveldb::Slice;
 
+// The column families of a schema flattened for the compact strategy,
+// which looks up the column family of every key it checks: the names are
+// kept in one buffer, sorted and binary searched by slice, so that a lookup
+// neither allocates nor touches the protobuf.
+// Immutable once built, shared by the strategies of all compactions.
+class CompactSchema {
+public:
+    struct ColumnFamily {
+        Slice name;
+        int64_t ttl_us;         // <= 0 means never expire
+        uint32_t max_versions;
+    };
+
+    explicit CompactSchema(const TableSchema& schema);
+
+    // Return NULL if "name" is not a column family of the schema.
+    const ColumnFamily* Find(const Slice& name) const;
+
+    size_t Size() const { return cfs_.size(); }
+
+private:
+    std::string names_;
+    std::vector<ColumnFamily> cfs_;
+};
+
 class DefaultCompactStrategy : public leveldb::CompactStrategy {
 public:
-    DefaultCompactStrategy(const TableSchema& schema,
-                           const std::map<std::string, int32_t>& cf_indexs,
+    DefaultCompactStrategy(const std::shared_ptr<const CompactSchema>& schema,
                            const leveldb::RawKeyOperator& raw_key_operator,
                            leveldb::Comparator* cmp);
 
@@ -40,6 +68,9 @@ public:
 
     virtual void SetSnapshot(uint64_t snapshot);
     virtual bool CheckTag(const leveldb::Slice& tera_key, bool* del_tag, int64_t* ttl_tag);
+    virtual bool ExtractCell(const Slice& tera_key, Slice* family,
+                             int64_t* ts, leveldb::TeraKeyType* type);
+    virtual int64_t FamilyExpireTime(const Slice& family, int64_t max_ts, int64_t expire_ts);
 
     virtual bool ScanMergedValue(leveldb::Iterator* it,
                                  std::string* merged_value,
@@ -49,9 +80,7 @@ public:
                                 std::string* merged_key);
 
 private:
-    bool DropIllegalColumnFamily(const std::string& column_family,
-                            int32_t* cf_idx = NULL) const;
-    bool DropByLifeTime(int32_t cf_idx, int64_t timestamp) const;
+    bool DropByLifeTime(const CompactSchema::ColumnFamily* cf, int64_t timestamp) const;
 
     bool InternalMergeProcess(leveldb::Iterator* it, std::string* merged_value,
                               std::string* merged_key,
@@ -62,10 +91,12 @@ private:
                                 const std::string& lower_bound);
 
 private:
-    const TableSchema& schema_;
-    const std::map<std::string, int32_t>& cf_indexs_;
+    std::shared_ptr<const CompactSchema> schema_;
     const leveldb::RawKeyOperator& raw_key_operator_;
     leveldb::Comparator* cmp_;
+    // the values are expired by the time the current row is reached, a
+    // strategy may live through a long compaction or batch scan
+    int64_t now_us_;
 
     std::string last_key_;
     std::string last_col_;
@@ -97,7 +128,7 @@ public:
 
 private:
     TableSchema schema_;
-    std::map<std::string, int32_t> cf_indexs_;
+    std::shared_ptr<const CompactSchema> compact_schema_;
     const leveldb::RawKeyOperator* raw_key_operator_;
     leveldb::Comparator* cmp_;
     mutable Mutex mutex_;
@@ -19,11 +19,14 @@ DEFINE_bool(tera_enable_level0_limit, true, "enable level0 limit");
 DEFINE_int32(tera_tabletnode_scanner_cache_size, 5, "default tablet scanner manager cache no more than 100 stream");
 DEFINE_uint64(tera_tabletnode_prefetch_scan_size, 1 << 20, "Max size for prefetch scan");
 DEFINE_int32(tera_asyncwriter_batch_size, 1024, "write batch to leveldb per X KB");
+DEFINE_int32(tera_tabletnode_trace_sample_interval, 0, "trace the stages of one of every X read/write requests, 0 means no trace");
+DEFINE_int64(tera_tabletnode_trace_slow_request_us, 100000, "log the stages of the traced requests slower than X us, 0 means never");
 
 DEFINE_int32(tera_tablet_max_block_log_number, 50, "max number of unsed log files produced by switching log");
 DEFINE_int64(tera_tablet_write_log_time_out, 5, "max time(sec) to wait for log writing or sync");
 DEFINE_bool(tera_log_async_mode, true, "enable async mode for log writing and sync");
 DEFINE_int64(tera_tablet_log_file_size, 32, "the log file size (in MB) for tablet");
+DEFINE_int32(tera_tablet_log_stream_num, 1, "the number of write-ahead log streams for tablet, logs are written in parallel on them");
 DEFINE_int64(tera_tablet_max_write_buffer_size, 32, "the buffer size (in MB) for tablet write buffer");
 DEFINE_int64(tera_tablet_living_period, -1, "the living period of tablet");
 DEFINE_int32(tera_tablet_flush_log_num, 100000, "the max log number before flush memtable");
@@ -56,6 +59,15 @@ DEFINE_bool(tera_leveldb_use_direct_io_read, true, "enable random read from loca
 DEFINE_bool(tera_leveldb_use_direct_io_write, true, "enable write to local SATA or SSD device use Direct I/O");
 DEFINE_uint64(tera_leveldb_posix_write_buffer_size, 512<<10, "write buffer size for PosixWritableFile");
 DEFINE_uint64(tera_leveldb_table_builder_write_batch_size, 256<<10, "table builder's batch write size, 0 means disable table builder batch write");
+DEFINE_bool(tera_leveldb_use_tera_block_encoding, false, "store the row key once per row run and the column family as an id in sst data blocks of non-kv tables");
+DEFINE_bool(tera_leveldb_data_block_hash_index, false, "append a hash index of keys to sst data blocks of kv tables for point lookups");
+DEFINE_int32(tera_leveldb_tiered_compaction_size_ratio, 200, "(percent) lgs of tiered compaction style merge a sorted run into the next older one not larger than this ratio of it");
+DEFINE_bool(tera_leveldb_use_mmap_read, false, "read sst files of flash and memory lgs through mmap, serving uncompressed blocks without copying them into the block cache");
+DEFINE_int32(tera_leveldb_dump_compress_threads, 0, "threads of a shared pool compressing the data blocks of each memtable dump in parallel, 0 means compress on the dumping thread");
+
+DEFINE_int32(tera_tablet_load_sample_size, 256, "the number of accessed row keys sampled per period to find the load split key, 0 means disable");
+DEFINE_int64(tera_tablet_load_sample_period, 60, "the period (in sec) of the accessed row key samples, the last two periods are used");
+DEFINE_int32(tera_tablet_load_split_min_samples, 64, "the min number of samples to split a tablet by load, otherwise split by size");
 
 DEFINE_int32(tera_tablet_unload_count_limit, 3, "the upper bound of try unload, broken this limit will speed up unloading");
 
@@ -0,0 +1,133 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "io/key_sampler.h"
+
+#include <algorithm>
+
+#include "common/timer.h"
+
+namespace tera {
+namespace io {
+
+namespace {
+
+// cheap pseudo random slot for the n-th access, no shared state needed
+uint64_t MixTicket(uint64_t n) {
+    n += 0x9e3779b97f4a7c15ULL;
+    n = (n ^ (n >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    n = (n ^ (n >> 27)) * 0x94d049bb133111ebULL;
+    return n ^ (n >> 31);
+}
+
+} // namespace
+
+KeySampler::KeySampler(uint32_t max_samples, int64_t period_us)
+    : max_samples_(max_samples),
+      period_us_(period_us),
+      seen_(0),
+      window_start_(get_micros()) {
+}
+
+KeySampler::~KeySampler() {}
+
+void KeySampler::Sample(const std::string& key, uint32_t weight) {
+    if (max_samples_ == 0 || weight == 0) {
+        return;
+    }
+    uint64_t ticket = seen_.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint64_t slot = ticket - 1;
+    if (ticket > max_samples_) {
+        // reservoir sampling, keep the n-th access with probability max/n
+        slot = MixTicket(ticket) % ticket;
+        if (slot >= max_samples_) {
+            return;
+        }
+    }
+
+    MutexLock lock(&mutex_);
+    MaybeRotate(get_micros());
+    current_.seen = std::max(current_.seen, seen_.load(std::memory_order_relaxed));
+    if (current_.samples.size() < max_samples_) {
+        current_.samples.push_back(std::make_pair(key, weight));
+    } else {
+        current_.samples[slot % max_samples_] = std::make_pair(key, weight);
+    }
+}
+
+bool KeySampler::GetMedianKey(uint32_t min_samples, std::string* key) {
+    // (key, load) of all samples, a sample stands for seen/size accesses
+    // of its window
+    std::vector<std::pair<std::string, double> > load;
+    {
+        MutexLock lock(&mutex_);
+        MaybeRotate(get_micros());
+        current_.seen = std::max(current_.seen, seen_.load(std::memory_order_relaxed));
+        const Window* windows[2] = {&previous_, &current_};
+        for (int w = 0; w < 2; ++w) {
+            const SampleList& samples = windows[w]->samples;
+            if (samples.empty()) {
+                continue;
+            }
+            double scale = static_cast<double>(windows[w]->seen) / samples.size();
+            for (size_t i = 0; i < samples.size(); ++i) {
+                load.push_back(std::make_pair(samples[i].first, samples[i].second * scale));
+            }
+        }
+    }
+    if (load.empty() || load.size() < min_samples) {
+        return false;
+    }
+
+    std::sort(load.begin(), load.end());
+    double total = 0;
+    for (size_t i = 0; i < load.size(); ++i) {
+        total += load[i].second;
+    }
+    double sum = 0;
+    for (size_t i = 0; i < load.size(); ++i) {
+        sum += load[i].second;
+        if (sum * 2 >= total) {
+            *key = load[i].first;
+            return true;
+        }
+    }
+    *key = load.back().first;
+    return true;
+}
+
+uint32_t KeySampler::SampleCount() {
+    MutexLock lock(&mutex_);
+    MaybeRotate(get_micros());
+    return previous_.samples.size() + current_.samples.size();
+}
+
+void KeySampler::Reset() {
+    MutexLock lock(&mutex_);
+    previous_ = Window();
+    current_ = Window();
+    seen_.store(0, std::memory_order_relaxed);
+    window_start_ = get_micros();
+}
+
+void KeySampler::MaybeRotate(int64_t now) {
+    mutex_.AssertHeld();
+    if (now - window_start_ < period_us_) {
+        return;
+    }
+    if (now - window_start_ < 2 * period_us_) {
+        current_.seen = std::max(current_.seen, seen_.load(std::memory_order_relaxed));
+        previous_.samples.swap(current_.samples);
+        previous_.seen = current_.seen;
+    } else {
+        // idle for a whole window, the old samples are stale
+        previous_ = Window();
+    }
+    current_ = Window();
+    seen_.store(0, std::memory_order_relaxed);
+    window_start_ = now;
+}
+
+} // namespace io
+} // namespace tera
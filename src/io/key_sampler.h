@@ -0,0 +1,67 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TERA_IO_KEY_SAMPLER_H_
+#define TERA_IO_KEY_SAMPLER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/mutex.h"
+
+namespace tera {
+namespace io {
+
+// KeySampler keeps a reservoir of the row keys read, written or scanned
+// on a tablet, to find the key splitting the recent load of the tablet
+// in half.  Samples are kept per time window, the last two windows are
+// used.  Most accesses are dropped before taking the lock once the
+// reservoir of the window is full.
+class KeySampler {
+public:
+    KeySampler(uint32_t max_samples, int64_t period_us);
+    ~KeySampler();
+
+    // Record "weight" accesses (e.g. rows scanned) at "key".
+    void Sample(const std::string& key, uint32_t weight = 1);
+
+    // Find the key with half of the sampled load before it.
+    // Return false if less than "min_samples" keys are sampled.
+    bool GetMedianKey(uint32_t min_samples, std::string* key);
+
+    uint32_t SampleCount();
+    void Reset();
+
+private:
+    typedef std::vector<std::pair<std::string, uint32_t> > SampleList;
+    struct Window {
+        SampleList samples;
+        uint64_t seen;
+        Window() : seen(0) {}
+    };
+
+    void MaybeRotate(int64_t now);
+
+    const uint32_t max_samples_;
+    const int64_t period_us_;
+    // accesses in the current window
+    std::atomic<uint64_t> seen_;
+
+    Mutex mutex_;
+    int64_t window_start_;
+    Window current_;
+    Window previous_;
+
+    KeySampler(const KeySampler&);
+    void operator=(const KeySampler&);
+};
+
+} // namespace io
+} // namespace tera
+
+#endif // TERA_IO_KEY_SAMPLER_H_
@@ -0,0 +1,147 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "io/request_trace.h"
+
+#include <sstream>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "common/metric/metric_id.h"
+#include "common/metric/percentile_counter.h"
+#include "tabletnode/tabletnode_metric_name.h"
+
+DECLARE_int32(tera_tabletnode_trace_sample_interval);
+DECLARE_int64(tera_tabletnode_trace_slow_request_us);
+
+namespace tera {
+namespace io {
+
+using tera::tabletnode::kRequestStageDelayPercentileMetric;
+
+namespace {
+
+const RequestTrace::Type kStageType[RequestTrace::kStageNum] = {
+    RequestTrace::kRead,    // kReadSchedule
+    RequestTrace::kRead,    // kReadIterator
+    RequestTrace::kRead,    // kReadBlock
+    RequestTrace::kWrite,   // kWriteQueue
+    RequestTrace::kWrite,   // kWriteBatch
+    RequestTrace::kWrite,   // kWriteLeaderWait
+    RequestTrace::kWrite,   // kWriteLog
+    RequestTrace::kWrite,   // kWriteMemTable
+};
+
+const char* const kStageName[RequestTrace::kStageNum] = {
+    "schedule",
+    "iterator",
+    "block",
+    "queue",
+    "batch",
+    "leader_wait",
+    "log",
+    "memtable",
+};
+
+const char* const kTypeName[RequestTrace::kTypeNum] = {
+    "read",
+    "write",
+};
+
+// labeled as "api:write,stage:log,percentile:99", ...
+class StageDelayPercentiles {
+public:
+    StageDelayPercentiles() {
+        for (int i = 0; i < RequestTrace::kStageNum; ++i) {
+            std::string label = LabelStringBuilder()
+                .Append("api", kTypeName[kStageType[i]])
+                .Append("stage", kStageName[i])
+                .ToString();
+            percentiles_[i] = new PercentileCounter(kRequestStageDelayPercentileMetric, label,
+                                                    std::vector<double>{50, 99, 99.9});
+        }
+    }
+
+    ~StageDelayPercentiles() {
+        for (int i = 0; i < RequestTrace::kStageNum; ++i) {
+            delete percentiles_[i];
+        }
+    }
+
+    void Append(RequestTrace::Stage stage, int64_t cost_us) {
+        percentiles_[stage]->Append(cost_us);
+    }
+
+private:
+    PercentileCounter* percentiles_[RequestTrace::kStageNum];
+};
+
+StageDelayPercentiles stage_delay_percentiles;
+
+} // namespace
+
+RequestTrace::RequestTrace(Type type, int64_t start_micros)
+    : type_(type), start_micros_(start_micros) {
+    for (int i = 0; i < kStageNum; ++i) {
+        stage_us_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+RequestTrace* RequestTrace::Sample(Type type, int64_t start_micros) {
+    int32_t interval = FLAGS_tera_tabletnode_trace_sample_interval;
+    if (interval <= 0) {
+        return NULL;
+    }
+    // one of every "interval" requests of a thread is sampled
+    static thread_local int32_t request_count = 0;
+    if (++request_count < interval) {
+        return NULL;
+    }
+    request_count = 0;
+    return new RequestTrace(type, start_micros);
+}
+
+void RequestTrace::Finish(int64_t done_micros) {
+    if (type_ == kRead) {
+        Add(kReadBlock, read_trace_.block_read_us);
+    }
+    for (int i = 0; i < kStageNum; ++i) {
+        if (kStageType[i] == type_) {
+            stage_delay_percentiles.Append(static_cast<Stage>(i), StageCost(static_cast<Stage>(i)));
+        }
+    }
+    int64_t slow_us = FLAGS_tera_tabletnode_trace_slow_request_us;
+    if (slow_us > 0 && done_micros - start_micros_ >= slow_us) {
+        LOG(WARNING) << "[trace] slow " << TypeName(type_) << " request, "
+            << DebugString(done_micros);
+    }
+}
+
+std::string RequestTrace::DebugString(int64_t done_micros) const {
+    std::ostringstream oss;
+    oss << "total_us: " << done_micros - start_micros_;
+    for (int i = 0; i < kStageNum; ++i) {
+        if (kStageType[i] == type_) {
+            oss << ", " << kStageName[i] << ": " << StageCost(static_cast<Stage>(i));
+        }
+    }
+    if (type_ == kRead) {
+        oss << ", block_cache_hit: " << read_trace_.block_cache_hit
+            << ", block_cache_miss: " << read_trace_.block_cache_miss;
+    }
+    return oss.str();
+}
+
+const char* RequestTrace::TypeName(Type type) {
+    return kTypeName[type];
+}
+
+const char* RequestTrace::StageName(Stage stage) {
+    return kStageName[stage];
+}
+
+} // namespace io
+} // namespace tera
@@ -0,0 +1,101 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TERA_IO_REQUEST_TRACE_H_
+#define TERA_IO_REQUEST_TRACE_H_
+
+#include <atomic>
+#include <string>
+
+#include "common/base/stdint.h"
+#include "leveldb/options.h"
+
+namespace tera {
+namespace io {
+
+// RequestTrace breaks the latency of a sampled read or write rpc down into
+// the stages of its path on the tabletnode.  A trace is created by
+// Sample() when the rpc arrives, carried along with the request, and
+// finished by the done closure of the rpc: the stage costs are appended to
+// per-stage histograms, and the breakdown of a slow request is logged.
+//
+// Most requests are not sampled and carry a NULL trace, which costs the
+// path no more than a pointer test.
+//
+// The tablets of a write rpc are written in parallel, each stage of it
+// keeps the cost of the slowest tablet.
+class RequestTrace {
+public:
+    enum Type {
+        kRead = 0,
+        kWrite = 1,
+        kTypeNum
+    };
+
+    enum Stage {
+        kReadSchedule = 0,  // waiting in RpcSchedule for a read thread
+        kReadIterator,      // creating the iterators of the rows
+        kReadBlock,         // reading the block cache missed blocks from dfs
+        kWriteQueue,        // waiting in the queue of the write thread pool
+        kWriteBatch,        // batching in TabletWriter, checking and encoding
+        kWriteLeaderWait,   // waiting for the write group in DBTable::Write
+        kWriteLog,          // log AddRecord and Sync
+        kWriteMemTable,     // applying to memtables
+        kStageNum
+    };
+
+    // Return a new trace for a request of "type" which arrives at
+    // "start_micros" if the request is sampled, otherwise NULL.
+    static RequestTrace* Sample(Type type, int64_t start_micros);
+
+    // Add "cost_us" to "stage".
+    void Add(Stage stage, int64_t cost_us) {
+        stage_us_[stage].fetch_add(cost_us, std::memory_order_relaxed);
+    }
+
+    // Keep the max of "cost_us" and the cost of "stage".
+    void Max(Stage stage, int64_t cost_us) {
+        int64_t old_us = stage_us_[stage].load(std::memory_order_relaxed);
+        while (cost_us > old_us &&
+               !stage_us_[stage].compare_exchange_weak(old_us, cost_us,
+                                                       std::memory_order_relaxed)) {
+        }
+    }
+
+    int64_t StageCost(Stage stage) const {
+        return stage_us_[stage].load(std::memory_order_relaxed);
+    }
+
+    int64_t StartMicros() const { return start_micros_; }
+
+    // Passed to leveldb by the reads of the request, NOT thread safe, only
+    // for the requests read by one thread.
+    leveldb::ReadTrace* MutableReadTrace() { return &read_trace_; }
+
+    // Account the trace of a request done at "done_micros".
+    void Finish(int64_t done_micros);
+
+    // "stage:cost_us ..." of the request done at "done_micros".
+    std::string DebugString(int64_t done_micros) const;
+
+    static const char* TypeName(Type type);
+    static const char* StageName(Stage stage);
+
+    // Never copied
+    RequestTrace(const RequestTrace&) = delete;
+    RequestTrace& operator=(const RequestTrace&) = delete;
+
+private:
+    RequestTrace(Type type, int64_t start_micros);
+
+    Type type_;
+    int64_t start_micros_;
+    std::atomic<int64_t> stage_us_[kStageNum];
+    leveldb::ReadTrace read_trace_;
+};
+
+} // namespace io
+} // namespace tera
+
+#endif // TERA_IO_REQUEST_TRACE_H_
@@ -7,6 +7,7 @@
 #include <stdint.h>
 
 #include "common/counter.h"
+#include "common/metric/percentile_counter.h"
 #include "common/metric/prometheus_subscriber.h"
 #include "common/metric/ratio_subscriber.h"
 #include "common/this_thread.h"
@@ -25,6 +26,7 @@
 #include "io/coding.h"
 #include "io/default_compact_strategy.h"
 #include "io/io_utils.h"
+#include "io/request_trace.h"
 #include "io/tablet_writer.h"
 #include "io/timekey_comparator.h"
 #include "io/ttlkv_compact_strategy.h"
@@ -37,6 +39,7 @@
 
 DECLARE_string(tera_leveldb_env_type);
 DECLARE_int64(tera_tablet_log_file_size);
+DECLARE_int32(tera_tablet_log_stream_num);
 DECLARE_int64(tera_tablet_max_write_buffer_size);
 DECLARE_int64(tera_tablet_write_block_size);
 DECLARE_int32(tera_tablet_level0_file_limit);
@@ -83,11 +86,20 @@ DECLARE_bool(tera_leveldb_use_direct_io_read);
 DECLARE_bool(tera_leveldb_use_direct_io_write);
 DECLARE_uint64(tera_leveldb_posix_write_buffer_size);
 DECLARE_uint64(tera_leveldb_table_builder_write_batch_size);
+DECLARE_bool(tera_leveldb_use_tera_block_encoding);
+DECLARE_bool(tera_leveldb_data_block_hash_index);
+DECLARE_bool(tera_leveldb_use_mmap_read);
+DECLARE_int32(tera_leveldb_dump_compress_threads);
+DECLARE_int32(tera_leveldb_tiered_compaction_size_ratio);
+DECLARE_int32(tera_tablet_load_sample_size);
+DECLARE_int64(tera_tablet_load_sample_period);
+DECLARE_int32(tera_tablet_load_split_min_samples);
 
 namespace tera {
 namespace io {
 
 using tera::tabletnode::kRowDelayMetric;
+using tera::tabletnode::kRowDelayPercentileMetric;
 using tera::tabletnode::kRowCountMetric;
 using tera::tabletnode::kRowThroughPutMetric;
 
@@ -100,20 +112,25 @@ using tera::tabletnode::kScanDropCountMetric;
 using tera::tabletnode::kBatchScanCountMetric;
 using tera::tabletnode::kSyncScanCountMetric;
 
-tera::MetricCounter low_level_read_count(kLowLevelReadMetric, {SubscriberType::QPS});
-tera::MetricCounter scan_drop_count(kScanDropCountMetric, {SubscriberType::QPS});
-tera::MetricCounter batch_scan_count(kBatchScanCountMetric, {SubscriberType::QPS});
-tera::MetricCounter sync_scan_count(kSyncScanCountMetric, {SubscriberType::QPS});
+tera::StripedMetricCounter low_level_read_count(kLowLevelReadMetric, {SubscriberType::QPS});
+tera::StripedMetricCounter scan_drop_count(kScanDropCountMetric, {SubscriberType::QPS});
+tera::StripedMetricCounter batch_scan_count(kBatchScanCountMetric, {SubscriberType::QPS});
+tera::StripedMetricCounter sync_scan_count(kSyncScanCountMetric, {SubscriberType::QPS});
 
-tera::MetricCounter row_read_delay(kRowDelayMetric, kApiLabelRead, {});
-tera::MetricCounter row_read_count(kRowCountMetric, kApiLabelRead, {SubscriberType::QPS});
-tera::MetricCounter row_read_bytes(kRowThroughPutMetric, kApiLabelRead, {SubscriberType::THROUGHPUT});
+tera::StripedMetricCounter row_read_delay(kRowDelayMetric, kApiLabelRead, {});
+tera::StripedMetricCounter row_read_count(kRowCountMetric, kApiLabelRead, {SubscriberType::QPS});
+tera::StripedMetricCounter row_read_bytes(kRowThroughPutMetric, kApiLabelRead, {SubscriberType::THROUGHPUT});
 
-tera::MetricCounter row_scan_delay(kRowDelayMetric, kApiLabelScan, {});
-tera::MetricCounter row_scan_count(kRowCountMetric, kApiLabelScan, {SubscriberType::QPS});
-tera::MetricCounter row_scan_bytes(kRowThroughPutMetric, kApiLabelScan, {SubscriberType::THROUGHPUT});
+tera::StripedMetricCounter row_scan_delay(kRowDelayMetric, kApiLabelScan, {});
+tera::StripedMetricCounter row_scan_count(kRowCountMetric, kApiLabelScan, {SubscriberType::QPS});
+tera::StripedMetricCounter row_scan_bytes(kRowThroughPutMetric, kApiLabelScan, {SubscriberType::THROUGHPUT});
 
-tera::MetricCounter row_write_bytes(kRowThroughPutMetric, kApiLabelWrite, {SubscriberType::THROUGHPUT});
+tera::PercentileCounter row_read_delay_percentile(kRowDelayPercentileMetric, kApiLabelRead,
+                                                  std::vector<double>{95, 99, 99.9});
+tera::PercentileCounter row_scan_delay_percentile(kRowDelayPercentileMetric, kApiLabelScan,
+                                                  std::vector<double>{95, 99, 99.9});
+
+tera::StripedMetricCounter row_write_bytes(kRowThroughPutMetric, kApiLabelWrite, {SubscriberType::THROUGHPUT});
 
 tera::AutoSubscriberRegister row_read_delay_per_row(std::unique_ptr<Subscriber>(new tera::RatioSubscriber(
     MetricId("tera_ts_row_read_delay_us_per_row"),
@@ -157,10 +174,14 @@ TabletIO::TabletIO(const std::string& key_start, const std::string& key_end,
       last_err_msg_(""),
       ref_count_(1), db_ref_count_(0), db_(NULL),
       m_memory_cache(NULL),
+      shared_log_(NULL),
+      rate_limiter_(NULL),
       kv_only_(false),
       key_operator_(NULL),
       try_unload_count_(0),
       counter_(short_path_),
+      key_sampler_(FLAGS_tera_tablet_load_sample_size,
+                   FLAGS_tera_tablet_load_sample_period * 1000000),
       mock_env_(NULL) {
 }
 
@@ -231,10 +252,22 @@ TabletIO::StatCounter& TabletIO::GetCounter() {
     return counter_;
 }
 
+KeySampler& TabletIO::GetKeySampler() {
+    return key_sampler_;
+}
+
 void TabletIO::SetMemoryCache(leveldb::Cache* cache) {
     m_memory_cache = cache;
 }
 
+void TabletIO::SetSharedLog(leveldb::SharedLog* shared_log) {
+    shared_log_ = shared_log;
+}
+
+void TabletIO::SetRateLimiter(leveldb::RateLimiter* rate_limiter) {
+    rate_limiter_ = rate_limiter;
+}
+
 bool TabletIO::Load(const TableSchema& schema,
                     const std::string& path,
                     const std::vector<uint64_t>& parent_tablets,
@@ -255,6 +288,51 @@ bool TabletIO::Load(const TableSchema& schema,
         db_ref_count_++;
     }
 
+    SetupOptions(schema, path, parent_tablets, ignore_err_lgs,
+                 logger, block_cache, table_cache);
+    LOG(INFO) << "[Load] Start Open " << tablet_path_
+        << ", kv_only " << kv_only_ << ", raw_key_operator " << key_operator_->Name();
+
+    leveldb::Status db_status = leveldb::DB::Open(ldb_options_, tablet_path_, &db_);
+
+    if (!db_status.ok()) {
+        LOG(ERROR) << "fail to open table: " << tablet_path_
+            << ", " << db_status.ToString();
+        {
+            MutexLock lock(&mutex_);
+            status_ = kNotInit;
+            last_err_msg_ = db_status.ToString();
+            db_ref_count_--;
+        }
+        SetStatusCode(db_status, status);
+//         delete ldb_options_.env;
+        return false;
+    }
+
+    async_writer_ = new TabletWriter(this);
+    async_writer_->Start();
+
+    scan_context_manager_ = new ScanContextManager;
+
+    {
+        MutexLock lock(&mutex_);
+        status_ = kReady;
+        //reset try unload count to 0 for ready
+        try_unload_count_ = 0;
+        db_ref_count_--;
+    }
+
+    LOG(INFO) << "[Load] Load " << tablet_path_ << " done";
+    return true;
+}
+
+void TabletIO::SetupOptions(const TableSchema& schema,
+                            const std::string& path,
+                            const std::vector<uint64_t>& parent_tablets,
+                            const std::set<std::string>& ignore_err_lgs,
+                            leveldb::Logger* logger,
+                            leveldb::Cache* block_cache,
+                            leveldb::TableCache* table_cache) {
     // any type of table should have at least 1lg+1cf.
     table_schema_.CopyFrom(schema);
     if (table_schema_.locality_groups_size() == 0) {
@@ -319,22 +397,32 @@ bool TabletIO::Load(const TableSchema& schema,
             << ", block_size:"  << ldb_options_.memtable_ldb_block_size;
     }
 
+    // filter policies are stateless and never deleted, tables in the shared
+    // table cache may outlive the tablet which opened them
+    static const leveldb::FilterPolicy* ttl_kv_filter =
+        leveldb::NewTTLKvBloomFilterPolicy(10);
+    static const leveldb::FilterPolicy* kv_filter = leveldb::NewBloomFilterPolicy(10);
+    static const leveldb::FilterPolicy* readable_filter =
+        leveldb::NewRowKeyBloomFilterPolicy(10, leveldb::ReadableRawKeyOperator());
+    static const leveldb::FilterPolicy* binary_filter =
+        leveldb::NewRowKeyBloomFilterPolicy(10, leveldb::BinaryRawKeyOperator());
     if (kv_only_ && table_schema_.raw_key() == TTLKv) {
-        ldb_options_.filter_policy = leveldb::NewTTLKvBloomFilterPolicy(10);
+        ldb_options_.filter_policy = ttl_kv_filter;
     } else if (kv_only_) {
-        ldb_options_.filter_policy = leveldb::NewBloomFilterPolicy(10);
+        ldb_options_.filter_policy = kv_filter;
     } else if (table_schema_.raw_key() == Readable) {
-        ldb_options_.filter_policy =
-            leveldb::NewRowKeyBloomFilterPolicy(10, leveldb::ReadableRawKeyOperator());
+        ldb_options_.filter_policy = readable_filter;
     } else {
         CHECK_EQ(table_schema_.raw_key(), Binary);
-        ldb_options_.filter_policy =
-            leveldb::NewRowKeyBloomFilterPolicy(10, leveldb::BinaryRawKeyOperator());
+        ldb_options_.filter_policy = binary_filter;
     }
     ldb_options_.block_cache = block_cache;
     ldb_options_.table_cache = table_cache;
     ldb_options_.flush_triggered_log_num = FLAGS_tera_tablet_flush_log_num;
     ldb_options_.log_file_size = FLAGS_tera_tablet_log_file_size * 1024 * 1024;
+    ldb_options_.log_stream_num = FLAGS_tera_tablet_log_stream_num;
+    ldb_options_.shared_log = shared_log_;
+    ldb_options_.rate_limiter = rate_limiter_;
     ldb_options_.parent_tablets = parent_tablets;
     if (table_schema_.raw_key() == Binary) {
         ldb_options_.raw_key_format = leveldb::kBinary;
@@ -351,6 +439,10 @@ bool TabletIO::Load(const TableSchema& schema,
     ldb_options_.ignore_corruption_in_compaction = FLAGS_tera_leveldb_ignore_corruption_in_compaction;
     ldb_options_.use_file_lock = FLAGS_tera_leveldb_use_file_lock;
     ldb_options_.disable_wal = table_schema_.disable_wal();
+    // keys of kv tables are point looked up by their bytes
+    ldb_options_.data_block_hash_index = FLAGS_tera_leveldb_data_block_hash_index
+        && kv_only_ && ldb_options_.raw_key_format != leveldb::kBinary;
+    ldb_options_.dump_compress_threads = FLAGS_tera_leveldb_dump_compress_threads;
     SetupOptionsForLG(ignore_err_lgs);
 
     std::string path_prefix = FLAGS_tera_tabletnode_path_prefix;
@@ -359,39 +451,33 @@ bool TabletIO::Load(const TableSchema& schema,
     }
 
     tablet_path_ = path_prefix + path;
-    LOG(INFO) << "[Load] Start Open " << tablet_path_
-        << ", kv_only " << kv_only_ << ", raw_key_operator " << key_operator_->Name();
-
-    leveldb::Status db_status = leveldb::DB::Open(ldb_options_, tablet_path_, &db_);
-
-    if (!db_status.ok()) {
-        LOG(ERROR) << "fail to open table: " << tablet_path_
-            << ", " << db_status.ToString();
-        {
-            MutexLock lock(&mutex_);
-            status_ = kNotInit;
-            last_err_msg_ = db_status.ToString();
-            db_ref_count_--;
-        }
-        SetStatusCode(db_status, status);
-//         delete ldb_options_.env;
-        return false;
-    }
-
-    async_writer_ = new TabletWriter(this);
-    async_writer_->Start();
-
-    scan_context_manager_ = new ScanContextManager;
+}
 
+bool TabletIO::Prewarm(const TableSchema& schema,
+                       const std::string& path,
+                       const std::vector<leveldb::HotTableFile>& files,
+                       leveldb::Logger* logger,
+                       leveldb::Cache* block_cache,
+                       leveldb::TableCache* table_cache,
+                       uint64_t* warm_bytes,
+                       StatusCode* status) {
     {
         MutexLock lock(&mutex_);
-        status_ = kReady;
-        //reset try unload count to 0 for ready
-        try_unload_count_ = 0;
-        db_ref_count_--;
+        if (status_ != kNotInit) {
+            SetStatusCode(status_, status);
+            return false;
+        }
     }
 
-    LOG(INFO) << "[Load] Load " << tablet_path_ << " done";
+    SetupOptions(schema, path, std::vector<uint64_t>(), std::set<std::string>(),
+                 logger, block_cache, table_cache);
+    leveldb::Status s = leveldb::WarmUpDB(ldb_options_, tablet_path_, files, warm_bytes);
+    TearDownOptionsForLG();
+    if (!s.ok()) {
+        LOG(WARNING) << "[Prewarm] fail to warm up " << tablet_path_ << ", " << s.ToString();
+        SetStatusCode(s, status);
+        return false;
+    }
     return true;
 }
 
@@ -412,7 +498,7 @@ bool TabletIO::ShouldForceUnloadOnError() {
     return ret;
 }
 
-bool TabletIO::Unload(StatusCode* status) {
+bool TabletIO::Unload(StatusCode* status, bool keep_table_cache) {
     {
         MutexLock lock(&mutex_);
         // inc try unload times
@@ -448,7 +534,10 @@ bool TabletIO::Unload(StatusCode* status) {
 
     if (s.ok()) {
         LOG(INFO) << "[Unload] start shutdown2 " << tablet_path_;
-        db_->Shutdown2();
+        s = db_->Shutdown2();
+        if (s.ok() && keep_table_cache) {
+            db_->KeepTableCacheOnClose();
+        }
     } else {
         LOG(INFO) << "[Unload] shutdown1 failed, keep log " << tablet_path_;
     }
@@ -457,7 +546,6 @@ bool TabletIO::Unload(StatusCode* status) {
     delete db_;
     db_ = NULL;
 
-    delete ldb_options_.filter_policy;
     TearDownOptionsForLG();
     LOG(INFO) << "[Unload] done " << tablet_path_;
 
@@ -532,6 +620,25 @@ bool TabletIO::ParseRowKey(const std::string& tera_key, std::string* row_key) {
     return true;
 }
 
+bool TabletIO::GetHotTableFiles(uint64_t max_bytes,
+                                std::vector<leveldb::HotTableFile>* files,
+                                StatusCode* status) {
+    {
+        MutexLock lock(&mutex_);
+        if (status_ != kReady) {
+            SetStatusCode(status_, status);
+            return false;
+        }
+        db_ref_count_++;
+    }
+    db_->GetHotTableFiles(max_bytes, files);
+    {
+        MutexLock lock(&mutex_);
+        db_ref_count_--;
+    }
+    return true;
+}
+
 bool TabletIO::Split(std::string* split_key, StatusCode* status) {
     {
         MutexLock lock(&mutex_);
@@ -590,6 +697,23 @@ bool TabletIO::Split(std::string* split_key, StatusCode* status) {
     }
 }
 
+bool TabletIO::GetLoadSplitKey(std::string* split_key) {
+    std::string key;
+    if (!key_sampler_.GetMedianKey(FLAGS_tera_tablet_load_split_min_samples, &key)) {
+        return false;
+    }
+    if (key <= start_key_) {
+        // the first row is the hottest, leave it alone in the left child
+        key = start_key_;
+        key.push_back('\0');
+    }
+    if (!end_key_.empty() && key >= end_key_) {
+        return false;
+    }
+    *split_key = key;
+    return true;
+}
+
 bool TabletIO::Compact(int lg_no, StatusCode* status, CompactionType type) {
     {
         MutexLock lock(&mutex_);
@@ -764,8 +888,15 @@ StatusCode TabletIO::InitedScanIterator(const std::string& start_tera_key,
         read_option.prefetch_scan_size = FLAGS_tera_tabletnode_prefetch_scan_size;
     }
 
+    uint64_t skipped_files = 0;
+    read_option.skipped_files = &skipped_files;
+    int64_t new_iterator_us = scan_options.trace ? get_micros() : 0;
     *scan_it = db_->NewIterator(read_option);
     TearDownIteratorOptions(&read_option);
+    counter_.skipped_files.Add(skipped_files);
+    if (scan_options.trace != NULL) {
+        scan_options.trace->Add(RequestTrace::kReadIterator, get_micros() - new_iterator_us);
+    }
 
     if ((*scan_it)->status().IsShutdownInProgress()) {
         TABLET_UNLOAD_LOG << "on waiting_for_shutdown2_ new a ErrorIterator, and return kKeyNotInRange";
@@ -773,7 +904,8 @@ StatusCode TabletIO::InitedScanIterator(const std::string& start_tera_key,
     }
 
     VLOG(10) << "ll-scan: " << "startkey=[" << DebugString(start_key.ToString()) << ":"
-             << DebugString(start_col.ToString()) << ":" << DebugString(start_qual.ToString());
+             << DebugString(start_col.ToString()) << ":" << DebugString(start_qual.ToString())
+             << "], skipped sst files: " << skipped_files;
     std::string start_seek_key;
     key_operator_->EncodeTeraKey(start_key.ToString(), "", "", kLatestTs,
                                   leveldb::TKT_FORSEEK, &start_seek_key);
@@ -812,7 +944,7 @@ bool TabletIO::LowLevelScan(const std::string& start_tera_key,
 }
 
 bool TabletIO::ScanWithFilter(const ScanOptions& scan_options) {
-    return scan_options.filter_list.filter_size() != 0;
+    return !scan_options.compiled_filter.Empty();
 }
 
 // 检测`row_buf'中的数据是否为一整行，`row_buf'为空是整行的特例，也返回true
@@ -865,18 +997,18 @@ bool TabletIO::ShouldFilterRow(const ScanOptions& scan_options,
     }
     std::string origin_row = row_buf.begin()->key();
 
-    leveldb::Slice origin_cell = it->key();
+    std::string origin_cell = it->key().ToString();
 
-    int filter_num = scan_options.filter_list.filter_size();
+    const CompiledScanFilter& filter = scan_options.compiled_filter;
+    size_t filter_num = filter.FamilyNum();
 
     // TODO(taocipian)
     // 0). some target cf maybe already in row_buf
     // 1). collects all target cf and sorts them,
     //     then Seek() to the 1st cf, Next() to the rest
-    for (int i = 0; i < filter_num; ++i) {
-        const Filter& filter = scan_options.filter_list.filter(i);
+    for (size_t i = 0; i < filter_num; ++i) {
         // 针对用户指定了过滤条件的每一列，seek过去看看是否符合
-        std::string target_cf = filter.content();
+        const std::string& target_cf = filter.Family(i);
         VLOG(9) << "[filter] " << i << " of " << filter_num
                 << " , target cf:" << target_cf;
         std::string seek_key;
@@ -885,23 +1017,19 @@ bool TabletIO::ShouldFilterRow(const ScanOptions& scan_options,
         it->Seek(seek_key);
         for (; it->Valid();) {
             leveldb::Slice row, cf, qu;
-            int64_t ts;
-            if (!key_operator_->ExtractTeraKey(it->key(), &row, &cf, &qu, &ts, NULL)) {
+            if (!key_operator_->ExtractTeraKey(it->key(), &row, &cf, &qu, NULL, NULL)) {
                 LOG(ERROR) << "[filter] invalid tera key: " << DebugString(it->key().ToString());
                 it->Next();
                 continue;
             }
-            if ((row.ToString() != origin_row)
-                || (cf.ToString() != target_cf)
-                || (qu.ToString() != "")) {
+            if (row != leveldb::Slice(origin_row)
+                || cf != leveldb::Slice(target_cf)
+                || !qu.empty()) {
                 // 用户试图过滤不存在的一列，忽略这个过滤条件
                 VLOG(9) << "[filter] target cf not found:" << target_cf;
                 break;
             }
-            KeyValuePair pair;
-            leveldb::Slice value = it->value();
-            MakeKvPair(row, cf, qu, ts, value, &pair);
-            if (!CheckCell(pair, filter)) {
+            if (!filter.CheckFamily(i, it->value())) {
                 it->Seek(origin_cell);
                 VLOG(9) << "[filter] check failed at target cf:" << target_cf;
                 return true;
@@ -954,6 +1082,9 @@ inline bool TabletIO::LowLevelScan(const std::string& start_tera_key,
     uint64_t& qu_num = scan_context->qu_num;
 
     std::list<KeyValuePair> row_buf;
+    const CompiledScanFilter& row_filter = scan_options.compiled_filter;
+    // the current row failed the filter, its cells are skipped unparsed
+    bool row_filtered = false;
     uint32_t buffer_size = 0;
     int64_t number_limit = 0;
     value_list->clear_key_values();
@@ -1060,6 +1191,10 @@ inline bool TabletIO::LowLevelScan(const std::string& start_tera_key,
             *read_row_count += 1;
             ProcessRowBuffer(row_buf, scan_options, value_list, &buffer_size, &number_limit);
             row_buf.clear();
+            row_filtered = false;
+        } else if (row_filtered) {
+            it->Next();
+            continue;
         }
 
         if (key.compare(last_key) == 0 &&
@@ -1103,9 +1238,16 @@ inline bool TabletIO::LowLevelScan(const std::string& start_tera_key,
             }
         }
 
-        KeyValuePair kv;
-        MakeKvPair(key, col, qual, ts, value, &kv);
-        row_buf.push_back(kv);
+        if (!row_filter.Empty() && !row_filter.CheckCell(col, value)) {
+            // drop the buffered cells of this row and skip the rest of it
+            VLOG(10) << "ll-scan filter row: " << DebugString(key.ToString());
+            row_buf.clear();
+            row_filtered = true;
+        } else {
+            KeyValuePair kv;
+            MakeKvPair(key, col, qual, ts, value, &kv);
+            row_buf.push_back(kv);
+        }
 
         // ScanMergedValue may have set it->Next()
         // Must make sure has_merged == false before it->Next()
@@ -1126,7 +1268,17 @@ inline bool TabletIO::LowLevelScan(const std::string& start_tera_key,
     }
     *is_complete = !it->Valid() ? true : *is_complete;
 
-    if (ScanWithFilter(scan_options)
+    if (row_filtered && it->Valid()) {
+        // the row may go on after the break, the rest of it is not returned
+        std::string next_row = last_key + '\0';
+        std::string seek_key;
+        key_operator_->EncodeTeraKey(next_row, "", "", kLatestTs,
+                                      leveldb::TKT_FORSEEK, &seek_key);
+        it->Seek(seek_key);
+        if (*status == kRPCTimeout && next_start_point != NULL) {
+            MakeKvPair(leveldb::Slice(next_row), "", "", kLatestTs, "", next_start_point);
+        }
+    } else if (ScanWithFilter(scan_options)
         && it->Valid()
         && !IsCompleteRow(row_buf, it)
         && ShouldFilterRow(scan_options, row_buf, it)) {
@@ -1180,8 +1332,15 @@ bool TabletIO::LowLevelSeek(const std::string& row_key,
     }
     read_option.rollbacks = rollbacks_;
     SetupSingleRowIteratorOptions(row_key, &read_option);
+    uint64_t skipped_files = 0;
+    read_option.skipped_files = &skipped_files;
+    int64_t new_iterator_us = scan_options.trace ? get_micros() : 0;
     std::unique_ptr<leveldb::Iterator> it_data(db_->NewIterator(read_option));
     TearDownIteratorOptions(&read_option);
+    counter_.skipped_files.Add(skipped_files);
+    if (scan_options.trace != NULL) {
+        scan_options.trace->Add(RequestTrace::kReadIterator, get_micros() - new_iterator_us);
+    }
     if (it_data->status().IsShutdownInProgress()) {
         TABLET_UNLOAD_LOG << "on waiting_for_shutdown2_ new a ErrorIterator, and return early";
         SetStatusCode(kKeyNotInRange, status);
@@ -1356,7 +1515,8 @@ bool TabletIO::LowLevelSeek(const std::string& row_key,
 }
 
 bool TabletIO::ReadCells(const RowReaderInfo& row_reader, RowResult* value_list,
-                         uint64_t snapshot_id, StatusCode* status, int64_t timeout_ms) {
+                         uint64_t snapshot_id, StatusCode* status, int64_t timeout_ms,
+                         RequestTrace* trace) {
     {
         MutexLock lock(&mutex_);
         if ((status_ != kReady && status_ != kUnLoading) || IsUrgentUnload()) {
@@ -1373,6 +1533,7 @@ bool TabletIO::ReadCells(const RowReaderInfo& row_reader, RowResult* value_list,
     }
 
     int64_t start_read_us = get_micros();
+    key_sampler_.Sample(row_reader.key());
 
     if (kv_only_) {
         std::string key(row_reader.key());
@@ -1383,7 +1544,9 @@ bool TabletIO::ReadCells(const RowReaderInfo& row_reader, RowResult* value_list,
         if (!Read(key, &value, snapshot_id, status)) {
             counter_.read_rows.Inc();
             row_read_count.Inc();
-            row_read_delay.Add(get_micros() - start_read_us);
+            int64_t read_us = get_micros() - start_read_us;
+            row_read_delay.Add(read_us);
+            row_read_delay_percentile.Append(read_us);
             {
                 MutexLock lock(&mutex_);
                 db_ref_count_--;
@@ -1397,7 +1560,9 @@ bool TabletIO::ReadCells(const RowReaderInfo& row_reader, RowResult* value_list,
         row_read_count.Inc();
         counter_.read_size.Add(result->ByteSize());
         row_read_bytes.Add(result->ByteSize());
-        row_read_delay.Add(get_micros() - start_read_us);
+        int64_t read_us = get_micros() - start_read_us;
+        row_read_delay.Add(read_us);
+        row_read_delay_percentile.Append(read_us);
         {
             MutexLock lock(&mutex_);
             db_ref_count_--;
@@ -1444,6 +1609,7 @@ bool TabletIO::ReadCells(const RowReaderInfo& row_reader, RowResult* value_list,
 
     scan_options.snapshot_id = snapshot_id;
     scan_options.timeout = timeout_ms;
+    scan_options.trace = trace;
 
 
     VLOG(10) << "ReadCells: " << "key=[" << DebugString(row_reader.key()) << "]";
@@ -1466,7 +1632,9 @@ bool TabletIO::ReadCells(const RowReaderInfo& row_reader, RowResult* value_list,
     }
     counter_.read_rows.Inc();
     row_read_count.Inc();
-    row_read_delay.Add(get_micros() - start_read_us);
+    int64_t read_us = get_micros() - start_read_us;
+    row_read_delay.Add(read_us);
+    row_read_delay_percentile.Append(read_us);
     {
         MutexLock lock(&mutex_);
         db_ref_count_--;
@@ -1486,10 +1654,11 @@ bool TabletIO::ReadCells(const RowReaderInfo& row_reader, RowResult* value_list,
 }
 
 bool TabletIO::WriteBatch(leveldb::WriteBatch* batch, bool disable_wal, bool sync,
-                          StatusCode* status) {
+                          StatusCode* status, leveldb::WriteTrace* trace) {
     leveldb::WriteOptions options;
     options.disable_wal = disable_wal;
     options.sync = sync;
+    options.trace = trace;
 
     CHECK_NOTNULL(db_);
 
@@ -1515,7 +1684,8 @@ bool TabletIO::WriteOne(const std::string& key, const std::string& value,
 
 bool TabletIO::Write(std::vector<const RowMutationSequence*>* row_mutation_vec,
                      std::vector<StatusCode>* status_vec, bool is_instant,
-                     WriteCallback callback, StatusCode* status) {
+                     WriteCallback callback, StatusCode* status,
+                     RequestTrace* trace) {
     {
         MutexLock lock(&mutex_);
         if ((status_ != kReady && status_ != kUnLoading) || IsUrgentUnload()) {
@@ -1531,7 +1701,7 @@ bool TabletIO::Write(std::vector<const RowMutationSequence*>* row_mutation_vec,
         db_ref_count_++;
     }
     bool ret = async_writer_->Write(row_mutation_vec, status_vec, is_instant,
-                                     callback, status);
+                                     callback, status, trace);
     if (!ret) {
         counter_.write_reject_rows.Add(row_mutation_vec->size());
     }
@@ -1563,6 +1733,7 @@ bool TabletIO::ScanRows(const ScanTabletRequest* request,
         }
         db_ref_count_++;
     }
+    key_sampler_.Sample(request->start());
 
     bool success = false;
     if (kv_only_) {
@@ -1625,7 +1796,11 @@ bool TabletIO::ScanRowsRestricted(const ScanTabletRequest* request,
         counter_.scan_size.Add(read_bytes);
         row_scan_count.Add(read_row_count);
         row_scan_bytes.Add(read_bytes);
-        row_scan_delay.Add(get_micros() - start_scan_us);
+        int64_t scan_us = get_micros() - start_scan_us;
+        row_scan_delay.Add(scan_us);
+        if (read_row_count > 0) {
+            row_scan_delay_percentile.Append(scan_us / read_row_count);
+        }
         ret = true;
     }
 
@@ -1670,7 +1845,11 @@ void TabletIO::ProcessScan(ScanContext* context) {
         counter_.scan_size.Add(size_scan_bytes);
         row_scan_count.Add(rows_scan_num);
         row_scan_bytes.Add(size_scan_bytes);
-        row_scan_delay.Add(get_micros() - start_scan_us);
+        int64_t scan_us = get_micros() - start_scan_us;
+        row_scan_delay.Add(scan_us);
+        if (rows_scan_num > 0) {
+            row_scan_delay_percentile.Append(scan_us / rows_scan_num);
+        }
     }
 }
 
@@ -1780,7 +1959,11 @@ bool TabletIO::Scan(const ScanOption& option, KeyValueList* kv_list,
     counter_.scan_size.Add(pack_size);
     row_scan_count.Add(kv_list->size());
     row_scan_bytes.Add(pack_size);
-    row_scan_delay.Add(get_micros() - start_scan_us);
+    int64_t scan_us = get_micros() - start_scan_us;
+    row_scan_delay.Add(scan_us);
+    if (kv_list->size() > 0) {
+        row_scan_delay_percentile.Append(scan_us / kv_list->size());
+    }
 
     return true;
 }
@@ -1828,6 +2011,7 @@ void TabletIO::SetupScanRowOptions(const ScanTabletRequest* request,
     if (request->has_filter_list() &&
         request->filter_list().filter_size() > 0) {
         scan_options->filter_list.CopyFrom(request->filter_list());
+        scan_options->compiled_filter = CompiledScanFilter(scan_options->filter_list);
     }
     if (scan_options->iter_cf_set.size() > 0 &&
         scan_options->filter_list.filter_size() > 0) {
@@ -1906,9 +2090,11 @@ void TabletIO::SetupOptionsForLG(const std::set<std::string>& ignore_err_lgs) {
                     lg_info->env = DefaultFlashBlockCacheEnv();
                 } else {
                     lg_info->env = LeveldbFlashEnv();
+                    lg_info->use_mmap_read = FLAGS_tera_leveldb_use_mmap_read;
                 }
             } else {
                 lg_info->env = LeveldbMemEnv();
+                lg_info->use_mmap_read = FLAGS_tera_leveldb_use_mmap_read;
             }
             lg_info->seek_latency = 0;
             lg_info->block_cache = m_memory_cache;
@@ -1918,7 +2104,10 @@ void TabletIO::SetupOptionsForLG(const std::set<std::string>& ignore_err_lgs) {
                 lg_info->env = DefaultFlashBlockCacheEnv();
             } else {
                 lg_info->env = LeveldbFlashEnv();
-                lg_info->use_direct_io_read = FLAGS_tera_leveldb_use_direct_io_read;
+                // mmap read turns direct io read off
+                lg_info->use_mmap_read = FLAGS_tera_leveldb_use_mmap_read;
+                lg_info->use_direct_io_read = FLAGS_tera_leveldb_use_direct_io_read
+                    && !FLAGS_tera_leveldb_use_mmap_read;
                 lg_info->use_direct_io_write = FLAGS_tera_leveldb_use_direct_io_write;
                 lg_info->posix_write_buffer_size = FLAGS_tera_leveldb_posix_write_buffer_size;
             }
@@ -1954,6 +2143,13 @@ void TabletIO::SetupOptionsForLG(const std::set<std::string>& ignore_err_lgs) {
         triggered_log_size += lg_info->write_buffer_size;
         lg_info->table_builder_batch_write = (FLAGS_tera_leveldb_table_builder_write_batch_size > 0);
         lg_info->table_builder_batch_size = FLAGS_tera_leveldb_table_builder_write_batch_size;
+        lg_info->use_tera_block_encoding = FLAGS_tera_leveldb_use_tera_block_encoding;
+        if (lg_schema.compact_style() == TieredCompact) {
+            lg_info->compaction_style = leveldb::kTieredCompaction;
+            lg_info->tiered_size_ratio = FLAGS_tera_leveldb_tiered_compaction_size_ratio;
+            LOG(INFO) << "tiered compaction for LG:" << lg_schema.name()
+                << ", size_ratio:" << lg_info->tiered_size_ratio;
+        }
         exist_lg_list->insert(lg_i);
         (*lg_info_list)[lg_i] = lg_info;
         if (ignore_err_lgs.find(lg_schema.name()) != ignore_err_lgs.end()) {
@@ -2042,6 +2238,18 @@ void TabletIO::SetupIteratorOptions(const ScanOptions& scan_options,
     if (target_lgs.size() > 0) {
         leveldb_opts->target_lgs = new std::set<uint32_t>(target_lgs);
     }
+    // sst files of tera tables record their column families
+    if (!kv_only_ && scan_options.iter_cf_set.size() > 0) {
+        leveldb_opts->target_cfs = new std::set<std::string>(scan_options.iter_cf_set);
+    }
+    if (scan_options.trace != NULL) {
+        leveldb_opts->trace = scan_options.trace->MutableReadTrace();
+    }
+    // leveldb reads all files if atomic operations may be merged into
+    // cells older than ts_start
+    if (!kv_only_) {
+        leveldb_opts->cell_ts_start = scan_options.ts_start;
+    }
 }
 
 void TabletIO::SetupSingleRowIteratorOptions(const std::string& row_key,
@@ -2061,35 +2269,11 @@ void TabletIO::TearDownIteratorOptions(leveldb::ReadOptions* opts) {
         delete opts->target_lgs;
         opts->target_lgs = NULL;
     }
-}
-
-bool TabletIO::ShouldFilterRowBuffer(std::list<KeyValuePair>& row_buf,
-                                     const ScanOptions& scan_options) {
-    if (row_buf.size() <= 0) {
-        return true;
-    }
-    std::list<KeyValuePair>::iterator it;
-    int filter_num = scan_options.filter_list.filter_size();
-
-    VLOG(10) << "Filter check: kv_num: " << row_buf.size()
-        << ", filter_num: " << filter_num;
-
-    for (int i = 0; i < filter_num; ++i) {
-        const Filter& filter = scan_options.filter_list.filter(i);
-        for (it = row_buf.begin(); it != row_buf.end(); ++it) {
-            if (it->column_family() != filter.content()) {
-                continue;
-            }
-            if (filter.value_type() != kINT64) {
-                LOG(ERROR) << "only support int64 value.";
-                return true;
-            }
-            if (!CheckCell(*it, filter)) {
-                return true;
-            }
-        }
+    if (opts->target_cfs) {
+        delete opts->target_cfs;
+        opts->target_cfs = NULL;
     }
-    return false;
+    opts->skipped_files = NULL;
 }
 
 void TabletIO::ProcessRowBuffer(std::list<KeyValuePair>& row_buf,
@@ -2100,10 +2284,6 @@ void TabletIO::ProcessRowBuffer(std::list<KeyValuePair>& row_buf,
     if (row_buf.size() <= 0) {
         return;
     }
-    if (ShouldFilterRowBuffer(row_buf, scan_options)) {
-        return;
-    }
-
     std::list<KeyValuePair>::iterator it;
     for (it = row_buf.begin(); it != row_buf.end(); ++it) {
         const std::string& key = it->key();
@@ -2410,5 +2590,47 @@ bool TabletIO::GetDBLevelSize(std::vector<int64_t>* result) {
     return true;
 
 }
+
+bool TabletIO::RefreshWriteAmplification() {
+    {
+        MutexLock lock(&mutex_);
+        if (status_ != kReady) {
+            return false;
+        }
+        db_ref_count_++;
+    }
+    std::vector<uint64_t> flush_bytes;
+    std::vector<uint64_t> compaction_bytes;
+    db_->GetWriteBytes(&flush_bytes, &compaction_bytes);
+
+    MutexLock lock(&mutex_);
+    db_ref_count_--;
+    if (ldb_options_.exist_lg_list == NULL ||
+        ldb_options_.exist_lg_list->size() != flush_bytes.size()) {
+        return false;
+    }
+    if (lg_write_amp_counters_.empty()) {
+        TableSchema schema = GetSchema();
+        std::set<uint32_t>::iterator it = ldb_options_.exist_lg_list->begin();
+        for (; it != ldb_options_.exist_lg_list->end(); ++it) {
+            std::string label = LabelStringBuilder()
+                .Append("table", schema.name())
+                .Append("tablet", short_path_)
+                .Append("lg", schema.locality_groups(*it).name())
+                .ToString();
+            lg_write_amp_counters_.emplace_back(kLgWriteAmplificationMetricName, label,
+                                                SubscriberTypeList({SubscriberType::LATEST}),
+                                                false);
+        }
+    }
+    for (size_t i = 0; i < flush_bytes.size(); ++i) {
+        int64_t percent = 0;
+        if (flush_bytes[i] > 0) {
+            percent = (flush_bytes[i] + compaction_bytes[i]) * 100 / flush_bytes[i];
+        }
+        lg_write_amp_counters_[i].Set(percent);
+    }
+    return true;
+}
 } // namespace io
 } // namespace tera
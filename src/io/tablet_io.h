@@ -16,6 +16,7 @@
 #include "common/base/scoped_ptr.h"
 #include "common/metric/metric_counter.h"
 #include "common/mutex.h"
+#include "io/key_sampler.h"
 #include "io/tablet_scanner.h"
 #include "leveldb/db.h"
 #include "leveldb/options.h"
@@ -44,10 +45,13 @@ const char* const kWriteRowsMetricName = "tera_ts_tablet_write_row_count";
 const char* const kWriteKvsMetricName = "tera_ts_tablet_write_kv_count";
 const char* const kWriteThroughPutMetricName = "tera_ts_tablet_write_through_put";
 const char* const kWriteRejectRowsMetricName = "tera_ts_tablet_write_reject_row_count";
+const char* const kSkippedFilesMetricName = "tera_ts_tablet_skipped_sst_count";
+const char* const kLgWriteAmplificationMetricName = "tera_ts_tablet_lg_write_amplification_percent";
 
 namespace io {
 
 class TabletWriter;
+class RequestTrace;
 struct ScanOptions;
 struct ScanContext;
 class ScanContextManager;
@@ -75,6 +79,7 @@ public:
         tera::MetricCounter scan_rows;
         tera::MetricCounter scan_kvs;
         tera::MetricCounter scan_size;
+        tera::MetricCounter skipped_files;
         tera::MetricCounter read_rows;
         tera::MetricCounter read_kvs;
         tera::MetricCounter read_size;
@@ -89,6 +94,7 @@ public:
               scan_rows(tera::kScanRowsMetricName, label, {SubscriberType::QPS}),
               scan_kvs(tera::kScanKvsMetricName, label, {SubscriberType::QPS}),
               scan_size(tera::kScanThroughPutMetricName, label, {SubscriberType::THROUGHPUT}),
+              skipped_files(tera::kSkippedFilesMetricName, label, {SubscriberType::QPS}),
               read_rows(tera::kReadRowsMetricName, label, {SubscriberType::QPS}),
               read_kvs(tera::kReadKvsMetricName, label, {SubscriberType::QPS}),
               read_size(tera::kReadThroughPutMetricName, label, {SubscriberType::THROUGHPUT}),
@@ -121,8 +127,12 @@ public:
     RawKey RawKeyType() const;
     bool KvOnly() const { return kv_only_; }
     StatCounter& GetCounter();
+    KeySampler& GetKeySampler();
     // Set independent cache for memory table.
     void SetMemoryCache(leveldb::Cache* cache);
+    void SetSharedLog(leveldb::SharedLog* shared_log);
+    // Set the node-level limiter of the sst writes.
+    void SetRateLimiter(leveldb::RateLimiter* rate_limiter);
     // tablet
     virtual bool Load(const TableSchema& schema,
                       const std::string& path,
@@ -132,14 +142,37 @@ public:
                       leveldb::Cache* block_cache = NULL,
                       leveldb::TableCache* table_cache = NULL,
                       StatusCode* status = NULL);
-    virtual bool Unload(StatusCode* status = NULL);
+    // "keep_table_cache" keeps opened tables in the node-wide table cache
+    // for the children of a split loaded right after on this node.
+    virtual bool Unload(StatusCode* status = NULL, bool keep_table_cache = false);
     virtual bool Split(std::string* split_key, StatusCode* status = NULL);
+    // The row key splitting the recently sampled read/write/scan load of
+    // the tablet in half, false if the tablet is not accessed enough.
+    bool GetLoadSplitKey(std::string* split_key);
+    // Table files of the tablet, with at most "max_bytes" of their data
+    // blocks found in the block cache, to warm another tabletnode up.
+    bool GetHotTableFiles(uint64_t max_bytes, std::vector<leveldb::HotTableFile>* files,
+                          StatusCode* status = NULL);
+    // Read "files" of a tablet not loaded yet into the node-wide table cache
+    // and block cache, before the tablet moves to this tabletnode.
+    bool Prewarm(const TableSchema& schema,
+                 const std::string& path,
+                 const std::vector<leveldb::HotTableFile>& files,
+                 leveldb::Logger* logger,
+                 leveldb::Cache* block_cache,
+                 leveldb::TableCache* table_cache,
+                 uint64_t* warm_bytes,
+                 StatusCode* status = NULL);
     virtual bool Compact(int lg_no = -1, StatusCode* status = NULL, CompactionType type = kManualCompaction);
     bool Destroy(StatusCode* status = NULL);
     virtual bool GetDataSize(uint64_t* size, std::vector<uint64_t>* lgsize = NULL,
                              StatusCode* status = NULL);
     virtual bool AddInheritedLiveFiles(std::vector<std::set<uint64_t> >* live);
     bool GetDBLevelSize(std::vector<int64_t>*);
+    // Update the write amplification metrics of locality groups, the bytes
+    // of sst files written by memtable dumps and compactions over the bytes
+    // written by memtable dumps.
+    bool RefreshWriteAmplification();
 
     bool IsBusy();
     bool Workload(double* write_workload);
@@ -152,7 +185,8 @@ public:
     // read a row
     virtual bool ReadCells(const RowReaderInfo& row_reader, RowResult* value_list,
                            uint64_t snapshot_id = 0, StatusCode* status = NULL,
-                           int64_t timeout_ms = std::numeric_limits<int64_t>::max());
+                           int64_t timeout_ms = std::numeric_limits<int64_t>::max(),
+                           RequestTrace* trace = NULL);
     /// scan from leveldb return ture means complete flase means not complete
     bool LowLevelScan(const std::string& start_tera_key,
                       const std::string& end_row_key,
@@ -170,10 +204,11 @@ public:
     bool WriteOne(const std::string& key, const std::string& value,
                   bool sync = true, StatusCode* status = NULL);
     bool WriteBatch(leveldb::WriteBatch* batch, bool disable_wal = false, bool sync = true,
-                    StatusCode* status = NULL);
+                    StatusCode* status = NULL, leveldb::WriteTrace* trace = NULL);
     bool Write(std::vector<const RowMutationSequence*>* row_mutation_vec,
                std::vector<StatusCode>* status_vec, bool is_instant,
-               WriteCallback callback, StatusCode* status = NULL);
+               WriteCallback callback, StatusCode* status = NULL,
+               RequestTrace* trace = NULL);
 
     virtual bool Scan(const ScanOption& option, KeyValueList* kv_list,
                       bool* complete, StatusCode* status = NULL);
@@ -225,6 +260,13 @@ private:
                           bool sync = false, StatusCode* status = NULL);
 //     int64_t GetDataSizeWithoutLock(StatusCode* status = NULL);
 
+    void SetupOptions(const TableSchema& schema,
+                      const std::string& path,
+                      const std::vector<uint64_t>& parent_tablets,
+                      const std::set<std::string>& ignore_err_lgs,
+                      leveldb::Logger* logger,
+                      leveldb::Cache* block_cache,
+                      leveldb::TableCache* table_cache);
     void SetupOptionsForLG(const std::set<std::string>& ignore_err_lgs);
     void TearDownOptionsForLG();
     void IndexingCfToLG();
@@ -276,8 +318,6 @@ private:
                     int64_t ts, leveldb::Slice value, KeyValuePair* kv);
 
     bool ParseRowKey(const std::string& tera_key, std::string* row_key);
-    bool ShouldFilterRowBuffer(std::list<KeyValuePair>& row_buf,
-                               const ScanOptions& scan_options);
 
     bool ScanWithFilter(const ScanOptions& scan_options);
     bool IsCompleteRow(const std::list<KeyValuePair>& row_buf,
@@ -317,6 +357,8 @@ private:
     leveldb::Options ldb_options_;
     leveldb::DB* db_;
     leveldb::Cache* m_memory_cache;
+    leveldb::SharedLog* shared_log_;
+    leveldb::RateLimiter* rate_limiter_;
     TableSchema table_schema_;
     bool kv_only_;
     std::map<uint64_t, uint64_t> id_to_snapshot_num_;
@@ -330,6 +372,9 @@ private:
     // accept unload request for this tablet will inc this count
     std::atomic<int> try_unload_count_;
     StatCounter counter_;
+    // write amplification of each lg in exist_lg_list, guarded by mutex_
+    std::vector<tera::MetricCounter> lg_write_amp_counters_;
+    KeySampler key_sampler_;
     mutable Mutex schema_mutex_;
 
     leveldb::Env* mock_env_; // mock env for testing
@@ -15,11 +15,13 @@
 #include "leveldb/compact_strategy.h"
 #include "leveldb/db.h"
 #include "proto/tabletnode_rpc.pb.h"
+#include "utils/scan_filter.h"
 
 namespace tera {
 namespace io {
 
 class TabletIO;
+class RequestTrace;
 
 typedef std::map< std::string, std::set<std::string> > ColumnFamilyMap;
 struct ScanOptions {
@@ -30,12 +32,16 @@ struct ScanOptions {
     int64_t ts_end;
     uint64_t snapshot_id;
     FilterList filter_list;
+    // filter_list prepared for checking raw cells
+    CompiledScanFilter compiled_filter;
     ColumnFamilyMap column_family_list;
     std::set<std::string> iter_cf_set;
     int64_t timeout;
     uint64_t max_qualifiers;
     // If sdk uses batch scan, we will use prefetch scan iterator.;
     bool is_batch_scan;
+    // the trace of a sampled read request, or NULL
+    RequestTrace* trace;
 
     ScanOptions()
             : max_versions(std::numeric_limits<uint32_t>::max()),
@@ -44,7 +50,8 @@ struct ScanOptions {
               ts_start(kOldestTs), ts_end(kLatestTs), snapshot_id(0),
               timeout(std::numeric_limits<int64_t>::max() / 2),
               max_qualifiers(std::numeric_limits<uint64_t>::max()),
-              is_batch_scan(false)
+              is_batch_scan(false),
+              trace(NULL)
     {}
 };
 
@@ -14,6 +14,7 @@
 #include "common/this_thread.h"
 #include "io/coding.h"
 #include "io/io_utils.h"
+#include "io/request_trace.h"
 #include "io/tablet_io.h"
 #include "leveldb/lg_coding.h"
 #include "proto/proto_helper.h"
@@ -129,7 +130,8 @@ uint64_t TabletWriter::CountRequestSize(std::vector<const RowMutationSequence*>&
 
 bool TabletWriter::Write(std::vector<const RowMutationSequence*>* row_mutation_vec,
                          std::vector<StatusCode>* status_vec, bool is_instant,
-                         WriteCallback callback, StatusCode* status) {
+                         WriteCallback callback, StatusCode* status,
+                         RequestTrace* trace) {
     static uint32_t last_print = time(NULL);
     const uint64_t MAX_PENDING_SIZE = FLAGS_tera_asyncwriter_pending_limit * 1024UL;
 
@@ -157,6 +159,7 @@ bool TabletWriter::Write(std::vector<const RowMutationSequence*>* row_mutation_v
     task.row_mutation_vec = row_mutation_vec;
     task.status_vec = status_vec;
     task.callback = callback;
+    task.trace = trace;
 
     active_buffer_->push_back(task);
     active_buffer_size_ += request_size;
@@ -358,6 +361,7 @@ void TabletWriter::FinishTask(WriteTaskBuffer* task_buffer, StatusCode status) {
         row_write_delay.Add(get_micros() - task.start_time);
         for (uint32_t i = 0; i < task.row_mutation_vec->size(); i++) {
             tablet_->GetCounter().write_kvs.Add((*task.row_mutation_vec)[i]->mutation_sequence_size());
+            tablet_->GetKeySampler().Sample((*task.row_mutation_vec)[i]->row_key());
             // set batch_write status for row_mu
             if ((*task.status_vec)[i] == kTabletNodeOk) {
                 (*task.status_vec)[i] = status;
@@ -469,16 +473,37 @@ StatusCode TabletWriter::FlushToDiskBatch(WriteTaskBuffer* task_buffer) {
     leveldb::WriteBatch batch;
     BatchRequest(task_buffer, &batch);
     batch_cost = get_micros();
+
+    bool traced = false;
+    for (uint32_t task_idx = 0; task_idx < task_buffer->size(); ++task_idx) {
+        WriteTask& task = (*task_buffer)[task_idx];
+        if (task.trace != NULL) {
+            task.trace->Max(RequestTrace::kWriteBatch, batch_cost - task.start_time);
+            traced = true;
+        }
+    }
+    leveldb::WriteTrace write_trace;
+
     StatusCode status = kTabletNodeOk;
     if (tablet_->IsUrgentUnload()) {
         LOG(INFO) << "tablet unload slow, reject to write log and memtable";
     } else {
         const bool disable_wal = false;
-        tablet_->WriteBatch(&batch, disable_wal, FLAGS_tera_sync_log, &status);
+        tablet_->WriteBatch(&batch, disable_wal, FLAGS_tera_sync_log, &status,
+                            traced ? &write_trace : NULL);
     }
     batch.Clear();
     write_cost = get_micros();
 
+    for (uint32_t task_idx = 0; traced && task_idx < task_buffer->size(); ++task_idx) {
+        RequestTrace* trace = (*task_buffer)[task_idx].trace;
+        if (trace != NULL) {
+            trace->Max(RequestTrace::kWriteLeaderWait, write_trace.wait_us);
+            trace->Max(RequestTrace::kWriteLog, write_trace.log_us);
+            trace->Max(RequestTrace::kWriteMemTable, write_trace.memtable_us);
+        }
+    }
+
     FinishTask(task_buffer, status);
     finish_cost = get_micros();
     int64_t check_delay = check_cost - start_ts;
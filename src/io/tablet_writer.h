@@ -22,6 +22,7 @@ class WriteBatch;
 namespace tera {
 namespace io {
 
+class RequestTrace;
 class TabletIO;
 
 class TabletWriter {
@@ -30,11 +31,12 @@ public:
                                 std::vector<StatusCode>*)> WriteCallback;
 
     struct WriteTask {
-        WriteTask():start_time(get_micros()) {}
+        WriteTask():start_time(get_micros()), trace(NULL) {}
         std::vector<const RowMutationSequence*>* row_mutation_vec;
         std::vector<StatusCode>* status_vec;
         WriteCallback callback;
         int64_t start_time;
+        RequestTrace* trace;
     };
 
     typedef std::vector<WriteTask> WriteTaskBuffer;
@@ -44,7 +46,8 @@ public:
     ~TabletWriter();
     bool Write(std::vector<const RowMutationSequence*>* row_mutation_vec,
                std::vector<StatusCode>* status_vec, bool is_instant,
-               WriteCallback callback, StatusCode* status = NULL);
+               WriteCallback callback, StatusCode* status = NULL,
+               RequestTrace* trace = NULL);
     /// 初略计算一个request的数据大小
     static uint64_t CountRequestSize(std::vector<const RowMutationSequence*>& row_mutation_vec,
                                      bool kv_only);
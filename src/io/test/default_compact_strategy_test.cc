@@ -0,0 +1,220 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "io/default_compact_strategy.h"
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "common/timer.h"
+#include "leveldb/raw_key_operator.h"
+
+namespace tera {
+namespace io {
+
+class DefaultCompactStrategyTest : public ::testing::Test {
+public:
+    DefaultCompactStrategyTest() : key_operator_(leveldb::ReadableRawKeyOperator()) {}
+
+    void AddColumnFamily(const std::string& name, int32_t max_versions, int32_t ttl) {
+        ColumnFamilySchema* cf = schema_.add_column_families();
+        cf->set_name(name);
+        cf->set_max_versions(max_versions);
+        cf->set_time_to_live(ttl);
+    }
+
+    std::string Key(const std::string& row, const std::string& cf, const std::string& qual,
+                    int64_t ts, leveldb::TeraKeyType type = leveldb::TKT_VALUE) {
+        std::string key;
+        key_operator_->EncodeTeraKey(row, cf, qual, ts, type, &key);
+        return key;
+    }
+
+protected:
+    TableSchema schema_;
+    const leveldb::RawKeyOperator* key_operator_;
+};
+
+TEST_F(DefaultCompactStrategyTest, CompactSchema) {
+    AddColumnFamily("cf1", 3, 0);
+    AddColumnFamily("c", 1, 10);
+    AddColumnFamily("cf", 2, -1);
+    CompactSchema compact_schema(schema_);
+    ASSERT_EQ(compact_schema.Size(), 3U);
+
+    const CompactSchema::ColumnFamily* cf = compact_schema.Find("cf1");
+    ASSERT_TRUE(cf != NULL);
+    EXPECT_EQ(cf->name.ToString(), "cf1");
+    EXPECT_EQ(cf->max_versions, 3U);
+    EXPECT_EQ(cf->ttl_us, 0);
+    cf = compact_schema.Find("c");
+    ASSERT_TRUE(cf != NULL);
+    EXPECT_EQ(cf->ttl_us, 10000000LL);
+    cf = compact_schema.Find("cf");
+    ASSERT_TRUE(cf != NULL);
+    EXPECT_EQ(cf->max_versions, 2U);
+    EXPECT_EQ(cf->ttl_us, -1000000LL);
+
+    EXPECT_TRUE(compact_schema.Find("") == NULL);
+    EXPECT_TRUE(compact_schema.Find("b") == NULL);
+    EXPECT_TRUE(compact_schema.Find("cf0") == NULL);
+    EXPECT_TRUE(compact_schema.Find("cf10") == NULL);
+    EXPECT_TRUE(compact_schema.Find("d") == NULL);
+}
+
+TEST_F(DefaultCompactStrategyTest, Drop) {
+    AddColumnFamily("cf", 2, 0);
+    AddColumnFamily("ttl", 1, 100);
+    DefaultCompactStrategyFactory factory(schema_);
+    std::unique_ptr<DefaultCompactStrategy> strategy(factory.NewInstance());
+
+    int64_t now = get_micros();
+    // out-of-range versions
+    EXPECT_FALSE(strategy->Drop(Key("row", "cf", "q", 3), 1, ""));
+    EXPECT_FALSE(strategy->Drop(Key("row", "cf", "q", 2), 1, ""));
+    EXPECT_TRUE(strategy->Drop(Key("row", "cf", "q", 1), 1, ""));
+    // unknown column family
+    EXPECT_TRUE(strategy->Drop(Key("row", "unknown", "q", 1), 1, ""));
+    // expired values
+    EXPECT_FALSE(strategy->Drop(Key("row", "ttl", "q1", now), 1, ""));
+    EXPECT_TRUE(strategy->Drop(Key("row", "ttl", "q2", now - 200000000LL), 1, ""));
+
+    bool del_tag = false;
+    int64_t ttl_tag = -1;
+    ASSERT_TRUE(strategy->CheckTag(Key("row", "ttl", "q", 5), &del_tag, &ttl_tag));
+    EXPECT_FALSE(del_tag);
+    EXPECT_EQ(ttl_tag, 5 + 100000000LL);
+    ASSERT_TRUE(strategy->CheckTag(Key("row", "cf", "q", 5, leveldb::TKT_DEL_QUALIFIER),
+                                   &del_tag, &ttl_tag));
+    EXPECT_TRUE(del_tag);
+    EXPECT_EQ(ttl_tag, -1);
+}
+
+TEST_F(DefaultCompactStrategyTest, ExpireByScanTime) {
+    AddColumnFamily("ttl", 1, 1);
+    DefaultCompactStrategyFactory factory(schema_);
+    std::unique_ptr<DefaultCompactStrategy> strategy(factory.NewInstance());
+
+    // a long scan expires the values by the time of each row
+    int64_t ts = get_micros() - 800000;
+    EXPECT_FALSE(strategy->ScanDrop(Key("row1", "ttl", "q", ts), 1));
+    usleep(300000);
+    EXPECT_TRUE(strategy->ScanDrop(Key("row2", "ttl", "q", ts), 1));
+}
+
+TEST_F(DefaultCompactStrategyTest, CellMeta) {
+    AddColumnFamily("cf", 1, 0);
+    AddColumnFamily("ttl", 1, 100);
+    DefaultCompactStrategyFactory factory(schema_);
+    std::unique_ptr<DefaultCompactStrategy> strategy(factory.NewInstance());
+
+    leveldb::Slice family;
+    int64_t ts = -1;
+    leveldb::TeraKeyType type = leveldb::TKT_VALUE;
+    // the family refers to the key
+    std::string key = Key("row", "ttl", "q", 5, leveldb::TKT_ADD);
+    ASSERT_TRUE(strategy->ExtractCell(key, &family, &ts, &type));
+    EXPECT_EQ(family.ToString(), "ttl");
+    EXPECT_EQ(ts, 5);
+    EXPECT_EQ(type, leveldb::TKT_ADD);
+
+    // expire by the ttl of the current schema
+    EXPECT_EQ(strategy->FamilyExpireTime("ttl", 5, 1000), 5 + 100000000LL);
+    EXPECT_EQ(strategy->FamilyExpireTime("cf", 5, 1000), 0);
+    EXPECT_EQ(strategy->FamilyExpireTime("unknown", 5, 1000), 1000);
+}
+
+TEST_F(DefaultCompactStrategyTest, SetArg) {
+    AddColumnFamily("cf", 1, 0);
+    DefaultCompactStrategyFactory factory(schema_);
+    std::unique_ptr<DefaultCompactStrategy> old_strategy(factory.NewInstance());
+
+    AddColumnFamily("new_cf", 1, 0);
+    factory.SetArg(&schema_);
+    std::unique_ptr<DefaultCompactStrategy> strategy(factory.NewInstance());
+    EXPECT_FALSE(strategy->Drop(Key("row", "new_cf", "q", 1), 1, ""));
+    // a running compaction keeps its schema
+    EXPECT_TRUE(old_strategy->Drop(Key("row", "new_cf", "q", 1), 1, ""));
+}
+
+// keys/s of Drop() on a stream of sorted keys of a table with many column
+// families, compared with looking up the column family in a std::map by a
+// copied name and reading the ttl from the protobuf
+TEST_F(DefaultCompactStrategyTest, DropBench) {
+    const int kCfNum = 16;
+    std::map<std::string, int32_t> cf_indexs;
+    for (int i = 0; i < kCfNum; ++i) {
+        std::string name = "column_family_" + std::to_string(i);
+        AddColumnFamily(name, 2, 86400);
+        cf_indexs[name] = i;
+    }
+    std::vector<std::string> keys;
+    int64_t now = get_micros();
+    for (int row = 0; row < 100; ++row) {
+        for (std::map<std::string, int32_t>::iterator it = cf_indexs.begin();
+             it != cf_indexs.end(); ++it) {
+            for (int qual = 0; qual < 4; ++qual) {
+                for (int version = 0; version < 3; ++version) {
+                    keys.push_back(Key("row" + std::to_string(1000 + row), it->first,
+                                       "qualifier" + std::to_string(qual), now - version));
+                }
+            }
+        }
+    }
+
+    const int kRounds = 20;
+    DefaultCompactStrategyFactory factory(schema_);
+    int64_t dropped = 0;
+    int64_t start_us = get_micros();
+    for (int round = 0; round < kRounds; ++round) {
+        std::unique_ptr<DefaultCompactStrategy> strategy(factory.NewInstance());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            dropped += strategy->Drop(keys[i], 1, "") ? 1 : 0;
+        }
+    }
+    int64_t drop_us = get_micros() - start_us + 1;
+    // 1 of the 3 versions of each cell is out of range
+    EXPECT_EQ(dropped, static_cast<int64_t>(keys.size()) * kRounds / 3);
+
+    int64_t found = 0;
+    start_us = get_micros();
+    for (int round = 0; round < kRounds; ++round) {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            leveldb::Slice row, col, qual;
+            int64_t ts = -1;
+            leveldb::TeraKeyType type;
+            key_operator_->ExtractTeraKey(keys[i], &row, &col, &qual, &ts, &type);
+            std::map<std::string, int32_t>::const_iterator it = cf_indexs.find(col.ToString());
+            if (it != cf_indexs.end() &&
+                ts + schema_.column_families(it->second).time_to_live() * 1000000LL > now) {
+                ++found;
+            }
+        }
+    }
+    int64_t map_us = get_micros() - start_us + 1;
+    EXPECT_EQ(found, static_cast<int64_t>(keys.size()) * kRounds);
+
+    int64_t num = keys.size() * kRounds;
+    std::cout << "column families: " << kCfNum
+              << ", Drop: " << num * 1000000 / drop_us << " keys/s"
+              << ", std::map lookup only: " << num * 1000000 / map_us << " keys/s"
+              << std::endl;
+}
+
+} // namespace io
+} // namespace tera
+
+int main(int argc, char** argv) {
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
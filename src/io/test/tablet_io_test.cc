@@ -654,6 +654,31 @@ static void TabletUnloadWapper(TabletIO* tablet) {
     tablet->Unload();
 }
 
+TEST_F(TabletIOTest, LoadSplitKey) {
+    TabletIO tablet("", "", working_dir + "load_split_key");
+    std::string split_key;
+    EXPECT_FALSE(tablet.GetLoadSplitKey(&split_key));
+
+    // uniform accesses on [0000, 0100), and a hot row 0080
+    for (int32_t i = 0; i < 10000; i++) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%04d", i % 100);
+        tablet.GetKeySampler().Sample(buf);
+        tablet.GetKeySampler().Sample("0080");
+    }
+    EXPECT_TRUE(tablet.GetLoadSplitKey(&split_key));
+    EXPECT_EQ(split_key, "0080");
+
+    // the hot row is the first row of the tablet
+    TabletIO hot_tablet("0080", "", working_dir + "load_split_key_hot");
+    for (int32_t i = 0; i < 10000; i++) {
+        hot_tablet.GetKeySampler().Sample("0080", 10);
+        hot_tablet.GetKeySampler().Sample("0090");
+    }
+    EXPECT_TRUE(hot_tablet.GetLoadSplitKey(&split_key));
+    EXPECT_EQ(split_key, std::string("0080") + '\0');
+}
+
 TEST_F(TabletIOTest, TryUnload) {
     std::string tablet_path = working_dir + "unload_try";
     std::string key_start = "";
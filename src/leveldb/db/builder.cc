@@ -17,6 +17,7 @@
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
+#include "leveldb/rate_limiter.h"
 #include "leveldb/compact_strategy.h"
 
 namespace leveldb {
@@ -32,6 +33,7 @@ Status BuildTable(const std::string& dbname,
   Status s;
   int64_t del_num = 0;         // statistic: delete tag's percentage in sst
   std::vector<int64_t> ttls; // use for calculate timeout percentage
+  CellMetaBuilder cell_meta;
   int64_t entries = 0;
   meta->file_size = 0;
   iter->SeekToFirst();
@@ -43,6 +45,9 @@ Status BuildTable(const std::string& dbname,
     if (!s.ok()) {
       return s;
     }
+    if (options.rate_limiter != NULL) {
+      file = NewRateLimitedFile(file, options.rate_limiter, kIOFlush);
+    }
     SequenceNumber snapshot = smallest_snapshot;
 
     CompactStrategy* compact_strategy = NULL;
@@ -53,10 +58,15 @@ Status BuildTable(const std::string& dbname,
 
     ParsedInternalKey ikey;
     TableBuilder* builder = new TableBuilder(options, file);
+    if (options.dump_compress_threads > 0) {
+      builder->EnableParallelCompression(options.dump_compress_threads);
+    }
     meta->smallest.DecodeFrom(iter->key());
     for (;iter->Valid();) {
       Slice key = iter->key();  // no-length-prefix-key
-      assert(ParseInternalKey(key, &ikey));
+      bool parsed = ParseInternalKey(key, &ikey);
+      assert(parsed);
+      (void)parsed;
 
       bool has_atom_merged = false;
       if (ikey.type == kTypeValue && compact_strategy && ikey.sequence <= snapshot) {
@@ -74,6 +84,9 @@ Status BuildTable(const std::string& dbname,
           if (has_atom_merged) {
             meta->largest.DecodeFrom(Slice(merged_key));
             builder->Add(Slice(merged_key), Slice(merged_value));
+            ParsedInternalKey merged_ikey;
+            ParseInternalKey(merged_key, &merged_ikey);
+            cell_meta.Add(compact_strategy, merged_ikey, false, -1);
           }
         }
       }
@@ -91,6 +104,7 @@ Status BuildTable(const std::string& dbname,
           //    dbname_.c_str(), ttl);
           ttls.push_back(ttl);
         }
+        cell_meta.Add(compact_strategy, ikey, del_tag, ttl);
 
         meta->largest.DecodeFrom(key);
         builder->Add(key, iter->value());
@@ -121,8 +135,10 @@ Status BuildTable(const std::string& dbname,
         meta->del_percentage = del_num * 100 / entries; /* delete tag percentage */
         meta->check_ttl_ts = ((ttls.size() > 0) && (idx < ttls.size())) ? ttls[idx] : 0; /* sst's check ttl's time */
         meta->ttl_percentage = ((ttls.size() > 0) && (idx < ttls.size())) ? idx * 100 / ttls.size() : 0; /* ttl tag percentage */
+        meta->expire_ts = (ttls.size() == static_cast<size_t>(entries)) ? ttls.back() : 0; /* all entries expired */
+        cell_meta.Finish(meta);
         Log(options.info_log, "[%s] (mem dump) AddFile, number #%u, entries %ld, del_nr %lu"
-                             ", ttl_nr %lu, del_p %lu, ttl_check_ts %lu, ttl_p %lu\n",
+                             ", ttl_nr %lu, del_p %lu, ttl_check_ts %lu, ttl_p %lu, expire_ts %lu\n",
           dbname.c_str(),
           (unsigned int) meta->number,
           entries,
@@ -130,7 +146,8 @@ Status BuildTable(const std::string& dbname,
           ttls.size(),
           meta->del_percentage,
           meta->check_ttl_ts,
-          meta->ttl_percentage);
+          meta->ttl_percentage,
+          meta->expire_ts);
       }
     } else {
       builder->Abandon();
@@ -14,6 +14,7 @@
 #include "leveldb/cache.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/rate_limiter.h"
 #include "leveldb/write_batch.h"
 #include "port/port.h"
 #include "util/crc32c.h"
@@ -33,6 +34,7 @@
 //      overwrite     -- overwrite N values in random key order in async mode
 //      fillsync      -- write N/100 values in random key order in sync mode
 //      fill100K      -- write N/1000 100K values in random order in async mode
+//      logstreams    -- fillsync with 1, 2 and 4 log streams, use --threads>1
 //      deleteseq     -- delete N keys in sequential order
 //      deleterandom  -- delete N keys in random order
 //      readseq       -- read N times sequentially
@@ -40,6 +42,9 @@
 //      readrandom    -- read N times in random order
 //      readmissing   -- read N missing keys in random order
 //      readhot       -- read N times in random order from 1% section of DB
+//      readwhilecompacting -- 1 writer keeps dumping and compacting, N threads
+//                      do random reads, and the latency percentiles of the
+//                      reads are reported
 //      seekrandom    -- N random seeks
 //      crc32c        -- repeated crc32c of 4K of data
 //      acquireload   -- load N*1000 times
@@ -110,12 +115,20 @@ static const char* FLAGS_env = NULL;
 // disable WAL
 static bool FLAGS_disable_wal = false;
 
+// number of write-ahead log streams
+static int FLAGS_log_stream_num = 1;
+
 // compress
 static int FLAGS_compress = 0;
 
 // block size
 static int FLAGS_block_size = 4096;
 
+// Write rate of the memtable dumps and of the compactions in MB/s,
+// 0 for unlimited.
+static int FLAGS_flush_rate_mb = 0;
+static int FLAGS_compaction_rate_mb = 0;
+
 // Bloom filter bits per key.
 // Negative means use default settings.
 static int FLAGS_bloom_bits = -1;
@@ -194,6 +207,8 @@ class Stats {
   int64_t bytes_;
   double last_op_finish_;
   Histogram hist_;
+  Histogram latency_;
+  int64_t latency_num_;
   std::string message_;
 
  public:
@@ -204,6 +219,8 @@ class Stats {
     next_report_ = 100;
     last_op_finish_ = start_;
     hist_.Clear();
+    latency_.Clear();
+    latency_num_ = 0;
     done_ = 0;
     bytes_ = 0;
     seconds_ = 0;
@@ -213,6 +230,8 @@ class Stats {
 
   void Merge(const Stats& other) {
     hist_.Merge(other.hist_);
+    latency_.Merge(other.latency_);
+    latency_num_ += other.latency_num_;
     done_ += other.done_;
     bytes_ += other.bytes_;
     seconds_ += other.seconds_;
@@ -262,6 +281,13 @@ class Stats {
     bytes_ += n;
   }
 
+  // Latency of the ops counted by the percentiles of the report,
+  // regardless of --histogram.
+  void AddLatency(double micros) {
+    latency_.Add(micros);
+    latency_num_++;
+  }
+
   void Report(const Slice& name) {
     // Pretend at least one op was done in case we are running a benchmark
     // that does not call FinishedSingleOp().
@@ -278,6 +304,14 @@ class Stats {
       extra = rate;
     }
     AppendWithSpace(&extra, message_);
+    if (latency_num_ > 0) {
+      char latency[200];
+      snprintf(latency, sizeof(latency),
+               "(latency us p50: %.1f, p99: %.1f, p99.9: %.1f)",
+               latency_.Percentile(50), latency_.Percentile(99),
+               latency_.Percentile(99.9));
+      AppendWithSpace(&extra, latency);
+    }
 
     fprintf(stdout, "%-12s : %11.3f micros/op;%s%s\n",
             name.ToString().c_str(),
@@ -330,12 +364,14 @@ class Benchmark {
  private:
   Cache* cache_;
   const FilterPolicy* filter_policy_;
+  RateLimiter* rate_limiter_;
   DB* db_;
   int num_;
   int value_size_;
   int entries_per_batch_;
   WriteOptions write_options_;
   int reads_;
+  uint32_t log_stream_num_;
   int heap_counter_;
 
   void PrintHeader() {
@@ -418,11 +454,13 @@ class Benchmark {
     filter_policy_(FLAGS_bloom_bits >= 0
                    ? NewBloomFilterPolicy(FLAGS_bloom_bits)
                    : NULL),
+    rate_limiter_(NULL),
     db_(NULL),
     num_(FLAGS_num),
     value_size_(FLAGS_value_size),
     entries_per_batch_(1),
     reads_(FLAGS_reads < 0 ? FLAGS_num : FLAGS_reads),
+    log_stream_num_(FLAGS_log_stream_num),
     heap_counter_(0) {
     std::vector<std::string> files;
     Env::Default()->GetChildren(FLAGS_db, &files);
@@ -440,6 +478,7 @@ class Benchmark {
     delete db_;
     delete cache_;
     delete filter_policy_;
+    delete rate_limiter_;
   }
 
   void Run() {
@@ -488,6 +527,8 @@ class Benchmark {
         num_ /= 1000;
         write_options_.sync = true;
         method = &Benchmark::WriteRandom;
+      } else if (name == Slice("logstreams")) {
+        LogStreams(num_threads);
       } else if (name == Slice("fill100K")) {
         //fresh_db = true;
         num_ /= 1000;
@@ -515,6 +556,9 @@ class Benchmark {
       } else if (name == Slice("readwhilewriting")) {
         num_threads++;  // Add extra thread for writing
         method = &Benchmark::ReadWhileWriting;
+      } else if (name == Slice("readwhilecompacting")) {
+        num_threads++;  // Add extra thread for writing
+        method = &Benchmark::ReadWhileCompacting;
       } else if (name == Slice("compact")) {
         method = &Benchmark::Compact;
       } else if (name == Slice("crc32c")) {
@@ -844,6 +888,17 @@ class Benchmark {
     options.filter_policy = filter_policy_;
     options.block_size = FLAGS_block_size;
     options.compression = NumToCompressionType(FLAGS_compress);
+    options.log_stream_num = log_stream_num_;
+    if (FLAGS_flush_rate_mb > 0 || FLAGS_compaction_rate_mb > 0) {
+      RateLimiterOptions limiter_options;
+      limiter_options.max_bytes_per_sec[kIOFlush] = FLAGS_flush_rate_mb * 1048576LL;
+      limiter_options.max_bytes_per_sec[kIOL0Compaction] = FLAGS_compaction_rate_mb * 1048576LL;
+      limiter_options.max_bytes_per_sec[kIODeepCompaction] = FLAGS_compaction_rate_mb * 1048576LL;
+      if (rate_limiter_ == NULL) {
+        rate_limiter_ = NewRateLimiter(Env::Default(), limiter_options);
+      }
+      options.rate_limiter = rate_limiter_;
+    }
     Status log_s = Env::Default()->NewLogger("./ldblog", &options.info_log);
     if (FLAGS_env == NULL) {
         // do nothing
@@ -863,6 +918,26 @@ class Benchmark {
     }
   }
 
+  // Run fillsync on a fresh db with 1, 2 and 4 log streams.
+  // The db is left open with the last stream number.
+  void LogStreams(int num_threads) {
+    static const uint32_t kStreamNums[] = {1, 2, 4};
+    for (size_t i = 0; i < sizeof(kStreamNums) / sizeof(kStreamNums[0]); i++) {
+      delete db_;
+      db_ = NULL;
+      DestroyDB(FLAGS_db, Options());
+      log_stream_num_ = kStreamNums[i];
+      Open();
+
+      num_ = FLAGS_num / 1000;
+      write_options_.sync = true;
+      char name[32];
+      snprintf(name, sizeof(name), "logstreams%u", kStreamNums[i]);
+      RunBenchmark(num_threads, name, &Benchmark::WriteRandom);
+    }
+    log_stream_num_ = FLAGS_log_stream_num;
+  }
+
   void WriteSeq(ThreadState* thread) {
     DoWrite(thread, true);
   }
@@ -1022,30 +1097,61 @@ class Benchmark {
     if (thread->tid > 0) {
       ReadRandom(thread);
     } else {
-      // Special thread that keeps writing until other threads are done.
-      RandomGenerator gen;
-      while (true) {
-        {
-          MutexLock l(&thread->shared->mu);
-          if (thread->shared->num_done + 1 >= thread->shared->num_initialized) {
-            // Other threads have finished
-            break;
-          }
-        }
+      KeepWriting(thread);
+    }
+  }
 
-        const int k = thread->rand.Next() % FLAGS_num;
-        char key[100];
-        snprintf(key, sizeof(key), "%016d", k);
-        Status s = db_->Put(write_options_, key, gen.Generate(value_size_));
-        if (!s.ok()) {
-          fprintf(stderr, "put error: %s\n", s.ToString().c_str());
-          exit(1);
+  // The writer overwrites the whole key space again and again, so that
+  // the memtable dumps and compactions never stop while the readers run.
+  // Compare the read latency percentiles with --compaction_rate_mb.
+  void ReadWhileCompacting(ThreadState* thread) {
+    if (thread->tid == 0) {
+      KeepWriting(thread);
+      return;
+    }
+    ReadOptions options;
+    std::string value;
+    int found = 0;
+    for (int i = 0; i < reads_; i++) {
+      char key[100];
+      const int k = thread->rand.Next() % FLAGS_num;
+      snprintf(key, sizeof(key), "%016d", k);
+      uint64_t start = Env::Default()->NowMicros();
+      if (db_->Get(options, key, &value).ok()) {
+        found++;
+      }
+      thread->stats.AddLatency(Env::Default()->NowMicros() - start);
+      thread->stats.FinishedSingleOp();
+    }
+    char msg[100];
+    snprintf(msg, sizeof(msg), "(%d of %d found)", found, reads_);
+    thread->stats.AddMessage(msg);
+  }
+
+  // Special thread that keeps writing until other threads are done.
+  void KeepWriting(ThreadState* thread) {
+    RandomGenerator gen;
+    while (true) {
+      {
+        MutexLock l(&thread->shared->mu);
+        if (thread->shared->num_done + 1 >= thread->shared->num_initialized) {
+          // Other threads have finished
+          break;
         }
       }
 
-      // Do not count any of the preceding work/delay in stats.
-      thread->stats.Start();
+      const int k = thread->rand.Next() % FLAGS_num;
+      char key[100];
+      snprintf(key, sizeof(key), "%016d", k);
+      Status s = db_->Put(write_options_, key, gen.Generate(value_size_));
+      if (!s.ok()) {
+        fprintf(stderr, "put error: %s\n", s.ToString().c_str());
+        exit(1);
+      }
     }
+
+    // Do not count any of the preceding work/delay in stats.
+    thread->stats.Start();
   }
 
   void Compact(ThreadState* thread) {
@@ -1105,6 +1211,9 @@ int main(int argc, char** argv) {
     } else if (sscanf(argv[i], "--disable_wal=%d%c", &n, &junk) == 1 &&
                (n == 0 || n == 1)) {
       FLAGS_disable_wal = n;
+    } else if (sscanf(argv[i], "--log_stream_num=%d%c", &n, &junk) == 1 &&
+               n > 0) {
+      FLAGS_log_stream_num = n;
     } else if (sscanf(argv[i], "--compress=%d%c", &n, &junk) == 1 &&
                (n == 0 || n == 1 || n == 2 || n == 3)) {
       FLAGS_compress = n;
@@ -1126,6 +1235,10 @@ int main(int argc, char** argv) {
       FLAGS_open_files = n;
     } else if (sscanf(argv[i], "--block_size=%d%c", &n, &junk) == 1) {
       FLAGS_block_size = n;
+    } else if (sscanf(argv[i], "--flush_rate_mb=%d%c", &n, &junk) == 1) {
+      FLAGS_flush_rate_mb = n;
+    } else if (sscanf(argv[i], "--compaction_rate_mb=%d%c", &n, &junk) == 1) {
+      FLAGS_compaction_rate_mb = n;
     } else if (strncmp(argv[i], "--env=", 6) == 0) {
       FLAGS_env = argv[i] + 6;
     } else if (strncmp(argv[i], "--db=", 5) == 0) {
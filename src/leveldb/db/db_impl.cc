@@ -31,6 +31,7 @@
 #include "leveldb/db.h"
 #include "leveldb/compact_strategy.h"
 #include "leveldb/env.h"
+#include "leveldb/rate_limiter.h"
 #include "leveldb/status.h"
 #include "leveldb/table.h"
 #include "leveldb/table_builder.h"
@@ -79,6 +80,7 @@ struct DBImpl::CompactionState {
     uint64_t file_size;
     int64_t del_num;         // statistic: delete tag's percentage in sst
     std::vector<int64_t> ttls; // use for calculate timeout percentage
+    CellMetaBuilder cell_meta;
     int64_t entries;
     InternalKey smallest, largest;
 
@@ -178,7 +180,9 @@ DBImpl::DBImpl(const Options& options, const std::string& dbname)
       manual_compaction_(NULL),
       consecutive_compaction_errors_(0),
       flush_on_destroy_(false),
-      need_newdb_txn_(false) {
+      need_newdb_txn_(false),
+      flush_bytes_(0),
+      compaction_bytes_(0) {
   mem_->Ref();
   has_imm_.Release_Store(NULL);
 
@@ -199,6 +203,25 @@ bool DBImpl::ShouldForceUnloadOnError() {
     return bg_error_.IsIOPermissionDenied();
 }
 
+void DBImpl::KeepTableCacheOnClose() {
+  MutexLock l(&mutex_);
+  versions_->KeepTableCache();
+}
+
+void DBImpl::AddHotTableFiles(uint32_t lg_id, uint64_t* budget,
+                              std::vector<HotTableFile>* files) {
+  mutex_.Lock();
+  Version* current = versions_->current();
+  current->Ref();
+  mutex_.Unlock();
+
+  current->GetHotTableFiles(lg_id, budget, files);
+
+  mutex_.Lock();
+  current->Unref();
+  mutex_.Unlock();
+}
+
 Status DBImpl::Shutdown1() {
   assert(state_ == kOpened);
   state_ = kShutdown1;
@@ -393,6 +416,7 @@ void DBImpl::DeleteObsoleteFiles() {
         case kCurrentFile:
         case kDBLockFile:
         case kInfoLogFile:
+        case kSharedLogMarkerFile:
           keep = true;
           break;
         case kUnknown:
@@ -761,10 +785,12 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
   if (s.ok() && meta.file_size > 0) {
     const Slice min_user_key = meta.smallest.user_key();
     const Slice max_user_key = meta.largest.user_key();
-    if (base != NULL && options_.drop_base_level_del_in_compaction) {
+    if (base != NULL && options_.drop_base_level_del_in_compaction &&
+        options_.compaction_style == kLeveledCompaction) {
       level = base->PickLevelForMemTableOutput(min_user_key, max_user_key);
     }
     edit->AddFile(level, meta);
+    flush_bytes_ += meta.file_size;
   }
   VersionSet::LevelSummaryStorage tmp;
   Log(options_.info_log, "[%s] Level-0 table #%u: dump-level %d, %lld (+ %lld ) bytes %s, %s",
@@ -1191,22 +1217,27 @@ Status DBImpl::BackgroundCompaction(bool* sched_idle) {
     // Nothing to do
     *sched_idle = true;
   } else if (!is_manual && c->IsTrivialMove()) {
-    // Move file to next level
-    assert(c->num_input_files(0) == 1);
-    FileMetaData* f = c->input(0, 0);
-    c->edit()->DeleteFile(c->level(), *f);
-    c->edit()->AddFile(c->output_level(), *f);
+    // Move file to next level, or a whole run in tiered compaction
+    for (int i = 0; i < c->num_input_files(0); i++) {
+      FileMetaData* f = c->input(0, i);
+      c->edit()->DeleteFile(c->level(), *f);
+      c->edit()->AddFile(c->output_level(), *f);
+    }
     status = versions_->LogAndApply(c->edit(), &mutex_);
     VersionSet::LevelSummaryStorage tmp;
-    Log(options_.info_log, "[%s] Moved #%08u, #%u to level-%d %lld bytes %s: %s\n",
+    FileMetaData* f = c->input(0, 0);
+    Log(options_.info_log, "[%s] Moved #%08u, #%u (%d files) to level-%d %lld bytes %s: %s\n",
         dbname_.c_str(),
         static_cast<uint32_t>(f->number >> 32 & 0x7fffffff),  //tablet number
         static_cast<uint32_t>(f->number & 0xffffffff),        //sst number
+        c->num_input_files(0),
         c->output_level(),
         static_cast<unsigned long long>(f->file_size),
         status.ToString().c_str(),
         versions_->LevelSummary(&tmp));
     versions_->ReleaseCompaction(c, status);
+  } else if (c->IsExpiredDrop()) {
+    status = DropExpiredFiles(c);
   } else {
     status = ParallelCompaction(c);
   }
@@ -1329,6 +1360,9 @@ Status DBImpl::ParallelCompaction(Compaction* c) {
       dbname_.c_str(), versions_->LevelSummary(&tmp), status.ToString().c_str());
   stats.micros = env_->NowMicros() - start_micros;
   stats_[compact->compaction->output_level()].Add(stats);
+  if (status.ok()) {
+    compaction_bytes_ += stats.bytes_written;
+  }
 
   for (size_t i = 0; i < compaction_vec.size(); i++) {
     CompactionState* compaction = compaction_state_vec[i];
@@ -1387,6 +1421,11 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
   // Make the output file
   std::string fname = TableFileName(dbname_, file_number);
   Status s = env_->NewWritableFile(fname, &compact->outfile, EnvOptions(options_));
+  if (s.ok() && options_.rate_limiter != NULL) {
+    IOPriority pri = (compact->compaction->level() == 0) ? kIOL0Compaction
+                                                         : kIODeepCompaction;
+    compact->outfile = NewRateLimitedFile(compact->outfile, options_.rate_limiter, pri);
+  }
   if (s.ok()) {
     compact->builder = new TableBuilder(options_, compact->outfile);
   }
@@ -1452,6 +1491,69 @@ Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
   return s;
 }
 
+Status DBImpl::DropExpiredFiles(Compaction* c) {
+  mutex_.AssertHeld();
+  // The metadata may be stale, e.g. the ttl of a column family was
+  // increased after the file was written.  A file with cell metadata is
+  // checked against the current schema without reading it, the entries of
+  // other files are checked again, which is still much cheaper than
+  // rewriting them.
+  CompactStrategy* compact_strategy = NULL;
+  if (options_.compact_strategy_factory) {
+    compact_strategy = options_.compact_strategy_factory->NewInstance();
+  }
+  FileMetaData* f = c->input(0, 0);
+  const int64_t now = env_->NowMicros();
+  uint64_t expire_ts = 0;
+  uint64_t entries = 0;
+  Status status;
+  if (compact_strategy != NULL && f->has_cell_meta) {
+    expire_ts = f->families.empty() ? 0 : 1;
+    for (size_t i = 0; i < f->families.size() && expire_ts > 0; i++) {
+      const FamilyMeta& family = f->families[i];
+      int64_t ts = (family.expire_ts == 0) ? 0 :
+          compact_strategy->FamilyExpireTime(family.name, family.max_ts, family.expire_ts);
+      expire_ts = (ts <= 0) ? 0 : std::max(expire_ts, static_cast<uint64_t>(ts));
+    }
+  } else if (compact_strategy != NULL) {
+    Iterator* input = versions_->MakeInputIterator(c);
+    mutex_.Unlock();
+    bool expired = true;
+    ParsedInternalKey ikey;
+    for (input->SeekToFirst(); expired && input->Valid(); input->Next()) {
+      bool del_tag = false;
+      int64_t ttl = -1;
+      expired = ParseInternalKey(input->key(), &ikey) &&
+                ikey.type == kTypeValue &&
+                compact_strategy->CheckTag(ikey.user_key, &del_tag, &ttl) &&
+                !del_tag && ttl > 0 && ttl <= now;
+      entries++;
+    }
+    status = input->status();
+    delete input;
+    mutex_.Lock();
+    expire_ts = expired ? f->expire_ts : 0;
+  }
+  delete compact_strategy;
+
+  const bool expired = (expire_ts > 0 && expire_ts <= static_cast<uint64_t>(now));
+  if (status.ok() && expired) {
+    c->AddInputDeletions(c->edit());
+    status = versions_->LogAndApply(c->edit(), &mutex_);
+  } else if (status.ok()) {
+    // pick it again when it expires under the current schema, 0 for never
+    f->expire_ts = expire_ts;
+  }
+  VersionSet::LevelSummaryStorage tmp;
+  Log(options_.info_log,
+      "[%s] Drop expired file #%lu at level %d, %s after %lu entries, expire_ts %lu, %s: %s\n",
+      dbname_.c_str(), f->number & 0xffffffff, c->level(),
+      expired ? "dropped" : "kept", entries, expire_ts,
+      status.ToString().c_str(), versions_->LevelSummary(&tmp));
+  versions_->ReleaseCompaction(c, status);
+  return status;
+}
+
 Status DBImpl::InstallCompactionResults(CompactionState* compact) {
   mutex_.AssertHeld();
   Log(options_.info_log,  "[%s] Compacted %d@%d + %d@%d files => %lld bytes",
@@ -1472,23 +1574,30 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
 
     std::sort(out.ttls.begin(), out.ttls.end());
     uint32_t idx = out.ttls.size() * options_.ttl_percentage / 100 ;
-    compact->compaction->edit()->AddFile(
-      compact->compaction->output_level(), BuildFullFileNumber(dbname_, out.number),
-      out.file_size, out.smallest, out.largest,
-      out.del_num * 100 / out.entries /* delete tag percentage */,
-      ((out.ttls.size() > 0) && (idx < out.ttls.size())) ? out.ttls[idx] : 0 /* sst's check ttl's time */,
-      ((out.ttls.size() > 0) && (idx < out.ttls.size())) ? idx * 100 / out.ttls.size() : 0 /* delete tag percentage */);
+    FileMetaData f;
+    f.number = BuildFullFileNumber(dbname_, out.number);
+    f.file_size = out.file_size;
+    f.data_size = f.file_size;
+    f.smallest = out.smallest;
+    f.largest = out.largest;
+    f.del_percentage = out.del_num * 100 / out.entries; /* delete tag percentage */
+    f.check_ttl_ts = ((out.ttls.size() > 0) && (idx < out.ttls.size())) ? out.ttls[idx] : 0; /* sst's check ttl's time */
+    f.ttl_percentage = ((out.ttls.size() > 0) && (idx < out.ttls.size())) ? idx * 100 / out.ttls.size() : 0; /* ttl tag percentage */
+    f.expire_ts = (out.ttls.size() == static_cast<size_t>(out.entries)) ? out.ttls.back() : 0; /* all entries expired */
+    out.cell_meta.Finish(&f);
+    compact->compaction->edit()->AddFile(compact->compaction->output_level(), f);
       Log(options_.info_log, "[%s] AddFile, level %d, number #%lu, entries %ld, del_nr %lu"
-                             ", ttl_nr %lu, del_p %lu, ttl_check_ts %lu, ttl_p %lu\n",
+                             ", ttl_nr %lu, del_p %lu, ttl_check_ts %lu, ttl_p %lu, expire_ts %lu\n",
           dbname_.c_str(),
           compact->compaction->output_level(),
           out.number,
           out.entries,
           out.del_num,
           out.ttls.size(),
-          out.del_num * 100 / out.entries,
-          ((out.ttls.size() > 0) && (idx < out.ttls.size())) ? out.ttls[idx] : 0,
-          ((out.ttls.size() > 0) && (idx < out.ttls.size())) ? idx * 100 / out.ttls.size() : 0);
+          f.del_percentage,
+          f.check_ttl_ts,
+          f.ttl_percentage,
+          f.expire_ts);
   }
   return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
 }
@@ -1636,6 +1745,10 @@ void DBImpl::HandleCompactionWork(CompactionState* compact,
         if (has_atom_merged) {
             Slice newValue(merged_value);
             compact->builder->Add(Slice(merged_key), newValue);
+            ParsedInternalKey merged_ikey;
+            ParseInternalKey(merged_key, &merged_ikey);
+            compact->current_output()->cell_meta.Add(compact_strategy, merged_ikey,
+                                                     false, -1);
         }
       }
 
@@ -1653,6 +1766,7 @@ void DBImpl::HandleCompactionWork(CompactionState* compact,
           //    dbname_.c_str(), ttl);
           compact->current_output()->ttls.push_back(ttl);
         }
+        compact->current_output()->cell_meta.Add(compact_strategy, ikey, del_tag, ttl);
         compact->builder->Add(key, input->value());
       }
       // Close output file if it is big enough
@@ -1726,7 +1840,13 @@ Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
   if (imm != NULL) {
     child_iterators.emplace_back(imm->NewIterator());
   }
-  current->AddIterators(options, &child_iterators);
+  ReadOptions file_options = options;
+  if (mem->MayMergeCells() || (imm != NULL && imm->MayMergeCells())) {
+    // atomic operations in memtables may be merged into cells of
+    // files older than cell_ts_start
+    file_options.cell_ts_start = INT64_MIN;
+  }
+  current->AddIterators(file_options, &child_iterators);
   Iterator* internal_iter =
       NewMergingIterator(&internal_comparator_,
                          &child_iterators[0],
@@ -2189,6 +2309,13 @@ void DBImpl::GetApproximateSizes(uint64_t* size, std::vector<uint64_t>* lgsize)
   }
 }
 
+void DBImpl::GetWriteBytes(std::vector<uint64_t>* flush_bytes,
+                           std::vector<uint64_t>* compaction_bytes) {
+  MutexLock l(&mutex_);
+  flush_bytes->push_back(flush_bytes_);
+  compaction_bytes->push_back(compaction_bytes_);
+}
+
 uint64_t DBImpl::GetLastSequence(bool is_locked) {
   if (is_locked) {
     mutex_.Lock();
@@ -2210,7 +2337,8 @@ uint64_t DBImpl::GetLastSequence(bool is_locked) {
 MemTable* DBImpl::NewMemTable() const {
     if (!options_.use_memtable_on_leveldb) {
         return new MemTable(internal_comparator_,
-                  options_.enable_strategy_when_get ? options_.compact_strategy_factory : NULL);
+                  options_.enable_strategy_when_get ? options_.compact_strategy_factory : NULL,
+                  options_.compact_strategy_factory);
     } else {
         Logger* info_log = NULL;
         //Logger* info_log = options_.info_log;
@@ -54,8 +54,13 @@ class DBImpl : public DB {
   // lgsize not used in db_impl, just for interface compatable
   virtual void GetApproximateSizes(uint64_t* size, std::vector<uint64_t>* lgsize = NULL);
   virtual void CompactRange(const Slice* begin, const Slice* end, int lg_no = -1);
+  virtual void GetWriteBytes(std::vector<uint64_t>* flush_bytes,
+                             std::vector<uint64_t>* compaction_bytes);
 
   virtual bool ShouldForceUnloadOnError();
+  virtual void KeepTableCacheOnClose();
+  void AddHotTableFiles(uint32_t lg_id, uint64_t* budget,
+                        std::vector<HotTableFile>* files);
 
   void AddBoundLogSize(uint64_t size);
 
@@ -119,6 +124,11 @@ class DBImpl : public DB {
   // parallel compaction
   Status ParallelCompaction(Compaction* c);
 
+  // Delete the input file of an expire-triggered compaction if all its
+  // entries are expired according to the compact strategy, decided from
+  // the cell metadata of the file if it has any.
+  Status DropExpiredFiles(Compaction* c);
+
   CompactStrategy* NewCompactStrategy(CompactionState* compact);
 
   void HandleCompactionWork(CompactionState* compact,
@@ -269,6 +279,11 @@ class DBImpl : public DB {
   };
   CompactionStats stats_[config::kNumLevels];
 
+  // Bytes of the sst files written by memtable dumps and by compactions,
+  // whose ratio is the write amplification.
+  uint64_t flush_bytes_;
+  uint64_t compaction_bytes_;
+
   // No copying allowed
   DBImpl(const DBImpl&);
   void operator=(const DBImpl&);
@@ -17,6 +17,8 @@
 #include "db/log_reader.h"
 #include "db/memtable.h"
 #include "db/memtable.h"
+#include "db/shared_log.h"
+#include "db/table_cache.h"
 #include "db/version_edit.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
@@ -45,6 +47,164 @@ struct DBTable::RecordWriter {
       cv(mu) {}
 };
 
+struct DBTable::LogStream {
+  uint32_t id;
+  WritableFile* logfile;
+  log::AsyncWriter* log;
+  // number of the log file being written
+  uint64_t log_number;
+  size_t current_log_size;
+  bool force_switch_log;
+  // a write group is being logged through this stream
+  bool busy;
+  WriteBatch* tmp_batch;
+
+  explicit LogStream(uint32_t stream_id)
+    : id(stream_id),
+      logfile(NULL),
+      log(NULL),
+      log_number(0),
+      current_log_size(0),
+      force_switch_log(false),
+      busy(false),
+      tmp_batch(new WriteBatch) {}
+
+  ~LogStream() {
+    delete tmp_batch;
+  }
+};
+
+namespace {
+
+struct LogReporter : public log::Reader::Reporter {
+  Env* env;
+  Logger* info_log;
+  const char* fname;
+  Status* status;  // NULL if options_.paranoid_checks==false
+  virtual void Corruption(size_t bytes, const Status& s) {
+    Log(info_log, "%s%s: dropping %d bytes; %s",
+        (this->status == NULL ? "(ignoring error) " : ""),
+        fname, static_cast<int>(bytes), s.ToString().c_str());
+    if (this->status != NULL && this->status->ok()) *this->status = s;
+  }
+};
+
+// Read all records of one log stream, file by file.
+// If two log files have overlap sequence id, ignore records
+// from old log.
+class LogStreamReader {
+public:
+  LogStreamReader(const Options& options, const std::string& dbname,
+                  uint32_t stream_id, const std::vector<uint64_t>& log_numbers)
+    : options_(options), dbname_(dbname), stream_id_(stream_id),
+      log_numbers_(log_numbers), next_file_(0), recover_limit_(0),
+      file_(NULL), reader_(NULL), first_seq_(0), last_seq_(0) {
+    reporter_.env = options_.env;
+    reporter_.info_log = options_.info_log;
+    reporter_.fname = fname_.c_str();
+    reporter_.status = (options_.paranoid_checks ? &status_ : NULL);
+  }
+
+  ~LogStreamReader() {
+    CloseFile();
+  }
+
+  // Move to the next valid record, return false at the end of stream
+  // or on error.
+  bool Next() {
+    while (status_.ok()) {
+      if (reader_ == NULL && !OpenNextFile()) {
+        return false;
+      }
+      if (!reader_->ReadRecord(&record_, &scratch_)) {
+        CloseFile();
+        continue;
+      }
+      if (!status_.ok()) {
+        break;
+      }
+      if (record_.size() < 12) {
+        reporter_.Corruption(record_.size(),
+            Status::Corruption("log record too small"));
+        continue;
+      }
+      WriteBatchInternal::SetContents(&batch_, record_);
+      first_seq_ = WriteBatchInternal::Sequence(&batch_);
+      last_seq_ = first_seq_ + WriteBatchInternal::Count(&batch_) - 1;
+      if (last_seq_ >= recover_limit_) {
+        Log(options_.info_log, "[%s] exceed limit %lu, ignore %lu ~ %lu",
+            dbname_.c_str(), recover_limit_, first_seq_, last_seq_);
+        continue;
+      }
+      return true;
+    }
+    return false;
+  }
+
+  WriteBatch* batch() { return &batch_; }
+  uint64_t first_seq() const { return first_seq_; }
+  uint32_t stream_id() const { return stream_id_; }
+  const Status& status() const { return status_; }
+
+private:
+  bool OpenNextFile() {
+    while (next_file_ < log_numbers_.size()) {
+      uint64_t log_number = log_numbers_[next_file_];
+      recover_limit_ = kMaxSequenceNumber;
+      if (next_file_ < log_numbers_.size() - 1) {
+        recover_limit_ = log_numbers_[next_file_ + 1];
+      }
+      ++next_file_;
+
+      fname_ = LogStreamFileName(dbname_, log_number, stream_id_);
+      reporter_.fname = fname_.c_str();
+      Status s = options_.env->NewSequentialFile(fname_, &file_);
+      if (!s.ok()) {
+        file_ = NULL;
+        if (options_.paranoid_checks) {
+          status_ = s;
+          return false;
+        }
+        Log(options_.info_log, "[%s] Ignoring error %s",
+            dbname_.c_str(), s.ToString().c_str());
+        continue;
+      }
+      reader_ = new log::Reader(file_, &reporter_, true/*checksum*/,
+                                0/*initial_offset*/);
+      Log(options_.info_log, "[%s] Recovering log #%lx of stream %u, sequence limit %lu",
+          dbname_.c_str(), log_number, stream_id_, recover_limit_);
+      return true;
+    }
+    return false;
+  }
+
+  void CloseFile() {
+    delete reader_;
+    reader_ = NULL;
+    delete file_;
+    file_ = NULL;
+  }
+
+  const Options& options_;
+  const std::string& dbname_;
+  const uint32_t stream_id_;
+  const std::vector<uint64_t>& log_numbers_;
+  size_t next_file_;
+  uint64_t recover_limit_;
+  std::string fname_;
+  LogReporter reporter_;
+  Status status_;
+  SequentialFile* file_;
+  log::Reader* reader_;
+  std::string scratch_;
+  Slice record_;
+  WriteBatch batch_;
+  uint64_t first_seq_;
+  uint64_t last_seq_;
+};
+
+}  // namespace
+
 Options InitDefaultOptions(const Options& options, const std::string& dbname) {
   Options opt = options;
   Status s = opt.env->CreateDir(dbname);
@@ -87,6 +247,7 @@ Options InitOptionsLG(const Options& options, uint32_t lg_id) {
   LG_info* lg_info = it->second;
   if (lg_info->env) {
     opt.env = lg_info->env;
+    opt.rate_limiter = NULL;
   }
   if (lg_info->block_cache) {
     opt.block_cache = lg_info->block_cache;
@@ -104,6 +265,10 @@ Options InitOptionsLG(const Options& options, uint32_t lg_id) {
   opt.posix_write_buffer_size = lg_info->posix_write_buffer_size;
   opt.table_builder_batch_write = lg_info->table_builder_batch_write;
   opt.table_builder_batch_size = lg_info->table_builder_batch_size;
+  opt.use_tera_block_encoding = lg_info->use_tera_block_encoding;
+  opt.use_mmap_read = lg_info->use_mmap_read;
+  opt.compaction_style = lg_info->compaction_style;
+  opt.tiered_size_ratio = lg_info->tiered_size_ratio;
   if (options.ignore_corruption_in_open_lg_list.find(lg_id) 
           != options.ignore_corruption_in_open_lg_list.end()) {
     opt.ignore_corruption_in_open = true;
@@ -111,6 +276,29 @@ Options InitOptionsLG(const Options& options, uint32_t lg_id) {
   return opt;
 }
 
+Status WarmUpDB(const Options& options, const std::string& dbname,
+                const std::vector<HotTableFile>& files, uint64_t* bytes) {
+  if (options.table_cache == NULL) {
+    return Status::InvalidArgument("warm up without shared table cache");
+  }
+  Status s;
+  for (size_t i = 0; i < files.size() && s.ok(); ++i) {
+    const HotTableFile& f = files[i];
+    Options lg_opt = InitOptionsLG(options, f.lg_id);
+    if (lg_opt.block_cache == NULL) {
+      return Status::InvalidArgument("warm up without block cache");
+    }
+    // tables copy the wrappers when they are opened, see TableCache
+    InternalKeyComparator icmp(lg_opt.comparator);
+    InternalFilterPolicy ipolicy(lg_opt.filter_policy);
+    lg_opt.comparator = &icmp;
+    lg_opt.filter_policy = (lg_opt.filter_policy != NULL) ? &ipolicy : NULL;
+    s = options.table_cache->Prefetch(&lg_opt, dbname + "/" + Uint64ToString(f.lg_id),
+                                      f.number, f.size, f.block_offsets, bytes);
+  }
+  return s;
+}
+
 DBTable::DBTable(const Options& options, const std::string& dbname)
   : state_(kNotOpen), shutting_down_(NULL), shutdown1_finished_(NULL), bg_cv_(&mutex_),
     bg_cv_timer_(&mutex_), bg_cv_sleeper_(&mutex_),
@@ -119,9 +307,9 @@ DBTable::DBTable(const Options& options, const std::string& dbname)
     created_own_lg_list_(options_.exist_lg_list != options.exist_lg_list),
     created_own_info_log_(options_.info_log != options.info_log),
     created_own_compact_strategy_(options_.compact_strategy_factory != options.compact_strategy_factory),
-    commit_snapshot_(kMaxSequenceNumber), logfile_(NULL), log_(NULL), force_switch_log_(false),
-    last_sequence_(0), current_log_size_(0),
-    tmp_batch_(new WriteBatch),
+    commit_snapshot_(kMaxSequenceNumber), log_stream_cv_(&mutex_),
+    last_sequence_(0), log_sequence_(0),
+    next_apply_ticket_(0), apply_ticket_(0), apply_cv_(&mutex_),
     bg_schedule_gc_(false), bg_schedule_gc_id_(0),
     bg_schedule_gc_score_(0), force_clean_log_seq_(0) {
 }
@@ -180,18 +368,26 @@ Status DBTable::Shutdown2() {
   }
 
   Log(options_.info_log, "[%s] stop async log", dbname_.c_str());
-  if (log_) {
-    log_->Stop(false);
+  for (uint32_t i = 0; i < log_streams_.size(); ++i) {
+    if (log_streams_[i]->log) {
+      log_streams_[i]->log->Stop(false);
+      log_streams_[i]->log = NULL;
+    }
   }
 
   if (s.ok() && options_.dump_mem_on_shutdown) {
     Log(options_.info_log, "[%s] gather all log file", dbname_.c_str());
-    std::vector<uint64_t> logfiles;
+    LogFileMap logfiles;
     s = GatherLogFile(0, &logfiles);
     if (s.ok()) {
       Log(options_.info_log, "[%s] delete all log file", dbname_.c_str());
       s = DeleteLogFile(logfiles);
     }
+    if (s.ok() && options_.shared_log) {
+      Log(options_.info_log, "[%s] release shared log", dbname_.c_str());
+      env_->DeleteFile(SharedLogMarkerFileName(dbname_));
+      options_.shared_log->Unregister(dbname_);
+    }
   }
 
   Log(options_.info_log, "[%s] shutdown2 done", dbname_.c_str());
@@ -226,7 +422,9 @@ DBTable::~DBTable() {
   if (created_own_info_log_) {
     delete options_.info_log;
   }
-  delete tmp_batch_;
+  for (uint32_t i = 0; i < log_streams_.size(); ++i) {
+    delete log_streams_[i];
+  }
   if (db_lock_) {
     env_->UnlockFile(db_lock_);
   }
@@ -296,25 +494,20 @@ Status DBTable::Init() {
 
   Log(options_.info_log, "[%s] start GatherLogFile", dbname_.c_str());
   // recover log files
-  std::vector<uint64_t> logfiles;
+  LogFileMap logfiles;
   s = GatherLogFile(min_log_sequence + 1, &logfiles);
   if (s.ok()) {
-    for (uint32_t i = 0; i < logfiles.size(); ++i) {
-      // If two log files have overlap sequence id, ignore records
-      // from old log.
-      uint64_t recover_limit = kMaxSequenceNumber;
-      if (i < logfiles.size() - 1) {
-        recover_limit = logfiles[i + 1];
-      }
-      s = RecoverLogFile(logfiles[i], recover_limit, &lg_edits);
-      if (!s.ok()) {
-        Log(options_.info_log, "[%s] Fail to RecoverLogFile %ld",
-            dbname_.c_str(), logfiles[i]);
-      }
+    s = RecoverLogFiles(logfiles, &lg_edits);
+    if (!s.ok()) {
+      Log(options_.info_log, "[%s] Fail to RecoverLogFiles: %s",
+          dbname_.c_str(), s.ToString().c_str());
     }
   } else {
     Log(options_.info_log, "[%s] Fail to GatherLogFile", dbname_.c_str());
   }
+  if (s.ok()) {
+    s = RecoverSharedLog(&lg_edits);
+  }
 
   Log(options_.info_log, "[%s] start RecoverLogToLevel0Table", dbname_.c_str());
   std::set<uint32_t>::iterator it = options_.exist_lg_list->begin();
@@ -329,14 +522,29 @@ Status DBTable::Init() {
     Log(options_.info_log, "[%s] start DeleteLogFile", dbname_.c_str());
     s = DeleteLogFile(logfiles);
   }
+  if (s.ok()) {
+    s = ResetSharedLogMarker();
+  }
 
-  if (s.ok() && !options_.disable_wal) {
-    std::string log_file_name = LogHexFileName(dbname_, last_sequence_ + 1);
-    s = options_.env->NewWritableFile(log_file_name, &logfile_, EnvOptions(options_));
+  if (s.ok()) {
+    log_sequence_ = last_sequence_;
+    // shared log recovery replays records in log order and skips the
+    // ones at or below the recovered sequence, so keep them in order
+    uint32_t stream_num = options_.shared_log ? 1 : std::max(options_.log_stream_num, 1U);
+    for (uint32_t i = 0; i < stream_num; ++i) {
+      log_streams_.push_back(new LogStream(i));
+    }
+  }
+  bool own_log = !options_.disable_wal && options_.shared_log == NULL;
+  for (uint32_t i = 0; s.ok() && own_log && i < log_streams_.size(); ++i) {
+    LogStream* stream = log_streams_[i];
+    std::string log_file_name = LogStreamFileName(dbname_, last_sequence_ + 1, i);
+    s = options_.env->NewWritableFile(log_file_name, &stream->logfile, EnvOptions(options_));
     if (s.ok()) {
       //Log(options_.info_log, "[%s] open logfile %s",
       //    dbname_.c_str(), log_file_name.c_str());
-      log_ = new log::AsyncWriter(logfile_, options_.log_async_mode);
+      stream->log = new log::AsyncWriter(stream->logfile, options_.log_async_mode);
+      stream->log_number = last_sequence_ + 1;
     } else {
       Log(options_.info_log, "[%s] fail to open logfile %s",
           dbname_.c_str(), log_file_name.c_str());
@@ -354,6 +562,9 @@ Status DBTable::Init() {
   }
 
   if (s.ok()) {
+    if (options_.shared_log) {
+      options_.shared_log->Register(dbname_, last_sequence_);
+    }
     state_ = kOpened;
     Log(options_.info_log, "[%s] custom compact strategy: %s, flush trigger %lu",
         dbname_.c_str(), options_.compact_strategy_factory->Name(),
@@ -367,6 +578,13 @@ Status DBTable::Init() {
       delete lg_list_[i];
     }
     lg_list_.clear();
+    for (uint32_t i = 0; i < log_streams_.size(); ++i) {
+      if (log_streams_[i]->log) {
+        log_streams_[i]->log->Stop(false);
+      }
+      delete log_streams_[i];
+    }
+    log_streams_.clear();
   }
   return s;
 }
@@ -412,6 +630,8 @@ Status DBTable::Write(const WriteOptions& options, WriteBatch* my_batch) {
   w.batch = my_batch;
   w.sync = options.sync;
   w.done = false;
+  WriteTrace* trace = options.trace;
+  uint64_t trace_us = trace ? env_->NowMicros() : 0;
 
   MutexLock l(&mutex_);
   writers_.push_back(&w);
@@ -419,96 +639,100 @@ Status DBTable::Write(const WriteOptions& options, WriteBatch* my_batch) {
     w.cv.Wait();
   }
   if (w.done) {
+    if (trace) {
+      trace->wait_us = env_->NowMicros() - trace_us;
+    }
     return w.status;
   }
 
+  // The group holds its log stream until it is applied, so with a single
+  // stream write groups are still handled one by one.
+  LogStream* stream = NULL;
+  while ((stream = PickIdleLogStream()) == NULL) {
+    log_stream_cv_.Wait();
+  }
+  stream->busy = true;
+  if (trace) {
+    uint64_t now_us = env_->NowMicros();
+    trace->wait_us = now_us - trace_us;
+    trace_us = now_us;
+  }
+
   // DB with fatal error is unwritable.
   Status s = fatal_error_;
   if (IsShutdown1Finished()) {
     s = Status::ShutdownInProgress(dbname_ + ": fail to write on waiting shutdown2"); 
   }
 
+  bool write_log = !options_.disable_wal && !options.disable_wal;
   RecordWriter* last_writer = &w;
   WriteBatch* updates = NULL;
   if (s.ok()) {
-    updates = GroupWriteBatch(&last_writer);
-    WriteBatchInternal::SetSequence(updates, last_sequence_ + 1);
+    updates = GroupWriteBatch(stream->tmp_batch, &last_writer);
   }
 
-  if (s.ok() && !options_.disable_wal && !options.disable_wal) {
-    if (force_switch_log_ || current_log_size_ > options_.log_file_size) {
+  if (s.ok() && write_log && options_.shared_log) {
+    // logs of the tablet are gone with the shared log, only
+    // clean up garbage as often as a log would be switched
+    if (stream->current_log_size > options_.log_file_size) {
+      stream->current_log_size = 0;
+      ScheduleGarbageClean(kDeleteLogScore);
+    }
+  } else if (s.ok() && write_log) {
+    if (stream->force_switch_log || stream->current_log_size > options_.log_file_size) {
+      uint64_t log_number = log_sequence_ + 1;
       mutex_.Unlock();
-      if (SwitchLog(false) == 2) {
+      if (SwitchLog(stream, false, log_number) == 2) {
         s = Status::IOError(dbname_ + ": fail to open log: ", s.ToString());
       } else {
-        force_switch_log_ = false;
+        stream->force_switch_log = false;
       }
       mutex_.Lock();
     }
   }
 
+  // Sequence this group, then hand the writer queue over to the next
+  // group, which may log through another stream in the meantime.
+  uint64_t first_seq = log_sequence_ + 1;
+  if (updates) {
+    WriteBatchInternal::SetSequence(updates, first_seq);
+    log_sequence_ += WriteBatchInternal::Count(updates);
+  }
+  uint64_t apply_ticket = next_apply_ticket_++;
+  std::vector<RecordWriter*> group;
+  while (true) {
+    RecordWriter* ready = writers_.front();
+    writers_.pop_front();
+    if (ready != &w) {
+      group.push_back(ready);
+    }
+    if (ready == last_writer) break;
+  }
+  if (!writers_.empty()) {
+    writers_.front()->cv.Signal();
+  }
+
   // dump to log
-  if (s.ok() && !options_.disable_wal && !options.disable_wal) {
+  if (s.ok() && write_log) {
     mutex_.Unlock();
-
-    Slice slice = WriteBatchInternal::Contents(updates);
-    uint32_t wait_sec = options_.write_log_time_out;
-    for (; ; wait_sec <<= 1) {
-      // write a record into log
-      log_->AddRecord(slice);
-      s = log_->WaitDone(wait_sec);
-      if (s.IsTimeOut()) {
-        Log(options_.info_log, "[%s] AddRecord time out, current log size: %lu, "
-            "record size: %lu, wait_sec: %u",
-            dbname_.c_str(), current_log_size_, slice.size(), wait_sec);
-        int ret = SwitchLog(true);
-        if (ret == 0) {
-          continue;
-        } else if (ret == 1) {
-          s = log_->WaitDone(-1);
-          if (!s.ok()) {
-            break;
-          }
-        } else {
-          s = Status::IOError(dbname_ + ": fail to open log: ", s.ToString());
-          break;
-        }
-      }
-      // do sync if needed
-      if (!s.ok()) {
-        s = Status::IOError(dbname_ + ": fail to write log: ", s.ToString());
-        force_switch_log_ = true;
-      } else {
-        log_->Sync(options.sync);
-        s = log_->WaitDone(wait_sec);
-        if (s.IsTimeOut()) {
-          Log(options_.info_log, "[%s] Sync time out %lu",
-              dbname_.c_str(), current_log_size_);
-          int ret = SwitchLog(true);
-          if (ret == 0) {
-            continue;
-          } else if (ret == 1) {
-            s = log_->WaitDone(-1);
-            if (s.ok()) {
-              continue;
-            }
-          } else {
-            s = Status::IOError(dbname_ + ": fail to open log: ", s.ToString());
-            break;
-          }
-        }
-        if (!s.ok()) {
-          s = Status::IOError(dbname_ + ": fail to sync log: ", s.ToString());
-          force_switch_log_ = true;
-        }
-      }
-      break;
-    }
+    s = WriteLogRecord(stream, WriteBatchInternal::Contents(updates),
+                       first_seq, options.sync);
     mutex_.Lock();
     if (s.IsIOPermissionDenied()) {
         fatal_error_ = s;
     }
   }
+  if (trace) {
+    uint64_t now_us = env_->NowMicros();
+    trace->log_us = now_us - trace_us;
+    trace_us = now_us;
+  }
+
+  // Groups logged through different streams may finish out of order,
+  // but they are applied to memtables in sequence order.
+  while (apply_ticket_ != apply_ticket) {
+    apply_cv_.Wait();
+  }
   if (s.ok()) {
     std::vector<WriteBatch*> lg_updates;
     lg_updates.resize(lg_list_.size());
@@ -541,12 +765,21 @@ Status DBTable::Write(const WriteOptions& options, WriteBatch* my_batch) {
     }
     mutex_.Lock();
     if (s.ok()) {
+      // the tablet keeps the oldest shared log files alive, count them
+      // as a full bound log to dump the memtables
+      uint64_t bound_log_size = static_cast<uint64_t>(updates->DataSize());
+      if (options_.shared_log && options_.shared_log->NeedFlush(dbname_)) {
+        bound_log_size = std::max(bound_log_size, options_.flush_triggered_log_size);
+      }
       for (uint32_t i = 0; i < lg_list_.size(); ++i) {
-        lg_list_[i]->AddBoundLogSize(updates->DataSize());
+        lg_list_[i]->AddBoundLogSize(bound_log_size);
       }
     } else {
         fatal_error_ = s;
     }
+    if (trace) {
+      trace->memtable_us = env_->NowMicros() - trace_us;
+    }
 
     // Commit updates
     if (s.ok() && lg_list_.size() > 1) {
@@ -569,31 +802,104 @@ Status DBTable::Write(const WriteOptions& options, WriteBatch* my_batch) {
   // Update last_sequence
   if (updates) {
     last_sequence_ += WriteBatchInternal::Count(updates);
-    current_log_size_ += WriteBatchInternal::ByteSize(updates);
+    stream->current_log_size += WriteBatchInternal::ByteSize(updates);
   }
-  if (updates == tmp_batch_) tmp_batch_->Clear();
+  if (updates == stream->tmp_batch) stream->tmp_batch->Clear();
 
-  while (true) {
-    RecordWriter* ready = writers_.front();
-    writers_.pop_front();
-    if (ready != &w) {
-      ready->status = s;
-      ready->done = true;
-      ready->cv.Signal();
-    }
-    if (ready == last_writer) break;
+  ++apply_ticket_;
+  apply_cv_.SignalAll();
+  stream->busy = false;
+  log_stream_cv_.Signal();
+
+  for (uint32_t i = 0; i < group.size(); ++i) {
+    group[i]->status = s;
+    group[i]->done = true;
+    group[i]->cv.Signal();
   }
+  return s;
+}
 
-  if (!writers_.empty()) {
-    writers_.front()->cv.Signal();
+// REQUIRES: mutex_ is held
+DBTable::LogStream* DBTable::PickIdleLogStream() {
+  mutex_.AssertHeld();
+  for (uint32_t i = 0; i < log_streams_.size(); ++i) {
+    if (!log_streams_[i]->busy) {
+      return log_streams_[i];
+    }
   }
+  return NULL;
+}
 
+// REQUIRES: mutex_ is NOT held
+// REQUIRES: "stream" is held by the calling write group
+Status DBTable::WriteLogRecord(LogStream* stream, const Slice& slice,
+                               uint64_t first_seq, bool sync) {
+  if (options_.shared_log) {
+    return options_.shared_log->AddRecord(dbname_, slice, sync);
+  }
+  Status s;
+  uint32_t wait_sec = options_.write_log_time_out;
+  for (; ; wait_sec <<= 1) {
+    // write a record into log
+    stream->log->AddRecord(slice);
+    s = stream->log->WaitDone(wait_sec);
+    if (s.IsTimeOut()) {
+      Log(options_.info_log, "[%s] AddRecord time out, log stream: %u, "
+          "current log size: %lu, record size: %lu, wait_sec: %u",
+          dbname_.c_str(), stream->id, stream->current_log_size,
+          slice.size(), wait_sec);
+      int ret = SwitchLog(stream, true, first_seq);
+      if (ret == 0) {
+        continue;
+      } else if (ret == 1) {
+        s = stream->log->WaitDone(-1);
+        if (!s.ok()) {
+          break;
+        }
+      } else {
+        s = Status::IOError(dbname_ + ": fail to open log: ", s.ToString());
+        break;
+      }
+    }
+    // do sync if needed
+    if (!s.ok()) {
+      s = Status::IOError(dbname_ + ": fail to write log: ", s.ToString());
+      stream->force_switch_log = true;
+    } else {
+      stream->log->Sync(sync);
+      s = stream->log->WaitDone(wait_sec);
+      if (s.IsTimeOut()) {
+        Log(options_.info_log, "[%s] Sync time out, log stream: %u, "
+            "current log size: %lu",
+            dbname_.c_str(), stream->id, stream->current_log_size);
+        int ret = SwitchLog(stream, true, first_seq);
+        if (ret == 0) {
+          continue;
+        } else if (ret == 1) {
+          s = stream->log->WaitDone(-1);
+          if (s.ok()) {
+            continue;
+          }
+        } else {
+          s = Status::IOError(dbname_ + ": fail to open log: ", s.ToString());
+          break;
+        }
+      }
+      if (!s.ok()) {
+        s = Status::IOError(dbname_ + ": fail to sync log: ", s.ToString());
+        stream->force_switch_log = true;
+      }
+    }
+    break;
+  }
   return s;
 }
 
 // REQUIRES: Writer list must be non-empty
 // REQUIRES: First writer must have a non-NULL batch
-WriteBatch* DBTable::GroupWriteBatch(RecordWriter** last_writer) {
+WriteBatch* DBTable::GroupWriteBatch(WriteBatch* tmp_batch,
+                                     RecordWriter** last_writer) {
+
   assert(!writers_.empty());
   RecordWriter* first = writers_.front();
   WriteBatch* result = first->batch;
@@ -629,7 +935,7 @@ WriteBatch* DBTable::GroupWriteBatch(RecordWriter** last_writer) {
       // Append to *reuslt
       if (result == first->batch) {
         // Switch to temporary batch instead of disturbing caller's batch
-        result = tmp_batch_;
+        result = tmp_batch;
         assert(WriteBatchInternal::Count(result) == 0);
         WriteBatchInternal::Append(result, first->batch);
       }
@@ -735,6 +1041,25 @@ bool DBTable::ShouldForceUnloadOnError() {
     return permission_error;
 }
 
+void DBTable::KeepTableCacheOnClose() {
+  for (uint32_t i = 0; i < lg_list_.size(); ++i) {
+    DBImpl* impl = lg_list_[i];
+    if (impl) {
+      impl->KeepTableCacheOnClose();
+    }
+  }
+}
+
+void DBTable::GetHotTableFiles(uint64_t max_bytes, std::vector<HotTableFile>* files) {
+  uint64_t budget = max_bytes;
+  for (uint32_t i = 0; i < lg_list_.size(); ++i) {
+    DBImpl* impl = lg_list_[i];
+    if (impl) {
+      impl->AddHotTableFiles(i, &budget, files);
+    }
+  }
+}
+
 const uint64_t DBTable::Rollback(uint64_t snapshot_seq, uint64_t rollback_point) {
   std::set<uint32_t>::iterator it = options_.exist_lg_list->begin();
   uint64_t rollback_seq = rollback_point == kMaxSequenceNumber ? last_sequence_ : rollback_point;;
@@ -813,6 +1138,14 @@ void DBTable::GetApproximateSizes(uint64_t* size, std::vector<uint64_t>* lgsize)
   }
 }
 
+void DBTable::GetWriteBytes(std::vector<uint64_t>* flush_bytes,
+                            std::vector<uint64_t>* compaction_bytes) {
+  std::set<uint32_t>::iterator it = options_.exist_lg_list->begin();
+  for (; it != options_.exist_lg_list->end(); ++it) {
+    lg_list_[*it]->GetWriteBytes(flush_bytes, compaction_bytes);
+  }
+}
+
 void DBTable::CompactRange(const Slice* begin, const Slice* end, int lg_no) {
   std::vector<LGCompactThread*> lg_threads;
   std::set<uint32_t>::iterator it = options_.exist_lg_list->begin();
@@ -831,163 +1164,235 @@ void DBTable::CompactRange(const Slice* begin, const Slice* end, int lg_no) {
 }
 
 // @begin_num:  the 1st record(sequence number) should be recover
-Status DBTable::GatherLogFile(uint64_t begin_num,
-                              std::vector<uint64_t>* logfiles) {
+Status DBTable::GatherLogFile(uint64_t begin_num, LogFileMap* logfiles) {
   std::vector<std::string> files;
   Status s = env_->GetChildren(dbname_, &files);
   if (!s.ok()) {
     Log(options_.info_log, "[%s] GatherLogFile fail", dbname_.c_str());
     return s;
   }
+  // stream id -> the last log file number below @begin_num
+  std::map<uint32_t, uint64_t> last_numbers;
   uint64_t number = 0;
-  uint64_t last_number = 0;
-  FileType type;
+  uint32_t stream_id = 0;
   for (uint32_t i = 0; i < files.size(); ++i) {
-    type = kUnknown;
-    number = 0;
-    if (ParseFileName(files[i], &number, &type)
-        && type == kLogFile
-        && number >= begin_num) {
-      logfiles->push_back(number);
-    } else if (type == kLogFile && number > last_number) {
-      last_number = number;
-    }
-  }
-  std::sort(logfiles->begin(), logfiles->end());
-  uint64_t first_log_num = logfiles->size() ? (*logfiles)[0] : 0;
-  /*
-   *                                             @begin_num(not in sst)
-   *       |-> records alredy be dumped to sst <-|->   not be dumped        <-|
-   *range: [start -------------------------------------------------------- end]
-   *case 1:       ^         ^                     ^
-   *              001.log   last_number.log       first_log_num.log
-   *
-   *case 2:       ^         ^
-   *              001.log   last_number.log
-   */
-  if ((last_number > 0 && first_log_num > begin_num)   // case 1
-      || (last_number > 0 && logfiles->size() == 0)) { // case 2
-    logfiles->push_back(last_number);
-    Log(options_.info_log, "[%s] add log file #%lu", dbname_.c_str(), last_number);
-  }
-  Log(options_.info_log, "[%s] begin_seq= %lu, first log num= %lu, last num=%lu, log count=%lu\n",
-      dbname_.c_str(), begin_num, first_log_num, last_number, logfiles->size());
-  std::sort(logfiles->begin(), logfiles->end());
+    if (!ParseLogStreamFileName(files[i], &number, &stream_id)) {
+      continue;
+    }
+    if (number >= begin_num) {
+      (*logfiles)[stream_id].push_back(number);
+    } else if (number > last_numbers[stream_id]) {
+      last_numbers[stream_id] = number;
+    }
+  }
+  std::map<uint32_t, uint64_t>::iterator it = last_numbers.begin();
+  for (; it != last_numbers.end(); ++it) {
+    std::vector<uint64_t>* stream_files = &(*logfiles)[it->first];
+    uint64_t last_number = it->second;
+    std::sort(stream_files->begin(), stream_files->end());
+    uint64_t first_log_num = stream_files->size() ? (*stream_files)[0] : 0;
+    /*
+     *                                             @begin_num(not in sst)
+     *       |-> records alredy be dumped to sst <-|->   not be dumped        <-|
+     *range: [start -------------------------------------------------------- end]
+     *case 1:       ^         ^                     ^
+     *              001.log   last_number.log       first_log_num.log
+     *
+     *case 2:       ^         ^
+     *              001.log   last_number.log
+     */
+    if ((last_number > 0 && first_log_num > begin_num)   // case 1
+        || (last_number > 0 && stream_files->size() == 0)) { // case 2
+      stream_files->push_back(last_number);
+      Log(options_.info_log, "[%s] add log file #%lu of stream %u",
+          dbname_.c_str(), last_number, it->first);
+    }
+  }
+  LogFileMap::iterator file_it = logfiles->begin();
+  for (; file_it != logfiles->end(); ++file_it) {
+    std::vector<uint64_t>* stream_files = &file_it->second;
+    std::sort(stream_files->begin(), stream_files->end());
+    Log(options_.info_log, "[%s] stream %u, begin_seq= %lu, first log num= %lu, "
+        "last num= %lu, log count=%lu\n",
+        dbname_.c_str(), file_it->first, begin_num, stream_files->front(),
+        stream_files->back(), stream_files->size());
+  }
   return s;
 }
 
-Status DBTable::RecoverLogFile(uint64_t log_number, uint64_t recover_limit,
-                               std::vector<VersionEdit*>* edit_list) {
-  struct LogReporter : public log::Reader::Reporter {
-    Env* env;
-    Logger* info_log;
-    const char* fname;
-    Status* status;  // NULL if options_.paranoid_checks==false
-    virtual void Corruption(size_t bytes, const Status& s) {
-      Log(info_log, "%s%s: dropping %d bytes; %s",
-          (this->status == NULL ? "(ignoring error) " : ""),
-          fname, static_cast<int>(bytes), s.ToString().c_str());
-      if (this->status != NULL && this->status->ok()) *this->status = s;
-    }
-  };
-
+// Replay the log files of all streams.  Each stream carries at most one
+// write group at a time, so its records are sorted by sequence, and
+// merging the streams by sequence number restores the write order.
+Status DBTable::RecoverLogFiles(const LogFileMap& logfiles,
+                                std::vector<VersionEdit*>* edit_list) {
   mutex_.AssertHeld();
 
-  // Open the log file
-  std::string fname = LogHexFileName(dbname_, log_number);
-  SequentialFile* file;
-  Status status = env_->NewSequentialFile(fname, &file);
-  if (!status.ok()) {
-    MaybeIgnoreError(&status);
-    return status;
-  }
-
-  // Create the log reader.
-  LogReporter reporter;
-  reporter.env = env_;
-  reporter.info_log = options_.info_log;
-  reporter.fname = fname.c_str();
-  reporter.status = (options_.paranoid_checks ? &status : NULL);
-  log::Reader reader(file, &reporter, true/*checksum*/,
-      0/*initial_offset*/);
-  Log(options_.info_log, "[%s] Recovering log #%lx, sequence limit %lu",
-      dbname_.c_str(), log_number, recover_limit);
-
-  // Read all the records and add to a memtable
-  std::string scratch;
-  Slice record;
-  WriteBatch batch;
-  while (reader.ReadRecord(&record, &scratch) && status.ok()) {
-    if (record.size() < 12) {
-      reporter.Corruption(record.size(),
-          Status::Corruption("log record too small"));
+  Status status;
+  std::vector<LogStreamReader*> readers;
+  LogFileMap::const_iterator it = logfiles.begin();
+  for (; it != logfiles.end(); ++it) {
+    LogStreamReader* reader =
+        new LogStreamReader(options_, dbname_, it->first, it->second);
+    if (reader->Next()) {
+      readers.push_back(reader);
       continue;
     }
-    WriteBatchInternal::SetContents(&batch, record);
-    uint64_t first_seq = WriteBatchInternal::Sequence(&batch);
-    uint64_t last_seq = first_seq + WriteBatchInternal::Count(&batch) - 1;
-    //Log(options_.info_log, "[%s] batch_seq= %lu, last_seq= %lu, count=%d",
-    //    dbname_.c_str(), batch_seq, last_sequence_, WriteBatchInternal::Count(&batch));
-    if (last_seq >= recover_limit) {
-      Log(options_.info_log, "[%s] exceed limit %lu, ignore %lu ~ %lu",
-          dbname_.c_str(), recover_limit, first_seq, last_seq);
-      continue;
+    if (!reader->status().ok()) {
+      Log(options_.info_log, "[%s] fail to recover log stream %u: %s",
+          dbname_.c_str(), reader->stream_id(), reader->status().ToString().c_str());
+      status = reader->status();
     }
+    delete reader;
+  }
 
-    if (last_seq > last_sequence_) {
-      last_sequence_ = last_seq;
+  while (!readers.empty()) {
+    size_t min_idx = 0;
+    for (size_t i = 1; i < readers.size(); ++i) {
+      if (readers[i]->first_seq() < readers[min_idx]->first_seq()) {
+        min_idx = i;
+      }
     }
-
-    std::vector<WriteBatch*> lg_updates;
-    lg_updates.resize(lg_list_.size());
-    std::fill(lg_updates.begin(), lg_updates.end(), (WriteBatch*)0);
-    bool created_new_wb = false;
-    if (lg_list_.size() > 1) {
-      status = batch.SeperateLocalityGroup(&lg_updates);
-      created_new_wb = true;
-      if (!status.ok()) {
-        return status;
+    LogStreamReader* reader = readers[min_idx];
+    Status s = RecoverWriteBatch(reader->batch(), edit_list);
+    if (!s.ok()) {
+      status = s;
+      break;
+    }
+    if (!reader->Next()) {
+      if (!reader->status().ok()) {
+        Log(options_.info_log, "[%s] fail to recover log stream %u: %s",
+            dbname_.c_str(), reader->stream_id(), reader->status().ToString().c_str());
+        status = reader->status();
       }
-    } else {
-      lg_updates[0] = (&batch);
+      delete reader;
+      readers.erase(readers.begin() + min_idx);
     }
+  }
+  for (size_t i = 0; i < readers.size(); ++i) {
+    delete readers[i];
+  }
+  return status;
+}
 
-    if (status.ok()) {
-      //TODO: should be multi-thread distributed
-      for (uint32_t i = 0; i < lg_updates.size(); ++i) {
-        if (lg_updates[i] == NULL) {
-          continue;
-        }
-        if (last_seq <= lg_list_[i]->GetLastSequence()) {
-          continue;
-        }
-        uint64_t first = WriteBatchInternal::Sequence(lg_updates[i]);
-        uint64_t last = first + WriteBatchInternal::Count(lg_updates[i]) - 1;
-        // Log(options_.info_log, "[%s] recover log batch first= %lu, last= %lu\n",
-        //     dbname_.c_str(), first, last);
-
-        Status lg_s = lg_list_[i]->RecoverInsertMem(lg_updates[i], (*edit_list)[i]);
-        if (!lg_s.ok()) {
-          Log(options_.info_log, "[%s] recover log fail batch first= %lu, last= %lu\n",
-              dbname_.c_str(), first, last);
-          status = lg_s;
-        }
+Status DBTable::RecoverWriteBatch(WriteBatch* batch,
+                                  std::vector<VersionEdit*>* edit_list) {
+  mutex_.AssertHeld();
+  Status status;
+  uint64_t first_seq = WriteBatchInternal::Sequence(batch);
+  uint64_t last_seq = first_seq + WriteBatchInternal::Count(batch) - 1;
+  //Log(options_.info_log, "[%s] batch_seq= %lu, last_seq= %lu, count=%d",
+  //    dbname_.c_str(), batch_seq, last_sequence_, WriteBatchInternal::Count(batch));
+  if (last_seq > last_sequence_) {
+    last_sequence_ = last_seq;
+  }
+
+  std::vector<WriteBatch*> lg_updates;
+  lg_updates.resize(lg_list_.size());
+  std::fill(lg_updates.begin(), lg_updates.end(), (WriteBatch*)0);
+  bool created_new_wb = false;
+  if (lg_list_.size() > 1) {
+    status = batch->SeperateLocalityGroup(&lg_updates);
+    created_new_wb = true;
+    if (!status.ok()) {
+      return status;
+    }
+  } else {
+    lg_updates[0] = batch;
+  }
+
+  if (status.ok()) {
+    //TODO: should be multi-thread distributed
+    for (uint32_t i = 0; i < lg_updates.size(); ++i) {
+      if (lg_updates[i] == NULL) {
+        continue;
+      }
+      if (last_seq <= lg_list_[i]->GetLastSequence()) {
+        continue;
+      }
+      uint64_t first = WriteBatchInternal::Sequence(lg_updates[i]);
+      uint64_t last = first + WriteBatchInternal::Count(lg_updates[i]) - 1;
+      // Log(options_.info_log, "[%s] recover log batch first= %lu, last= %lu\n",
+      //     dbname_.c_str(), first, last);
+
+      Status lg_s = lg_list_[i]->RecoverInsertMem(lg_updates[i], (*edit_list)[i]);
+      if (!lg_s.ok()) {
+        Log(options_.info_log, "[%s] recover log fail batch first= %lu, last= %lu\n",
+            dbname_.c_str(), first, last);
+        status = lg_s;
       }
     }
+  }
 
-    if (created_new_wb) {
-      for (uint32_t i = 0; i < lg_updates.size(); ++i) {
-        if (lg_updates[i] != NULL) {
-          delete lg_updates[i];
-          lg_updates[i] = NULL;
-        }
+  if (created_new_wb) {
+    for (uint32_t i = 0; i < lg_updates.size(); ++i) {
+      if (lg_updates[i] != NULL) {
+        delete lg_updates[i];
+        lg_updates[i] = NULL;
       }
     }
   }
-  delete file;
   return status;
 }
 
+// Replay the records a tablet left in a node-level shared log when it
+// was not unloaded cleanly.
+Status DBTable::RecoverSharedLog(std::vector<VersionEdit*>* edit_list) {
+  mutex_.AssertHeld();
+  std::string marker = SharedLogMarkerFileName(dbname_);
+  if (!env_->FileExists(marker).ok()) {
+    return Status::OK();
+  }
+  std::string log_dir;
+  Status s = ReadFileToString(env_, marker, &log_dir);
+  if (!s.ok()) {
+    Log(options_.info_log, "[%s] fail to read shared log marker: %s",
+        dbname_.c_str(), s.ToString().c_str());
+    return s;
+  }
+
+  SharedLog* live = NULL;
+  if (options_.shared_log && options_.shared_log->dir() == log_dir) {
+    live = options_.shared_log;
+  }
+  Log(options_.info_log, "[%s] recover shared log %s, last_seq= %lu",
+      dbname_.c_str(), log_dir.c_str(), last_sequence_);
+  SharedLogReader reader(env_, options_.info_log, log_dir, dbname_, live);
+  s = reader.Open();
+  WriteBatch batch;
+  Slice record;
+  uint64_t count = 0;
+  while (s.ok() && reader.Next(&record)) {
+    WriteBatchInternal::SetContents(&batch, record);
+    uint64_t last_seq = WriteBatchInternal::Sequence(&batch)
+        + WriteBatchInternal::Count(&batch) - 1;
+    // already recovered from the tablet's own log
+    if (last_seq <= last_sequence_) {
+      continue;
+    }
+    s = RecoverWriteBatch(&batch, edit_list);
+    ++count;
+  }
+  if (s.ok()) {
+    s = reader.status();
+  }
+  Log(options_.info_log, "[%s] recover shared log done, %lu batches, last_seq= %lu: %s",
+      dbname_.c_str(), count, last_sequence_, s.ToString().c_str());
+  return s;
+}
+
+// Everything recovered is dumped to sst by now, point the marker to the
+// shared log of this node, or drop it if the tablet logs by itself.
+Status DBTable::ResetSharedLogMarker() {
+  std::string marker = SharedLogMarkerFileName(dbname_);
+  if (options_.shared_log) {
+    return SetSharedLogMarker(env_, dbname_, options_.shared_log->dir());
+  }
+  if (env_->FileExists(marker).ok()) {
+    return env_->DeleteFile(marker);
+  }
+  return Status::OK();
+}
+
 void DBTable::MaybeIgnoreError(Status* s) const {
   if (s->ok() || options_.paranoid_checks) {
     // No change needed
@@ -998,25 +1403,29 @@ void DBTable::MaybeIgnoreError(Status* s) const {
   }
 }
 
-Status DBTable::DeleteLogFile(const std::vector<uint64_t>& log_numbers) {
+Status DBTable::DeleteLogFile(const LogFileMap& logfiles) {
   Status s;
-  for (uint32_t i = 0; i < log_numbers.size() && s.ok(); ++i) {
-    uint64_t log_number = log_numbers[i];
-    Log(options_.info_log, "[%s] Delete type=%s #%llu",
-        dbname_.c_str(), FileTypeToString(kLogFile),
-        static_cast<unsigned long long>(log_number));
-    std::string fname = LogHexFileName(dbname_, log_number);
-    s = env_->DeleteFile(fname);
-    // The last log file must be deleted before write a new log
-    // in case of record sequence_id overlap;
-    // Fail to delete other log files may be accepted.
-    if (i < log_numbers.size() - 1) {
-      MaybeIgnoreError(&s);
-    }
-    if (!s.ok()) {
-      Log(options_.info_log, "[%s] fail to delete logfile %llu: %s",
-          dbname_.c_str(), static_cast<unsigned long long>(log_number),
-          s.ToString().data());
+  LogFileMap::const_iterator it = logfiles.begin();
+  for (; it != logfiles.end() && s.ok(); ++it) {
+    const std::vector<uint64_t>& log_numbers = it->second;
+    for (uint32_t i = 0; i < log_numbers.size() && s.ok(); ++i) {
+      uint64_t log_number = log_numbers[i];
+      Log(options_.info_log, "[%s] Delete type=%s #%llu of stream %u",
+          dbname_.c_str(), FileTypeToString(kLogFile),
+          static_cast<unsigned long long>(log_number), it->first);
+      std::string fname = LogStreamFileName(dbname_, log_number, it->first);
+      s = env_->DeleteFile(fname);
+      // The last log file must be deleted before write a new log
+      // in case of record sequence_id overlap;
+      // Fail to delete other log files may be accepted.
+      if (i < log_numbers.size() - 1) {
+        MaybeIgnoreError(&s);
+      }
+      if (!s.ok()) {
+        Log(options_.info_log, "[%s] fail to delete logfile %llu: %s",
+            dbname_.c_str(), static_cast<unsigned long long>(log_number),
+            s.ToString().data());
+      }
     }
   }
   return s;
@@ -1025,32 +1434,37 @@ Status DBTable::DeleteLogFile(const std::vector<uint64_t>& log_numbers) {
 void DBTable::DeleteObsoleteFiles(uint64_t seq_no) {
   std::vector<std::string> filenames;
   env_->GetChildren(dbname_, &filenames);
-  std::sort(filenames.begin(), filenames.end());
+  // stream id -> <number, filename> of log files below seq_no
+  std::map<uint32_t, std::vector<std::pair<uint64_t, std::string> > > obsolete_logs;
   uint64_t number;
-  FileType type;
-  std::string last_file;
+  uint32_t stream_id;
   uint64_t keep_log_num = 0;
   uint64_t delete_log_num = 0;
   for (size_t i = 0; i < filenames.size(); ++i) {
-    bool deleted = false;
-    if (ParseFileName(filenames[i], &number, &type)
-        && type == kLogFile) {
-      if (number < seq_no) {
-        deleted = true;
-        delete_log_num++;
-      } else {
-        keep_log_num++;
-      }
+    if (!ParseLogStreamFileName(filenames[i], &number, &stream_id)) {
+      continue;
     }
-    if (deleted) {
-      Log(options_.info_log, "[%s] Delete type=%s #%llu",
-          dbname_.c_str(), FileTypeToString(type),
-          static_cast<unsigned long long>(number));
-      if (!last_file.empty()) {
-        //                 ArchiveFile(dbname_ + "/" + last_file);
-        env_->DeleteFile(dbname_ + "/" + last_file);
-      }
-      last_file = filenames[i];
+    if (number < seq_no) {
+      obsolete_logs[stream_id].push_back(std::make_pair(number, filenames[i]));
+    } else {
+      keep_log_num++;
+    }
+  }
+
+  std::map<uint32_t, std::vector<std::pair<uint64_t, std::string> > >::iterator it;
+  for (it = obsolete_logs.begin(); it != obsolete_logs.end(); ++it) {
+    std::vector<std::pair<uint64_t, std::string> >& logs = it->second;
+    std::sort(logs.begin(), logs.end());
+    // the last log below seq_no may still hold records not dumped yet
+    logs.pop_back();
+    keep_log_num++;
+    for (size_t i = 0; i < logs.size(); ++i) {
+      Log(options_.info_log, "[%s] Delete type=%s #%llu of stream %u",
+          dbname_.c_str(), FileTypeToString(kLogFile),
+          static_cast<unsigned long long>(logs[i].first), it->first);
+      //                 ArchiveFile(dbname_ + "/" + logs[i].second);
+      env_->DeleteFile(dbname_ + "/" + logs[i].second);
+      delete_log_num++;
     }
   }
   Log(options_.info_log, "[%s] delete obsolete log: %u, keep: %u, [seq < %llu]",
@@ -1182,7 +1596,9 @@ int64_t DBTable::TEST_MaxNextLevelOverlappingBytes() {
   return 0;
 }
 
-int DBTable::SwitchLog(bool blocked_switch) {
+// REQUIRES: mutex_ is NOT held
+// REQUIRES: "stream" is held by the calling write group
+int DBTable::SwitchLog(LogStream* stream, bool blocked_switch, uint64_t log_number) {
   {
     MutexLock l(&mutex_);
     if (fatal_error_.IsIOPermissionDenied() || IsShutdown1Finished()) {
@@ -1197,17 +1613,20 @@ int DBTable::SwitchLog(bool blocked_switch) {
   }
   if (!blocked_switch ||
       log::AsyncWriter::BlockLogNum() < options_.max_block_log_number) {
-    if (current_log_size_ == 0) {
-      last_sequence_++;
+    // log numbers of a stream must increase, even if nothing
+    // has been written since the last switch
+    if (log_number <= stream->log_number) {
+      log_number = stream->log_number + 1;
     }
     WritableFile* logfile = NULL;
-    std::string log_file_name = LogHexFileName(dbname_, last_sequence_ + 1);
+    std::string log_file_name = LogStreamFileName(dbname_, log_number, stream->id);
     Status s = env_->NewWritableFile(log_file_name, &logfile, EnvOptions(options_));
     if (s.ok()) {
-      log_->Stop(blocked_switch);
-      logfile_ = logfile;
-      log_ = new log::AsyncWriter(logfile, options_.log_async_mode);
-      current_log_size_ = 0;
+      stream->log->Stop(blocked_switch);
+      stream->logfile = logfile;
+      stream->log = new log::AsyncWriter(logfile, options_.log_async_mode);
+      stream->log_number = log_number;
+      stream->current_log_size = 0;
 
       // protect bg thread cv
       mutex_.Lock();
@@ -1217,7 +1636,8 @@ int DBTable::SwitchLog(bool blocked_switch) {
       if (blocked_switch) {
         // if we switched log because it was blocked
         log::AsyncWriter::BlockLogNumInc();
-        Log(options_.info_log, "[%s] SwitchLog", dbname_.c_str());
+        Log(options_.info_log, "[%s] SwitchLog, log stream: %u",
+            dbname_.c_str(), stream->id);
       }
       return 0;   // success
     } else if (s.IsIOPermissionDenied()) {
@@ -1295,6 +1715,9 @@ void DBTable::GarbageClean() {
     Log(options_.info_log, "[%s] delete obsolete file, seq_no below: %lu",
         dbname_.c_str(), min_last_seq);
     DeleteObsoleteFiles(min_last_seq);
+    if (options_.shared_log) {
+      options_.shared_log->SetPersistedSequence(dbname_, min_last_seq);
+    }
   }
 }
 
@@ -9,6 +9,7 @@
 #include <stdio.h>
 
 #include <deque>
+#include <map>
 #include <vector>
 #include <set>
 
@@ -120,6 +121,8 @@ public:
     // size: db size, include mem, imm, all sst files
     // lgsize: each lg size, include all storage
     virtual void GetApproximateSizes(uint64_t* size, std::vector<uint64_t>* lgsize);
+    virtual void GetWriteBytes(std::vector<uint64_t>* flush_bytes,
+                               std::vector<uint64_t>* compaction_bytes);
 
     // tera-specific
     // result: each level's total file size
@@ -150,6 +153,9 @@ public:
     // Strategy : Always return True begin shutdown1 finished. Else return False
     virtual bool IsShutdown1Finished() const;
 
+    virtual void KeepTableCacheOnClose();
+    virtual void GetHotTableFiles(uint64_t max_bytes, std::vector<HotTableFile>* files);
+
     // for unit test
     Status TEST_CompactMemTable();
     void TEST_CompactRange(int level, const Slice* begin, const Slice* end);
@@ -158,21 +164,31 @@ public:
 
 private:
     struct RecordWriter;
-    WriteBatch* GroupWriteBatch(RecordWriter** last_writer);
-
-    Status RecoverLogFile(uint64_t log_number, uint64_t recover_limit,
-                          std::vector<VersionEdit*>* edit_list);
+    struct LogStream;
+    // stream id -> sorted log file numbers of that stream
+    typedef std::map<uint32_t, std::vector<uint64_t> > LogFileMap;
+
+    WriteBatch* GroupWriteBatch(WriteBatch* tmp_batch, RecordWriter** last_writer);
+    LogStream* PickIdleLogStream();
+    Status WriteLogRecord(LogStream* stream, const Slice& record,
+                          uint64_t first_seq, bool sync);
+
+    Status RecoverLogFiles(const LogFileMap& logfiles,
+                           std::vector<VersionEdit*>* edit_list);
+    Status RecoverWriteBatch(WriteBatch* batch,
+                             std::vector<VersionEdit*>* edit_list);
+    Status RecoverSharedLog(std::vector<VersionEdit*>* edit_list);
+    Status ResetSharedLogMarker();
     void MaybeIgnoreError(Status* s) const;
-    Status GatherLogFile(uint64_t begin_num,
-                         std::vector<uint64_t>* logfiles);
-    Status DeleteLogFile(const std::vector<uint64_t>& log_numbers);
+    Status GatherLogFile(uint64_t begin_num, LogFileMap* logfiles);
+    Status DeleteLogFile(const LogFileMap& logfiles);
     void DeleteObsoleteFiles(uint64_t seq_no = -1U);
     void ArchiveFile(const std::string& filepath);
 
     // return 0: switch log successed
     // return 1: cannot switch log right now
     // return 2: can switch but failed
-    int SwitchLog(bool blocked_switch);
+    int SwitchLog(LogStream* stream, bool blocked_switch, uint64_t log_number);
     void ScheduleGarbageClean(double score);
     static void GarbageCleanWrapper(void* db);
     void BackgroundGarbageClean();
@@ -200,14 +216,19 @@ private:
     uint64_t commit_snapshot_;
     Status fatal_error_;
 
-    WritableFile* logfile_;
-    log::AsyncWriter* log_;
-    bool force_switch_log_;
+    // write-ahead log streams, see Options::log_stream_num
+    std::vector<LogStream*> log_streams_;
+    port::CondVar log_stream_cv_;
+    // sequence visible to readers, all write groups below it are applied
     uint64_t last_sequence_;
-    size_t current_log_size_;
+    // sequence handed out to write groups, maybe not applied yet
+    uint64_t log_sequence_;
+    // write groups are applied to memtables in the order they were sequenced
+    uint64_t next_apply_ticket_;
+    uint64_t apply_ticket_;
+    port::CondVar apply_cv_;
 
     std::deque<RecordWriter*> writers_;
-    WriteBatch* tmp_batch_;
 
     // for GC schedule
     bool bg_schedule_gc_;
@@ -10,12 +10,15 @@
 
 #include "db/db_impl.h"
 #include "db/filename.h"
+#include "db/shared_log.h"
+#include "db/table_cache.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
 #include "leveldb/cache.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/lg_coding.h"
+#include "leveldb/rate_limiter.h"
 #include "leveldb/table.h"
 #include "util/hash.h"
 #include "util/logging.h"
@@ -231,6 +234,8 @@ class DBTest {
     kDefault,
     kFilter,
     kUncompressed,
+    kDataBlockHashIndex,
+    kParallelDump,
     kEnd
   };
   int option_config_;
@@ -285,6 +290,13 @@ class DBTest {
       case kUncompressed:
         options.compression = kNoCompression;
         break;
+      case kDataBlockHashIndex:
+        options.data_block_hash_index = true;
+        break;
+      case kParallelDump:
+        options.filter_policy = filter_policy_;
+        options.dump_compress_threads = 2;
+        break;
       default:
         break;
     }
@@ -305,6 +317,13 @@ class DBTest {
       case kUncompressed:
         options.compression = kNoCompression;
         break;
+      case kDataBlockHashIndex:
+        options.data_block_hash_index = true;
+        break;
+      case kParallelDump:
+        options.filter_policy = filter_policy_;
+        options.dump_compress_threads = 2;
+        break;
       default:
         break;
     }
@@ -949,6 +968,155 @@ TEST(DBTest, RecoverWithLostCurrent0) {
   dbname_ = old_dbname;
 }
 
+TEST(DBTest, SplitKeepTableCache) {
+  TableCache* table_cache = new TableCache(8 << 20);
+  Cache* block_cache = NewLRUCache(8 << 20);
+  // freed with the parent, as a tablet frees its options on unload
+  CompactStrategyFactory* factory = new DummyCompactStrategyFactory();
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.dump_mem_on_shutdown = true;
+  options.table_cache = table_cache;
+  options.block_cache = block_cache;
+  options.compact_strategy_factory = factory;
+  Reopen(&options);
+  ASSERT_OK(Put("2", "v2"));
+  ASSERT_OK(Put("3", "v3"));
+  Compact("1", "6");
+  ASSERT_EQ("v2", Get("2"));
+  db_->KeepTableCacheOnClose();
+  Close();
+  delete factory;
+
+  // the child reads the tables opened by its parent, no file read at all
+  std::string old_dbname = dbname_;
+  dbname_ = dbname_.replace(dbname_.length() - 2, 1, "3");
+  DestroyDB(dbname_, Options());
+  Options opt = SplitOptions();
+  opt.env = env_;
+  opt.table_cache = table_cache;
+  opt.block_cache = block_cache;
+  env_->count_random_reads_ = true;
+  env_->random_read_counter_.Reset();
+  Reopen(&opt);
+  ASSERT_EQ("v2", Get("2"));
+  ASSERT_EQ(0, env_->random_read_counter_.Read());
+
+  // tables are evicted on a normal close
+  Reopen(&opt);
+  ASSERT_EQ("v3", Get("3"));
+  ASSERT_GT(env_->random_read_counter_.Read(), 0);
+  Close();
+  env_->count_random_reads_ = false;
+  DestroyDB(dbname_, Options());
+  dbname_ = old_dbname;
+  delete table_cache;
+  delete block_cache;
+}
+
+TEST(DBTest, TraceReadAndWrite) {
+  Cache* block_cache = NewLRUCache(8 << 20);
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = block_cache;
+  Reopen(&options);
+
+  WriteTrace write_trace;
+  WriteOptions write_options;
+  write_options.trace = &write_trace;
+  uint64_t start_us = env_->NowMicros();
+  ASSERT_OK(db_->Put(write_options, "foo", "v1"));
+  uint64_t write_us = env_->NowMicros() - start_us;
+  ASSERT_LE(write_trace.wait_us + write_trace.log_us + write_trace.memtable_us, write_us);
+  Compact("a", "z");
+
+  // the first read misses the block cache, the second hits it
+  ReadTrace read_trace;
+  ReadOptions read_options;
+  read_options.trace = &read_trace;
+  std::string value;
+  ASSERT_OK(db_->Get(read_options, "foo", &value));
+  ASSERT_EQ("v1", value);
+  ASSERT_EQ(0U, read_trace.block_cache_hit);
+  ASSERT_GT(read_trace.block_cache_miss, 0U);
+  uint64_t miss = read_trace.block_cache_miss;
+  ASSERT_OK(db_->Get(read_options, "foo", &value));
+  ASSERT_GT(read_trace.block_cache_hit, 0U);
+  ASSERT_EQ(miss, read_trace.block_cache_miss);
+  Close();
+  delete block_cache;
+}
+
+TEST(DBTest, RateLimitSstWrites) {
+  RateLimiterOptions limiter_options;
+  limiter_options.max_bytes_per_sec[kIODeepCompaction] = 64 << 20;
+  RateLimiter* limiter = NewRateLimiter(env_, limiter_options);
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.rate_limiter = limiter;
+  Reopen(&options);
+
+  ASSERT_OK(Put("foo", "v1"));
+  ASSERT_OK(Put("bar", "v1"));
+  dbfull()->TEST_CompactMemTable();
+  int64_t flushed = limiter->TotalBytes(kIOFlush);
+  ASSERT_GT(flushed, 0);
+  ASSERT_OK(Put("foo", "v2"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_GT(limiter->TotalBytes(kIOFlush), flushed);
+
+  // the overlapped files are merged by compactions
+  Compact("a", "z");
+  ASSERT_GT(limiter->TotalBytes(kIOL0Compaction) +
+            limiter->TotalBytes(kIODeepCompaction), 0);
+  ASSERT_EQ("v2", Get("foo"));
+  Close();
+  delete limiter;
+}
+
+TEST(DBTest, WarmUpBeforeMove) {
+  TableCache* src_table_cache = new TableCache(8 << 20);
+  Cache* src_block_cache = NewLRUCache(8 << 20);
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.table_cache = src_table_cache;
+  options.block_cache = src_block_cache;
+  Reopen(&options);
+  ASSERT_OK(Put("2", "v2"));
+  Compact("1", "6");
+  ASSERT_EQ("v2", Get("2"));
+  std::vector<HotTableFile> files;
+  db_->GetHotTableFiles(0, &files);
+  ASSERT_EQ(1U, files.size());
+  ASSERT_TRUE(files[0].block_offsets.empty());
+  files.clear();
+  db_->GetHotTableFiles(1 << 20, &files);
+  ASSERT_EQ(1U, files.size());
+  ASSERT_EQ(1U, files[0].block_offsets.size());
+  Close();
+
+  // the destination reads the tables and blocks in advance, no file read
+  // at all once the db is opened there
+  TableCache* table_cache = new TableCache(8 << 20);
+  Cache* block_cache = NewLRUCache(8 << 20);
+  options.table_cache = table_cache;
+  options.block_cache = block_cache;
+  uint64_t bytes = 0;
+  ASSERT_OK(WarmUpDB(options, dbname_, files, &bytes));
+  ASSERT_GT(bytes, 0U);
+  env_->count_random_reads_ = true;
+  env_->random_read_counter_.Reset();
+  Reopen(&options);
+  ASSERT_EQ("v2", Get("2"));
+  ASSERT_EQ(0, env_->random_read_counter_.Read());
+  Close();
+  env_->count_random_reads_ = false;
+  delete table_cache;
+  delete block_cache;
+  delete src_table_cache;
+  delete src_block_cache;
+}
+
 TEST(DBTest, RecoverWithLostCurrent1) {
   // before write anything delete current file 
   ASSERT_OK(env_->DeleteFile(CurrentFileName(dbname_ + "/0")));
@@ -1606,6 +1774,289 @@ TEST(DBTest, ManualCompaction) {
   ASSERT_EQ("0,0,1", FilesPerLevel());
 }
 
+// Wait until the background compactions leave the files alone.
+static std::string WaitForStableFiles(DBTest* t) {
+  std::string files = t->FilesPerLevel();
+  for (int stable = 0, i = 0; stable < 5 && i < 200; i++) {
+    DelayMilliseconds(100);
+    std::string now = t->FilesPerLevel();
+    stable = (now == files) ? stable + 1 : 0;
+    files = now;
+  }
+  return files;
+}
+
+TEST(DBTest, TieredCompaction) {
+  Options options = CurrentOptions();
+  options.compaction_style = kTieredCompaction;
+  DestroyAndReopen(&options);
+
+  const int kRounds = 3 * config::kL0_CompactionTrigger;
+  for (int round = 0; round < kRounds; round++) {
+    for (int i = 0; i < 300; i++) {
+      char key[20];
+      snprintf(key, sizeof(key), "key%06d", (i * 7 + round * 100) % 1000);
+      ASSERT_OK(Put(key, "v" + NumberToString(round)));
+    }
+    dbfull()->TEST_CompactMemTable();
+  }
+  std::string files = WaitForStableFiles(this);
+  fprintf(stderr, "tiered files per level: %s\n", files.c_str());
+  ASSERT_LT(NumTableFilesAtLevel(0), config::kL0_CompactionTrigger);
+  ASSERT_EQ(0, NumTableFilesAtLevel(1));  // runs are pushed down
+
+  std::vector<uint64_t> flush_bytes, compaction_bytes;
+  db_->GetWriteBytes(&flush_bytes, &compaction_bytes);
+  ASSERT_EQ(1U, flush_bytes.size());
+  ASSERT_GT(flush_bytes[0], 0U);
+  ASSERT_GT(compaction_bytes[0], 0U);
+  fprintf(stderr, "tiered write amplification: %.2f\n",
+          (flush_bytes[0] + compaction_bytes[0]) / static_cast<double>(flush_bytes[0]));
+
+  for (int i = 0; i < 1000; i++) {
+    char key[20];
+    snprintf(key, sizeof(key), "key%06d", i);
+    int last = -1;
+    for (int round = 0; round < kRounds; round++) {
+      for (int j = 0; j < 300; j++) {
+        if ((j * 7 + round * 100) % 1000 == i) {
+          last = round;
+        }
+      }
+    }
+    ASSERT_EQ(last < 0 ? "NOT_FOUND" : "v" + NumberToString(last), Get(key));
+  }
+
+  Reopen(&options);
+  ASSERT_EQ(files, FilesPerLevel());
+}
+
+// Keys starting with "e" expire at *expire, the other keys never.
+// Keys starting with "e" expire at *expire.  With cell metadata, the first
+// char of a key is its column family and the digits after it the timestamp,
+// keys of family "m" are atomic operations and of family "d" row deletion
+// marks.
+class ExpireCompactStrategy : public DummyCompactStrategy {
+ public:
+  ExpireCompactStrategy(const int64_t* expire, bool cell_meta)
+      : expire_(expire), cell_meta_(cell_meta) {}
+  virtual bool CheckTag(const Slice& tera_key, bool* del_tag, int64_t* ttl_tag) {
+    *del_tag = false;
+    *ttl_tag = tera_key.starts_with("e") ? *expire_ : -1;
+    return true;
+  }
+  virtual bool ExtractCell(const Slice& tera_key, Slice* family,
+                           int64_t* ts, TeraKeyType* type) {
+    if (!cell_meta_ || tera_key.empty()) {
+      return false;
+    }
+    *family = Slice(tera_key.data(), 1);
+    *ts = 0;
+    for (size_t i = 1; i < tera_key.size() && isdigit(tera_key[i]); i++) {
+      *ts = *ts * 10 + (tera_key[i] - '0');
+    }
+    *type = tera_key.starts_with("m") ? TKT_ADD :
+            tera_key.starts_with("d") ? TKT_DEL : TKT_VALUE;
+    return true;
+  }
+  virtual int64_t FamilyExpireTime(const Slice& family, int64_t max_ts,
+                                   int64_t expire_ts) {
+    return family == Slice("e") ? *expire_ : 0;
+  }
+ private:
+  const int64_t* expire_;
+  bool cell_meta_;
+};
+
+class ExpireCompactStrategyFactory : public CompactStrategyFactory {
+ public:
+  explicit ExpireCompactStrategyFactory(const int64_t* expire, bool cell_meta = false)
+      : expire_(expire), cell_meta_(cell_meta) {}
+  virtual CompactStrategy* NewInstance() {
+    return new ExpireCompactStrategy(expire_, cell_meta_);
+  }
+  virtual const char* Name() const {
+    return "leveldb.ExpireCompactStrategyFactory";
+  }
+  virtual void SetArg(const void* arg) {}
+ private:
+  const int64_t* expire_;
+  bool cell_meta_;
+};
+
+TEST(DBTest, TieredCompactionDropExpired) {
+  int64_t expire = 0;
+  ExpireCompactStrategyFactory factory(&expire);
+  Options options = CurrentOptions();
+  options.compaction_style = kTieredCompaction;
+  options.compact_strategy_factory = &factory;
+  DestroyAndReopen(&options);
+
+  // dropped without being rewritten
+  expire = env_->NowMicros() - 1;
+  ASSERT_OK(Put("e1", "v1"));
+  ASSERT_OK(Put("e2", "v2"));
+  dbfull()->TEST_CompactMemTable();
+  WaitForStableFiles(this);
+  ASSERT_EQ(0, TotalTableFiles());
+  ASSERT_EQ("NOT_FOUND", Get("e1"));
+  std::vector<uint64_t> flush_bytes, compaction_bytes;
+  db_->GetWriteBytes(&flush_bytes, &compaction_bytes);
+  ASSERT_EQ(0U, compaction_bytes[0]);
+
+  // the entries are checked again before the file is dropped
+  expire = env_->NowMicros() + 1000000;
+  ASSERT_OK(Put("e3", "v3"));
+  dbfull()->TEST_CompactMemTable();
+  expire = env_->NowMicros() + 1000000000;
+  DelayMilliseconds(2500);
+  WaitForStableFiles(this);
+  ASSERT_EQ(1, TotalTableFiles());
+  ASSERT_EQ("v3", Get("e3"));
+
+  // an older run overlaps
+  ASSERT_OK(Put("e5", "v5"));
+  dbfull()->TEST_CompactMemTable();
+  WaitForStableFiles(this);
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+  int files = TotalTableFiles();
+  expire = env_->NowMicros() - 1;
+  ASSERT_OK(Put("e4", "v4"));
+  dbfull()->TEST_CompactMemTable();
+  WaitForStableFiles(this);
+  ASSERT_EQ(1, NumTableFilesAtLevel(0));
+  ASSERT_EQ(files + 1, TotalTableFiles());
+  ASSERT_EQ("v4", Get("e4"));
+  Close();
+}
+
+TEST(DBTest, DropExpiredFilesByCellMeta) {
+  int64_t expire = 0;
+  ExpireCompactStrategyFactory factory(&expire, true);
+  Options options = CurrentOptions();
+  options.compact_strategy_factory = &factory;
+  DestroyAndReopen(&options);
+
+  // an older file overlaps, but the expired cells hide none of it
+  expire = env_->NowMicros() + 1000000000;
+  ASSERT_OK(Put("e5", "v5"));
+  dbfull()->TEST_CompactMemTable();
+  dbfull()->TEST_CompactRange(0, NULL, NULL);
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+  ASSERT_EQ(1, TotalTableFiles());
+  expire = env_->NowMicros() - 1;
+  ASSERT_OK(Put("e4", "v4"));
+  dbfull()->TEST_CompactMemTable();
+  WaitForStableFiles(this);
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+  std::vector<uint64_t> flush_bytes, compaction_bytes;
+  db_->GetWriteBytes(&flush_bytes, &compaction_bytes);
+  uint64_t compacted = compaction_bytes[0];
+
+  // the schema is checked again before the file is dropped
+  expire = env_->NowMicros() + 1000000;
+  ASSERT_OK(Put("e6", "v6"));
+  dbfull()->TEST_CompactMemTable();
+  expire = env_->NowMicros() + 1000000000;
+  DelayMilliseconds(2500);
+  WaitForStableFiles(this);
+  ASSERT_EQ("v6", Get("e6"));
+  db_->GetWriteBytes(&flush_bytes, &compaction_bytes);
+  ASSERT_EQ(compacted, compaction_bytes[0]);
+  Close();
+}
+
+static std::string ScanCells(DB* db, int64_t ts_start,
+                             std::set<std::string>* cfs = NULL,
+                             uint64_t* skipped_files = NULL) {
+  ReadOptions options;
+  options.cell_ts_start = ts_start;
+  options.target_cfs = cfs;
+  options.skipped_files = skipped_files;
+  Iterator* iter = db->NewIterator(options);
+  std::string result;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    result += iter->key().ToString() + " ";
+  }
+  delete iter;
+  return result;
+}
+
+TEST(DBTest, SkipFilesOlderThanReadRange) {
+  int64_t expire = 0;
+  ExpireCompactStrategyFactory factory(&expire, true);
+  Options options = CurrentOptions();
+  options.compact_strategy_factory = &factory;
+  DestroyAndReopen(&options);
+
+  ASSERT_OK(Put("a1", "v1"));
+  ASSERT_OK(Put("b2", "v2"));
+  dbfull()->TEST_CompactMemTable();
+  dbfull()->TEST_CompactRange(0, NULL, NULL);
+  ASSERT_OK(Put("a9", "v9"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(Put("b3", "v3"));
+  ASSERT_EQ(2, TotalTableFiles());
+  ASSERT_EQ("a1 a9 b2 b3 ", ScanCells(db_, INT64_MIN));
+  ASSERT_EQ("a1 a9 b2 b3 ", ScanCells(db_, 2));
+  // the memtable is never skipped
+  ASSERT_EQ("a9 b3 ", ScanCells(db_, 3));
+  ASSERT_EQ("b3 ", ScanCells(db_, 10));
+
+  // atomic operations may be merged into older cells, in the memtable,
+  // replayed from the log and in files
+  ASSERT_OK(Put("m7", "v7"));
+  ASSERT_EQ("a1 a9 b2 b3 m7 ", ScanCells(db_, 10));
+  Reopen(&options);
+  ASSERT_EQ("a1 a9 b2 b3 m7 ", ScanCells(db_, 10));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ("a1 a9 b2 b3 m7 ", ScanCells(db_, 10));
+  Close();
+}
+
+TEST(DBTest, SkipFilesOfOtherFamilies) {
+  int64_t expire = 0;
+  ExpireCompactStrategyFactory factory(&expire, true);
+  Options options = CurrentOptions();
+  options.compact_strategy_factory = &factory;
+  DestroyAndReopen(&options);
+
+  ASSERT_OK(Put("a1", "v1"));
+  ASSERT_OK(Put("a2", "v2"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(Put("b3", "v3"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(Put("c4", "v4"));
+  ASSERT_EQ(2, TotalTableFiles());
+
+  std::set<std::string> cfs;
+  cfs.insert("a");
+  uint64_t skipped = 0;
+  // the memtable is never skipped
+  ASSERT_EQ("a1 a2 c4 ", ScanCells(db_, INT64_MIN, &cfs, &skipped));
+  ASSERT_EQ(1U, skipped);
+  cfs.insert("b");
+  skipped = 0;
+  ASSERT_EQ("a1 a2 b3 c4 ", ScanCells(db_, INT64_MIN, &cfs, &skipped));
+  ASSERT_EQ(0U, skipped);
+  cfs.clear();
+  cfs.insert("c");
+  skipped = 0;
+  ASSERT_EQ("c4 ", ScanCells(db_, INT64_MIN, &cfs, &skipped));
+  ASSERT_EQ(2U, skipped);
+  skipped = 0;
+  ASSERT_EQ("a1 a2 b3 c4 ", ScanCells(db_, INT64_MIN, NULL, &skipped));
+  ASSERT_EQ(0U, skipped);
+
+  // a file of row deletion marks is read for all families
+  ASSERT_OK(Put("d5", ""));
+  dbfull()->TEST_CompactMemTable();
+  skipped = 0;
+  ASSERT_EQ("c4 d5 ", ScanCells(db_, INT64_MIN, &cfs, &skipped));
+  ASSERT_EQ(2U, skipped);
+  Close();
+}
+
 TEST(DBTest, DBOpen_Options) {
   std::string dbname = test::TmpDir() + "/db_options_test";
   DestroyDB(dbname, Options());
@@ -1909,6 +2360,125 @@ TEST(DBTest, MultiThreaded) {
   } while (ChangeOptions());
 }
 
+TEST(DBTest, MultiStreamLog) {
+  Options options = CurrentOptions();
+  options.log_stream_num = 4;
+  options.log_file_size = 64 << 10;
+  Reopen(&options);
+
+  // Initialize state
+  MTState mt;
+  mt.test = this;
+  mt.stop.Release_Store(0);
+  for (int id = 0; id < kNumThreads; id++) {
+    mt.counter[id].Release_Store(0);
+    mt.thread_done[id].Release_Store(0);
+  }
+
+  // Start threads
+  MTThread thread[kNumThreads];
+  for (int id = 0; id < kNumThreads; id++) {
+    thread[id].state = &mt;
+    thread[id].id = id;
+    env_->StartThread(MTThreadBody, &thread[id]);
+  }
+
+  // Let them run for a while
+  DelayMilliseconds(kTestSeconds * 1000);
+
+  // Stop the threads and wait for them to finish
+  mt.stop.Release_Store(&mt);
+  for (int id = 0; id < kNumThreads; id++) {
+    while (mt.thread_done[id].Acquire_Load() == NULL) {
+      DelayMilliseconds(100);
+    }
+  }
+
+  std::string before = Contents();
+  std::vector<std::string> files;
+  ASSERT_OK(env_->GetChildren(dbname_, &files));
+  std::set<uint32_t> streams;
+  for (size_t i = 0; i < files.size(); i++) {
+    uint64_t number;
+    uint32_t stream_id;
+    if (ParseLogStreamFileName(files[i], &number, &stream_id)) {
+      streams.insert(stream_id);
+    }
+  }
+  ASSERT_EQ(4U, streams.size());
+
+  // Log streams are merged by sequence number on recovery
+  Reopen();
+  ASSERT_EQ(before, Contents());
+  ASSERT_OK(Put("foo", "v1"));
+  Reopen(&options);
+  ASSERT_EQ("v1", Get("foo"));
+}
+
+TEST(DBTest, SharedLogMultiStream) {
+  std::string root = test::TmpDir() + "/db_test_shared_log";
+  env_->DeleteDirRecursive(root);
+  ASSERT_OK(env_->CreateDir(root));
+  SharedLog* log = new SharedLog(env_, SharedLogDirName(root, "host:8000", 1),
+                                 64 << 10, 1000, NULL);
+  ASSERT_OK(log->Open());
+  Options options = CurrentOptions();
+  options.shared_log = log;
+  options.log_stream_num = 4;
+  DestroyAndReopen(&options);
+
+  // Initialize state
+  MTState mt;
+  mt.test = this;
+  mt.stop.Release_Store(0);
+  for (int id = 0; id < kNumThreads; id++) {
+    mt.counter[id].Release_Store(0);
+    mt.thread_done[id].Release_Store(0);
+  }
+
+  // Start threads
+  MTThread thread[kNumThreads];
+  for (int id = 0; id < kNumThreads; id++) {
+    thread[id].state = &mt;
+    thread[id].id = id;
+    env_->StartThread(MTThreadBody, &thread[id]);
+  }
+
+  // Let them run for a while
+  DelayMilliseconds(kTestSeconds * 1000);
+
+  // Stop the threads and wait for them to finish
+  mt.stop.Release_Store(&mt);
+  for (int id = 0; id < kNumThreads; id++) {
+    while (mt.thread_done[id].Acquire_Load() == NULL) {
+      DelayMilliseconds(100);
+    }
+  }
+  std::string before = Contents();
+
+  // Close without dumping the memtable, recover from the live shared log
+  Reopen(&options);
+  ASSERT_EQ(before, Contents());
+  ASSERT_OK(Put("foo", "v1"));
+
+  // The node is gone, recover from the split of its shared log
+  Close();
+  ASSERT_OK(log->Sync());
+  SharedLog* other = new SharedLog(env_, SharedLogDirName(root, "host:8001", 2),
+                                   64 << 10, 1000, NULL);
+  ASSERT_OK(other->Open());
+  options.shared_log = other;
+  Reopen(&options);
+  ASSERT_EQ("v1", Get("foo"));
+  ASSERT_OK(Delete("foo"));
+  ASSERT_EQ(before, Contents());
+
+  Close();
+  delete log;
+  delete other;
+  env_->DeleteDirRecursive(root);
+}
+
 namespace {
 typedef std::map<std::string, std::string> KVMap;
 }
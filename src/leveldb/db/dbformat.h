@@ -108,6 +108,7 @@ class InternalFilterPolicy : public FilterPolicy {
   const FilterPolicy* const user_policy_;
  public:
   explicit InternalFilterPolicy(const FilterPolicy* p) : user_policy_(p) { }
+  const FilterPolicy* user_policy() const { return user_policy_; }
   virtual const char* Name() const;
   virtual void CreateFilter(const Slice* keys, int n, std::string* dst) const;
   virtual bool KeyMayMatch(const Slice& key, const Slice& filter) const;
@@ -74,6 +74,52 @@ std::string LogHexFileName(const std::string& name, uint64_t number) {
   return name + std::string("/H") + Uint64ToString(number, 16) + ".log";
 }
 
+std::string LogStreamFileName(const std::string& name, uint64_t number,
+                              uint32_t stream_id) {
+  if (stream_id == 0) {
+    return LogHexFileName(name, number);
+  }
+  return name + std::string("/H") + Uint64ToString(number, 16) + "."
+      + Uint64ToString(stream_id) + ".log";
+}
+
+// Parse the suffix after the log number: ".log" or ".<stream_id>.log"
+static bool ConsumeLogSuffix(Slice* suffix, uint32_t* stream_id) {
+  if (*suffix == Slice(".log")) {
+    *stream_id = 0;
+    return true;
+  }
+  if (!suffix->starts_with(".")) {
+    return false;
+  }
+  Slice rest(suffix->data() + 1, suffix->size() - 1);
+  uint64_t id = 0;
+  if (rest.starts_with("H") || !ConsumeDecimalNumber(&rest, &id)) {
+    return false;
+  }
+  if (rest != Slice(".log") || id == 0 || id > 0xffffffffull) {
+    return false;
+  }
+  *stream_id = static_cast<uint32_t>(id);
+  return true;
+}
+
+bool ParseLogStreamFileName(const std::string& fname, uint64_t* number,
+                            uint32_t* stream_id) {
+  Slice rest(fname);
+  uint64_t num;
+  if (!ConsumeDecimalNumber(&rest, &num)) {
+    return false;
+  }
+  uint32_t id;
+  if (!ConsumeLogSuffix(&rest, &id)) {
+    return false;
+  }
+  *number = num;
+  *stream_id = id;
+  return true;
+}
+
 std::string TableFileName(const std::string& name, uint64_t number) {
   assert(number > 0);
   if (number < (1ull << 63)) {
@@ -96,6 +142,10 @@ std::string CurrentFileName(const std::string& dbname) {
   return dbname + "/CURRENT";
 }
 
+std::string SharedLogMarkerFileName(const std::string& dbname) {
+  return dbname + "/SHAREDLOG";
+}
+
 std::string LockFileName(const std::string& dbname) {
   return dbname + "/LOCK";
 }
@@ -122,6 +172,7 @@ std::string OldInfoLogFileName(const std::string& dbname) {
 //    dbname/LOG.old
 //    dbname/MANIFEST-[0-9]+
 //    dbname/[0-9]+.(log|sst)
+//    dbname/H[0-9a-f]+(.[0-9]+)?.log
 bool ParseFileName(const std::string& fname,
                    uint64_t* number,
                    FileType* type) {
@@ -132,6 +183,9 @@ bool ParseFileName(const std::string& fname,
   } else if (rest == "LOCK" || rest == "__init_load_filelock") {
     *number = 0;
     *type = kDBLockFile;
+  } else if (rest == "SHAREDLOG") {
+    *number = 0;
+    *type = kSharedLogMarkerFile;
   } else if (rest == "LOG" || rest == "LOG.old") {
     *number = 0;
     *type = kInfoLogFile;
@@ -154,7 +208,8 @@ bool ParseFileName(const std::string& fname,
       return false;
     }
     Slice suffix = rest;
-    if (suffix == Slice(".log")) {
+    uint32_t stream_id;
+    if (ConsumeLogSuffix(&suffix, &stream_id)) {
       *type = kLogFile;
     } else if (suffix == Slice(".sst")) {
       *type = kTableFile;
@@ -191,6 +246,21 @@ Status SetCurrentFile(Env* env, const std::string& dbname,
   return s;
 }
 
+Status SetSharedLogMarker(Env* env, const std::string& dbname,
+                          const std::string& log_dir) {
+  std::string tmp = TempFileName(dbname, 1);
+  Status s = WriteStringToFileSync(env, log_dir, tmp);
+  if (s.ok()) {
+    s = env->RenameFile(tmp, SharedLogMarkerFileName(dbname));
+  }
+  if (!s.ok()) {
+    Log("[%s][dfs error] set shared log marker[%s] error, status[%s].\n",
+        dbname.c_str(), log_dir.c_str(), s.ToString().c_str());
+    env->DeleteFile(tmp);
+  }
+  return s;
+}
+
 const char* FileTypeToString(FileType type) {
   switch (type) {
   case kLogFile:
@@ -207,6 +277,8 @@ const char* FileTypeToString(FileType type) {
     return "kTempFile";
   case kInfoLogFile:
     return "kInfoLogFile";
+  case kSharedLogMarkerFile:
+    return "kSharedLogMarkerFile";
   default:;
   }
   return "kUnknown";
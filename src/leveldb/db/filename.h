@@ -30,7 +30,8 @@ enum FileType {
   kDescriptorFile,
   kCurrentFile,
   kTempFile,
-  kInfoLogFile  // Either the current one, or an old one
+  kInfoLogFile,  // Either the current one, or an old one
+  kSharedLogMarkerFile
 };
 
 // Return the name of the log file with the specified number
@@ -41,6 +42,19 @@ extern std::string LogFileName(const std::string& dbname, uint64_t number);
 // for qinan
 extern std::string LogHexFileName(const std::string& dbname, uint64_t number);
 
+// Return the name of the log file with the specified number that belongs
+// to log stream "stream_id".  Stream 0 shares the single-stream name, so
+// tablets written before multi-stream WAL can still be recovered.
+// E.g. "dbname/H1a2b.log" for stream 0, "dbname/H1a2b.3.log" for stream 3
+extern std::string LogStreamFileName(const std::string& dbname, uint64_t number,
+                                     uint32_t stream_id);
+
+// If filename is a log file of any stream, store its number in *number and
+// its stream id in *stream_id and return true.  Else return false.
+extern bool ParseLogStreamFileName(const std::string& filename,
+                                   uint64_t* number,
+                                   uint32_t* stream_id);
+
 // Return the name of the sstable with the specified number
 // in the db named by "dbname".  The result will be prefixed with
 // "dbname".
@@ -57,6 +71,10 @@ extern std::string DescriptorFileName(const std::string& dbname,
 // "dbname".
 extern std::string CurrentFileName(const std::string& dbname);
 
+// Return the name of the file naming the node-level shared log the db
+// named by "dbname" writes to.  The result will be prefixed with "dbname".
+extern std::string SharedLogMarkerFileName(const std::string& dbname);
+
 // Return the name of the lock file for the db named by
 // "dbname".  The result will be prefixed with "dbname".
 extern std::string LockFileName(const std::string& dbname);
@@ -83,6 +101,10 @@ extern bool ParseFileName(const std::string& filename,
 extern Status SetCurrentFile(Env* env, const std::string& dbname,
                              uint64_t descriptor_number);
 
+// Make the shared log marker of "dbname" point to "log_dir".
+extern Status SetSharedLogMarker(Env* env, const std::string& dbname,
+                                 const std::string& log_dir);
+
 
 const char* FileTypeToString(FileType type);
 
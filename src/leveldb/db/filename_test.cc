@@ -33,11 +33,14 @@ TEST(FileNameTest, Parse) {
     { "0.sst",              0,     kTableFile },
     { "CURRENT",            0,     kCurrentFile },
     { "LOCK",               0,     kDBLockFile },
+    { "SHAREDLOG",          0,     kSharedLogMarkerFile },
     { "MANIFEST-2",         2,     kDescriptorFile },
     { "MANIFEST-7",         7,     kDescriptorFile },
     { "LOG",                0,     kInfoLogFile },
     { "LOG.old",            0,     kInfoLogFile },
     { "18446744073709551615.log", 18446744073709551615ull, kLogFile },
+    { "H1a.log",            0x1a,  kLogFile },
+    { "H1a.3.log",          0x1a,  kLogFile },
   };
   for (uint32_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
     std::string f = cases[i].fname;
@@ -69,7 +72,11 @@ TEST(FileNameTest, Parse) {
     "184467440737095516150.log",
     "100",
     "100.",
-    "100.lop"
+    "100.lop",
+    "H1a.0.log",
+    "H1a.H3.log",
+    "H1a.3.sst",
+    "H1a.3"
   };
   for (uint32_t i = 0; i < sizeof(errors) / sizeof(errors[0]); i++) {
     std::string f = errors[i];
@@ -94,12 +101,34 @@ TEST(FileNameTest, Construction) {
   ASSERT_EQ(0UL, number);
   ASSERT_EQ(kDBLockFile, type);
 
+  fname = SharedLogMarkerFileName("foo");
+  ASSERT_EQ("foo/", std::string(fname.data(), 4));
+  ASSERT_TRUE(ParseFileName(fname.c_str() + 4, &number, &type));
+  ASSERT_EQ(0UL, number);
+  ASSERT_EQ(kSharedLogMarkerFile, type);
+
   fname = LogFileName("foo", 192);
   ASSERT_EQ("foo/", std::string(fname.data(), 4));
   ASSERT_TRUE(ParseFileName(fname.c_str() + 4, &number, &type));
   ASSERT_EQ(192UL, number);
   ASSERT_EQ(kLogFile, type);
 
+  uint32_t stream_id;
+  fname = LogStreamFileName("foo", 0x1a2b, 0);
+  ASSERT_EQ(LogHexFileName("foo", 0x1a2b), fname);
+  ASSERT_TRUE(ParseLogStreamFileName(fname.c_str() + 4, &number, &stream_id));
+  ASSERT_EQ(0x1a2bUL, number);
+  ASSERT_EQ(0U, stream_id);
+
+  fname = LogStreamFileName("foo", 0x1a2b, 3);
+  ASSERT_EQ("foo/", std::string(fname.data(), 4));
+  ASSERT_TRUE(ParseFileName(fname.c_str() + 4, &number, &type));
+  ASSERT_EQ(0x1a2bUL, number);
+  ASSERT_EQ(kLogFile, type);
+  ASSERT_TRUE(ParseLogStreamFileName(fname.c_str() + 4, &number, &stream_id));
+  ASSERT_EQ(0x1a2bUL, number);
+  ASSERT_EQ(3U, stream_id);
+
   fname = TableFileName("bar/table/0", 200);
   ASSERT_EQ("bar/table/0", std::string(fname.data(), 11));
   ASSERT_TRUE(ParseFileName(fname.c_str() + 12, &number, &type));
@@ -25,7 +25,7 @@ AsyncWriter::AsyncWriter(WritableFile* dest, bool async_mode)
       work_done_(&mutex_),
       can_work_(&mutex_),
       finished_(false),
-      slice_data_(NULL),
+      records_(NULL),
       stop_(false),
       blocked_(false) {
   if (async_mode) {
@@ -50,7 +50,23 @@ void AsyncWriter::AddRecord(const Slice& slice) {
   } else {
     MutexLock lock(&mutex_);
     mode_ = AsyncWriter::kAddRecord;
-    slice_data_ = new std::string(slice.data(), slice.size());
+    records_ = new std::vector<std::string>(1, std::string(slice.data(), slice.size()));
+    finished_ = false;
+    can_work_.Signal();
+  }
+}
+
+void AsyncWriter::AddRecords(const std::vector<std::string>& records) {
+  if (!async_mode_) {
+    s_ = Status::OK();
+    for (size_t i = 0; s_.ok() && i < records.size(); ++i) {
+      s_ = writer_.AddRecord(records[i]);
+    }
+    finished_ = true;
+  } else {
+    MutexLock lock(&mutex_);
+    mode_ = AsyncWriter::kAddRecord;
+    records_ = new std::vector<std::string>(records);
     finished_ = false;
     can_work_.Signal();
   }
@@ -130,10 +146,14 @@ void AsyncWriter::ThreadFuncCall() {
     }
     if (mode_ == kAddRecord) {
       mutex_.Unlock();
-      s_ = writer_.AddRecord(*(slice_data_));
+      Status s;
+      for (size_t i = 0; s.ok() && i < records_->size(); ++i) {
+        s = writer_.AddRecord((*records_)[i]);
+      }
       mutex_.Lock();
-      delete slice_data_;
-      slice_data_ = NULL;
+      s_ = s;
+      delete records_;
+      records_ = NULL;
     } else if (mode_ == kSync) {
       mutex_.Unlock();
       s_ = dest_->Sync();
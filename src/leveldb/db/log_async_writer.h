@@ -12,6 +12,8 @@
 #include <stdint.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <string>
+#include <vector>
 #include "db/log_format.h"
 #include "db/log_writer.h"
 #include "port/port_posix.h"
@@ -42,6 +44,8 @@ class AsyncWriter {
   // is a async function which calls TreadFuncAddRecor
   // to do the actual work
   void AddRecord(const Slice& slice);
+  // Like AddRecord, for "records" written one after another.
+  void AddRecords(const std::vector<std::string>& records);
   void Sync(bool sync_or_flush = true);
 
   // wait_sec can be:
@@ -72,7 +76,7 @@ class AsyncWriter {
   port::CondVar work_done_;
   port::CondVar can_work_;
   bool finished_;
-  std::string* slice_data_;
+  std::vector<std::string>* records_;
   bool stop_;
   bool blocked_;    // whether the current writter blocked
   Status s_;
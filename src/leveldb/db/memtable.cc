@@ -22,18 +22,22 @@ static Slice GetLengthPrefixedSlice(const char* data) {
   return Slice(p, len);
 }
 
-MemTable::MemTable(const InternalKeyComparator& cmp, CompactStrategyFactory* compact_strategy_factory)
+MemTable::MemTable(const InternalKeyComparator& cmp, CompactStrategyFactory* compact_strategy_factory,
+                   CompactStrategyFactory* cell_strategy_factory)
     : last_seq_(0),
       comparator_(cmp),
       refs_(0),
       being_flushed_(false),
       table_(comparator_, &arena_),
       empty_(true),
-      compact_strategy_factory_(compact_strategy_factory) {
+      compact_strategy_factory_(compact_strategy_factory),
+      cell_strategy_(cell_strategy_factory ? cell_strategy_factory->NewInstance() : NULL),
+      may_merge_cells_(cell_strategy_ ? NULL : this) {
 }
 
 MemTable::~MemTable() {
   assert(refs_ == 0);
+  delete cell_strategy_;
 }
 
 size_t MemTable::ApproximateMemoryUsage() { return arena_.MemoryUsage(); }
@@ -95,6 +99,16 @@ void MemTable::Add(SequenceNumber s, ValueType type,
   //  key bytes    : char[internal_key.size()]
   //  value_size   : varint32 of value.size()
   //  value bytes  : char[value.size()]
+  if (may_merge_cells_.NoBarrier_Load() == NULL) {
+    Slice family;
+    int64_t ts = 0;
+    TeraKeyType tera_type = TKT_VALUE;
+    if (!cell_strategy_->ExtractCell(key, &family, &ts, &tera_type) ||
+        tera_type > TKT_VALUE) {
+      may_merge_cells_.Release_Store(this);
+    }
+  }
+
   size_t key_size = key.size();
   size_t val_size = value.size();
   size_t internal_key_size = key_size + 8;
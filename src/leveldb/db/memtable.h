@@ -14,6 +14,7 @@
 #include "leveldb/compact_strategy.h"
 #include "db/dbformat.h"
 #include "db/skiplist.h"
+#include "port/port.h"
 #include "util/arena.h"
 
 namespace leveldb {
@@ -26,8 +27,11 @@ class MemTable {
  public:
   // MemTables are reference counted.  The initial reference count
   // is zero and the caller must call Ref() at least once.
+  // Keys are split into cells by an instance of "cell_strategy_factory",
+  // see MayMergeCells().
   explicit MemTable(const InternalKeyComparator& comparator,
-          CompactStrategyFactory* compact_strategy_factory = NULL);
+          CompactStrategyFactory* compact_strategy_factory = NULL,
+          CompactStrategyFactory* cell_strategy_factory = NULL);
 
   // Increase reference count.
   void Ref() { ++refs_; }
@@ -79,6 +83,14 @@ class MemTable {
     empty_ = false;
   }
 
+  // Tera tables: true if an atomic operation has been added, which is
+  // merged with older cells on read, or if keys can not be split into
+  // cells.  Files older than ReadOptions::cell_ts_start are not skipped
+  // then.
+  bool MayMergeCells() const {
+    return may_merge_cells_.Acquire_Load() != NULL;
+  }
+
   bool BeingFlushed() { return being_flushed_;}
   void SetBeingFlushed(bool flag) {
     assert(flag ? !being_flushed_
@@ -110,6 +122,8 @@ class MemTable {
   Table table_;
   bool empty_;
   CompactStrategyFactory* compact_strategy_factory_;
+  CompactStrategy* cell_strategy_;
+  port::AtomicPointer may_merge_cells_;
 
   // No copying allowed
   MemTable(const MemTable&);
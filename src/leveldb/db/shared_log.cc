@@ -0,0 +1,682 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "db/shared_log.h"
+
+#include <algorithm>
+
+#include "db/filename.h"
+#include "db/log_async_writer.h"
+#include "db/log_reader.h"
+#include "db/log_writer.h"
+#include "util/coding.h"
+#include "util/logging.h"
+#include "util/mutexlock.h"
+#include "util/string_ext.h"
+
+namespace leveldb {
+
+// Records of a group are written together, up to this size.
+static const size_t kMaxGroupSize = 1 << 20;
+
+std::string SharedLogNodeName(const std::string& node) {
+  std::string name = node;
+  std::replace(name.begin(), name.end(), ':', '_');
+  return name;
+}
+
+std::string SharedLogDirName(const std::string& root,
+                             const std::string& node,
+                             uint64_t start_ts) {
+  return root + "/" + SharedLogNodeName(node) + "@" + Uint64ToString(start_ts);
+}
+
+bool ParseSharedLogDirName(const std::string& dirname,
+                           std::string* node,
+                           uint64_t* start_ts) {
+  size_t pos = dirname.rfind('@');
+  if (pos == std::string::npos || pos == 0) {
+    return false;
+  }
+  Slice rest(dirname.data() + pos + 1, dirname.size() - pos - 1);
+  uint64_t ts;
+  if (!ConsumeDecimalNumber(&rest, &ts) || !rest.empty()) {
+    return false;
+  }
+  *node = dirname.substr(0, pos);
+  *start_ts = ts;
+  return true;
+}
+
+// The split of "dir" covering its logs up to the end of log file
+// "last_number", of "last_size" bytes.
+static std::string SplitDirName(const std::string& dir, uint64_t last_number,
+                                uint64_t last_size) {
+  return dir + "/split_" + Uint64ToString(last_number) + "_"
+      + Uint64ToString(last_size);
+}
+
+static std::string SplitFileName(const std::string& split_dir,
+                                 const std::string& tablet) {
+  std::string name = tablet;
+  std::replace(name.begin(), name.end(), '/', '#');
+  return split_dir + "/" + name + ".log";
+}
+
+// Shared log records are <tablet name><write batch>, the tablet name
+// is length prefixed.
+static void EncodeRecord(const std::string& tablet, const Slice& batch,
+                         std::string* rep) {
+  rep->clear();
+  PutLengthPrefixedSlice(rep, tablet);
+  rep->append(batch.data(), batch.size());
+}
+
+static bool DecodeRecord(Slice record, Slice* tablet, Slice* batch) {
+  if (!GetLengthPrefixedSlice(&record, tablet) || record.size() < 12) {
+    return false;
+  }
+  *batch = record;
+  return true;
+}
+
+// Log numbers of the shared log files in "dir", in write order.
+static Status GetLogNumbers(Env* env, const std::string& dir,
+                            std::vector<uint64_t>* numbers) {
+  std::vector<std::string> filenames;
+  Status s = env->GetChildren(dir, &filenames);
+  uint64_t number;
+  FileType type;
+  for (size_t i = 0; s.ok() && i < filenames.size(); ++i) {
+    if (ParseFileName(filenames[i], &number, &type) && type == kLogFile) {
+      numbers->push_back(number);
+    }
+  }
+  std::sort(numbers->begin(), numbers->end());
+  return s;
+}
+
+struct SharedLogReporter : public log::Reader::Reporter {
+  Logger* info_log;
+  std::string fname;
+  virtual void Corruption(size_t bytes, const Status& s) {
+    // the tail of the last file may be lost with the process
+    Log(info_log, "[shared_log] %s: dropping %d bytes; %s",
+        fname.c_str(), static_cast<int>(bytes), s.ToString().c_str());
+  }
+};
+
+namespace {
+struct SplitWriter {
+  WritableFile* file;
+  log::Writer* log;
+};
+}  // namespace
+
+// Split all the logs in "dir" by tablet, into <*split_dir>/<tablet>.log.
+// The split is named by the end of the logs it covers, so it is reused by
+// tablets loaded concurrently, and done again if the owner of "dir" is
+// still alive and has appended more records since.
+static Status SplitSharedLog(Env* env, Logger* info_log, const std::string& dir,
+                             std::string* split_dir) {
+  static port::Mutex split_mutex;
+  MutexLock l(&split_mutex);
+
+  std::vector<uint64_t> numbers;
+  Status s = GetLogNumbers(env, dir, &numbers);
+  uint64_t last_number = 0;
+  uint64_t last_size = 0;
+  if (s.ok() && !numbers.empty()) {
+    last_number = numbers.back();
+    s = env->GetFileSize(LogHexFileName(dir, last_number), &last_size);
+  }
+  if (!s.ok()) {
+    return s;
+  }
+  *split_dir = SplitDirName(dir, last_number, last_size);
+  if (env->FileExists(*split_dir).ok()) {
+    return Status::OK();
+  }
+  std::string tmp_dir = *split_dir + "." + Uint64ToString(env->NowMicros()) + ".tmp";
+  s = env->CreateDir(tmp_dir);
+  if (!s.ok()) {
+    return s;
+  }
+  Log(info_log, "[shared_log] split %s, %lu log files",
+      dir.c_str(), numbers.size());
+
+  std::map<std::string, SplitWriter> writers;
+  uint64_t records = 0;
+  for (size_t i = 0; s.ok() && i < numbers.size(); ++i) {
+    SharedLogReporter reporter;
+    reporter.info_log = info_log;
+    reporter.fname = LogHexFileName(dir, numbers[i]);
+    SequentialFile* file;
+    s = env->NewSequentialFile(reporter.fname, &file);
+    if (!s.ok()) {
+      break;
+    }
+    log::Reader reader(file, &reporter, true, 0);
+    std::string scratch;
+    Slice record, tablet, batch;
+    while (s.ok() && reader.ReadRecord(&record, &scratch)) {
+      if (!DecodeRecord(record, &tablet, &batch)) {
+        reporter.Corruption(record.size(), Status::Corruption("bad record"));
+        continue;
+      }
+      SplitWriter& w = writers[tablet.ToString()];
+      if (w.log == NULL) {
+        s = env->NewWritableFile(SplitFileName(tmp_dir, tablet.ToString()),
+                                 &w.file, EnvOptions());
+        if (!s.ok()) {
+          writers.erase(tablet.ToString());
+          break;
+        }
+        w.log = new log::Writer(w.file);
+      }
+      s = w.log->AddRecord(record);
+      ++records;
+    }
+    delete file;
+  }
+
+  std::map<std::string, SplitWriter>::iterator it = writers.begin();
+  for (; it != writers.end(); ++it) {
+    delete it->second.log;
+    if (s.ok()) {
+      s = it->second.file->Sync();
+    }
+    if (s.ok()) {
+      s = it->second.file->Close();
+    }
+    delete it->second.file;
+  }
+
+  if (s.ok() && !env->FileExists(*split_dir).ok()) {
+    s = env->RenameFile(tmp_dir, *split_dir);
+  }
+  if (env->FileExists(tmp_dir).ok()) {
+    env->DeleteDirRecursive(tmp_dir);
+  }
+  if (!s.ok() && env->FileExists(*split_dir).ok()) {
+    // split by another tablet server
+    s = Status::OK();
+  }
+  Log(info_log, "[shared_log] split %s done, %lu records of %lu tablets: %s",
+      split_dir->c_str(), records, writers.size(), s.ToString().c_str());
+  return s;
+}
+
+struct SharedLog::Writer {
+  const std::string* tablet;   // NULL for a sync barrier
+  Slice batch;
+  bool sync;
+  bool done;
+  Status status;
+  port::CondVar cv;
+
+  explicit Writer(port::Mutex* mu)
+    : tablet(NULL), sync(false), done(false), cv(mu) {}
+};
+
+SharedLog::SharedLog(Env* env, const std::string& dir, uint64_t log_file_size,
+                     uint64_t max_log_num, Logger* info_log,
+                     int32_t write_timeout_sec, int max_block_log_num)
+    : env_(env), dir_(dir), log_file_size_(log_file_size),
+      max_log_num_(max_log_num), info_log_(info_log),
+      write_timeout_sec_(write_timeout_sec),
+      max_block_log_num_(max_block_log_num),
+      logfile_(NULL), log_(NULL), log_blocked_(false), log_size_(0),
+      force_switch_(false), next_file_number_(1) {
+}
+
+SharedLog::~SharedLog() {
+  assert(writers_.empty());
+  if (log_ != NULL) {
+    // the writer deletes the file once its pending write returns
+    if (!log_blocked_) {
+      logfile_->Close();
+    }
+    log_->Stop(false);
+  }
+  for (size_t i = 0; i < files_.size(); ++i) {
+    delete files_[i];
+  }
+}
+
+Status SharedLog::Open() {
+  size_t pos = dir_.rfind('/');
+  if (pos != std::string::npos && pos > 0) {
+    env_->CreateDir(dir_.substr(0, pos));
+  }
+  env_->CreateDir(dir_);
+
+  std::vector<uint64_t> numbers;
+  Status s = GetLogNumbers(env_, dir_, &numbers);
+  if (!s.ok()) {
+    Log(info_log_, "[shared_log] fail to list %s: %s",
+        dir_.c_str(), s.ToString().c_str());
+    return s;
+  }
+  if (!numbers.empty()) {
+    next_file_number_ = numbers.back() + 1;
+  }
+  s = NewLogFile();
+  Log(info_log_, "[shared_log] open %s: %s", dir_.c_str(), s.ToString().c_str());
+  return s;
+}
+
+// REQUIRES: mutex_ is NOT held
+// REQUIRES: called by the leader of writers_, or before any write
+Status SharedLog::NewLogFile() {
+  uint64_t number;
+  {
+    MutexLock l(&mutex_);
+    number = next_file_number_++;
+  }
+  WritableFile* file = NULL;
+  std::string fname = LogHexFileName(dir_, number);
+  Status s = env_->NewWritableFile(fname, &file, EnvOptions());
+  if (!s.ok()) {
+    Log(info_log_, "[shared_log] fail to open %s: %s",
+        fname.c_str(), s.ToString().c_str());
+    return s;
+  }
+  if (log_ != NULL) {
+    if (log_blocked_) {
+      // leave the hanging file to its writer thread
+      Log(info_log_, "[shared_log] switch from blocked log file of %s", dir_.c_str());
+      log_->Stop(true);
+      log::AsyncWriter::BlockLogNumInc();
+    } else {
+      logfile_->Close();
+      log_->Stop(false);
+    }
+  }
+  logfile_ = file;
+  log_ = new log::AsyncWriter(file, write_timeout_sec_ > 0);
+  log_blocked_ = false;
+
+  LogFile* f = new LogFile;
+  f->number = number;
+  MutexLock l(&mutex_);
+  files_.push_back(f);
+  log_size_ = 0;
+  force_switch_ = false;
+
+  // ask the tablets which keep the oldest files alive to dump memtables
+  need_flush_.clear();
+  for (size_t i = 0; i + max_log_num_ < files_.size(); ++i) {
+    std::map<std::string, uint64_t>::iterator it = files_[i]->last_seq.begin();
+    for (; it != files_[i]->last_seq.end(); ++it) {
+      std::map<std::string, uint64_t>::iterator p = persisted_.find(it->first);
+      if (p != persisted_.end() && p->second < it->second) {
+        need_flush_.insert(it->first);
+      }
+    }
+  }
+  if (!need_flush_.empty()) {
+    Log(info_log_, "[shared_log] %lu log files, %lu tablets need flush",
+        files_.size(), need_flush_.size());
+  }
+  return s;
+}
+
+Status SharedLog::AddRecord(const std::string& tablet, const Slice& batch,
+                            bool sync) {
+  Writer w(&mutex_);
+  w.tablet = &tablet;
+  w.batch = batch;
+  w.sync = sync;
+
+  MutexLock l(&mutex_);
+  writers_.push_back(&w);
+  while (!w.done && &w != writers_.front()) {
+    w.cv.Wait();
+  }
+  if (w.done) {
+    return w.status;
+  }
+
+  std::vector<Writer*> group;
+  bool sync_group = false;
+  size_t group_size = 0;
+  std::deque<Writer*>::iterator iter = writers_.begin();
+  for (; iter != writers_.end(); ++iter) {
+    Writer* writer = *iter;
+    if (!group.empty() && group_size + writer->batch.size() > kMaxGroupSize) {
+      break;
+    }
+    group_size += writer->batch.size();
+    sync_group = sync_group || writer->sync;
+    group.push_back(writer);
+  }
+  bool need_switch = force_switch_ || log_size_ >= log_file_size_;
+
+  mutex_.Unlock();
+  Status s;
+  if (need_switch) {
+    s = NewLogFile();
+  }
+  if (s.ok() && log_ == NULL) {
+    s = Status::IOError(dir_, "shared log not opened");
+  }
+  std::vector<std::string> records;
+  uint64_t written = 0;
+  for (size_t i = 0; s.ok() && i < group.size(); ++i) {
+    if (group[i]->tablet == NULL) {
+      continue;
+    }
+    records.push_back(std::string());
+    EncodeRecord(*group[i]->tablet, group[i]->batch, &records.back());
+    written += records.back().size();
+  }
+  if (s.ok()) {
+    s = WriteGroup(records, sync_group);
+  }
+  mutex_.Lock();
+
+  if (s.ok()) {
+    LogFile* f = files_.back();
+    for (size_t i = 0; i < group.size(); ++i) {
+      const Slice& batch = group[i]->batch;
+      if (group[i]->tablet == NULL) {
+        continue;
+      }
+      uint64_t seq = DecodeFixed64(batch.data()) + DecodeFixed32(batch.data() + 8) - 1;
+      uint64_t& last_seq = f->last_seq[*group[i]->tablet];
+      last_seq = std::max(last_seq, seq);
+    }
+    log_size_ += written;
+  } else {
+    Log(info_log_, "[shared_log] fail to write %s: %s",
+        dir_.c_str(), s.ToString().c_str());
+    force_switch_ = true;
+  }
+
+  for (size_t i = 0; i < group.size(); ++i) {
+    Writer* ready = writers_.front();
+    writers_.pop_front();
+    assert(ready == group[i]);
+    if (ready != &w) {
+      ready->status = s;
+      ready->done = true;
+      ready->cv.Signal();
+    }
+  }
+  if (!writers_.empty()) {
+    writers_.front()->cv.Signal();
+  }
+
+  if (need_switch && s.ok()) {
+    DeleteObsoleteFiles();
+  }
+  return s;
+}
+
+Status SharedLog::Sync() {
+  Writer w(&mutex_);
+  w.sync = true;
+  w.tablet = NULL;
+  // go through the group commit path, so records written by the
+  // current leader are synced as well
+  MutexLock l(&mutex_);
+  writers_.push_back(&w);
+  while (!w.done && &w != writers_.front()) {
+    w.cv.Wait();
+  }
+  if (w.done) {
+    return w.status;
+  }
+  // stay at the front of writers_ while syncing, so no other writer
+  // becomes the leader and switches or appends to logfile_ meanwhile
+  Status s;
+  if (log_blocked_) {
+    s = Status::IOError(dir_, "shared log blocked");
+  } else if (log_ != NULL) {
+    mutex_.Unlock();
+    bool switched = false;
+    log_->Sync();
+    s = WaitLog(write_timeout_sec_ > 0 ? write_timeout_sec_ : -1, &switched);
+    if (s.ok() && switched) {
+      // the records before the barrier are left in the abandoned file
+      s = Status::IOError(dir_, "sync timeout, shared log switched");
+    }
+    mutex_.Lock();
+  }
+  if (!s.ok()) {
+    Log(info_log_, "[shared_log] fail to sync %s: %s",
+        dir_.c_str(), s.ToString().c_str());
+    force_switch_ = true;
+  }
+  assert(writers_.front() == &w);
+  writers_.pop_front();
+  if (!writers_.empty()) {
+    writers_.front()->cv.Signal();
+  }
+  return s;
+}
+
+// Write "records" to the log file and sync it if "sync".  If the log file
+// hangs and is switched meanwhile, write them again to the new one: the
+// records may then be read twice on recovery, where the batches already
+// replayed are skipped.
+// REQUIRES: mutex_ is NOT held
+// REQUIRES: called by the leader of writers_
+Status SharedLog::WriteGroup(const std::vector<std::string>& records, bool sync) {
+  int32_t wait_sec = write_timeout_sec_ > 0 ? write_timeout_sec_ : -1;
+  Status s;
+  bool switched = true;
+  while (s.ok() && switched) {
+    switched = false;
+    if (!records.empty()) {
+      log_->AddRecords(records);
+      s = WaitLog(wait_sec, &switched);
+    }
+    if (s.ok() && !switched && sync) {
+      log_->Sync();
+      s = WaitLog(wait_sec, &switched);
+    }
+    if (wait_sec > 0) {
+      wait_sec <<= 1;
+    }
+  }
+  return s;
+}
+
+// Wait for the pending write or sync of log_, at most "wait_sec" seconds
+// if it is not negative.  Past it, the file is left to its writer thread
+// and a new one is opened, "*switched" is set for the caller to write
+// again.  Once too many log files hang, wait until this one returns.
+// REQUIRES: mutex_ is NOT held
+// REQUIRES: called by the leader of writers_
+Status SharedLog::WaitLog(int32_t wait_sec, bool* switched) {
+  *switched = false;
+  Status s = log_->WaitDone(wait_sec);
+  if (!s.IsTimeOut()) {
+    return s;
+  }
+  log_blocked_ = true;
+  if (log::AsyncWriter::BlockLogNum() >= max_block_log_num_) {
+    Log(info_log_, "[shared_log] %s time out after %d s, %d blocked log files, "
+        "keep waiting", dir_.c_str(), wait_sec, log::AsyncWriter::BlockLogNum());
+    s = log_->WaitDone(-1);
+    log_blocked_ = false;
+    return s;
+  }
+  Log(info_log_, "[shared_log] %s time out after %d s, switch log",
+      dir_.c_str(), wait_sec);
+  s = NewLogFile();
+  *switched = s.ok();
+  return s;
+}
+
+void SharedLog::Register(const std::string& tablet, uint64_t persisted_seq) {
+  MutexLock l(&mutex_);
+  persisted_[tablet] = persisted_seq;
+}
+
+void SharedLog::SetPersistedSequence(const std::string& tablet, uint64_t seq) {
+  MutexLock l(&mutex_);
+  std::map<std::string, uint64_t>::iterator it = persisted_.find(tablet);
+  if (it == persisted_.end() || it->second >= seq) {
+    return;
+  }
+  it->second = seq;
+  need_flush_.erase(tablet);
+  DeleteObsoleteFiles();
+}
+
+void SharedLog::Unregister(const std::string& tablet) {
+  MutexLock l(&mutex_);
+  persisted_.erase(tablet);
+  need_flush_.erase(tablet);
+  for (size_t i = 0; i < files_.size(); ++i) {
+    files_[i]->last_seq.erase(tablet);
+  }
+  DeleteObsoleteFiles();
+}
+
+bool SharedLog::NeedFlush(const std::string& tablet) {
+  MutexLock l(&mutex_);
+  return need_flush_.erase(tablet) > 0;
+}
+
+void SharedLog::GetTabletsToFlush(std::vector<std::string>* tablets) {
+  MutexLock l(&mutex_);
+  tablets->assign(need_flush_.begin(), need_flush_.end());
+  need_flush_.clear();
+}
+
+// A log file is obsolete when all its records are dumped to sst, or
+// belong to unloaded tablets.  Records of tablets failed to unload
+// are kept, they are replayed when the tablet is loaded again.
+// REQUIRES: mutex_ is held
+void SharedLog::DeleteObsoleteFiles() {
+  mutex_.AssertHeld();
+  std::vector<uint64_t> obsolete;
+  std::deque<LogFile*>::iterator it = files_.begin();
+  while (it + 1 < files_.end()) {
+    LogFile* f = *it;
+    std::map<std::string, uint64_t>::iterator t = f->last_seq.begin();
+    for (; t != f->last_seq.end(); ++t) {
+      std::map<std::string, uint64_t>::iterator p = persisted_.find(t->first);
+      if (p == persisted_.end() || p->second < t->second) {
+        break;
+      }
+    }
+    if (t == f->last_seq.end()) {
+      obsolete.push_back(f->number);
+      delete f;
+      it = files_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (obsolete.empty()) {
+    return;
+  }
+
+  mutex_.Unlock();
+  for (size_t i = 0; i < obsolete.size(); ++i) {
+    std::string fname = LogHexFileName(dir_, obsolete[i]);
+    Status s = env_->DeleteFile(fname);
+    Log(info_log_, "[shared_log] delete obsolete %s: %s",
+        fname.c_str(), s.ToString().c_str());
+  }
+  mutex_.Lock();
+}
+
+struct SharedLogReader::Reporter : public SharedLogReporter {
+};
+
+SharedLogReader::SharedLogReader(Env* env, Logger* info_log,
+                                 const std::string& dir,
+                                 const std::string& tablet, SharedLog* live)
+    : env_(env), info_log_(info_log), dir_(dir), tablet_(tablet), live_(live),
+      next_file_(0), reporter_(new Reporter), file_(NULL), reader_(NULL) {
+  reporter_->info_log = info_log;
+}
+
+SharedLogReader::~SharedLogReader() {
+  CloseFile();
+  delete reporter_;
+}
+
+Status SharedLogReader::Open() {
+  if (!env_->FileExists(dir_).ok()) {
+    // the shared log is gone with all tablets of it loaded, so all
+    // the records of this tablet were dumped before
+    Log(info_log_, "[shared_log] %s not found, nothing to recover for %s",
+        dir_.c_str(), tablet_.c_str());
+    return status_;
+  }
+  if (live_ == NULL) {
+    std::string split_dir;
+    status_ = SplitSharedLog(env_, info_log_, dir_, &split_dir);
+    std::string fname = SplitFileName(split_dir, tablet_);
+    if (status_.ok() && env_->FileExists(fname).ok()) {
+      files_.push_back(fname);
+    }
+    return status_;
+  }
+
+  // records of a log being written are not split, read all of them
+  status_ = live_->Sync();
+  std::vector<uint64_t> numbers;
+  if (status_.ok()) {
+    status_ = GetLogNumbers(env_, dir_, &numbers);
+  }
+  for (size_t i = 0; i < numbers.size(); ++i) {
+    files_.push_back(LogHexFileName(dir_, numbers[i]));
+  }
+  return status_;
+}
+
+bool SharedLogReader::Next(Slice* batch) {
+  Slice record, tablet;
+  while (status_.ok()) {
+    if (reader_ == NULL && !OpenNextFile()) {
+      return false;
+    }
+    if (!reader_->ReadRecord(&record, &scratch_)) {
+      CloseFile();
+      continue;
+    }
+    if (!DecodeRecord(record, &tablet, batch)) {
+      reporter_->Corruption(record.size(), Status::Corruption("bad record"));
+      continue;
+    }
+    if (tablet == tablet_) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SharedLogReader::OpenNextFile() {
+  while (next_file_ < files_.size()) {
+    reporter_->fname = files_[next_file_++];
+    Status s = env_->NewSequentialFile(reporter_->fname, &file_);
+    if (s.ok()) {
+      reader_ = new log::Reader(file_, reporter_, true, 0);
+      return true;
+    }
+    // a live log file may be deleted after it was listed
+    if (live_ == NULL || !s.IsNotFound()) {
+      status_ = s;
+      return false;
+    }
+  }
+  return false;
+}
+
+void SharedLogReader::CloseFile() {
+  delete reader_;
+  reader_ = NULL;
+  delete file_;
+  file_ = NULL;
+}
+
+}  // namespace leveldb
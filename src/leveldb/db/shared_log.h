@@ -0,0 +1,178 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// SharedLog is a commit log shared by all tablets of a tablet server.
+// Instead of syncing one log file per tablet, every tablet appends its
+// write batches, tagged with the tablet name, to a single group-committed
+// log under <root>/<node>@<start_ts>/.
+//
+// A tablet writing to a shared log leaves a marker file in its own
+// directory, naming the shared log it writes to.  When the tablet is
+// loaded again after an unclean shutdown, it reads its records back from
+// that shared log.  The shared log of another process is split by tablet
+// first, like the WAL split of HBase.  The split is shared by all of its
+// tablets, and done again if that process has appended to it since.
+
+#ifndef STORAGE_LEVELDB_DB_SHARED_LOG_H_
+#define STORAGE_LEVELDB_DB_SHARED_LOG_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "leveldb/env.h"
+#include "leveldb/status.h"
+#include "port/port.h"
+
+namespace leveldb {
+
+namespace log {
+class AsyncWriter;
+class Reader;
+}
+
+// Name of the shared log directory of the process of "node" started at
+// "start_ts".  ':' in "node" is not allowed in a dfs path and is encoded.
+extern std::string SharedLogDirName(const std::string& root,
+                                    const std::string& node,
+                                    uint64_t start_ts);
+
+// "node" as encoded in the shared log directory name.
+extern std::string SharedLogNodeName(const std::string& node);
+
+// Parse the last component of a shared log directory name.
+extern bool ParseSharedLogDirName(const std::string& dirname,
+                                  std::string* node,
+                                  uint64_t* start_ts);
+
+class SharedLog {
+ public:
+  // "max_log_num" is the number of log files kept before the tablets
+  // pinning the oldest one are asked to dump their memtables.
+  // If "write_timeout_sec" > 0, the log file is written by a thread of its
+  // own, and a write or sync lasting longer switches to a new log file,
+  // as long as fewer than "max_block_log_num" files of the process hang.
+  SharedLog(Env* env, const std::string& dir, uint64_t log_file_size,
+            uint64_t max_log_num, Logger* info_log,
+            int32_t write_timeout_sec = 0, int max_block_log_num = 0);
+  ~SharedLog();
+
+  Status Open();
+
+  const std::string& dir() const { return dir_; }
+
+  // Append a write batch of "tablet".  Records of concurrent callers
+  // are written together and synced once.
+  Status AddRecord(const std::string& tablet, const Slice& batch, bool sync);
+
+  // Wait until all the records added so far are synced.
+  Status Sync();
+
+  // "tablet" starts writing, everything up to "persisted_seq" is in sst.
+  void Register(const std::string& tablet, uint64_t persisted_seq);
+
+  // Records of "tablet" up to "seq" are dumped to sst and no longer
+  // need to be kept.
+  void SetPersistedSequence(const std::string& tablet, uint64_t seq);
+
+  // "tablet" is unloaded with its memtable dumped.
+  void Unregister(const std::string& tablet);
+
+  // Return true once if "tablet" keeps too many log files alive and
+  // should dump its memtable.
+  bool NeedFlush(const std::string& tablet);
+
+  // Like NeedFlush(), for all tablets, including the idle ones.
+  void GetTabletsToFlush(std::vector<std::string>* tablets);
+
+ private:
+  struct Writer;
+  struct LogFile {
+    uint64_t number;
+    // last sequence written by each tablet
+    std::map<std::string, uint64_t> last_seq;
+  };
+
+  Status NewLogFile();
+  Status WriteGroup(const std::vector<std::string>& records, bool sync);
+  Status WaitLog(int32_t wait_sec, bool* switched);
+  void DeleteObsoleteFiles();
+
+  Env* const env_;
+  const std::string dir_;
+  const uint64_t log_file_size_;
+  const uint64_t max_log_num_;
+  Logger* info_log_;
+  const int32_t write_timeout_sec_;
+  const int max_block_log_num_;
+
+  port::Mutex mutex_;
+  std::deque<Writer*> writers_;
+
+  // owned by the leader of writers_
+  WritableFile* logfile_;
+  log::AsyncWriter* log_;
+  bool log_blocked_;   // log_ hangs in a write or sync
+  uint64_t log_size_;
+  bool force_switch_;
+
+  uint64_t next_file_number_;
+  std::deque<LogFile*> files_;   // oldest first, back() is being written
+  std::map<std::string, uint64_t> persisted_;   // registered tablets
+  std::set<std::string> need_flush_;
+
+  // No copying allowed
+  SharedLog(const SharedLog&);
+  void operator=(const SharedLog&);
+};
+
+// Read back the records "tablet" wrote into the shared log "dir".
+// If "dir" belongs to another process, it is split by tablet first.
+// If it is being written by this process, "live" is the writer.
+class SharedLogReader {
+ public:
+  SharedLogReader(Env* env, Logger* info_log, const std::string& dir,
+                  const std::string& tablet, SharedLog* live);
+  ~SharedLogReader();
+
+  Status Open();
+
+  // Return the next write batch of the tablet, or false at the end
+  // of the log or on error.
+  bool Next(Slice* batch);
+
+  const Status& status() const { return status_; }
+
+ private:
+  struct Reporter;
+
+  bool OpenNextFile();
+  void CloseFile();
+
+  Env* const env_;
+  Logger* info_log_;
+  const std::string dir_;
+  const std::string tablet_;
+  SharedLog* live_;
+
+  std::vector<std::string> files_;
+  size_t next_file_;
+  Reporter* reporter_;
+  SequentialFile* file_;
+  log::Reader* reader_;
+  std::string scratch_;
+  Status status_;
+
+  // No copying allowed
+  SharedLogReader(const SharedLogReader&);
+  void operator=(const SharedLogReader&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_SHARED_LOG_H_
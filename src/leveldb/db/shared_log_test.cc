@@ -0,0 +1,371 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "db/shared_log.h"
+
+#include "db/filename.h"
+#include "db/log_async_writer.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class SharedLogTest {
+ public:
+  Env* env_;
+  std::string root_;
+  std::string tablet_[2];
+  std::vector<SharedLog*> logs_;
+
+  SharedLogTest() : env_(Env::Default()) {
+    std::string dir = test::TmpDir() + "/shared_log_test";
+    env_->DeleteDirRecursive(dir);
+    env_->CreateDir(dir);
+    env_->CreateDir(dir + "/table");
+    root_ = dir + "/shared_log";
+    tablet_[0] = dir + "/table/tablet00000001";
+    tablet_[1] = dir + "/table/tablet00000002";
+  }
+
+  ~SharedLogTest() {
+    for (size_t i = 0; i < logs_.size(); ++i) {
+      delete logs_[i];
+    }
+    env_->DeleteDirRecursive(test::TmpDir() + "/shared_log_test");
+  }
+
+  // Start the shared log of a new tablet server process.
+  SharedLog* NewSharedLog(const std::string& node, uint64_t log_file_size) {
+    SharedLog* log = new SharedLog(env_, SharedLogDirName(root_, node, logs_.size() + 1),
+                                   log_file_size, 4, NULL);
+    ASSERT_OK(log->Open());
+    logs_.push_back(log);
+    return log;
+  }
+
+  DB* OpenTablet(int i, SharedLog* log, bool dump_mem_on_shutdown = true) {
+    Options options;
+    options.shared_log = log;
+    options.dump_mem_on_shutdown = dump_mem_on_shutdown;
+    DB* db = NULL;
+    ASSERT_OK(DB::Open(options, tablet_[i], &db));
+    return db;
+  }
+
+  std::string Get(DB* db, const std::string& k) {
+    std::string result;
+    Status s = db->Get(ReadOptions(), k, &result);
+    if (s.IsNotFound()) {
+      result = "NOT_FOUND";
+    } else if (!s.ok()) {
+      result = s.ToString();
+    }
+    return result;
+  }
+
+  int CountLogFiles(const std::string& dir) {
+    std::vector<std::string> filenames;
+    env_->GetChildren(dir, &filenames);
+    int count = 0;
+    uint64_t number;
+    FileType type;
+    for (size_t i = 0; i < filenames.size(); ++i) {
+      if (ParseFileName(filenames[i], &number, &type) && type == kLogFile) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  int CountSplitDirs(const std::string& dir) {
+    std::vector<std::string> filenames;
+    env_->GetChildren(dir, &filenames);
+    int count = 0;
+    for (size_t i = 0; i < filenames.size(); ++i) {
+      if (Slice(filenames[i]).starts_with("split_")) {
+        count++;
+      }
+    }
+    return count;
+  }
+};
+
+TEST(SharedLogTest, DirName) {
+  std::string dir = SharedLogDirName("/root", "host:8000", 123);
+  ASSERT_EQ("/root/host_8000@123", dir);
+  std::string node;
+  uint64_t start_ts = 0;
+  ASSERT_TRUE(ParseSharedLogDirName("host_8000@123", &node, &start_ts));
+  ASSERT_EQ(SharedLogNodeName("host:8000"), node);
+  ASSERT_EQ(123U, start_ts);
+  ASSERT_TRUE(!ParseSharedLogDirName("host_8000", &node, &start_ts));
+  ASSERT_TRUE(!ParseSharedLogDirName("host_8000@12a", &node, &start_ts));
+  ASSERT_TRUE(!ParseSharedLogDirName("@123", &node, &start_ts));
+}
+
+TEST(SharedLogTest, CleanUnload) {
+  SharedLog* log = NewSharedLog("host:8000", 1 << 20);
+  DB* db = OpenTablet(0, log);
+  ASSERT_OK(db->Put(WriteOptions(), "k1", "v1"));
+  ASSERT_EQ(0, CountLogFiles(tablet_[0]));
+  ASSERT_OK(env_->FileExists(SharedLogMarkerFileName(tablet_[0])));
+  delete db;
+
+  // memtable is dumped on unload, the marker is gone
+  ASSERT_TRUE(!env_->FileExists(SharedLogMarkerFileName(tablet_[0])).ok());
+  db = OpenTablet(0, NULL);
+  ASSERT_EQ("v1", Get(db, "k1"));
+  delete db;
+}
+
+TEST(SharedLogTest, RecoverOnSameNode) {
+  SharedLog* log = NewSharedLog("host:8000", 1 << 20);
+  DB* db[2];
+  for (int i = 0; i < 2; ++i) {
+    db[i] = OpenTablet(i, log, false);
+  }
+  WriteOptions sync;
+  sync.sync = true;
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_OK(db[i]->Put(sync, "k", tablet_[i]));
+    ASSERT_OK(db[i]->Put(WriteOptions(), "k" + tablet_[i], "v"));
+  }
+  // unload without dumping memtables
+  for (int i = 0; i < 2; ++i) {
+    delete db[i];
+  }
+
+  for (int i = 0; i < 2; ++i) {
+    db[i] = OpenTablet(i, log);
+    ASSERT_EQ(tablet_[i], Get(db[i], "k"));
+    ASSERT_EQ("v", Get(db[i], "k" + tablet_[i]));
+    ASSERT_EQ("NOT_FOUND", Get(db[i], "k" + tablet_[1 - i]));
+  }
+  for (int i = 0; i < 2; ++i) {
+    delete db[i];
+  }
+}
+
+TEST(SharedLogTest, SplitOnOtherNode) {
+  SharedLog* log = NewSharedLog("host:8000", 1 << 10);
+  DB* db[2];
+  for (int i = 0; i < 2; ++i) {
+    db[i] = OpenTablet(i, log, false);
+  }
+  for (int k = 0; k < 100; ++k) {
+    for (int i = 0; i < 2; ++i) {
+      char key[16];
+      snprintf(key, sizeof(key), "%08d", k);
+      ASSERT_OK(db[i]->Put(WriteOptions(), key, tablet_[i]));
+    }
+  }
+  ASSERT_TRUE(CountLogFiles(log->dir()) > 1);
+  for (int i = 0; i < 2; ++i) {
+    delete db[i];
+  }
+  ASSERT_OK(log->Sync());
+
+  // the first node is gone, its log is split when the tablets are loaded
+  SharedLog* other = NewSharedLog("host:8001", 1 << 20);
+  for (int i = 0; i < 2; ++i) {
+    db[i] = OpenTablet(i, other);
+    ASSERT_EQ(1, CountSplitDirs(log->dir()));
+    ASSERT_EQ(tablet_[i], Get(db[i], "00000000"));
+    ASSERT_EQ(tablet_[i], Get(db[i], "00000099"));
+    std::string marker;
+    ASSERT_OK(ReadFileToString(env_, SharedLogMarkerFileName(tablet_[i]), &marker));
+    ASSERT_EQ(other->dir(), marker);
+  }
+  for (int i = 0; i < 2; ++i) {
+    delete db[i];
+  }
+}
+
+TEST(SharedLogTest, SplitGrownLog) {
+  SharedLog* log = NewSharedLog("host:8000", 1 << 20);
+  DB* db[2];
+  for (int i = 0; i < 2; ++i) {
+    db[i] = OpenTablet(i, log, false);
+    ASSERT_OK(db[i]->Put(WriteOptions(), "k1", tablet_[i]));
+  }
+  delete db[0];
+  ASSERT_OK(log->Sync());
+
+  // tablet 0 moves to another node while the first one keeps writing
+  SharedLog* other = NewSharedLog("host:8001", 1 << 20);
+  db[0] = OpenTablet(0, other);
+  ASSERT_EQ(tablet_[0], Get(db[0], "k1"));
+  ASSERT_EQ(1, CountSplitDirs(log->dir()));
+
+  ASSERT_OK(db[1]->Put(WriteOptions(), "k2", tablet_[1]));
+  delete db[1];
+  ASSERT_OK(log->Sync());
+
+  // the log has grown since the first split, split it again
+  db[1] = OpenTablet(1, other);
+  ASSERT_EQ(tablet_[1], Get(db[1], "k1"));
+  ASSERT_EQ(tablet_[1], Get(db[1], "k2"));
+  ASSERT_EQ(2, CountSplitDirs(log->dir()));
+  for (int i = 0; i < 2; ++i) {
+    delete db[i];
+  }
+}
+
+TEST(SharedLogTest, DeleteObsoleteFiles) {
+  SharedLog* log = NewSharedLog("host:8000", 1 << 10);
+  DB* db[2];
+  for (int i = 0; i < 2; ++i) {
+    db[i] = OpenTablet(i, log);
+  }
+  std::string value(512, 'v');
+  for (int k = 0; k < 20; ++k) {
+    ASSERT_OK(db[0]->Put(WriteOptions(), "k", value));
+  }
+  // tablet 1 writes once and keeps an old log file alive
+  ASSERT_OK(db[1]->Put(WriteOptions(), "k", value));
+  for (int k = 0; k < 20; ++k) {
+    ASSERT_OK(db[0]->Put(WriteOptions(), "k", value));
+  }
+  std::vector<std::string> tablets;
+  log->GetTabletsToFlush(&tablets);
+  ASSERT_EQ(1U, tablets.size());
+  ASSERT_EQ(tablet_[1], tablets[0]);
+
+  int count = CountLogFiles(log->dir());
+  ASSERT_TRUE(count > 4);
+  delete db[1];
+  log->SetPersistedSequence(tablet_[0], 1000);
+  ASSERT_TRUE(CountLogFiles(log->dir()) < count);
+  delete db[0];
+  ASSERT_EQ(1, CountLogFiles(log->dir()));
+}
+
+namespace {
+struct ConcurrentSyncState {
+  SharedLog* log;
+  port::AtomicPointer stop;
+  port::AtomicPointer failed;
+  port::Mutex mu;
+  int running;
+};
+
+static void ConcurrentSync(void* arg) {
+  ConcurrentSyncState* state = reinterpret_cast<ConcurrentSyncState*>(arg);
+  while (state->stop.Acquire_Load() == NULL) {
+    if (!state->log->Sync().ok()) {
+      state->failed.Release_Store(state);
+    }
+  }
+  MutexLock l(&state->mu);
+  state->running--;
+}
+}  // namespace
+
+// Sync() runs while other writers append and switch the log file.
+TEST(SharedLogTest, ConcurrentSync) {
+  SharedLog* log = NewSharedLog("host:8000", 1 << 10);
+  DB* db = OpenTablet(0, log);
+  ConcurrentSyncState state;
+  state.log = log;
+  state.stop.Release_Store(NULL);
+  state.failed.Release_Store(NULL);
+  state.running = 2;
+  env_->StartThread(ConcurrentSync, &state);
+  env_->StartThread(ConcurrentSync, &state);
+  std::string value(256, 'v');
+  for (int k = 0; k < 200; ++k) {
+    ASSERT_OK(db->Put(WriteOptions(), "k", value));
+  }
+  state.stop.Release_Store(&state);
+  while (true) {
+    MutexLock l(&state.mu);
+    if (state.running == 0) {
+      break;
+    }
+  }
+  ASSERT_TRUE(state.failed.Acquire_Load() == NULL);
+  ASSERT_EQ(value, Get(db, "k"));
+  delete db;
+}
+
+namespace {
+// Sync() of the first file written hangs while hang_ is set.
+class HangEnv : public EnvWrapper {
+ public:
+  port::AtomicPointer hang_;
+  int files_;
+
+  explicit HangEnv(Env* base) : EnvWrapper(base), files_(0) {
+    hang_.Release_Store(NULL);
+  }
+
+  Status NewWritableFile(const std::string& f, WritableFile** r, const EnvOptions& o) {
+    class HangFile : public WritableFile {
+     private:
+      HangEnv* env_;
+      WritableFile* base_;
+
+     public:
+      HangFile(HangEnv* env, WritableFile* base) : env_(env), base_(base) { }
+      ~HangFile() { delete base_; }
+      Status Append(const Slice& data) { return base_->Append(data); }
+      Status Close() { return base_->Close(); }
+      Status Flush() { return base_->Flush(); }
+      Status Sync() {
+        while (env_->hang_.Acquire_Load() != NULL) {
+          env_->SleepForMicroseconds(100000);
+        }
+        return base_->Sync();
+      }
+    };
+
+    Status s = target()->NewWritableFile(f, r, o);
+    if (s.ok() && files_++ == 0) {
+      *r = new HangFile(this, *r);
+    }
+    return s;
+  }
+};
+}  // namespace
+
+// A hanging sync switches to a new log file, where the records are
+// written again.
+TEST(SharedLogTest, SyncTimeout) {
+  HangEnv env(env_);
+  std::string dir = SharedLogDirName(root_, "host:8000", 1);
+  SharedLog* log = new SharedLog(&env, dir, 1 << 20, 4, NULL, 1, 10);
+  ASSERT_OK(log->Open());
+  logs_.push_back(log);
+  DB* db = OpenTablet(0, log, false);
+
+  env.hang_.Release_Store(&env);
+  WriteOptions sync;
+  sync.sync = true;
+  uint64_t start = env_->NowMicros();
+  ASSERT_OK(db->Put(sync, "k1", "v1"));
+  ASSERT_GE(env_->NowMicros() - start, 1000000U);
+  ASSERT_EQ(2, CountLogFiles(dir));
+  ASSERT_EQ(1, log::AsyncWriter::BlockLogNum());
+  ASSERT_OK(db->Put(sync, "k2", "v2"));
+
+  // the abandoned file goes away once its sync returns
+  env.hang_.Release_Store(NULL);
+  while (log::AsyncWriter::BlockLogNum() > 0) {
+    env_->SleepForMicroseconds(100000);
+  }
+  delete db;
+  db = OpenTablet(0, log);
+  ASSERT_EQ("v1", Get(db, "k1"));
+  ASSERT_EQ("v2", Get(db, "k2"));
+  delete db;
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
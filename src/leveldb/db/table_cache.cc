@@ -19,6 +19,20 @@ namespace leveldb {
 struct TableAndFile {
   RandomAccessFile* file;
   Table* table;
+  // A table may outlive the db which opened it (see
+  // DB::KeepTableCacheOnClose()), so it refers to these copies instead
+  // of the comparator and filter policy of the db.
+  const InternalKeyComparator icmp;
+  const InternalFilterPolicy ipolicy;
+
+  explicit TableAndFile(const Options& options)
+      : file(NULL), table(NULL),
+        icmp(static_cast<const InternalKeyComparator*>(
+                options.comparator)->user_comparator()),
+        ipolicy(options.filter_policy == NULL ? NULL :
+                static_cast<const InternalFilterPolicy*>(
+                    options.filter_policy)->user_policy()) {
+  }
 };
 
 static void DeleteEntry(const Slice& key, void* value) {
@@ -34,10 +48,14 @@ static void UnrefEntry(void* arg1, void* arg2) {
   cache->Release(h);
 }
 
+// Inherited files are signed by the db they belong to, so split children
+// loaded on the same node share the tables (and cached blocks) of their parent.
 static std::string GetTableFileSign(const std::string& dbname,
                                     const uint64_t* file_number) {
-    return dbname + std::string(reinterpret_cast<const char*>(file_number),
-                                sizeof(*file_number));
+    std::string sign = (*file_number < (1ull << 63)) ? dbname :
+        RealDbName(dbname, *file_number >> 32 & 0x7fffffff);
+    sign.append(reinterpret_cast<const char*>(file_number), sizeof(*file_number));
+    return sign;
 }
 
 TableCache::TableCache(size_t byte_size)
@@ -92,20 +110,32 @@ Status TableCache::FindTable(const std::string& dbname, const Options* options,
       mu_.Unlock();
       RandomAccessFile* file = NULL;
       Table* table = NULL;
+      TableAndFile* tf = new TableAndFile(*options);
       std::string fname = TableFileName(dbname, file_number);
       s = options->env->NewRandomAccessFile(fname, file_size, &file, EnvOptions(*options));
       if (s.ok()) {
-        s = Table::Open(*options, file, file_size, &table);
+        Options table_options = *options;
+        table_options.comparator = &tf->icmp;
+        if (options->filter_policy != NULL) {
+          table_options.filter_policy = &tf->ipolicy;
+        }
+        // nor to the objects the db frees when it is closed, which the
+        // table never uses
+        table_options.info_log = NULL;
+        table_options.compact_strategy_factory = NULL;
+        table_options.exist_lg_list = NULL;
+        table_options.lg_info_list = NULL;
+        s = Table::Open(table_options, file, file_size, &table);
       }
 
       if (!s.ok()) {
         assert(table == NULL);
         fprintf(stderr, "open sstable file failed: [%s] %s\n", fname.c_str(), s.ToString().c_str());
         delete file;
+        delete tf;
         // We do not cache error results so that if the error is transient,
         // or somebody repairs the file, we recover automatically.
       } else {
-        TableAndFile* tf = new TableAndFile;
         tf->file = file;
         tf->table = table;
         *handle = cache_->Insert(key, tf, table->IndexBlockSize(), &DeleteEntry);
@@ -179,6 +209,34 @@ Status TableCache::Get(const ReadOptions& options,
   return s;
 }
 
+void TableCache::GetCachedBlocks(const std::string& dbname, uint64_t file_number,
+                                 std::vector<uint64_t>* block_offsets,
+                                 uint64_t* budget) {
+  Cache::Handle* handle = cache_->Lookup(Slice(GetTableFileSign(dbname, &file_number)));
+  if (handle != NULL) {
+    Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+    t->GetCachedBlocks(block_offsets, budget);
+    cache_->Release(handle);
+  }
+}
+
+Status TableCache::Prefetch(const Options* options,
+                            const std::string& dbname,
+                            uint64_t file_number,
+                            uint64_t file_size,
+                            const std::vector<uint64_t>& block_offsets,
+                            uint64_t* bytes) {
+  Cache::Handle* handle = NULL;
+  Status s = FindTable(dbname, options, file_number, file_size, &handle);
+  if (s.ok()) {
+    Table* t = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+    ReadOptions read_options(options);
+    s = t->Prefetch(read_options, block_offsets, bytes);
+    cache_->Release(handle);
+  }
+  return s;
+}
+
 void TableCache::Evict(const std::string& dbname, uint64_t file_number) {
   cache_->Erase(Slice(GetTableFileSign(dbname, &file_number)));
 }
@@ -13,6 +13,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include <stdint.h>
 #include "db/dbformat.h"
 #include "leveldb/cache.h"
@@ -61,6 +62,22 @@ class TableCache {
              void* arg,
              void (*handle_result)(void*, const Slice&, const Slice&));
 
+  // If the file is open, append the offsets of its data blocks found in
+  // the block cache, at most "*budget" bytes of them, and decrease
+  // "*budget" accordingly.
+  void GetCachedBlocks(const std::string& dbname, uint64_t file_number,
+                       std::vector<uint64_t>* block_offsets, uint64_t* budget);
+
+  // Open the file, which reads its index and filter blocks, and read the
+  // data blocks at the sorted "block_offsets" into the block cache.
+  // Adds the bytes of data blocks read to "*bytes".
+  Status Prefetch(const Options* options,
+                  const std::string& dbname,
+                  uint64_t file_number,
+                  uint64_t file_size,
+                  const std::vector<uint64_t>& block_offsets,
+                  uint64_t* bytes);
+
   // Evict any entry for the specified file number
   void Evict(const std::string& dbname, uint64_t file_number);
 
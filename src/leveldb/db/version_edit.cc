@@ -10,6 +10,7 @@
 
 #include "db/filename.h"
 #include "db/version_set.h"
+#include "leveldb/compact_strategy.h"
 #include "util/coding.h"
 namespace leveldb {
 
@@ -29,6 +30,8 @@ enum Tag {
   kDeletedFile          = 11,
   kNewFileInfo          = 12,
   kSstFileDataSize      = 13,
+  kFileExpireTs         = 14,
+  kFileCellMeta         = 15,
 
   // no more than 1<<20
   kMaxTag               = 1 << 20,
@@ -154,7 +157,62 @@ void VersionEdit::EncodeTo(std::string* dst) const {
     PutVarint32(dst, str.size() + kMaxTag);
     PutVarint32(dst, kSstFileDataSize);
     dst->append(str.data(), str.size());
+
+    if (f.expire_ts > 0) {
+      str.clear();
+      PutVarint64(&str, f.expire_ts);
+      PutVarint32(dst, str.size() + kMaxTag);
+      PutVarint32(dst, kFileExpireTs);
+      dst->append(str.data(), str.size());
+    }
+
+    if (f.has_cell_meta) {
+      str.clear();
+      PutVarint32(&str, f.has_merge_ops ? 1 : 0);
+      PutVarint64(&str, static_cast<uint64_t>(f.smallest_ts));
+      PutVarint64(&str, static_cast<uint64_t>(f.largest_ts));
+      PutVarint32(&str, f.families.size());
+      for (size_t j = 0; j < f.families.size(); j++) {
+        PutLengthPrefixedSlice(&str, f.families[j].name);
+        PutVarint64(&str, static_cast<uint64_t>(f.families[j].max_ts));
+        PutVarint64(&str, f.families[j].expire_ts);
+      }
+      PutVarint32(dst, str.size() + kMaxTag);
+      PutVarint32(dst, kFileCellMeta);
+      dst->append(str.data(), str.size());
+    }
+  }
+}
+
+static bool GetCellMeta(Slice* input, FileMetaData* f) {
+  uint32_t has_merge_ops = 0;
+  uint64_t smallest_ts = 0;
+  uint64_t largest_ts = 0;
+  uint32_t num = 0;
+  if (!GetVarint32(input, &has_merge_ops) ||
+      !GetVarint64(input, &smallest_ts) ||
+      !GetVarint64(input, &largest_ts) ||
+      !GetVarint32(input, &num)) {
+    return false;
+  }
+  std::vector<FamilyMeta> families(num);
+  for (uint32_t i = 0; i < num; i++) {
+    Slice name;
+    uint64_t max_ts = 0;
+    if (!GetLengthPrefixedSlice(input, &name) ||
+        !GetVarint64(input, &max_ts) ||
+        !GetVarint64(input, &families[i].expire_ts)) {
+      return false;
+    }
+    families[i].name = name.ToString();
+    families[i].max_ts = static_cast<int64_t>(max_ts);
   }
+  f->has_cell_meta = true;
+  f->has_merge_ops = (has_merge_ops != 0);
+  f->smallest_ts = static_cast<int64_t>(smallest_ts);
+  f->largest_ts = static_cast<int64_t>(largest_ts);
+  f->families.swap(families);
+  return true;
 }
 
 static bool GetInternalKey(Slice* input, InternalKey* dst) {
@@ -180,6 +238,10 @@ static bool GetLevel(Slice* input, int* level) {
 
 Status VersionEdit::DecodeNewFileInfo(Slice* input, FileMetaData* f) {
   bool decode_continue = true;
+  f->expire_ts = 0;
+  f->has_cell_meta = false;
+  f->has_merge_ops = false;
+  f->families.clear();
 
   while (decode_continue && input->size() > 0) {
     uint32_t len = 0;
@@ -204,6 +266,22 @@ Status VersionEdit::DecodeNewFileInfo(Slice* input, FileMetaData* f) {
         GetVarint32(input, &tag);
         GetVarint64(input, &f->data_size);
         break;
+      case kFileExpireTs:
+        GetVarint32(input, &len);
+        GetVarint32(input, &tag);
+        GetVarint64(input, &f->expire_ts);
+        break;
+      case kFileCellMeta: {
+        GetVarint32(input, &len);
+        GetVarint32(input, &tag);
+        Slice meta(input->data(), len - kMaxTag);
+        input->remove_prefix(len - kMaxTag);
+        if (!GetCellMeta(&meta, f)) {
+          f->has_cell_meta = false;
+          f->families.clear();
+        }
+        break;
+      }
       default:
         fprintf(stderr, "NewFile %lu without info, skip tag %d, len %d\n",
                 f->number & 0xffffffff,
@@ -434,9 +512,104 @@ std::string VersionEdit::DebugString() const {
     AppendNumberTo(&r, f.ttl_percentage);
     r.append(" ttl_check_ts ");
     AppendNumberTo(&r, f.check_ttl_ts);
+    if (f.expire_ts > 0) {
+      r.append(" expire_ts ");
+      AppendNumberTo(&r, f.expire_ts);
+    }
+    if (f.has_cell_meta) {
+      char buf[64];
+      snprintf(buf, sizeof(buf), " ts %lld .. %lld",
+               static_cast<long long>(f.smallest_ts),
+               static_cast<long long>(f.largest_ts));
+      r.append(buf);
+      if (f.has_merge_ops) {
+        r.append(" merge_ops");
+      }
+      for (size_t j = 0; j < f.families.size(); j++) {
+        r.append(j == 0 ? " families " : ",");
+        r.append(f.families[j].name);
+        r.append(":");
+        AppendNumberTo(&r, f.families[j].expire_ts);
+      }
+    }
   }
   r.append("\n}\n");
   return r;
 }
 
+CellMetaBuilder::CellMetaBuilder()
+    : valid_(true),
+      empty_(true),
+      has_merge_ops_(false),
+      smallest_ts_(0),
+      largest_ts_(0),
+      last_family_(0) {
+}
+
+void CellMetaBuilder::Add(CompactStrategy* strategy, const ParsedInternalKey& ikey,
+                          bool del_tag, int64_t ttl) {
+  Slice family;
+  int64_t ts = 0;
+  TeraKeyType type = TKT_VALUE;
+  if (!valid_) {
+    return;
+  }
+  if (strategy == NULL || !strategy->ExtractCell(ikey.user_key, &family, &ts, &type)) {
+    valid_ = false;
+    return;
+  }
+  if (empty_) {
+    smallest_ts_ = largest_ts_ = ts;
+    empty_ = false;
+  } else if (ts < smallest_ts_) {
+    smallest_ts_ = ts;
+  } else if (ts > largest_ts_) {
+    largest_ts_ = ts;
+  }
+  if (type > TKT_VALUE) {
+    has_merge_ops_ = true;
+  }
+  if (type == TKT_DEL) {
+    // a row deletion mark hides the cells of all families
+    family = Slice();
+  }
+
+  // keys are sorted by row, the family changes on every row at most
+  if (last_family_ >= families_.size() || families_[last_family_].name != family) {
+    std::vector<FamilyMeta>::iterator it = families_.begin();
+    while (it != families_.end() && Slice(it->name).compare(family) < 0) {
+      ++it;
+    }
+    if (it == families_.end() || it->name != family) {
+      FamilyMeta meta;
+      meta.name = family.ToString();
+      meta.max_ts = ts;
+      meta.expire_ts = (ttl > 0) ? ttl : 0;
+      it = families_.insert(it, meta);
+    }
+    last_family_ = it - families_.begin();
+  }
+  FamilyMeta* meta = &families_[last_family_];
+  if (ts > meta->max_ts) {
+    meta->max_ts = ts;
+  }
+  if (ikey.type == kTypeDeletion || del_tag || ttl <= 0) {
+    meta->expire_ts = 0;
+  } else if (meta->expire_ts > 0 && static_cast<uint64_t>(ttl) > meta->expire_ts) {
+    meta->expire_ts = ttl;
+  }
+}
+
+void CellMetaBuilder::Finish(FileMetaData* meta) const {
+  meta->has_cell_meta = valid_ && !empty_;
+  meta->has_merge_ops = has_merge_ops_;
+  meta->smallest_ts = smallest_ts_;
+  meta->largest_ts = largest_ts_;
+  if (meta->has_cell_meta) {
+    meta->families = families_;
+  } else {
+    meta->families.clear();
+  }
+}
+
 }  // namespace leveldb
@@ -11,21 +11,32 @@
 
 #include <map>
 #include <set>
+#include <string>
 #include <utility>
 #include <vector>
 #include "db/dbformat.h"
 
 namespace leveldb {
 
+class CompactStrategy;
 class VersionSet;
 class VersionSetBuilder;
 
+// Cells of a column family in an sst file of a tera table.
+struct FamilyMeta {
+  std::string name;
+  int64_t max_ts;             // latest timestamp, deletion marks included
+  uint64_t expire_ts;         // all cells are expired after it, 0 if some
+                              // never expire or are deletion marks
+};
+
 struct FileMetaData {
   int refs;
   int allowed_seeks;          // Seeks allowed until compaction
   uint64_t check_ttl_ts;       // statistic: Descripe this sst file when to timeout check
   uint64_t ttl_percentage;     // statistic: By default, if 50% entry timeout, will trigger compaction
   uint64_t del_percentage;     // statistic: delete tag's percentage in sst
+  uint64_t expire_ts;          // statistic: all entries are expired after it, 0 if some never expire
   uint64_t number;
   uint64_t file_size;         // File size in bytes
   uint64_t data_size;         // data_size <= file_size
@@ -35,18 +46,56 @@ struct FileMetaData {
   bool largest_fake;          // largest is not real, have out-of-range keys
   bool being_compacted;       // Is this file undergoing compaction?
 
+  // Cell metadata of files of tera tables, see CellMetaBuilder.  The other
+  // fields are valid only if has_cell_meta is true.
+  bool has_cell_meta;
+  bool has_merge_ops;         // has atomic operations, merged with older cells
+  int64_t smallest_ts;        // bounds of the timestamps of the cells,
+  int64_t largest_ts;         // deletion marks included
+  std::vector<FamilyMeta> families;  // sorted by name, row deletion marks
+                                     // under the empty name
+
   FileMetaData() :
       refs(0),
       allowed_seeks(1 << 30),
       check_ttl_ts(0),
       ttl_percentage(0),
       del_percentage(0),
+      expire_ts(0),
       number(0),
       file_size(0),
       data_size(0),
       smallest_fake(false),
       largest_fake(false),
-      being_compacted(false) { }
+      being_compacted(false),
+      has_cell_meta(false),
+      has_merge_ops(false),
+      smallest_ts(0),
+      largest_ts(0) { }
+};
+
+// CellMetaBuilder collects the cell metadata of an sst file from the keys
+// added to it, split by CompactStrategy::ExtractCell().
+class CellMetaBuilder {
+ public:
+  CellMetaBuilder();
+
+  // "del_tag" and "ttl" are the results of CheckTag() of the user key.
+  // No metadata is recorded if "strategy" is NULL or can not split a key.
+  void Add(CompactStrategy* strategy, const ParsedInternalKey& ikey,
+           bool del_tag, int64_t ttl);
+
+  // Save the metadata of the added keys to *meta.
+  void Finish(FileMetaData* meta) const;
+
+ private:
+  bool valid_;
+  bool empty_;
+  bool has_merge_ops_;
+  int64_t smallest_ts_;
+  int64_t largest_ts_;
+  std::vector<FamilyMeta> families_;  // sorted by name
+  size_t last_family_;                // index of the family of the last key
 };
 
 class VersionEdit {
@@ -155,7 +204,8 @@ class VersionEdit {
                const InternalKey& largest,
                uint64_t del_percentage = 0,
                uint64_t check_ttl_ts = 0,
-               uint64_t ttl_percentage = 0) {
+               uint64_t ttl_percentage = 0,
+               uint64_t expire_ts = 0) {
     FileMetaData f;
     f.number = file;
     f.file_size = file_size;
@@ -165,6 +215,7 @@ class VersionEdit {
     f.del_percentage = del_percentage;
     f.ttl_percentage = ttl_percentage;
     f.check_ttl_ts = check_ttl_ts;
+    f.expire_ts = expire_ts;
     new_files_.push_back(std::make_pair(level, f));
   }
 
@@ -7,6 +7,7 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include "db/version_edit.h"
+#include "leveldb/compact_strategy.h"
 #include "util/testharness.h"
 
 namespace leveldb {
@@ -27,6 +28,7 @@ enum Tag {
   kDeletedFile          = 11,
   kNewFileInfo          = 12,
   kSstFileDataSize      = 13,
+  kFileExpireTs         = 14,
 
   // no more than 1<<20
   kMaxTag               = 1 << 20,
@@ -200,6 +202,125 @@ TEST(VersionEditTest, EncodeFileInfoTag) {
   CreateEditWithSstDetail(&edit);
   fprintf(stderr, "%s\n", edit.DebugString().c_str());
 }
+// a file without expire_ts must not take the one of the previous file
+TEST(VersionEditTest, EncodeExpireTs) {
+  VersionEditTest edit;
+  for (int i = 0; i < 4; i++) {
+    FileMetaData f;
+    f.number = 100 + i;
+    f.file_size = 200 + i;
+    f.data_size = f.file_size;
+    f.smallest = InternalKey("apple", 300 + i, kTypeValue);
+    f.largest = InternalKey("zookeeper", 400 + i, kTypeValue);
+    f.expire_ts = (i % 2 == 0) ? 1500000000000000ULL + i : 0;
+    edit.AddFile(i, f);
+  }
+  TestEncodeDecode(edit);
+
+  std::string encoded;
+  edit.EncodeTo(&encoded);
+  VersionEditTest parsed;
+  ASSERT_OK(parsed.DecodeFrom(encoded));
+  std::string debug = parsed.DebugString();
+  ASSERT_TRUE(debug.find("expire_ts 1500000000000000") != std::string::npos);
+  ASSERT_TRUE(debug.find("expire_ts 1500000000000001") == std::string::npos);
+  ASSERT_TRUE(debug.find("expire_ts 1500000000000002") != std::string::npos);
+}
+
+TEST(VersionEditTest, EncodeCellMeta) {
+  VersionEditTest edit;
+  for (int i = 0; i < 4; i++) {
+    FileMetaData f;
+    f.number = 100 + i;
+    f.file_size = 200 + i;
+    f.data_size = f.file_size;
+    f.smallest = InternalKey("apple", 300 + i, kTypeValue);
+    f.largest = InternalKey("zookeeper", 400 + i, kTypeValue);
+    if (i % 2 == 0) {
+      f.has_cell_meta = true;
+      f.has_merge_ops = (i == 2);
+      f.smallest_ts = -5 + i;
+      f.largest_ts = 1500000000000000LL + i;
+      FamilyMeta family;
+      family.name = "cf";
+      family.max_ts = f.largest_ts;
+      family.expire_ts = 1600000000000000ULL + i;
+      f.families.push_back(family);
+      family.name = "meta";
+      family.expire_ts = 0;
+      f.families.push_back(family);
+    }
+    edit.AddFile(i, f);
+  }
+  TestEncodeDecode(edit);
+
+  std::string encoded;
+  edit.EncodeTo(&encoded);
+  VersionEditTest parsed;
+  ASSERT_OK(parsed.DecodeFrom(encoded));
+  std::string debug = parsed.DebugString();
+  ASSERT_TRUE(debug.find("ts -5 .. 1500000000000000 families cf:1600000000000000,meta:0")
+              != std::string::npos);
+  ASSERT_TRUE(debug.find("ts -3 .. 1500000000000002 merge_ops families cf:1600000000000002")
+              != std::string::npos);
+  ASSERT_TRUE(debug.find("1500000000000001") == std::string::npos);
+}
+
+// The first char of a key is its column family and the second its
+// timestamp, keys of family "m" are atomic operations.
+class CellCompactStrategy : public DummyCompactStrategy {
+ public:
+  virtual bool ExtractCell(const Slice& tera_key, Slice* family,
+                           int64_t* ts, TeraKeyType* type) {
+    if (tera_key.size() != 2) {
+      return false;
+    }
+    *family = Slice(tera_key.data(), 1);
+    *ts = tera_key[1] - '0';
+    *type = tera_key.starts_with("m") ? TKT_ADD : TKT_VALUE;
+    return true;
+  }
+};
+
+TEST(VersionEditTest, CellMetaBuilder) {
+  CellCompactStrategy strategy;
+  CellMetaBuilder builder;
+  builder.Add(&strategy, ParsedInternalKey("a5", 1, kTypeValue), false, 100);
+  builder.Add(&strategy, ParsedInternalKey("b3", 1, kTypeValue), false, 200);
+  builder.Add(&strategy, ParsedInternalKey("a7", 1, kTypeValue), false, 300);
+  builder.Add(&strategy, ParsedInternalKey("b2", 1, kTypeValue), true, -1);
+  builder.Add(&strategy, ParsedInternalKey("c9", 1, kTypeValue), false, -1);
+  FileMetaData f;
+  builder.Finish(&f);
+  ASSERT_TRUE(f.has_cell_meta);
+  ASSERT_TRUE(!f.has_merge_ops);
+  ASSERT_EQ(2, f.smallest_ts);
+  ASSERT_EQ(9, f.largest_ts);
+  ASSERT_EQ(3U, f.families.size());
+  ASSERT_EQ("a", f.families[0].name);
+  ASSERT_EQ(7, f.families[0].max_ts);
+  ASSERT_EQ(300U, f.families[0].expire_ts);
+  // a deletion mark never expires
+  ASSERT_EQ("b", f.families[1].name);
+  ASSERT_EQ(0U, f.families[1].expire_ts);
+  ASSERT_EQ(0U, f.families[2].expire_ts);
+
+  builder.Add(&strategy, ParsedInternalKey("m1", 1, kTypeValue), false, 100);
+  builder.Finish(&f);
+  ASSERT_TRUE(f.has_merge_ops);
+  ASSERT_EQ(1, f.smallest_ts);
+
+  // no metadata if some key can not be split
+  builder.Add(&strategy, ParsedInternalKey("kv-key", 1, kTypeValue), false, 100);
+  builder.Finish(&f);
+  ASSERT_TRUE(!f.has_cell_meta);
+  ASSERT_TRUE(f.families.empty());
+
+  CellMetaBuilder empty;
+  empty.Finish(&f);
+  ASSERT_TRUE(!f.has_cell_meta);
+}
+
 TEST(VersionEditTest, OldFormatRead) {
   VersionEditTest edit;
   std::string c1, c3;
@@ -94,7 +94,9 @@ Version::~Version() {
       assert(f->refs > 0);
       f->refs--;
       if (f->refs <= 0) {
-        vset_->table_cache_->Evict(vset_->dbname_, f->number);
+        if (!vset_->keep_table_cache_) {
+          vset_->table_cache_->Evict(vset_->dbname_, f->number);
+        }
         delete f;
       }
     }
@@ -192,6 +194,27 @@ class Version::LevelFileNumIterator : public Iterator {
         row_start_key_(opts.row_start_key, kMaxSequenceNumber, kValueTypeForSeek),
         row_end_key_(opts.row_end_key, kMaxSequenceNumber, kValueTypeForSeek) {
   }
+  // Iterate the files of "*flist" that "v" does not skip for "opts".
+  LevelFileNumIterator(const InternalKeyComparator& icmp,
+                       const std::vector<FileMetaData*>* flist,
+                       const std::string& dbname,
+                       const ReadOptions& opts,
+                       const Version* v)
+      : icmp_(icmp),
+        flist_(&files_),
+        dbname_(dbname),
+        read_single_row_(opts.read_single_row),
+        row_start_key_(opts.row_start_key, kMaxSequenceNumber, kValueTypeForSeek),
+        row_end_key_(opts.row_end_key, kMaxSequenceNumber, kValueTypeForSeek) {
+    for (size_t i = 0; i < flist->size(); i++) {
+      if (!v->SkipFileForRead(opts, (*flist)[i])) {
+        files_.push_back((*flist)[i]);
+      } else if (opts.skipped_files != NULL) {
+        ++*opts.skipped_files;
+      }
+    }
+    index_ = files_.size();  // Marks as invalid
+  }
   virtual bool Valid() const {
     if (index_ >= flist_->size()) {
       return false;
@@ -252,6 +275,7 @@ class Version::LevelFileNumIterator : public Iterator {
   bool read_single_row_;
   InternalKey row_start_key_;
   InternalKey row_end_key_;
+  std::vector<FileMetaData*> files_;  // Files not skipped, if filtered
 
   // Backing store for value().  Holds the file number and size.
   mutable std::string value_buf_;
@@ -281,9 +305,37 @@ Iterator* Version::NewConcatenatingIterator(const ReadOptions& options,
                                             int level) const {
   ReadOptions opts = options;
   opts.db_opt = vset_->options_;
-  return NewTwoLevelIterator(
-      new LevelFileNumIterator(vset_->icmp_, &files_[level], vset_->dbname_, opts),
-      &GetFileIterator, vset_->table_cache_, opts);
+  LevelFileNumIterator* file_iter = NULL;
+  if (options.cell_ts_start > INT64_MIN || options.target_cfs != NULL) {
+    file_iter = new LevelFileNumIterator(vset_->icmp_, &files_[level],
+                                         vset_->dbname_, opts, this);
+  } else {
+    file_iter = new LevelFileNumIterator(vset_->icmp_, &files_[level],
+                                         vset_->dbname_, opts);
+  }
+  return NewTwoLevelIterator(file_iter, &GetFileIterator, vset_->table_cache_, opts);
+}
+
+bool Version::SkipFileForRead(const ReadOptions& options, const FileMetaData* f) const {
+  if (!f->has_cell_meta) {
+    return false;
+  }
+  // Deletion marks and version counts only hide cells with older timestamps,
+  // so cells older than the range start never hide a cell the read returns.
+  if (!may_merge_cells_ && f->largest_ts < options.cell_ts_start) {
+    return true;
+  }
+  if (options.target_cfs == NULL) {
+    return false;
+  }
+  // row deletion marks are recorded under the empty family
+  for (size_t i = 0; i < f->families.size(); i++) {
+    const std::string& name = f->families[i].name;
+    if (name.empty() || options.target_cfs->count(name) > 0) {
+      return false;
+    }
+  }
+  return true;
 }
 
 void Version::AddIterators(const ReadOptions& options,
@@ -293,6 +345,12 @@ void Version::AddIterators(const ReadOptions& options,
   // Merge all level zero files together since they may overlap
   for (size_t i = 0; i < files_[0].size(); i++) {
     FileMetaData* f = files_[0][i];
+    if (SkipFileForRead(opts, f)) {
+      if (opts.skipped_files != NULL) {
+        ++*opts.skipped_files;
+      }
+      continue;
+    }
     Slice smallest = f->smallest_fake ? f->smallest.Encode() : "";
     Slice largest = f->largest_fake ? f->largest.Encode() : "";
     iters->emplace_back(vset_->table_cache_->NewIterator(
@@ -595,6 +653,24 @@ void Version::GetApproximateSizes(uint64_t* size, uint64_t* size_under_level1) {
   }
 }
 
+void Version::GetHotTableFiles(uint32_t lg_id, uint64_t* budget,
+                               std::vector<HotTableFile>* files) {
+  for (int level = 0; level < config::kNumLevels; level++) {
+    for (size_t i = 0; i < files_[level].size(); i++) {
+      const FileMetaData* f = files_[level][i];
+      HotTableFile hot;
+      hot.lg_id = lg_id;
+      hot.number = f->number;
+      hot.size = f->file_size;
+      if (*budget > 0) {
+        vset_->table_cache_->GetCachedBlocks(vset_->dbname_, f->number,
+                                             &hot.block_offsets, budget);
+      }
+      files->push_back(hot);
+    }
+  }
+}
+
 bool Version::FindSplitKey(double ratio, std::string* split_key) {
   assert(ratio >= 0 && ratio <= 1);
   uint64_t size_under_level1;
@@ -975,6 +1051,7 @@ VersionSet::VersionSet(const std::string& dbname,
       options_(options),
       env_opt_(*options),
       table_cache_(table_cache),
+      keep_table_cache_(false),
       icmp_(*cmp),
       db_key_start_(options->key_start, kMaxSequenceNumber, kValueTypeForSeek),
       db_key_end_(options->key_end, kMaxSequenceNumber, kValueTypeForSeek),
@@ -1644,6 +1721,12 @@ void VersionSet::MarkFileNumberUsed(uint64_t number) {
 }
 
 void VersionSet::Finalize(Version* v) {
+  if (options_->compaction_style == kTieredCompaction) {
+    FinalizeTiered(v);
+    return;
+  }
+  FinalizeExpire(v);
+
   // Precomputed best level for next compaction
   int best_del_level = -1;
   int best_del_idx = -1;
@@ -1754,6 +1837,210 @@ void VersionSet::Finalize(Version* v) {
   }
 }
 
+void VersionSet::FinalizeTiered(Version* v) {
+  for (size_t i = 0; i < v->compaction_score_.size(); i++) {
+    v->compaction_level_[i] = i;
+    v->compaction_score_[i] = 0;
+  }
+  FinalizeExpire(v);
+
+  // A tiered compaction merges whole runs, only one of them at a time.
+  for (int level = 0; level < config::kNumLevels; level++) {
+    for (size_t i = 0; i < v->files_[level].size(); i++) {
+      if (v->files_[level][i]->being_compacted) {
+        return;
+      }
+    }
+  }
+
+  double score = v->files_[0].size() /
+      static_cast<double>(config::kL0_CompactionTrigger);
+  int output_level = -1;
+  bool move_run = false;
+  if (score < 1.0 && PickTieredLevel(v, &output_level, &move_run) >= 0) {
+    score = 1.0;
+  }
+  v->compaction_score_[0] = (score < 1.0) ? 0 : score;
+}
+
+void VersionSet::FinalizeExpire(Version* v) {
+  v->expire_trigger_compact_ = NULL;
+  v->expire_trigger_compact_level_ = -1;
+  v->may_merge_cells_ = false;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    for (size_t i = 0; i < v->files_[level].size(); i++) {
+      FileMetaData* f = v->files_[level][i];
+      if (!f->has_cell_meta || f->has_merge_ops) {
+        v->may_merge_cells_ = true;
+      }
+      if (!f->being_compacted && f->expire_ts > 0 &&
+          (v->expire_trigger_compact_ == NULL ||
+           v->expire_trigger_compact_->expire_ts > f->expire_ts) &&
+          IsExpiredFileDroppable(v, level, f)) {
+        v->expire_trigger_compact_ = f;
+        v->expire_trigger_compact_level_ = level;
+      }
+    }
+  }
+}
+
+// An expired file can be deleted as a whole if no older version of its keys
+// shows up again.  Cells expire by their own timestamps, so this holds for
+// files with cell metadata, whose expire_ts has no deletion mark behind it.
+// Other files must not overlap any older file.
+bool VersionSet::IsExpiredFileDroppable(Version* v, int level, FileMetaData* f) {
+  if (f->has_cell_meta) {
+    return true;
+  }
+  const Comparator* ucmp = icmp_.user_comparator();
+  Slice smallest = f->smallest.user_key();
+  Slice largest = f->largest.user_key();
+  if (level == 0) {
+    for (size_t i = 0; i < v->files_[0].size(); i++) {
+      FileMetaData* older = v->files_[0][i];
+      if (older->number < f->number &&
+          ucmp->Compare(older->largest.user_key(), smallest) >= 0 &&
+          ucmp->Compare(older->smallest.user_key(), largest) <= 0) {
+        return false;
+      }
+    }
+  }
+  for (int lvl = level + 1; lvl < config::kNumLevels; lvl++) {
+    if (SomeFileOverlapsRange(icmp_, ucmp, true, v->files_[lvl],
+                              &smallest, &largest)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Each level above 0 holds one sorted run, older runs at larger levels.
+// Return the level whose files should be moved or merged into
+// *output_level, or -1 if no compaction is needed.
+int VersionSet::PickTieredLevel(Version* v, int* output_level, bool* move_run) {
+  const int64_t ratio = options_->tiered_size_ratio;
+
+  // Push runs down to the empty level above the next older run, which
+  // leaves the levels near level-0 empty for new runs.
+  *move_run = true;
+  for (int level = config::kNumLevels - 2; level > 0; level--) {
+    if (v->files_[level].empty() || !v->files_[level + 1].empty()) {
+      continue;
+    }
+    int next = level + 1;
+    while (next < config::kNumLevels && v->files_[next].empty()) {
+      next++;
+    }
+    *output_level = next - 1;
+    return level;
+  }
+
+  // Merge level-0 files into a new run, or into the newest run if it is
+  // not much larger than them or there is no empty level left.
+  *move_run = false;
+  if (v->files_[0].size() >= static_cast<size_t>(config::kL0_CompactionTrigger)) {
+    int first = 1;
+    while (first < config::kNumLevels && v->files_[first].empty()) {
+      first++;
+    }
+    if (first == config::kNumLevels) {
+      *output_level = config::kNumLevels - 1;
+    } else if (first == 1 ||
+               TotalFileSize(v->files_[first]) * 100 <=
+               TotalFileSize(v->files_[0]) * ratio) {
+      *output_level = first;
+    } else {
+      *output_level = first - 1;
+    }
+    return 0;
+  }
+
+  // Merge a run into the next older run if that is not much larger.
+  for (int level = 1; level < config::kNumLevels - 1; level++) {
+    if (!v->files_[level].empty() && !v->files_[level + 1].empty() &&
+        TotalFileSize(v->files_[level + 1]) * 100 <=
+        TotalFileSize(v->files_[level]) * ratio) {
+      *output_level = level + 1;
+      return level;
+    }
+  }
+  return -1;
+}
+
+Compaction* VersionSet::PickTieredCompaction() {
+  Version* v = current_;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    for (size_t i = 0; i < v->files_[level].size(); i++) {
+      if (v->files_[level][i]->being_compacted) {
+        return NULL;
+      }
+    }
+  }
+
+  Compaction* c = PickExpireCompaction();
+  if (c != NULL) {
+    return c;
+  } else {
+    int output_level = -1;
+    bool move_run = false;
+    int level = PickTieredLevel(v, &output_level, &move_run);
+    if (level < 0) {
+      return NULL;
+    }
+    c = new Compaction(level);
+    c->output_level_ = output_level;
+    c->move_run_ = move_run;
+    c->inputs_[0] = v->files_[level];
+    if (!move_run) {
+      c->inputs_[1] = v->files_[output_level];
+    }
+    Log(options_->info_log,
+        "[%s] tiered compaction: %s %d@%d (%ld bytes) + %d@%d (%ld bytes)\n",
+        dbname_.c_str(), move_run ? "move" : "merge",
+        static_cast<int>(c->inputs_[0].size()), level,
+        static_cast<long>(TotalFileSize(c->inputs_[0])),
+        static_cast<int>(c->inputs_[1].size()), output_level,
+        static_cast<long>(TotalFileSize(c->inputs_[1])));
+  }
+
+  c->input_version_ = v;
+  c->input_version_->Ref(); // make sure compacting version will not delete
+  // Small files expire as a whole earlier.
+  c->max_output_file_size_ = options_->sst_size;
+  SetupCompactionBoundary(c);
+
+  c->MarkBeingCompacted(true);
+  if (c->level_ == 0) {
+    level0_compactions_in_progress_.push_back(c);
+  }
+  Finalize(v);
+  return c;
+}
+
+// Drop the first expired file as a whole, which does not conflict with
+// other compactions as its entries are not rewritten.
+Compaction* VersionSet::PickExpireCompaction() {
+  Version* v = current_;
+  FileMetaData* f = v->expire_trigger_compact_;
+  if (f == NULL || f->being_compacted || f->expire_ts > env_->NowMicros()) {
+    return NULL;
+  }
+  Compaction* c = new Compaction(v->expire_trigger_compact_level_);
+  c->output_level_ = c->level_;
+  c->drop_expired_ = true;
+  c->inputs_[0].push_back(f);
+  c->input_version_ = v;
+  c->input_version_->Ref(); // make sure compacting version will not delete
+  c->MarkBeingCompacted(true);
+  Log(options_->info_log,
+      "[%s] compact trigger by expire stragety, level %d, num #%lu, "
+      "file_size %lu, expire_ts %lu\n",
+      dbname_.c_str(), c->level_, (f->number) & 0xffffffff,
+      f->file_size, f->expire_ts);
+  Finalize(v);
+  return c;
+}
+
 Status VersionSet::WriteSnapshot(log::Writer* log) {
   // TODO: Break up into multiple records to reduce memory usage on recovery?
 
@@ -2208,6 +2495,11 @@ void VersionSet::CompactionScore(std::vector<std::pair<double, uint64_t> >* scor
              !v->file_to_compact_->being_compacted) {
     scores->push_back(std::pair<double, uint64_t>(0.1, 0));
   }
+  if (v->expire_trigger_compact_ != NULL &&
+      !v->expire_trigger_compact_->being_compacted &&
+      ts >= v->expire_trigger_compact_->expire_ts) {
+    scores->push_back(std::pair<double, uint64_t>(1.0, 0));
+  }
 
   // delay task
   if (v->ttl_trigger_compact_ != NULL &&
@@ -2217,6 +2509,12 @@ void VersionSet::CompactionScore(std::vector<std::pair<double, uint64_t> >* scor
                      (double)((v->ttl_trigger_compact_->ttl_percentage + 1) / 100.0),
                      ((v->ttl_trigger_compact_->check_ttl_ts - ts + 1000000) / 1000)));
   }
+  if (v->expire_trigger_compact_ != NULL &&
+      !v->expire_trigger_compact_->being_compacted &&
+      ts < v->expire_trigger_compact_->expire_ts) {
+    scores->push_back(std::pair<double, uint64_t>(
+                     1.0, ((v->expire_trigger_compact_->expire_ts - ts + 1000000) / 1000)));
+  }
 }
 
 Compaction* VersionSet::NewSubCompact(Compaction* compact) {
@@ -2308,15 +2606,18 @@ void VersionSet::GenerateSubCompaction(Compaction* compact, std::vector<Compacti
   // generate candidate sub compaction split key
   InternalKeyCompare icmp(&icmp_);
   std::set<std::string, InternalKeyCompare> boundary(icmp);
-  for (int i = compact->level_; i < compact->output_level_; i++ ) {
-    for (size_t j = 0; j < compact->inputs_[i - compact->level_].size(); j++) {
-      FileMetaData* f = compact->inputs_[i - compact->level_][j];
+  // inputs_[1] are the files of output_level_, which may be more than
+  // one level below level_ in tiered compaction
+  const int output_which = (compact->output_level_ == compact->level_) ? 0 : 1;
+  if (output_which == 1) {
+    for (size_t j = 0; j < compact->inputs_[0].size(); j++) {
+      FileMetaData* f = compact->inputs_[0][j];
       boundary.insert(f->smallest.Encode().ToString());
       boundary.insert(f->largest.Encode().ToString());
     }
   }
-  for (size_t j = 1; j < compact->inputs_[compact->output_level_ - compact->level_].size(); j++) {
-    FileMetaData* f = compact->inputs_[compact->output_level_ - compact->level_][j];
+  for (size_t j = 1; j < compact->inputs_[output_which].size(); j++) {
+    FileMetaData* f = compact->inputs_[output_which][j];
     boundary.insert(f->smallest.Encode().ToString());
   }
 
@@ -2382,6 +2683,14 @@ void VersionSet::GenerateSubCompaction(Compaction* compact, std::vector<Compacti
 }
 
 Compaction* VersionSet::PickCompaction() {
+  if (options_->compaction_style == kTieredCompaction) {
+    return PickTieredCompaction();
+  }
+  Compaction* expire_compaction = PickExpireCompaction();
+  if (expire_compaction != NULL) {
+    return expire_compaction;
+  }
+
   int level = -1;
   std::vector<FileMetaData*> inputs;
   bool set_non_trivial = false;
@@ -2706,10 +3015,12 @@ Compaction* VersionSet::CompactRange(
 void VersionSet::ReleaseCompaction(Compaction* c, Status& s) {
   c->MarkBeingCompacted(false);
   assert(level0_compactions_in_progress_.size() <= 1);
-  if (c->level() == 0 && level0_compactions_in_progress_[0] == c) {
+  if (c->level() == 0 && !level0_compactions_in_progress_.empty() &&
+      level0_compactions_in_progress_[0] == c) {
     level0_compactions_in_progress_.resize(0);
   }
-  if (!s.ok()) {
+  if (!s.ok() || c->IsExpiredDrop()) {
+    // expired drop may find unexpired entries and keep the file
     Finalize(current_);
   }
   return;
@@ -2723,7 +3034,9 @@ Compaction::Compaction(int level)
       grandparent_index_(0),
       seen_key_(false),
       overlapped_bytes_(0),
-      force_non_trivial_(false) {
+      force_non_trivial_(false),
+      move_run_(false),
+      drop_expired_(false) {
   for (int i = 0; i < config::kNumLevels; i++) {
     level_ptrs_[i] = 0;
   }
@@ -2739,7 +3052,10 @@ void Compaction::SetNonTrivial(bool non_trivial) {
   force_non_trivial_ = non_trivial;
 }
 bool Compaction::IsTrivialMove() const {
-  if (force_non_trivial_) {
+  if (move_run_) {
+    return true;
+  }
+  if (force_non_trivial_ || drop_expired_) {
     return false;
   }
   // Avoid a move if there is lots of overlapping grandparent data.
@@ -2754,7 +3070,7 @@ bool Compaction::IsTrivialMove() const {
 void Compaction::AddInputDeletions(VersionEdit* edit) {
   for (int which = 0; which < 2; which++) {
     for (size_t i = 0; i < inputs_[which].size(); i++) {
-      edit->DeleteFile(level_ + which, *inputs_[which][i]);
+      edit->DeleteFile(which == 0 ? level_ : output_level_, *inputs_[which][i]);
     }
   }
 }
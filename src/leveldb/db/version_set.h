@@ -116,6 +116,10 @@ class Version {
   void GetApproximateSizes(uint64_t* size, uint64_t* size_under_level1 = NULL);
   bool FindSplitKey(double ratio, std::string* split_key);
   bool FindKeyRange(std::string* smallest_key, std::string* largest_key);
+  // Append the files of this version as files of "lg_id", with at most
+  // "*budget" bytes of their cached data blocks, lower levels first.
+  void GetHotTableFiles(uint32_t lg_id, uint64_t* budget,
+                        std::vector<HotTableFile>* files);
 
   // Return a human readable string that describes this version's contents.
   std::string DebugString() const;
@@ -127,6 +131,8 @@ class Version {
 
   class LevelFileNumIterator;
   Iterator* NewConcatenatingIterator(const ReadOptions&, int level) const;
+  // Return true iff "f" holds nothing the read of "options" needs.
+  bool SkipFileForRead(const ReadOptions& options, const FileMetaData* f) const;
 
   VersionSet* vset_;            // VersionSet to which this Version belongs
   Version* next_;               // Next version in linked list
@@ -146,6 +152,14 @@ class Version {
   // del strategy: delete trigger compaction
   FileMetaData* del_trigger_compact_;
   int del_trigger_compact_level_;
+  // expire strategy: the first file to expire that can be dropped
+  FileMetaData* expire_trigger_compact_;
+  int expire_trigger_compact_level_;
+
+  // Some file may hold atomic operations or has no cell metadata, so the
+  // cells of a file may be merged into older ones on read, which keeps
+  // reads from skipping files by time range.
+  bool may_merge_cells_;
 
   // Level that should be compacted next and its compaction score.
   // Score < 1 means compaction is not strictly needed.  These fields
@@ -160,7 +174,10 @@ class Version {
         ttl_trigger_compact_(NULL),
         ttl_trigger_compact_level_(-1),
         del_trigger_compact_(NULL),
-        del_trigger_compact_level_(-1) {
+        del_trigger_compact_level_(-1),
+        expire_trigger_compact_(NULL),
+        expire_trigger_compact_level_(-1),
+        may_merge_cells_(true) {
     compaction_score_.resize(config::kNumLevels - 1);
     compaction_level_.resize(config::kNumLevels - 1);
     for (size_t i = 0; i < config::kNumLevels - 1; i++) {
@@ -235,6 +252,9 @@ class VersionSet {
   // Mark the specified file number as used.
   void MarkFileNumberUsed(uint64_t number);
 
+  // Do not evict tables of released files from table cache any more.
+  void KeepTableCache() { keep_table_cache_ = true; }
+
   // Return the current log file number.
   uint64_t LogNumber() const { return log_number_; }
 
@@ -301,6 +321,16 @@ class VersionSet {
 
   void Finalize(Version* v);
 
+  // expire strategy
+  void FinalizeExpire(Version* v);
+  bool IsExpiredFileDroppable(Version* v, int level, FileMetaData* f);
+  Compaction* PickExpireCompaction();
+
+  // tiered compaction
+  void FinalizeTiered(Version* v);
+  int PickTieredLevel(Version* v, int* output_level, bool* move_run);
+  Compaction* PickTieredCompaction();
+
   void GetRange(const std::vector<FileMetaData*>& inputs,
                 InternalKey* smallest,
                 InternalKey* largest);
@@ -338,6 +368,7 @@ class VersionSet {
   const Options* const options_;
   EnvOptions env_opt_;
   TableCache* const table_cache_;
+  bool keep_table_cache_;
   const InternalKeyComparator icmp_;
   InternalKey db_key_start_;
   InternalKey db_key_end_;
@@ -387,7 +418,8 @@ class Compaction {
   // "which" must be either 0 or 1
   int num_input_files(int which) const { return inputs_[which].size(); }
 
-  // Return the ith input file at "level()+which" ("which" must be 0 or 1).
+  // Return the ith input file at "level()" or "output_level()" ("which"
+  // must be 0 or 1).
   FileMetaData* input(int which, int i) const { return inputs_[which][i]; }
 
   // Maximum size of files to build during this compaction.
@@ -395,9 +427,14 @@ class Compaction {
 
   void SetNonTrivial(bool non_trivial);
   // Is this a trivial compaction that can be implemented by just
-  // moving a single input file to the next level (no merging or splitting)
+  // moving a single input file to the next level (no merging or splitting),
+  // or all the files of a run to output_level() in tiered compaction
   bool IsTrivialMove() const;
 
+  // Is this a compaction that only deletes its input files, which are
+  // expired as a whole (tiered compaction).
+  bool IsExpiredDrop() const { return drop_expired_; }
+
   // Add all inputs to this compaction as delete operations to *edit.
   void AddInputDeletions(VersionEdit* edit);
 
@@ -462,6 +499,11 @@ class Compaction {
   // support self compaction
   bool force_non_trivial_;
 
+  // tiered compaction: move all the input files to output_level_, or
+  // drop all the input files
+  bool move_run_;
+  bool drop_expired_;
+
   // support parallel compaction
   std::string sub_compact_start_;   // own by child
   std::string sub_compact_end_; // own by child
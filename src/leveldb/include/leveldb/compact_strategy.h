@@ -9,6 +9,7 @@
 #include <string>
 #include "leveldb/iterator.h"
 #include "leveldb/comparator.h"
+#include "leveldb/tera_key.h"
 
 namespace leveldb {
 
@@ -44,6 +45,23 @@ public:
 
     virtual bool CheckTag(const Slice& tera_key, bool* del_tag, int64_t* ttl_tag) = 0;
 
+    // tera-specific, split a tera key into the column family, timestamp and
+    // type recorded in the metadata of sst files.  Return false if the key
+    // has no column family, e.g. it is a key of a kv table.
+    virtual bool ExtractCell(const Slice& tera_key, Slice* family,
+                             int64_t* ts, TeraKeyType* type) {
+        return false;
+    }
+
+    // tera-specific, return when the cells of "family" with timestamps up
+    // to "max_ts" expire under the current schema, given that the latest
+    // of them expired at "expire_ts" when they were written.  Return 0 if
+    // they never expire.
+    virtual int64_t FamilyExpireTime(const Slice& family, int64_t max_ts,
+                                     int64_t expire_ts) {
+        return expire_ts;
+    }
+
     virtual const char* Name() const = 0;
 };
 
@@ -35,6 +35,16 @@ struct Range {
   Range(const Slice& s, const Slice& l) : start(s), limit(l) { }
 };
 
+// A table file of a locality group and the offsets of its data blocks
+// found in the block cache, exported by a db to warm the table cache and
+// block cache of another node up before the db is moved there.
+struct HotTableFile {
+  uint32_t lg_id;
+  uint64_t number;
+  uint64_t size;
+  std::vector<uint64_t> block_offsets;
+};
+
 // A DB is a persistent ordered map from keys to values.
 // A DB is safe for concurrent access from multiple threads without
 // any external synchronization.
@@ -151,6 +161,12 @@ class DB {
   // result: each level's total file size
   virtual void GetCurrentLevelSize(std::vector<int64_t>* result) = 0;
 
+  // tera-specific
+  // Append the bytes of the sst files written by memtable dumps and by
+  // compactions of each lg since the db was opened.
+  virtual void GetWriteBytes(std::vector<uint64_t>* flush_bytes,
+                             std::vector<uint64_t>* compaction_bytes) {}
+
   // Compact the underlying storage for the key range [*begin,*end].
   // In particular, deleted and overwritten versions are discarded,
   // and the data is rearranged to reduce the cost of operations
@@ -185,6 +201,15 @@ class DB {
   // Strategy : Always return True begin shutdown1 finished.
   virtual bool IsShutdown1Finished() const { return false; }
 
+  // Keep the tables of this db in the shared table cache when it is
+  // deleted, for split children opened right after it on the same node.
+  // REQUIRES: Shutdown2() returned OK.
+  virtual void KeepTableCacheOnClose() {}
+
+  // Return all the live table files, with the offsets of at most
+  // "max_bytes" of their data blocks found in the block cache.
+  virtual void GetHotTableFiles(uint64_t max_bytes, std::vector<HotTableFile>* files) {}
+
  private:
   // No copying allowed
   DB(const DB&);
@@ -201,6 +226,12 @@ Status DestroyDB(const std::string& name, const Options& options);
 // on a database that contains important information.
 Status RepairDB(const std::string& dbname, const Options& options);
 
+// Open the table files of the db "dbname" in options.table_cache and read
+// their listed data blocks into the block cache, without opening the db.
+// The bytes of data blocks read are added to "*bytes".
+Status WarmUpDB(const Options& options, const std::string& dbname,
+                const std::vector<HotTableFile>& files, uint64_t* bytes);
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_INCLUDE_DB_H_
@@ -51,6 +51,9 @@ struct EnvOptions {
   bool use_direct_io_read = false;
   bool use_direct_io_write = false;
   uint64_t posix_write_buffer_size = 512 << 10;
+  // mmap random access files within the budget of SetMmapReadBudget(),
+  // ignored if use_direct_io_read
+  bool use_mmap_read = false;
 };
 
 class Env {
@@ -422,6 +425,12 @@ class EnvWrapper : public Env {
 };
 
 Env* NewPosixEnv();
+
+// Limit the total size of the files mapped by the posix envs of the
+// process for EnvOptions::use_mmap_read, files opened beyond it are read
+// by pread().  Files mapped before are not unmapped if it shrinks.
+// Default: 0, no file is mapped.
+void SetMmapReadBudget(uint64_t bytes);
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_INCLUDE_ENV_H_
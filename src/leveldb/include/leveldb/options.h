@@ -32,6 +32,8 @@ class Comparator;
 class Env;
 class FilterPolicy;
 class Logger;
+class RateLimiter;
+class SharedLog;
 
 // DB contents are stored in a set of blocks, each of which holds a
 // sequence of key,value pairs.  Each block may be compressed before
@@ -52,6 +54,17 @@ enum RawKeyFormat {
   kTTLKv,
 };
 
+// How the background compactions of a DB arrange its sst files.
+enum CompactionStyle {
+  // Each level is 10 times as large as the previous one, and a file
+  // is merged into the overlapping files of the next level.
+  kLeveledCompaction = 0,
+  // Each level holds one sorted run, and whole runs are merged once the
+  // older run is not much larger than the newer ones, see
+  // Options::tiered_size_ratio.  Rewrites less data, reads more runs.
+  kTieredCompaction = 1,
+};
+
 // struct for LG properties
 struct LG_info {
   // ID for LG informaction structure
@@ -85,6 +98,10 @@ struct LG_info {
   uint64_t posix_write_buffer_size;
   bool table_builder_batch_write;
   uint64_t table_builder_batch_size;
+  bool use_tera_block_encoding;
+  bool use_mmap_read;
+  CompactionStyle compaction_style;
+  uint32_t tiered_size_ratio;
   // Other LG properties
   // ...
 
@@ -104,7 +121,11 @@ struct LG_info {
         use_direct_io_write(false),
         posix_write_buffer_size(512<<10),
         table_builder_batch_write(false),
-        table_builder_batch_size(0) {}
+        table_builder_batch_size(0),
+        use_tera_block_encoding(false),
+        use_mmap_read(false),
+        compaction_style(kLeveledCompaction),
+        tiered_size_ratio(200) {}
 };
 
 // Options to control the behavior of a database (passed to DB::Open)
@@ -248,6 +269,31 @@ struct Options {
   // AddRecord and Sync will be apllied asynchronously
   bool log_async_mode;
 
+  // number of log streams the write-ahead log is spread over.
+  // Each write group is logged through one idle stream, so up to
+  // log_stream_num groups can be in flight on different files (and
+  // thus different dfs pipelines or devices) at the same time.
+  // Recovery merges all streams by sequence number.
+  // More streams raise write throughput of a hot tablet, at the cost of
+  // more open log files, more syncs and a slower recovery.
+  // Ignored with shared_log, which needs the records of a tablet in
+  // sequence order.
+  // default: 1
+  uint32_t log_stream_num;
+
+  // If non-NULL, the tablet writes its log to this node-level commit log
+  // shared by all tablets of the tablet server instead of its own log
+  // files.  Must outlive the db.
+  // default: NULL
+  SharedLog* shared_log;
+
+  // If non-NULL, the sst files of memtable dumps and compactions are
+  // written through this limiter, usually shared by all tablets of the
+  // tablet server.  Not applied to the lgs with their own env, such as
+  // the in-memory and flash ones.  Must outlive the db.
+  // default: NULL
+  RateLimiter* rate_limiter;
+
   // max number of unsed log files produced by switching log
   // default: 50
   int max_block_log_number;
@@ -348,10 +394,66 @@ struct Options {
   bool table_builder_batch_write;
   uint64_t table_builder_batch_size;
 
+  // If true and raw_key_format is kReadable or kBinary, data blocks store
+  // the row key once per row run and the column family as a dictionary id,
+  // see table/tera_block.cc.  Tables with other keys fall back to the
+  // default block format.
+  // Default: false
+  bool use_tera_block_encoding;
+
+  // If true, data blocks end with a hash index from the user keys to
+  // their restart intervals, which point lookups use to skip the binary
+  // search of the restart array.  Only for kv tables, whose user keys are
+  // equal iff their bytes are equal, ignoring the last 8 bytes of kTTLKv
+  // user keys.
+  // Default: false
+  bool data_block_hash_index;
+
+  // If true, sst files are read through mmap within the budget of
+  // SetMmapReadBudget() (see EnvOptions), and uncompressed blocks are
+  // served from the memory of the file without copying them or inserting
+  // them into block_cache.  For envs whose random access files keep the
+  // data they return valid until deleted, e.g. local files and the
+  // in-memory env.
+  // Default: false
+  bool use_mmap_read;
+
+  // Compaction style of the sst files.
+  // Default: kLeveledCompaction
+  CompactionStyle compaction_style;
+
+  // kTieredCompaction merges a newer run into the next older run if the
+  // older run is at most tiered_size_ratio percent of the size of the
+  // newer one.  Files whose cells are all expired are dropped without
+  // being rewritten.
+  // Default: 200
+  uint32_t tiered_size_ratio;
+
+  // If positive, memtable dumps compress and checksum their data blocks on
+  // up to this many threads of a pool shared by all dbs, while the dumping
+  // thread writes them in order, see TableBuilder::EnableParallelCompression().
+  // Default: 0, the dumping thread builds the whole table
+  int dump_compress_threads;
+
   // Create an Options object with default values for all fields.
   Options();
 };
 
+// Costs of the block reads of a read operation, accumulated by the
+// tables if ReadOptions::trace is set.  Used by the caller to break down
+// the latency of sampled requests, not thread safe.
+struct ReadTrace {
+  uint64_t block_cache_hit;
+  uint64_t block_cache_miss;
+  uint64_t block_read_us;    // reading the missed blocks from storage
+
+  ReadTrace()
+      : block_cache_hit(0),
+        block_cache_miss(0),
+        block_read_us(0) {
+  }
+};
+
 // Options that control read operations
 struct ReadOptions {
   // If true, all data read from underlying storage will be
@@ -379,6 +481,12 @@ struct ReadOptions {
   // Default: NULL
   std::set<uint32_t>* target_lgs;
 
+  // Tera tables: the column families read.  Files holding none of them nor
+  // a row deletion mark are skipped.  If NULL, all of them are read.  Only
+  // used while an iterator is created.
+  // Default: NULL
+  std::set<std::string>* target_cfs;
+
   // if read a single row, optimization may be applied to this read
   bool read_single_row;
   std::string row_start_key;  // start key of this row
@@ -392,21 +500,55 @@ struct ReadOptions {
   // size to prefetch, default:1MB
   uint64_t prefetch_scan_size;
 
+  // If non-NULL, block cache hits/misses and block read time are added
+  // to "trace".
+  // Default: NULL
+  ReadTrace* trace;
+
+  // Tera tables: files whose cells are all older than "cell_ts_start" are
+  // skipped, unless cells of a file may be merged into older ones.
+  // Default: INT64_MIN
+  int64_t cell_ts_start;
+
+  // If non-NULL, the number of files skipped by "cell_ts_start" and
+  // "target_cfs" is added to "*skipped_files" when an iterator is created.
+  // Default: NULL
+  uint64_t* skipped_files;
+
   ReadOptions(const Options* db_option)
       : verify_checksums(false),
         fill_cache(true),
         snapshot(kMaxSequenceNumber),
         target_lgs(NULL),
+        target_cfs(NULL),
         read_single_row(false),
         db_opt(db_option),
         prefetch_scan(false),
-        prefetch_scan_size(1 << 20) {
+        prefetch_scan_size(1 << 20),
+        trace(NULL),
+        cell_ts_start(INT64_MIN),
+        skipped_files(NULL) {
   }
   ReadOptions() {
     *this = ReadOptions(NULL);
   }
 };
 
+// Costs of the stages of a write, filled by DB::Write if
+// WriteOptions::trace is set.
+struct WriteTrace {
+  uint64_t wait_us;       // waiting to lead a write group, or for the
+                          // leader to finish the group of this write
+  uint64_t log_us;        // log AddRecord and Sync
+  uint64_t memtable_us;   // applying to memtables
+
+  WriteTrace()
+      : wait_us(0),
+        log_us(0),
+        memtable_us(0) {
+  }
+};
+
 // Options that control write operations
 struct WriteOptions {
   // If true, the write will be flushed from the operating system
@@ -429,9 +571,14 @@ struct WriteOptions {
 
   bool disable_wal;
 
+  // If non-NULL, the costs of the write stages are stored in "trace".
+  // Default: NULL
+  WriteTrace* trace;
+
   WriteOptions()
       : sync(false),
-        disable_wal(false) {
+        disable_wal(false),
+        trace(NULL) {
   }
 };
 
@@ -0,0 +1,99 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// A RateLimiter bounds the bandwidth of the sst files written by the
+// background jobs of all the dbs sharing it, so that memtable dumps and
+// compactions leave the disk to the foreground reads and writes.
+//
+// Each priority class has its own token bucket: a burst of deep
+// compactions never eats the budget of the memtable dumps, which block the
+// writes when they fall behind.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+#define STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace leveldb {
+
+class Env;
+class WritableFile;
+
+enum IOPriority {
+  kIOFlush = 0,           // memtable dumps
+  kIOL0Compaction = 1,    // compactions of level 0
+  kIODeepCompaction = 2,  // compactions of the other levels
+  kIOPriorityNum
+};
+
+struct RateLimiterOptions {
+  // Max bytes per second written by the jobs of each class, <= 0 for
+  // unlimited.
+  int64_t max_bytes_per_sec[kIOPriorityNum];
+
+  // If > 0, Tune() cuts the rates of the compactions while the latency of
+  // the foreground requests is above it, and raises them back to the max
+  // while the latency is below half of it.  Memtable dumps are never tuned.
+  // Default: 0
+  int64_t target_latency_us;
+
+  // Tune() never cuts the rate of a class below max / min_rate_divisor.
+  // Default: 8
+  int64_t min_rate_divisor;
+
+  // Slow compactions let the level 0 files pile up, which slows down the
+  // reads in turn.  Tune() only cuts the rates while the compaction debt is
+  // below this, and raises them whatever the latency once the debt reaches
+  // 1, i.e. the writes are about to be slowed down.
+  // Default: 0.5
+  double max_cut_debt;
+
+  RateLimiterOptions();
+};
+
+class RateLimiter {
+ public:
+  RateLimiter() { }
+  virtual ~RateLimiter();
+
+  // Block the caller until "bytes" may be written by a job of "pri".
+  virtual void Request(size_t bytes, IOPriority pri) = 0;
+
+  // Current rate of "pri" in bytes per second, <= 0 for unlimited.
+  virtual int64_t GetBytesPerSecond(IOPriority pri) = 0;
+
+  // Set both the max and the current rate of "pri".
+  virtual void SetBytesPerSecond(IOPriority pri, int64_t bytes_per_sec) = 0;
+
+  // Adjust the rates of the compactions by the latency of the foreground
+  // requests measured since the last call.  Called periodically, a latency
+  // <= 0 means there is no foreground request.  "compaction_debt" tells how
+  // far the most loaded db is behind with its compactions: 0 for none, 1
+  // when it reaches the point where its writes are slowed down.
+  virtual void Tune(int64_t fg_latency_us, double compaction_debt) = 0;
+
+  // Bytes requested and microseconds waited by the jobs of "pri" since the
+  // limiter was created.
+  virtual int64_t TotalBytes(IOPriority pri) = 0;
+  virtual int64_t TotalWaitMicros(IOPriority pri) = 0;
+
+ private:
+  // No copying allowed
+  RateLimiter(const RateLimiter&);
+  void operator=(const RateLimiter&);
+};
+
+// Return a new token bucket limiter timed by "env".
+extern RateLimiter* NewRateLimiter(Env* env, const RateLimiterOptions& options);
+
+// Return a file which requests "limiter" for the bytes appended to "base"
+// before writing them.  The returned file owns "base".
+extern WritableFile* NewRateLimitedFile(WritableFile* base,
+                                        RateLimiter* limiter,
+                                        IOPriority pri);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
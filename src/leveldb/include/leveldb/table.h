@@ -10,6 +10,7 @@
 #define STORAGE_LEVELDB_INCLUDE_TABLE_H_
 
 #include <stdint.h>
+#include <vector>
 #include "leveldb/iterator.h"
 
 namespace leveldb {
@@ -83,6 +84,15 @@ class Table {
       void (*handle_result)(void* arg, const Slice& k, const Slice& v));
 
 
+  // Appends the offsets of the data blocks found in the block cache, at
+  // most "*budget" bytes of them, and decreases "*budget" accordingly.
+  void GetCachedBlocks(std::vector<uint64_t>* block_offsets, uint64_t* budget) const;
+
+  // Reads the data blocks at the sorted "block_offsets" which are not in
+  // the block cache yet into it, and adds the bytes read to "*bytes".
+  Status Prefetch(const ReadOptions&, const std::vector<uint64_t>& block_offsets,
+                  uint64_t* bytes);
+
   void ReadMeta(const Footer& footer);
   void ReadFilter(const Slice& filter_handle_value);
 
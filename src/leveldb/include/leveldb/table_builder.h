@@ -81,12 +81,29 @@ class TableBuilder {
   // Size of the saved space of compression
   uint64_t SavedSize() const;
 
+  // Advanced operation: compress and checksum the data blocks on up to
+  // "threads" threads of a pool shared by all builders.  The calling
+  // thread appends the finished blocks to the file in order while it adds
+  // keys, so slow writes never hold the pool threads.  Until Finish(),
+  // FileSize() counts the blocks not written yet by their uncompressed
+  // size.
+  // REQUIRES: threads > 0, Add() has not been called
+  void EnableParallelCompression(int threads);
+
  private:
+  struct ParallelBlock;
+
+
   bool ok() const { return status().ok(); }
   void WriteBlock(BlockBuilder* block, BlockHandle* handle);
+  void WriteBlock(const Slice& raw, BlockHandle* handle);
   void WriteRawBlock(const Slice& data, CompressionType, BlockHandle* handle);
   void AppendToFile(const Slice& slice);
   void FlushBatchBuffer();
+  void SubmitParallelBlock(const Slice& raw);
+  static void CompressParallelBlock(void* arg);
+  void WriteParallelBlocks(size_t max_pending);
+  void WaitParallelBlocks();
 
   struct Rep;
   Rep* rep_;
@@ -14,6 +14,7 @@
 #include <algorithm>
 #include "leveldb/comparator.h"
 #include "table/format.h"
+#include "table/tera_block.h"
 #include "util/coding.h"
 #include "util/logging.h"
 
@@ -21,23 +22,44 @@ namespace leveldb {
 
 inline uint32_t Block::NumRestarts() const {
   assert(size_ >= sizeof(uint32_t));
-  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+  return DecodeFixed32(data_ + size_ - sizeof(uint32_t)) & ~kBlockHashIndexFlag;
 }
 
 Block::Block(const BlockContents& contents)
     : data_(contents.data.data()),
       size_(contents.data.size()),
       restart_offset_(0),
-      owned_(contents.heap_allocated) {
+      owned_(contents.heap_allocated),
+      tera_block_(false),
+      hash_buckets_(NULL),
+      num_buckets_(0),
+      hash_key_suffix_(0) {
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;  // Error marker
+  } else if (IsTeraBlock(data_, size_)) {
+    tera_block_ = true;  // Trailer is checked by NewTeraBlockIterator()
   } else {
-    size_t max_restarts_allowed = (size_-sizeof(uint32_t)) / sizeof(uint32_t);
+    size_t trailer_size = sizeof(uint32_t);
+    if (DecodeFixed32(data_ + size_ - sizeof(uint32_t)) & kBlockHashIndexFlag) {
+      const uint8_t* p = reinterpret_cast<const uint8_t*>(data_ + size_) -
+          sizeof(uint32_t) - kBlockHashIndexTrailerSize;
+      if (size_ >= sizeof(uint32_t) + kBlockHashIndexTrailerSize) {
+        num_buckets_ = p[0] | (p[1] << 8);
+        hash_key_suffix_ = p[2];
+        trailer_size += kBlockHashIndexTrailerSize + num_buckets_;
+      }
+      if (num_buckets_ == 0 || trailer_size > size_) {
+        size_ = 0;  // Error marker
+        return;
+      }
+      hash_buckets_ = p - num_buckets_;
+    }
+    size_t max_restarts_allowed = (size_ - trailer_size) / sizeof(uint32_t);
     if (NumRestarts() > max_restarts_allowed) {
       // The size is too small for NumRestarts()
       size_ = 0;
     } else {
-      restart_offset_ = size_ - (1 + NumRestarts()) * sizeof(uint32_t);
+      restart_offset_ = size_ - trailer_size - NumRestarts() * sizeof(uint32_t);
     }
   }
 }
@@ -92,6 +114,10 @@ class Block::Iter : public Iterator {
   Slice value_;
   Status status_;
 
+  const uint8_t* const hash_buckets_;  // NULL if the block has no hash index
+  uint32_t const num_buckets_;
+  uint32_t const hash_key_suffix_;
+
   inline int Compare(const Slice& a, const Slice& b) const {
     return comparator_->Compare(a, b);
   }
@@ -120,13 +146,19 @@ class Block::Iter : public Iterator {
   Iter(const Comparator* comparator,
        const char* data,
        uint32_t restarts,
-       uint32_t num_restarts)
+       uint32_t num_restarts,
+       const uint8_t* hash_buckets,
+       uint32_t num_buckets,
+       uint32_t hash_key_suffix)
       : comparator_(comparator),
         data_(data),
         restarts_(restarts),
         num_restarts_(num_restarts),
         current_(restarts_),
-        restart_index_(num_restarts_) {
+        restart_index_(num_restarts_),
+        hash_buckets_(hash_buckets),
+        num_buckets_(num_buckets),
+        hash_key_suffix_(hash_key_suffix) {
     assert(num_restarts_ > 0);
   }
 
@@ -168,6 +200,10 @@ class Block::Iter : public Iterator {
   }
 
   virtual void Seek(const Slice& target) {
+    if (hash_buckets_ != NULL && SeekByHashIndex(target)) {
+      return;
+    }
+
     // Binary search in restart array to find the last restart point
     // with a key < target
     uint32_t left = 0;
@@ -228,6 +264,49 @@ class Block::Iter : public Iterator {
     value_.clear();
   }
 
+  // Seek in the restart interval of the user key of "target" in the hash
+  // index.  The interval is only a guess, e.g. for absent user keys: it is
+  // used if its first key is smaller than "target" and the first key of the
+  // next interval is not, or if its first key is the first version of the
+  // user key of "target".  Return false to fall back to the binary search,
+  // after at most two comparisons.
+  bool SeekByHashIndex(const Slice& target) {
+    Slice hash_key;
+    if (!ExtractBlockHashKey(target, hash_key_suffix_, &hash_key)) {
+      return false;
+    }
+    const uint8_t restart_index = hash_buckets_[BlockHash(hash_key) % num_buckets_];
+    if (restart_index >= num_restarts_) {  // kBlockHashNoEntry or kBlockHashCollision
+      return false;
+    }
+    if (restart_index + 1U < num_restarts_) {
+      uint32_t shared, non_shared, value_length;
+      const char* key_ptr = DecodeEntry(data_ + GetRestartPoint(restart_index + 1),
+                                        data_ + restarts_,
+                                        &shared, &non_shared, &value_length);
+      if (key_ptr == NULL || shared != 0) {
+        CorruptionError();
+        return true;
+      }
+      if (Compare(Slice(key_ptr, non_shared), target) < 0) {
+        return false;
+      }
+    }
+    SeekToRestartPoint(restart_index);
+    if (!ParseNextKey()) {
+      return !status_.ok();
+    }
+    if (Compare(key_, target) >= 0) {
+      Slice found_hash_key;
+      return ExtractBlockHashKey(key_, hash_key_suffix_, &found_hash_key) &&
+          found_hash_key == hash_key;
+    }
+    // Stops within the interval or at the first key of the next one
+    while (ParseNextKey() && Compare(key_, target) < 0) {
+    }
+    return true;
+  }
+
   bool ParseNextKey() {
     current_ = NextEntryOffset();
     const char* p = data_ + current_;
@@ -262,11 +341,15 @@ Iterator* Block::NewIterator(const Comparator* cmp) {
   if (size_ < sizeof(uint32_t)) {
     return NewErrorIterator(Status::Corruption("bad block contents"));
   }
+  if (tera_block_) {
+    return NewTeraBlockIterator(cmp, data_, size_);
+  }
   const uint32_t num_restarts = NumRestarts();
   if (num_restarts == 0) {
     return NewEmptyIterator();
   } else {
-    return new Iter(cmp, data_, restart_offset_, num_restarts);
+    return new Iter(cmp, data_, restart_offset_, num_restarts,
+                    hash_buckets_, num_buckets_, hash_key_suffix_);
   }
 }
 
@@ -35,6 +35,10 @@ class Block {
   size_t size_;
   uint32_t restart_offset_;     // Offset in data_ of restart array
   bool owned_;                  // Block owns data_[]
+  bool tera_block_;             // Generated by TeraBlockBuilder
+  const uint8_t* hash_buckets_; // Hash index, NULL if absent
+  uint32_t num_buckets_;
+  uint32_t hash_key_suffix_;
 
   // No copying allowed
   Block(const Block&);
@@ -29,6 +29,18 @@
 //     restarts: uint32[num_restarts]
 //     num_restarts: uint32
 // restarts[i] contains the offset within the block of the ith restart point.
+//
+// With a hash index, the trailer has the form:
+//     restarts: uint32[num_restarts]
+//     buckets: uint8[num_buckets]
+//     num_buckets: uint16
+//     key_suffix: uint8
+//     num_restarts | kBlockHashIndexFlag: uint32
+// buckets[BlockHash(hash key) % num_buckets] is the index of the restart
+// interval where the first entry of the user key lives, kBlockHashNoEntry,
+// or kBlockHashCollision if user keys of different intervals share it.
+// Blocks with more than kBlockHashMaxRestarts restart points, or with keys
+// too short to be internal keys, are built without it.
 
 #include "table/block_builder.h"
 
@@ -36,6 +48,7 @@
 #include <assert.h>
 #include "leveldb/comparator.h"
 #include "leveldb/table_builder.h"
+#include "table/format.h"
 #include "util/coding.h"
 
 namespace leveldb {
@@ -44,11 +57,20 @@ BlockBuilder::BlockBuilder(const Options* options)
     : options_(options),
       restarts_(),
       counter_(0),
-      finished_(false) {
+      finished_(false),
+      hash_index_(false),
+      hash_key_suffix_(0),
+      hash_index_valid_(true) {
   assert(options->block_restart_interval >= 1);
   restarts_.push_back(0);       // First restart point is at offset 0
 }
 
+void BlockBuilder::EnableHashIndex(size_t key_suffix) {
+  assert(buffer_.empty());
+  hash_index_ = true;
+  hash_key_suffix_ = key_suffix;
+}
+
 void BlockBuilder::Reset() {
   buffer_.clear();
   restarts_.clear();
@@ -56,11 +78,18 @@ void BlockBuilder::Reset() {
   counter_ = 0;
   finished_ = false;
   last_key_.clear();
+  hash_index_valid_ = true;
+  hashes_.clear();
 }
 
 size_t BlockBuilder::CurrentSizeEstimate() const {
+  size_t hash_index_size = 0;
+  if (hash_index_ && hash_index_valid_) {
+    hash_index_size = hashes_.size() * 4 / 3 + kBlockHashIndexTrailerSize;
+  }
   return (buffer_.size() +                        // Raw data buffer
           restarts_.size() * sizeof(uint32_t) +   // Restart array
+          hash_index_size +                       // Hash index
           sizeof(uint32_t));                      // Restart array length
 }
 
@@ -69,11 +98,37 @@ Slice BlockBuilder::Finish() {
   for (size_t i = 0; i < restarts_.size(); i++) {
     PutFixed32(&buffer_, restarts_[i]);
   }
-  PutFixed32(&buffer_, restarts_.size());
+  if (hash_index_ && hash_index_valid_ && !hashes_.empty() &&
+      restarts_.size() <= kBlockHashMaxRestarts) {
+    AppendHashIndex();
+    PutFixed32(&buffer_, restarts_.size() | kBlockHashIndexFlag);
+  } else {
+    PutFixed32(&buffer_, restarts_.size());
+  }
   finished_ = true;
   return Slice(buffer_);
 }
 
+void BlockBuilder::AppendHashIndex() {
+  // About 3/4 of the buckets are used
+  const size_t num_buckets = std::min<size_t>(hashes_.size() * 4 / 3 + 1, 0xffff);
+  const size_t offset = buffer_.size();
+  buffer_.append(num_buckets, static_cast<char>(kBlockHashNoEntry));
+  uint8_t* buckets = reinterpret_cast<uint8_t*>(&buffer_[offset]);
+  for (size_t i = 0; i < hashes_.size(); i++) {
+    uint8_t* bucket = &buckets[hashes_[i].first % num_buckets];
+    const uint8_t restart_index = hashes_[i].second;
+    if (*bucket == kBlockHashNoEntry) {
+      *bucket = restart_index;
+    } else if (*bucket != restart_index) {
+      *bucket = kBlockHashCollision;
+    }
+  }
+  buffer_.push_back(static_cast<char>(num_buckets & 0xff));
+  buffer_.push_back(static_cast<char>(num_buckets >> 8));
+  buffer_.push_back(static_cast<char>(hash_key_suffix_));
+}
+
 void BlockBuilder::Add(const Slice& key, const Slice& value) {
   Slice last_key_piece(last_key_);
   assert(!finished_);
@@ -94,6 +149,19 @@ void BlockBuilder::Add(const Slice& key, const Slice& value) {
   }
   const size_t non_shared = key.size() - shared;
 
+  if (hash_index_ && hash_index_valid_) {
+    Slice hash_key, last_hash_key;
+    if (!ExtractBlockHashKey(key, hash_key_suffix_, &hash_key)) {
+      hash_index_valid_ = false;
+    } else if (buffer_.empty() ||
+               !ExtractBlockHashKey(last_key_piece, hash_key_suffix_, &last_hash_key) ||
+               hash_key != last_hash_key) {
+      // Only the first entry of a user key is indexed, the others follow it
+      hashes_.push_back(std::make_pair(BlockHash(hash_key),
+                                       static_cast<uint32_t>(restarts_.size() - 1)));
+    }
+  }
+
   // Add "<shared><non_shared><value_size>" to buffer_
   PutVarint32(&buffer_, shared);
   PutVarint32(&buffer_, non_shared);
@@ -22,6 +22,11 @@ class BlockBuilder {
  public:
   explicit BlockBuilder(const Options* options);
 
+  // Append a hash index from the user keys without their last "key_suffix"
+  // bytes to the restart intervals they start in, which lets point lookups
+  // skip the binary search of the restart array.
+  void EnableHashIndex(size_t key_suffix);
+
   // Reset the contents as if the BlockBuilder was just constructed.
   void Reset();
 
@@ -51,6 +56,14 @@ class BlockBuilder {
   bool                  finished_;    // Has Finish() been called?
   std::string           last_key_;
 
+  bool                  hash_index_;       // Build a hash index?
+  size_t                hash_key_suffix_;
+  bool                  hash_index_valid_; // All keys can be hashed?
+  // Hash and restart index of the first entry of each user key
+  std::vector<std::pair<uint32_t, uint32_t> > hashes_;
+
+  void AppendHashIndex();
+
   // No copying allowed
   BlockBuilder(const BlockBuilder&);
   void operator=(const BlockBuilder&);
@@ -168,7 +168,10 @@ Status ReadBlock(RandomAccessFile* file,
   if (!s.ok()) {
     return s;
   }
-  s = ParseBlock(n, offset, options, contents, result);
+  // An mmapped or in-memory file returns its own memory instead of buf
+  const bool in_file_memory = db_opt.use_mmap_read &&
+      !db_opt.use_direct_io_read && contents.data() != buf;
+  s = ParseBlock(n, offset, options, contents, result, in_file_memory);
   FreeBuf(buf, db_opt.use_direct_io_read);
   return s;
 }
@@ -177,7 +180,8 @@ Status ParseBlock(size_t n,
                   size_t offset,
                   const ReadOptions& options,
                   Slice contents,
-                  BlockContents* result) {
+                  BlockContents* result,
+                  bool in_file_memory) {
 
   if (contents.size() != n + kBlockTrailerSize) {
     return Status::Corruption("truncated block read");
@@ -199,6 +203,13 @@ Status ParseBlock(size_t n,
 
   switch (data[n]) {
     case kNoCompression: {
+      if (in_file_memory) {
+        // Do not copy or cache the block, it is in memory already
+        result->data = Slice(data, n);
+        result->heap_allocated = false;
+        result->cachable = false;
+        break;
+      }
       char* buf = new char[n];
       memcpy(buf, contents.data(), n);
       result->data = Slice(buf, n);
@@ -14,6 +14,7 @@
 #include "leveldb/slice.h"
 #include "leveldb/status.h"
 #include "leveldb/table_builder.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
@@ -87,6 +88,30 @@ static const uint64_t kTableMagicNumber = 0xdb4775248b80fb57ull;
 // 1-byte type + 32-bit crc
 static const size_t kBlockTrailerSize = 5;
 
+// A data block may end with a hash index from the keys to their restart
+// intervals, flagged in its restart count, see block_builder.cc
+static const uint32_t kBlockHashIndexFlag = 0x40000000u;
+static const uint8_t kBlockHashNoEntry = 255;
+static const uint8_t kBlockHashCollision = 254;
+static const uint32_t kBlockHashMaxRestarts = kBlockHashCollision;
+// num_buckets: uint16 + key_suffix: uint8
+static const size_t kBlockHashIndexTrailerSize = 3;
+
+// The part of internal key "key" that is hashed: the user key without
+// the last "key_suffix" bytes, which the comparator ignores.
+inline bool ExtractBlockHashKey(const Slice& key, size_t key_suffix,
+                                Slice* result) {
+  if (key.size() < 8 + key_suffix) {
+    return false;
+  }
+  *result = Slice(key.data(), key.size() - 8 - key_suffix);
+  return true;
+}
+
+inline uint32_t BlockHash(const Slice& hash_key) {
+  return Hash(hash_key.data(), hash_key.size(), 0x4a8c3f1d);
+}
+
 struct BlockContents {
   Slice data;           // Actual contents of data
   bool cachable;        // True iff data can be cached
@@ -122,11 +147,15 @@ extern Status ReadBlock(RandomAccessFile* file,
                         const BlockHandle& handle,
                         BlockContents* result);
 
+// Parse the block of size "n" and its trailer in "contents" into *result.
+// If "in_file_memory", "contents" is owned by the file and stays valid as
+// long as it is open, and an uncompressed block refers to it directly.
 Status ParseBlock(size_t n,
                   size_t offset,
                   const ReadOptions& options,
                   Slice contents,
-                  BlockContents* result);
+                  BlockContents* result,
+                  bool in_file_memory = false);
 
 // Implementation details follow.  Clients should ignore,
 inline BlockHandle::BlockHandle()
@@ -9,6 +9,8 @@
 #include <malloc.h>
 #include "leveldb/table.h"
 
+#include <algorithm>
+
 #include "leveldb/cache.h"
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
@@ -604,8 +606,16 @@ Iterator* Table::BlockReader(void* arg,
       cache_handle = block_cache->Lookup(key);
       if (cache_handle != NULL) {
         block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
+        if (options.trace) {
+          options.trace->block_cache_hit++;
+        }
       } else {
+        uint64_t read_start_us = options.trace ? table->rep_->options.env->NowMicros() : 0;
         s = ReadBlock(table->rep_->file, options, handle, &contents);
+        if (options.trace) {
+          options.trace->block_cache_miss++;
+          options.trace->block_read_us += table->rep_->options.env->NowMicros() - read_start_us;
+        }
         if (s.ok()) {
           block = new Block(contents);
           if (contents.cachable && options.fill_cache) {
@@ -615,7 +625,12 @@ Iterator* Table::BlockReader(void* arg,
         }
       }
     } else {
+      uint64_t read_start_us = options.trace ? table->rep_->options.env->NowMicros() : 0;
       s = ReadBlock(table->rep_->file, options, handle, &contents);
+      if (options.trace) {
+        options.trace->block_cache_miss++;
+        options.trace->block_read_us += table->rep_->options.env->NowMicros() - read_start_us;
+      }
       if (s.ok()) {
         block = new Block(contents);
       }
@@ -636,6 +651,70 @@ Iterator* Table::BlockReader(void* arg,
   return iter;
 }
 
+void Table::GetCachedBlocks(std::vector<uint64_t>* block_offsets,
+                            uint64_t* budget) const {
+  Cache* block_cache = rep_->options.block_cache;
+  if (block_cache == NULL) {
+    return;
+  }
+  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  for (iiter->SeekToFirst(); iiter->Valid() && *budget > 0; iiter->Next()) {
+    BlockHandle handle;
+    Slice input = iiter->value();
+    if (!handle.DecodeFrom(&input).ok()) {
+      break;
+    }
+    char cache_key_buffer[16];
+    EncodeFixed64(cache_key_buffer, rep_->cache_id);
+    EncodeFixed64(cache_key_buffer+8, handle.offset());
+    Cache::Handle* cache_handle =
+        block_cache->Lookup(Slice(cache_key_buffer, sizeof(cache_key_buffer)));
+    if (cache_handle != NULL) {
+      block_cache->Release(cache_handle);
+      block_offsets->push_back(handle.offset());
+      *budget -= std::min(*budget, handle.size());
+    }
+  }
+  delete iiter;
+}
+
+Status Table::Prefetch(const ReadOptions& options,
+                       const std::vector<uint64_t>& block_offsets,
+                       uint64_t* bytes) {
+  Status s;
+  Cache* block_cache = rep_->options.block_cache;
+  if (block_cache == NULL || block_offsets.empty()) {
+    return s;
+  }
+  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  for (iiter->SeekToFirst(); iiter->Valid() && s.ok(); iiter->Next()) {
+    BlockHandle handle;
+    Slice input = iiter->value();
+    s = handle.DecodeFrom(&input);
+    if (!s.ok() || !std::binary_search(block_offsets.begin(), block_offsets.end(),
+                                       handle.offset())) {
+      continue;
+    }
+    char cache_key_buffer[16];
+    EncodeFixed64(cache_key_buffer, rep_->cache_id);
+    EncodeFixed64(cache_key_buffer+8, handle.offset());
+    Cache::Handle* cache_handle =
+        block_cache->Lookup(Slice(cache_key_buffer, sizeof(cache_key_buffer)));
+    if (cache_handle != NULL) {
+      block_cache->Release(cache_handle);
+      continue;
+    }
+    Iterator* block_iter = BlockReader(this, options, iiter->value());
+    s = block_iter->status();
+    delete block_iter;
+    if (s.ok()) {
+      *bytes += handle.size();
+    }
+  }
+  delete iiter;
+  return s;
+}
+
 Iterator* Table::NewIterator(const ReadOptions& options) const {
   return NewIterator(options, Slice(), Slice());
 }
@@ -9,6 +9,8 @@
 #include "leveldb/table_builder.h"
 
 #include <assert.h>
+#include <deque>
+#include <vector>
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
@@ -16,8 +18,11 @@
 #include "table/block_builder.h"
 #include "table/filter_block.h"
 #include "table/format.h"
+#include "table/tera_block.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/mutexlock.h"
+#include "util/thread_pool.h"
 #include "../common/counter.h"
 
 namespace leveldb {
@@ -25,6 +30,98 @@ namespace leveldb {
 tera::Counter snappy_before_size_counter;
 tera::Counter snappy_after_size_counter;
 
+// A data block compressed by the pool of EnableParallelCompression()
+struct TableBuilder::ParallelBlock {
+  TableBuilder* builder;
+  CompressionType compression;
+  std::string raw;
+  std::string keys;         // length-prefixed keys of the block for the filter
+  std::string compressed;
+  Slice contents;           // raw or compressed
+  CompressionType type;
+  char trailer[kBlockTrailerSize];
+  size_t index;             // index of the block in the table
+  bool done;                // contents and trailer are ready
+};
+
+namespace {
+
+port::Mutex compress_pool_mu;
+ThreadPool* compress_pool = NULL;
+int compress_pool_threads = 0;
+
+ThreadPool* CompressPool(int threads) {
+  MutexLock l(&compress_pool_mu);
+  if (compress_pool == NULL) {
+    compress_pool = new ThreadPool;
+  }
+  if (threads > compress_pool_threads) {
+    compress_pool_threads = threads;
+    compress_pool->SetBackgroundThreads(threads);
+  }
+  return compress_pool;
+}
+
+// Return the contents to store for the block "raw" and set *type to the
+// compression actually used.  The contents may refer to *compressed.
+Slice CompressBlock(CompressionType compression, const Slice& raw,
+                    std::string* compressed, CompressionType* type) {
+  Slice block_contents;
+  *type = compression;
+  // TODO(postrelease): Support more compression options: zlib?
+  switch (compression) {
+    case kNoCompression:
+      block_contents = raw;
+      break;
+
+    case kSnappyCompression: {
+      snappy_before_size_counter.Add(raw.size());
+      if (port::Snappy_Compress(raw.data(), raw.size(), compressed) &&
+          compressed->size() < raw.size() - (raw.size() / 8u)) {
+        block_contents = *compressed;
+      } else {
+        // Snappy not supported, or compressed less than 12.5%, so just
+        // store uncompressed form
+        block_contents = raw;
+        *type = kNoCompression;
+      }
+      snappy_after_size_counter.Add(block_contents.size());
+      break;
+    }
+    case kBmzCompression: {
+      if (port::Bmz_Compress(raw.data(), raw.size(), compressed) &&
+          compressed->size() < raw.size() - (raw.size() / 8u)) {
+        block_contents = *compressed;
+      } else {
+        block_contents = raw;
+        *type = kNoCompression;
+      }
+      break;
+    }
+    case kLZ4Compression: {
+      if (port::Lz4_Compress(raw.data(), raw.size(), compressed) &&
+          compressed->size() < raw.size()) {
+        block_contents = *compressed;
+      } else {
+        block_contents = raw;
+        *type = kNoCompression;
+      }
+      break;
+    }
+  }
+  return block_contents;
+}
+
+void EncodeBlockTrailer(const Slice& block_contents, CompressionType type,
+                        char* trailer) {
+  trailer[0] = type;
+  uint32_t crc = crc32c::Value(block_contents.data(), block_contents.size());
+  crc = crc32c::Extend(crc, trailer, 1);  // Extend crc to cover block type
+  EncodeFixed32(trailer+1, crc32c::Mask(crc));
+}
+
+}  // namespace
+
 struct TableBuilder::Rep {
   Options options;
   Options index_block_options;
@@ -32,6 +129,7 @@ struct TableBuilder::Rep {
   uint64_t offset;
   Status status;
   BlockBuilder data_block;
+  TeraBlockBuilder* tera_data_block;  // Replaces data_block if not NULL
   BlockBuilder index_block;
   std::string last_key;
   int64_t num_entries;
@@ -53,24 +151,54 @@ struct TableBuilder::Rep {
 
   std::string compressed_output;
 
+  // Parallel compression of data blocks, see EnableParallelCompression().
+  // The pool threads only compress the blocks, the building thread writes
+  // them to the file.
+  int compress_threads;                 // 0 if disabled
+  std::vector<std::string> index_keys;  // index keys of the data blocks
+  std::string block_keys;               // keys of the current data block
+  std::vector<BlockHandle> handles;     // handles of the data blocks
+  uint64_t pending_size;                // raw size of the blocks not written
+  bool abandoned;
+  port::Mutex mu;                       // guards the done flag of blocks
+  port::CondVar cv;
+  std::deque<ParallelBlock*> blocks;    // submitted blocks not written yet
+
   Rep(const Options& opt, WritableFile* f)
       : options(opt),
         index_block_options(opt),
         file(f),
         offset(0),
         data_block(&options),
+        tera_data_block(NULL),
         index_block(&index_block_options),
         num_entries(0),
         saved_size(0),
         closed(false),
         filter_block(opt.filter_policy == NULL ? NULL
                      : new FilterBlockBuilder(opt.filter_policy)),
-        pending_index_entry(false) {
+        pending_index_entry(false),
+        compress_threads(0),
+        pending_size(0),
+        abandoned(false),
+        cv(&mu) {
     index_block_options.block_restart_interval = 1;
+    if (opt.data_block_hash_index) {
+      data_block.EnableHashIndex(opt.raw_key_format == kTTLKv ? 8 : 0);
+    }
+    if (opt.use_tera_block_encoding &&
+        (opt.raw_key_format == kReadable || opt.raw_key_format == kBinary)) {
+      tera_data_block = new TeraBlockBuilder(&options);
+    }
   }
 
   ~Rep() {
     delete filter_block;
+    delete tera_data_block;
+  }
+
+  bool DataBlockEmpty() const {
+    return tera_data_block == NULL ? data_block.empty() : tera_data_block->empty();
   }
 };
 
@@ -113,24 +241,47 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
     assert(r->options.comparator->Compare(key, Slice(r->last_key)) > 0);
   }
 
+  TeraBlockKey tera_key;
+  if (r->tera_data_block != NULL &&
+      !r->tera_data_block->ParseKey(key, &tera_key)) {
+    // Not a tera key, build the rest of the table in the default format
+    Flush();
+    delete r->tera_data_block;
+    r->tera_data_block = NULL;
+  }
+
   if (r->pending_index_entry) {
-    assert(r->data_block.empty());
+    assert(r->DataBlockEmpty());
     r->options.comparator->FindShortestSeparator(&r->last_key, key);
-    std::string handle_encoding;
-    r->pending_handle.EncodeTo(&handle_encoding);
-    r->index_block.Add(r->last_key, Slice(handle_encoding));
+    if (r->compress_threads > 0) {
+      // the handle is known once the block is written
+      r->index_keys.push_back(r->last_key);
+    } else {
+      std::string handle_encoding;
+      r->pending_handle.EncodeTo(&handle_encoding);
+      r->index_block.Add(r->last_key, Slice(handle_encoding));
+    }
     r->pending_index_entry = false;
   }
 
   if (r->filter_block != NULL) {
-    r->filter_block->AddKey(key);
+    if (r->compress_threads > 0) {
+      PutLengthPrefixedSlice(&r->block_keys, key);
+    } else {
+      r->filter_block->AddKey(key);
+    }
   }
 
   r->last_key.assign(key.data(), key.size());
   r->num_entries++;
-  r->data_block.Add(key, value);
-
-  const size_t estimated_block_size = r->data_block.CurrentSizeEstimate();
+  size_t estimated_block_size;
+  if (r->tera_data_block != NULL) {
+    r->tera_data_block->Add(tera_key, value);
+    estimated_block_size = r->tera_data_block->CurrentSizeEstimate();
+  } else {
+    r->data_block.Add(key, value);
+    estimated_block_size = r->data_block.CurrentSizeEstimate();
+  }
   if (estimated_block_size >= r->options.block_size) {
     Flush();
   }
@@ -140,9 +291,25 @@ void TableBuilder::Flush() {
   Rep* r = rep_;
   assert(!r->closed);
   if (!ok()) return;
-  if (r->data_block.empty()) return;
+  if (r->DataBlockEmpty()) return;
   assert(!r->pending_index_entry);
-  WriteBlock(&r->data_block, &r->pending_handle);
+  if (r->compress_threads > 0) {
+    if (r->tera_data_block != NULL) {
+      SubmitParallelBlock(r->tera_data_block->Finish());
+      r->tera_data_block->Reset();
+    } else {
+      SubmitParallelBlock(r->data_block.Finish());
+      r->data_block.Reset();
+    }
+    r->pending_index_entry = true;
+    return;
+  }
+  if (r->tera_data_block != NULL) {
+    WriteBlock(r->tera_data_block->Finish(), &r->pending_handle);
+    r->tera_data_block->Reset();
+  } else {
+    WriteBlock(&r->data_block, &r->pending_handle);
+  }
   if (ok()) {
     r->pending_index_entry = true;
   }
@@ -152,63 +319,23 @@ void TableBuilder::Flush() {
 }
 
 void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
+  WriteBlock(block->Finish(), handle);
+  block->Reset();
+}
+
+void TableBuilder::WriteBlock(const Slice& raw, BlockHandle* handle) {
   // File format contains a sequence of blocks where each block has:
   //    block_data: uint8[n]
   //    type: uint8
   //    crc: uint32
   assert(ok());
   Rep* r = rep_;
-  Slice raw = block->Finish();
-
-  Slice block_contents;
-  CompressionType type = r->options.compression;
-  // TODO(postrelease): Support more compression options: zlib?
-  switch (type) {
-    case kNoCompression:
-      block_contents = raw;
-      break;
 
-    case kSnappyCompression: {
-      snappy_before_size_counter.Add(raw.size());
-      std::string* compressed = &r->compressed_output;
-      if (port::Snappy_Compress(raw.data(), raw.size(), compressed) &&
-          compressed->size() < raw.size() - (raw.size() / 8u)) {
-        block_contents = *compressed;
-      } else {
-        // Snappy not supported, or compressed less than 12.5%, so just
-        // store uncompressed form
-        block_contents = raw;
-        type = kNoCompression;
-      }
-      snappy_after_size_counter.Add(block_contents.size());
-      break;
-    }
-    case kBmzCompression: {
-      std::string* compressed = &r->compressed_output;
-      if (port::Bmz_Compress(raw.data(), raw.size(), compressed) &&
-          compressed->size() < raw.size() - (raw.size() / 8u)) {
-        block_contents = *compressed;
-      } else {
-        block_contents = raw;
-        type = kNoCompression;
-      }
-      break;
-    }
-    case kLZ4Compression: {
-      std::string* compressed = &r->compressed_output;
-      if (port::Lz4_Compress(raw.data(), raw.size(), compressed) &&
-          compressed->size() < raw.size()) {
-        block_contents = *compressed;
-      } else {
-        block_contents = raw;
-        type = kNoCompression;
-      }
-      break;
-    }
-  }
+  CompressionType type;
+  Slice block_contents = CompressBlock(r->options.compression, raw,
+                                       &r->compressed_output, &type);
   WriteRawBlock(block_contents, type, handle);
   r->compressed_output.clear();
-  block->Reset();
   r->saved_size += raw.size() - block_contents.size();
 }
 
@@ -221,10 +348,7 @@ void TableBuilder::WriteRawBlock(const Slice& block_contents,
   AppendToFile(block_contents);
   if (r->status.ok()) {
     char trailer[kBlockTrailerSize];
-    trailer[0] = type;
-    uint32_t crc = crc32c::Value(block_contents.data(), block_contents.size());
-    crc = crc32c::Extend(crc, trailer, 1);  // Extend crc to cover block type
-    EncodeFixed32(trailer+1, crc32c::Mask(crc));
+    EncodeBlockTrailer(block_contents, type, trailer);
     AppendToFile(Slice(trailer, kBlockTrailerSize));
     if (r->status.ok()) {
       r->offset += block_contents.size() + kBlockTrailerSize;
@@ -232,6 +356,99 @@ void TableBuilder::WriteRawBlock(const Slice& block_contents,
   }
 }
 
+void TableBuilder::EnableParallelCompression(int threads) {
+  Rep* r = rep_;
+  assert(threads > 0);
+  assert(r->num_entries == 0);
+  CompressPool(threads);
+  r->compress_threads = threads;
+}
+
+void TableBuilder::SubmitParallelBlock(const Slice& raw) {
+  Rep* r = rep_;
+  ParallelBlock* block = new ParallelBlock;
+  block->builder = this;
+  block->compression = r->options.compression;
+  block->raw.assign(raw.data(), raw.size());
+  block->keys.swap(r->block_keys);
+  block->index = r->handles.size();
+  block->done = false;
+  r->handles.push_back(BlockHandle());
+  r->pending_size += block->raw.size();
+
+  // bound the memory of the blocks waiting for compression or writing
+  size_t max_pending = static_cast<size_t>(r->compress_threads) * 2;
+  WriteParallelBlocks(max_pending - 1);
+  MutexLock l(&r->mu);
+  r->blocks.push_back(block);
+  CompressPool(r->compress_threads)->Schedule(&TableBuilder::CompressParallelBlock,
+                                              block, 0);
+}
+
+void TableBuilder::CompressParallelBlock(void* arg) {
+  ParallelBlock* block = reinterpret_cast<ParallelBlock*>(arg);
+  block->contents = CompressBlock(block->compression, block->raw,
+                                  &block->compressed, &block->type);
+  EncodeBlockTrailer(block->contents, block->type, block->trailer);
+  Rep* r = block->builder->rep_;
+  MutexLock l(&r->mu);
+  block->done = true;
+  r->cv.SignalAll();
+}
+
+void TableBuilder::WriteParallelBlocks(size_t max_pending) {
+  Rep* r = rep_;
+  while (true) {
+    ParallelBlock* b = NULL;
+    {
+      MutexLock l(&r->mu);
+      while (r->blocks.size() > max_pending && !r->blocks.front()->done) {
+        r->cv.Wait();
+      }
+      if (r->blocks.empty() || !r->blocks.front()->done) {
+        return;
+      }
+      b = r->blocks.front();
+      r->blocks.pop_front();
+    }
+
+    BlockHandle* handle = &r->handles[b->index];
+    handle->set_offset(r->offset);
+    handle->set_size(b->contents.size());
+    if (!r->abandoned && r->status.ok()) {
+      if (r->filter_block != NULL) {
+        Slice input(b->keys);
+        Slice key;
+        while (GetLengthPrefixedSlice(&input, &key)) {
+          r->filter_block->AddKey(key);
+        }
+      }
+      AppendToFile(b->contents);
+      if (r->status.ok()) {
+        AppendToFile(Slice(b->trailer, kBlockTrailerSize));
+      }
+      if (r->status.ok()) {
+        r->offset += b->contents.size() + kBlockTrailerSize;
+        r->saved_size += b->raw.size() - b->contents.size();
+      }
+      if (r->filter_block != NULL) {
+        r->filter_block->StartBlock(r->offset);
+      }
+    }
+    r->pending_size -= b->raw.size();
+    delete b;
+  }
+}
+
+void TableBuilder::WaitParallelBlocks() {
+  Rep* r = rep_;
+  if (r->compress_threads == 0) {
+    return;
+  }
+  WriteParallelBlocks(0);
+  r->compress_threads = 0;
+}
+
 Status TableBuilder::status() const {
   return rep_->status;
 }
@@ -242,6 +459,23 @@ Status TableBuilder::Finish() {
   assert(!r->closed);
   r->closed = true;
 
+  if (r->compress_threads > 0) {
+    WaitParallelBlocks();
+    if (ok()) {
+      if (r->pending_index_entry) {
+        r->options.comparator->FindShortSuccessor(&r->last_key);
+        r->index_keys.push_back(r->last_key);
+        r->pending_index_entry = false;
+      }
+      assert(r->index_keys.size() == r->handles.size());
+      for (size_t i = 0; i < r->index_keys.size(); i++) {
+        std::string handle_encoding;
+        r->handles[i].EncodeTo(&handle_encoding);
+        r->index_block.Add(r->index_keys[i], Slice(handle_encoding));
+      }
+    }
+  }
+
   BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle;
 
   // Write filter block
@@ -299,6 +533,10 @@ void TableBuilder::Abandon() {
   Rep* r = rep_;
   assert(!r->closed);
   r->closed = true;
+  if (r->compress_threads > 0) {
+    r->abandoned = true;
+    WaitParallelBlocks();
+  }
 }
 
 uint64_t TableBuilder::NumEntries() const {
@@ -306,7 +544,8 @@ uint64_t TableBuilder::NumEntries() const {
 }
 
 uint64_t TableBuilder::FileSize() const {
-  return rep_->offset;
+  Rep* r = rep_;
+  return r->offset + r->pending_size;
 }
 
 uint64_t TableBuilder::SavedSize() const {
@@ -13,13 +13,16 @@
 #include "db/dbformat.h"
 #include "db/memtable.h"
 #include "db/write_batch_internal.h"
+#include "leveldb/cache.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
 #include "leveldb/iterator.h"
 #include "leveldb/table_builder.h"
 #include "table/block.h"
 #include "table/block_builder.h"
 #include "table/format.h"
+#include "util/coding.h"
 #include "util/random.h"
 #include "util/testharness.h"
 #include "util/testutil.h"
@@ -869,6 +872,443 @@ TEST(TableTest, ApproximateOffsetOfCompressed) {
   ASSERT_TRUE(Between(c.ApproximateOffsetOf("xyz"),    4000,   6000));
 }
 
+class BlockHashIndexTest {
+ public:
+  BlockHashIndexTest() : icmp_(BytewiseComparator()), key_suffix_(0) {
+    options_.comparator = &icmp_;
+  }
+
+  void UseTTLKvKeys() {
+    icmp_ = InternalKeyComparator(TeraTTLKvComparator());
+    key_suffix_ = 8;
+  }
+
+  std::string UserKey(int i, uint64_t suffix) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "key%08d", i);
+    std::string key(buf);
+    if (key_suffix_ > 0) {
+      PutFixed64(&key, suffix);
+    }
+    return key;
+  }
+
+  std::string Key(int i, SequenceNumber seq, uint64_t suffix = 0) {
+    std::string key;
+    AppendInternalKey(&key, ParsedInternalKey(UserKey(i, suffix), seq, kTypeValue));
+    return key;
+  }
+
+  // even user keys with 1 to 3 versions
+  void BuildKeys(int num_keys) {
+    Random rnd(301);
+    SequenceNumber seq = 1000000;
+    keys_.clear();
+    for (int i = 0; i < num_keys; i++) {
+      int versions = 1 + rnd.Uniform(3);
+      for (int v = 0; v < versions; v++) {
+        keys_.push_back(Key(i * 2, seq - v, rnd.Next()));
+      }
+      seq -= 10;
+    }
+  }
+
+  void BuildBlocks(int value_size) {
+    BlockBuilder default_builder(&options_);
+    BlockBuilder hash_builder(&options_);
+    hash_builder.EnableHashIndex(key_suffix_);
+    std::string value(value_size, 'v');
+    for (size_t i = 0; i < keys_.size(); i++) {
+      default_builder.Add(keys_[i], value);
+      hash_builder.Add(keys_[i], value);
+    }
+    default_contents_ = default_builder.Finish().ToString();
+    hash_contents_ = hash_builder.Finish().ToString();
+  }
+
+  Block* NewBlock(const std::string& contents) {
+    BlockContents block_contents;
+    block_contents.data = contents;
+    block_contents.cachable = false;
+    block_contents.heap_allocated = false;
+    return new Block(block_contents);
+  }
+
+  bool HasHashIndex(const std::string& contents) {
+    return DecodeFixed32(contents.data() + contents.size() - 4) & kBlockHashIndexFlag;
+  }
+
+  // Seek with and without the hash index return the same entry
+  void CheckSeek(Iterator* expected, Iterator* iter, const Slice& target) {
+    expected->Seek(target);
+    iter->Seek(target);
+    ASSERT_EQ(expected->Valid(), iter->Valid());
+    if (expected->Valid()) {
+      ASSERT_EQ(EscapeString(expected->key()), EscapeString(iter->key()));
+      ASSERT_EQ(expected->value().ToString(), iter->value().ToString());
+      iter->Prev();
+      expected->Prev();
+      ASSERT_EQ(expected->Valid(), iter->Valid());
+    }
+    ASSERT_OK(iter->status());
+  }
+
+  void CheckAllSeeks() {
+    ASSERT_TRUE(HasHashIndex(hash_contents_));
+    ASSERT_TRUE(!HasHashIndex(default_contents_));
+    Block* default_block = NewBlock(default_contents_);
+    Block* hash_block = NewBlock(hash_contents_);
+    Iterator* expected = default_block->NewIterator(&icmp_);
+    Iterator* iter = hash_block->NewIterator(&icmp_);
+    for (size_t i = 0; i < keys_.size(); i++) {
+      CheckSeek(expected, iter, keys_[i]);
+      ParsedInternalKey ikey;
+      ASSERT_TRUE(ParseInternalKey(keys_[i], &ikey));
+      int k = atoi(ikey.user_key.data() + 3);
+      CheckSeek(expected, iter, Key(k, kMaxSequenceNumber, i));
+      CheckSeek(expected, iter, Key(k, ikey.sequence - 1, i));
+      CheckSeek(expected, iter, Key(k, 0, i));
+      CheckSeek(expected, iter, Key(k + 1, kMaxSequenceNumber, i));
+      CheckSeek(expected, iter, Key(k - 1, kMaxSequenceNumber, i));
+    }
+    CheckSeek(expected, iter, Key(-1, kMaxSequenceNumber));
+    CheckSeek(expected, iter, Key(99999999, kMaxSequenceNumber));
+    delete expected;
+    delete iter;
+    delete default_block;
+    delete hash_block;
+  }
+
+  // ns per Seek() of the existing user keys, or of the absent ones
+  // between them
+  int SeekNanos(const std::string& contents, bool absent = false) {
+    Block* block = NewBlock(contents);
+    Iterator* iter = block->NewIterator(&icmp_);
+    std::vector<std::string> targets;
+    for (size_t i = 0; i < keys_.size(); i++) {
+      ParsedInternalKey ikey;
+      ParseInternalKey(keys_[i], &ikey);
+      targets.push_back(Key(atoi(ikey.user_key.data() + 3) - (absent ? 1 : 0),
+                            kMaxSequenceNumber));
+    }
+    const int kRounds = 200;
+    uint64_t start = Env::Default()->NowMicros();
+    int found = 0;
+    for (int r = 0; r < kRounds; r++) {
+      for (size_t i = 0; i < targets.size(); i++) {
+        iter->Seek(targets[i]);
+        found += iter->Valid() ? 1 : 0;
+      }
+    }
+    uint64_t used = Env::Default()->NowMicros() - start;
+    ASSERT_EQ(found, static_cast<int>(targets.size() * kRounds));
+    delete iter;
+    delete block;
+    return used * 1000 / (targets.size() * kRounds);
+  }
+
+  InternalKeyComparator icmp_;
+  size_t key_suffix_;
+  Options options_;
+  std::vector<std::string> keys_;
+  std::string default_contents_;
+  std::string hash_contents_;
+};
+
+TEST(BlockHashIndexTest, Seek) {
+  BuildKeys(500);
+  BuildBlocks(10);
+  CheckAllSeeks();
+}
+
+TEST(BlockHashIndexTest, TTLKvKeys) {
+  UseTTLKvKeys();
+  BuildKeys(500);
+  BuildBlocks(10);
+  CheckAllSeeks();
+}
+
+TEST(BlockHashIndexTest, TooManyRestarts) {
+  options_.block_restart_interval = 1;
+  BuildKeys(300);
+  BuildBlocks(10);
+  ASSERT_TRUE(!HasHashIndex(hash_contents_));
+  ASSERT_EQ(default_contents_, hash_contents_);
+}
+
+TEST(BlockHashIndexTest, ShortKeys) {
+  Options options;
+  BlockBuilder builder(&options);
+  builder.EnableHashIndex(0);
+  builder.Add("a", "v");
+  builder.Add("b", "v");
+  ASSERT_TRUE(!HasHashIndex(builder.Finish().ToString()));
+}
+
+// Point lookups in blocks of a kv table with and without the hash index
+TEST(BlockHashIndexTest, Bench) {
+  const int kValueSizes[] = {100, 10};
+  const int kBlockSizes[] = {4 << 10, 64 << 10};
+  for (size_t v = 0; v < sizeof(kValueSizes) / sizeof(kValueSizes[0]); v++) {
+    for (size_t b = 0; b < sizeof(kBlockSizes) / sizeof(kBlockSizes[0]); b++) {
+      BuildKeys(10000);
+      // the keys of about one block, without splitting the versions of a key
+      size_t n = 0;
+      size_t bytes = 0;
+      while (n < keys_.size() &&
+             (bytes < static_cast<size_t>(kBlockSizes[b]) ||
+              ExtractUserKey(keys_[n]) == ExtractUserKey(keys_[n - 1]))) {
+        bytes += keys_[n++].size() + kValueSizes[v];
+      }
+      keys_.resize(n);
+      BuildBlocks(kValueSizes[v]);
+      fprintf(stderr, "block %5d bytes, %4d entries: seek %4d ns, "
+              "with hash index (+%d bytes) %4d ns; absent keys %4d ns, %4d ns\n",
+              static_cast<int>(default_contents_.size()),
+              static_cast<int>(keys_.size()),
+              SeekNanos(default_contents_),
+              static_cast<int>(hash_contents_.size() - default_contents_.size()),
+              SeekNanos(hash_contents_),
+              SeekNanos(default_contents_, true),
+              SeekNanos(hash_contents_, true));
+    }
+  }
+}
+
+class MmapReadTest {
+ public:
+  MmapReadTest()
+      : icmp_(BytewiseComparator()),
+        fname_(test::TmpDir() + "/table_test_mmap_read") {
+    options_.comparator = &icmp_;
+    options_.compression = kNoCompression;
+    options_.block_size = 4 << 10;
+    SetMmapReadBudget(1 << 30);
+  }
+
+  ~MmapReadTest() {
+    SetMmapReadBudget(0);
+    Env::Default()->DeleteFile(fname_);
+  }
+
+  std::string Key(int i) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "key%08d", i);
+    std::string key;
+    AppendInternalKey(&key, ParsedInternalKey(buf, 1, kTypeValue));
+    return key;
+  }
+
+  std::string Value(int i) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%08d", i);
+    return std::string(buf) + std::string(92, 'v');
+  }
+
+  void BuildTable(int num_keys) {
+    WritableFile* file = NULL;
+    ASSERT_OK(Env::Default()->NewWritableFile(fname_, &file, EnvOptions()));
+    TableBuilder builder(options_, file);
+    for (int i = 0; i < num_keys; i++) {
+      builder.Add(Key(i), Value(i));
+    }
+    ASSERT_OK(builder.Finish());
+    ASSERT_OK(file->Close());
+    delete file;
+    num_keys_ = num_keys;
+  }
+
+  void Open(const Options& options, RandomAccessFile** file, Table** table) {
+    uint64_t size = 0;
+    ASSERT_OK(Env::Default()->GetFileSize(fname_, &size));
+    ASSERT_OK(Env::Default()->NewRandomAccessFile(fname_, file, EnvOptions(options)));
+    ASSERT_OK(Table::Open(options, *file, size, table));
+  }
+
+  // ns per Seek() of random keys, after a scan of all the keys
+  int SeekNanos(const Options& options) {
+    RandomAccessFile* file = NULL;
+    Table* table = NULL;
+    Open(options, &file, &table);
+    ReadOptions read_options(&options);
+    Iterator* iter = table->NewIterator(read_options);
+    int i = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+      ASSERT_EQ(Key(i), iter->key().ToString());
+      ASSERT_EQ(Value(i), iter->value().ToString());
+    }
+    ASSERT_OK(iter->status());
+    ASSERT_EQ(num_keys_, i);
+
+    const int kLookups = 200000;
+    Random rnd(301);
+    std::vector<std::string> targets;
+    for (int n = 0; n < 1000; n++) {
+      targets.push_back(Key(rnd.Uniform(num_keys_)));
+    }
+    uint64_t start = Env::Default()->NowMicros();
+    for (int n = 0; n < kLookups; n++) {
+      iter->Seek(targets[n % targets.size()]);
+      ASSERT_TRUE(iter->Valid());
+    }
+    uint64_t used = Env::Default()->NowMicros() - start;
+    delete iter;
+    delete table;
+    delete file;
+    return used * 1000 / kLookups;
+  }
+
+  InternalKeyComparator icmp_;
+  std::string fname_;
+  Options options_;
+  int num_keys_;
+};
+
+// Uncompressed blocks of mmapped files are neither copied nor cached
+TEST(MmapReadTest, SkipBlockCache) {
+  BuildTable(20000);
+  Cache* cache = NewLRUCache(64 << 20);
+  Options options = options_;
+  options.block_cache = cache;
+  options.use_mmap_read = true;
+  SeekNanos(options);
+  ASSERT_EQ(0U, cache->Entries());
+
+  options.use_mmap_read = false;
+  SeekNanos(options);
+  ASSERT_GT(cache->Entries(), 0U);
+  delete cache;
+}
+
+// Random lookups in an sst served by mmap, compared with pread() of the
+// blocks with a block cache large enough for the whole table, and without
+// a block cache
+TEST(MmapReadTest, LookupBench) {
+  BuildTable(50000);
+  Cache* cache = NewLRUCache(64 << 20);
+  Options options = options_;
+  options.block_cache = cache;
+  options.use_mmap_read = true;
+  int mmap_ns = SeekNanos(options);
+  options.use_mmap_read = false;
+  int cache_ns = SeekNanos(options);
+  size_t cache_charge = cache->TotalCharge();
+  options.block_cache = NULL;
+  int pread_ns = SeekNanos(options);
+  fprintf(stderr, "%d keys: seek mmap %d ns, pread + block cache (%d KB) %d ns, "
+          "pread %d ns\n", num_keys_, mmap_ns, static_cast<int>(cache_charge >> 10),
+          cache_ns, pread_ns);
+  delete cache;
+}
+
+class ParallelCompressionTest {
+ public:
+  ParallelCompressionTest() : policy_(NewBloomFilterPolicy(10)), rnd_(301) {
+    options_.block_size = 1024;
+    options_.filter_policy = policy_;
+  }
+
+  ~ParallelCompressionTest() {
+    delete policy_;
+  }
+
+  void GenerateKeys(int num_keys) {
+    std::string value;
+    for (int i = 0; i < num_keys; i++) {
+      char key[32];
+      snprintf(key, sizeof(key), "key%08d", i * 3);
+      keys_.push_back(key);
+      values_.push_back(test::CompressibleString(&rnd_, 0.5, 100 + rnd_.Uniform(200),
+                                                 &value).ToString());
+    }
+  }
+
+  // Return the contents of the table of all the keys built with "threads"
+  // compression threads, or on the adding thread if "threads" is 0
+  std::string Build(int threads) {
+    StringSink sink;
+    TableBuilder builder(options_, &sink);
+    if (threads > 0) {
+      builder.EnableParallelCompression(threads);
+    }
+    for (size_t i = 0; i < keys_.size(); i++) {
+      builder.Add(keys_[i], values_[i]);
+    }
+    Status s = builder.Finish();
+    ASSERT_OK(s);
+    ASSERT_EQ(sink.contents().size(), builder.FileSize());
+    return sink.contents();
+  }
+
+  const FilterPolicy* policy_;
+  Random rnd_;
+  Options options_;
+  std::vector<std::string> keys_;
+  std::vector<std::string> values_;
+};
+
+// Tables built with parallel compression are identical to the ones built
+// on a single thread
+TEST(ParallelCompressionTest, SameContents) {
+  GenerateKeys(5000);
+  for (int c = 0; c < 2; c++) {
+    options_.compression = (c == 0) ? kNoCompression : kSnappyCompression;
+    options_.table_builder_batch_write = (c == 1);
+    options_.table_builder_batch_size = 16 << 10;
+    std::string contents = Build(0);
+    for (int threads = 1; threads <= 4; threads *= 2) {
+      std::string parallel_contents = Build(threads);
+      ASSERT_EQ(contents.size(), parallel_contents.size());
+      ASSERT_TRUE(contents == parallel_contents);
+    }
+  }
+
+  StringSource source(Build(3));
+  Table* table = NULL;
+  ASSERT_OK(Table::Open(options_, &source, source.Size(), &table));
+  Iterator* iter = table->NewIterator(ReadOptions(&options_));
+  size_t i = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), i++) {
+    ASSERT_EQ(keys_[i], iter->key().ToString());
+    ASSERT_EQ(values_[i], iter->value().ToString());
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(keys_.size(), i);
+  delete iter;
+  delete table;
+}
+
+TEST(ParallelCompressionTest, EmptyAndAbandon) {
+  std::string contents = Build(0);
+  ASSERT_TRUE(contents == Build(2));
+
+  StringSink sink;
+  TableBuilder builder(options_, &sink);
+  builder.EnableParallelCompression(2);
+  GenerateKeys(1000);
+  for (size_t i = 0; i < keys_.size(); i++) {
+    builder.Add(keys_[i], values_[i]);
+  }
+  builder.Abandon();
+}
+
+// Time to build a table of 100000 keys on the adding thread and with 4
+// compression threads
+TEST(ParallelCompressionTest, BuildBench) {
+  GenerateKeys(100000);
+  options_.compression = kSnappyCompression;
+  options_.block_size = 4 << 10;
+  uint64_t start = Env::Default()->NowMicros();
+  size_t size = Build(0).size();
+  uint64_t serial_us = Env::Default()->NowMicros() - start;
+  start = Env::Default()->NowMicros();
+  Build(4);
+  uint64_t parallel_us = Env::Default()->NowMicros() - start;
+  fprintf(stderr, "%d keys, %d KB: build %d us, parallel compression %d us\n",
+          static_cast<int>(keys_.size()), static_cast<int>(size >> 10),
+          static_cast<int>(serial_us), static_cast<int>(parallel_us));
+}
+
 class FormatTest {};
 
 static void CheckAlign(RandomAccessFile* file, size_t alignment, uint64_t offset, size_t len) {
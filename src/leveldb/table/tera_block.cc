@@ -0,0 +1,657 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// TeraBlockBuilder generates data blocks for internal keys of tera keys:
+//     readable: row\0 family\0 qualifier\0 ts_type(8B) tag(8B)
+//     binary:   row family\0 qualifier ts_type(8B) rlen|qlen(4B) tag(8B)
+// where ts_type is the big-endian timestamp and type of the tera key, and
+// tag is the sequence and value type of the internal key.  Prefix
+// compression of whole keys works poorly for them: the binary format puts
+// the lengths at the end, and every restart point repeats the row key.
+//
+// An entry for a particular key-value pair has the form:
+//     header: varint32 (family_id << 1 | new_row)
+//     row_length: varint32          (only if new_row)
+//     row: char[row_length]         (only if new_row)
+//     shared_bytes: varint32        (of the previous qualifier)
+//     unshared_bytes: varint32
+//     qualifier_delta: char[unshared_bytes]
+//     ts_type_delta: varint64       (zigzag of ts_type - previous ts_type)
+//     tag_delta: varint64           (zigzag of tag - previous tag)
+//     value_length: varint32
+//     value: char[value_length]
+// Restart points have new_row set, shared_bytes == 0, and deltas against 0.
+// They are placed at the first row boundary after block_restart_interval / 2
+// entries, or after 2 * block_restart_interval entries in a long row.
+//
+// The trailer of the block has the form:
+//     families: varint32 num_families, (varint32 length, char[length])[]
+//     restarts: uint32[num_restarts]
+//     families_offset: uint32
+//     raw_key_format: uint32
+//     num_restarts | kTeraBlockFlag: uint32
+// The flag makes Block decode the block with NewTeraBlockIterator(), and
+// readers without this format reject the block as corrupted instead of
+// misreading it.
+
+#include "table/tera_block.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+#include "util/coding.h"
+
+namespace leveldb {
+
+static const uint32_t kTeraBlockFlag = 0x80000000u;
+static const size_t kTeraBlockTrailerSize = 3 * sizeof(uint32_t);
+
+static inline uint64_t ZigZag(uint64_t v) {
+  return (v << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(v) >> 63);
+}
+
+static inline uint64_t UnZigZag(uint64_t v) {
+  return (v >> 1) ^ (~(v & 1) + 1);
+}
+
+// Most deltas fit in one byte
+static inline const char* GetDeltaPtr(const char* p, const char* limit,
+                                      uint64_t* value) {
+  if (p < limit) {
+    uint64_t result = *(reinterpret_cast<const unsigned char*>(p));
+    if ((result & 128) == 0) {
+      *value = UnZigZag(result);
+      return p + 1;
+    }
+  }
+  p = GetVarint64Ptr(p, limit, value);
+  *value = UnZigZag(*value);
+  return p;
+}
+
+TeraBlockBuilder::TeraBlockBuilder(const Options* options)
+    : options_(options),
+      restarts_(),
+      families_size_(0),
+      last_family_(0),
+      counter_(0),
+      finished_(false),
+      last_ts_type_(0),
+      last_tag_(0) {
+  assert(options->block_restart_interval >= 1);
+  assert(options->raw_key_format == kReadable ||
+         options->raw_key_format == kBinary);
+  restarts_.push_back(0);       // First restart point is at offset 0
+}
+
+// Split "key", an internal key of a tera key of "format", into *result
+static bool ParseTeraKey(RawKeyFormat format, const Slice& key,
+                         TeraBlockKey* result) {
+  if (key.size() < 8) {
+    return false;
+  }
+  result->tag = DecodeFixed64(key.data() + key.size() - 8);
+  const char* data = key.data();
+  size_t size = key.size() - 8;
+  if (format == kReadable) {
+    if (size < 3 + 8) {
+      return false;
+    }
+    result->ts_type = DecodeBigEndain(data + size - 8);
+    const char* end = data + size - 8 - 1;
+    if (*end != '\0') {
+      return false;
+    }
+    const char* row_end = static_cast<const char*>(memchr(data, '\0', end - data));
+    if (row_end == NULL) {
+      return false;
+    }
+    const char* family = row_end + 1;
+    const char* family_end =
+        static_cast<const char*>(memchr(family, '\0', end - family));
+    if (family_end == NULL) {
+      return false;
+    }
+    result->row = Slice(data, row_end - data);
+    result->family = Slice(family, family_end - family);
+    result->qualifier = Slice(family_end + 1, end - family_end - 1);
+    return true;
+  } else if (format == kBinary) {
+    if (size < 1 + 8 + 4) {
+      return false;
+    }
+    uint32_t lengths = DecodeBigEndain32(data + size - 4);
+    size_t row_size = lengths >> 16;
+    size_t qualifier_size = lengths & 0xffff;
+    if (row_size + 1 + qualifier_size + 8 + 4 > size) {
+      return false;
+    }
+    size_t family_size = size - 8 - 4 - qualifier_size - 1 - row_size;
+    if (data[row_size + family_size] != '\0') {
+      return false;
+    }
+    result->row = Slice(data, row_size);
+    result->family = Slice(data + row_size, family_size);
+    result->qualifier = Slice(data + row_size + family_size + 1, qualifier_size);
+    result->ts_type = DecodeBigEndain(data + size - 12);
+    return true;
+  }
+  return false;
+}
+
+bool TeraBlockBuilder::ParseKey(const Slice& key, TeraBlockKey* result) const {
+  return ParseTeraKey(options_->raw_key_format, key, result);
+}
+
+void TeraBlockBuilder::Reset() {
+  buffer_.clear();
+  restarts_.clear();
+  restarts_.push_back(0);       // First restart point is at offset 0
+  families_.clear();
+  families_size_ = 0;
+  last_family_ = 0;
+  counter_ = 0;
+  finished_ = false;
+  last_row_.clear();
+  last_qualifier_.clear();
+  last_ts_type_ = 0;
+  last_tag_ = 0;
+}
+
+size_t TeraBlockBuilder::CurrentSizeEstimate() const {
+  return (buffer_.size() +                        // Raw data buffer
+          VarintLength(families_.size()) +        // Family dictionary
+          families_size_ +
+          restarts_.size() * sizeof(uint32_t) +   // Restart array
+          kTeraBlockTrailerSize);
+}
+
+uint32_t TeraBlockBuilder::FamilyId(const Slice& family) {
+  if (last_family_ < families_.size() &&
+      family == Slice(families_[last_family_])) {
+    return last_family_;
+  }
+  for (size_t i = 0; i < families_.size(); i++) {
+    if (family == Slice(families_[i])) {
+      last_family_ = i;
+      return last_family_;
+    }
+  }
+  families_.push_back(family.ToString());
+  families_size_ += VarintLength(family.size()) + family.size();
+  last_family_ = families_.size() - 1;
+  return last_family_;
+}
+
+Slice TeraBlockBuilder::Finish() {
+  const uint32_t families_offset = buffer_.size();
+  PutVarint32(&buffer_, families_.size());
+  for (size_t i = 0; i < families_.size(); i++) {
+    PutLengthPrefixedSlice(&buffer_, families_[i]);
+  }
+  for (size_t i = 0; i < restarts_.size(); i++) {
+    PutFixed32(&buffer_, restarts_[i]);
+  }
+  PutFixed32(&buffer_, families_offset);
+  PutFixed32(&buffer_, options_->raw_key_format);
+  PutFixed32(&buffer_, restarts_.size() | kTeraBlockFlag);
+  finished_ = true;
+  return Slice(buffer_);
+}
+
+void TeraBlockBuilder::Add(const TeraBlockKey& key, const Slice& value) {
+  assert(!finished_);
+  const int interval = options_->block_restart_interval;
+  bool new_row = buffer_.empty() || key.row != Slice(last_row_);
+  if (counter_ >= 2 * interval || (new_row && counter_ >= interval / 2)) {
+    // Restart compression
+    restarts_.push_back(buffer_.size());
+    counter_ = 0;
+    last_qualifier_.clear();
+    last_ts_type_ = 0;
+    last_tag_ = 0;
+    new_row = true;
+  }
+
+  PutVarint32(&buffer_, FamilyId(key.family) << 1 | (new_row ? 1 : 0));
+  if (new_row) {
+    PutLengthPrefixedSlice(&buffer_, key.row);
+    last_row_.assign(key.row.data(), key.row.size());
+  }
+
+  Slice last_qualifier(last_qualifier_);
+  const size_t min_length = std::min(last_qualifier.size(), key.qualifier.size());
+  size_t shared = 0;
+  while ((shared < min_length) && (last_qualifier[shared] == key.qualifier[shared])) {
+    shared++;
+  }
+  const size_t non_shared = key.qualifier.size() - shared;
+  PutVarint32(&buffer_, shared);
+  PutVarint32(&buffer_, non_shared);
+  buffer_.append(key.qualifier.data() + shared, non_shared);
+  last_qualifier_.resize(shared);
+  last_qualifier_.append(key.qualifier.data() + shared, non_shared);
+
+  PutVarint64(&buffer_, ZigZag(key.ts_type - last_ts_type_));
+  PutVarint64(&buffer_, ZigZag(key.tag - last_tag_));
+  last_ts_type_ = key.ts_type;
+  last_tag_ = key.tag;
+
+  PutVarint32(&buffer_, value.size());
+  buffer_.append(value.data(), value.size());
+  counter_++;
+}
+
+bool IsTeraBlock(const char* data, size_t size) {
+  return size >= sizeof(uint32_t) &&
+      (DecodeFixed32(data + size - sizeof(uint32_t)) & kTeraBlockFlag) != 0;
+}
+
+namespace {
+
+class TeraBlockIter : public Iterator {
+ private:
+  const Comparator* const comparator_;
+  const char* const data_;      // underlying block contents
+  uint32_t const limit_;        // Offset just past the last entry
+  uint32_t const restarts_;     // Offset of restart array (list of fixed32)
+  uint32_t const num_restarts_; // Number of uint32_t entries in restart array
+  RawKeyFormat const format_;
+  std::vector<Slice> families_;
+
+  // current_ is offset in data_ of current entry.  >= limit_ if !Valid
+  uint32_t current_;
+  uint32_t next_;           // Offset in data_ just past the current entry
+  uint32_t restart_index_;  // Index of restart block in which current_ falls
+  Slice row_;
+  uint32_t family_;
+  std::string qualifier_;
+  uint64_t ts_type_;
+  uint64_t tag_;
+  std::string key_;         // rebuilt by BuildKey() from the pieces above
+  uint32_t key_family_;     // family in key_
+  size_t prefix_size_;      // Size of the row and family part of key_, 0 if stale
+  Slice value_;
+  Status status_;
+
+  inline int Compare(const Slice& a, const Slice& b) const {
+    return comparator_->Compare(a, b);
+  }
+
+  uint32_t GetRestartPoint(uint32_t index) {
+    assert(index < num_restarts_);
+    return DecodeFixed32(data_ + restarts_ + index * sizeof(uint32_t));
+  }
+
+  void SeekToRestartPoint(uint32_t index) {
+    restart_index_ = index;
+    // current_ and the delta state will be fixed by ParseNextKey();
+    next_ = GetRestartPoint(index);
+  }
+
+ public:
+  TeraBlockIter(const Comparator* comparator,
+                const char* data,
+                uint32_t limit,
+                uint32_t restarts,
+                uint32_t num_restarts,
+                RawKeyFormat format,
+                std::vector<Slice>* families)
+      : comparator_(comparator),
+        data_(data),
+        limit_(limit),
+        restarts_(restarts),
+        num_restarts_(num_restarts),
+        format_(format),
+        current_(limit_),
+        next_(limit_),
+        restart_index_(num_restarts_),
+        family_(0),
+        ts_type_(0),
+        tag_(0),
+        key_family_(0),
+        prefix_size_(0) {
+    assert(num_restarts_ > 0);
+    families_.swap(*families);
+  }
+
+  virtual bool Valid() const { return current_ < limit_; }
+  virtual Status status() const { return status_; }
+  virtual Slice key() const {
+    assert(Valid());
+    return key_;
+  }
+  virtual Slice value() const {
+    assert(Valid());
+    return value_;
+  }
+
+  virtual void Next() {
+    assert(Valid());
+    ParseNextKey();
+  }
+
+  virtual void Prev() {
+    assert(Valid());
+
+    // Scan backwards to a restart point before current_
+    const uint32_t original = current_;
+    while (GetRestartPoint(restart_index_) >= original) {
+      if (restart_index_ == 0) {
+        // No more entries
+        current_ = limit_;
+        restart_index_ = num_restarts_;
+        return;
+      }
+      restart_index_--;
+    }
+
+    SeekToRestartPoint(restart_index_);
+    do {
+      // Loop until end of current entry hits the start of original entry
+    } while (ParseNextKey(false) && next_ < original);
+    if (Valid()) {
+      BuildKey();
+    }
+  }
+
+  virtual void Seek(const Slice& target) {
+    TeraBlockKey target_key;
+    if (!ParseTeraKey(format_, target, &target_key)) {
+      SeekByKey(target);
+      return;
+    }
+    // Keys are ordered by row first: compare the rows of restart points
+    // and entries as they are stored, and rebuild full keys only in the
+    // row of "target".
+    //
+    // Binary search in restart array to find the last restart point
+    // with a key < target
+    uint32_t left = 0;
+    uint32_t right = num_restarts_ - 1;
+    while (left < right) {
+      uint32_t mid = (left + right + 1) / 2;
+      Slice row;
+      if (!RestartRow(mid, &row)) {
+        return;
+      }
+      int r = row.compare(target_key.row);
+      if (r == 0) {
+        // a long row has restart points inside
+        SeekToRestartPoint(mid);
+        if (!ParseNextKey()) {
+          return;
+        }
+        r = Compare(key_, target);
+      }
+      if (r < 0) {
+        left = mid;
+      } else {
+        right = mid - 1;
+      }
+    }
+
+    // Linear search (within restart block) for first key >= target
+    SeekToRestartPoint(left);
+    while (true) {
+      if (!ParseNextKey(false)) {
+        return;
+      }
+      const int r = row_.compare(target_key.row);
+      if (r < 0) {
+        continue;
+      }
+      if (r == 0 && CellBefore(target_key)) {
+        continue;
+      }
+      BuildKey();
+      if (r > 0 || Compare(key_, target) >= 0) {
+        return;
+      }
+    }
+  }
+
+  virtual void SeekToFirst() {
+    SeekToRestartPoint(0);
+    ParseNextKey();
+  }
+
+  virtual void SeekToLast() {
+    SeekToRestartPoint(num_restarts_ - 1);
+    while (ParseNextKey(false) && next_ < limit_) {
+      // Keep skipping
+    }
+    if (Valid()) {
+      BuildKey();
+    }
+  }
+
+ private:
+  void CorruptionError() {
+    current_ = limit_;
+    restart_index_ = num_restarts_;
+    status_ = Status::Corruption("bad entry in tera block");
+    key_.clear();
+    value_.clear();
+    prefix_size_ = 0;
+    qualifier_.clear();
+  }
+
+  // Seek by comparing the full key of every entry, for targets which are
+  // not tera keys
+  void SeekByKey(const Slice& target) {
+    uint32_t left = 0;
+    uint32_t right = num_restarts_ - 1;
+    while (left < right) {
+      uint32_t mid = (left + right + 1) / 2;
+      SeekToRestartPoint(mid);
+      if (!ParseNextKey()) {
+        return;
+      }
+      if (Compare(key_, target) < 0) {
+        left = mid;
+      } else {
+        right = mid - 1;
+      }
+    }
+    SeekToRestartPoint(left);
+    while (true) {
+      if (!ParseNextKey()) {
+        return;
+      }
+      if (Compare(key_, target) >= 0) {
+        return;
+      }
+    }
+  }
+
+  // Return true if the cell of the current entry, in the row of "target",
+  // is before the cell of "target".  Both raw key formats order the keys of
+  // a row by family and then qualifier, but the binary comparator reads
+  // only the low byte of the qualifier length, so cells of longer
+  // qualifiers are left to the full comparison.
+  bool CellBefore(const TeraBlockKey& target) const {
+    if (format_ == kBinary &&
+        (qualifier_.size() > 0xff || target.qualifier.size() > 0xff)) {
+      return false;
+    }
+    const int r = families_[family_].compare(target.family);
+    return r < 0 || (r == 0 && Slice(qualifier_).compare(target.qualifier) < 0);
+  }
+
+  // Set *row to the row of the entry at restart point "index", which is
+  // stored in full at the head of the entry.
+  bool RestartRow(uint32_t index, Slice* row) {
+    const char* p = data_ + GetRestartPoint(index);
+    const char* limit = data_ + limit_;
+    uint32_t header, row_length;
+    if ((p = GetVarint32Ptr(p, limit, &header)) == NULL || (header & 1) == 0 ||
+        (p = GetVarint32Ptr(p, limit, &row_length)) == NULL ||
+        static_cast<uint32_t>(limit - p) < row_length) {
+      CorruptionError();
+      return false;
+    }
+    *row = Slice(p, row_length);
+    return true;
+  }
+
+  // Decode the next entry, and rebuild key_ from it if "build_key".
+  // Otherwise key_ is stale until BuildKey() is called.
+  bool ParseNextKey(bool build_key = true) {
+    current_ = next_;
+    const char* p = data_ + current_;
+    const char* limit = data_ + limit_;
+    if (p >= limit) {
+      // No more entries to return.  Mark as invalid.
+      current_ = limit_;
+      restart_index_ = num_restarts_;
+      return false;
+    }
+    while (restart_index_ + 1 < num_restarts_ &&
+           GetRestartPoint(restart_index_ + 1) <= current_) {
+      ++restart_index_;
+    }
+    const bool restart = (GetRestartPoint(restart_index_) == current_);
+
+    uint32_t header, shared, non_shared, value_length;
+    uint64_t ts_type_delta, tag_delta;
+    if ((p = GetVarint32Ptr(p, limit, &header)) == NULL ||
+        (header >> 1) >= families_.size()) {
+      CorruptionError();
+      return false;
+    }
+    const uint32_t family = header >> 1;
+    const bool new_row = (header & 1) != 0;
+    if (new_row) {
+      uint32_t row_length;
+      if ((p = GetVarint32Ptr(p, limit, &row_length)) == NULL ||
+          static_cast<uint32_t>(limit - p) < row_length) {
+        CorruptionError();
+        return false;
+      }
+      row_ = Slice(p, row_length);
+      p += row_length;
+    } else if (restart) {
+      CorruptionError();
+      return false;
+    }
+    if (restart) {
+      qualifier_.clear();
+      ts_type_ = 0;
+      tag_ = 0;
+    }
+    if ((p = GetVarint32Ptr(p, limit, &shared)) == NULL ||
+        (p = GetVarint32Ptr(p, limit, &non_shared)) == NULL ||
+        qualifier_.size() < shared ||
+        static_cast<uint32_t>(limit - p) < non_shared) {
+      CorruptionError();
+      return false;
+    }
+    const char* qualifier_delta = p;
+    p += non_shared;
+    if ((p = GetDeltaPtr(p, limit, &ts_type_delta)) == NULL ||
+        (p = GetDeltaPtr(p, limit, &tag_delta)) == NULL ||
+        (p = GetVarint32Ptr(p, limit, &value_length)) == NULL ||
+        static_cast<uint32_t>(limit - p) < value_length) {
+      CorruptionError();
+      return false;
+    }
+    ts_type_ += ts_type_delta;
+    tag_ += tag_delta;
+    value_ = Slice(p, value_length);
+    next_ = (p + value_length) - data_;
+
+    qualifier_.resize(shared);
+    qualifier_.append(qualifier_delta, non_shared);
+    if (new_row) {
+      prefix_size_ = 0;
+    }
+    family_ = family;
+    if (build_key) {
+      BuildKey();
+    }
+    return true;
+  }
+
+  // Rebuild key_ from the pieces of the current entry, the row and family
+  // part is kept while they do not change
+  void BuildKey() {
+    if (prefix_size_ == 0 || family_ != key_family_) {
+      const Slice& family_name = families_[family_];
+      key_.assign(row_.data(), row_.size());
+      if (format_ == kReadable) {
+        key_.push_back('\0');
+      }
+      key_.append(family_name.data(), family_name.size());
+      key_.push_back('\0');
+      prefix_size_ = key_.size();
+      key_family_ = family_;
+    } else {
+      key_.resize(prefix_size_);
+    }
+    key_.append(qualifier_);
+
+    char suffix[1 + 8 + 4 + 8];
+    char* dst = suffix;
+    if (format_ == kReadable) {
+      *dst++ = '\0';
+    }
+    EncodeBigEndian(dst, ts_type_);
+    dst += 8;
+    if (format_ == kBinary) {
+      EncodeBigEndian32(dst, (row_.size() << 16) | qualifier_.size());
+      dst += 4;
+    }
+    EncodeFixed64(dst, tag_);
+    dst += 8;
+    key_.append(suffix, dst - suffix);
+  }
+};
+
+}  // namespace
+
+Iterator* NewTeraBlockIterator(const Comparator* comparator,
+                               const char* data, size_t size) {
+  if (size < kTeraBlockTrailerSize) {
+    return NewErrorIterator(Status::Corruption("bad tera block contents"));
+  }
+  const char* trailer = data + size - kTeraBlockTrailerSize;
+  const uint32_t families_offset = DecodeFixed32(trailer);
+  const uint32_t format = DecodeFixed32(trailer + 4);
+  const uint32_t num_restarts = DecodeFixed32(trailer + 8) & ~kTeraBlockFlag;
+  const size_t max_restarts_allowed =
+      (size - kTeraBlockTrailerSize) / sizeof(uint32_t);
+  if (num_restarts > max_restarts_allowed ||
+      (format != kReadable && format != kBinary)) {
+    return NewErrorIterator(Status::Corruption("bad tera block contents"));
+  }
+  const uint32_t restarts =
+      size - kTeraBlockTrailerSize - num_restarts * sizeof(uint32_t);
+  if (families_offset > restarts) {
+    return NewErrorIterator(Status::Corruption("bad tera block contents"));
+  }
+
+  Slice input(data + families_offset, restarts - families_offset);
+  uint32_t num_families;
+  if (!GetVarint32(&input, &num_families) || num_families > input.size()) {
+    return NewErrorIterator(Status::Corruption("bad tera block families"));
+  }
+  std::vector<Slice> families(num_families);
+  for (uint32_t i = 0; i < num_families; i++) {
+    if (!GetLengthPrefixedSlice(&input, &families[i])) {
+      return NewErrorIterator(Status::Corruption("bad tera block families"));
+    }
+  }
+
+  if (num_restarts == 0) {
+    return NewEmptyIterator();
+  }
+  return new TeraBlockIter(comparator, data, families_offset, restarts,
+                           num_restarts, static_cast<RawKeyFormat>(format),
+                           &families);
+}
+
+}  // namespace leveldb
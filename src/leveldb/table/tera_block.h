@@ -0,0 +1,98 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef STORAGE_LEVELDB_TABLE_TERA_BLOCK_H_
+#define STORAGE_LEVELDB_TABLE_TERA_BLOCK_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "leveldb/options.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+class Comparator;
+class Iterator;
+
+// Pieces of an internal key whose user key is a readable or binary tera key.
+struct TeraBlockKey {
+  Slice row;
+  Slice family;
+  Slice qualifier;
+  uint64_t ts_type;   // big-endian timestamp and type of the tera key
+  uint64_t tag;       // sequence and value type of the internal key
+};
+
+// TeraBlockBuilder generates data blocks of tera keys, which store the row
+// key once per row run and the column family as an id of a per-block
+// dictionary.  The qualifier is prefix-compressed against the previous one
+// of the same row, and the timestamp and the internal key tag are
+// delta-encoded.  Restart points start at row boundaries.
+//
+// Blocks are self-describing: the high bit of the trailing restart count
+// tells Block to decode them with NewTeraBlockIterator().
+class TeraBlockBuilder {
+ public:
+  explicit TeraBlockBuilder(const Options* options);
+
+  // Split "key" into *result, return false if it is not an internal key of
+  // options->raw_key_format, which must be kReadable or kBinary.
+  bool ParseKey(const Slice& key, TeraBlockKey* result) const;
+
+  // Reset the contents as if the TeraBlockBuilder was just constructed.
+  void Reset();
+
+  // REQUIRES: Finish() has not been callled since the last call to Reset().
+  // REQUIRES: key is the result of ParseKey() of a key larger than any
+  //           previously added key
+  void Add(const TeraBlockKey& key, const Slice& value);
+
+  // Finish building the block and return a slice that refers to the
+  // block contents.  The returned slice will remain valid for the
+  // lifetime of this builder or until Reset() is called.
+  Slice Finish();
+
+  // Returns an estimate of the current (uncompressed) size of the block
+  // we are building.
+  size_t CurrentSizeEstimate() const;
+
+  // Return true iff no entries have been added since the last Reset()
+  bool empty() const {
+    return buffer_.empty();
+  }
+
+ private:
+  uint32_t FamilyId(const Slice& family);
+
+  const Options*           options_;
+  std::string              buffer_;        // Destination buffer
+  std::vector<uint32_t>    restarts_;      // Restart points
+  std::vector<std::string> families_;      // Column family dictionary
+  size_t                   families_size_; // Encoded size of families_
+  uint32_t                 last_family_;
+  int                      counter_;       // Entries emitted since restart
+  bool                     finished_;      // Has Finish() been called?
+  std::string              last_row_;
+  std::string              last_qualifier_;
+  uint64_t                 last_ts_type_;
+  uint64_t                 last_tag_;
+
+  // No copying allowed
+  TeraBlockBuilder(const TeraBlockBuilder&);
+  void operator=(const TeraBlockBuilder&);
+};
+
+// Return true iff the block contents were generated by TeraBlockBuilder.
+extern bool IsTeraBlock(const char* data, size_t size);
+
+// Return an iterator over the full internal keys of a block generated by
+// TeraBlockBuilder.  The block contents must outlive the iterator.
+extern Iterator* NewTeraBlockIterator(const Comparator* comparator,
+                                      const char* data, size_t size);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_TABLE_TERA_BLOCK_H_
@@ -0,0 +1,362 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "table/tera_block.h"
+
+#include <algorithm>
+#include <memory>
+#include <string.h>
+#include "db/dbformat.h"
+#include "leveldb/comparator.h"
+#include "leveldb/env.h"
+#include "leveldb/iterator.h"
+#include "leveldb/raw_key_operator.h"
+#include "leveldb/table.h"
+#include "leveldb/table_builder.h"
+#include "table/block.h"
+#include "table/block_builder.h"
+#include "table/format.h"
+#include "util/random.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class StringSink: public WritableFile {
+ public:
+  const std::string& contents() const { return contents_; }
+  virtual Status Close() { return Status::OK(); }
+  virtual Status Flush() { return Status::OK(); }
+  virtual Status Sync() { return Status::OK(); }
+  virtual Status Append(const Slice& data) {
+    contents_.append(data.data(), data.size());
+    return Status::OK();
+  }
+
+ private:
+  std::string contents_;
+};
+
+class StringSource: public RandomAccessFile {
+ public:
+  explicit StringSource(const std::string& contents) : contents_(contents) { }
+  virtual Status Read(uint64_t offset, size_t n, Slice* result,
+                      char* scratch) const {
+    if (offset > contents_.size()) {
+      return Status::InvalidArgument("invalid Read offset");
+    }
+    if (offset + n > contents_.size()) {
+      n = contents_.size() - offset;
+    }
+    memcpy(scratch, &contents_[offset], n);
+    *result = Slice(scratch, n);
+    return Status::OK();
+  }
+
+ private:
+  std::string contents_;
+};
+
+struct InternalKeyLess {
+  explicit InternalKeyLess(const Comparator* cmp) : cmp_(cmp) { }
+  bool operator()(const std::string& a, const std::string& b) const {
+    return cmp_->Compare(a, b) < 0;
+  }
+  const Comparator* cmp_;
+};
+
+class TeraBlockTest {
+ public:
+  TeraBlockTest() : rnd_(301), icmp_(BytewiseComparator()) { }
+
+  void Init(RawKeyFormat format) {
+    options_.raw_key_format = format;
+    key_operator_ = (format == kReadable) ? ReadableRawKeyOperator()
+                                          : BinaryRawKeyOperator();
+    icmp_ = InternalKeyComparator((format == kReadable) ? BytewiseComparator()
+                                                        : TeraBinaryComparator());
+    options_.comparator = &icmp_;
+    keys_.clear();
+    num_tera_keys_ = 0;
+  }
+
+  std::string Key(const std::string& row, const std::string& family,
+                  const std::string& qualifier, int64_t ts, SequenceNumber seq) {
+    std::string tera_key;
+    key_operator_->EncodeTeraKey(row, family, qualifier, ts, TKT_VALUE, &tera_key);
+    std::string key;
+    AppendInternalKey(&key, ParsedInternalKey(tera_key, seq, kTypeValue));
+    return key;
+  }
+
+  // rows of a few column families with several versions of each cell
+  void GenerateKeys(int num_rows) {
+    const char* families[] = {"cf", "family", "meta"};
+    SequenceNumber seq = 1000;
+    for (int r = 0; r < num_rows; r++) {
+      char row[32];
+      snprintf(row, sizeof(row), "user_%012d", r * 7);
+      int cells = 1 + rnd_.Uniform(12);
+      for (int c = 0; c < cells; c++) {
+        char qualifier[32];
+        snprintf(qualifier, sizeof(qualifier), "qualifier%d", c);
+        int versions = 1 + rnd_.Uniform(3);
+        for (int v = 0; v < versions; v++) {
+          keys_.push_back(Key(row, families[rnd_.Uniform(3)], qualifier,
+                              1500000000000000LL + rnd_.Uniform(1000000), seq++));
+        }
+      }
+    }
+    std::sort(keys_.begin(), keys_.end(), InternalKeyLess(&icmp_));
+    keys_.erase(std::unique(keys_.begin(), keys_.end()), keys_.end());
+    num_tera_keys_ = keys_.size();
+  }
+
+  std::string Value(size_t i) {
+    return std::string(i % 16, 'v');
+  }
+
+  Slice BuildBlock() {
+    builder_.reset(new TeraBlockBuilder(&options_));
+    for (size_t i = 0; i < keys_.size(); i++) {
+      TeraBlockKey key;
+      ASSERT_TRUE(builder_->ParseKey(keys_[i], &key));
+      builder_->Add(key, Value(i));
+    }
+    return builder_->Finish();
+  }
+
+  size_t DefaultBlockSize() {
+    BlockBuilder builder(&options_);
+    for (size_t i = 0; i < keys_.size(); i++) {
+      builder.Add(keys_[i], Value(i));
+    }
+    return builder.Finish().size();
+  }
+
+  void CheckIterator(Iterator* iter) {
+    // forward
+    iter->SeekToFirst();
+    for (size_t i = 0; i < keys_.size(); i++) {
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(EscapeString(keys_[i]), EscapeString(iter->key()));
+      ASSERT_EQ(Value(i), iter->value().ToString());
+      iter->Next();
+    }
+    ASSERT_TRUE(!iter->Valid());
+
+    // backward
+    iter->SeekToLast();
+    for (size_t i = keys_.size(); i > 0; i--) {
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(EscapeString(keys_[i - 1]), EscapeString(iter->key()));
+      iter->Prev();
+    }
+    ASSERT_TRUE(!iter->Valid());
+
+    // seek to every key, and to the cell of every key with a later timestamp
+    for (size_t i = 0; i < keys_.size(); i++) {
+      iter->Seek(keys_[i]);
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(EscapeString(keys_[i]), EscapeString(iter->key()));
+      if (i >= num_tera_keys_) {
+        continue;
+      }
+
+      Slice row, family, qualifier;
+      int64_t ts;
+      TeraKeyType type;
+      ASSERT_TRUE(key_operator_->ExtractTeraKey(ExtractUserKey(keys_[i]), &row,
+                                                &family, &qualifier, &ts, &type));
+      std::string target = Key(row.ToString(), family.ToString(),
+                               qualifier.ToString(), ts + 1, kMaxSequenceNumber);
+      iter->Seek(target);
+      std::vector<std::string>::iterator expected =
+          std::lower_bound(keys_.begin(), keys_.end(), target, InternalKeyLess(&icmp_));
+      ASSERT_TRUE(expected != keys_.end());
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(EscapeString(*expected), EscapeString(iter->key()));
+    }
+    iter->Seek(Key("zzzz", "", "", 0, 0));
+    ASSERT_TRUE(!iter->Valid());
+    ASSERT_OK(iter->status());
+  }
+
+  void TestFormat(RawKeyFormat format) {
+    Init(format);
+    GenerateKeys(100);
+    Slice raw = BuildBlock();
+    ASSERT_TRUE(IsTeraBlock(raw.data(), raw.size()));
+    size_t default_size = DefaultBlockSize();
+    fprintf(stderr, "%s: %d keys, tera block %d bytes, default block %d bytes\n",
+            key_operator_->Name(), static_cast<int>(keys_.size()),
+            static_cast<int>(raw.size()), static_cast<int>(default_size));
+    ASSERT_LT(raw.size(), default_size);
+
+    BlockContents contents;
+    contents.data = raw;
+    contents.cachable = false;
+    contents.heap_allocated = false;
+    Block block(contents);
+    Iterator* iter = block.NewIterator(&icmp_);
+    CheckIterator(iter);
+    delete iter;
+
+    BlockBuilder default_builder(&options_);
+    for (size_t i = 0; i < keys_.size(); i++) {
+      default_builder.Add(keys_[i], Value(i));
+    }
+    contents.data = default_builder.Finish();
+    Block default_block(contents);
+    fprintf(stderr, "%s: seek tera block %d ns, default block %d ns\n",
+            key_operator_->Name(), SeekNanos(&block), SeekNanos(&default_block));
+  }
+
+  int SeekNanos(Block* block) {
+    Iterator* iter = block->NewIterator(&icmp_);
+    const int kRounds = 20;
+    uint64_t start = Env::Default()->NowMicros();
+    for (int r = 0; r < kRounds; r++) {
+      for (size_t i = 0; i < keys_.size(); i++) {
+        iter->Seek(keys_[i]);
+      }
+    }
+    uint64_t used = Env::Default()->NowMicros() - start;
+    delete iter;
+    return used * 1000 / (kRounds * keys_.size());
+  }
+
+  Random rnd_;
+  InternalKeyComparator icmp_;
+  Options options_;
+  const RawKeyOperator* key_operator_;
+  std::vector<std::string> keys_;
+  size_t num_tera_keys_;
+  std::unique_ptr<TeraBlockBuilder> builder_;
+};
+
+TEST(TeraBlockTest, Readable) {
+  TestFormat(kReadable);
+}
+
+TEST(TeraBlockTest, Binary) {
+  TestFormat(kBinary);
+}
+
+// Rows longer than the restart interval have restart points inside, and
+// targets which are not tera keys are compared in full
+TEST(TeraBlockTest, LongRow) {
+  Init(kReadable);
+  SequenceNumber seq = 1000;
+  for (int r = 0; r < 5; r++) {
+    char row[32];
+    snprintf(row, sizeof(row), "row%d", r);
+    for (int c = 0; c < (r == 2 ? 200 : 3); c++) {
+      char qualifier[32];
+      snprintf(qualifier, sizeof(qualifier), "qualifier%03d", c);
+      keys_.push_back(Key(row, "cf", qualifier, 1500000000000000LL + c, seq++));
+    }
+  }
+  std::sort(keys_.begin(), keys_.end(), InternalKeyLess(&icmp_));
+  num_tera_keys_ = keys_.size();
+  Slice raw = BuildBlock();
+  BlockContents contents;
+  contents.data = raw;
+  contents.cachable = false;
+  contents.heap_allocated = false;
+  Block block(contents);
+  Iterator* iter = block.NewIterator(&icmp_);
+  CheckIterator(iter);
+
+  std::string target = "row2";
+  PutFixed64(&target, (kMaxSequenceNumber << 8) | kTypeValue);
+  iter->Seek(target);
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(EscapeString(keys_[6]), EscapeString(iter->key()));
+  delete iter;
+}
+
+TEST(TeraBlockTest, ParseKey) {
+  Init(kReadable);
+  TeraBlockBuilder builder(&options_);
+  TeraBlockKey key;
+  std::string readable_key = Key("row", "cf", "", 5, 1);
+  ASSERT_TRUE(builder.ParseKey(readable_key, &key));
+  ASSERT_EQ("row", key.row.ToString());
+  ASSERT_EQ("cf", key.family.ToString());
+  ASSERT_EQ("", key.qualifier.ToString());
+  ASSERT_EQ((1ULL << 8) | kTypeValue, key.tag);
+  ASSERT_TRUE(!builder.ParseKey("", &key));
+  ASSERT_TRUE(!builder.ParseKey("not a tera key00000000", &key));
+
+  Init(kBinary);
+  std::string binary_key = Key("row", "cf", "qu", 5, 1);
+  ASSERT_TRUE(builder.ParseKey(binary_key, &key));
+  ASSERT_EQ("row", key.row.ToString());
+  ASSERT_EQ("cf", key.family.ToString());
+  ASSERT_EQ("qu", key.qualifier.ToString());
+  ASSERT_TRUE(!builder.ParseKey("not a tera key00000000", &key));
+}
+
+TEST(TeraBlockTest, Corruption) {
+  Init(kReadable);
+  GenerateKeys(10);
+  std::string raw = BuildBlock().ToString();
+  // point the family dictionary past the restart array
+  EncodeFixed32(&raw[raw.size() - 12], raw.size());
+  BlockContents contents;
+  contents.data = raw;
+  contents.cachable = false;
+  contents.heap_allocated = false;
+  Block block(contents);
+  Iterator* iter = block.NewIterator(&icmp_);
+  iter->SeekToFirst();
+  ASSERT_TRUE(!iter->Valid());
+  ASSERT_TRUE(iter->status().IsCorruption());
+  delete iter;
+}
+
+// Non-tera keys switch the rest of the table to the default block format
+TEST(TeraBlockTest, Table) {
+  Init(kReadable);
+  GenerateKeys(1000);
+  std::string tail = "zzz";
+  PutFixed64(&tail, (1ULL << 8) | kTypeValue);
+  keys_.push_back(tail);
+  options_.use_tera_block_encoding = true;
+  options_.compression = kNoCompression;
+  options_.block_size = 1024;
+
+  StringSink sink;
+  TableBuilder builder(options_, &sink);
+  for (size_t i = 0; i < keys_.size(); i++) {
+    builder.Add(keys_[i], Value(i));
+  }
+  ASSERT_OK(builder.Finish());
+
+  Table* table = NULL;
+  StringSource* source = new StringSource(sink.contents());
+  ASSERT_OK(Table::Open(options_, source, sink.contents().size(), &table));
+  Iterator* iter = table->NewIterator(ReadOptions(&options_));
+  CheckIterator(iter);
+  delete iter;
+  delete table;
+  delete source;
+
+  // the same table in the default block format is larger
+  keys_.pop_back();
+  StringSink default_sink;
+  options_.use_tera_block_encoding = false;
+  TableBuilder default_builder(options_, &default_sink);
+  for (size_t i = 0; i < keys_.size(); i++) {
+    default_builder.Add(keys_[i], Value(i));
+  }
+  ASSERT_OK(default_builder.Finish());
+  ASSERT_LT(sink.contents().size(), default_sink.contents().size());
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
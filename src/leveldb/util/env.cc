@@ -14,6 +14,7 @@ EnvOptions::EnvOptions(const Options& options) {
     use_direct_io_read = options.use_direct_io_read;
     use_direct_io_write = options.use_direct_io_write;
     posix_write_buffer_size = options.posix_write_buffer_size;
+    use_mmap_read = options.use_mmap_read;
 }
 
 Env::~Env() {
@@ -207,7 +207,7 @@ class PosixRandomAccessFile: public RandomAccessFile {
 // problems for very large databases.
 class MmapLimiter {
  public:
-  MmapLimiter() {
+  MmapLimiter() : limit_(0) {
     //Disable mmap in tera for reducing memory use.
     SetAllowed(0);
 
@@ -216,31 +216,40 @@ class MmapLimiter {
     //If you want to enable mmap, uncomment the line above.
   }
 
-  // If another mmap slot is available, acquire it and return true.
+  // Change the number of slots to "limit", slots acquired before are
+  // still released by Release().
+  void SetLimit(intptr_t limit) {
+    MutexLock l(&mu_);
+    SetAllowed(GetAllowed() + limit - limit_);
+    limit_ = limit;
+  }
+
+  // If another n mmap slots are available, acquire them and return true.
   // Else return false.
-  bool Acquire() {
-    if (GetAllowed() <= 0) {
+  bool Acquire(intptr_t n = 1) {
+    if (GetAllowed() < n) {
       return false;
     }
     MutexLock l(&mu_);
     intptr_t x = GetAllowed();
-    if (x <= 0) {
+    if (x < n) {
       return false;
     } else {
-      SetAllowed(x - 1);
+      SetAllowed(x - n);
       return true;
     }
   }
 
-  // Release a slot acquired by a previous call to Acquire() that returned true.
-  void Release() {
+  // Release slots acquired by a previous call to Acquire() that returned true.
+  void Release(intptr_t n = 1) {
     MutexLock l(&mu_);
-    SetAllowed(GetAllowed() + 1);
+    SetAllowed(GetAllowed() + n);
   }
 
  private:
   port::Mutex mu_;
   port::AtomicPointer allowed_;
+  intptr_t limit_;
 
   intptr_t GetAllowed() const {
     return reinterpret_cast<intptr_t>(allowed_.Acquire_Load());
@@ -255,6 +264,10 @@ class MmapLimiter {
   void operator=(const MmapLimiter&);
 };
 
+// Bytes of the files mapped for EnvOptions::use_mmap_read, shared by all
+// the posix envs of the process, see SetMmapReadBudget().
+static MmapLimiter mmap_read_budget;
+
 // mmap() based random-access
 class PosixMmapReadableFile: public RandomAccessFile {
  private:
@@ -262,18 +275,19 @@ class PosixMmapReadableFile: public RandomAccessFile {
   void* mmapped_region_;
   size_t length_;
   MmapLimiter* limiter_;
+  intptr_t acquired_;   // Slots of limiter_ held by the file
 
  public:
   // base[0,length-1] contains the mmapped contents of the file.
   PosixMmapReadableFile(const std::string& fname, void* base, size_t length,
-                        MmapLimiter* limiter)
+                        MmapLimiter* limiter, intptr_t acquired = 1)
       : filename_(fname), mmapped_region_(base), length_(length),
-        limiter_(limiter) {
+        limiter_(limiter), acquired_(acquired) {
   }
 
   virtual ~PosixMmapReadableFile() {
     munmap(mmapped_region_, length_);
-    limiter_->Release();
+    limiter_->Release(acquired_);
   }
 
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
@@ -534,8 +548,22 @@ class PosixEnv : public Env {
         flags |= O_DIRECT;
     }
     int fd = open(fname.c_str(), flags);
+    uint64_t file_size = 0;
     if (fd < 0) {
       s = IOError(fname, errno);
+    } else if (!options.use_direct_io_read && options.use_mmap_read &&
+               GetFileSize(fname, &file_size).ok() && file_size > 0 &&
+               mmap_read_budget.Acquire(file_size)) {
+      void* base = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (base != MAP_FAILED) {
+        *result = new PosixMmapReadableFile(fname, base, file_size,
+                                            &mmap_read_budget, file_size);
+        close(fd);
+      } else {
+        // Read it by pread() as if the budget was used up
+        mmap_read_budget.Release(file_size);
+        *result = new PosixRandomAccessFile(fname, fd, options);
+      }
     } else if (!options.use_direct_io_read && mmap_limit_.Acquire()) {
       uint64_t size;
       s = GetFileSize(fname, &size);
@@ -903,6 +931,10 @@ Env* NewPosixEnv() {
   return new PosixEnv;
 }
 
+void SetMmapReadBudget(uint64_t bytes) {
+  mmap_read_budget.SetLimit(static_cast<intptr_t>(bytes));
+}
+
 PosixWritableFile::PosixWritableFile(const std::string& fname,
                   int fd,
                   const EnvOptions& options)
@@ -190,6 +190,55 @@ TEST(EnvPosixTest, StartThread) {
     ASSERT_EQ(state.val, 3);
 }
 
+// Files are mapped while the budget lasts, the others are read by pread()
+TEST(EnvPosixTest, MmapReadBudget) {
+    const std::string fname[3] = {"/tmp/posix_mmap_test_file0",
+                                  "/tmp/posix_mmap_test_file1",
+                                  "/tmp/posix_mmap_test_file2"};
+    const std::string content(10000, 'm');
+    for (int i = 0; i < 3; i++) {
+        WritableFile* file = NULL;
+        ASSERT_OK(env_->NewWritableFile(fname[i], &file, EnvOptions()));
+        ASSERT_OK(file->Append(content));
+        ASSERT_OK(file->Close());
+        delete file;
+    }
+    SetMmapReadBudget(2 * content.size() + 1);
+
+    EnvOptions env_opt;
+    env_opt.use_mmap_read = true;
+    RandomAccessFile* rfile[3];
+    char scratch[100];
+    for (int i = 0; i < 3; i++) {
+        ASSERT_OK(env_->NewRandomAccessFile(fname[i], &rfile[i], env_opt));
+        Slice result;
+        ASSERT_OK(rfile[i]->Read(5000, 100, &result, scratch));
+        ASSERT_EQ(content.substr(5000, 100), result.ToString());
+        // the first two files are mapped
+        ASSERT_EQ(i < 2, result.data() != scratch);
+    }
+
+    // the budget of a closed file is reused
+    delete rfile[0];
+    RandomAccessFile* file = NULL;
+    ASSERT_OK(env_->NewRandomAccessFile(fname[0], &file, env_opt));
+    Slice result;
+    ASSERT_OK(file->Read(0, 100, &result, scratch));
+    ASSERT_TRUE(result.data() != scratch);
+    delete file;
+    delete rfile[1];
+    delete rfile[2];
+
+    SetMmapReadBudget(0);
+    ASSERT_OK(env_->NewRandomAccessFile(fname[0], &file, env_opt));
+    ASSERT_OK(file->Read(0, 100, &result, scratch));
+    ASSERT_TRUE(result.data() == scratch);
+    delete file;
+    for (int i = 0; i < 3; i++) {
+        env_->DeleteFile(fname[i]);
+    }
+}
+
 #define TEST_DATA_SIZE  384 // will cross buffer boundary
 #define TEST_DATA_NUM   500
 const std::string block_based_cache_paths = "./block_based_dir";
@@ -34,6 +34,9 @@ Options::Options()
       compact_strategy_factory(NULL),
       log_file_size(2 << 20),
       log_async_mode(true),
+      log_stream_num(1),
+      shared_log(NULL),
+      rate_limiter(NULL),
       max_block_log_number(50),
       write_log_time_out(5),
       flush_triggered_log_num(100000),
@@ -61,7 +64,13 @@ Options::Options()
       use_direct_io_write(false),
       posix_write_buffer_size(512<<10),
       table_builder_batch_write(false),
-      table_builder_batch_size(0) { }
+      table_builder_batch_size(0),
+      use_tera_block_encoding(false),
+      data_block_hash_index(false),
+      use_mmap_read(false),
+      compaction_style(kLeveledCompaction),
+      tiered_size_ratio(200),
+      dump_compress_threads(0) { }
 
 FlashBlockCacheOptions::FlashBlockCacheOptions()
   : force_update_conf_enabled(false),
@@ -0,0 +1,192 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "leveldb/rate_limiter.h"
+
+#include <algorithm>
+
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+RateLimiterOptions::RateLimiterOptions()
+    : target_latency_us(0),
+      min_rate_divisor(8),
+      max_cut_debt(0.5) {
+  for (int i = 0; i < kIOPriorityNum; ++i) {
+    max_bytes_per_sec[i] = 0;
+  }
+}
+
+RateLimiter::~RateLimiter() {
+}
+
+namespace {
+
+// the tokens of an idle class are capped to the bytes of this time
+static const int64_t kBurstMicros = 100000;
+
+class TokenBucketRateLimiter : public RateLimiter {
+ public:
+  TokenBucketRateLimiter(Env* env, const RateLimiterOptions& options)
+      : env_(env),
+        target_latency_us_(options.target_latency_us),
+        min_rate_divisor_(std::max<int64_t>(options.min_rate_divisor, 1)),
+        max_cut_debt_(options.max_cut_debt) {
+    uint64_t now = env_->NowMicros();
+    for (int i = 0; i < kIOPriorityNum; ++i) {
+      Bucket* b = &buckets_[i];
+      b->max_rate = options.max_bytes_per_sec[i];
+      b->rate = b->max_rate;
+      b->tokens = 0;
+      b->last_refill_us = now;
+      b->total_bytes = 0;
+      b->total_wait_us = 0;
+    }
+  }
+
+  virtual void Request(size_t bytes, IOPriority pri) {
+    int64_t wait_us = 0;
+    {
+      MutexLock l(&mu_);
+      Bucket* b = &buckets_[pri];
+      b->total_bytes += bytes;
+      if (b->rate <= 0) {
+        return;
+      }
+      Refill(b, env_->NowMicros());
+      // tokens go negative for the bytes granted ahead of time, the
+      // requests coming later wait for this debt to be paid off first
+      b->tokens -= static_cast<int64_t>(bytes);
+      if (b->tokens < 0) {
+        wait_us = -b->tokens * 1000000 / b->rate;
+        b->total_wait_us += wait_us;
+      }
+    }
+    if (wait_us > 0) {
+      env_->SleepForMicroseconds(static_cast<int>(wait_us));
+    }
+  }
+
+  virtual int64_t GetBytesPerSecond(IOPriority pri) {
+    MutexLock l(&mu_);
+    return buckets_[pri].rate;
+  }
+
+  virtual void SetBytesPerSecond(IOPriority pri, int64_t bytes_per_sec) {
+    MutexLock l(&mu_);
+    Bucket* b = &buckets_[pri];
+    Refill(b, env_->NowMicros());
+    b->max_rate = bytes_per_sec;
+    b->rate = bytes_per_sec;
+  }
+
+  virtual void Tune(int64_t fg_latency_us, double compaction_debt) {
+    if (target_latency_us_ <= 0) {
+      return;
+    }
+    MutexLock l(&mu_);
+    uint64_t now = env_->NowMicros();
+    for (int i = kIOL0Compaction; i < kIOPriorityNum; ++i) {
+      Bucket* b = &buckets_[i];
+      if (b->max_rate <= 0) {
+        continue;
+      }
+      Refill(b, now);
+      int64_t min_rate = std::max<int64_t>(b->max_rate / min_rate_divisor_, 1);
+      if (compaction_debt >= 1 || fg_latency_us < target_latency_us_ / 2) {
+        // raised back while the reads are fast, and whatever the latency
+        // once a db is about to slow down its writes: slower compactions
+        // would only add level 0 files to every read
+        b->rate = std::min(b->rate + b->max_rate / 8 + 1, b->max_rate);
+      } else if (fg_latency_us > target_latency_us_ && compaction_debt < max_cut_debt_) {
+        // multiplicative decrease while there is little compaction debt,
+        // deep compactions give way first
+        int64_t cut = (i == kIODeepCompaction) ? b->rate / 2 : b->rate / 4;
+        b->rate = std::max(b->rate - cut, min_rate);
+      }
+    }
+  }
+
+  virtual int64_t TotalBytes(IOPriority pri) {
+    MutexLock l(&mu_);
+    return buckets_[pri].total_bytes;
+  }
+
+  virtual int64_t TotalWaitMicros(IOPriority pri) {
+    MutexLock l(&mu_);
+    return buckets_[pri].total_wait_us;
+  }
+
+ private:
+  struct Bucket {
+    int64_t max_rate;
+    int64_t rate;
+    int64_t tokens;
+    uint64_t last_refill_us;
+    int64_t total_bytes;
+    int64_t total_wait_us;
+  };
+
+  // REQUIRES: mu_ held
+  void Refill(Bucket* b, uint64_t now) {
+    if (now <= b->last_refill_us) {
+      return;
+    }
+    if (b->rate > 0) {
+      int64_t elapsed_us = std::min<int64_t>(now - b->last_refill_us, kBurstMicros * 10);
+      b->tokens += elapsed_us * b->rate / 1000000;
+      b->tokens = std::min(b->tokens, b->rate * kBurstMicros / 1000000);
+    }
+    b->last_refill_us = now;
+  }
+
+  Env* const env_;
+  const int64_t target_latency_us_;
+  const int64_t min_rate_divisor_;
+  const double max_cut_debt_;
+  port::Mutex mu_;
+  Bucket buckets_[kIOPriorityNum];
+};
+
+class RateLimitedFile : public WritableFile {
+ public:
+  RateLimitedFile(WritableFile* base, RateLimiter* limiter, IOPriority pri)
+      : base_(base), limiter_(limiter), pri_(pri) {
+  }
+
+  virtual ~RateLimitedFile() {
+    delete base_;
+  }
+
+  virtual Status Append(const Slice& data) {
+    limiter_->Request(data.size(), pri_);
+    return base_->Append(data);
+  }
+
+  virtual Status Close() { return base_->Close(); }
+  virtual Status Flush() { return base_->Flush(); }
+  virtual Status Sync() { return base_->Sync(); }
+
+ private:
+  WritableFile* base_;
+  RateLimiter* limiter_;
+  IOPriority pri_;
+};
+
+}  // namespace
+
+RateLimiter* NewRateLimiter(Env* env, const RateLimiterOptions& options) {
+  return new TokenBucketRateLimiter(env, options);
+}
+
+WritableFile* NewRateLimitedFile(WritableFile* base,
+                                 RateLimiter* limiter,
+                                 IOPriority pri) {
+  return new RateLimitedFile(base, limiter, pri);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,172 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "leveldb/rate_limiter.h"
+
+#include "leveldb/env.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class StringFile : public WritableFile {
+ public:
+  explicit StringFile(std::string* contents) : contents_(contents) { }
+  virtual Status Append(const Slice& data) {
+    contents_->append(data.data(), data.size());
+    return Status::OK();
+  }
+  virtual Status Close() { return Status::OK(); }
+  virtual Status Flush() { return Status::OK(); }
+  virtual Status Sync() { return Status::OK(); }
+
+ private:
+  std::string* contents_;
+};
+
+class RateLimiterTest {
+ public:
+  RateLimiterTest() : env_(Env::Default()) { }
+
+  RateLimiter* NewLimiter(int64_t flush_rate, int64_t l0_rate, int64_t deep_rate,
+                          int64_t target_latency_us = 0) {
+    RateLimiterOptions options;
+    options.max_bytes_per_sec[kIOFlush] = flush_rate;
+    options.max_bytes_per_sec[kIOL0Compaction] = l0_rate;
+    options.max_bytes_per_sec[kIODeepCompaction] = deep_rate;
+    options.target_latency_us = target_latency_us;
+    return NewRateLimiter(env_, options);
+  }
+
+  Env* env_;
+};
+
+TEST(RateLimiterTest, Unlimited) {
+  RateLimiter* limiter = NewLimiter(0, 0, 0);
+  uint64_t start = env_->NowMicros();
+  for (int i = 0; i < 1000; i++) {
+    limiter->Request(1 << 20, kIODeepCompaction);
+  }
+  ASSERT_LT(env_->NowMicros() - start, 1000000U);
+  ASSERT_EQ(limiter->TotalBytes(kIODeepCompaction), 1000LL << 20);
+  ASSERT_EQ(limiter->TotalWaitMicros(kIODeepCompaction), 0);
+  delete limiter;
+}
+
+TEST(RateLimiterTest, Throttle) {
+  // 1MB at 4MB/s takes about 250ms
+  RateLimiter* limiter = NewLimiter(0, 0, 4 << 20);
+  uint64_t start = env_->NowMicros();
+  for (int i = 0; i < 16; i++) {
+    limiter->Request(64 << 10, kIODeepCompaction);
+  }
+  uint64_t used = env_->NowMicros() - start;
+  ASSERT_GT(used, 200000U);
+  ASSERT_LT(used, 2000000U);
+  ASSERT_GT(limiter->TotalWaitMicros(kIODeepCompaction), 100000);
+  ASSERT_EQ(limiter->TotalBytes(kIODeepCompaction), 1 << 20);
+
+  // the budget of the other classes is not touched
+  start = env_->NowMicros();
+  limiter->Request(8 << 20, kIOFlush);
+  ASSERT_LT(env_->NowMicros() - start, 100000U);
+  ASSERT_EQ(limiter->TotalWaitMicros(kIOFlush), 0);
+  delete limiter;
+}
+
+TEST(RateLimiterTest, SetBytesPerSecond) {
+  RateLimiter* limiter = NewLimiter(0, 0, 0);
+  limiter->SetBytesPerSecond(kIOL0Compaction, 1 << 20);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIOL0Compaction), 1 << 20);
+  limiter->Request(100 << 10, kIOL0Compaction);
+  ASSERT_GT(limiter->TotalWaitMicros(kIOL0Compaction), 0);
+  limiter->SetBytesPerSecond(kIOL0Compaction, 0);
+  int64_t waited = limiter->TotalWaitMicros(kIOL0Compaction);
+  limiter->Request(100 << 20, kIOL0Compaction);
+  ASSERT_EQ(limiter->TotalWaitMicros(kIOL0Compaction), waited);
+  delete limiter;
+}
+
+TEST(RateLimiterTest, Tune) {
+  const int64_t kRate = 64 << 20;
+  RateLimiter* limiter = NewLimiter(kRate, kRate, kRate, 1000);
+
+  // slow foreground requests cut the compactions, deep ones first
+  limiter->Tune(5000, 0);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIOFlush), kRate);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIOL0Compaction), kRate - kRate / 4);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIODeepCompaction), kRate / 2);
+  for (int i = 0; i < 100; i++) {
+    limiter->Tune(5000, 0);
+  }
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIOFlush), kRate);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIOL0Compaction), kRate / 8);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIODeepCompaction), kRate / 8);
+
+  // keep the rates between target / 2 and target
+  limiter->Tune(800, 0);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIODeepCompaction), kRate / 8);
+
+  // raised back to the max while idle
+  for (int i = 0; i < 100; i++) {
+    limiter->Tune(0, 0);
+  }
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIOL0Compaction), kRate);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIODeepCompaction), kRate);
+  delete limiter;
+
+  // no tuning without a target
+  limiter = NewLimiter(kRate, kRate, kRate);
+  limiter->Tune(5000, 0);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIODeepCompaction), kRate);
+  delete limiter;
+}
+
+TEST(RateLimiterTest, TuneByCompactionDebt) {
+  const int64_t kRate = 64 << 20;
+  RateLimiter* limiter = NewLimiter(kRate, kRate, kRate, 1000);
+
+  // no cut while the compactions are behind, whatever the latency
+  limiter->Tune(5000, 0.6);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIOL0Compaction), kRate);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIODeepCompaction), kRate);
+
+  for (int i = 0; i < 100; i++) {
+    limiter->Tune(5000, 0.1);
+  }
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIOL0Compaction), kRate / 8);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIODeepCompaction), kRate / 8);
+
+  // level 0 files pile up: hold the rates, then raise them back to the max
+  limiter->Tune(5000, 0.8);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIODeepCompaction), kRate / 8);
+  limiter->Tune(5000, 1.0);
+  ASSERT_GT(limiter->GetBytesPerSecond(kIODeepCompaction), kRate / 8);
+  for (int i = 0; i < 100; i++) {
+    limiter->Tune(5000, 1.5);
+  }
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIOL0Compaction), kRate);
+  ASSERT_EQ(limiter->GetBytesPerSecond(kIODeepCompaction), kRate);
+  delete limiter;
+}
+
+TEST(RateLimiterTest, RateLimitedFile) {
+  RateLimiter* limiter = NewLimiter(0, 0, 0);
+  std::string contents;
+  WritableFile* file = NewRateLimitedFile(new StringFile(&contents), limiter, kIOFlush);
+  ASSERT_OK(file->Append("hello"));
+  ASSERT_OK(file->Append(" world"));
+  ASSERT_OK(file->Sync());
+  ASSERT_OK(file->Close());
+  delete file;
+  ASSERT_EQ(contents, "hello world");
+  ASSERT_EQ(limiter->TotalBytes(kIOFlush), 11);
+  ASSERT_EQ(limiter->TotalBytes(kIOL0Compaction), 0);
+  delete limiter;
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
@@ -29,6 +29,7 @@ DEFINE_int32(tera_master_impl_retry_times, 5, "the max retry times when master i
 DEFINE_double(tera_master_workload_merge_threshold, 1.0, "if workload(wwl) < 1.0, enable merge on this tablet");
 DEFINE_double(tera_master_workload_split_threshold, 9.9, "if workload(wwl) > 9.9, trigger split by workload");
 DEFINE_int64(tera_master_min_split_size, 64, "the size (in MB) of tablet to trigger split");
+DEFINE_int64(tera_master_load_split_qps_threshold, 0, "split tablets with qps (rows read, written and scanned per second) over it at the median key of their load, 0 means disable");
 DEFINE_double(tera_master_min_split_ratio, 0.5, "min ratio of split size of tablet schema to trigger split");
 DEFINE_int64(tera_master_split_history_time_interval, 600000, "minimal split time interval(ms)");
 DEFINE_string(tera_master_gc_strategy, "trackable", "gc strategy, [default, trackable]");
@@ -60,6 +61,7 @@ DEFINE_int32(tera_master_control_tabletnode_retry_period, 60000, "the retry peri
 DEFINE_int32(tera_master_load_rpc_timeout, 60000, "the timeout period (in ms) for load rpc");
 DEFINE_int32(tera_master_unload_rpc_timeout, 60000, "the timeout period (in ms) for unload rpc");
 DEFINE_int32(tera_master_split_rpc_timeout, 120000, "the timeout period (in ms) for split rpc");
+DEFINE_int32(tera_master_prewarm_rpc_timeout, 60000, "the timeout period (in ms) for prewarm rpc");
 DEFINE_int32(tera_master_tabletnode_timeout, 60000, "the timeout period (in ms) for move tablet after tabletnode down");
 DEFINE_int32(tera_master_collect_info_timeout, 3000, "the timeout period (in ms) for collect tabletnode info");
 DEFINE_int32(tera_master_collect_info_retry_period, 3000, "the retry period (in ms) for collect tabletnode info");
@@ -79,5 +81,9 @@ DEFINE_int64(tera_master_gc_trash_clean_period_s, 3600, "period (in second) for
 DEFINE_bool(tera_master_availability_check_enabled, true, "whether execute availability check");    // reload config safety
 DEFINE_int64(tera_master_availability_check_period, 60, "the period (in s) of availability check"); // reload config safety
 DEFINE_bool(tera_master_update_split_meta, true, "[split] update child tablets meta from master");
+DEFINE_bool(tera_master_online_split_enabled, false, "[split] split tablet on its tabletnode without unloading it through master, children are loaded on the same tabletnode at once");
+DEFINE_int32(tera_master_online_split_retry_period, 1000, "[split] the period (in ms) to ask the tabletnode again when the result of an online split is unknown");
+DEFINE_bool(tera_master_move_prewarm_enabled, false, "[move] read the sst files and cached blocks of a tablet on the dest tabletnode before moving the tablet there");
+DEFINE_int64(tera_master_move_prewarm_max_size, 256, "[move] the max size (in MB) of cached blocks of a tablet read by the dest tabletnode in advance");
 
 
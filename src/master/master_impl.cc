@@ -14,6 +14,7 @@
 #include <gperftools/malloc_extension.h>
 
 #include "db/filename.h"
+#include "db/shared_log.h"
 #include "io/io_utils.h"
 #include "io/utils_leveldb.h"
 #include "leveldb/status.h"
@@ -66,6 +67,7 @@ DECLARE_double(tera_master_workload_split_threshold);
 DECLARE_double(tera_master_workload_merge_threshold);
 DECLARE_int64(tera_master_split_tablet_size);
 DECLARE_int64(tera_master_min_split_size);
+DECLARE_int64(tera_master_load_split_qps_threshold);
 DECLARE_double(tera_master_min_split_ratio);
 DECLARE_int64(tera_master_merge_tablet_size);
 DECLARE_bool(tera_master_kick_tabletnode_enabled);
@@ -92,6 +94,7 @@ DECLARE_bool(tera_master_gc_trash_enabled);
 DECLARE_int64(tera_master_gc_trash_clean_period_s);
 
 DECLARE_string(tera_tabletnode_path_prefix);
+DECLARE_string(tera_tabletnode_shared_log_dir);
 DECLARE_string(tera_leveldb_env_type);
 
 DECLARE_string(tera_zk_root_path);
@@ -1720,9 +1723,18 @@ bool MasterImpl::TabletNodeLoadBalance(TabletNodePtr tabletnode, Scheduler* sche
         if (tablet->GetSchema().has_merge_size() && tablet->GetSchema().merge_size() > 0) {
             merge_size = tablet->GetSchema().merge_size();
         }
+        int64_t qps = tablet->GetQps();
         if (tablet->GetDataSize() < 0) {
             // tablet size is error, skip it
             continue;
+        } else if (FLAGS_tera_master_load_split_qps_threshold > 0 &&
+                   qps > FLAGS_tera_master_load_split_qps_threshold &&
+                   tablet->GetDataSize() > (FLAGS_tera_master_min_split_size << 20) &&
+                   tablet->TestAndSetSplitTimeStamp(get_micros())) {
+            VLOG(6) << tablet->GetPath() << ", trigger load split, qps: " << qps;
+            TrySplitTablet(tablet, "", true);
+            any_tablet_split = true;
+            continue;
         } else if (tablet->GetDataSize() > (split_size << 20) &&
                    tablet->TestAndSetSplitTimeStamp(get_micros())) {
             TrySplitTablet(tablet);
@@ -2680,6 +2692,8 @@ void MasterImpl::DoTabletNodeGcPhase2() {
     int64_t cost = (get_micros() - start) / 1000;
     LOG(INFO) << "[gc] clean trash dir done, cost: " << cost << "ms.";
 
+    CleanDeadSharedLogs();
+
     MutexLock lock(&mutex_);
     if (gc_enabled_) {
         ScheduleTabletNodeGc();
@@ -2688,6 +2702,65 @@ void MasterImpl::DoTabletNodeGcPhase2() {
     }
 }
 
+// The shared log of a dead tabletnode (or of an old process of a live one)
+// is needed until all its tablets are loaded again, which splits the log.
+// It is deleted when it is found dead in two gc rounds with all tablets
+// ready, so tablets of a node dying during the check are not missed.
+void MasterImpl::CleanDeadSharedLogs() {
+    std::vector<TabletNodePtr> nodes;
+    tabletnode_manager_->GetAllTabletNodeInfo(&nodes);
+    std::set<std::string> live_nodes;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        live_nodes.insert(leveldb::SharedLogNodeName(nodes[i]->GetAddr()));
+    }
+
+    std::vector<TablePtr> tables;
+    std::vector<TabletPtr> tablets;
+    tablet_manager_->ShowTable(&tables, &tablets);
+    for (size_t i = 0; i < tablets.size(); ++i) {
+        if (tablets[i]->GetStatus() != TabletMeta::kTabletReady) {
+            VLOG(10) << "[gc] tablet not ready, keep shared logs: " << tablets[i]->GetPath();
+            dead_shared_logs_.clear();
+            return;
+        }
+    }
+
+    std::string root = FLAGS_tera_tabletnode_path_prefix + "/"
+        + FLAGS_tera_tabletnode_shared_log_dir;
+    leveldb::Env* env = io::LeveldbBaseEnv();
+    std::vector<std::string> children;
+    env->GetChildren(root, &children);
+    // the newest process of a live node
+    std::map<std::string, uint64_t> newest;
+    for (size_t i = 0; i < children.size(); ++i) {
+        std::string node;
+        uint64_t start_ts = 0;
+        if (leveldb::ParseSharedLogDirName(children[i], &node, &start_ts)
+            && live_nodes.find(node) != live_nodes.end()) {
+            newest[node] = std::max(newest[node], start_ts);
+        }
+    }
+
+    std::set<std::string> dead;
+    for (size_t i = 0; i < children.size(); ++i) {
+        std::string node;
+        uint64_t start_ts = 0;
+        if (!leveldb::ParseSharedLogDirName(children[i], &node, &start_ts)) {
+            continue;
+        }
+        std::map<std::string, uint64_t>::iterator it = newest.find(node);
+        if (it != newest.end() && it->second == start_ts) {
+            continue;
+        }
+        dead.insert(children[i]);
+        if (dead_shared_logs_.find(children[i]) != dead_shared_logs_.end()) {
+            LOG(INFO) << "[gc] delete dead shared log: " << children[i];
+            io::DeleteEnvDir(root + "/" + children[i]);
+        }
+    }
+    dead_shared_logs_.swap(dead);
+}
+
 void MasterImpl::RefreshTableCounter() {
     int64_t start = get_micros();
     std::vector<TablePtr> table_list;
@@ -2776,12 +2849,13 @@ bool TryMergeTablet(TabletPtr tablet) {
     return true;
 }
 
-bool TrySplitTablet(TabletPtr tablet, std::string split_key) {
+bool TrySplitTablet(TabletPtr tablet, std::string split_key, bool by_load) {
     if (!tablet->LockTransition()) {
         LOG(WARNING) << "tablet: " << tablet->GetPath() << "is in transition, giveup this split try";
         return false;
     }
-    std::shared_ptr<Procedure> split(new SplitTabletProcedure(tablet, split_key, MasterEnv().GetThreadPool().get()));
+    std::shared_ptr<Procedure> split(new SplitTabletProcedure(tablet, split_key,
+                                                              MasterEnv().GetThreadPool().get(), by_load));
     if(MasterEnv().GetExecutor()->AddProcedure(split) == 0) {
         LOG(WARNING) << "add to procedure_executor fail, may duplicated procid: " << split->ProcId();
         tablet->UnlockTransition();
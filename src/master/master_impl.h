@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <semaphore.h>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -302,6 +303,7 @@ private:
     void ScheduleTabletNodeGc();
     void DoTabletNodeGc();
     void DoTabletNodeGcPhase2();
+    void CleanDeadSharedLogs();
 
     bool CheckUserPermissionOnTable(const std::string& token, TablePtr table);
 
@@ -361,6 +363,8 @@ private:
     int64_t gc_timer_id_;
     bool gc_query_enable_;
     std::shared_ptr<GcStrategy> gc_strategy_;
+    // shared log dirs of dead tabletnodes found in last gc round
+    std::set<std::string> dead_shared_logs_;
 
     
     std::shared_ptr<ProcedureExecutor> executor_;
@@ -375,7 +379,7 @@ bool TryMoveTablet(TabletPtr tablet, TabletNodePtr node = TabletNodePtr(nullptr)
 
 bool TryMergeTablet(TabletPtr tablet);
 
-bool TrySplitTablet(TabletPtr tablet, std::string split_key = "");
+bool TrySplitTablet(TabletPtr tablet, std::string split_key = "", bool by_load = false);
 
 } // namespace master
 } // namespace tera
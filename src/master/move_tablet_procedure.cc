@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include "load_tablet_procedure.h"
 #include "move_tablet_procedure.h"
@@ -10,10 +11,15 @@
 #include "master/procedure_executor.h"
 #include "unload_tablet_procedure.h"
 
+DECLARE_bool(tera_master_move_prewarm_enabled);
+DECLARE_int64(tera_master_move_prewarm_max_size);
+DECLARE_int32(tera_master_prewarm_rpc_timeout);
+
 namespace tera {
 namespace master {
 
 std::map<MoveTabletPhase, MoveTabletProcedure::MoveTabletPhaseHandler> MoveTabletProcedure::phase_handlers_ {
+    {MoveTabletPhase::kPrewarmTablet, std::bind(&MoveTabletProcedure::PrewarmTabletPhaseHandler, _1, _2)},
     {MoveTabletPhase::kUnLoadTablet, std::bind(&MoveTabletProcedure::UnloadTabletPhaseHandler, _1, _2)},
     {MoveTabletPhase::kLoadTablet,   std::bind(&MoveTabletProcedure::LoadTabletPhaseHandler, _1, _2)},
     {MoveTabletPhase::kEofPhase,     std::bind(&MoveTabletProcedure::EOFPhaseHandler, _1, _2)}
@@ -24,6 +30,8 @@ MoveTabletProcedure::MoveTabletProcedure(TabletPtr tablet, TabletNodePtr node, T
     tablet_(tablet), 
     dest_node_(node), 
     done_(false),
+    prewarm_dispatched_(false),
+    prewarm_start_micros_(0),
     thread_pool_(thread_pool) {
     PROC_LOG(INFO) << "move tablet begin, tablet: " << tablet_->GetPath();
     if (dest_node_) {
@@ -32,7 +40,8 @@ MoveTabletProcedure::MoveTabletProcedure(TabletPtr tablet, TabletNodePtr node, T
         dest_node_->PlanToMoveIn();
     }
     if (tablet_->GetStatus() == TabletMeta::kTabletReady) {
-        SetNextPhase(MoveTabletPhase::kUnLoadTablet);
+        SetNextPhase(FLAGS_tera_master_move_prewarm_enabled && dest_node_ ?
+                MoveTabletPhase::kPrewarmTablet : MoveTabletPhase::kUnLoadTablet);
     }
     else if (tablet_->GetStatus() == TabletMeta::kTabletOffline || 
             tablet_->GetStatus() == TabletMeta::kTabletLoadFail) {
@@ -55,6 +64,22 @@ void MoveTabletProcedure::RunNextStage() {
     handler(this, phase);
 }
 
+void MoveTabletProcedure::PrewarmTabletPhaseHandler(const MoveTabletPhase&) {
+    if (prewarm_dispatched_) {
+        // waiting RPC response
+        return;
+    }
+    TabletNodePtr src_node = tablet_->GetTabletNode();
+    if (tablet_->GetStatus() != TabletMeta::kTabletReady || !src_node || src_node->NodeDown() ||
+            src_node->GetAddr() == dest_node_->GetAddr()) {
+        SetNextPhase(MoveTabletPhase::kUnLoadTablet);
+        return;
+    }
+    prewarm_dispatched_ = true;
+    prewarm_start_micros_ = get_micros();
+    GetHotBlocksAsync();
+}
+
 void MoveTabletProcedure::UnloadTabletPhaseHandler(const MoveTabletPhase&) {
     if (!unload_proc_) {
         PROC_LOG(INFO) << "MoveTablet: Unload: " << tablet_; 
@@ -98,14 +123,90 @@ void MoveTabletProcedure::EOFPhaseHandler(const MoveTabletPhase&) {
     done_ = true;
 }
 
+void MoveTabletProcedure::GetHotBlocksAsync() {
+    GetHotBlocksRequest* request = new GetHotBlocksRequest;
+    GetHotBlocksResponse* response = new GetHotBlocksResponse;
+    request->set_sequence_id(MasterEnv().SequenceId().Inc());
+    request->set_tablet_name(tablet_->GetTableName());
+    request->mutable_key_range()->set_key_start(tablet_->GetKeyStart());
+    request->mutable_key_range()->set_key_end(tablet_->GetKeyEnd());
+    request->set_max_bytes(FLAGS_tera_master_move_prewarm_max_size << 20);
+    tabletnode::TabletNodeClient node_client(thread_pool_, tablet_->GetServerAddr(),
+            FLAGS_tera_master_prewarm_rpc_timeout);
+    PROC_LOG(INFO) << "GetHotBlocksAsync id: " << request->sequence_id() << ", " << tablet_;
+    GetHotBlocksClosure done =
+        std::bind(&MoveTabletProcedure::GetHotBlocksCallback, this, _1, _2, _3, _4);
+    node_client.GetHotBlocks(request, response, done);
+}
+
+void MoveTabletProcedure::GetHotBlocksCallback(GetHotBlocksRequest* request,
+        GetHotBlocksResponse* response,
+        bool failed,
+        int error_code) {
+    std::unique_ptr<GetHotBlocksRequest> request_deleter(request);
+    std::unique_ptr<GetHotBlocksResponse> response_deleter(response);
+    StatusCode status = response->status();
+    if (failed || status != kTabletNodeOk) {
+        std::string errmsg = (failed ?
+                sofa::pbrpc::RpcErrorCodeToString(error_code) : StatusCodeToString(status));
+        // prewarm is best effort, move the tablet anyway
+        PROC_LOG(WARNING) << "[move] fail to get hot blocks, skip prewarm, "
+            << tablet_ << ", error: " << errmsg;
+        SetNextPhase(MoveTabletPhase::kUnLoadTablet);
+        return;
+    }
+    PrewarmTabletAsync(*response);
+}
+
+void MoveTabletProcedure::PrewarmTabletAsync(const GetHotBlocksResponse& hot_blocks) {
+    PrewarmTabletRequest* request = new PrewarmTabletRequest;
+    PrewarmTabletResponse* response = new PrewarmTabletResponse;
+    request->set_sequence_id(MasterEnv().SequenceId().Inc());
+    request->set_tablet_name(tablet_->GetTableName());
+    request->mutable_key_range()->set_key_start(tablet_->GetKeyStart());
+    request->mutable_key_range()->set_key_end(tablet_->GetKeyEnd());
+    request->set_path(tablet_->GetPath());
+    request->mutable_schema()->CopyFrom(tablet_->GetSchema());
+    request->mutable_files()->CopyFrom(hot_blocks.files());
+    tabletnode::TabletNodeClient node_client(thread_pool_, dest_node_->GetAddr(),
+            FLAGS_tera_master_prewarm_rpc_timeout);
+    PROC_LOG(INFO) << "PrewarmTabletAsync id: " << request->sequence_id() << ", " << tablet_
+        << ", dest: " << dest_node_->GetAddr() << ", files: " << request->files_size();
+    PrewarmTabletClosure done =
+        std::bind(&MoveTabletProcedure::PrewarmTabletCallback, this, _1, _2, _3, _4);
+    node_client.PrewarmTablet(request, response, done);
+}
+
+void MoveTabletProcedure::PrewarmTabletCallback(PrewarmTabletRequest* request,
+        PrewarmTabletResponse* response,
+        bool failed,
+        int error_code) {
+    std::unique_ptr<PrewarmTabletRequest> request_deleter(request);
+    std::unique_ptr<PrewarmTabletResponse> response_deleter(response);
+    StatusCode status = response->status();
+    int64_t cost_ms = (get_micros() - prewarm_start_micros_) / 1000;
+    if (failed || status != kTabletNodeOk) {
+        std::string errmsg = (failed ?
+                sofa::pbrpc::RpcErrorCodeToString(error_code) : StatusCodeToString(status));
+        PROC_LOG(WARNING) << "[move] fail to prewarm, " << tablet_ << ", dest: "
+            << dest_node_->GetAddr() << ", error: " << errmsg << ", cost: " << cost_ms << "ms";
+    } else {
+        PROC_LOG(INFO) << "[move] prewarm done, " << tablet_ << ", dest: " << dest_node_->GetAddr()
+            << ", files: " << request->files_size() << ", bytes: " << response->warm_bytes()
+            << ", cost: " << cost_ms << "ms";
+    }
+    SetNextPhase(MoveTabletPhase::kUnLoadTablet);
+}
+
 std::ostream& operator<< (std::ostream& o, const MoveTabletPhase& phase) {
-    static const char* msg[] = {"MoveTabletPhase::kUnLoadTablet", 
+    static const char* msg[] = {"MoveTabletPhase::kPrewarmTablet",
+                                "MoveTabletPhase::kUnLoadTablet", 
                                 "MoveTabletPhase::kLoadTablet", 
                                 "MoveTabletPhase::kEofPhase", 
                                 "MoveTabletPhase::Unknown"};
     static uint32_t msg_size = sizeof(msg) / sizeof(const char*);
     typedef std::underlying_type<MoveTabletPhase>::type UnderType;
-    uint32_t index = static_cast<UnderType>(phase) - static_cast<UnderType>(MoveTabletPhase::kUnLoadTablet);
+    uint32_t index = static_cast<UnderType>(phase) - static_cast<UnderType>(MoveTabletPhase::kPrewarmTablet);
     index = index < msg_size ? index : msg_size - 1;
     o << msg[index];
     return o;
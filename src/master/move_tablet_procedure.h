@@ -16,6 +16,7 @@ namespace tera {
 namespace master {
 
 enum class MoveTabletPhase {
+    kPrewarmTablet,
     kUnLoadTablet,
     kLoadTablet,
     kEofPhase,
@@ -24,6 +25,9 @@ enum class MoveTabletPhase {
 
 std::ostream& operator<< (std::ostream& o, const MoveTabletPhase& phase);
 
+typedef std::function<void (GetHotBlocksRequest*, GetHotBlocksResponse*, bool, int)> GetHotBlocksClosure;
+typedef std::function<void (PrewarmTabletRequest*, PrewarmTabletResponse*, bool, int)> PrewarmTabletClosure;
+
 // Notice that MoveTabletProcedure is splitted into a UnloadTabletProcedure and a LoadTabletProcedure, 
 // so MoveTabletProcedure do not deal with tablet state transition directly
 class MoveTabletProcedure : public Procedure {
@@ -49,16 +53,30 @@ private:
         phases_.emplace_back(phase);
     }
 
+    void PrewarmTabletPhaseHandler(const MoveTabletPhase& phase);
     void UnloadTabletPhaseHandler(const MoveTabletPhase& phase);
     void LoadTabletPhaseHandler(const MoveTabletPhase& phase);
     void EOFPhaseHandler(const MoveTabletPhase& phase);
 
+    // the dest tabletnode reads the sst files of the tablet and the blocks
+    // cached by the src tabletnode before the tablet is unloaded
+    void GetHotBlocksAsync();
+    void GetHotBlocksCallback(GetHotBlocksRequest* request,
+                              GetHotBlocksResponse* response,
+                              bool failed, int error_code);
+    void PrewarmTabletAsync(const GetHotBlocksResponse& hot_blocks);
+    void PrewarmTabletCallback(PrewarmTabletRequest* request,
+                               PrewarmTabletResponse* response,
+                               bool failed, int error_code);
+
 private:
     const std::string id_;
     std::mutex mutex_;
     TabletPtr tablet_;
     TabletNodePtr dest_node_;
     bool done_;
+    bool prewarm_dispatched_;
+    int64_t prewarm_start_micros_;
     std::shared_ptr<Procedure> unload_proc_;
     std::shared_ptr<Procedure> load_proc_;
     std::vector<MoveTabletPhase> phases_;
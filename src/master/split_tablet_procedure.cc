@@ -4,6 +4,7 @@
 
 #include <memory>
 #include <glog/logging.h>
+#include "common/timer.h"
 #include "db/filename.h"
 #include "io/utils_leveldb.h"
 #include "load_tablet_procedure.h"
@@ -15,6 +16,8 @@
 #include "unload_tablet_procedure.h"
 
 DECLARE_int32(tera_master_split_rpc_timeout);
+DECLARE_bool(tera_master_online_split_enabled);
+DECLARE_int32(tera_master_online_split_retry_period);
 DECLARE_string(tera_tabletnode_path_prefix);
 namespace tera {
 namespace master {
@@ -22,6 +25,7 @@ namespace master {
 std::map<SplitTabletPhase, SplitTabletProcedure::SplitTabletPhaseHandler> 
     SplitTabletProcedure::phase_handlers_ {
         {SplitTabletPhase::kPreSplitTablet,   std::bind(&SplitTabletProcedure::PreSplitTabletPhaseHandler, _1, _2)},
+        {SplitTabletPhase::kOnlineSplitTablet, std::bind(&SplitTabletProcedure::OnlineSplitTabletPhaseHandler, _1, _2)},
         {SplitTabletPhase::kUnLoadTablet,     std::bind(&SplitTabletProcedure::UnloadTabletPhaseHandler, _1, _2)},
         {SplitTabletPhase::kPostUnLoadTablet, std::bind(&SplitTabletProcedure::PostUnloadTabletPhaseHandler, _1, _2)},
         {SplitTabletPhase::kUpdateMeta,       std::bind(&SplitTabletProcedure::UpdateMetaPhaseHandler, _1, _2)},
@@ -30,9 +34,11 @@ std::map<SplitTabletPhase, SplitTabletProcedure::SplitTabletPhaseHandler>
         {SplitTabletPhase::kEofPhase,         std::bind(&SplitTabletProcedure::EOFPhaseHandler, _1, _2)}
 };
 
-SplitTabletProcedure::SplitTabletProcedure(TabletPtr tablet, std::string split_key, ThreadPool* thread_pool) : 
+SplitTabletProcedure::SplitTabletProcedure(TabletPtr tablet, std::string split_key, ThreadPool* thread_pool,
+                                           bool by_load) : 
     id_(std::string("SplitTablet:") + tablet->GetPath() + ":" + TimeStamp()),
-    tablet_(tablet), split_key_(split_key), thread_pool_(thread_pool) {
+    tablet_(tablet), split_key_(split_key), by_load_(by_load),
+    online_split_(FLAGS_tera_master_online_split_enabled), thread_pool_(thread_pool) {
     PROC_LOG(INFO) << "split tablet begin, tablet: " << tablet_->GetPath();
     if (tablet_->GetStatus() != TabletMeta::kTabletReady) {
         SetNextPhase(SplitTabletPhase::kEofPhase);
@@ -62,7 +68,7 @@ void SplitTabletProcedure::PreSplitTabletPhaseHandler(const SplitTabletPhase&) {
             SetNextPhase(SplitTabletPhase::kEofPhase);
             return;
         }
-        SetNextPhase(SplitTabletPhase::kUnLoadTablet);
+        SetNextPhase(SplitPhase());
     }
     else if (dispatch_split_key_request_) {
         // waiting RPC response
@@ -74,6 +80,41 @@ void SplitTabletProcedure::PreSplitTabletPhaseHandler(const SplitTabletPhase&) {
     }    
 }
 
+SplitTabletPhase SplitTabletProcedure::SplitPhase() {
+    return online_split_ ? SplitTabletPhase::kOnlineSplitTablet : SplitTabletPhase::kUnLoadTablet;
+}
+
+void SplitTabletProcedure::OnlineSplitTabletPhaseHandler(const SplitTabletPhase&) {
+    if (dispatch_online_split_request_) {
+        // waiting meta write or RPC response
+        return;
+    }
+    if (!split_intent_persisted_) {
+        if (tablet_->GetTabletNode()->NodeDown()) {
+            PROC_LOG(WARNING) << "[split] tabletnode down, give up online split, " << tablet_;
+            SetNextPhase(SplitTabletPhase::kUnLoadTablet);
+            return;
+        }
+        PrepareChildTablets();
+        tablet_->DoStateTransition(TabletEvent::kUnLoadTablet);
+        dispatch_online_split_request_ = true;
+        PersistSplitIntent();
+        return;
+    }
+    if (tablet_->GetTabletNode()->NodeDown()) {
+        // the children are in meta already, load them on other nodes
+        PROC_LOG(WARNING) << "[split] tabletnode down during online split, load children, "
+            << tablet_;
+        SplitTabletInMemory(false);
+        return;
+    }
+    if (get_micros() < online_split_retry_us_) {
+        return;
+    }
+    dispatch_online_split_request_ = true;
+    OnlineSplitAsync();
+}
+
 void SplitTabletProcedure::UnloadTabletPhaseHandler(const SplitTabletPhase&) {
     if (!unload_proc_) {
         unload_proc_.reset(new UnloadTabletProcedure(tablet_, thread_pool_, true));
@@ -102,9 +143,10 @@ void SplitTabletProcedure::PostUnloadTabletPhaseHandler(const SplitTabletPhase&)
 }
 
 void SplitTabletProcedure::UpdateMetaPhaseHandler(const SplitTabletPhase&) {
-    if (!child_tablets_[0]) {
+    if (!update_meta_dispatched_) {
+        update_meta_dispatched_ = true;
         UpdateMeta();
-    }   
+    }
 }
 
 void SplitTabletProcedure::LoadTabletsPhaseHandler(const SplitTabletPhase&) {
@@ -151,6 +193,7 @@ void SplitTabletProcedure::ComputeSplitKeyAsync() {
     request->set_tablet_name(tablet_->GetTableName());
     request->mutable_key_range()->set_key_start(tablet_->GetKeyStart());
     request->mutable_key_range()->set_key_end(tablet_->GetKeyEnd());
+    request->set_by_load(by_load_);
     tabletnode::TabletNodeClient node_client(thread_pool_, tablet_->GetServerAddr(),
             FLAGS_tera_master_split_rpc_timeout);
     PROC_LOG(INFO) << "ComputeSplitKeyAsync id: " << request->sequence_id() << ", " << tablet_;
@@ -175,12 +218,75 @@ void SplitTabletProcedure::ComputeSplitKeyCallback(SplitTabletRequest* request,
         return;
     }
     split_key_ = response->split_keys(0);
-    SetNextPhase(SplitTabletPhase::kUnLoadTablet);
+    SetNextPhase(SplitPhase());
 }
 
-void SplitTabletProcedure::UpdateMeta() {
-    std::vector<MetaWriteRecord> records;
-    
+void SplitTabletProcedure::OnlineSplitAsync() {
+    SplitTabletRequest* request = new SplitTabletRequest;
+    SplitTabletResponse* response = new SplitTabletResponse;
+
+    request->set_sequence_id(MasterEnv().SequenceId().Inc());
+    request->set_tablet_name(tablet_->GetTableName());
+    request->mutable_key_range()->set_key_start(tablet_->GetKeyStart());
+    request->mutable_key_range()->set_key_end(tablet_->GetKeyEnd());
+    request->set_split_key(split_key_);
+    request->set_master_update_meta(true);
+    for (int i = 0; i < 2; ++i) {
+        request->add_child_tablets(leveldb::GetTabletNumFromPath(child_tablets_[i]->GetPath()));
+    }
+    tabletnode::TabletNodeClient node_client(thread_pool_, tablet_->GetServerAddr(),
+            FLAGS_tera_master_split_rpc_timeout);
+    PROC_LOG(INFO) << "OnlineSplitAsync id: " << request->sequence_id() << ", " << tablet_;
+    ComputeSplitKeyClosure done =
+        std::bind(&SplitTabletProcedure::OnlineSplitCallback, this, _1, _2, _3, _4);
+    node_client.SplitTablet(request, response, done);
+}
+
+void SplitTabletProcedure::OnlineSplitCallback(SplitTabletRequest* request,
+        SplitTabletResponse* response,
+        bool failed,
+        int error_code) {
+    std::unique_ptr<SplitTabletRequest> request_deleter(request);
+    std::unique_ptr<SplitTabletResponse> response_deleter(response);
+    StatusCode status = response->status();
+    if (!failed && status == kTabletNodeOk) {
+        PROC_LOG(INFO) << "[split] children loaded by ts, " << tablet_;
+        tablet_->DoStateTransition(TabletEvent::kTsUnLoadSucc);
+        SplitTabletInMemory(true);
+        return;
+    }
+    std::string errmsg = (failed ?
+            sofa::pbrpc::RpcErrorCodeToString(error_code) : StatusCodeToString(status));
+    if (!failed && status == kTableNotSupport) {
+        // refused before the tablet is touched, take the children out of meta
+        PROC_LOG(WARNING) << "[split] online split refused, abort tablet split, "
+            << tablet_ << ", error: " << errmsg;
+        RevertSplitIntent();
+        return;
+    }
+    if (!failed && status == kKeyNotInRange) {
+        // the parent is unloaded but the children are not all served, as a
+        // child failed to load, or the parent was gone before
+        PROC_LOG(WARNING) << "[split] parent not found on ts, load children, "
+            << tablet_ << ", error: " << errmsg;
+        tablet_->DoStateTransition(TabletEvent::kTsUnLoadSucc);
+        SplitTabletInMemory(false);
+        return;
+    }
+    // the split may be in progress, done, or not started on ts, and loading
+    // the children now may serve the range twice: send the same request
+    // again later, ts answers it from the current state of the tablets
+    PROC_LOG(WARNING) << "[split] online split result unknown, " << tablet_
+        << ", error: " << errmsg << ", ask ts again";
+    online_split_retry_us_ = get_micros()
+        + static_cast<int64_t>(FLAGS_tera_master_online_split_retry_period) * 1000;
+    dispatch_online_split_request_ = false;
+}
+
+void SplitTabletProcedure::PrepareChildTablets() {
+    if (child_tablets_[0]) {
+        return;
+    }
     std::string parent_path = tablet_->GetPath();
     TablePtr table = tablet_->GetTable();
     std::string child_key_start = tablet_->GetKeyStart();
@@ -198,9 +304,16 @@ void SplitTabletProcedure::UpdateMeta() {
         child_tablets_[i].reset(new Tablet(child_meta, table));
         child_key_start = child_key_end;
         child_key_end = tablet_->GetKeyEnd();
+    }
+}
+
+void SplitTabletProcedure::UpdateMeta() {
+    PrepareChildTablets();
+    std::vector<MetaWriteRecord> records;
+    for (int i = 0; i < 2; ++i) {
         PackMetaWriteRecords(child_tablets_[i], false, records);
     }
-    
+
     UpdateMetaClosure done = std::bind(&SplitTabletProcedure::UpdateMetaDone, this, _1);
     PROC_LOG(INFO) << "[split] update meta async: " << tablet_ ;
     MasterEnv().BatchWriteMetaTableAsync(records, done, -1);
@@ -208,12 +321,60 @@ void SplitTabletProcedure::UpdateMeta() {
 }
 
 void SplitTabletProcedure::UpdateMetaDone(bool) {
+    SplitTabletInMemory(false);
+}
+
+void SplitTabletProcedure::PersistSplitIntent() {
+    std::vector<MetaWriteRecord> records;
+    for (int i = 0; i < 2; ++i) {
+        PackMetaWriteRecords(child_tablets_[i], false, records);
+    }
+    UpdateMetaClosure done = std::bind(&SplitTabletProcedure::PersistSplitIntentDone, this, _1);
+    PROC_LOG(INFO) << "[split] persist split intent: " << tablet_;
+    MasterEnv().BatchWriteMetaTableAsync(records, done, -1);
+}
+
+void SplitTabletProcedure::PersistSplitIntentDone(bool) {
+    PROC_LOG(INFO) << "[split] split intent persisted, ask ts to split, " << tablet_;
+    split_intent_persisted_ = true;
+    dispatch_online_split_request_ = false;
+}
+
+void SplitTabletProcedure::RevertSplitIntent() {
+    // the first child shares the meta row of the parent
+    std::vector<MetaWriteRecord> records;
+    PackMetaWriteRecords(child_tablets_[1], true, records);
+    PackMetaWriteRecords(tablet_, false, records);
+    UpdateMetaClosure done = std::bind(&SplitTabletProcedure::RevertSplitIntentDone, this, _1);
+    PROC_LOG(INFO) << "[split] revert split intent: " << tablet_;
+    MasterEnv().BatchWriteMetaTableAsync(records, done, -1);
+}
+
+void SplitTabletProcedure::RevertSplitIntentDone(bool) {
+    tablet_->SetStatus(TabletMeta::kTabletReady);
+    SetNextPhase(SplitTabletPhase::kEofPhase);
+}
+
+void SplitTabletProcedure::SplitTabletInMemory(bool served) {
     TabletMeta first_meta, second_meta;
     child_tablets_[0]->ToMeta(&first_meta);
     first_meta.set_status(TabletMeta::kTabletOffline);
     child_tablets_[1]->ToMeta(&second_meta);
     second_meta.set_status(TabletMeta::kTabletOffline);
     TablePtr table = tablet_->GetTable();
+    if (served) {
+        table->SplitTablet(tablet_, first_meta, second_meta, &child_tablets_[0], &child_tablets_[1]);
+        TabletNodePtr node = tablet_->GetTabletNode();
+        for (int i = 0; i < 2; ++i) {
+            BindTabletToTabletNode(child_tablets_[i], node);
+            child_tablets_[i]->SetStatus(TabletMeta::kTabletReady);
+        }
+        PROC_LOG(INFO) << "online split finish, " << tablet_
+                << "\nfirst: " << child_tablets_[0]
+                << "\nsecond: " << child_tablets_[1];
+        SetNextPhase(SplitTabletPhase::kEofPhase);
+        return;
+    }
     child_tablets_[0]->LockTransition();
     child_tablets_[1]->LockTransition();
     
@@ -248,6 +409,7 @@ bool SplitTabletProcedure::TabletStatusCheck() {
 
 std::ostream& operator<< (std::ostream& o, const SplitTabletPhase& phase) {
     static const char* msg[] = {"SplitTabletPhase::kPreSplitTablet", 
+                                "SplitTabletPhase::kOnlineSplitTablet", 
                                 "SplitTabletPhase::kUnLoadTablet", 
                                 "SplitTabletPhase::kPostUnLoadTablet", 
                                 "SplitTabletPhase::kUpdateMeta", 
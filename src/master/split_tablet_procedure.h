@@ -16,6 +16,7 @@ namespace master {
 
 enum class SplitTabletPhase {
     kPreSplitTablet,
+    kOnlineSplitTablet,
     kUnLoadTablet,
     kPostUnLoadTablet,
     kUpdateMeta,
@@ -34,7 +35,10 @@ public:
     explicit SplitTabletProcedure(TabletPtr tablet, ThreadPool* thread_pool)
              : SplitTabletProcedure(tablet, std::string(""), thread_pool) {}
 
-    explicit SplitTabletProcedure(TabletPtr tablet, std::string, ThreadPool* thread_pool);
+    // "by_load" asks the tabletnode to split at the median key of the
+    // sampled load instead of the data size, if no split key is given
+    explicit SplitTabletProcedure(TabletPtr tablet, std::string, ThreadPool* thread_pool,
+                                  bool by_load = false);
 
     virtual ~SplitTabletProcedure() {}
 
@@ -58,6 +62,7 @@ private:
     }
     
     void PreSplitTabletPhaseHandler(const SplitTabletPhase&);
+    void OnlineSplitTabletPhaseHandler(const SplitTabletPhase&);
     void UnloadTabletPhaseHandler(const SplitTabletPhase&);
     void PostUnloadTabletPhaseHandler(const SplitTabletPhase&);
     void UpdateMetaPhaseHandler(const SplitTabletPhase&);
@@ -68,6 +73,26 @@ private:
     void ComputeSplitKeyAsync();
 
     void ComputeSplitKeyCallback(SplitTabletRequest* request, SplitTabletResponse* response, bool failed, int error_code);
+
+    void OnlineSplitAsync();
+
+    void OnlineSplitCallback(SplitTabletRequest* request, SplitTabletResponse* response, bool failed, int error_code);
+
+    // split key is known, go on with online split or unloading the tablet
+    SplitTabletPhase SplitPhase();
+
+    void PrepareChildTablets();
+
+    // children are written to meta before the tabletnode splits, and the
+    // parent is written back if the tabletnode refuses to split
+    void PersistSplitIntent();
+    void PersistSplitIntentDone(bool);
+    void RevertSplitIntent();
+    void RevertSplitIntentDone(bool);
+
+    // replace the parent by the children in memory, "served" if the
+    // tabletnode serves the children already, otherwise they are loaded
+    void SplitTabletInMemory(bool served);
     
     bool TabletStatusCheck();
 
@@ -80,7 +105,15 @@ private:
     TabletPtr tablet_;
     bool done_ = false;
     std::string split_key_;
+    bool by_load_;
     bool dispatch_split_key_request_ = false;   
+    // children are loaded by tabletnode during split, master only updates meta
+    bool online_split_;
+    bool dispatch_online_split_request_ = false;
+    bool split_intent_persisted_ = false;
+    // time to ask the tabletnode again after an unknown split result
+    int64_t online_split_retry_us_ = 0;
+    bool update_meta_dispatched_ = false;
     std::shared_ptr<Procedure> unload_proc_;
     
     TabletPtr child_tablets_[2];
@@ -10,6 +10,8 @@
 #include "master/master_env.h"
 #include "master/master_zk_adapter.h"
 
+DECLARE_bool(tera_master_move_prewarm_enabled);
+
 namespace tera {
 namespace master {
 namespace test {
@@ -140,6 +142,37 @@ TEST_F(MoveTabletProcedureTest, LoadTabletPhaseHandler) {
     EXPECT_EQ(move_proc_->phases_.back(), MoveTabletPhase::kEofPhase);
 }
 
+TEST_F(MoveTabletProcedureTest, PrewarmTabletPhaseHandler) {
+    tablet_->SetStatus(TabletMeta::kTabletReady);
+    tablet_->AssignTabletNode(src_node_);
+    FLAGS_tera_master_move_prewarm_enabled = true;
+    move_proc_ = std::shared_ptr<MoveTabletProcedure>(new MoveTabletProcedure(tablet_, dest_node_, MasterEnv().GetThreadPool().get()));
+    FLAGS_tera_master_move_prewarm_enabled = false;
+    EXPECT_EQ(move_proc_->phases_.back(), MoveTabletPhase::kPrewarmTablet);
+
+    // prewarm is skipped once the src tabletnode is gone
+    src_node_->SetState(kOffLine, NULL);
+    move_proc_->PrewarmTabletPhaseHandler(MoveTabletPhase::kPrewarmTablet);
+    EXPECT_FALSE(move_proc_->prewarm_dispatched_);
+    EXPECT_EQ(move_proc_->phases_.back(), MoveTabletPhase::kUnLoadTablet);
+
+    // a failed prewarm does not stop the move
+    move_proc_->phases_.push_back(MoveTabletPhase::kPrewarmTablet);
+    GetHotBlocksRequest* get_request = new GetHotBlocksRequest;
+    GetHotBlocksResponse* get_response = new GetHotBlocksResponse;
+    get_response->set_status(kKeyNotInRange);
+    move_proc_->GetHotBlocksCallback(get_request, get_response, false, 0);
+    EXPECT_EQ(move_proc_->phases_.back(), MoveTabletPhase::kUnLoadTablet);
+
+    move_proc_->phases_.push_back(MoveTabletPhase::kPrewarmTablet);
+    PrewarmTabletRequest* request = new PrewarmTabletRequest;
+    PrewarmTabletResponse* response = new PrewarmTabletResponse;
+    response->set_status(kTabletNodeOk);
+    response->set_warm_bytes(4096);
+    move_proc_->PrewarmTabletCallback(request, response, false, 0);
+    EXPECT_EQ(move_proc_->phases_.back(), MoveTabletPhase::kUnLoadTablet);
+}
+
 TEST_F(MoveTabletProcedureTest, EofPhaseHandler) {
     EXPECT_EQ(dest_node_->plan_move_in_count_, 0);
     move_proc_ = std::shared_ptr<MoveTabletProcedure>(new MoveTabletProcedure(tablet_, dest_node_, MasterEnv().GetThreadPool().get()));
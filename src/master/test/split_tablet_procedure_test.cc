@@ -4,6 +4,7 @@
 
 #include "gflags/gflags.h"
 #include "gtest/gtest.h"
+#include "common/timer.h"
 #include "db/filename.h"
 #include "io/utils_leveldb.h"
 #include "master/load_tablet_procedure.h"
@@ -218,6 +219,91 @@ TEST_F(SplitTabletProcedureTest, PreSplitTabletPhaseHandler) {
 
 }
 
+TEST_F(SplitTabletProcedureTest, OnlineSplitTabletPhaseHandler) {
+    tablet_->AssignTabletNode(node_);
+    split_proc_->split_key_ = "c";
+    split_proc_->SetNextPhase(SplitTabletPhase::kOnlineSplitTablet);
+
+    // the children are written to meta before ts is asked to split
+    split_proc_->OnlineSplitTabletPhaseHandler(SplitTabletPhase::kOnlineSplitTablet);
+    EXPECT_TRUE(split_proc_->child_tablets_[0]);
+    EXPECT_TRUE(split_proc_->child_tablets_[1]);
+    EXPECT_TRUE(split_proc_->dispatch_online_split_request_);
+    EXPECT_FALSE(split_proc_->split_intent_persisted_);
+    split_proc_->OnlineSplitTabletPhaseHandler(SplitTabletPhase::kOnlineSplitTablet);
+    EXPECT_EQ(split_proc_->phases_.back(), SplitTabletPhase::kOnlineSplitTablet);
+
+    split_proc_->PersistSplitIntentDone(true);
+    EXPECT_TRUE(split_proc_->split_intent_persisted_);
+    EXPECT_FALSE(split_proc_->dispatch_online_split_request_);
+}
+
+TEST_F(SplitTabletProcedureTest, OnlineSplitCallback) {
+    tablet_->AssignTabletNode(node_);
+    split_proc_->split_key_ = "c";
+    split_proc_->SetNextPhase(SplitTabletPhase::kOnlineSplitTablet);
+    split_proc_->PrepareChildTablets();
+    split_proc_->split_intent_persisted_ = true;
+    tablet_->DoStateTransition(TabletEvent::kUnLoadTablet);
+
+    // rpc failed, the split result is unknown, ask ts again later
+    split_proc_->dispatch_online_split_request_ = true;
+    split_proc_->OnlineSplitCallback(new SplitTabletRequest, new SplitTabletResponse, true, 0);
+    EXPECT_EQ(split_proc_->phases_.back(), SplitTabletPhase::kOnlineSplitTablet);
+    EXPECT_FALSE(split_proc_->dispatch_online_split_request_);
+    EXPECT_GT(split_proc_->online_split_retry_us_, get_micros());
+    EXPECT_EQ(table_->GetTabletsCount(), 1);
+    split_proc_->OnlineSplitTabletPhaseHandler(SplitTabletPhase::kOnlineSplitTablet);
+    EXPECT_FALSE(split_proc_->dispatch_online_split_request_);
+
+    // refused by ts, the tablet is still served, take the children out of meta
+    SplitTabletResponse* response = new SplitTabletResponse;
+    response->set_status(kTableNotSupport);
+    split_proc_->OnlineSplitCallback(new SplitTabletRequest, response, false, 0);
+    EXPECT_EQ(split_proc_->phases_.back(), SplitTabletPhase::kOnlineSplitTablet);
+    split_proc_->RevertSplitIntentDone(true);
+    EXPECT_EQ(split_proc_->phases_.back(), SplitTabletPhase::kEofPhase);
+    EXPECT_EQ(tablet_->GetStatus(), TabletMeta::kTabletReady);
+    EXPECT_EQ(table_->GetTabletsCount(), 1);
+}
+
+TEST_F(SplitTabletProcedureTest, OnlineSplitCallbackServed) {
+    tablet_->AssignTabletNode(node_);
+    split_proc_->split_key_ = "c";
+    split_proc_->PrepareChildTablets();
+    split_proc_->split_intent_persisted_ = true;
+    tablet_->DoStateTransition(TabletEvent::kUnLoadTablet);
+
+    // children are loaded by ts, meta is written already
+    SplitTabletResponse* response = new SplitTabletResponse;
+    response->set_status(kTabletNodeOk);
+    split_proc_->OnlineSplitCallback(new SplitTabletRequest, response, false, 0);
+    EXPECT_EQ(split_proc_->phases_.back(), SplitTabletPhase::kEofPhase);
+    EXPECT_EQ(tablet_->GetStatus(), TabletMeta::kTabletOffline);
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_EQ(split_proc_->child_tablets_[i]->GetStatus(), TabletMeta::kTabletReady);
+        EXPECT_EQ(split_proc_->child_tablets_[i]->GetTabletNode(), node_);
+    }
+}
+
+TEST_F(SplitTabletProcedureTest, OnlineSplitCallbackLoadChildren) {
+    tablet_->AssignTabletNode(node_);
+    split_proc_->split_key_ = "c";
+    split_proc_->PrepareChildTablets();
+    split_proc_->split_intent_persisted_ = true;
+    tablet_->DoStateTransition(TabletEvent::kUnLoadTablet);
+
+    // the parent is gone on ts but a child is not served, load the children
+    SplitTabletResponse* response = new SplitTabletResponse;
+    response->set_status(kKeyNotInRange);
+    split_proc_->OnlineSplitCallback(new SplitTabletRequest, response, false, 0);
+    EXPECT_EQ(split_proc_->phases_.back(), SplitTabletPhase::kLoadTablets);
+    EXPECT_EQ(table_->GetTabletsCount(), 2);
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_EQ(split_proc_->child_tablets_[i]->GetStatus(), TabletMeta::kTabletOffline);
+    }
+}
+
 }
 }
 }
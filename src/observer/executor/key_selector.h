@@ -21,6 +21,27 @@ public:
 	virtual bool SelectStart(std::string* table_name,
 							 std::string* start_key) = 0;
 	virtual ErrorCode Observe(const std::string& table_name) = 0;
+
+	// For selectors partitioning the work among observer workers.
+	// output: selected table name, and the range [start_key, end_key) to
+	// scan, which is taken by the caller only until FinishRange().  The keys
+	// are of the table scanned, the notification index if it is enabled.
+	// An empty end_key means the end of the table.
+	// Return false if the selector does not partition, use SelectStart.
+	virtual bool SelectRange(std::string* table_name,
+							 std::string* start_key,
+							 std::string* end_key) {
+		return false;
+	}
+	virtual void FinishRange(const std::string& table_name,
+							 const std::string& start_key) {}
+	// Called by the caller of SelectRange before each batch of work in the
+	// range is dispatched.  Return false if the range is no longer taken by
+	// the caller, who should stop and call FinishRange().
+	virtual bool HoldRange(const std::string& table_name,
+						   const std::string& start_key) {
+		return true;
+	}
 };
 
 } // namespace observer
@@ -9,6 +9,8 @@
 #include "common/timer.h"
 #include "common/base/string_number.h"
 #include "sdk/global_txn_internal.h"
+#include "sdk/sdk_utils.h"
+#include "sdk/table_impl.h"
 #include "types.h"
 
 namespace tera {
@@ -37,7 +39,18 @@ void NotificationImpl::Ack(Table* t,
     std::string notify_qulifier = PackNotifyName(column_family, qualifier);
     mutation->DeleteColumns(kNotifyColumnFamily, notify_qulifier, start_timestamp_);
     t->ApplyMutation(mutation);
+    bool acked = mutation->GetError().GetType() == tera::ErrorCode::kOK;
     delete mutation;
+
+    // an index entry left by a failed ack is dropped by the scanner
+    tera::ErrorCode err;
+    TableImpl* index_table = GetNotifyIndexTable(t, &err);
+    if (acked && index_table != NULL) {
+        std::unique_ptr<tera::RowMutation> index_mutation(
+            index_table->NewRowMutation(PackNotifyIndexRow(row_key)));
+        index_mutation->DeleteColumns(kNotifyColumnFamily, notify_qulifier, start_timestamp_);
+        index_table->ApplyMutation(index_mutation.get());
+    }
 }
 
 void NotificationImpl::Notify(Table* t,
@@ -56,6 +69,19 @@ void NotificationImpl::Notify(Table* t,
 
     tera::ErrorCode err;
     std::string notify_qulifier = PackNotifyName(column_family, qualifier);
+    TableImpl* index_table = GetNotifyIndexTable(t, &err);
+    if (index_table != NULL) {
+        // index the row before notifying it, observers scanning the index
+        // never see a notification without an index entry
+        index_table->Put(PackNotifyIndexRow(row_key), kNotifyColumnFamily, notify_qulifier,
+                         NumberToString(notify_timestamp_), notify_timestamp_, &err);
+    }
+    if (err.GetType() != tera::ErrorCode::kOK) {
+        LOG(ERROR) << "Notify index error. table: " << t->GetName() << " row "
+            << row_key << " pos: " << column_family << ":" << qualifier
+            << ", " << err.ToString();
+        return;
+    }
     t->Put(row_key, kNotifyColumnFamily, notify_qulifier, NumberToString(notify_timestamp_), notify_timestamp_, &err);
     if (err.GetType() != tera::ErrorCode::kOK) {
         LOG(ERROR) << "Notify error. table: " << t->GetName() << " row "
@@ -0,0 +1,187 @@
+// Copyright (c) 2015-2017, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "observer/executor/partition_key_selector.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <functional>
+#include <memory>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "common/this_thread.h"
+#include "common/timer.h"
+#include "observer/rowlocknode/fake_rowlock_client.h"
+#include "types.h"
+
+DECLARE_bool(mock_rowlock_enable);
+DECLARE_int32(observer_partition_lease_ms);
+
+namespace tera {
+namespace observer {
+
+namespace {
+
+// '#' is not allowed in table names, leases never conflict with rows
+std::string LeaseTableName(const std::string& table_name) {
+    return "#lease#" + table_name;
+}
+
+RowlockClient* NewRowlockClient() {
+    if (FLAGS_mock_rowlock_enable) {
+        return new FakeRowlockClient();
+    }
+    return new RowlockClient();
+}
+
+// unique among the observer processes, never 0
+uint64_t NewLeaseOwner() {
+    char hostname[256] = {0};
+    gethostname(hostname, sizeof(hostname) - 1);
+    uint64_t owner = std::hash<std::string>()(hostname)
+                     ^ static_cast<uint64_t>(get_micros())
+                     ^ (static_cast<uint64_t>(getpid()) << 32);
+    return owner | 1;
+}
+
+} // namespace
+
+PartitionKeySelector::PartitionKeySelector()
+    : RandomKeySelector(true),
+      cursor_(static_cast<uint64_t>(get_micros()) ^ (static_cast<uint64_t>(getpid()) << 32)),
+      owner_(NewLeaseOwner()) {
+}
+
+bool PartitionKeySelector::SelectStart(std::string* table_name,
+                                       std::string* start_key) {
+    return false;
+}
+
+bool PartitionKeySelector::SelectRange(std::string* table_name,
+                                       std::string* start_key,
+                                       std::string* end_key) {
+    std::shared_ptr<std::map<std::string, std::vector<tera::TabletInfo>>> table_read_copy;
+    {
+        MutexLock locker(&table_mutex_);
+        table_read_copy = tables_;
+    }
+
+    size_t tablet_num = 0;
+    for (auto it = table_read_copy->begin(); it != table_read_copy->end(); ++it) {
+        tablet_num += it->second.size();
+    }
+
+    // try each tablet once from the cursor, the next tablet of the one
+    // taken last time
+    for (size_t i = 0; i < tablet_num; ++i) {
+        size_t tablet_no = cursor_++ % tablet_num;
+        auto it = table_read_copy->begin();
+        while (tablet_no >= it->second.size()) {
+            tablet_no -= it->second.size();
+            ++it;
+        }
+        const tera::TabletInfo& tablet = it->second[tablet_no];
+        TabletKey key(it->first, tablet.start_key);
+        {
+            MutexLock locker(&lease_mutex_);
+            // the rowlock server renews rather than refuses a lease of the
+            // same owner, skip the tablets of the other workers here
+            if (!leases_.insert(std::make_pair(key, get_millis())).second) {
+                continue;
+            }
+        }
+        if (TryLease(it->first, tablet.start_key) == kLockSucc) {
+            *table_name = it->first;
+            *start_key = tablet.start_key;
+            *end_key = tablet.end_key;
+            VLOG(25) << "Partition table=" << *table_name << " StartKey=" << *start_key
+                     << " EndKey=" << *end_key;
+            return true;
+        }
+        MutexLock locker(&lease_mutex_);
+        leases_.erase(key);
+    }
+
+    // all tablets are taken by others
+    ThisThread::Sleep(kObserverWaitTimeMs);
+    return false;
+}
+
+void PartitionKeySelector::FinishRange(const std::string& table_name,
+                                       const std::string& start_key) {
+    {
+        MutexLock locker(&lease_mutex_);
+        if (leases_.erase(TabletKey(table_name, start_key)) == 0) {
+            // lost, the tablet may be leased by others now
+            return;
+        }
+    }
+    RowlockRequest request;
+    RowlockResponse response;
+    std::unique_ptr<RowlockClient> rowlock_client(NewRowlockClient());
+    request.set_table_name(LeaseTableName(table_name));
+    request.set_row(start_key);
+    request.set_owner(owner_);
+    rowlock_client->UnLock(&request, &response);
+}
+
+bool PartitionKeySelector::HoldRange(const std::string& table_name,
+                                     const std::string& start_key) {
+    TabletKey key(table_name, start_key);
+    int64_t lease_time = 0;
+    {
+        MutexLock locker(&lease_mutex_);
+        auto it = leases_.find(key);
+        if (it == leases_.end()) {
+            return false;
+        }
+        lease_time = it->second;
+    }
+    int64_t now = get_millis();
+    if (now - lease_time < FLAGS_observer_partition_lease_ms / 3) {
+        return true;
+    }
+
+    // the lease expires on the rowlock server no sooner than
+    // "observer_partition_lease_ms" after "lease_time", the time the request
+    // is sent, so it is held until then even if the renewal fails
+    StatusCode status = TryLease(table_name, start_key);
+    MutexLock locker(&lease_mutex_);
+    if (status == kLockSucc) {
+        leases_[key] = now;
+        return true;
+    }
+    int64_t held_ms = get_millis() - lease_time;
+    if (status != kLockFail && held_ms < FLAGS_observer_partition_lease_ms) {
+        return true;
+    }
+    LOG(WARNING) << "lease lost, table: " << table_name << " tablet: " << start_key
+                 << " taken " << held_ms << "ms ago";
+    leases_.erase(key);
+    return false;
+}
+
+StatusCode PartitionKeySelector::TryLease(const std::string& table_name,
+                                          const std::string& start_key) {
+    RowlockRequest request;
+    RowlockResponse response;
+    std::unique_ptr<RowlockClient> rowlock_client(NewRowlockClient());
+
+    request.set_table_name(LeaseTableName(table_name));
+    request.set_row(start_key);
+    request.set_owner(owner_);
+    request.set_lease_ms(FLAGS_observer_partition_lease_ms);
+    if (!rowlock_client->TryLock(&request, &response)) {
+        LOG(ERROR) << "TryLock rpc fail, lease of table: " << table_name
+                   << " tablet: " << start_key;
+        return kRPCError;
+    }
+    return response.lock_status();
+}
+
+} // namespace observer
+} // namespace tera
@@ -0,0 +1,63 @@
+// Copyright (c) 2015-2017, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TERA_OBSERVER_EXECUTOR_PARTITION_KEY_SELECTOR_H_
+#define TERA_OBSERVER_EXECUTOR_PARTITION_KEY_SELECTOR_H_
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "observer/executor/random_key_selector.h"
+#include "proto/status_code.pb.h"
+
+namespace tera {
+namespace observer {
+
+// PartitionKeySelector hands the tablets out to observer workers one at a
+// time.  A worker takes a lease on a tablet, i.e. locks its start key in the
+// rowlock service under a table name no user table could have, scans only
+// that tablet and releases the lease.  Workers start from random tablets
+// and go round the tablets in order, so workers of all processes seldom
+// scan the same tablet or conflict on rows.  A lease lasts
+// observer_partition_lease_ms and is renewed while the tablet is scanned,
+// the lease of a dead worker expires soon, then its tablets are taken by the
+// others.
+class PartitionKeySelector : public RandomKeySelector {
+public:
+	PartitionKeySelector();
+	virtual ~PartitionKeySelector() {}
+
+	// work is selected by SelectRange only
+	virtual bool SelectStart(std::string* table_name,
+							 std::string* start_key);
+	virtual bool SelectRange(std::string* table_name,
+							 std::string* start_key,
+							 std::string* end_key);
+	virtual void FinishRange(const std::string& table_name,
+							 const std::string& start_key);
+	// renew the lease if a third of it has passed, false if it is lost
+	virtual bool HoldRange(const std::string& table_name,
+						   const std::string& start_key);
+
+private:
+	// take or renew the lease, kLockSucc if it is taken by this process
+	StatusCode TryLease(const std::string& table_name, const std::string& start_key);
+
+private:
+	typedef std::pair<std::string, std::string> TabletKey;
+
+	std::atomic<uint64_t> cursor_;
+	// tells leases of this process from those of others
+	const uint64_t owner_;
+	mutable Mutex lease_mutex_;
+	// tablets leased by this process, and when (ms) the lease was taken last
+	std::map<TabletKey, int64_t> leases_;
+};
+
+} // namespace observer
+} // namespace tera
+
+#endif  // TERA_OBSERVER_EXECUTOR_PARTITION_KEY_SELECTOR_H_
@@ -7,6 +7,7 @@
 #include "gflags/gflags.h"
 #include "glog/logging.h"
 
+#include "sdk/sdk_utils.h"
 #include "types.h"
 
 DECLARE_string(flagfile);
@@ -14,8 +15,9 @@ DECLARE_string(flagfile);
 namespace tera {
 namespace observer {
 
-RandomKeySelector::RandomKeySelector()
-    : tables_(new std::map<std::string, std::vector<tera::TabletInfo>>),
+RandomKeySelector::RandomKeySelector(bool locate_index)
+    : locate_index_(locate_index),
+      tables_(new std::map<std::string, std::vector<tera::TabletInfo>>),
       quit_(false),
       cond_(&quit_mutex_) {
     tera::ErrorCode err;
@@ -83,8 +85,18 @@ ErrorCode RandomKeySelector::Observe(const std::string& table_name) {
     }
     if (tables_->find(table_name) == tables_->end()) {
 
+        if (locate_index_) {
+            std::unique_ptr<tera::TableDescriptor> desc(client_->GetTableDescriptor(table_name, &err));
+            if (desc == NULL) {
+                LOG(ERROR) << "Observe table failed, " << err.ToString();
+                return err;
+            }
+            if (desc->IsNotifyIndexEnabled()) {
+                index_tables_.insert(table_name);
+            }
+        }
         std::vector<tera::TabletInfo> tablets;
-        client_->GetTabletLocation(table_name, &tablets, &err);
+        GetTablets(table_name, &tablets, &err);
         if (tera::ErrorCode::kOK != err.GetType()) {
             LOG(ERROR) << "Observe table failed, " << err.ToString();
             return err;
@@ -95,6 +107,16 @@ ErrorCode RandomKeySelector::Observe(const std::string& table_name) {
     return err;
 }
 
+void RandomKeySelector::GetTablets(const std::string& table_name,
+                                   std::vector<tera::TabletInfo>* tablets,
+                                   tera::ErrorCode* err) {
+    if (index_tables_.find(table_name) != index_tables_.end()) {
+        client_->GetTabletLocation(NotifyIndexTableName(table_name), tablets, err);
+    } else {
+        client_->GetTabletLocation(table_name, tablets, err);
+    }
+}
+
 void RandomKeySelector::Update() {
     tera::ErrorCode err;
     while (true) {
@@ -115,7 +137,7 @@ void RandomKeySelector::Update() {
             std::string table_name = observe_tables_[i];
 
             std::vector<tera::TabletInfo> tablets;
-            client_->GetTabletLocation(table_name, &tablets, &err);
+            GetTablets(table_name, &tablets, &err);
             if (tera::ErrorCode::kOK != err.GetType()) {
                 LOG(ERROR) << "Observe table failed, " << err.ToString();
                 continue;
@@ -7,6 +7,7 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -20,19 +21,30 @@ namespace observer {
 
 class RandomKeySelector : public KeySelector {
 public:
-	RandomKeySelector();
+	// "locate_index": keep the tablets of the notification index tables
+	// instead of the observed tables, for tables with notify_index=on
+	explicit RandomKeySelector(bool locate_index = false);
 	virtual ~RandomKeySelector();
 
 	virtual bool SelectStart(std::string* table_name,
 							 std::string* start_key);
 	virtual ErrorCode Observe(const std::string& table_name);
+
+protected:
+	void GetTablets(const std::string& table_name,
+					std::vector<tera::TabletInfo>* tablets,
+					tera::ErrorCode* err);
+
 private:
 	void Update();
 
-private:
+protected:
+	const bool locate_index_;
 	tera::Client* client_;
 	mutable Mutex table_mutex_;
 	std::vector<std::string> observe_tables_;
+	// observed tables with the notification index
+	std::set<std::string> index_tables_;
 	std::shared_ptr<std::map<std::string, std::vector<tera::TabletInfo>>> tables_;
 	common::Thread update_thread_;
 
@@ -8,16 +8,19 @@
 #include <signal.h>
 #include <sys/time.h>
 
+#include <algorithm>
 #include <functional>
 
 #include "gflags/gflags.h"
 
 #include "common/base/string_number.h"
 #include "common/this_thread.h"
+#include "observer/executor/partition_key_selector.h"
 #include "observer/executor/random_key_selector.h"
 #include "observer/executor/notification.h"
 #include "observer/executor/notification_impl.h"
 #include "observer/rowlocknode/fake_rowlock_client.h"
+#include "sdk/global_txn_internal.h"
 #include "sdk/table_impl.h"
 #include "sdk/sdk_utils.h"
 #include "tera.h"
@@ -34,6 +37,8 @@ DECLARE_string(rowlock_server_port);
 DECLARE_int32(observer_rowlock_client_thread_num);
 DECLARE_int32(observer_random_access_thread_num);
 DECLARE_bool(mock_rowlock_enable);
+DECLARE_string(observer_key_selector);
+DECLARE_int32(observer_rowlock_batch_size);
 
 using namespace std::placeholders;
 
@@ -74,6 +79,9 @@ ScannerImpl::~ScannerImpl() {
         if (it->second.table) {
             delete it->second.table;
         }
+        if (it->second.notify_index_table) {
+            delete it->second.notify_index_table;
+        }
     }
 
     for (auto it = observers_.begin(); it != observers_.end(); ++it) {
@@ -120,6 +128,18 @@ ErrorCode ScannerImpl::Observe(const std::string& table_name,
             (*table_observe_info_)[table_name].type = GetTableTransactionType(table);
         }
 
+        if (!(*table_observe_info_)[table_name].notify_index_table &&
+            IsNotifyIndexTable((*table_observe_info_)[table_name].table)) {
+            const std::string index_name = NotifyIndexTableName(table_name);
+            tera::Table* index_table = tera_client_->OpenTable(index_name, &err);
+            if (tera::ErrorCode::kOK != err.GetType()) {
+                LOG(ERROR) << "open notify index table [" << index_name
+                           << "] failed, " << err.ToString();
+                return err;
+            }
+            (*table_observe_info_)[table_name].notify_index_table = index_table;
+        }
+
         if (!CheckTransactionTypeLegalForTable(observer->GetTransactionType(),
                 (*table_observe_info_)[table_name].type)) {
 
@@ -170,7 +190,11 @@ bool ScannerImpl::Init() {
 
     // init key_selector_
     // different selector started by different flags
-    key_selector_.reset(new RandomKeySelector());
+    if (FLAGS_observer_key_selector == "partition") {
+        key_selector_.reset(new PartitionKeySelector());
+    } else {
+        key_selector_.reset(new RandomKeySelector());
+    }
 
     return true;
 }
@@ -195,27 +219,45 @@ void ScannerImpl::ScanTable() {
     std::string table_name;
     std::set<Column> observe_columns;
     tera::Table* table = NULL;
+    tera::Table* index_table = NULL;
+
+    std::string end_key;
 
     // table and start key will be refreshed.
     while (!quit_) {
-        if (key_selector_->SelectStart(&table_name, &start_key)) {
+        if (key_selector_->SelectRange(&table_name, &start_key, &end_key)) {
+            // the range is scanned by this worker only
             GetObserveColumns(table_name, &observe_columns);
             table = GetTable(table_name);
-            if (DoScanTable(table, observe_columns, start_key, "")) {
-                DoScanTable(table, observe_columns, "", start_key);
+            index_table = GetIndexTable(table_name);
+            DoScanTable(table, index_table, observe_columns, start_key, end_key, true);
+            key_selector_->FinishRange(table_name, start_key);
+        } else if (key_selector_->SelectStart(&table_name, &start_key)) {
+            GetObserveColumns(table_name, &observe_columns);
+            table = GetTable(table_name);
+            index_table = GetIndexTable(table_name);
+            if (index_table != NULL) {
+                // a position in the index as random as "start_key" in the table
+                start_key = PackNotifyIndexRow(start_key);
+            }
+            if (DoScanTable(table, index_table, observe_columns, start_key, "", false)) {
+                DoScanTable(table, index_table, observe_columns, "", start_key, false);
             }
         }
     }
 }
 
 bool ScannerImpl::DoScanTable(tera::Table* table,
+                              tera::Table* index_table,
                               const std::set<Column>& observe_columns,
                               const std::string& start_key,
-                              const std::string& end_key) {
+                              const std::string& end_key,
+                              bool leased) {
     if (table == NULL) {
         return false;
     }
-    LOG(INFO) << "Start scan table. Table name: [" << table->GetName()
+    tera::Table* scan_table = index_table != NULL ? index_table : table;
+    LOG(INFO) << "Start scan table. Table name: [" << scan_table->GetName()
         << "]. Start key: [" << start_key << "]";
 
     tera::ScanDescriptor desc(start_key);
@@ -224,7 +266,7 @@ bool ScannerImpl::DoScanTable(tera::Table* table,
     // Notify stores in single lg
     desc.AddColumnFamily(kNotifyColumnFamily);
     tera::ErrorCode err;
-    std::unique_ptr<tera::ResultStream> result_stream(table->Scan(desc, &err));
+    std::unique_ptr<tera::ResultStream> result_stream(scan_table->Scan(desc, &err));
     if (tera::ErrorCode::kOK != err.GetType()) {
         LOG(ERROR) << "table scan failed, " << err.ToString();
         return false;
@@ -235,29 +277,68 @@ bool ScannerImpl::DoScanTable(tera::Table* table,
     }
 
     bool finished = false;
-    while (true) {
-        std::string rowkey;
-        std::vector<Column> notify_columns;
-        if (!NextRow(result_stream.get(), table->GetName(), &finished, &rowkey, &notify_columns)) {
-            return finished;
+    bool more = true;
+    const size_t batch_size = std::max(FLAGS_observer_rowlock_batch_size, 1);
+    while (more) {
+        // the rows of a batch are locked by one rpc
+        std::vector<NotifyRow> rows;
+        while (rows.size() < batch_size) {
+            NotifyRow row;
+            if (!NextRow(result_stream.get(), table->GetName(), &finished, &row.rowkey,
+                         &row.columns, &row.timestamps)) {
+                more = false;
+                break;
+            }
+            if (index_table != NULL && !UnpackNotifyIndexRow(row.rowkey, &row.rowkey)) {
+                LOG(WARNING) << "bad notify index row: " << row.rowkey;
+                continue;
+            }
+            rows.push_back(std::move(row));
         }
-
-        if (!TryLockRow(table->GetName(), rowkey)) {
-            // collision
-            LOG(INFO) <<"[rowlock failed] table=" << table->GetName() << " row=" << rowkey;
+        if (rows.empty()) {
+            break;
+        }
+        if (leased && !key_selector_->HoldRange(table->GetName(), start_key)) {
+            // the range may be scanned by another worker now
+            LOG(INFO) << "[lease lost] table=" << table->GetName() << " start=" << start_key;
             return false;
         }
-        VLOG(12) <<"[time] read value start. [row] " << rowkey;
 
-        std::shared_ptr<AutoRowUnlocker> unlocker(new AutoRowUnlocker(table->GetName(), rowkey));
-        std::vector<std::shared_ptr<NotifyCell>> notify_cells;
-        PrepareNotifyCell(table, rowkey, observe_columns, notify_columns, unlocker, &notify_cells);
+        std::vector<bool> locked;
+        LockRows(table->GetName(), rows, &locked);
+        // the rows locked behind a collision are unlocked when leaving
+        std::vector<std::shared_ptr<AutoRowUnlocker>> unlockers(rows.size());
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (locked[i]) {
+                unlockers[i].reset(new AutoRowUnlocker(table->GetName(), rows[i].rowkey));
+            }
+        }
+        for (size_t i = 0; i < rows.size(); ++i) {
+            const std::string& rowkey = rows[i].rowkey;
+            if (!locked[i]) {
+                // collision
+                LOG(INFO) <<"[rowlock failed] table=" << table->GetName() << " row=" << rowkey;
+                return false;
+            }
+            VLOG(12) <<"[time] read value start. [row] " << rowkey;
+
+            std::shared_ptr<AutoRowUnlocker> unlocker;
+            unlocker.swap(unlockers[i]);
+            if (index_table != NULL &&
+                !CheckNotifyIndex(table, index_table, rowkey, rows[i].timestamps,
+                                  &rows[i].columns)) {
+                continue;
+            }
+            std::vector<std::shared_ptr<NotifyCell>> notify_cells;
+            PrepareNotifyCell(table, rowkey, observe_columns, rows[i].columns, unlocker,
+                              &notify_cells);
 
-        for (uint32_t i = 0; i < notify_cells.size(); ++i) {
-            AsyncReadCell(notify_cells[i]);
+            for (uint32_t j = 0; j < notify_cells.size(); ++j) {
+                AsyncReadCell(notify_cells[j]);
+            }
         }
     }
-    return true;
+    return finished;
 }
 void ScannerImpl::PrepareNotifyCell(tera::Table* table,
                                     const std::string& rowkey,
@@ -322,9 +403,59 @@ void ScannerImpl::PrepareNotifyCell(tera::Table* table,
     }                                 
 }
 
+bool ScannerImpl::CheckNotifyIndex(tera::Table* table,
+                                   tera::Table* index_table,
+                                   const std::string& rowkey,
+                                   const std::vector<int64_t>& index_timestamps,
+                                   std::vector<Column>* notify_columns) {
+    std::unique_ptr<tera::RowReader> reader(table->NewRowReader(rowkey));
+    for (size_t i = 0; i < notify_columns->size(); ++i) {
+        const Column& column = (*notify_columns)[i];
+        reader->AddColumn(kNotifyColumnFamily, PackNotifyName(column.family, column.qualifier));
+    }
+    table->Get(reader.get());
+    tera::ErrorCode::ErrorCodeType type = reader->GetError().GetType();
+    if (type != tera::ErrorCode::kOK && type != tera::ErrorCode::kNotFound) {
+        LOG(WARNING) << "read notify of indexed row failed, table=" << table->GetName()
+            << " row=" << rowkey << ", " << reader->GetError().ToString();
+        return false;
+    }
+    std::set<std::string> notified;
+    for (; type == tera::ErrorCode::kOK && !reader->Done(); reader->Next()) {
+        notified.insert(reader->Qualifier());
+    }
+
+    std::vector<Column> columns;
+    std::unique_ptr<tera::RowMutation> stale(
+        index_table->NewRowMutation(PackNotifyIndexRow(rowkey)));
+    for (size_t i = 0; i < notify_columns->size(); ++i) {
+        const Column& column = (*notify_columns)[i];
+        std::string notify_name = PackNotifyName(column.family, column.qualifier);
+        if (notified.find(notify_name) != notified.end()) {
+            columns.push_back(column);
+        } else if (i < index_timestamps.size()) {
+            // a newer index entry belongs to a notification being written
+            stale->DeleteColumns(kNotifyColumnFamily, notify_name, index_timestamps[i]);
+        }
+    }
+    if (stale->MutationNum() > 0) {
+        VLOG(12) << "drop " << stale->MutationNum() << " stale notify index entries, table="
+            << table->GetName() << " row=" << rowkey;
+        index_table->ApplyMutation(stale.get());
+    }
+    notify_columns->swap(columns);
+    return true;
+}
+
+bool ScannerImpl::IsNotifyIndexTable(tera::Table* table) {
+    TableWrapper* wrapper = dynamic_cast<TableWrapper*>(table);
+    return wrapper != NULL && IsNotifyIndexEnabled(wrapper->GetTableImpl()->GetTableSchema());
+}
+
 bool ScannerImpl::NextRow(tera::ResultStream* result_stream,
                           const std::string& table_name, bool* finished,
-                          std::string* row, std::vector<Column>* notify_columns) {
+                          std::string* row, std::vector<Column>* notify_columns,
+                          std::vector<int64_t>* notify_timestamps) {
     tera::ErrorCode err;
 
     // check finish
@@ -339,6 +470,9 @@ bool ScannerImpl::NextRow(tera::ResultStream* result_stream,
     }
 
     notify_columns->clear();
+    if (notify_timestamps != NULL) {
+        notify_timestamps->clear();
+    }
     *row = result_stream->RowName();
 
     // scan cell
@@ -358,6 +492,9 @@ bool ScannerImpl::NextRow(tera::ResultStream* result_stream,
         Column notify_column = {table_name, observe_cf, observe_qu};
 
         notify_columns->push_back(notify_column);
+        if (notify_timestamps != NULL) {
+            notify_timestamps->push_back(result_stream->Timestamp());
+        }
         result_stream->Next();
     }
     return true;
@@ -462,6 +599,15 @@ tera::Table* ScannerImpl::GetTable(const std::string table_name) {
     return (*table_observe_info_read_copy)[table_name].table;
 }
 
+tera::Table* ScannerImpl::GetIndexTable(const std::string table_name) {
+    std::shared_ptr<std::map<std::string, TableObserveInfo>> table_observe_info_read_copy;
+    {
+        MutexLock locker(&table_mutex_);
+        table_observe_info_read_copy = table_observe_info_;
+    }
+    return (*table_observe_info_read_copy)[table_name].notify_index_table;
+}
+
 void ScannerImpl::Profiling() {
     while (!quit_) {
         LOG(INFO) << "[Observer Profiling Info]  total: "
@@ -531,12 +677,14 @@ std::string ScannerImpl::GetAckQualifier(const std::string& prefix,
     return prefix + "+ack_" + observer_name;
 }
 
-bool ScannerImpl::TryLockRow(const std::string& table_name,
-                             const std::string& row) const {
-    VLOG(12) << "[time] trylock wait " << table_name << " " << row;
-    
-    RowlockRequest request;
-    RowlockResponse response;
+void ScannerImpl::LockRows(const std::string& table_name,
+                           const std::vector<NotifyRow>& rows,
+                           std::vector<bool>* locked) const {
+    locked->assign(rows.size(), false);
+    VLOG(12) << "[time] batch lock " << table_name << " rows: " << rows.size();
+
+    RowlockBatchRequest request;
+    RowlockBatchResponse response;
 
     std::shared_ptr<RowlockClient> rowlock_client;
 
@@ -546,23 +694,25 @@ bool ScannerImpl::TryLockRow(const std::string& table_name,
         rowlock_client.reset(new RowlockClient());
     }
 
-    request.set_table_name(table_name);
-    request.set_row(row);
-
-    VLOG(12) << "[time] trylock " << table_name << " " << row;
-    if (!rowlock_client->TryLock(&request, &response)) {
-        LOG(ERROR) << "TryLock rpc fail, row: " << row;
-        return false;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        RowlockRequest* row = request.add_rows();
+        row->set_table_name(table_name);
+        row->set_row(rows[i].rowkey);
     }
 
-    if (response.lock_status() != kLockSucc) {
-        LOG(INFO) << "Lock row fail, row: " << request.row();
-        return false;
+    if (!rowlock_client->BatchLock(&request, &response)) {
+        LOG(ERROR) << "BatchLock rpc fail, table: " << table_name << " rows: " << rows.size();
+        return;
     }
-    VLOG(12) << "[time] lock success " << request.table_name()
-             << " " << request.row();
-
-    return true;
+    if (response.lock_status_size() != request.rows_size()) {
+        LOG(ERROR) << "BatchLock returns " << response.lock_status_size()
+                   << " status for " << request.rows_size() << " rows";
+        return;
+    }
+    for (size_t i = 0; i < rows.size(); ++i) {
+        (*locked)[i] = response.lock_status(i) == kLockSucc;
+    }
+    VLOG(12) << "[time] batch lock finish " << table_name;
 }
 
 bool ScannerImpl::CheckTransactionTypeLegalForTable(TransactionType transaction_type,
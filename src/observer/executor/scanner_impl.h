@@ -31,6 +31,8 @@ private:
     struct TableObserveInfo {
         std::map<Column, std::set<Observer*>> observe_columns;
         tera::Table* table;
+        // the notification index of "table", NULL if the index is disabled
+        tera::Table* notify_index_table;
         TransactionType type;
     };
     
@@ -49,6 +51,13 @@ private:
         }
     };
 
+    // a row found by the scan, with its notified columns and their timestamps
+    struct NotifyRow {
+        std::string rowkey;
+        std::vector<Column> columns;
+        std::vector<int64_t> timestamps;
+    };
+
 public:
     ScannerImpl();
     virtual ~ScannerImpl();
@@ -74,10 +83,16 @@ public:
 private:
     void ScanTable();
 
+    // scan "index_table" for the notified rows of "table" if it is not NULL,
+    // otherwise scan "table" itself
+    // with "leased", the range is taken by SelectRange(), it is scanned
+    // only while the key selector holds it
     bool DoScanTable(tera::Table* table,
+                     tera::Table* index_table,
                      const std::set<Column>& column_set,
                      const std::string& start_key,
-                     const std::string& end_key);
+                     const std::string& end_key,
+                     bool leased);
 
     void AsyncReadCell(std::shared_ptr<NotifyCell> notify_cell);
     void ValidateCellValue(RowReader* value_reader);
@@ -90,18 +105,37 @@ private:
                            std::set<Column>* columns);
 
     tera::Table* GetTable(const std::string table_name);
+    tera::Table* GetIndexTable(const std::string table_name);
 
+    // "notify_timestamps", if not NULL, gets the timestamp of each column
     bool NextRow(tera::ResultStream* result_stream, 
                  const std::string& table_name, bool* finished, 
-                 std::string* row, std::vector<Column>* notify_columns);
+                 std::string* row, std::vector<Column>* notify_columns,
+                 std::vector<int64_t>* notify_timestamps = NULL);
+
+    // keep the "notify_columns" of an index row which the data row still
+    // notifies, and delete the others from the index up to their
+    // "index_timestamps", so that entries left by failed acks do not fire
+    // the observers again.  false if the data row could not be read
+    bool CheckNotifyIndex(tera::Table* table,
+                          tera::Table* index_table,
+                          const std::string& rowkey,
+                          const std::vector<int64_t>& index_timestamps,
+                          std::vector<Column>* notify_columns);
+
+    // the notification index is enabled in the schema of "table"
+    bool IsNotifyIndexTable(tera::Table* table);
 
     void Profiling();
 
     void AsyncReadAck(std::shared_ptr<NotifyCell> notify_cell);
     std::string GetAckQualifierPrefix(const std::string& family, const std::string& qualifier) const;
     std::string GetAckQualifier(const std::string& prefix, const std::string& observer_name) const;
-    bool TryLockRow(const std::string& table_name, 
-                    const std::string& row) const;
+    // lock "rows" of "table_name" with one rpc, "locked" gets whether each
+    // row is locked, none of them if the rpc fails
+    void LockRows(const std::string& table_name,
+                  const std::vector<NotifyRow>& rows,
+                  std::vector<bool>* locked) const;
 
     bool CheckTransactionTypeLegalForTable(TransactionType transaction_type, TransactionType table_type);
     TransactionType GetTableTransactionType(tera::Table* table);
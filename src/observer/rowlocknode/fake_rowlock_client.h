@@ -38,6 +38,14 @@ public:
 
         return true;
     }
+
+    virtual bool BatchLock(const RowlockBatchRequest* request,
+                           RowlockBatchResponse* response) {
+        for (int32_t i = 0; i < request->rows_size(); ++i) {
+            response->add_lock_status(kLockSucc);
+        }
+        return true;
+    }
 };
 
 } // namespace observer
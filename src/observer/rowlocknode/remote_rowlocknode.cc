@@ -32,5 +32,12 @@ void RemoteRowlockNode::UnLock(google::protobuf::RpcController* controller,
     rowlocknode_impl_->UnLock(request, response, done);
 }
 
+void RemoteRowlockNode::BatchLock(google::protobuf::RpcController* controller,
+                                  const RowlockBatchRequest* request,
+                                  RowlockBatchResponse* response,
+                                  google::protobuf::Closure* done) {
+    rowlocknode_impl_->BatchLock(request, response, done);
+}
+
 } // namespace observer
 } // namespace tera
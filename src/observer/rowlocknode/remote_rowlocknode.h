@@ -27,6 +27,11 @@ public:
             RowlockResponse* response,
             google::protobuf::Closure* done);
 
+    void BatchLock(google::protobuf::RpcController* controller,
+            const RowlockBatchRequest* request,
+            RowlockBatchResponse* response,
+            google::protobuf::Closure* done);
+
 private:
     RowlockNodeImpl* rowlocknode_impl_;
 };
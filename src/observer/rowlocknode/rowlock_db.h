@@ -5,6 +5,7 @@
 #ifndef TERA_OBSERVER_ROWLOCKNODE_ROWLOCK_DB_H_
 #define TERA_OBSERVER_ROWLOCKNODE_ROWLOCK_DB_H_
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <pthread.h>
@@ -12,7 +13,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
-#include <unordered_map>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -30,72 +30,157 @@ DECLARE_int32(rowlock_timing_wheel_patch_num);
 namespace tera {
 namespace observer {
 
+// RowlockDB keeps the locks in an open-addressed table of (row, owner,
+// expire epoch) slots, a lock takes no allocation.  The epoch moves one step
+// on every ClearTimeout(), a lock taken in epoch "e" expires in epoch
+// "e + rowlock_timing_wheel_patch_num", or "e + ttl_epochs" if it is given,
+// expired and unlocked slots are reused by later locks and dropped when the
+// table is rebuilt.  A lock with a non-zero owner can be taken again by the
+// same owner, which renews it.
 class RowlockDB {
 public:
-    RowlockDB() 
-        : timing_wheel_pos_(0),
-          timing_wheel_patch_num_(FLAGS_rowlock_timing_wheel_patch_num) {
-        timing_wheel_.resize(timing_wheel_patch_num_);
+    RowlockDB()
+        : epoch_(kFirstEpoch),
+          ttl_epochs_(FLAGS_rowlock_timing_wheel_patch_num),
+          used_num_(0) {
+        slots_.resize(kInitSlotNum);
     }
 
     ~RowlockDB() {}
 
-    bool TryLock(uint64_t row) {
+    bool TryLock(uint64_t row, uint64_t owner = 0, uint64_t ttl_epochs = 0) {
         MutexLock locker(&mutex_);
-        if (locks_.find(row) == locks_.end()) {
-            locks_[row].reset(new uint64_t(row));
-            std::weak_ptr<uint64_t> ptr = locks_[row];
-            timing_wheel_[timing_wheel_pos_].push_back(ptr);
-            return true;
-        } else {
-            return false;
+        uint64_t epoch = epoch_;
+        Slot* reuse = NULL;
+        size_t mask = slots_.size() - 1;
+        for (size_t i = Hash(row) & mask; ; i = (i + 1) & mask) {
+            Slot* slot = &slots_[i];
+            if (slot->expire_epoch == kEmpty) {
+                // not locked, take the first free slot on the way
+                if (reuse == NULL) {
+                    reuse = slot;
+                    ++used_num_;
+                }
+                break;
+            }
+            if (slot->row == row) {
+                if (slot->expire_epoch > epoch && (owner == 0 || slot->owner != owner)) {
+                    return false;
+                }
+                reuse = slot;
+                break;
+            }
+            if (reuse == NULL && slot->expire_epoch <= epoch) {
+                reuse = slot;
+            }
         }
+        reuse->row = row;
+        reuse->owner = owner;
+        reuse->expire_epoch = epoch + (ttl_epochs > 0 ? ttl_epochs : ttl_epochs_);
+        if (used_num_ * 4 > slots_.size() * 3) {
+            Rebuild();
+        }
+        return true;
     }
 
-    void UnLock(uint64_t row) {
+    // with a non-zero owner, unlock the row only if it is locked by the owner
+    void UnLock(uint64_t row, uint64_t owner = 0) {
         MutexLock locker(&mutex_);
-        locks_.erase(row);
+        Slot* slot = Find(row);
+        if (slot != NULL && (owner == 0 || slot->owner == owner)) {
+            // keep the slot in the probe chain, it is free to reuse
+            slot->expire_epoch = kUnlocked;
+        }
     }
 
     // call this function ever timeout period
-    // 1. pointer of timing wheel move forward by one step
-    // 2. clear all the rowlock keys and remove them from locks_
-    // 3. the next 60 seconds all new rowlock keys will be put into this wheel patch
-    void ClearTimeout() { 
-        // pointer forward
-        mutex_.Lock();
-        timing_wheel_pos_ = (timing_wheel_pos_ + 1) % timing_wheel_patch_num_;
-        std::vector<std::weak_ptr<uint64_t>> buffer;
-
-        // release memory
-        buffer.swap(timing_wheel_[timing_wheel_pos_]);
-        mutex_.Unlock();
-
-        // remove key from locks_
-        for (uint32_t i = 0; i < buffer.size(); ++i) {
-            if (!buffer[i].expired()) {
-                mutex_.Lock();
-                auto it = buffer[i].lock();
-                locks_.erase(*it);
-                mutex_.Unlock();
-            }           
-        }
+    // the epoch moves forward by one step, locks of the oldest epoch expire
+    void ClearTimeout() {
+        MutexLock locker(&mutex_);
+        ++epoch_;
     }
 
     size_t Size() const {
         MutexLock locker(&mutex_);
-        return locks_.size();
+        size_t size = 0;
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            if (slots_[i].expire_epoch > epoch_) {
+                ++size;
+            }
+        }
+        return size;
     }
 
 private:
-    mutable Mutex mutex_;
+    struct Slot {
+        uint64_t row;
+        uint64_t owner;
+        uint64_t expire_epoch;
+        Slot() : row(0), owner(0), expire_epoch(kEmpty) {}
+    };
+
+    static const uint64_t kEmpty = 0;
+    static const uint64_t kUnlocked = 1;
+    static const uint64_t kFirstEpoch = 1;
+    static const size_t kInitSlotNum = 64;
+
+    static uint64_t Hash(uint64_t row) {
+        // rows are hash values already, mix them for the low bits
+        row ^= row >> 33;
+        row *= 0xff51afd7ed558ccdULL;
+        row ^= row >> 33;
+        return row;
+    }
+
+    // REQUIRES: mutex_ is held
+    Slot* Find(uint64_t row) {
+        size_t mask = slots_.size() - 1;
+        for (size_t i = Hash(row) & mask; slots_[i].expire_epoch != kEmpty; i = (i + 1) & mask) {
+            if (slots_[i].row == row) {
+                return &slots_[i];
+            }
+        }
+        return NULL;
+    }
 
-    std::unordered_map<uint64_t, std::shared_ptr<uint64_t>> locks_;
+    // drop the expired and unlocked slots, grow the table if it is still
+    // more than half full
+    // REQUIRES: mutex_ is held
+    void Rebuild() {
+        std::vector<Slot> old_slots;
+        old_slots.swap(slots_);
+        size_t live_num = 0;
+        for (size_t i = 0; i < old_slots.size(); ++i) {
+            if (old_slots[i].expire_epoch > epoch_) {
+                ++live_num;
+            }
+        }
+        size_t slot_num = old_slots.size();
+        while (live_num * 2 > slot_num) {
+            slot_num *= 2;
+        }
+        slots_.resize(slot_num);
+        size_t mask = slot_num - 1;
+        for (size_t i = 0; i < old_slots.size(); ++i) {
+            if (old_slots[i].expire_epoch <= epoch_) {
+                continue;
+            }
+            size_t pos = Hash(old_slots[i].row) & mask;
+            while (slots_[pos].expire_epoch != kEmpty) {
+                pos = (pos + 1) & mask;
+            }
+            slots_[pos] = old_slots[i];
+        }
+        used_num_ = live_num;
+    }
 
-    // timing wheel
-    uint32_t timing_wheel_pos_;
-    uint32_t timing_wheel_patch_num_;
-    std::vector<std::vector<std::weak_ptr<uint64_t>>> timing_wheel_;
+private:
+    mutable Mutex mutex_;
+    std::vector<Slot> slots_;
+    uint64_t epoch_;
+    const uint64_t ttl_epochs_;
+    // slots not empty, including expired and unlocked ones
+    size_t used_num_;
 };
 
 class ShardedRowlockDB {
@@ -112,19 +197,28 @@ public:
 
     ~ShardedRowlockDB() {}
 
-    bool TryLock(uint64_t row) {
+    bool TryLock(uint64_t row, uint64_t owner = 0, uint64_t ttl_epochs = 0) {
         std::unique_ptr<RowlockDB>& db_node = lock_map_[row % FLAGS_rowlock_db_sharding_number];
 
-        if (db_node->TryLock(row) == true) {
+        if (db_node->TryLock(row, owner, ttl_epochs) == true) {
             return true;
         } else {
             return false;
         }
     }
 
-    void UnLock(uint64_t row) {
+    // epochs a lease of "lease_ms" lasts at least, no longer than the ttl
+    static uint64_t LeaseEpochs(int32_t lease_ms) {
+        int64_t epoch_ms = std::max(FLAGS_rowlock_db_ttl / FLAGS_rowlock_timing_wheel_patch_num, 1);
+        // the epoch may move right after the lock is taken
+        int64_t epochs = (lease_ms + epoch_ms - 1) / epoch_ms + 1;
+        return std::min<int64_t>(std::max<int64_t>(epochs, 1),
+                                 FLAGS_rowlock_timing_wheel_patch_num);
+    }
+
+    void UnLock(uint64_t row, uint64_t owner = 0) {
         std::unique_ptr<RowlockDB>& db_node = lock_map_[row % FLAGS_rowlock_db_sharding_number];
-        db_node->UnLock(row);
+        db_node->UnLock(row, owner);
     }
 
     size_t Size() const {
@@ -44,7 +44,9 @@ void RowlockNodeImpl::TryLock(const RowlockRequest* request,
         RowlockResponse* response,
         google::protobuf::Closure* done) {
     uint64_t rowlock_key = GetRowlockKey(request->table_name(), request->row());
-    if (rowlock_db_.TryLock(rowlock_key)) {
+    uint64_t ttl_epochs = request->has_lease_ms() ?
+                          ShardedRowlockDB::LeaseEpochs(request->lease_ms()) : 0;
+    if (rowlock_db_.TryLock(rowlock_key, request->owner(), ttl_epochs)) {
         response->set_lock_status(kLockSucc);
         VLOG(12) << "Lock success: " << request->row();
     } else {
@@ -60,12 +62,31 @@ void RowlockNodeImpl::UnLock(const RowlockRequest* request,
         RowlockResponse* response,
         google::protobuf::Closure* done) {
     uint64_t rowlock_key = GetRowlockKey(request->table_name(), request->row());
-    rowlock_db_.UnLock(rowlock_key);
+    rowlock_db_.UnLock(rowlock_key, request->owner());
     response->set_lock_status(kLockSucc);
     VLOG(12) << "Unlock success: " << request->row();
     done->Run();
 }
 
+void RowlockNodeImpl::BatchLock(const RowlockBatchRequest* request,
+        RowlockBatchResponse* response,
+        google::protobuf::Closure* done) {
+    for (int32_t i = 0; i < request->rows_size(); ++i) {
+        const RowlockRequest& row = request->rows(i);
+        uint64_t rowlock_key = GetRowlockKey(row.table_name(), row.row());
+        uint64_t ttl_epochs = row.has_lease_ms() ?
+                              ShardedRowlockDB::LeaseEpochs(row.lease_ms()) : 0;
+        if (rowlock_db_.TryLock(rowlock_key, row.owner(), ttl_epochs)) {
+            response->add_lock_status(kLockSucc);
+        } else {
+            response->add_lock_status(kLockFail);
+            VLOG(12) << "Lock fail, table name: " << row.table_name()
+                     << " row :" << row.row();
+        }
+    }
+    done->Run();
+}
+
 void RowlockNodeImpl::PrintQPS() {
     return;
 }
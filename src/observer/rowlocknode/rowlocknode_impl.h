@@ -38,6 +38,10 @@ public:
             RowlockResponse* response,
             google::protobuf::Closure* done);
 
+    void BatchLock(const RowlockBatchRequest* request,
+            RowlockBatchResponse* response,
+            google::protobuf::Closure* done);
+
     void PrintQPS();
 private:
     uint64_t GetRowlockKey(const std::string& table_name, const std::string& row) const;
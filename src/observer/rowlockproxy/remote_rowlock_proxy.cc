@@ -32,5 +32,12 @@ void RemoteRowlockProxy::UnLock(google::protobuf::RpcController* controller,
     rowlock_proxy_impl_->UnLock(request, response, done);
 }
 
+void RemoteRowlockProxy::BatchLock(google::protobuf::RpcController* controller,
+                                   const RowlockBatchRequest* request,
+                                   RowlockBatchResponse* response,
+                                   google::protobuf::Closure* done) {
+    rowlock_proxy_impl_->BatchLock(request, response, done);
+}
+
 } // namespace observer
 } // namespace tera
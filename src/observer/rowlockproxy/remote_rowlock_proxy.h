@@ -29,6 +29,11 @@ public:
             RowlockResponse* response,
             google::protobuf::Closure* done);
 
+    void BatchLock(google::protobuf::RpcController* controller,
+            const RowlockBatchRequest* request,
+            RowlockBatchResponse* response,
+            google::protobuf::Closure* done);
+
 private:
     RowlockProxyImpl* rowlock_proxy_impl_;
 };
@@ -5,6 +5,8 @@
 #include "observer/rowlockproxy/rowlock_proxy_impl.h"
 
 #include <functional>
+#include <map>
+#include <vector>
 
 #include "common/timer.h"
 #include "utils/utils_cmd.h"
@@ -69,6 +71,43 @@ void RowlockProxyImpl::UnLock(const RowlockRequest* request,
 
 }
 
+void RowlockProxyImpl::BatchLock(const RowlockBatchRequest* request,
+                                 RowlockBatchResponse* response,
+                                 google::protobuf::Closure* done) {
+    ServerBatches server_rows;
+    SplitBatch(request, &server_rows);
+    for (int32_t i = 0; i < request->rows_size(); ++i) {
+        response->add_lock_status(kLockFail);
+    }
+
+    for (auto it = server_rows.begin(); it != server_rows.end(); ++it) {
+        RowlockStub client(it->first);
+        RowlockBatchResponse server_response;
+        const std::vector<int32_t>& index = it->second.second;
+        if (!client.BatchLock(&it->second.first, &server_response)
+            || server_response.lock_status_size() != static_cast<int32_t>(index.size())) {
+            LOG(WARNING) << "batch lock rpc fail, server: " << it->first;
+            continue;
+        }
+        for (size_t i = 0; i < index.size(); ++i) {
+            response->set_lock_status(index[i], server_response.lock_status(i));
+        }
+    }
+    VLOG(12) << "batch lock rows: " << request->rows_size();
+    done->Run();
+}
+
+void RowlockProxyImpl::SplitBatch(const RowlockBatchRequest* request,
+                                  ServerBatches* server_rows) {
+    for (int32_t i = 0; i < request->rows_size(); ++i) {
+        const RowlockRequest& row = request->rows(i);
+        std::string addr = ScheduleRowKey(GetRowKey(row.table_name(), row.row()));
+        auto& batch = (*server_rows)[addr];
+        *batch.first.add_rows() = row;
+        batch.second.push_back(i);
+    }
+}
+
 uint64_t RowlockProxyImpl::GetRowKey(const std::string& table_name,
                                      const std::string& row) const {
     std::string rowkey_str = table_name + row;
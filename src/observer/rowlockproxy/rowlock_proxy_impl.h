@@ -6,8 +6,12 @@
 #define TERA_OBSERVER_ROWLOCKPROXY_ROWLOCK_PROXY_IMPL_H_
 
 #include <glog/logging.h>
+#include <map>
 #include <memory>
 #include <pthread.h>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "common/counter.h"
 #include "common/mutex.h"
@@ -37,11 +41,21 @@ public:
                 RowlockResponse* response,
                 google::protobuf::Closure* done);
 
+    // one BatchLock rpc to each rowlock server of the rows
+    void BatchLock(const RowlockBatchRequest* request,
+                   RowlockBatchResponse* response,
+                   google::protobuf::Closure* done);
+
     // for zk
     void SetServerNumber(uint32_t number);
     uint32_t GetServerNumber();
     void UpdateServers(uint32_t id, const std::string& addr);
 private:
+    // server addr -> (rows to the server, their index in the request)
+    typedef std::map<std::string, std::pair<RowlockBatchRequest, std::vector<int32_t>>>
+        ServerBatches;
+    void SplitBatch(const RowlockBatchRequest* request, ServerBatches* server_rows);
+
     uint64_t GetRowKey(const std::string& table_name,
                        const std::string& row) const;
     // rowkey -> server addr
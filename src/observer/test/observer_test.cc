@@ -2,15 +2,20 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "common/base/string_number.h"
 #include "common/thread_pool.h"
 #include "common/semaphore.h"
+#include "common/timer.h"
 #include "observer/executor/observer.h"
 #include "observer/executor/random_key_selector.h"
 #include "observer/executor/scanner.h"
@@ -36,6 +41,9 @@ DECLARE_bool(mock_rowlock_enable);
 DECLARE_bool(tera_sdk_tso_client_enabled);
 DECLARE_int32(observer_scanner_thread_num);
 
+DEFINE_int64(observer_bench_rows, 10000, "rows notified and acked before NotifyLatencyBench");
+DEFINE_int64(observer_bench_notifies, 100, "notifications measured by NotifyLatencyBench");
+
 namespace tera {
 namespace observer {
 
@@ -223,6 +231,54 @@ private:
     std::string value_;
 };
 
+// records the delay from writing a notification to observing it,
+// the write time is the value of the notified cell
+class LatencyWorker : public Observer {
+public:
+    LatencyWorker() {}
+    virtual ~LatencyWorker() {}
+    virtual void OnNotify(tera::Transaction* t,
+                          tera::Client* client,
+                          const std::string& table_name,
+                          const std::string& family,
+                          const std::string& qualifier,
+                          const std::string& row,
+                          const std::string& value,
+                          int64_t timestamp,
+                          Notification* notification) {
+        int64_t write_us = 0;
+        if (StringToNumber(value, &write_us)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            latency_.push_back(get_micros() - write_us);
+        }
+        tera::ErrorCode err;
+        std::unique_ptr<Table> table(client->OpenTable(table_name, &err));
+        notification->Ack(table.get(), row, family, qualifier);
+        notification->Done();
+    }
+
+    virtual std::string GetObserverName() const {
+        return "LatencyWorker";
+    }
+
+    virtual TransactionType GetTransactionType() const {
+        return kNoneTransaction;
+    }
+
+    size_t Count() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return latency_.size();
+    }
+
+    std::vector<int64_t> Latency() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return latency_;
+    }
+private:
+    std::mutex mutex_;
+    std::vector<int64_t> latency_;
+};
+
 class TestTxn : public SingleRowTxn {
 public:
     TestTxn(Table* table, const std::string& row_key,
@@ -713,6 +769,102 @@ public:
         scanner->Exit();
         delete scanner;
     }
+
+    // write a notification of "row" the way NotificationImpl::Notify does
+    void WriteNotify(Table* table, const std::string& row, const std::string& value) {
+        tera::ErrorCode err;
+        int64_t ts = get_micros();
+        TableImpl* index_table = GetNotifyIndexTable(table, &err);
+        if (index_table != NULL) {
+            index_table->Put(PackNotifyIndexRow(row), kNotifyColumnFamily, "cf:Page", "", ts, &err);
+        }
+        table->Put(row, "cf", "Page", value, ts, &err);
+        table->Put(row, kNotifyColumnFamily, "cf:Page", "", ts, &err);
+    }
+
+    // Fill the table with FLAGS_observer_bench_rows rows notified and acked
+    // already, then measure how long FLAGS_observer_bench_notifies fresh
+    // notifications take to be observed.  Return false if failed.
+    bool RunNotifyLatencyBench(tera::Client* client, const std::string& table_name,
+                               bool use_index) {
+        tera::ErrorCode err;
+        tera::TableDescriptor table_desc(table_name);
+        if (use_index) {
+            table_desc.EnableNotifyIndex();
+        }
+        table_desc.AddLocalityGroup("lg1");
+        tera::ColumnFamilyDescriptor* cf1 = table_desc.AddColumnFamily("cf", "lg1");
+        cf1->EnableNotify();
+        ExtendNotifyLgToDescriptor(&table_desc);
+        client->CreateTable(table_desc, &err);
+        if (use_index) {
+            tera::TableDescriptor index_desc;
+            BuildNotifyIndexDescriptor(table_name, &index_desc);
+            client->CreateTable(index_desc, &err);
+        }
+
+        std::unique_ptr<Table> table(client->OpenTable(table_name, &err));
+        if (tera::ErrorCode::kOK != err.GetType()) {
+            LOG(ERROR) << "open table failed";
+            return false;
+        }
+        for (int64_t i = 0; i < FLAGS_observer_bench_rows; ++i) {
+            std::string row = "cold_" + NumberToString(i);
+            table->Put(row, "cf", "Page", "cold", &err);
+            table->Put(row, kNotifyColumnFamily, "cf:Page", "", &err);
+            std::unique_ptr<tera::RowMutation> ack(table->NewRowMutation(row));
+            ack->DeleteColumns(kNotifyColumnFamily, "cf:Page");
+            table->ApplyMutation(ack.get());
+        }
+
+        LatencyWorker* observer = new LatencyWorker();
+        ScannerImpl* scanner = new ScannerImpl();
+        if (!scanner->Init() ||
+            scanner->Observe(table_name, "cf", "Page", observer).GetType() != tera::ErrorCode::kOK ||
+            !scanner->Start()) {
+            LOG(ERROR) << "fail to start scanner_impl";
+            delete observer;
+            delete scanner;
+            return false;
+        }
+
+        int64_t start_us = get_micros();
+        for (int64_t i = 0; i < FLAGS_observer_bench_notifies; ++i) {
+            WriteNotify(table.get(), "hot_" + NumberToString(i), NumberToString(get_micros()));
+        }
+        while (observer->Count() < static_cast<size_t>(FLAGS_observer_bench_notifies) &&
+               get_micros() - start_us < 600 * 1000000LL) {
+            usleep(10000);
+        }
+        scanner->Exit();
+
+        std::vector<int64_t> latency = observer->Latency();
+        std::sort(latency.begin(), latency.end());
+        int64_t sum = 0;
+        for (size_t i = 0; i < latency.size(); ++i) {
+            sum += latency[i];
+        }
+        std::cout << "notify index: " << (use_index ? "on" : "off")
+                  << ", cold rows: " << FLAGS_observer_bench_rows
+                  << ", observed: " << latency.size() << "/" << FLAGS_observer_bench_notifies
+                  << ", latency(ms) avg: " << (latency.empty() ? 0 : sum / latency.size() / 1000)
+                  << ", p99: " << (latency.empty() ? 0 : latency[latency.size() * 99 / 100] / 1000)
+                  << std::endl;
+        delete scanner;
+        return latency.size() >= static_cast<size_t>(FLAGS_observer_bench_notifies);
+    }
+
+    void NotifyLatencyBench() {
+        tera::ErrorCode err;
+        std::unique_ptr<tera::Client> client(tera::Client::NewClient(FLAGS_flagfile, &err));
+        EXPECT_EQ(tera::ErrorCode::kOK, err.GetType());
+        if (tera::ErrorCode::kOK != err.GetType()) {
+            LOG(ERROR) << "new client failed";
+            return;
+        }
+        EXPECT_TRUE(RunNotifyLatencyBench(client.get(), "observer_bench_table", false));
+        EXPECT_TRUE(RunNotifyLatencyBench(client.get(), "observer_bench_index_table", true));
+    }
 };
 
 TEST_F(ObserverImplTest, OnNotifyTest) {
@@ -739,6 +891,10 @@ TEST_F(ObserverImplTest, ValidateAckConfilict) {
     ValidateAckConfilictTest();
 }
 
+TEST_F(ObserverImplTest, NotifyLatencyBench) {
+    NotifyLatencyBench();
+}
+
 } // namespace observer
 } // namespace tera
 
@@ -64,6 +64,46 @@ TEST(RowlockProxyTest, ValueTest) {
 	EXPECT_EQ((*rowlock_proxy_impl.server_addrs_)[1], rowlock_proxy_impl.ScheduleRowKey(1));
 }
 
+TEST(RowlockProxyTest, SplitBatch) {
+	RowlockProxyImpl rowlock_proxy_impl;
+	rowlock_proxy_impl.SetServerNumber(3);
+	rowlock_proxy_impl.UpdateServers(0, "server0:22222");
+	rowlock_proxy_impl.UpdateServers(1, "server1:22222");
+	rowlock_proxy_impl.UpdateServers(2, "server2:22222");
+
+	RowlockBatchRequest request;
+	for (int i = 0; i < 30; ++i) {
+		RowlockRequest* row = request.add_rows();
+		row->set_table_name("table");
+		row->set_row("row" + std::to_string(i));
+		row->set_owner(i);
+		row->set_lease_ms(1000);
+	}
+
+	RowlockProxyImpl::ServerBatches server_rows;
+	rowlock_proxy_impl.SplitBatch(&request, &server_rows);
+	EXPECT_EQ(3, server_rows.size());
+	// every row goes once to its own server, owner and lease included
+	std::vector<int> seen(request.rows_size(), 0);
+	for (auto it = server_rows.begin(); it != server_rows.end(); ++it) {
+		const RowlockBatchRequest& batch = it->second.first;
+		const std::vector<int32_t>& index = it->second.second;
+		ASSERT_EQ(batch.rows_size(), static_cast<int32_t>(index.size()));
+		for (int32_t i = 0; i < batch.rows_size(); ++i) {
+			const RowlockRequest& row = batch.rows(i);
+			EXPECT_EQ(request.rows(index[i]).row(), row.row());
+			EXPECT_EQ(static_cast<uint64_t>(index[i]), row.owner());
+			EXPECT_EQ(1000, row.lease_ms());
+			EXPECT_EQ(it->first, rowlock_proxy_impl.ScheduleRowKey(
+				rowlock_proxy_impl.GetRowKey(row.table_name(), row.row())));
+			++seen[index[i]];
+		}
+	}
+	for (size_t i = 0; i < seen.size(); ++i) {
+		EXPECT_EQ(1, seen[i]);
+	}
+}
+
 } // namespace observer
 } // namespace tera
 
@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "gflags/gflags.h"
@@ -11,8 +12,11 @@
 #include "gtest/gtest.h"
 
 #include "observer/rowlocknode/rowlock_db.h"
+#include "observer/rowlocknode/rowlocknode_impl.h"
 #include "common/counter.h"
+#include "common/timer.h"
 
+DECLARE_int32(rowlock_db_ttl);
 DECLARE_int32(rowlock_timing_wheel_patch_num);
 
 namespace tera {
@@ -159,6 +163,98 @@ TEST(RowlockDB, LockTest) {
     EXPECT_EQ(FLAGS_rowlock_timing_wheel_patch_num - 2, db.Size());
 }
 
+TEST(RowlockDB, LeaseTest) {
+    RowlockDB db;
+    const uint64_t kOwner = 100;
+    const uint64_t kOther = 200;
+
+    // a lease is renewed by its owner only
+    EXPECT_TRUE(db.TryLock(0, kOwner, 3));
+    EXPECT_FALSE(db.TryLock(0));
+    EXPECT_FALSE(db.TryLock(0, kOther, 3));
+    EXPECT_TRUE(db.TryLock(0, kOwner, 3));
+
+    // it expires "ttl_epochs" after it is renewed last
+    db.ClearTimeout();
+    db.ClearTimeout();
+    EXPECT_TRUE(db.TryLock(0, kOwner, 3));
+    db.ClearTimeout();
+    db.ClearTimeout();
+    EXPECT_FALSE(db.TryLock(0, kOther, 3));
+    db.ClearTimeout();
+    EXPECT_EQ(0, db.Size());
+    EXPECT_TRUE(db.TryLock(0, kOther, 3));
+
+    // only the owner releases its lease
+    db.UnLock(0, kOwner);
+    EXPECT_FALSE(db.TryLock(0, kOwner, 3));
+    db.UnLock(0, kOther);
+    EXPECT_TRUE(db.TryLock(0, kOwner, 3));
+
+    // a lock without owner is never renewed
+    EXPECT_TRUE(db.TryLock(1));
+    EXPECT_FALSE(db.TryLock(1, 0, 3));
+}
+
+class TestClosure : public google::protobuf::Closure {
+public:
+    virtual void Run() {}
+};
+
+TEST(RowlockNodeImpl, BatchLock) {
+    RowlockNodeImpl rowlock_node;
+    TestClosure done;
+    const uint64_t kOwner = 100;
+
+    RowlockBatchRequest request;
+    RowlockRequest* row = request.add_rows();
+    row->set_table_name("table");
+    row->set_row("leased");
+    row->set_owner(kOwner);
+    row->set_lease_ms(1000);
+    row = request.add_rows();
+    row->set_table_name("table");
+    row->set_row("locked");
+
+    RowlockBatchResponse response;
+    rowlock_node.BatchLock(&request, &response, &done);
+    ASSERT_EQ(2, response.lock_status_size());
+    EXPECT_EQ(kLockSucc, response.lock_status(0));
+    EXPECT_EQ(kLockSucc, response.lock_status(1));
+
+    // the owner renews its lease, a plain lock is not taken twice
+    response.Clear();
+    rowlock_node.BatchLock(&request, &response, &done);
+    EXPECT_EQ(kLockSucc, response.lock_status(0));
+    EXPECT_EQ(kLockFail, response.lock_status(1));
+
+    // another owner does not get the lease, and only the owner releases it
+    request.mutable_rows(0)->set_owner(kOwner + 1);
+    response.Clear();
+    rowlock_node.BatchLock(&request, &response, &done);
+    EXPECT_EQ(kLockFail, response.lock_status(0));
+
+    RowlockResponse unlock_response;
+    rowlock_node.UnLock(&request.rows(0), &unlock_response, &done);
+    request.mutable_rows(0)->set_owner(kOwner);
+    rowlock_node.UnLock(&request.rows(0), &unlock_response, &done);
+    request.mutable_rows(0)->set_owner(kOwner + 1);
+    response.Clear();
+    rowlock_node.BatchLock(&request, &response, &done);
+    EXPECT_EQ(kLockSucc, response.lock_status(0));
+}
+
+TEST(ShardedRowlockDB, LeaseEpochs) {
+    int32_t epoch_ms = FLAGS_rowlock_db_ttl / FLAGS_rowlock_timing_wheel_patch_num;
+    // one more epoch for the one moving right after the lock
+    EXPECT_EQ(2U, ShardedRowlockDB::LeaseEpochs(1));
+    EXPECT_EQ(2U, ShardedRowlockDB::LeaseEpochs(epoch_ms));
+    EXPECT_EQ(3U, ShardedRowlockDB::LeaseEpochs(epoch_ms + 1));
+    // no longer than the rowlock ttl
+    EXPECT_EQ(static_cast<uint64_t>(FLAGS_rowlock_timing_wheel_patch_num),
+              ShardedRowlockDB::LeaseEpochs(FLAGS_rowlock_db_ttl * 2));
+}
+
 TEST(ShardedRowlockDB, ParaTest) {
     Counter counter;
     ShardedRowlockDB db;
@@ -180,5 +276,67 @@ TEST(ShardedRowlockDB, ParaTest) {
     EXPECT_EQ(0, db.Size());
 }
 
+TEST(RowlockDB, RebuildTest) {
+    RowlockDB db;
+    const uint64_t kKeyNum = 10000;
+
+    // the table grows many times
+    for (uint64_t i = 0; i < kKeyNum; ++i) {
+        EXPECT_TRUE(db.TryLock(i));
+    }
+    EXPECT_EQ(kKeyNum, db.Size());
+    for (uint64_t i = 0; i < kKeyNum; ++i) {
+        EXPECT_FALSE(db.TryLock(i));
+    }
+
+    // unlocked slots are reused
+    for (uint64_t i = 0; i < kKeyNum; i += 2) {
+        db.UnLock(i);
+    }
+    EXPECT_EQ(kKeyNum / 2, db.Size());
+    for (uint64_t i = 0; i < kKeyNum; ++i) {
+        EXPECT_EQ(i % 2 == 0, db.TryLock(i));
+    }
+    EXPECT_EQ(kKeyNum, db.Size());
+
+    for (int32_t i = 0; i < FLAGS_rowlock_timing_wheel_patch_num; ++i) {
+        db.ClearTimeout();
+    }
+    EXPECT_EQ(0, db.Size());
+    EXPECT_TRUE(db.TryLock(0));
+}
+
+class LockBench {
+public:
+    void Lock(ShardedRowlockDB* db, uint64_t start, uint64_t num) {
+        for (uint64_t i = start; i < start + num; ++i) {
+            db->TryLock(i);
+            db->UnLock(i);
+        }
+    }
+};
+
+// lock + unlock qps of different threads
+TEST(ShardedRowlockDB, QPSBench) {
+    const uint64_t kLockNum = 1000000;
+    LockBench bench;
+    for (uint32_t thread_num = 1; thread_num <= 64; thread_num *= 2) {
+        ShardedRowlockDB db;
+        uint64_t num = kLockNum / thread_num;
+        std::vector<std::thread> threads;
+        int64_t start_us = get_micros();
+        for (uint32_t i = 0; i < thread_num; ++i) {
+            threads.push_back(std::thread(&LockBench::Lock, &bench, &db, i * num, num));
+        }
+        for (size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+        int64_t cost_us = get_micros() - start_us + 1;
+        EXPECT_EQ(0, db.Size());
+        std::cout << "threads: " << thread_num
+                  << ", qps: " << num * thread_num * 1000000 / cost_us << std::endl;
+    }
+}
+
 } // namespace observer
 } // namespace tera
@@ -12,6 +12,7 @@
 #include <gtest/gtest.h>
 #include <memory>
 
+#include "observer/executor/partition_key_selector.h"
 #include "observer/executor/random_key_selector.h"
 #include "observer/executor/scanner_impl.h"
 #include "observer/observer_demo/demo_observer.h"
@@ -21,6 +22,7 @@
 #include "sdk/read_impl.h"
 #include "sdk/table_impl.h"
 #include "sdk/sdk_utils.h"
+#include "sdk/test/mock_table.h"
 #include "tera.h"
 
 DECLARE_bool(tera_sdk_client_for_gtxn);
@@ -29,6 +31,7 @@ DECLARE_string(tera_coord_type);
 DECLARE_bool(rowlock_test);
 DECLARE_bool(tera_gtxn_test_opened);
 DECLARE_bool(mock_rowlock_enable);
+DECLARE_int32(observer_partition_lease_ms);
 
 namespace tera {
 namespace observer {
@@ -405,6 +408,64 @@ TEST(ScannerImpl, PrepareNotifyCell) {
     EXPECT_EQ(notify_cells[0]->observer, observer);
 }
 
+TEST(ScannerImpl, CheckNotifyIndex) {
+    common::ThreadPool thread_pool(2);
+    MockTable table("test_table", &thread_pool);
+    MockTable index_table(NotifyIndexTableName("test_table"), &thread_pool);
+    ScannerImpl scanner;
+
+    std::vector<Column> notify_columns;
+    Column acked = {"test_table", "cf", "acked"};
+    Column notified = {"test_table", "cf", "notified"};
+    notify_columns.push_back(acked);
+    notify_columns.push_back(notified);
+    std::vector<int64_t> index_timestamps;
+    index_timestamps.push_back(10);
+    index_timestamps.push_back(20);
+
+    // the data row still notifies one of the indexed columns
+    std::vector<MockReaderResult> results(2);
+    KeyValuePair* kv = results[0].result.add_key_values();
+    kv->set_key("row");
+    kv->set_column_family(kNotifyColumnFamily);
+    kv->set_qualifier(PackNotifyName("cf", "notified"));
+    kv->set_timestamp(20);
+    results[1].status.SetFailed(ErrorCode::kSystem, "");
+    table.AddReaderResult(results);
+    index_table.AddMutationErrors(std::vector<ErrorCode>(1));
+
+    EXPECT_TRUE(scanner.CheckNotifyIndex(&table, &index_table, "row",
+                                         index_timestamps, &notify_columns));
+    ASSERT_EQ(notify_columns.size(), 1);
+    EXPECT_EQ(notify_columns[0], notified);
+    // the stale entry is deleted from the index
+    EXPECT_EQ(index_table.MutationNum(), 1);
+
+    // unknown if the data row notifies, nothing is observed or deleted
+    notify_columns.push_back(acked);
+    EXPECT_FALSE(scanner.CheckNotifyIndex(&table, &index_table, "row",
+                                          index_timestamps, &notify_columns));
+    EXPECT_EQ(index_table.MutationNum(), 1);
+}
+
+TEST(ScannerImpl, LockRows) {
+    FLAGS_mock_rowlock_enable = true;
+    ScannerImpl scanner;
+    std::vector<ScannerImpl::NotifyRow> rows(3);
+    rows[0].rowkey = "row0";
+    rows[1].rowkey = "row1";
+    rows[2].rowkey = "row2";
+
+    std::vector<bool> locked;
+    scanner.LockRows("test_table", rows, &locked);
+    ASSERT_EQ(locked.size(), 3);
+    EXPECT_TRUE(locked[0] && locked[1] && locked[2]);
+
+    rows.clear();
+    scanner.LockRows("test_table", rows, &locked);
+    EXPECT_TRUE(locked.empty());
+}
+
 TEST(ScannerImpl, GetAckQualifierPrefix) {
     ScannerImpl scanner;
 
@@ -424,6 +485,79 @@ TEST(ScannerImpl, GetAckQualifier) {
     EXPECT_EQ(scanner.GetAckQualifier("a+", "_b"), "a++ack__b");
 }
 
+TEST(PartitionKeySelector, SelectRange) {
+    FLAGS_mock_rowlock_enable = true;
+    PartitionKeySelector selector;
+    std::string table_name;
+    std::string start_key;
+    std::string end_key;
+
+    // nothing observed
+    EXPECT_FALSE(selector.SelectRange(&table_name, &start_key, &end_key));
+    EXPECT_FALSE(selector.SelectStart(&table_name, &start_key));
+
+    std::vector<tera::TabletInfo> tablets(3);
+    tablets[0].start_key = "";
+    tablets[0].end_key = "b";
+    tablets[1].start_key = "b";
+    tablets[1].end_key = "c";
+    tablets[2].start_key = "c";
+    tablets[2].end_key = "";
+    (*selector.tables_)["t1"] = tablets;
+    (*selector.tables_)["t2"] = std::vector<tera::TabletInfo>(1, tablets[0]);
+    selector.observe_tables_.push_back("t1");
+    selector.observe_tables_.push_back("t2");
+
+    // every tablet once in a round, whatever the cursor starts from
+    std::set<std::string> ranges;
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(selector.SelectRange(&table_name, &start_key, &end_key));
+        ranges.insert(table_name + "/" + start_key + "/" + end_key);
+        selector.FinishRange(table_name, start_key);
+    }
+    EXPECT_EQ(ranges.size(), 4U);
+    EXPECT_TRUE(ranges.find("t1//b") != ranges.end());
+    EXPECT_TRUE(ranges.find("t1/b/c") != ranges.end());
+    EXPECT_TRUE(ranges.find("t1/c/") != ranges.end());
+    EXPECT_TRUE(ranges.find("t2//b") != ranges.end());
+}
+
+TEST(PartitionKeySelector, HoldRange) {
+    FLAGS_mock_rowlock_enable = true;
+    PartitionKeySelector selector;
+    std::string table_name;
+    std::string start_key;
+    std::string end_key;
+
+    std::vector<tera::TabletInfo> tablets(2);
+    tablets[0].start_key = "";
+    tablets[0].end_key = "b";
+    tablets[1].start_key = "b";
+    tablets[1].end_key = "";
+    (*selector.tables_)["t1"] = tablets;
+    selector.observe_tables_.push_back("t1");
+
+    // a tablet is leased to one worker of the process at a time
+    EXPECT_TRUE(selector.SelectRange(&table_name, &start_key, &end_key));
+    std::string start_key1;
+    EXPECT_TRUE(selector.SelectRange(&table_name, &start_key1, &end_key));
+    EXPECT_NE(start_key, start_key1);
+    std::string start_key2;
+    EXPECT_FALSE(selector.SelectRange(&table_name, &start_key2, &end_key));
+
+    // held, and renewed once a third of the lease has passed
+    EXPECT_TRUE(selector.HoldRange("t1", start_key));
+    PartitionKeySelector::TabletKey key("t1", start_key);
+    selector.leases_[key] -= FLAGS_observer_partition_lease_ms;
+    EXPECT_TRUE(selector.HoldRange("t1", start_key));
+    EXPECT_GT(selector.leases_[key], get_millis() - FLAGS_observer_partition_lease_ms / 3);
+
+    // released
+    selector.FinishRange("t1", start_key);
+    EXPECT_FALSE(selector.HoldRange("t1", start_key));
+    EXPECT_TRUE(selector.SelectRange(&table_name, &start_key2, &end_key));
+    EXPECT_EQ(start_key, start_key2);
+}
+
 } // namespace observer
 } // namespace tera
-
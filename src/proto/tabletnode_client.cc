@@ -87,6 +87,22 @@ bool TabletNodeClient::ComputeSplitKey(const SplitTabletRequest* request,
                                 rpc_timeout_, thread_pool_);
 }
 
+bool TabletNodeClient::GetHotBlocks(const GetHotBlocksRequest* request,
+                                    GetHotBlocksResponse* response,
+                                    std::function<void (GetHotBlocksRequest*, GetHotBlocksResponse*, bool, int)> done) {
+    return SendMessageWithRetry(&TabletNodeServer::Stub::GetHotBlocks,
+                                request, response, done, "GetHotBlocks",
+                                rpc_timeout_, thread_pool_);
+}
+
+bool TabletNodeClient::PrewarmTablet(const PrewarmTabletRequest* request,
+                                     PrewarmTabletResponse* response,
+                                     std::function<void (PrewarmTabletRequest*, PrewarmTabletResponse*, bool, int)> done) {
+    return SendMessageWithRetry(&TabletNodeServer::Stub::PrewarmTablet,
+                                request, response, done, "PrewarmTablet",
+                                rpc_timeout_, thread_pool_);
+}
+
 bool TabletNodeClient::CompactTablet(const CompactTabletRequest* request,
                                      CompactTabletResponse* response,
                                      std::function<void (CompactTabletRequest*, CompactTabletResponse*, bool, int)> done) {
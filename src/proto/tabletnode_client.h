@@ -60,6 +60,14 @@ public:
     bool ComputeSplitKey(const SplitTabletRequest* request, SplitTabletResponse* response, 
                      std::function<void (SplitTabletRequest*, SplitTabletResponse*, bool, int)> done = NULL);
 
+    bool GetHotBlocks(const GetHotBlocksRequest* request,
+                      GetHotBlocksResponse* response,
+                      std::function<void (GetHotBlocksRequest*, GetHotBlocksResponse*, bool, int)> done = NULL);
+
+    bool PrewarmTablet(const PrewarmTabletRequest* request,
+                       PrewarmTabletResponse* response,
+                       std::function<void (PrewarmTabletRequest*, PrewarmTabletResponse*, bool, int)> done = NULL);
+
     bool CompactTablet(const CompactTabletRequest* request,
                        CompactTabletResponse* response,
                        std::function<void (CompactTabletRequest*, CompactTabletResponse*, bool, int)> done = NULL);
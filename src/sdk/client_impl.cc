@@ -19,6 +19,7 @@
 #include "proto/tabletnode_client.h"
 #include "sdk/table_impl.h"
 #include "sdk/global_txn.h"
+#include "sdk/global_txn_committer.h"
 #include "sdk/sdk_perf.h"
 #include "sdk/sdk_utils.h"
 #include "sdk/sdk_zk.h"
@@ -53,6 +54,11 @@ DECLARE_int32(tera_gtxn_thread_max_num);
 DECLARE_bool(tera_sdk_client_for_gtxn);
 DECLARE_bool(tera_sdk_tso_client_enabled);
 DECLARE_bool(tera_sdk_mock_enable);
+DECLARE_bool(tera_gtxn_async_secondaries_enabled);
+DECLARE_int32(tera_gtxn_async_secondaries_thread_num);
+DECLARE_int64(tera_gtxn_async_secondaries_max_pending);
+DECLARE_int32(tera_gtxn_async_secondaries_retry_times);
+DECLARE_int32(tera_gtxn_async_secondaries_retry_period);
 
 namespace tera {
 
@@ -61,8 +67,11 @@ namespace {
         std::weak_ptr<ClientImpl> wp_client_impl;
         ThreadPool* client_thread_pool;
         ThreadPool* client_gtxn_thread_pool;
+        // outlives the global transactions committing in background
+        GlobalTxnCommitter* client_gtxn_committer;
         ClientResource() : client_thread_pool(NULL),
-                           client_gtxn_thread_pool(NULL) {}
+                           client_gtxn_thread_pool(NULL),
+                           client_gtxn_committer(NULL) {}
     };
     typedef std::map<std::string, std::unique_ptr<ClientResource>> ClusterClientMap;
     std::unique_ptr<ClusterClientMap> cluster_client_map;
@@ -83,12 +92,15 @@ namespace {
 
 ClientImpl::ClientImpl(const ClientOptions& client_options,
                        ThreadPool* client_thread_pool,
-                       ThreadPool* client_gtxn_thread_pool)
+                       ThreadPool* client_gtxn_thread_pool,
+                       GlobalTxnCommitter* gtxn_committer)
     : thread_pool_(client_thread_pool),
       gtxn_thread_pool_(client_gtxn_thread_pool),
       client_options_(client_options),
       client_zk_adapter_(NULL),
       tso_cluster_(NULL),
+      tso_client_(NULL),
+      gtxn_committer_(gtxn_committer),
       collecter_(NULL),
       session_str_("") {
     tabletnode::TabletNodeClient::SetRpcOption(
@@ -102,6 +114,7 @@ ClientImpl::ClientImpl(const ClientOptions& client_options,
         cluster_ = sdk::NewClusterFinder(client_zk_adapter_);
         if (FLAGS_tera_sdk_tso_client_enabled) {
             tso_cluster_ = sdk::NewTimeoracleClusterFinder();
+            tso_client_ = new timeoracle::TimeoracleClientImpl(gtxn_thread_pool_, tso_cluster_);
         }
         RegisterSelf();
     } else {
@@ -134,6 +147,7 @@ ClientImpl::~ClientImpl() {
     }
     if (FLAGS_tera_sdk_client_for_gtxn) {
         if (FLAGS_tera_sdk_tso_client_enabled) {
+            delete tso_client_;
             delete tso_cluster_;
         }
         delete client_zk_adapter_;
@@ -983,7 +997,8 @@ bool ClientImpl::ParseTabletEntry(const TabletMeta& meta, std::vector<TabletInfo
 }
 
 Transaction* ClientImpl::NewGlobalTransaction() {
-    return GlobalTxn::NewGlobalTxn(shared_from_this(), gtxn_thread_pool_, tso_cluster_);
+    return GlobalTxn::NewGlobalTxn(shared_from_this(), gtxn_thread_pool_, tso_client_,
+                                   gtxn_committer_);
 }
 
 bool ClientImpl::IsClientAlive(const std::string& path) {
@@ -1114,13 +1129,21 @@ Client* Client::NewClient(const string& confpath,
         client_resource->client_thread_pool = new ThreadPool(FLAGS_tera_sdk_thread_max_num);
         if (FLAGS_tera_sdk_client_for_gtxn) {
             client_resource->client_gtxn_thread_pool = new ThreadPool(FLAGS_tera_gtxn_thread_max_num);
+            if (FLAGS_tera_gtxn_async_secondaries_enabled) {
+                client_resource->client_gtxn_committer = new GlobalTxnCommitter(
+                    FLAGS_tera_gtxn_async_secondaries_thread_num,
+                    FLAGS_tera_gtxn_async_secondaries_max_pending,
+                    FLAGS_tera_gtxn_async_secondaries_retry_times,
+                    FLAGS_tera_gtxn_async_secondaries_retry_period);
+            }
         }
     } else {
         client_resource = std::move(it->second);
     }
 
     std::shared_ptr<ClientImpl> client(new ClientImpl(client_options,
-            client_resource->client_thread_pool, client_resource->client_gtxn_thread_pool));
+            client_resource->client_thread_pool, client_resource->client_gtxn_thread_pool,
+            client_resource->client_gtxn_committer));
     if (client) {
         client_resource->wp_client_impl = client;
         if (!client_existed) {
@@ -41,11 +41,13 @@ struct ClientOptions {
 };
 
 class TableImpl;
+class GlobalTxnCommitter;
 class ClientImpl : public Client, public std::enable_shared_from_this<ClientImpl> {
 public:
     explicit ClientImpl(const ClientOptions& client_option,
                         ThreadPool* sdk_thread_pool,
-                        ThreadPool* sdk_gtxn_thread_pool);
+                        ThreadPool* sdk_gtxn_thread_pool,
+                        GlobalTxnCommitter* gtxn_committer = NULL);
 
     virtual ~ClientImpl();
 
@@ -176,6 +178,11 @@ private:
     sdk::ClientZkAdapterBase* client_zk_adapter_;
     sdk::ClusterFinder* cluster_;
     sdk::ClusterFinder* tso_cluster_;
+    // shared by the global transactions of the client to coalesce
+    // their timestamp requests
+    timeoracle::TimeoracleClientImpl* tso_client_;
+    // commits secondaries of global transactions in background, not owned
+    GlobalTxnCommitter* gtxn_committer_;
     sdk::PerfCollecter* collecter_;
     std::string session_str_;
 
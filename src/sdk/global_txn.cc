@@ -44,25 +44,42 @@ extern tera::MetricCounter gtxn_acks_fail_cnt;
 extern tera::MetricCounter gtxn_notifies_cnt;
 extern tera::MetricCounter gtxn_notifies_fail_cnt;
 
+namespace {
+
+// users get TableWrapper, internal tables may be TableImpl, NULL if
+// "table" is neither
+TableImpl* GetTableImpl(Table* table) {
+    TableWrapper* wrapper = dynamic_cast<TableWrapper*>(table);
+    if (wrapper != NULL) {
+        return wrapper->GetTableImpl().get();
+    }
+    return dynamic_cast<TableImpl*>(table);
+}
+
+} // namespace
+
 Transaction* GlobalTxn::NewGlobalTxn(std::shared_ptr<tera::ClientImpl> client_impl, 
                                      common::ThreadPool* thread_pool,
-                                     sdk::ClusterFinder* tso_cluster) {
+                                     timeoracle::TimeoracleClientImpl* tso_client,
+                                     GlobalTxnCommitter* committer) {
     if (client_impl && thread_pool != NULL) {
             std::shared_ptr<GlobalTxn> global_txn_shared_ptr(
-                new GlobalTxn(client_impl, thread_pool, tso_cluster));
+                new GlobalTxn(client_impl, thread_pool, tso_client, committer));
             return new tera::TransactionWrapper<GlobalTxn>(global_txn_shared_ptr);
     }
-    LOG(ERROR) << "client_impl or tso_cluster is NULL";
+    LOG(ERROR) << "client_impl or thread_pool is NULL";
     return NULL;
 }
 
 GlobalTxn::GlobalTxn(std::shared_ptr<tera::ClientImpl> client_impl,
         common::ThreadPool* thread_pool,
-        sdk::ClusterFinder* tso_cluster) :
+        timeoracle::TimeoracleClientImpl* tso_client,
+        GlobalTxnCommitter* committer) :
     gtxn_internal_(new GlobalTxnInternal(client_impl)),
     status_returned_(false),
     primary_write_(NULL),
     writes_size_(0), 
+    primary_ctx_(NULL),
     commit_ts_(0),
     isolation_level_(IsolationLevel::kSnapshot),
     serialized_primary_(""),
@@ -72,7 +89,8 @@ GlobalTxn::GlobalTxn(std::shared_ptr<tera::ClientImpl> client_impl,
     user_commit_callback_(NULL),
     user_commit_context_(NULL),
     thread_pool_(thread_pool),
-    tso_cluster_(tso_cluster),
+    tso_client_(tso_client),
+    committer_(committer),
     commit_timeout_ms_(FLAGS_tera_gtxn_commit_timeout_ms),
     ttl_timestamp_ms_(FLAGS_tera_gtxn_timeout_ms + get_millis()),
     all_task_pushed_(false) {
@@ -82,8 +100,7 @@ GlobalTxn::GlobalTxn(std::shared_ptr<tera::ClientImpl> client_impl,
     } else if (!FLAGS_tera_sdk_tso_client_enabled) {
         start_ts_ = get_micros();
     } else {
-        timeoracle::TimeoracleClientImpl tsoc(thread_pool_, tso_cluster_); 
-        start_ts_ = tsoc.GetTimestamp(1);
+        start_ts_ = tso_client_->GetTimestamp(1);
         if (start_ts_ == 0) {
             status_.SetFailed(ErrorCode::kGTxnTimestampLost);
             status_returned_ = true;
@@ -578,6 +595,13 @@ ErrorCode GlobalTxn::Commit() {
         RunUserCallback();
         return status;
     }
+    if (!CheckTables(&status)) {
+        LOG(ERROR) << "[gtxn][commit][" << start_ts_ << "] " << status.ToString();
+        SetLastStatus(&status);
+        // Callback Point : unknown table type
+        RunUserCallback();
+        return status;
+    }
     thread_pool_->AddTask(std::bind(&GlobalTxn::InternalCommit, this));
 
     if (user_commit_callback_ == NULL) {
@@ -603,8 +627,7 @@ void GlobalTxn::InternalCommit() {
         } else if (!FLAGS_tera_sdk_tso_client_enabled) {
             start_ts_ = get_micros();
         } else {
-            timeoracle::TimeoracleClientImpl tsoc(thread_pool_, tso_cluster_); 
-            prewrite_start_ts_ = tsoc.GetTimestamp(1);
+            prewrite_start_ts_ = tso_client_->GetTimestamp(1);
         }
         if (prewrite_start_ts_ < start_ts_) {
             ErrorCode status;
@@ -620,12 +643,11 @@ void GlobalTxn::InternalCommit() {
     gtxn_internal_->PerfPrewriteDelay(get_micros(), 0); // begin_time
     gtxn_prewrite_cnt.Inc();
 
-    prewrite_iterator_ = writes_.begin();
-    primary_write_ = &(prewrite_iterator_->second[0]);
+    primary_write_ = &(writes_.begin()->second[0]);
     primary_write_->Serialize(prewrite_start_ts_, 
                               gtxn_internal_->GetClientSession(), 
                               &serialized_primary_);
-    AsyncPrewrite(&prewrite_iterator_->second);
+    AsyncPrewrite(&writes_.begin()->second);
 }
 
 // [prewrite] Step(1): 
@@ -716,8 +738,9 @@ void GlobalTxn::DoPrewriteReaderCallback(RowReader* r) {
 }
 
 // prewrite Step(3):
-//      verify [prewrite] step(2) single_row_txn commit status,
-//      if the last prewrite callback and status ok, will call [commit]
+//      verify [prewrite] step(2) single_row_txn commit status of primary,
+//      if status ok, will call [VerifyPrimaryLocked] and
+//      [PrewriteSecondaries] at the same time
 //
 // call by [prewrite] step(2), through single_row_txn commit callback
 //      
@@ -734,35 +757,189 @@ void GlobalTxn::DoPrewriteCallback(Transaction* single_row_txn) {
         }
         VLOG(12) << "[gtxn][prewrite][stxn_commit] failed : " << ctx->DebugString();
         RunAfterPrewriteFailed(ctx);
-    } else if (++prewrite_iterator_ != writes_.end()) {
-        thread_pool_->AddTask(std::bind(&GlobalTxn::AsyncPrewrite, this, &(prewrite_iterator_->second)));
-        delete ctx;
     } else {
-        gtxn_internal_->PerfPrewriteDelay(0, get_micros()); // finish_time
-        VLOG(12) << "prewrite done, next step";
-        InternalCommitPhase2();
         delete ctx;
+        // the primary "lock" is verified while secondaries are prewritten,
+        // the single_row_txn of primary will fail to commit if the "lock"
+        // is changed after verified
+        prewrite_stage_pending_cnt_.Set(2);
+        VerifyPrimaryLocked();
+        PrewriteSecondaries();
     }
 }
 
 void GlobalTxn::RunAfterPrewriteFailed(PrewriteContext* ctx) {
+    ErrorCode status = ctx->status;
+    delete ctx;
+    RunAfterPrewriteFailed(&status);
+}
+
+void GlobalTxn::RunAfterPrewriteFailed(ErrorCode* status) {
     gtxn_internal_->PerfPrewriteDelay(0, get_micros()); // finish_time
     gtxn_prewrite_fail_cnt.Inc();
-    if (gtxn_internal_->IsTimeOut() || ctx->status.GetType() == ErrorCode::kTimeout) {
-        ctx->status.SetFailed(ErrorCode::kGTxnPrewriteTimeout, ctx->status.ToString()); 
+    if (gtxn_internal_->IsTimeOut() || status->GetType() == ErrorCode::kTimeout) {
+        status->SetFailed(ErrorCode::kGTxnPrewriteTimeout, status->ToString()); 
     }
-    SetLastStatus(&ctx->status);
-    delete ctx;
+    SetLastStatus(status);
     RunUserCallback();
 }
 
+void GlobalTxn::PrewriteSecondaries() {
+    std::vector<Transaction*> single_row_txns;
+    std::vector<RowReader*> readers;
+    for (auto it = ++writes_.begin(); it != writes_.end(); ++it) {
+        std::vector<Write>* ws = &(it->second);
+        Write w = *(ws->begin());
+        Table* table = w.Table();
+        Transaction* single_row_txn = table->StartRowTransaction(w.RowKey());
+        RowReader* reader = table->NewRowReader(w.RowKey());
+        gtxn_internal_->SetInternalSdkTaskTimeout(reader);
+        gtxn_internal_->BuildRowReaderForPrewrite(*ws, reader);
+        reader->SetCallBack([](RowReader* r){
+            GlobalTxn* gtxn = static_cast<GlobalTxn*>(((PrewriteContext*)r->GetContext())->gtxn);
+            gtxn->thread_pool_->AddTask(
+                std::bind(&GlobalTxn::DoPrewriteSecondaryReaderCallback, gtxn, r));
+        });
+        PrewriteContext* ctx = new PrewriteContext(ws, this, single_row_txn, w.TableName(), w.RowKey());
+        reader->SetContext(ctx);
+        secondary_prewrites_.push_back(ctx);
+        single_row_txns.push_back(single_row_txn);
+        readers.push_back(reader);
+    }
+    if (secondary_prewrites_.empty()) {
+        FinishPrewriteStage();
+        return;
+    }
+    if (gtxn_internal_->IsTimeOut()) {
+        VLOG(12) << "[gtxn][prewrite][secondaries] ignored : " << start_ts_;
+        for (size_t i = 0; i < readers.size(); ++i) {
+            delete readers[i];
+        }
+        CleanupSecondaryPrewrites();
+        prewrite_status_.SetFailed(ErrorCode::kGTxnPrewriteTimeout,
+                                   "global transaction prewrite timeout");
+        FinishPrewriteStage();
+        return;
+    }
+    secondary_pending_cnt_.Set(secondary_prewrites_.size());
+    VLOG(12) << "[gtxn][prewrite][secondaries][stxn_read] invoked : " 
+             << secondary_prewrites_.size() << " rows";
+    SingleRowTxn::BatchGet(single_row_txns, readers);
+}
+
+void GlobalTxn::DoPrewriteSecondaryReaderCallback(RowReader* r) {
+    std::unique_ptr<RowReaderImpl> reader(static_cast<RowReaderImpl*>(r));
+    PrewriteContext* ctx = (PrewriteContext*)reader->GetContext();
+    if (reader->GetError().GetType() != ErrorCode::kNotFound
+        && reader->GetError().GetType() != ErrorCode::kOK) {
+        ctx->status = reader->GetError();
+        VLOG(12) << "[gtxn][prewrite][stxn_read] failed : " << ctx->status.ToString();
+    } else if (gtxn_internal_->ConflictWithOtherWrite(ctx->ws, reader, &(ctx->status))) {
+        VLOG(12) << "[gtxn][prewrite][stxn_read] failed : " << ctx->status.ToString();
+    } else {
+        VLOG(12) << "[gtxn][prewrite][stxn_read] succeed, table=" << ctx->DebugString();
+        RowMutation* prewrite_mu = reader->GetTable()->NewRowMutation(reader->RowKey());
+        gtxn_internal_->SetInternalSdkTaskTimeout(prewrite_mu);
+        gtxn_internal_->BuildRowMutationForPrewrite(ctx->ws, prewrite_mu, 
+                                                    serialized_primary_);
+        ctx->stxn->ApplyMutation(prewrite_mu);
+        delete prewrite_mu;
+    }
+    reader.reset();
+    if (secondary_pending_cnt_.Dec() > 0) {
+        return;
+    }
+
+    // all rows are read, lock them only if none of them fails
+    ErrorCode status;
+    for (size_t i = 0; i < secondary_prewrites_.size(); ++i) {
+        if (secondary_prewrites_[i]->status.GetType() != ErrorCode::kOK) {
+            status = secondary_prewrites_[i]->status;
+            break;
+        }
+    }
+    if (status.GetType() == ErrorCode::kOK && gtxn_internal_->IsTimeOut()) {
+        status.SetFailed(ErrorCode::kGTxnPrewriteTimeout, "global transaction prewrite timeout");
+    }
+    if (status.GetType() != ErrorCode::kOK) {
+        CleanupSecondaryPrewrites();
+        prewrite_status_ = status;
+        FinishPrewriteStage();
+        return;
+    }
+
+    std::vector<Transaction*> single_row_txns;
+    for (size_t i = 0; i < secondary_prewrites_.size(); ++i) {
+        Transaction* single_row_txn = secondary_prewrites_[i]->stxn;
+        single_row_txn->SetContext(secondary_prewrites_[i]);
+        single_row_txn->SetCommitCallback([](Transaction* single_txn) {
+            GlobalTxn* gtxn = static_cast<GlobalTxn*>(((PrewriteContext*)single_txn->GetContext())->gtxn);
+            gtxn->thread_pool_->AddTask(
+                std::bind(&GlobalTxn::DoPrewriteSecondaryCallback, gtxn, single_txn));
+        });
+        single_row_txns.push_back(single_row_txn);
+    }
+    secondary_pending_cnt_.Set(single_row_txns.size());
+    VLOG(12) << "[gtxn][prewrite][secondaries][stxn_commit] invoked : " 
+             << single_row_txns.size() << " rows";
+    SingleRowTxn::BatchCommit(single_row_txns);
+}
+
+void GlobalTxn::DoPrewriteSecondaryCallback(Transaction* single_row_txn) {
+    ErrorCode status = single_row_txn->GetError();
+    PrewriteContext* ctx = (PrewriteContext*)single_row_txn->GetContext();
+    if (status.GetType() != ErrorCode::kOK) {
+        ctx->status.SetFailed(status.GetType(), status.ToString());
+        VLOG(12) << "[gtxn][prewrite][stxn_commit] failed : " << ctx->DebugString();
+    }
+    if (secondary_pending_cnt_.Dec() > 0) {
+        return;
+    }
+    prewrite_status_ = CleanupSecondaryPrewrites();
+    FinishPrewriteStage();
+}
+
+ErrorCode GlobalTxn::CleanupSecondaryPrewrites() {
+    ErrorCode status;
+    for (size_t i = 0; i < secondary_prewrites_.size(); ++i) {
+        PrewriteContext* ctx = secondary_prewrites_[i];
+        if (status.GetType() == ErrorCode::kOK) {
+            status = ctx->status;
+        }
+        delete ctx->stxn;
+        delete ctx;
+    }
+    secondary_prewrites_.clear();
+    return status;
+}
+
+void GlobalTxn::FinishPrewriteStage() {
+    if (prewrite_stage_pending_cnt_.Dec() > 0) {
+        return;
+    }
+    if (prewrite_status_.GetType() != ErrorCode::kOK) {
+        VLOG(12) << "[gtxn][prewrite][secondaries] failed : " << prewrite_status_.ToString();
+        if (primary_ctx_ != NULL) {
+            delete primary_ctx_->stxn;
+            delete primary_ctx_;
+            primary_ctx_ = NULL;
+        }
+        ErrorCode status = prewrite_status_;
+        RunAfterPrewriteFailed(&status);
+        return;
+    }
+    gtxn_internal_->PerfPrewriteDelay(0, get_micros()); // finish_time
+    VLOG(12) << "prewrite done, next step";
+    InternalCommitPhase2();
+}
+
 // commit phase2 Step(1):
 //      a) get timestamp from timeoracle for commit_ts
-//      b) sync commit primary write through single_row_txn
-//         (for this gtxn, on this step only one thread can work)
-//      c) loop call [commit phase2] step(2)
+//      b) commit primary write through the single_row_txn which has
+//         verified the primary "lock"
+//      c) commit all secondaries, acks and notifies in batch
 //
-// call by [prewrite] step(3)
+// call by [FinishPrewriteStage]
 void GlobalTxn::InternalCommitPhase2() {
     gtxn_internal_->PerfPrimaryCommitDelay(get_micros(), 0); // begin_time
     gtxn_primary_cnt.Inc();
@@ -776,12 +953,21 @@ void GlobalTxn::InternalCommitPhase2() {
     } else if (!FLAGS_tera_sdk_tso_client_enabled) {
         commit_ts_ = get_micros();
     } else {
-        timeoracle::TimeoracleClientImpl tsoc(thread_pool_, tso_cluster_); 
-        commit_ts_ = tsoc.GetTimestamp(1);
+        commit_ts_ = tso_client_->GetTimestamp(1);
     }
     if (commit_ts_ < prewrite_start_ts_) {
         LOG(ERROR) << "[gtxn][commit] get commit ts failed";
         status.SetFailed(ErrorCode::kGTxnTimestampLost, "get commit ts failed");
+    } else if (primary_ctx_ == NULL) {
+        // primary "lock" verify failed
+        status = primary_status_;
+    }
+    if (status.GetType() != ErrorCode::kOK) {
+        if (primary_ctx_ != NULL) {
+            delete primary_ctx_->stxn;
+            delete primary_ctx_;
+            primary_ctx_ = NULL;
+        }
         SetLastStatus(&status);
         gtxn_internal_->PerfPrimaryCommitDelay(0, get_micros());
         gtxn_primary_fail_cnt.Inc();
@@ -793,7 +979,10 @@ void GlobalTxn::InternalCommitPhase2() {
     gtxn_internal_->TEST_Sleep(); // wait to begin primary commit
     
     /// begin to commit primary
-    VerifyPrimaryLocked();
+    PrimaryTxnContext* ctx = primary_ctx_;
+    primary_ctx_ = NULL;
+    ctx->stxn->SetContext(ctx);
+    CommitPrimary(ctx->stxn);
 }
 
 void GlobalTxn::VerifyPrimaryLocked() {
@@ -816,25 +1005,23 @@ void GlobalTxn::VerifyPrimaryLocked() {
 void GlobalTxn::DoVerifyPrimaryLockedCallback(RowReader* reader) {
     ErrorCode status = reader->GetError();
     PrimaryTxnContext* ctx = (PrimaryTxnContext*)reader->GetContext();
-    Transaction* pri_txn = ctx->stxn;
     delete reader;
 
-    if (status.GetType() == ErrorCode::kOK) {
-        pri_txn->SetContext(ctx);
-        CommitPrimary(pri_txn);
-    } else {
-        delete pri_txn;
+    if (status.GetType() != ErrorCode::kOK) {
+        delete ctx->stxn;
         delete ctx;
+        ctx = NULL;
         if (status.GetType() == ErrorCode::kNotFound) {
             status.SetFailed(ErrorCode::kGTxnPrimaryLost, "primary 'lock' lost before commit");
         } else if (status.GetType() == ErrorCode::kTimeout) {
             status.SetFailed(ErrorCode::kGTxnPrimaryCommitTimeout, status.ToString()); 
         }
-        SetLastStatus(&status);
-        gtxn_primary_fail_cnt.Inc();
-        gtxn_internal_->PerfPrimaryCommitDelay(0, get_micros()); // finish_time
-        RunUserCallback();
+        VLOG(12) << "[gtxn][commit] verify primary failed :[" << status.ToString() << "]";
     }
+    // commit primary after all secondaries are prewritten
+    primary_ctx_ = ctx;
+    primary_status_ = status;
+    FinishPrewriteStage();
 }
 
 void GlobalTxn::CommitPrimary(Transaction* pri_txn) {
@@ -889,22 +1076,25 @@ void GlobalTxn::CheckPrimaryStatusAndCommmitSecondaries(Transaction* pri_txn) {
     }
 
     all_task_pushed_ = false;
+    MutationBatch batch;
     /// begin commit secondaries
     for (auto &same_row_writes : writes_) {
-        thread_pool_->AddTask(std::bind(&GlobalTxn::AsyncCommitSecondaries, 
-                                       this, &(same_row_writes.second)));
+        AsyncCommitSecondaries(&(same_row_writes.second), &batch);
+    }
+    if (committer_ != NULL && CommitSecondariesInBackground(&batch)) {
+        // readers roll the secondaries forward if they are not committed yet
+        VLOG(12) << "[gtxn][commit][secondaries] in background :[" << start_ts_ << "]";
     }
 
     /// begin ack
     for (auto &same_row_acks : acks_) {
-        thread_pool_->AddTask(std::bind(&GlobalTxn::AsyncAck, 
-                                       this, &(same_row_acks.second)));
+        AsyncAck(&(same_row_acks.second), &batch);
     }
     /// begin notify
     for (auto &same_row_notifies : notifies_) {
-        thread_pool_->AddTask(std::bind(&GlobalTxn::AsyncNotify, 
-                                       this, &(same_row_notifies.second)));
+        AsyncNotify(&(same_row_notifies.second), &batch);
     }
+    ApplyMutationBatch(&batch);
     bool should_callback = false;
     {
         MutexLock lock(&mu_);
@@ -920,7 +1110,7 @@ void GlobalTxn::CheckPrimaryStatusAndCommmitSecondaries(Transaction* pri_txn) {
 
 }
 
-void GlobalTxn::AsyncAck(std::vector<Write>* ws) {
+void GlobalTxn::AsyncAck(std::vector<Write>* ws, MutationBatch* batch) {
     gtxn_internal_->PerfAckDelay(get_micros(), 0);
     gtxn_acks_cnt.Inc();
     assert(ws->size() > 0);
@@ -932,7 +1122,7 @@ void GlobalTxn::AsyncAck(std::vector<Write>* ws) {
     mu->SetCallBack([](RowMutation* row_mu) {
             ((GlobalTxn*)row_mu->GetContext())->DoAckCallback(row_mu);});
     mu->SetContext(this);
-    table->ApplyMutation(mu);
+    (*batch)[table].push_back(mu);
 }
 
 void GlobalTxn::DoAckCallback(RowMutation* mutation) {
@@ -960,7 +1150,7 @@ void GlobalTxn::DoAckCallback(RowMutation* mutation) {
     }
 }
 
-void GlobalTxn::AsyncNotify(std::vector<Write>* ws) {
+void GlobalTxn::AsyncNotify(std::vector<Write>* ws, MutationBatch* batch) {
     gtxn_internal_->PerfNotifyDelay(get_micros(), 0);
     gtxn_notifies_cnt.Inc();
     assert(ws->size() > 0);
@@ -972,7 +1162,7 @@ void GlobalTxn::AsyncNotify(std::vector<Write>* ws) {
     mu->SetCallBack([](RowMutation* row_mu) {
             ((GlobalTxn*)row_mu->GetContext())->DoNotifyCallback(row_mu);});
     mu->SetContext(this);
-    table->ApplyMutation(mu);
+    (*batch)[table].push_back(mu);
 }
 
 void GlobalTxn::DoNotifyCallback(RowMutation* mutation) {
@@ -1002,7 +1192,7 @@ void GlobalTxn::DoNotifyCallback(RowMutation* mutation) {
     }
 }
 
-void GlobalTxn::AsyncCommitSecondaries(std::vector<Write>* ws) {
+void GlobalTxn::AsyncCommitSecondaries(std::vector<Write>* ws, MutationBatch* batch) {
     gtxn_internal_->PerfSecondariesCommitDelay(get_micros(), 0); // begin time
     gtxn_secondaries_cnt.Inc();
     assert(ws->size() > 0);
@@ -1014,7 +1204,52 @@ void GlobalTxn::AsyncCommitSecondaries(std::vector<Write>* ws) {
     mu->SetCallBack([](RowMutation* row_mu) {
             ((GlobalTxn*)row_mu->GetContext())->DoCommitSecondariesCallback(row_mu);});
     mu->SetContext(this);
-    table->ApplyMutation(mu);
+    (*batch)[table].push_back(mu);
+}
+
+bool GlobalTxn::CheckTables(ErrorCode* status) {
+    {
+        MutexLock lock(&mu_);
+        if (notify_index_status_.GetType() != ErrorCode::kOK) {
+            *status = notify_index_status_;
+            return false;
+        }
+    }
+    const WriterMap* maps[] = {&writes_, &acks_, &notifies_};
+    for (size_t i = 0; i < sizeof(maps) / sizeof(maps[0]); ++i) {
+        for (auto it = maps[i]->begin(); it != maps[i]->end(); ++it) {
+            Table* table = it->second.begin()->Table();
+            if (GetTableImpl(table) == NULL) {
+                status->SetFailed(ErrorCode::kBadParam,
+                                  "table type not supported by global transaction: "
+                                  + table->GetName());
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void GlobalTxn::ApplyMutationBatch(MutationBatch* batch) {
+    for (auto it = batch->begin(); it != batch->end(); ++it) {
+        GetTableImpl(it->first)->ApplyMutation(it->second, true);
+    }
+    batch->clear();
+}
+
+bool GlobalTxn::CommitSecondariesInBackground(MutationBatch* batch) {
+    std::vector<RowMutation*> mutations;
+    for (auto it = batch->begin(); it != batch->end(); ++it) {
+        mutations.insert(mutations.end(), it->second.begin(), it->second.end());
+    }
+    if (!committer_->AsyncCommit(mutations)) {
+        return false;
+    }
+    batch->clear();
+    MutexLock lock(&mu_);
+    commit_secondaries_done_cnt_.Set(writes_cnt_.Get());
+    gtxn_internal_->PerfSecondariesCommitDelay(0, get_micros()); // finish time
+    return true;
 }
 
 void GlobalTxn::DoCommitSecondariesCallback(RowMutation* mutation) {
@@ -1117,20 +1352,16 @@ void GlobalTxn::Ack(Table* t,
         LOG(ERROR) << "set ack cell failed";
         return;
     }
-    const std::string& tablename = t->GetName();
     Cell cell(t, row_key, column_family, qualifier);
-    Write w(cell);
-    TableWithRowkey twr(tablename, row_key);
+    // an index entry left by a failed ack is dropped by the scanner
+    ErrorCode err;
+    TableImpl* index_table = GetNotifyIndexTable(t, &err);
     MutexLock lock(&mu_);
-    auto it = acks_.find(twr);
-    if (it != acks_.end()) {
-        std::vector<Write>* acks_ptr = &(acks_[twr]);
-        acks_ptr->push_back(w);
-    } else {
-        std::vector<Write> acks;
-        acks.push_back(w);   
-        acks_[twr] = acks; 
-        acks_cnt_.Inc();
+    AddWrite(cell, &acks_, &acks_cnt_);
+    if (index_table != NULL) {
+        // remove the index entry together with the notification
+        Cell index_cell(index_table, PackNotifyIndexRow(row_key), column_family, qualifier);
+        AddWrite(index_cell, &acks_, &acks_cnt_);
     }
 }
 
@@ -1142,20 +1373,34 @@ void GlobalTxn::Notify(Table* t,
         LOG(ERROR) << "set ack cell failed";
         return;
     }
-    const std::string& tablename = t->GetName();
     Cell cell(t, row_key, column_family, qualifier);
-    Write w(cell);
-    TableWithRowkey twr(tablename, row_key);
+    ErrorCode err;
+    TableImpl* index_table = GetNotifyIndexTable(t, &err);
     MutexLock lock(&mu_);
-    auto it = notifies_.find(twr);
-    if (it != notifies_.end()) {
-        std::vector<Write>* notifies_ptr = &(notifies_[twr]);
-        notifies_ptr->push_back(w);
+    if (err.GetType() != ErrorCode::kOK) {
+        LOG(ERROR) << "[gtxn] fail to open the notify index of " << t->GetName()
+                   << ", " << err.ToString();
+        notify_index_status_ = err;
+        return;
+    }
+    AddWrite(cell, &notifies_, &notifies_cnt_);
+    if (index_table != NULL) {
+        // the index entry is sent with the notification in the same batch,
+        // a failure of either is reported as notify failed
+        Cell index_cell(index_table, PackNotifyIndexRow(row_key), column_family, qualifier);
+        AddWrite(index_cell, &notifies_, &notifies_cnt_);
+    }
+}
+
+void GlobalTxn::AddWrite(const Cell& cell, WriterMap* writes, Counter* row_cnt) {
+    mu_.AssertHeld();
+    TableWithRowkey twr(cell.TableName(), cell.RowKey());
+    auto it = writes->find(twr);
+    if (it != writes->end()) {
+        it->second.push_back(Write(cell));
     } else {
-        std::vector<Write> notifies;
-        notifies.push_back(w);   
-        notifies_[twr] = notifies; 
-        notifies_cnt_.Inc();
+        (*writes)[twr].push_back(Write(cell));
+        row_cnt->Inc();
     }
 }
 
@@ -11,15 +11,18 @@
 #include <string>
 #include <set>
 #include <utility> 
+#include <vector>
 
 #include "common/mutex.h"
 #include "io/coding.h"
 #include "proto/table_meta.pb.h"
+#include "sdk/global_txn_committer.h"
 #include "sdk/global_txn_internal.h"
 #include "sdk/single_row_txn.h"
 #include "sdk/sdk_utils.h"
 #include "sdk/table_impl.h"
 #include "sdk/sdk_zk.h"
+#include "sdk/timeoracle_client_impl.h"
 #include "tera.h"
 #include "common/counter.h"
 #include "common/timer.h"
@@ -36,9 +39,12 @@ class PrimaryTxnContext;
 
 class GlobalTxn : public Transaction {
 public:
+    // with "committer", the secondaries are committed in background
+    // once the primary is committed
     static Transaction* NewGlobalTxn(std::shared_ptr<tera::ClientImpl> client_impl, 
             common::ThreadPool* thread_pool, 
-            sdk::ClusterFinder* tso_cluster);
+            timeoracle::TimeoracleClientImpl* tso_client,
+            GlobalTxnCommitter* committer = NULL);
 
     virtual ~GlobalTxn();
 
@@ -151,22 +157,40 @@ private:
     void DoPrewriteReaderCallback(RowReader* reader);
 
     // prewrite Step(3):
-    //      verify [prewrite] step(2) single_row_txn commit status,
-    //      if the last prewrite callback and status ok, will call [commit]
+    //      verify [prewrite] step(2) single_row_txn commit status of primary,
+    //      if status ok, will call [VerifyPrimaryLocked] and
+    //      [PrewriteSecondaries] at the same time
     //
     // call by [prewrite] step(2), through single_row_txn commit callback
     void DoPrewriteCallback(Transaction* single_row_txn);
     void RunAfterPrewriteFailed(PrewriteContext* ctx);
+    void RunAfterPrewriteFailed(ErrorCode* status);
+
+    // [prewrite] secondaries:
+    //      read all secondary rows, then write their "lock" and "data"
+    //      columns, in one request per tabletnode for each step
+    //
+    // no secondary row is locked if any read of them fails or conflicts
+    void PrewriteSecondaries();
+    void DoPrewriteSecondaryReaderCallback(RowReader* reader);
+    void DoPrewriteSecondaryCallback(Transaction* single_row_txn);
+    // delete the contexts and single_row_txns of secondaries,
+    // return the first failed status
+    ErrorCode CleanupSecondaryPrewrites();
+
+    // [VerifyPrimaryLocked] and [PrewriteSecondaries] both call it when done,
+    // the last one will call [commit phase2]
+    void FinishPrewriteStage();
 
     // --------------------- begin commit phase2 ---------------------- //
     
     // commit phase2 Step(1):
     //      a) get timestamp from timeoracle for commit_ts
-    //      b) sync commit primary write through single_row_txn
-    //         (for this gtxn, on this step only one thread can work)
-    //      c) call [commit phase2] step(2) in a loop
+    //      b) commit primary write through the single_row_txn which has
+    //         verified the primary "lock"
+    //      c) commit all secondaries, acks and notifies in batch
     //
-    // call by [prewrite] step(3)
+    // call by [FinishPrewriteStage]
     void InternalCommitPhase2(); 
 
     void VerifyPrimaryLocked();
@@ -177,30 +201,45 @@ private:
 
     void CheckPrimaryStatusAndCommmitSecondaries(Transaction* primary_single_txn);
 
+    // <table, mutations of the table>, to send in one request per tabletnode
+    typedef std::map<Table*, std::vector<RowMutation*>> MutationBatch;
+
     // commit phase2 Step(2):
-    //      async commit secondaries writes through RowMutaion
+    //      build the RowMutaion to commit secondaries writes into "batch"
     //
     // call by [commit phase2] step(1)
-    void AsyncCommitSecondaries(std::vector<Write>* same_row_writes);
+    void AsyncCommitSecondaries(std::vector<Write>* same_row_writes, MutationBatch* batch);
     
     void DoCommitSecondariesCallback(RowMutation* mutation);
 
     // commit phase2 Step(3):
-    //      async do ack through RowMutaion
+    //      build the RowMutaion to do ack into "batch"
     //
     // call by [commit phase2] step(1)
-    void AsyncAck(std::vector<Write>* same_row_acks);
+    void AsyncAck(std::vector<Write>* same_row_acks, MutationBatch* batch);
     
     void DoAckCallback(RowMutation* mutation);
 
     // commit phase2 Step(4):
-    //      async do notify through RowMutaion
+    //      build the RowMutaion to do notify into "batch"
     //
     // call by [commit phase2] step(1)
-    void AsyncNotify(std::vector<Write>* same_row_notifies);
+    void AsyncNotify(std::vector<Write>* same_row_notifies, MutationBatch* batch);
     
     void DoNotifyCallback(RowMutation* mutation);
 
+    // mutations of commit phase2 are sent through TableImpl, so fail the
+    // txn before prewrite if any table is of another type, or if a notify
+    // could not be indexed
+    bool CheckTables(ErrorCode* status);
+
+    // send all mutations in "batch" at once, async
+    void ApplyMutationBatch(MutationBatch* batch);
+
+    // hand the secondaries commit mutations in "batch" over to committer_,
+    // false if it is too busy to take them
+    bool CommitSecondariesInBackground(MutationBatch* batch);
+
     /// if user want to delete this transaction, 
     /// before any async tasks of this transaction finished for failed
     void WaitForComplete();
@@ -213,7 +252,8 @@ private:
 private:
     GlobalTxn(std::shared_ptr<tera::ClientImpl> client_impl, 
               common::ThreadPool* thread_pool, 
-              sdk::ClusterFinder* tso_cluster);
+              timeoracle::TimeoracleClientImpl* tso_client,
+              GlobalTxnCommitter* committer = NULL);
 
     GlobalTxn(const GlobalTxn&) = delete;
     void operator=(const GlobalTxn&) = delete;    
@@ -223,14 +263,27 @@ private:
     // tableWithRowkey -> set(write)
     typedef std::map<TableWithRowkey, std::vector<Write>> WriterMap;
 
+    // add "cell" into "writes", "row_cnt" counts the rows of "writes"
+    // REQUIRES: mu_ is held
+    void AddWrite(const Cell& cell, WriterMap* writes, Counter* row_cnt);
+
     std::unique_ptr<GlobalTxnInternal> gtxn_internal_;
     ErrorCode status_;
     bool status_returned_; // if true gtxn will not change "status_"
     
     Write* primary_write_;
     WriterMap writes_;
-    WriterMap::iterator prewrite_iterator_;
     int64_t writes_size_;
+
+    // prewrite of secondaries
+    std::vector<PrewriteContext*> secondary_prewrites_;
+    Counter secondary_pending_cnt_;
+    // [VerifyPrimaryLocked] and [PrewriteSecondaries] not finished
+    Counter prewrite_stage_pending_cnt_;
+    ErrorCode prewrite_status_;
+    // the verified primary single_row_txn, NULL if verify failed
+    PrimaryTxnContext* primary_ctx_;
+    ErrorCode primary_status_;
     
     int64_t start_ts_;
     int64_t prewrite_start_ts_;
@@ -240,6 +293,8 @@ private:
 
     WriterMap acks_;
     WriterMap notifies_;
+    // the notification index of a notified table could not be opened
+    ErrorCode notify_index_status_;
     
     mutable Mutex mu_;
     std::atomic<bool> finish_;
@@ -252,7 +307,8 @@ private:
     void* user_commit_context_;
 
     common::ThreadPool* thread_pool_;
-    sdk::ClusterFinder* tso_cluster_;
+    timeoracle::TimeoracleClientImpl* tso_client_;
+    GlobalTxnCommitter* committer_;
 
     int64_t commit_timeout_ms_;
     int64_t ttl_timestamp_ms_;
@@ -0,0 +1,135 @@
+// Copyright (c) 2015-2017, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sdk/global_txn_committer.h"
+
+#include <functional>
+#include <map>
+
+#include "glog/logging.h"
+
+#include "common/metric/metric_counter.h"
+#include "common/this_thread.h"
+#include "sdk/mutate_impl.h"
+#include "sdk/table_impl.h"
+
+namespace tera {
+
+extern tera::MetricCounter gtxn_async_secondaries_pending_cnt;
+extern tera::MetricCounter gtxn_async_secondaries_retry_cnt;
+extern tera::MetricCounter gtxn_async_secondaries_drop_cnt;
+
+GlobalTxnCommitter::GlobalTxnCommitter(int32_t thread_num,
+                                       int64_t max_pending_num,
+                                       int32_t max_retry_times,
+                                       int64_t retry_period_ms)
+    : max_pending_num_(max_pending_num),
+      max_retry_times_(max_retry_times),
+      retry_period_ms_(retry_period_ms),
+      stop_(false),
+      thread_pool_(new common::ThreadPool(thread_num)) {
+}
+
+GlobalTxnCommitter::~GlobalTxnCommitter() {
+    // no more retry, wait for the mutations in flight
+    stop_ = true;
+    while (pending_num_.Get() > 0) {
+        ThisThread::Sleep(10);
+    }
+    thread_pool_.reset();
+}
+
+bool GlobalTxnCommitter::AsyncCommit(const std::vector<RowMutation*>& mutations) {
+    int64_t num = mutations.size();
+    if (num == 0) {
+        return true;
+    }
+    if (stop_) {
+        return false;
+    }
+    if (pending_num_.Add(num) > max_pending_num_) {
+        pending_num_.Sub(num);
+        VLOG(12) << "[gtxn][commit][async] too many secondaries pending, "
+                 << pending_num_.Get();
+        return false;
+    }
+    gtxn_async_secondaries_pending_cnt.Add(num);
+
+    std::vector<Task*> tasks;
+    tasks.reserve(num);
+    for (size_t i = 0; i < mutations.size(); ++i) {
+        Task* task = new Task;
+        task->committer = this;
+        task->mutation = static_cast<RowMutationImpl*>(mutations[i]);
+        task->table = static_cast<TableImpl*>(task->mutation->GetTable())->shared_from_this();
+        task->retry_times = 0;
+        task->mutation->SetCallBack(&GlobalTxnCommitter::MutationCallback);
+        task->mutation->SetContext(task);
+        tasks.push_back(task);
+    }
+    thread_pool_->AddTask(std::bind(&GlobalTxnCommitter::ApplyTasks, this, tasks));
+    return true;
+}
+
+void GlobalTxnCommitter::ApplyTasks(const std::vector<Task*>& tasks) {
+    std::map<TableImpl*, std::vector<RowMutation*>> table_mutations;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        table_mutations[tasks[i]->table.get()].push_back(tasks[i]->mutation);
+    }
+    for (auto it = table_mutations.begin(); it != table_mutations.end(); ++it) {
+        it->first->ApplyMutation(it->second, true);
+    }
+}
+
+void GlobalTxnCommitter::MutationCallback(RowMutation* mutation) {
+    Task* task = static_cast<Task*>(mutation->GetContext());
+    task->committer->DoMutationCallback(task);
+}
+
+void GlobalTxnCommitter::DoMutationCallback(Task* task) {
+    const ErrorCode& err = task->mutation->GetError();
+    if (err.GetType() == ErrorCode::kOK) {
+        FinishTask(task);
+    } else if (!stop_ && task->retry_times < max_retry_times_) {
+        VLOG(12) << "[gtxn][commit][async] secondary failed, retry: " << err.ToString();
+        gtxn_async_secondaries_retry_cnt.Inc();
+        ++task->retry_times;
+        thread_pool_->DelayTask(retry_period_ms_ * task->retry_times,
+                                std::bind(&GlobalTxnCommitter::RetryTask, this, task));
+    } else {
+        // the row is still locked, readers will roll it forward
+        LOG(WARNING) << "[gtxn][commit][async] secondary dropped, row: "
+                     << task->mutation->RowKey() << ", " << err.ToString();
+        gtxn_async_secondaries_drop_cnt.Inc();
+        FinishTask(task);
+    }
+}
+
+void GlobalTxnCommitter::RetryTask(Task* task) {
+    if (stop_) {
+        gtxn_async_secondaries_drop_cnt.Inc();
+        FinishTask(task);
+        return;
+    }
+    // a finished mutation can not be applied again, send a copy of it
+    RowMutationImpl* old_mutation = task->mutation;
+    RowMutationImpl* mutation = static_cast<RowMutationImpl*>(
+        task->table->NewRowMutation(old_mutation->RowKey()));
+    mutation->Concatenate(*old_mutation);
+    mutation->SetTimeOut(old_mutation->TimeOut());
+    mutation->SetCallBack(&GlobalTxnCommitter::MutationCallback);
+    mutation->SetContext(task);
+    delete old_mutation;
+    task->mutation = mutation;
+    ApplyTasks(std::vector<Task*>(1, task));
+}
+
+void GlobalTxnCommitter::FinishTask(Task* task) {
+    delete task->mutation;
+    delete task;
+    gtxn_async_secondaries_pending_cnt.Dec();
+    pending_num_.Dec();
+}
+
+} // namespace tera
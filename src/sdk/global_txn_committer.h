@@ -0,0 +1,74 @@
+// Copyright (c) 2015-2017, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef  TERA_SDK_GLOBAL_TXN_COMMITTER_H_
+#define  TERA_SDK_GLOBAL_TXN_COMMITTER_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "common/counter.h"
+#include "common/thread_pool.h"
+#include "tera.h"
+
+namespace tera {
+
+class TableImpl;
+class RowMutationImpl;
+
+// GlobalTxnCommitter commits the secondaries of global transactions in
+// background, after their primaries have been committed and the users
+// have got the result.  A secondary row failed to commit is retried a few
+// times, and then left to readers, which roll the row forward according
+// to its committed primary.
+//
+// The committer outlives the transactions handed to it, it keeps its own
+// reference to the tables of the mutations.
+class GlobalTxnCommitter {
+public:
+    GlobalTxnCommitter(int32_t thread_num,
+                       int64_t max_pending_num,
+                       int32_t max_retry_times,
+                       int64_t retry_period_ms);
+    ~GlobalTxnCommitter();
+
+    // Take over "mutations" and apply them in background.
+    // Return false and take nothing if the rows pending in the committer
+    // would exceed "max_pending_num", the caller should commit them itself.
+    bool AsyncCommit(const std::vector<RowMutation*>& mutations);
+
+    // the rows taken over and not finished yet
+    int64_t PendingNum() { return pending_num_.Get(); }
+
+private:
+    struct Task {
+        GlobalTxnCommitter* committer;
+        std::shared_ptr<TableImpl> table;
+        RowMutationImpl* mutation;
+        int32_t retry_times;
+    };
+
+    // send "tasks" in one request per tabletnode
+    void ApplyTasks(const std::vector<Task*>& tasks);
+    static void MutationCallback(RowMutation* mutation);
+    void DoMutationCallback(Task* task);
+    void RetryTask(Task* task);
+    void FinishTask(Task* task);
+
+    const int64_t max_pending_num_;
+    const int32_t max_retry_times_;
+    const int64_t retry_period_ms_;
+
+    Counter pending_num_;
+    std::atomic<bool> stop_;
+    std::unique_ptr<common::ThreadPool> thread_pool_;
+
+    GlobalTxnCommitter(const GlobalTxnCommitter&) = delete;
+    void operator=(const GlobalTxnCommitter&) = delete;
+};
+
+} // namespace tera
+
+#endif  // TERA_SDK_GLOBAL_TXN_COMMITTER_H_
@@ -53,6 +53,14 @@ tera::MetricCounter gtxn_notifies_delay_us(kGTxnNotifiesDelayMetric, kGTxnLabelC
 tera::MetricCounter gtxn_notifies_cnt(kGTxnNotifiesCountMetric, kGTxnLabelCommit);
 tera::MetricCounter gtxn_notifies_fail_cnt(kGTxnNotifiesFailCountMetric, kGTxnLabelCommit);
 
+// secondaries committing in background, and retried or dropped by the committer
+tera::MetricCounter gtxn_async_secondaries_pending_cnt(kGTxnAsyncSecondariesPendingMetric,
+        kGTxnLabelCommit, {SubscriberType::LATEST}, false);
+tera::MetricCounter gtxn_async_secondaries_retry_cnt(kGTxnAsyncSecondariesRetryCountMetric,
+        kGTxnLabelCommit);
+tera::MetricCounter gtxn_async_secondaries_drop_cnt(kGTxnAsyncSecondariesDropCountMetric,
+        kGTxnLabelCommit);
+
 tera::MetricCounter gtxn_tso_delay_us(kGTxnTsoDelayMetric, kGTxnLabelTso);
 tera::MetricCounter gtxn_tso_req_cnt(kGTxnTsoRequestCountMetric, kGTxnLabelTso);
 
@@ -59,6 +59,14 @@ bool RowlockStub::UnLock(const RowlockRequest* request,
             rpc_timeout_, thread_pool_);
 }
 
+bool RowlockStub::BatchLock(const RowlockBatchRequest* request,
+        RowlockBatchResponse* response,
+        std::function<void (RowlockBatchRequest*, RowlockBatchResponse*, bool, int)> done) {
+    return SendMessageWithRetry(&RowlockService::Stub::BatchLock,
+            request, response, done, "BatchLock",
+            rpc_timeout_, thread_pool_);
+}
+
 bool RowlockClient::init_ = false;
 std::string RowlockClient::server_addr_ = "";
 
@@ -136,6 +144,26 @@ bool RowlockClient::UnLock(const RowlockRequest* request,
     return false;
 }
 
+bool RowlockClient::BatchLock(const RowlockBatchRequest* request,
+            RowlockBatchResponse* response) {
+    std::shared_ptr<RowlockStub> client;
+    {
+        MutexLock locker(&client_mutex_);
+        // COW ref +1
+        client = client_;
+    }
+    for (int32_t i = 0; i < FLAGS_rowlock_client_max_fail_times; ++i) {
+        response->Clear();
+        if (client->BatchLock(request, response)) {
+            return true;
+        }
+        LOG(WARNING) << "batch lock fail, rows: " << request->rows_size();
+    }
+    // rpc fail
+    SetZkAdapter();
+    return false;
+}
+
 void RowlockClient::SetZkAdapter() {
     // mock rowlock, do not need a real zk adapter
     if (FLAGS_mock_rowlock_enable == true) {
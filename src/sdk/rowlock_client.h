@@ -39,6 +39,9 @@ public:
             RowlockResponse* response,
             std::function<void (RowlockRequest*, RowlockResponse*, bool, int)> done = NULL);
 
+    virtual bool BatchLock(const RowlockBatchRequest* request,
+            RowlockBatchResponse* response,
+            std::function<void (RowlockBatchRequest*, RowlockBatchResponse*, bool, int)> done = NULL);
 
 private:
     int32_t rpc_timeout_;
@@ -60,6 +63,10 @@ public:
             RowlockResponse* response,
             std::function<void (RowlockRequest*, RowlockResponse*, bool, int)> done = NULL);
 
+    // lock all rows of "request" in one rpc, sync only
+    virtual bool BatchLock(const RowlockBatchRequest* request,
+            RowlockBatchResponse* response);
+
     void Update(const std::vector<std::string>& addrs);
 
 private:
@@ -127,6 +127,14 @@ bool TableDescriptor::IsTxnEnabled() const {
     return impl_->IsTxnEnabled();
 }
 
+void TableDescriptor::EnableNotifyIndex() {
+    impl_->EnableNotifyIndex();
+}
+
+bool TableDescriptor::IsNotifyIndexEnabled() const {
+    return impl_->IsNotifyIndexEnabled();
+}
+
 int32_t TableDescriptor::AddSnapshot(uint64_t snapshot) {
     return impl_->AddSnapshot(snapshot);
 }
@@ -134,7 +134,8 @@ LGDescImpl::LGDescImpl(const std::string& lg_name, int32_t id)
       use_memtable_on_leveldb_(false),
       memtable_ldb_write_buffer_size_(0),
       memtable_ldb_block_size_(0),
-      sst_size_(FLAGS_tera_tablet_ldb_sst_size << 20){
+      sst_size_(FLAGS_tera_tablet_ldb_sst_size << 20),
+      compaction_style_(kLeveledCompaction) {
 }
 
 /// Id read only
@@ -214,6 +215,14 @@ void LGDescImpl::SetSstSize(int32_t sst_size) {
     sst_size_ = sst_size;
 }
 
+void LGDescImpl::SetCompactionStyle(CompactionStyle style) {
+    compaction_style_ = style;
+}
+
+CompactionStyle LGDescImpl::GetCompactionStyle() const {
+    return compaction_style_;
+}
+
 /// 表格名字仅允许使用字母、数字和下划线构造,长度不超过256
 TableDescImpl::TableDescImpl(const std::string& tb_name)
     : name_(tb_name),
@@ -223,7 +232,8 @@ TableDescImpl::TableDescImpl(const std::string& tb_name)
       split_size_(FLAGS_tera_master_split_tablet_size),
       merge_size_(FLAGS_tera_master_merge_tablet_size),
       disable_wal_(false),
-      enable_txn_(false) {
+      enable_txn_(false),
+      enable_notify_index_(false) {
 }
 
 /*
@@ -447,6 +457,14 @@ bool TableDescImpl::IsTxnEnabled() const {
     return enable_txn_;
 }
 
+void TableDescImpl::EnableNotifyIndex() {
+    enable_notify_index_ = true;
+}
+
+bool TableDescImpl::IsNotifyIndexEnabled() const {
+    return enable_notify_index_;
+}
+
 /// 插入snapshot
 int32_t TableDescImpl::AddSnapshot(uint64_t snapshot) {
     snapshots_.push_back(snapshot);
@@ -130,6 +130,10 @@ public:
     int32_t SstSize() const;
     void SetSstSize(int32_t sst_size);
 
+    /// Compaction style
+    void SetCompactionStyle(CompactionStyle style);
+    CompactionStyle GetCompactionStyle() const;
+
 private:
     int32_t         id_;
     std::string     name_;
@@ -141,6 +145,7 @@ private:
     int32_t         memtable_ldb_write_buffer_size_;
     int32_t         memtable_ldb_block_size_;
     int32_t         sst_size_; // in bytes
+    CompactionStyle compaction_style_;
 };
 
 /// 表描述符.
@@ -189,6 +194,9 @@ public:
     void EnableTxn();
     bool IsTxnEnabled() const;
 
+    void EnableNotifyIndex();
+    bool IsNotifyIndexEnabled() const;
+
     /// 插入snapshot
     int32_t AddSnapshot(uint64_t snapshot);
     /// 获取snapshot
@@ -222,6 +230,7 @@ private:
     int64_t         merge_size_;
     bool            disable_wal_;
     bool            enable_txn_;
+    bool            enable_notify_index_;
     std::string     admin_group_;
     std::string     admin_;
 };
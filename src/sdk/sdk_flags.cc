@@ -8,10 +8,17 @@
 /////////  global transaction  ////////
 DEFINE_bool(tera_sdk_client_for_gtxn, false, "build thread_pool for global transaction");
 DEFINE_bool(tera_sdk_tso_client_enabled, false, "get timestamp from timeoracle, default from local timestamp");
+DEFINE_bool(tera_sdk_tso_coalesce_enabled, true, "coalesce concurrent timestamp requests of a client into one timeoracle rpc");
+DEFINE_int32(tera_sdk_tso_coalesce_max_count, 10000, "the max number of timestamps requested by one coalesced timeoracle rpc");
 DEFINE_int32(tera_gtxn_thread_max_num, 20, "the max thread number for global transaction operations");
 DEFINE_int32(tera_gtxn_commit_timeout_ms, 600000, "global transaction timeout limit (ms) default 10 minutes");
 DEFINE_int32(tera_gtxn_get_waited_times_limit, 10, "global txn wait other locked times limit");
 DEFINE_int32(tera_gtxn_all_puts_size_limit, 10000, "(B) global txn all puts data size limit");
+DEFINE_bool(tera_gtxn_async_secondaries_enabled, false, "return once the primary of global txn is committed, commit secondaries in background");
+DEFINE_int32(tera_gtxn_async_secondaries_thread_num, 4, "the thread number to commit secondaries of global txn in background");
+DEFINE_int64(tera_gtxn_async_secondaries_max_pending, 100000, "the max number of secondaries rows committing in background, commit in foreground if exceeded");
+DEFINE_int32(tera_gtxn_async_secondaries_retry_times, 10, "the max retry times to commit a secondary row in background");
+DEFINE_int32(tera_gtxn_async_secondaries_retry_period, 500, "the retry period (in ms) to commit a secondary row in background");
 DEFINE_int32(tera_gtxn_timeout_ms, 86400000, "global transaction timeout limit (ms) default 24 hours");
 
 ///////// SDK  /////////
@@ -49,6 +49,10 @@ const char* const kGTxnNotifiesDelayMetric = "tera_sdk_gtxn_notifies_delay_us";
 const char* const kGTxnNotifiesCountMetric = "tera_sdk_gtxn_notifies_count";
 const char* const kGTxnNotifiesFailCountMetric = "tera_sdk_gtxn_notifies_fail_count";
 
+const char* const kGTxnAsyncSecondariesPendingMetric = "tera_sdk_gtxn_async_secondaries_pending";
+const char* const kGTxnAsyncSecondariesRetryCountMetric = "tera_sdk_gtxn_async_secondaries_retry_count";
+const char* const kGTxnAsyncSecondariesDropCountMetric = "tera_sdk_gtxn_async_secondaries_drop_count";
+
 const char* const kGTxnTsoDelayMetric = "tera_sdk_gtxn_tso_delay_us";
 const char* const kGTxnTsoRequestCountMetric = "tera_sdk_gtxn_tso_request_count";
 } // end namespace tera 
@@ -46,6 +46,16 @@ string LgProp2Str(StoreMedium type) {
     }
 }
 
+string LgProp2Str(CompactStyle style) {
+    if (style == LeveledCompact) {
+        return "leveled";
+    } else if (style == TieredCompact) {
+        return "tiered";
+    } else {
+        return "";
+    }
+}
+
 string TableProp2Str(RawKey type) {
     if (type == Readable) {
         return "readable";
@@ -139,6 +149,9 @@ void ShowTableSchema(const TableSchema& s, bool is_x) {
     if (is_x || schema.enable_txn()) {
         ss << "txn=" << Switch2Str(schema.enable_txn()) << ",";
     }
+    if (is_x || schema.notify_index()) {
+        ss << "notify_index=" << Switch2Str(schema.notify_index()) << ",";
+    }
     ss << "\b> {" << std::endl;
 
     size_t lg_num = schema.locality_groups_size();
@@ -153,6 +166,9 @@ void ShowTableSchema(const TableSchema& s, bool is_x) {
         if (is_x) {
             ss << "sst_size=" << (lg_schema.sst_size() >> 20) << ",";
         }
+        if (is_x || lg_schema.compact_style() != LeveledCompact) {
+            ss << "compact_style=" << LgProp2Str(lg_schema.compact_style()) << ",";
+        }
         if (lg_schema.use_memtable_on_leveldb()) {
             ss << "use_memtable_on_leveldb=true"
                 << ",memtable_ldb_write_buffer_size="
@@ -241,6 +257,7 @@ void TableDescToSchema(const TableDescriptor& desc, TableSchema* schema) {
     schema->set_admin(desc.Admin());
     schema->set_disable_wal(desc.IsWalDisabled());
     schema->set_enable_txn(desc.IsTxnEnabled());
+    schema->set_notify_index(desc.IsNotifyIndexEnabled());
     // add lg
     int num = desc.LocalityGroupNum();
     for (int i = 0; i < num; ++i) {
@@ -267,6 +284,8 @@ void TableDescToSchema(const TableDescriptor& desc, TableSchema* schema) {
             lg->set_memtable_ldb_block_size(lgdesc->MemtableLdbBlockSize());
         }
         lg->set_sst_size(lgdesc->SstSize());
+        lg->set_compact_style(lgdesc->GetCompactionStyle() == kTieredCompaction ?
+                              TieredCompact : LeveledCompact);
         lg->set_id(lgdesc->Id());
     }
     // add cf
@@ -327,6 +346,9 @@ void TableSchemaToDesc(const TableSchema& schema, TableDescriptor* desc) {
     if (schema.has_enable_txn() && schema.enable_txn()) {
         desc->EnableTxn();
     }
+    if (schema.notify_index()) {
+        desc->EnableNotifyIndex();
+    }
     int32_t lg_num = schema.locality_groups_size();
     for (int32_t i = 0; i < lg_num; i++) {
         const LocalityGroupSchema& lg = schema.locality_groups(i);
@@ -352,6 +374,8 @@ void TableSchemaToDesc(const TableSchema& schema, TableDescriptor* desc) {
         lgd->SetMemtableLdbWriteBufferSize(lg.memtable_ldb_write_buffer_size());
         lgd->SetMemtableLdbBlockSize(lg.memtable_ldb_block_size());
         lgd->SetSstSize(lg.sst_size());
+        lgd->SetCompactionStyle(lg.compact_style() == TieredCompact ?
+                                kTieredCompaction : kLeveledCompaction);
     }
     int32_t cf_num = schema.column_families_size();
     for (int32_t i = 0; i < cf_num; i++) {
@@ -491,6 +515,14 @@ bool SetLgProperties(const string& name, const string& value,
             return false;
         }
         desc->SetSstSize(sst_size<<20); // display in MB, store in Bytes.
+    } else if (name == "compact_style") {
+        if (value == "leveled") {
+            desc->SetCompactionStyle(kLeveledCompaction);
+        } else if (value == "tiered") {
+            desc->SetCompactionStyle(kTieredCompaction);
+        } else {
+            return false;
+        }
     } else {
         return false;
     }
@@ -552,6 +584,14 @@ bool SetTableProperties(const string& name, const string& value,
         } else {
             return false;
         }
+    } else if (name == "notify_index") {
+        if (value == "on") {
+            desc->EnableNotifyIndex();
+        } else if (value == "off") {
+            // do nothing
+        } else {
+            return false;
+        }
     } else {
         return false;
     }
@@ -1017,6 +1057,10 @@ bool IsTransactionTable(const TableSchema& schema) {
     return schema.enable_txn();
 }
 
+bool IsNotifyIndexEnabled(const TableSchema& schema) {
+    return schema.notify_index();
+}
+
 void FindGlobalTransactionCfs(const TableSchema& schema, 
                               std::set<string>* column_families) {
     size_t cf_num = schema.column_families_size();
@@ -1065,4 +1109,34 @@ bool ExtendNotifyLgToDescriptor(TableDescriptor* desc) {
     return true;
 }
 
+string NotifyIndexTableName(const string& table_name) {
+    return table_name + "_notify_index";
+}
+
+string PackNotifyIndexRow(const string& row_key) {
+    // FNV-1a, stable across processes and platforms
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < row_key.size(); ++i) {
+        hash ^= static_cast<uint8_t>(row_key[i]);
+        hash *= 16777619u;
+    }
+    char bucket[3];
+    snprintf(bucket, sizeof(bucket), "%02x", hash % kNotifyIndexBucketNum);
+    return string(bucket, 2) + row_key;
+}
+
+bool UnpackNotifyIndexRow(const string& index_row, string* row_key) {
+    if (index_row.size() < 2) {
+        return false;
+    }
+    row_key->assign(index_row, 2, string::npos);
+    return true;
+}
+
+void BuildNotifyIndexDescriptor(const string& table_name, TableDescriptor* desc) {
+    desc->SetTableName(NotifyIndexTableName(table_name));
+    desc->AddLocalityGroup(TableDescImpl::NOTIFY_LG_NAME);
+    desc->AddColumnFamily(kNotifyColumnFamily, TableDescImpl::NOTIFY_LG_NAME);
+}
+
 } // namespace tera
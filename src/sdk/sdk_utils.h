@@ -52,8 +52,23 @@ bool IsKvTable(const TableSchema& schema);
 
 bool ExtendNotifyLgToDescriptor(TableDescriptor* desc);
 
+// Notification index: if "table_name" has the property "notify_index=on",
+// its rows with pending notifications are also listed in the side table
+// NotifyIndexTableName(table_name), one index row per data row with the
+// same "_N_" cells, so that observers scan the small index instead of the
+// whole table.  Index rows are prefixed
+// with a hash bucket of the data row to spread them over tablets.
+// BuildNotifyIndexDescriptor fills the schema of the index table into an
+// empty "desc".
+string NotifyIndexTableName(const string& table_name);
+string PackNotifyIndexRow(const string& row_key);
+bool UnpackNotifyIndexRow(const string& index_row, string* row_key);
+void BuildNotifyIndexDescriptor(const string& table_name, TableDescriptor* desc);
+
 bool IsTransactionTable(const TableSchema& schema);
 
+bool IsNotifyIndexEnabled(const TableSchema& schema);
+
 void FindGlobalTransactionCfs(const TableSchema& schema, std::set<string>* column_families);
 
 } // namespace tera
@@ -13,6 +13,7 @@
 #include "sdk/read_impl.h"
 #include "sdk/single_row_txn.h"
 #include "sdk/table_impl.h"
+#include "sdk/transaction_wrapper.h"
 #include "types.h"
 
 namespace tera {
@@ -83,6 +84,21 @@ void ReadCallbackWrapper(RowReader* row_reader) {
 /// 读取操作
 ErrorCode SingleRowTxn::Get(RowReader* row_reader) {
     RowReaderImpl* reader_impl = static_cast<RowReaderImpl*>(row_reader);
+    bool is_async = reader_impl->IsAsync();
+    if (!PrepareGet(reader_impl)) {
+        return is_async ? ErrorCode() : reader_impl->GetError();
+    }
+
+    table_impl_->Get(reader_impl);
+    if (is_async) {
+        return ErrorCode();
+    } else {
+        reader_impl->Wait();
+        return reader_impl->GetError();
+    }
+}
+
+bool SingleRowTxn::PrepareGet(RowReaderImpl* reader_impl) {
     reader_impl->SetTransaction(this);
     int64_t odd_time_ms = ttl_timestamp_ms_ - get_millis();
     if (odd_time_ms < reader_impl->TimeOut()) {
@@ -102,10 +118,8 @@ ErrorCode SingleRowTxn::Get(RowReader* row_reader) {
         if (is_async) {
             ThreadPool::Task task = std::bind(&RowReaderImpl::RunCallback, reader_impl);
             thread_pool_->AddTask(task);
-            return ErrorCode();
-        } else {
-            return reader_impl->GetError();
         }
+        return false;
     }
 
     int64_t ts_start = 0, ts_end = 0;
@@ -121,14 +135,7 @@ ErrorCode SingleRowTxn::Get(RowReader* row_reader) {
     // use our callback wrapper
     reader_impl->SetCallBack(ReadCallbackWrapper);
     reader_impl->SetContext(this);
-
-    table_impl_->Get(reader_impl);
-    if (is_async) {
-        return ErrorCode();
-    } else {
-        reader_impl->Wait();
-        return reader_impl->GetError();
-    }
+    return true;
 }
 
 /// 设置提交回调, 提交操作会异步返回
@@ -193,6 +200,22 @@ void CommitCallbackWrapper(RowMutation* row_mu) {
 
 /// 提交事务
 ErrorCode SingleRowTxn::Commit() {
+    RowMutationImpl* mutation = PrepareCommit();
+    if (mutation == NULL) {
+        return ErrorCode();
+    }
+    table_impl_->ApplyMutation(mutation);
+    if (mutation->IsAsync()) {
+        return ErrorCode();
+    } else {
+        if (mutation->GetError().GetType() == ErrorCode::kOK) {
+            InternalAckNotifyIndex();
+        }
+        return mutation->GetError();
+    }
+}
+
+RowMutationImpl* SingleRowTxn::PrepareCommit() {
     int64_t odd_time_ms = ttl_timestamp_ms_ - get_millis();
     if (odd_time_ms < mutation_buffer_.TimeOut()) {
         mutation_buffer_.SetTimeOut(odd_time_ms > 0 ? odd_time_ms : 1);
@@ -206,18 +229,47 @@ ErrorCode SingleRowTxn::Commit() {
             mutation_buffer_.SetContext(this);
         }
         mutation_buffer_.SetTransaction(this);
-        table_impl_->ApplyMutation(&mutation_buffer_);
-        if (mutation_buffer_.IsAsync()) {
-            return ErrorCode();
-        } else {
-            return mutation_buffer_.GetError();
-        }
+        return &mutation_buffer_;
     } else {
         if (user_commit_callback_ != NULL) {
             ThreadPool::Task task = std::bind(user_commit_callback_, this);
             thread_pool_->AddTask(task);
         }
-        return ErrorCode();
+        return NULL;
+    }
+}
+
+void SingleRowTxn::BatchGet(const std::vector<Transaction*>& txns,
+                            const std::vector<RowReader*>& readers) {
+    assert(txns.size() == readers.size());
+    std::map<TableImpl*, std::vector<RowReader*> > table_readers;
+    for (size_t i = 0; i < txns.size(); ++i) {
+        SingleRowTxn* txn = static_cast<TransactionWrapper<SingleRowTxn>*>(txns[i])
+            ->GetTransactionPtr().get();
+        RowReaderImpl* reader_impl = static_cast<RowReaderImpl*>(readers[i]);
+        assert(reader_impl->IsAsync());
+        if (txn->PrepareGet(reader_impl)) {
+            table_readers[txn->table_impl_.get()].push_back(reader_impl);
+        }
+    }
+    for (auto it = table_readers.begin(); it != table_readers.end(); ++it) {
+        it->first->Get(it->second, true);
+    }
+}
+
+void SingleRowTxn::BatchCommit(const std::vector<Transaction*>& txns) {
+    std::map<TableImpl*, std::vector<RowMutation*> > table_mutations;
+    for (size_t i = 0; i < txns.size(); ++i) {
+        SingleRowTxn* txn = static_cast<TransactionWrapper<SingleRowTxn>*>(txns[i])
+            ->GetTransactionPtr().get();
+        assert(txn->user_commit_callback_ != NULL);
+        RowMutationImpl* mutation = txn->PrepareCommit();
+        if (mutation != NULL) {
+            table_mutations[txn->table_impl_.get()].push_back(mutation);
+        }
+    }
+    for (auto it = table_mutations.begin(); it != table_mutations.end(); ++it) {
+        it->first->ApplyMutation(it->second, true);
     }
 }
 
@@ -225,6 +277,9 @@ ErrorCode SingleRowTxn::Commit() {
 void SingleRowTxn::CommitCallback(RowMutationImpl* mu_impl) {
     CHECK_EQ(&mutation_buffer_, mu_impl);
     CHECK_NOTNULL(user_commit_callback_);
+    if (mu_impl->GetError().GetType() == ErrorCode::kOK) {
+        InternalAckNotifyIndex();
+    }
     // run user's commit callback
     user_commit_callback_(this);
 }
@@ -288,6 +343,14 @@ void SingleRowTxn::Ack(Table* t,
     std::string notify_qulifier = PackNotifyName(column_family, qualifier);
     mutation->DeleteColumns(kNotifyColumnFamily, notify_qulifier, start_timestamp_);
     this->ApplyMutation(mutation.get());
+
+    ErrorCode err;
+    TableImpl* index_table = GetNotifyIndexTable(t, &err);
+    if (index_table != NULL) {
+        // removed once the transaction is committed
+        Cell cell(index_table, PackNotifyIndexRow(row_key), column_family, qualifier);
+        ack_index_cells_.push_back(cell);
+    }
 }
 
 void SingleRowTxn::Notify(Table* t,
@@ -300,6 +363,22 @@ void SingleRowTxn::Notify(Table* t,
 
 void SingleRowTxn::InternalNotify() {
     for (auto cell : notify_cells_) {
+        ErrorCode err;
+        TableImpl* index_table = GetNotifyIndexTable(cell.Table(), &err);
+        if (index_table != NULL) {
+            // index the row before notifying it, so that observers scanning
+            // the index never miss the notification
+            std::unique_ptr<tera::RowMutation> index_mutation(
+                index_table->NewRowMutation(PackNotifyIndexRow(cell.RowKey())));
+            index_mutation->Put(kNotifyColumnFamily, cell.NotifyName(), commit_timestamp_);
+            index_table->ApplyMutation(index_mutation.get());
+            err = index_mutation->GetError();
+        }
+        if (err.GetType() != ErrorCode::kOK) {
+            LOG(ERROR) << "fail to index the notification of " << cell.TableName()
+                << ":" << cell.RowKey() << ", " << err.ToString();
+            continue;
+        }
         std::unique_ptr<tera::RowMutation> mutation(cell.Table()->NewRowMutation(cell.RowKey()));
         std::string notify_qulifier = PackNotifyName(cell.ColFamily(), cell.Qualifier());
         mutation->Put(kNotifyColumnFamily, notify_qulifier, commit_timestamp_);
@@ -308,6 +387,17 @@ void SingleRowTxn::InternalNotify() {
     }
 }
 
+void SingleRowTxn::InternalAckNotifyIndex() {
+    for (auto cell : ack_index_cells_) {
+        RowMutation* mutation = cell.Table()->NewRowMutation(cell.RowKey());
+        mutation->DeleteColumns(kNotifyColumnFamily, cell.NotifyName(), start_timestamp_);
+        // a stale index entry only costs the observers one more check
+        mutation->SetCallBack([] (RowMutation* mu) { delete mu; });
+        cell.Table()->ApplyMutation(mutation);
+    }
+    ack_index_cells_.clear();
+}
+
 } // namespace tera
 
 /* vim: set expandtab ts=4 sw=4 sts=4 tw=100: */
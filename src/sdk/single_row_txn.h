@@ -6,6 +6,7 @@
 #define  TERA_SDK_SINGLE_ROW_TXN_H_
 
 #include <string>
+#include <vector>
 
 #include "common/timer.h"
 #include "sdk/mutate_impl.h"
@@ -80,13 +81,31 @@ public:
     /// 序列化
     void Serialize(RowMutationSequence* mu_seq);
 
+    /// 批量读/提交多个单行事务（须为StartRowTransaction创建、异步），
+    /// 请求按tabletnode打包后立即发送，不等待攒批间隔
+    static void BatchGet(const std::vector<Transaction*>& txns,
+                         const std::vector<RowReader*>& readers);
+    static void BatchCommit(const std::vector<Transaction*>& txns);
+
 private:
+    // check and hook "reader_impl" before it is sent,
+    // false if it has failed and its callback is scheduled
+    bool PrepareGet(RowReaderImpl* reader_impl);
+
+    // the mutation to send on commit, NULL if there is nothing to write
+    // and the commit callback is scheduled
+    RowMutationImpl* PrepareCommit();
+
     // prevent users from reading more than once in one single-row-txn
     bool MarkHasRead();
 
     void MarkNoRead();
 
     void InternalNotify();
+
+    // remove the notification index entries of the acked notifications,
+    // called after the transaction is committed
+    void InternalAckNotifyIndex();
 private:
     std::shared_ptr<TableImpl> table_impl_;
     const std::string row_key_;
@@ -113,6 +132,7 @@ private:
     void* user_commit_context_;
 
     std::vector<Cell> notify_cells_;
+    std::vector<Cell> ack_index_cells_;
 
     mutable Mutex mu_;
 };
@@ -30,6 +30,7 @@
 #include "sdk/single_row_txn.h"
 #include "sdk/scan_impl.h"
 #include "sdk/schema_impl.h"
+#include "sdk/sdk_utils.h"
 #include "sdk/sdk_zk.h"
 #include "tera.h"
 #include "utils/crypt.h"
@@ -137,6 +138,38 @@ void OpStatCallback(Table* table, SdkTask* task) {
     }
 }
 
+TableImpl* TableImpl::GetNotifyIndexTable(ErrorCode* err) {
+    err->SetFailed(ErrorCode::kOK);
+    if (!IsNotifyIndexEnabled(table_schema_)) {
+        return NULL;
+    }
+    MutexLock lock(&notify_index_mutex_);
+    if (!notify_index_table_) {
+        const std::string index_name = NotifyIndexTableName(name_);
+        std::unique_ptr<Table> table;
+        if (client_impl_) {
+            table.reset(client_impl_->OpenTable(index_name, err));
+        }
+        TableWrapper* wrapper = dynamic_cast<TableWrapper*>(table.get());
+        if (wrapper == NULL) {
+            if (err->GetType() == ErrorCode::kOK) {
+                err->SetFailed(ErrorCode::kSystem, "fail to open " + index_name);
+            }
+            return NULL;
+        }
+        notify_index_table_ = wrapper->GetTableImpl();
+    }
+    return notify_index_table_.get();
+}
+
+TableImpl* GetNotifyIndexTable(Table* table, ErrorCode* err) {
+    err->SetFailed(ErrorCode::kOK);
+    TableWrapper* wrapper = dynamic_cast<TableWrapper*>(table);
+    TableImpl* table_impl = wrapper != NULL
+        ? wrapper->GetTableImpl().get() : dynamic_cast<TableImpl*>(table);
+    return table_impl != NULL ? table_impl->GetNotifyIndexTable(err) : NULL;
+}
+
 void TableImpl::ApplyMutation(RowMutation* row_mu) {
     perf_counter_.user_mu_cnt.Add(1);
     ((RowMutationImpl*)row_mu)->Prepare(OpStatCallback);
@@ -159,6 +192,10 @@ void TableImpl::ApplyMutation(RowMutation* row_mu) {
 }
 
 void TableImpl::ApplyMutation(const std::vector<RowMutation*>& row_mutations) {
+    ApplyMutation(row_mutations, false);
+}
+
+void TableImpl::ApplyMutation(const std::vector<RowMutation*>& row_mutations, bool flush) {
     std::vector<SdkTask*> task_list;
     for (uint32_t i = 0; i < row_mutations.size(); i++) {
         perf_counter_.user_mu_cnt.Add(1);
@@ -177,7 +214,7 @@ void TableImpl::ApplyMutation(const std::vector<RowMutation*>& row_mutations) {
         task_list.push_back(static_cast<SdkTask*>((RowMutationImpl*)row_mutations[i]));
     }
     int64_t ts = get_micros();
-    DistributeTasks(task_list, true, SdkTask::MUTATION);
+    DistributeTasks(task_list, true, SdkTask::MUTATION, flush);
     perf_counter_.hist_async_cost.Add(get_micros() - ts);
 }
 
@@ -305,13 +342,17 @@ void TableImpl::Get(RowReader* row_reader) {
 }
 
 void TableImpl::Get(const std::vector<RowReader*>& row_readers) {
+    Get(row_readers, false);
+}
+
+void TableImpl::Get(const std::vector<RowReader*>& row_readers, bool flush) {
     std::vector<RowReaderImpl*> row_reader_list(row_readers.size());
     for (uint32_t i = 0; i < row_readers.size(); ++i) {
         perf_counter_.user_read_cnt.Add(1);
         ((RowReaderImpl*)row_readers[i])->Prepare(OpStatCallback);
         row_reader_list[i] = static_cast<RowReaderImpl*>(row_readers[i]);
     }
-    DistributeReaders(row_reader_list, true);
+    DistributeReaders(row_reader_list, true, flush);
 }
 
 bool TableImpl::Get(const std::string& row_key, const std::string& family,
@@ -571,7 +612,8 @@ bool TableImpl::OpenInternal(ErrorCode* err) {
 
 void TableImpl::DistributeTasks(const std::vector<SdkTask*>& task_list,
                                 bool called_by_user,
-                                SdkTask::TYPE task_type) {
+                                SdkTask::TYPE task_type,
+                                bool flush) {
     typedef std::map<std::string, std::vector<SdkTask*> > TsTaskMap;
     TsTaskMap ts_task_list;
     int64_t sync_min_timeout = -1;
@@ -655,7 +697,7 @@ void TableImpl::DistributeTasks(const std::vector<SdkTask*>& task_list,
 
     TsTaskMap::iterator it = ts_task_list.begin();
     for (; it != ts_task_list.end(); ++it) {
-        PackSdkTasks(it->first, it->second, task_type);
+        PackSdkTasks(it->first, it->second, task_type, flush);
     }
 
     // 从现在开始，所有异步的row_mutation都不可以再操作了，因为随时会被用户释放
@@ -887,12 +929,13 @@ void TableImpl::MutationTimeout(SdkTask* task) {
 }
 
 void TableImpl::DistributeReaders(const std::vector<RowReaderImpl*>& row_reader_list,
-                                  bool called_by_user) {
+                                  bool called_by_user,
+                                  bool flush) {
     std::vector<SdkTask*> task_list;
     for (size_t i = 0; i < row_reader_list.size(); ++i) {
         task_list.push_back((SdkTask*)(row_reader_list[i]));
     }
-    DistributeTasks(task_list, called_by_user, SdkTask::READ);
+    DistributeTasks(task_list, called_by_user, SdkTask::READ, flush);
 }
 
 void TableImpl::CommitReaders(const std::string server_addr,
@@ -1099,7 +1142,8 @@ void TableImpl::ReaderTimeout(SdkTask* task) {
 
 void TableImpl::PackSdkTasks(const std::string& server_addr,
                              std::vector<SdkTask*>& task_list,
-                             SdkTask::TYPE task_type) {
+                             SdkTask::TYPE task_type,
+                             bool flush) {
     Mutex* mutex = NULL;
     std::map<std::string, TaskBatch*>* task_batch_map = NULL;
     SdkTask::TimeoutFunc task;
@@ -1156,9 +1200,10 @@ void TableImpl::PackSdkTasks(const std::string& server_addr,
         // 2) any mutation is sync (flush == true)
         // 3) batch_row_num >= min_batch_row_num
         // 4) commit timeout
+        // 5) the caller asks to flush
         if (task_batch->byte_size >= kMaxRpcSize ||
             ((i == task_list.size() - 1) &&
-             (is_instant ||
+             (is_instant || flush ||
               (task_batch->row_id_list->size() >= commit_size)))) {
             std::vector<int64_t>* task_id_list = task_batch->row_id_list;
             task_batch->row_id_list = NULL;
@@ -98,6 +98,9 @@ public:
 
     virtual void ApplyMutation(RowMutation* row_mu);
     virtual void ApplyMutation(const std::vector<RowMutation*>& row_mutations);
+    // with "flush", the mutations are sent at once in one request per
+    // tabletnode, instead of waiting for the batch send interval
+    virtual void ApplyMutation(const std::vector<RowMutation*>& row_mutations, bool flush);
 
     virtual void Put(RowMutation* row_mu);
     virtual void Put(const std::vector<RowMutation*>& row_mutations);
@@ -142,6 +145,8 @@ public:
 
     virtual void Get(RowReader* row_reader);
     virtual void Get(const std::vector<RowReader*>& row_readers);
+    // with "flush", like ApplyMutation(row_mutations, flush)
+    virtual void Get(const std::vector<RowReader*>& row_readers, bool flush);
     virtual bool Get(const std::string& row_key, const std::string& family,
                      const std::string& qualifier, std::string* value,
                      ErrorCode* err);
@@ -219,6 +224,11 @@ public:
     uint64_t GetMaxReaderPendingNum() { return max_reader_pending_num_; }
     TableSchema GetTableSchema() { return  table_schema_; }
 
+    // The notification index table of this table, opened on first use and
+    // kept with this table.  NULL if the index is disabled by the schema,
+    // or if it could not be opened, with *err set.
+    TableImpl* GetNotifyIndexTable(ErrorCode* err);
+
     void StatUserPerfCounter(enum SdkTask::TYPE op, ErrorCode::ErrorCodeType code, int64_t cost_time);
     struct PerfCounter {
         int64_t start_time;
@@ -283,7 +293,8 @@ private:
 
     void DistributeTasks(const std::vector<SdkTask*>& task_list,
                          bool called_by_user,
-                         SdkTask::TYPE task_type);
+                         SdkTask::TYPE task_type,
+                         bool flush = false);
 
     void DistributeMutationsById(std::vector<int64_t>* retry_mu_id_list);
 
@@ -307,7 +318,8 @@ private:
 
     // 将一批reader根据rowkey分配给各个TS
     void DistributeReaders(const std::vector<RowReaderImpl*>& row_reader_list,
-                           bool called_by_user);
+                           bool called_by_user,
+                           bool flush = false);
 
     // 通过异步RPC将reader提交至TS
     void CommitReaders(const std::string server_addr,
@@ -329,9 +341,11 @@ private:
     // reader到达用户设置的超时时间但尚未处理完
     void ReaderTimeout(SdkTask* sdk_task);
 
+    // "flush" commits the last batch of "server_addr" at once
     void PackSdkTasks(const std::string& server_addr,
                       std::vector<SdkTask*>& task_list,
-                      SdkTask::TYPE task_type);
+                      SdkTask::TYPE task_type,
+                      bool flush = false);
     void TaskBatchTimeout(SdkTask* task);
     void CommitTasksById(const std::string& server_addr,
                          std::vector<int64_t>& task_id_list,
@@ -464,6 +478,8 @@ private:
     uint32_t timeout_;
 
     std::shared_ptr<ClientImpl> client_impl_;
+    Mutex notify_index_mutex_;
+    std::shared_ptr<TableImpl> notify_index_table_;
 
     mutable Mutex mutation_batch_mutex_;
     mutable Mutex reader_batch_mutex_;
@@ -693,6 +709,12 @@ private:
     std::shared_ptr<TableImpl> impl_;
 };
 
+// The notification index table of "table" if the notification index is
+// enabled on it, otherwise NULL.  *err is set if the index is enabled but
+// could not be opened, the notification must not be written then.  See
+// NotifyIndexTableName() in sdk_utils.h.
+TableImpl* GetNotifyIndexTable(Table* table, ErrorCode* err);
+
 } // namespace tera
 
 #endif  // TERA_SDK_TABLE_IMPL_H_
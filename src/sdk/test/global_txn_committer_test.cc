@@ -0,0 +1,150 @@
+// Copyright (c) 2015-2017, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "common/metric/metric_counter.h"
+#include "common/this_thread.h"
+#include "common/thread_pool.h"
+#include "sdk/global_txn_committer.h"
+#include "sdk/test/mock_table.h"
+
+namespace tera {
+
+extern tera::MetricCounter gtxn_async_secondaries_pending_cnt;
+extern tera::MetricCounter gtxn_async_secondaries_retry_cnt;
+extern tera::MetricCounter gtxn_async_secondaries_drop_cnt;
+
+class GlobalTxnCommitterTest : public ::testing::Test {
+public:
+    GlobalTxnCommitterTest()
+        : thread_pool_(2),
+          pending_base_(gtxn_async_secondaries_pending_cnt.Get()),
+          retry_base_(gtxn_async_secondaries_retry_cnt.Get()),
+          drop_base_(gtxn_async_secondaries_drop_cnt.Get()) {}
+
+    std::shared_ptr<MockTable> OpenTable(const std::string& tablename) {
+        return std::shared_ptr<MockTable>(new MockTable(tablename, &thread_pool_));
+    }
+
+    std::vector<ErrorCode> Errors(const std::vector<ErrorCode::ErrorCodeType>& types) {
+        std::vector<ErrorCode> errs(types.size());
+        for (size_t i = 0; i < types.size(); ++i) {
+            errs[i].SetFailed(types[i], "");
+        }
+        return errs;
+    }
+
+    RowMutation* NewMutation(Table* table, const std::string& row) {
+        RowMutation* mu = table->NewRowMutation(row);
+        mu->Put("cf", "qu", "val");
+        return mu;
+    }
+
+    // wait at most 5s for "cond"
+    template <typename Cond>
+    bool WaitFor(Cond cond) {
+        for (int i = 0; i < 500 && !cond(); ++i) {
+            ThisThread::Sleep(10);
+        }
+        return cond();
+    }
+
+    // the metrics since the test started
+    int64_t PendingMetric() { return gtxn_async_secondaries_pending_cnt.Get() - pending_base_; }
+    int64_t RetryMetric() { return gtxn_async_secondaries_retry_cnt.Get() - retry_base_; }
+    int64_t DropMetric() { return gtxn_async_secondaries_drop_cnt.Get() - drop_base_; }
+
+protected:
+    common::ThreadPool thread_pool_;
+    int64_t pending_base_;
+    int64_t retry_base_;
+    int64_t drop_base_;
+};
+
+TEST_F(GlobalTxnCommitterTest, ApplyInBackground) {
+    std::shared_ptr<MockTable> t1 = OpenTable("t1");
+    std::shared_ptr<MockTable> t2 = OpenTable("t2");
+    t1->AddMutationErrors(Errors({ErrorCode::kOK, ErrorCode::kOK}));
+    t2->AddMutationErrors(Errors({ErrorCode::kOK}));
+    GlobalTxnCommitter committer(1, 10, 3, 1);
+
+    std::vector<RowMutation*> mutations;
+    mutations.push_back(NewMutation(t1.get(), "r1"));
+    mutations.push_back(NewMutation(t2.get(), "r1"));
+    mutations.push_back(NewMutation(t1.get(), "r2"));
+    EXPECT_TRUE(committer.AsyncCommit(mutations));
+    EXPECT_TRUE(WaitFor([&committer] { return committer.PendingNum() == 0; }));
+
+    // one batch per table
+    EXPECT_EQ(t1->MutationNum(), 2);
+    EXPECT_EQ(t1->MutationBatchNum(), 1);
+    EXPECT_EQ(t2->MutationNum(), 1);
+    EXPECT_EQ(t2->MutationBatchNum(), 1);
+    EXPECT_EQ(PendingMetric(), 0);
+    EXPECT_EQ(RetryMetric(), 0);
+    EXPECT_EQ(DropMetric(), 0);
+}
+
+TEST_F(GlobalTxnCommitterTest, TooManyPending) {
+    std::shared_ptr<MockTable> t1 = OpenTable("t1");
+    GlobalTxnCommitter committer(1, 1, 3, 1);
+
+    std::vector<RowMutation*> mutations;
+    mutations.push_back(NewMutation(t1.get(), "r1"));
+    mutations.push_back(NewMutation(t1.get(), "r2"));
+    // nothing is taken, the caller commits the rows itself
+    EXPECT_FALSE(committer.AsyncCommit(mutations));
+    EXPECT_EQ(committer.PendingNum(), 0);
+    EXPECT_EQ(PendingMetric(), 0);
+    EXPECT_EQ(t1->MutationNum(), 0);
+    for (size_t i = 0; i < mutations.size(); ++i) {
+        delete mutations[i];
+    }
+    EXPECT_TRUE(committer.AsyncCommit(std::vector<RowMutation*>()));
+}
+
+TEST_F(GlobalTxnCommitterTest, RetryFailedRow) {
+    std::shared_ptr<MockTable> t1 = OpenTable("t1");
+    t1->AddMutationErrors(Errors({ErrorCode::kSystem, ErrorCode::kOK}));
+    // long enough a retry period to look at the row waiting for retry
+    GlobalTxnCommitter committer(1, 10, 3, 500);
+
+    EXPECT_TRUE(committer.AsyncCommit(std::vector<RowMutation*>(1, NewMutation(t1.get(), "r1"))));
+    EXPECT_TRUE(WaitFor([this] { return RetryMetric() == 1; }));
+    EXPECT_EQ(t1->MutationNum(), 1);
+    EXPECT_EQ(committer.PendingNum(), 1);
+    EXPECT_EQ(PendingMetric(), 1);
+
+    // sent again through a delayed task
+    EXPECT_TRUE(WaitFor([&committer] { return committer.PendingNum() == 0; }));
+    EXPECT_EQ(t1->MutationNum(), 2);
+    EXPECT_EQ(t1->MutationBatchNum(), 2);
+    EXPECT_EQ(PendingMetric(), 0);
+    EXPECT_EQ(RetryMetric(), 1);
+    EXPECT_EQ(DropMetric(), 0);
+}
+
+TEST_F(GlobalTxnCommitterTest, DropAfterMaxRetries) {
+    std::shared_ptr<MockTable> t1 = OpenTable("t1");
+    t1->AddMutationErrors(Errors({ErrorCode::kSystem, ErrorCode::kTimeout,
+                                  ErrorCode::kSystem}));
+    GlobalTxnCommitter committer(1, 10, 2, 1);
+
+    EXPECT_TRUE(committer.AsyncCommit(std::vector<RowMutation*>(1, NewMutation(t1.get(), "r1"))));
+    EXPECT_TRUE(WaitFor([&committer] { return committer.PendingNum() == 0; }));
+    // the first try and 2 retries
+    EXPECT_EQ(t1->MutationNum(), 3);
+    EXPECT_EQ(PendingMetric(), 0);
+    EXPECT_EQ(RetryMetric(), 2);
+    EXPECT_EQ(DropMetric(), 1);
+}
+
+} // namespace tera
@@ -20,6 +20,7 @@
 #include "sdk/table_impl.h"
 #include "sdk/sdk_zk.h"
 #include "sdk/test/mock_table.h"
+#include "sdk/timeoracle_client_impl.h"
 #include "tera.h"
 #include "sdk/transaction_wrapper.h"
 
@@ -31,7 +32,9 @@ class GlobalTxnTest : public ::testing::Test {
 public:
     GlobalTxnTest() : 
         thread_pool_(2), 
-        gtxn_(std::shared_ptr<ClientImpl>(), &thread_pool_, (new sdk::MockTimeoracleClusterFinder(""))) {
+        cluster_finder_(""),
+        tso_client_(&thread_pool_, &cluster_finder_),
+        gtxn_(std::shared_ptr<ClientImpl>(), &thread_pool_, &tso_client_) {
         gtxn_.status_.SetFailed(ErrorCode::kOK);
         gtxn_.status_returned_ = false;
     }
@@ -48,9 +51,54 @@ public:
         std::shared_ptr<MockTable> table_(new MockTable(tablename, &thread_pool_));
         return table_;
     }
-    
+
+    // primary "r0" in "pri_t" is prewritten and its "lock" is verified,
+    // the secondaries "r1".."rN" in "sec_t" are left to prewrite
+    void PrepareSecondaryPrewrite(Table* pri_t, Table* sec_t, int secondary_num) {
+        gtxn_.writes_.clear();
+        Cell pri_cell(pri_t, "r0", "cf", "qu", 1, "val");
+        Write pri_w(pri_cell);
+        gtxn_.SaveWrite("t0", "r0", pri_w);
+        for (int i = 1; i <= secondary_num; ++i) {
+            const std::string row = "r" + std::to_string(i);
+            Cell cell(sec_t, row, "cf", "qu", 1, "val");
+            Write w(cell);
+            gtxn_.SaveWrite("t1", row, w);
+        }
+        gtxn_.primary_write_ = &(gtxn_.writes_.begin()->second[0]);
+        gtxn_.prewrite_start_ts_ = 100;
+        gtxn_.gtxn_internal_->SetPrewriteStartTimestamp(100);
+        gtxn_.gtxn_internal_->SetCommitDuration(10000);
+        gtxn_.gtxn_internal_->is_timeout_ = false;
+        gtxn_.user_commit_callback_ = NULL;
+        gtxn_.finish_ = false;
+        gtxn_.status_returned_ = false;
+        gtxn_.prewrite_status_.SetFailed(ErrorCode::kOK);
+        gtxn_.primary_ctx_ = new PrimaryTxnContext(&gtxn_, pri_t->StartRowTransaction("r0"));
+        gtxn_.prewrite_stage_pending_cnt_.Set(1);
+    }
+
+    // all secondaries read ok and find nothing
+    std::vector<MockReaderResult> EmptyReaderResults(int num) {
+        std::vector<MockReaderResult> results(num);
+        for (int i = 0; i < num; ++i) {
+            results[i].status.SetFailed(ErrorCode::kOK);
+        }
+        return results;
+    }
+
+    std::vector<ErrorCode> Errors(const std::vector<ErrorCode::ErrorCodeType>& types) {
+        std::vector<ErrorCode> errs(types.size());
+        for (size_t i = 0; i < types.size(); ++i) {
+            errs[i].SetFailed(types[i], "");
+        }
+        return errs;
+    }
+
 private:
     common::ThreadPool thread_pool_;
+    sdk::MockTimeoracleClusterFinder cluster_finder_;
+    timeoracle::TimeoracleClientImpl tso_client_;
     GlobalTxn gtxn_;
     //std::vector<std::shared_ptr<MockTable>> table_vec;
 };
@@ -1261,5 +1309,179 @@ TEST_F(GlobalTxnTest, VerifyPrimaryLocked) {
     EXPECT_TRUE(gtxn_.status_.GetType() == ErrorCode::kGTxnPrimaryLost);
 }
 
+TEST_F(GlobalTxnTest, CommitSecondariesInBackground) {
+    std::shared_ptr<Table> t = OpenTable("t1");
+    GlobalTxnCommitter committer(1, 1, 0, 1);
+    gtxn_.committer_ = &committer;
+    gtxn_.writes_cnt_.Set(2);
+    gtxn_.commit_secondaries_done_cnt_.Set(0);
+
+    // more rows than the committer can take
+    GlobalTxn::MutationBatch batch;
+    batch[t.get()].push_back(t->NewRowMutation("r1"));
+    batch[t.get()].push_back(t->NewRowMutation("r2"));
+    EXPECT_FALSE(gtxn_.CommitSecondariesInBackground(&batch));
+    EXPECT_EQ(batch[t.get()].size(), 2U);
+    EXPECT_EQ(committer.PendingNum(), 0);
+    EXPECT_EQ(gtxn_.commit_secondaries_done_cnt_.Get(), 0);
+    for (size_t i = 0; i < batch[t.get()].size(); ++i) {
+        delete batch[t.get()][i];
+    }
+
+    // nothing to commit
+    batch.clear();
+    EXPECT_TRUE(gtxn_.CommitSecondariesInBackground(&batch));
+    EXPECT_EQ(gtxn_.commit_secondaries_done_cnt_.Get(), 2);
+    gtxn_.committer_ = NULL;
+}
+
+TEST_F(GlobalTxnTest, CheckTables) {
+    std::shared_ptr<Table> t = OpenTable("t1");
+    gtxn_.writes_.clear();
+    gtxn_.acks_.clear();
+    gtxn_.notifies_.clear();
+    Cell cell(t.get(), "r1", "cf", "qu", 1, "val");
+    Write w(cell);
+    gtxn_.SaveWrite("t1", "r1", w);
+    ErrorCode status;
+    EXPECT_TRUE(gtxn_.CheckTables(&status));
+    EXPECT_EQ(status.GetType(), ErrorCode::kOK);
+}
+
+TEST_F(GlobalTxnTest, PrewriteSecondariesWriteConflict) {
+    std::shared_ptr<Table> t0 = OpenTable("t0");
+    std::shared_ptr<Table> t1 = OpenTable("t1");
+    MockTable* pri_t = static_cast<MockTable*>(t0.get());
+    MockTable* sec_t = static_cast<MockTable*>(t1.get());
+    PrepareSecondaryPrewrite(pri_t, sec_t, 2);
+
+    // "r2" is committed by others after this txn started
+    std::vector<MockReaderResult> results = EmptyReaderResults(2);
+    AddKeyValueToResult("r2", "cf", PackWriteName("qu"), 120,
+                        EncodeWriteValue(0, 110), &results[1].result);
+    sec_t->AddReaderResult(results);
+
+    gtxn_.PrewriteSecondaries();
+    gtxn_.WaitForComplete();
+    EXPECT_EQ(gtxn_.status_.GetType(), ErrorCode::kGTxnWriteConflict);
+    EXPECT_EQ(sec_t->ReaderNum(), 2);
+    EXPECT_EQ(sec_t->ReaderBatchNum(), 1);
+    // no secondary is locked, and the primary is not committed
+    EXPECT_EQ(sec_t->MutationNum(), 0);
+    EXPECT_EQ(pri_t->MutationNum(), 0);
+    EXPECT_TRUE(gtxn_.primary_ctx_ == NULL);
+    EXPECT_TRUE(gtxn_.secondary_prewrites_.empty());
+}
+
+TEST_F(GlobalTxnTest, PrewriteSecondariesLockConflict) {
+    std::shared_ptr<Table> t0 = OpenTable("t0");
+    std::shared_ptr<Table> t1 = OpenTable("t1");
+    MockTable* pri_t = static_cast<MockTable*>(t0.get());
+    MockTable* sec_t = static_cast<MockTable*>(t1.get());
+    PrepareSecondaryPrewrite(pri_t, sec_t, 2);
+
+    // "r1" is locked by another txn during the read phase
+    std::vector<MockReaderResult> results = EmptyReaderResults(2);
+    AddKeyValueToResult("r1", "cf", PackLockName("qu"), 90, "", &results[0].result);
+    sec_t->AddReaderResult(results);
+
+    gtxn_.PrewriteSecondaries();
+    gtxn_.WaitForComplete();
+    EXPECT_EQ(gtxn_.status_.GetType(), ErrorCode::kGTxnLockConflict);
+    EXPECT_EQ(sec_t->ReaderNum(), 2);
+    EXPECT_EQ(sec_t->MutationNum(), 0);
+    EXPECT_EQ(pri_t->MutationNum(), 0);
+    EXPECT_TRUE(gtxn_.primary_ctx_ == NULL);
+    EXPECT_TRUE(gtxn_.secondary_prewrites_.empty());
+}
+
+TEST_F(GlobalTxnTest, PrewriteSecondariesTimeout0) {
+    // case a. global timeout before reading
+    std::shared_ptr<Table> t0 = OpenTable("t0");
+    std::shared_ptr<Table> t1 = OpenTable("t1");
+    MockTable* pri_t = static_cast<MockTable*>(t0.get());
+    MockTable* sec_t = static_cast<MockTable*>(t1.get());
+    PrepareSecondaryPrewrite(pri_t, sec_t, 2);
+    gtxn_.gtxn_internal_->is_timeout_ = true;
+
+    gtxn_.PrewriteSecondaries();
+    gtxn_.WaitForComplete();
+    EXPECT_EQ(gtxn_.status_.GetType(), ErrorCode::kGTxnPrewriteTimeout);
+    EXPECT_EQ(sec_t->ReaderNum(), 0);
+    EXPECT_EQ(sec_t->MutationNum(), 0);
+    EXPECT_EQ(pri_t->MutationNum(), 0);
+    EXPECT_TRUE(gtxn_.primary_ctx_ == NULL);
+    EXPECT_TRUE(gtxn_.secondary_prewrites_.empty());
+}
+
+TEST_F(GlobalTxnTest, PrewriteSecondariesTimeout1) {
+    // case b. one secondary read timeout
+    std::shared_ptr<Table> t0 = OpenTable("t0");
+    std::shared_ptr<Table> t1 = OpenTable("t1");
+    MockTable* pri_t = static_cast<MockTable*>(t0.get());
+    MockTable* sec_t = static_cast<MockTable*>(t1.get());
+    PrepareSecondaryPrewrite(pri_t, sec_t, 2);
+    std::vector<MockReaderResult> results = EmptyReaderResults(2);
+    results[1].status.SetFailed(ErrorCode::kTimeout, "");
+    sec_t->AddReaderResult(results);
+
+    gtxn_.PrewriteSecondaries();
+    gtxn_.WaitForComplete();
+    EXPECT_EQ(gtxn_.status_.GetType(), ErrorCode::kGTxnPrewriteTimeout);
+    EXPECT_EQ(sec_t->ReaderNum(), 2);
+    EXPECT_EQ(sec_t->MutationNum(), 0);
+    EXPECT_EQ(pri_t->MutationNum(), 0);
+    EXPECT_TRUE(gtxn_.primary_ctx_ == NULL);
+}
+
+TEST_F(GlobalTxnTest, PrewriteSecondariesVerifyPrimaryFailed) {
+    std::shared_ptr<Table> t0 = OpenTable("t0");
+    std::shared_ptr<Table> t1 = OpenTable("t1");
+    MockTable* pri_t = static_cast<MockTable*>(t0.get());
+    MockTable* sec_t = static_cast<MockTable*>(t1.get());
+    PrepareSecondaryPrewrite(pri_t, sec_t, 2);
+    delete gtxn_.primary_ctx_->stxn;
+    delete gtxn_.primary_ctx_;
+    gtxn_.primary_ctx_ = NULL;
+    gtxn_.prewrite_stage_pending_cnt_.Set(2);
+
+    // the primary "lock" is lost before the secondaries are prewritten
+    pri_t->AddReaderErrors(Errors({ErrorCode::kNotFound}));
+    sec_t->AddReaderResult(EmptyReaderResults(2));
+    sec_t->AddMutationErrors(Errors({ErrorCode::kOK, ErrorCode::kOK}));
+
+    gtxn_.VerifyPrimaryLocked();
+    EXPECT_FALSE(gtxn_.finish_);
+    gtxn_.PrewriteSecondaries();
+    gtxn_.WaitForComplete();
+    EXPECT_EQ(gtxn_.status_.GetType(), ErrorCode::kGTxnPrimaryLost);
+    EXPECT_EQ(sec_t->MutationNum(), 2);
+    EXPECT_EQ(sec_t->MutationBatchNum(), 1);
+    EXPECT_EQ(pri_t->MutationNum(), 0);
+    EXPECT_TRUE(gtxn_.primary_ctx_ == NULL);
+}
+
+TEST_F(GlobalTxnTest, PrewriteSecondariesPartialFailed) {
+    std::shared_ptr<Table> t0 = OpenTable("t0");
+    std::shared_ptr<Table> t1 = OpenTable("t1");
+    MockTable* pri_t = static_cast<MockTable*>(t0.get());
+    MockTable* sec_t = static_cast<MockTable*>(t1.get());
+    PrepareSecondaryPrewrite(pri_t, sec_t, 3);
+
+    // all rows are read, but only some of them are locked
+    sec_t->AddReaderResult(EmptyReaderResults(3));
+    sec_t->AddMutationErrors(Errors({ErrorCode::kOK, ErrorCode::kSystem, ErrorCode::kOK}));
+
+    gtxn_.PrewriteSecondaries();
+    gtxn_.WaitForComplete();
+    EXPECT_EQ(gtxn_.status_.GetType(), ErrorCode::kSystem);
+    EXPECT_EQ(sec_t->ReaderBatchNum(), 1);
+    EXPECT_EQ(sec_t->MutationNum(), 3);
+    EXPECT_EQ(sec_t->MutationBatchNum(), 1);
+    // the primary is never committed
+    EXPECT_EQ(pri_t->MutationNum(), 0);
+    EXPECT_TRUE(gtxn_.primary_ctx_ == NULL);
+    EXPECT_TRUE(gtxn_.secondary_prewrites_.empty());
+}
 
 } // namespace tera
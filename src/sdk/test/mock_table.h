@@ -35,6 +35,8 @@ public:
         mu_err_.clear();
         reader_pos_ = 0;
         mu_pos_ = 0;
+        reader_batch_cnt_ = 0;
+        mu_batch_cnt_ = 0;
     }
 
     void AddDelayTask(int64_t delay_time, ThreadPool::Task& task) {
@@ -58,6 +60,26 @@ public:
         r->RunCallback();
     }
 
+    void ApplyMutation(const std::vector<RowMutation*>& row_mutations, bool flush) {
+        mu_batch_cnt_++;
+        for (size_t i = 0; i < row_mutations.size(); ++i) {
+            ApplyMutation(row_mutations[i]);
+        }
+    }
+
+    void Get(const std::vector<RowReader*>& readers, bool flush) {
+        reader_batch_cnt_++;
+        for (size_t i = 0; i < readers.size(); ++i) {
+            Get(readers[i]);
+        }
+    }
+
+    // number of rows read / written, and of batches they are sent in
+    int ReaderNum() const { return reader_pos_; }
+    int MutationNum() const { return mu_pos_; }
+    int ReaderBatchNum() const { return reader_batch_cnt_; }
+    int MutationBatchNum() const { return mu_batch_cnt_; }
+
     void AddReaderResult(const std::vector<MockReaderResult>& results) {
         reader_result_.insert(reader_result_.end(),
                 results.begin(), results.end());    
@@ -77,6 +99,8 @@ private:
     std::vector<MockReaderResult> reader_result_;
     int reader_pos_;
     int mu_pos_;
+    int reader_batch_cnt_;
+    int mu_batch_cnt_;
 };
 
 } // namespace tera
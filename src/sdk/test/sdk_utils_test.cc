@@ -114,4 +114,53 @@ TEST(SdkUtilsTest, ExtendNotifyLgToDescriptor7) {
 	EXPECT_TRUE(schema.LocalityGroupNum() == before_num);
 }
 
+TEST(SdkUtilsTest, NotifyIndexRow) {
+    std::string row_key;
+    std::string index_row = PackNotifyIndexRow("www.baidu.com");
+    EXPECT_EQ(index_row.size(), 2 + std::string("www.baidu.com").size());
+    EXPECT_EQ(index_row, PackNotifyIndexRow("www.baidu.com"));
+    EXPECT_TRUE(UnpackNotifyIndexRow(index_row, &row_key));
+    EXPECT_EQ(row_key, "www.baidu.com");
+
+    index_row = PackNotifyIndexRow("");
+    EXPECT_TRUE(UnpackNotifyIndexRow(index_row, &row_key));
+    EXPECT_EQ(row_key, "");
+    EXPECT_FALSE(UnpackNotifyIndexRow("a", &row_key));
+
+    // rows are spread over buckets
+    std::set<std::string> buckets;
+    for (int i = 0; i < 1000; ++i) {
+        buckets.insert(PackNotifyIndexRow("row" + std::to_string(i)).substr(0, 2));
+    }
+    EXPECT_GT(buckets.size(), 100U);
+}
+
+TEST(SdkUtilsTest, BuildNotifyIndexDescriptor) {
+    tera::TableDescriptor desc;
+    BuildNotifyIndexDescriptor("t1", &desc);
+    EXPECT_EQ(desc.TableName(), "t1_notify_index");
+    EXPECT_EQ(desc.ColumnFamilyNum(), 1);
+    EXPECT_EQ(desc.ColumnFamily(0)->Name(), "_N_");
+}
+
+TEST(SdkUtilsTest, NotifyIndexProperty) {
+    tera::TableDescriptor desc("t1");
+    EXPECT_FALSE(desc.IsNotifyIndexEnabled());
+    EXPECT_FALSE(SetTableProperties("notify_index", "bad", &desc));
+    EXPECT_TRUE(SetTableProperties("notify_index", "on", &desc));
+    EXPECT_TRUE(desc.IsNotifyIndexEnabled());
+
+    TableSchema schema;
+    TableDescToSchema(desc, &schema);
+    EXPECT_TRUE(IsNotifyIndexEnabled(schema));
+    tera::TableDescriptor desc2("t1");
+    TableSchemaToDesc(schema, &desc2);
+    EXPECT_TRUE(desc2.IsNotifyIndexEnabled());
+
+    tera::TableDescriptor desc3("t1");
+    EXPECT_TRUE(SetTableProperties("notify_index", "off", &desc3));
+    TableDescToSchema(desc3, &schema);
+    EXPECT_FALSE(IsNotifyIndexEnabled(schema));
+}
+
 } // namespace tera
@@ -0,0 +1,158 @@
+// Copyright (c) 2015-2017, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "common/thread_pool.h"
+#include "sdk/single_row_txn.h"
+#include "sdk/test/mock_table.h"
+#include "sdk/transaction_wrapper.h"
+
+namespace tera {
+
+class SingleRowTxnTest : public ::testing::Test {
+public:
+    // status of an async reader or commit, set by its callback
+    struct Result {
+        SingleRowTxnTest* test;
+        ErrorCode::ErrorCodeType type;
+    };
+
+    SingleRowTxnTest() : thread_pool_(2), finished_(0) {}
+
+    std::shared_ptr<MockTable> OpenTable(const std::string& tablename) {
+        return std::shared_ptr<MockTable>(new MockTable(tablename, &thread_pool_));
+    }
+
+    std::vector<ErrorCode> Errors(const std::vector<ErrorCode::ErrorCodeType>& types) {
+        std::vector<ErrorCode> errs(types.size());
+        for (size_t i = 0; i < types.size(); ++i) {
+            errs[i].SetFailed(types[i], "");
+        }
+        return errs;
+    }
+
+    void Finish(Result* result, ErrorCode::ErrorCodeType type) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        result->type = type;
+        ++finished_;
+        cv_.notify_all();
+    }
+
+    void WaitFinished(int num) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this, num] { return finished_ >= num; });
+    }
+
+    static void ReaderCallback(RowReader* reader) {
+        Result* result = static_cast<Result*>(reader->GetContext());
+        result->test->Finish(result, reader->GetError().GetType());
+    }
+
+    static void CommitCallback(Transaction* txn) {
+        Result* result = static_cast<Result*>(txn->GetContext());
+        result->test->Finish(result, txn->GetError().GetType());
+    }
+
+protected:
+    common::ThreadPool thread_pool_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int finished_;
+};
+
+TEST_F(SingleRowTxnTest, BatchGet) {
+    std::shared_ptr<MockTable> t1 = OpenTable("t1");
+    std::shared_ptr<MockTable> t2 = OpenTable("t2");
+    t1->AddReaderErrors(Errors({ErrorCode::kOK, ErrorCode::kNotFound}));
+    t2->AddReaderErrors(Errors({ErrorCode::kSystem}));
+
+    std::vector<Transaction*> txns;
+    txns.push_back(t1->StartRowTransaction("r1"));
+    txns.push_back(t2->StartRowTransaction("r1"));
+    txns.push_back(t1->StartRowTransaction("r2"));
+    txns.push_back(t1->StartRowTransaction("r3"));
+    std::vector<RowReader*> readers;
+    readers.push_back(t1->NewRowReader("r1"));
+    readers.push_back(t2->NewRowReader("r1"));
+    readers.push_back(t1->NewRowReader("r2"));
+    // not the row of the txn, fails without being sent
+    readers.push_back(t1->NewRowReader("rx"));
+
+    std::vector<Result> results(txns.size(), Result{this, ErrorCode::kOK});
+    for (size_t i = 0; i < readers.size(); ++i) {
+        readers[i]->SetCallBack(ReaderCallback);
+        readers[i]->SetContext(&results[i]);
+    }
+    SingleRowTxn::BatchGet(txns, readers);
+    WaitFinished(txns.size());
+
+    EXPECT_EQ(results[0].type, ErrorCode::kOK);
+    EXPECT_EQ(results[1].type, ErrorCode::kSystem);
+    EXPECT_EQ(results[2].type, ErrorCode::kNotFound);
+    EXPECT_EQ(results[3].type, ErrorCode::kBadParam);
+    // one batch per table
+    EXPECT_EQ(t1->ReaderNum(), 2);
+    EXPECT_EQ(t1->ReaderBatchNum(), 1);
+    EXPECT_EQ(t2->ReaderNum(), 1);
+    EXPECT_EQ(t2->ReaderBatchNum(), 1);
+
+    for (size_t i = 0; i < txns.size(); ++i) {
+        delete readers[i];
+        delete txns[i];
+    }
+}
+
+TEST_F(SingleRowTxnTest, BatchCommit) {
+    std::shared_ptr<MockTable> t1 = OpenTable("t1");
+    std::shared_ptr<MockTable> t2 = OpenTable("t2");
+    t1->AddMutationErrors(Errors({ErrorCode::kOK, ErrorCode::kSystem}));
+    t2->AddMutationErrors(Errors({ErrorCode::kTimeout}));
+
+    std::vector<Transaction*> txns;
+    txns.push_back(t1->StartRowTransaction("r1"));
+    txns.push_back(t2->StartRowTransaction("r1"));
+    txns.push_back(t1->StartRowTransaction("r2"));
+    // nothing to commit, finishes without being sent
+    txns.push_back(t1->StartRowTransaction("r3"));
+    std::vector<Table*> tables = {t1.get(), t2.get(), t1.get()};
+    std::vector<std::string> rows = {"r1", "r1", "r2"};
+    for (size_t i = 0; i < tables.size(); ++i) {
+        std::unique_ptr<RowMutation> mu(tables[i]->NewRowMutation(rows[i]));
+        mu->Put("cf", "qu", "val");
+        txns[i]->ApplyMutation(mu.get());
+    }
+
+    std::vector<Result> results(txns.size(), Result{this, ErrorCode::kSystem});
+    for (size_t i = 0; i < txns.size(); ++i) {
+        txns[i]->SetCommitCallback(CommitCallback);
+        txns[i]->SetContext(&results[i]);
+    }
+    SingleRowTxn::BatchCommit(txns);
+    WaitFinished(txns.size());
+
+    EXPECT_EQ(results[0].type, ErrorCode::kOK);
+    EXPECT_EQ(results[1].type, ErrorCode::kTimeout);
+    EXPECT_EQ(results[2].type, ErrorCode::kSystem);
+    EXPECT_EQ(results[3].type, ErrorCode::kOK);
+    // one batch per table
+    EXPECT_EQ(t1->MutationNum(), 2);
+    EXPECT_EQ(t1->MutationBatchNum(), 1);
+    EXPECT_EQ(t2->MutationNum(), 1);
+    EXPECT_EQ(t2->MutationBatchNum(), 1);
+
+    for (size_t i = 0; i < txns.size(); ++i) {
+        delete txns[i];
+    }
+}
+
+} // namespace tera
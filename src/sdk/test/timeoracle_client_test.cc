@@ -0,0 +1,201 @@
+// Copyright (c) 2015, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+#include <sofa/pbrpc/pbrpc.h>
+
+#include "common/thread_pool.h"
+#include "proto/timeoracle_rpc.pb.h"
+#include "sdk/sdk_zk.h"
+#include "sdk/timeoracle_client_impl.h"
+
+namespace tera {
+namespace timeoracle {
+
+static const char* kFakeTimeoracleAddr = "127.0.0.1:28088";
+
+// Hands out timestamps from 1000 on, and can hold the rpcs until released,
+// so that requests of the client pile up behind the one in flight.
+class FakeTimeoracle : public TimeoracleServer {
+public:
+    FakeTimeoracle() : next_(1000), hold_(false) {}
+
+    virtual void GetTimestamp(::google::protobuf::RpcController* controller,
+                              const GetTimestampRequest* request,
+                              GetTimestampResponse* response,
+                              ::google::protobuf::Closure* done) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        counts_.push_back(request->count());
+        cv_.notify_all();
+        cv_.wait(lock, [this] { return !hold_; });
+        response->set_start_timestamp(next_);
+        response->set_count(request->count());
+        response->set_status(kTimeoracleOk);
+        next_ += request->count();
+        lock.unlock();
+        done->Run();
+    }
+
+    void Hold() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hold_ = true;
+    }
+
+    void Release() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hold_ = false;
+        cv_.notify_all();
+    }
+
+    void WaitRpcs(size_t num) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this, num] { return counts_.size() >= num; });
+    }
+
+    // count of each GetTimestamp rpc received
+    std::vector<uint32_t> Counts() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return counts_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int64_t next_;
+    bool hold_;
+    std::vector<uint32_t> counts_;
+};
+
+class FakeClusterFinder : public sdk::ClusterFinder {
+protected:
+    virtual bool ReadNode(const std::string& path, std::string* value) {
+        *value = kFakeTimeoracleAddr;
+        return true;
+    }
+    virtual std::string Name() { return "fake"; }
+    virtual std::string Authority() { return "localhost"; }
+    virtual std::string Path() { return "/"; }
+};
+
+class TimeoracleClientTest : public ::testing::Test {
+public:
+    TimeoracleClientTest() : thread_pool_(4), oracle_(new FakeTimeoracle) {}
+
+    virtual void SetUp() {
+        sofa::pbrpc::RpcServerOptions rpc_options;
+        server_.reset(new sofa::pbrpc::RpcServer(rpc_options));
+        ASSERT_TRUE(server_->RegisterService(oracle_));
+        ASSERT_TRUE(server_->Start(kFakeTimeoracleAddr));
+    }
+
+    virtual void TearDown() {
+        oracle_->Release();
+        server_->Stop();
+    }
+
+protected:
+    ThreadPool thread_pool_;
+    FakeClusterFinder finder_;
+    // owned by "server_"
+    FakeTimeoracle* oracle_;
+    std::unique_ptr<sofa::pbrpc::RpcServer> server_;
+};
+
+TEST_F(TimeoracleClientTest, CoalesceConcurrentRequests) {
+    TimeoracleClientImpl client(&thread_pool_, &finder_, 3000, true);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    const int kRequests = 10;
+    std::vector<int64_t> timestamps(kRequests, -1);
+    int finished = 0;
+    auto callback = [&] (int i, int64_t ts) {
+        std::lock_guard<std::mutex> lock(mutex);
+        timestamps[i] = ts;
+        ++finished;
+        cv.notify_all();
+    };
+
+    // the first request holds the rpc, the others queue up behind it
+    oracle_->Hold();
+    ASSERT_TRUE(client.GetTimestamp(1, std::bind(callback, 0, std::placeholders::_1)));
+    oracle_->WaitRpcs(1);
+    for (int i = 1; i < kRequests; ++i) {
+        ASSERT_TRUE(client.GetTimestamp(i, std::bind(callback, i, std::placeholders::_1)));
+    }
+    oracle_->Release();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return finished == kRequests; });
+    }
+
+    // one rpc for the first request, one for all the queued ones
+    std::vector<uint32_t> counts = oracle_->Counts();
+    ASSERT_EQ(counts.size(), 2U);
+    EXPECT_EQ(counts[0], 1U);
+    EXPECT_EQ(counts[1], static_cast<uint32_t>(kRequests * (kRequests - 1) / 2));
+    EXPECT_EQ(client.RpcCount(), 2);
+
+    // the range returned is handed out in queue order
+    EXPECT_EQ(timestamps[0], 1000);
+    EXPECT_EQ(timestamps[1], 1001);
+    for (int i = 2; i < kRequests; ++i) {
+        EXPECT_EQ(timestamps[i], timestamps[i - 1] + i - 1);
+    }
+}
+
+TEST_F(TimeoracleClientTest, MonotonicTimestamps) {
+    TimeoracleClientImpl client(&thread_pool_, &finder_, 3000, true);
+
+    const int kThreads = 8;
+    const int kRounds = 200;
+    std::vector<std::vector<int64_t> > timestamps(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&client, &timestamps, t] {
+            for (int i = 0; i < kRounds; ++i) {
+                timestamps[t].push_back(client.GetTimestamp(1));
+            }
+        });
+    }
+    for (int t = 0; t < kThreads; ++t) {
+        threads[t].join();
+    }
+
+    // a request never gets a timestamp older than any finished before it,
+    // and no timestamp is handed out twice
+    std::set<int64_t> all;
+    for (int t = 0; t < kThreads; ++t) {
+        for (int i = 0; i < kRounds; ++i) {
+            EXPECT_GT(timestamps[t][i], 0);
+            if (i > 0) {
+                EXPECT_GT(timestamps[t][i], timestamps[t][i - 1]);
+            }
+            all.insert(timestamps[t][i]);
+        }
+    }
+    EXPECT_EQ(all.size(), static_cast<size_t>(kThreads * kRounds));
+    EXPECT_LE(client.RpcCount(), kThreads * kRounds);
+
+    int64_t last = *all.rbegin();
+    EXPECT_GT(client.GetTimestamp(1), last);
+}
+
+TEST_F(TimeoracleClientTest, NoCoalesce) {
+    TimeoracleClientImpl client(&thread_pool_, &finder_, 3000, false);
+    int64_t ts = client.GetTimestamp(5);
+    EXPECT_EQ(ts, 1000);
+    EXPECT_EQ(client.GetTimestamp(1), 1005);
+    EXPECT_EQ(client.RpcCount(), 2);
+}
+
+} // namespace timeoracle
+} // namespace tera
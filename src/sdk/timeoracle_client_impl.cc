@@ -8,17 +8,33 @@
 
 #include "common/timer.h"
 
+DECLARE_int32(tera_sdk_tso_coalesce_max_count);
+
 namespace tera {
 namespace timeoracle {
 
 TimeoracleClientImpl::TimeoracleClientImpl(ThreadPool* thread_pool,
                                            sdk::ClusterFinder* cluster_finder,
-                                           int32_t rpc_timeout) :
+                                           int32_t rpc_timeout,
+                                           bool coalesce) :
     RpcClient<TimeoracleServer::Stub>(cluster_finder->TimeoracleAddr()),
     thread_pool_(thread_pool),
     rpc_timeout_(rpc_timeout),
     update_timestamp_(0),
-    cluster_finder_(cluster_finder) {}
+    cluster_finder_(cluster_finder),
+    coalesce_(coalesce),
+    rpc_count_(0),
+    rpc_inflight_(false) {
+    if (coalesce_) {
+        callback_pool_.reset(new ThreadPool(1));
+    }
+}
+
+TimeoracleClientImpl::~TimeoracleClientImpl() {
+    // wait for the coalesced rpc in flight, its callback refers to this
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    pending_cv_.wait(lock, [this] { return !rpc_inflight_ && pending_.empty(); });
+}
 
 void TimeoracleClientImpl::refresh_timeoracle_address(int64_t last_timestamp) {
     std::unique_lock<std::mutex>        lock_guard(mutex_);
@@ -34,6 +50,20 @@ void TimeoracleClientImpl::refresh_timeoracle_address(int64_t last_timestamp) {
 }
 
 int64_t TimeoracleClientImpl::GetTimestamp(uint32_t count) {
+    if (coalesce_) {
+        int64_t timestamp = 0;
+        bool done = false;
+        GetTimestamp(count, [this, &timestamp, &done] (int64_t ts) {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            timestamp = ts;
+            done = true;
+            pending_cv_.notify_all();
+        });
+        std::unique_lock<std::mutex> lock(pending_mutex_);
+        pending_cv_.wait(lock, [&done] { return done; });
+        return timestamp;
+    }
+
     GetTimestampRequest request;
     GetTimestampResponse response;
 
@@ -41,6 +71,7 @@ int64_t TimeoracleClientImpl::GetTimestamp(uint32_t count) {
 
     std::function<void (const GetTimestampRequest*, GetTimestampResponse*, bool, int)> done;
 
+    rpc_count_++;
     if (SendMessageWithRetry(&TimeoracleServer::Stub::GetTimestamp,
                              &request,
                              &response,
@@ -62,6 +93,15 @@ int64_t TimeoracleClientImpl::GetTimestamp(uint32_t count) {
 }
 
 bool TimeoracleClientImpl::GetTimestamp(uint32_t count, std::function<void (int64_t)> callback) {
+    if (coalesce_) {
+        std::unique_lock<std::mutex> lock(pending_mutex_);
+        pending_.push_back(Waiter{count, callback});
+        if (!rpc_inflight_) {
+            SendCoalescedRequest(&lock);
+        }
+        return true;
+    }
+
     auto request = new GetTimestampRequest();
     auto response = new GetTimestampResponse();
     request->set_count(count);
@@ -72,6 +112,7 @@ bool TimeoracleClientImpl::GetTimestamp(uint32_t count, std::function<void (int6
                     std::placeholders::_1, std::placeholders::_2,
                     std::placeholders::_3, std::placeholders::_4);
 
+    rpc_count_++;
     if (SendMessageWithRetry(&TimeoracleServer::Stub::GetTimestamp,
                              request,
                              response,
@@ -114,5 +155,81 @@ void TimeoracleClientImpl::OnRpcFinished(int64_t start_time,
     callback(ts);
 }
 
+void TimeoracleClientImpl::SendCoalescedRequest(std::unique_lock<std::mutex>* lock) {
+    std::vector<Waiter>* batch = new std::vector<Waiter>;
+    uint32_t count = 0;
+    while (!pending_.empty()) {
+        const Waiter& waiter = pending_.front();
+        if (!batch->empty()
+            && count + waiter.count > static_cast<uint32_t>(FLAGS_tera_sdk_tso_coalesce_max_count)) {
+            break;
+        }
+        count += waiter.count;
+        batch->push_back(waiter);
+        pending_.pop_front();
+    }
+    rpc_inflight_ = true;
+    lock->unlock();
+
+    auto request = new GetTimestampRequest();
+    auto response = new GetTimestampResponse();
+    request->set_count(count);
+    int64_t start_time = get_micros();
+
+    std::function<void (const GetTimestampRequest*, GetTimestampResponse*, bool, int)> done
+        = std::bind(&TimeoracleClientImpl::OnCoalescedRpcFinished, this, start_time, batch,
+                    std::placeholders::_1, std::placeholders::_2,
+                    std::placeholders::_3, std::placeholders::_4);
+
+    rpc_count_++;
+    if (!SendMessageWithRetry(&TimeoracleServer::Stub::GetTimestamp,
+                              request,
+                              response,
+                              done,
+                              "GetTimestamp",
+                              rpc_timeout_,
+                              callback_pool_.get())) {
+        // Rpc Failed
+        refresh_timeoracle_address(0);
+        done(request, response, true, 0);
+    }
+    lock->lock();
+}
+
+void TimeoracleClientImpl::OnCoalescedRpcFinished(int64_t start_time,
+                                                  std::vector<Waiter>* batch,
+                                                  const GetTimestampRequest* request,
+                                                  GetTimestampResponse* response,
+                                                  bool rpc_error,
+                                                  int  error_code) {
+    std::unique_ptr<std::vector<Waiter> > batch_hold(batch);
+    std::unique_ptr<const GetTimestampRequest> req_hold(request);
+    std::unique_ptr<GetTimestampResponse> res_hold(response);
+
+    int64_t ts = 0;
+    if (rpc_error) {
+        LOG(ERROR) << "RpcRequest failed for GetTimestamp, errno=" << error_code;
+        refresh_timeoracle_address(start_time);
+    } else if (response->status() == kTimeoracleOk) {
+        ts = response->start_timestamp();
+    }
+
+    // hand out the range in queue order
+    for (size_t i = 0; i < batch->size(); ++i) {
+        (*batch)[i].callback(ts);
+        if (ts != 0) {
+            ts += (*batch)[i].count;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    rpc_inflight_ = false;
+    if (!pending_.empty()) {
+        SendCoalescedRequest(&lock);
+    } else {
+        pending_cv_.notify_all();
+    }
+}
+
 } // namespace timeoracle
 } // namespace tera
@@ -5,8 +5,12 @@
 #ifndef TERA_SDK_TIMEORACLE_CLIENT_IMPL_H_
 #define TERA_SDK_TIMEORACLE_CLIENT_IMPL_H_
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <vector>
 #include <gflags/gflags.h>
 #include <sofa/pbrpc/pbrpc.h>
 
@@ -15,25 +19,51 @@
 #include "sdk/sdk_zk.h"
 
 DECLARE_int32(tera_rpc_timeout_period);
+DECLARE_bool(tera_sdk_tso_coalesce_enabled);
 
 namespace tera {
 namespace timeoracle {
 
+// With "coalesce" on, concurrent requests share one rpc: requests queued
+// while a GetTimestamp rpc is in flight are sent together as one request
+// for the sum of their counts once it returns, and the range returned is
+// handed out in queue order.  A request never gets a timestamp older than
+// any request finished before it was issued.  Callbacks of coalesced
+// requests run on a thread of the client, they should return quickly.
 class TimeoracleClientImpl : public RpcClient<TimeoracleServer::Stub> {
 public:
     TimeoracleClientImpl(ThreadPool* thread_pool,
             sdk::ClusterFinder* cluster_finder,
-            int32_t rpc_timeout = FLAGS_tera_rpc_timeout_period);
+            int32_t rpc_timeout = FLAGS_tera_rpc_timeout_period,
+            bool coalesce = FLAGS_tera_sdk_tso_coalesce_enabled);
 
-    ~TimeoracleClientImpl() {}
+    ~TimeoracleClientImpl();
 
     int64_t GetTimestamp(uint32_t count);
 
     bool GetTimestamp(uint32_t count, std::function<void (int64_t)> callback);
 
+    // number of GetTimestamp rpcs sent, for benchmark
+    int64_t RpcCount() const { return rpc_count_; }
+
 private:
+    struct Waiter {
+        uint32_t count;
+        std::function<void (int64_t)> callback;
+    };
+
     void refresh_timeoracle_address(int64_t last_timestamp);
 
+    // REQUIRES: mutex_ is held and no coalesced rpc is in flight
+    void SendCoalescedRequest(std::unique_lock<std::mutex>* lock);
+
+    void OnCoalescedRpcFinished(int64_t start_time,
+                                std::vector<Waiter>* batch,
+                                const GetTimestampRequest* request,
+                                GetTimestampResponse* response,
+                                bool rpc_error,
+                                int  error_code);
+
     void OnRpcFinished(int64_t start_time,
                        std::function<void (int64_t)> callback,
                        const GetTimestampRequest* request,
@@ -48,6 +78,16 @@ private:
     std::mutex                                              mutex_;
     int64_t                                                 update_timestamp_;
     sdk::ClusterFinder*                                     cluster_finder_;
+
+    const bool                                              coalesce_;
+    std::atomic<int64_t>                                    rpc_count_;
+    std::mutex                                              pending_mutex_;
+    std::condition_variable                                 pending_cv_;
+    std::deque<Waiter>                                      pending_;
+    bool                                                    rpc_inflight_;
+    // runs the callbacks of coalesced rpcs, so that callers blocked in
+    // GetTimestamp() on "thread_pool_" could not starve them
+    std::unique_ptr<ThreadPool>                             callback_pool_;
 };
 
 } // namespace timeoracle
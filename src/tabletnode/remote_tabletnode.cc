@@ -6,6 +6,7 @@
 
 #include <functional>
 #include <memory>
+#include <vector>
 
 #include "gflags/gflags.h"
 #include "glog/logging.h"
@@ -31,11 +32,11 @@ namespace tera {
 namespace tabletnode {
 
 //Add SubscriberType::SUM for caculating SLA
-tera::MetricCounter read_request_counter(kRequestCountMetric, kApiLabelRead, 
-                                         {SubscriberType::QPS, SubscriberType::SUM});
-tera::MetricCounter write_request_counter(kRequestCountMetric, kApiLabelWrite, 
-                                          {SubscriberType::QPS, SubscriberType::SUM});
-tera::MetricCounter scan_request_counter(kRequestCountMetric, kApiLabelScan, {SubscriberType::QPS});
+tera::StripedMetricCounter read_request_counter(kRequestCountMetric, kApiLabelRead, 
+                                                {SubscriberType::QPS, SubscriberType::SUM});
+tera::StripedMetricCounter write_request_counter(kRequestCountMetric, kApiLabelWrite, 
+                                                 {SubscriberType::QPS, SubscriberType::SUM});
+tera::StripedMetricCounter scan_request_counter(kRequestCountMetric, kApiLabelScan, {SubscriberType::QPS});
 
 tera::MetricCounter read_pending_counter(kPendingCountMetric, kApiLabelRead, {SubscriberType::LATEST}, false);
 tera::MetricCounter write_pending_counter(kPendingCountMetric, kApiLabelWrite, {SubscriberType::LATEST}, false);
@@ -43,19 +44,19 @@ tera::MetricCounter scan_pending_counter(kPendingCountMetric, kApiLabelScan, {Su
 tera::MetricCounter compact_pending_counter(kPendingCountMetric, kApiLabelCompact, {SubscriberType::LATEST}, false);
 
 //Add SubscriberType::SUM for caculating SLA
-tera::MetricCounter read_reject_counter(kRejectCountMetric, kApiLabelRead, 
-                                        {SubscriberType::QPS, SubscriberType::SUM});
-tera::MetricCounter write_reject_counter(kRejectCountMetric, kApiLabelWrite, 
-                                         {SubscriberType::QPS, SubscriberType::SUM});
-tera::MetricCounter scan_reject_counter(kRejectCountMetric, kApiLabelScan, {SubscriberType::QPS});
+tera::StripedMetricCounter read_reject_counter(kRejectCountMetric, kApiLabelRead, 
+                                               {SubscriberType::QPS, SubscriberType::SUM});
+tera::StripedMetricCounter write_reject_counter(kRejectCountMetric, kApiLabelWrite, 
+                                                {SubscriberType::QPS, SubscriberType::SUM});
+tera::StripedMetricCounter scan_reject_counter(kRejectCountMetric, kApiLabelScan, {SubscriberType::QPS});
 
-tera::MetricCounter finished_read_request_counter(kFinishedRequestCountMetric, kApiLabelRead, {SubscriberType::QPS});
-tera::MetricCounter finished_write_request_counter(kFinishedRequestCountMetric, kApiLabelWrite, {SubscriberType::QPS});
-tera::MetricCounter finished_scan_request_counter(kFinishedRequestCountMetric, kApiLabelScan, {SubscriberType::QPS});
+tera::StripedMetricCounter finished_read_request_counter(kFinishedRequestCountMetric, kApiLabelRead, {SubscriberType::QPS});
+tera::StripedMetricCounter finished_write_request_counter(kFinishedRequestCountMetric, kApiLabelWrite, {SubscriberType::QPS});
+tera::StripedMetricCounter finished_scan_request_counter(kFinishedRequestCountMetric, kApiLabelScan, {SubscriberType::QPS});
 
-tera::MetricCounter read_delay(kRequestDelayMetric, kApiLabelRead, {});
-tera::MetricCounter write_delay(kRequestDelayMetric, kApiLabelWrite, {});
-tera::MetricCounter scan_delay(kRequestDelayMetric, kApiLabelScan, {});
+tera::StripedMetricCounter read_delay(kRequestDelayMetric, kApiLabelRead, {});
+tera::StripedMetricCounter write_delay(kRequestDelayMetric, kApiLabelWrite, {});
+tera::StripedMetricCounter scan_delay(kRequestDelayMetric, kApiLabelScan, {});
 
 tera::AutoSubscriberRegister rand_read_delay_per_request(std::unique_ptr<Subscriber>(new tera::RatioSubscriber(
     MetricId(kRequestDelayAvgMetric, kApiLabelRead),
@@ -72,12 +73,13 @@ tera::AutoSubscriberRegister scan_delay_per_request(std::unique_ptr<Subscriber>(
     std::unique_ptr<Subscriber>(new tera::PrometheusSubscriber(MetricId(kRequestDelayMetric, kApiLabelScan), SubscriberType::SUM)),
     std::unique_ptr<Subscriber>(new tera::PrometheusSubscriber(MetricId(kFinishedRequestCountMetric, kApiLabelScan), SubscriberType::SUM)))));
 
-tera::PercentileCounter write_95(kRequestDelayPercentileMetric, kWriteLabelPercentile95, 95);
-tera::PercentileCounter write_99(kRequestDelayPercentileMetric, kWriteLabelPercentile99, 99);
-tera::PercentileCounter read_95(kRequestDelayPercentileMetric, kReadLabelPercentile95, 95);
-tera::PercentileCounter read_99(kRequestDelayPercentileMetric, kReadLabelPercentile99, 99);
-tera::PercentileCounter scan_95(kRequestDelayPercentileMetric, kScanLabelPercentile95, 95);
-tera::PercentileCounter scan_99(kRequestDelayPercentileMetric, kScanLabelPercentile99, 99);
+// labeled as kWriteLabelPercentile95, kWriteLabelPercentile99, ...
+tera::PercentileCounter write_percentile(kRequestDelayPercentileMetric, kApiLabelWrite,
+                                         std::vector<double>{95, 99, 99.9});
+tera::PercentileCounter read_percentile(kRequestDelayPercentileMetric, kApiLabelRead,
+                                        std::vector<double>{95, 99, 99.9});
+tera::PercentileCounter scan_percentile(kRequestDelayPercentileMetric, kApiLabelScan,
+                                        std::vector<double>{95, 99, 99.9});
 
 
 void ReadDoneWrapper::Run() {
@@ -90,8 +92,10 @@ void ReadDoneWrapper::Run() {
     finished_read_request_counter.Add(row_num);
     read_delay.Add(used_us);
     if (row_num > 0) {
-        read_95.Append(used_us / row_num);
-        read_99.Append(used_us / row_num);
+        read_percentile.Append(used_us / row_num);
+    }
+    if (trace_ != NULL) {
+        trace_->Finish(now_us);
     }
     delete this;
 }
@@ -106,8 +110,10 @@ void WriteDoneWrapper::Run() {
     finished_write_request_counter.Add(row_num);
     write_delay.Add(used_us);
     if (row_num > 0) {
-        write_95.Append(used_us / row_num);
-        write_99.Append(used_us / row_num);
+        write_percentile.Append(used_us / row_num);
+    }
+    if (trace_ != NULL) {
+        trace_->Finish(now_us);
     }
     delete this;
 }
@@ -123,8 +129,7 @@ void ScanDoneWrapper::Run() {
         finished_scan_request_counter.Add(row_num);
         scan_delay.Add(used_us);
         if (row_num > 0) {
-            scan_95.Append(used_us / row_num);
-            scan_99.Append(used_us / row_num);
+            scan_percentile.Append(used_us / row_num);
         }
     }
     delete this;
@@ -142,14 +147,15 @@ struct ReadRpc : public RpcTask {
     google::protobuf::Closure* done;
     ReadRpcTimer* timer;
     int64_t start_micros;
+    io::RequestTrace* trace;
 
     ReadRpc(google::protobuf::RpcController* ctrl,
             const ReadTabletRequest* req, ReadTabletResponse* resp,
             google::protobuf::Closure* done, ReadRpcTimer* timer,
-            int64_t start_micros)
+            int64_t start_micros, io::RequestTrace* trace)
       : RpcTask(RPC_READ), controller(ctrl), request(req),
         response(resp), done(done), timer(timer),
-        start_micros(start_micros) {}
+        start_micros(start_micros), trace(trace) {}
 };
 
 struct ScanRpc : public RpcTask {
@@ -206,7 +212,8 @@ void RemoteTabletNode::ReadTablet(google::protobuf::RpcController* controller,
                                   ReadTabletResponse* response,
                                   google::protobuf::Closure* done) {
     int64_t start_micros = get_micros();
-    done = ReadDoneWrapper::NewInstance(start_micros, request, response, done);
+    io::RequestTrace* trace = io::RequestTrace::Sample(io::RequestTrace::kRead, start_micros);
+    done = ReadDoneWrapper::NewInstance(start_micros, request, response, done, trace);
     VLOG(8) << "accept RPC (ReadTablet): [" << request->tablet_name() << "] " << tera::utils::GetRemoteAddress(controller);
     static uint32_t last_print = time(NULL);
     int32_t row_num = request->row_info_list_size();
@@ -228,7 +235,7 @@ void RemoteTabletNode::ReadTablet(google::protobuf::RpcController* controller,
         RpcTimerList::Instance()->Push(timer);
 
         ReadRpc* rpc = new ReadRpc(controller, request, response, done,
-                                   timer, start_micros);
+                                   timer, start_micros, trace);
         read_rpc_schedule_->EnqueueRpc(request->tablet_name(), rpc);
         read_thread_pool_->AddTask(std::bind(&RemoteTabletNode::DoScheduleRpc, this,
                                              read_rpc_schedule_.get()));
@@ -240,7 +247,8 @@ void RemoteTabletNode::WriteTablet(google::protobuf::RpcController* controller,
                                    WriteTabletResponse* response,
                                    google::protobuf::Closure* done) {
     int64_t start_micros = get_micros();
-    done = WriteDoneWrapper::NewInstance(start_micros, request, response, done);
+    io::RequestTrace* trace = io::RequestTrace::Sample(io::RequestTrace::kWrite, start_micros);
+    done = WriteDoneWrapper::NewInstance(start_micros, request, response, done, trace);
     VLOG(8) << "accept RPC (WriteTablet): [" << request->tablet_name() << "] " << tera::utils::GetRemoteAddress(controller);
     static uint32_t last_print = time(NULL);
     int32_t row_num = request->row_list_size();
@@ -262,7 +270,7 @@ void RemoteTabletNode::WriteTablet(google::protobuf::RpcController* controller,
         RpcTimerList::Instance()->Push(timer);
         ThreadPool::Task callback =
             std::bind(&RemoteTabletNode::DoWriteTablet, this,
-                      controller, request, response, done, timer);
+                      controller, request, response, done, timer, trace);
         write_thread_pool_->AddTask(callback);
     }
 }
@@ -338,6 +346,31 @@ void RemoteTabletNode::ComputeSplitKey(google::protobuf::RpcController* controll
     ctrl_thread_pool_->AddTask(callback);
 }
 
+void RemoteTabletNode::GetHotBlocks(google::protobuf::RpcController* controller,
+                                    const GetHotBlocksRequest* request,
+                                    GetHotBlocksResponse* response,
+                                    google::protobuf::Closure* done) {
+    uint64_t id = request->sequence_id();
+    LOG(INFO) << "accept RPC (GetHotBlocks) id: " << id << ", src: " << tera::utils::GetRemoteAddress(controller);
+    ThreadPool::Task callback =
+        std::bind(&RemoteTabletNode::DoGetHotBlocks, this, controller,
+                  request, response, done);
+    ctrl_thread_pool_->AddTask(callback);
+}
+
+void RemoteTabletNode::PrewarmTablet(google::protobuf::RpcController* controller,
+                                     const PrewarmTabletRequest* request,
+                                     PrewarmTabletResponse* response,
+                                     google::protobuf::Closure* done) {
+    uint64_t id = request->sequence_id();
+    LOG(INFO) << "accept RPC (PrewarmTablet) id: " << id << ", src: " << tera::utils::GetRemoteAddress(controller);
+    // reading files may take long, keep it out of the ctrl threads
+    ThreadPool::Task callback =
+        std::bind(&RemoteTabletNode::DoPrewarmTablet, this, controller,
+                  request, response, done);
+    compact_thread_pool_->AddTask(callback);
+}
+
 void RemoteTabletNode::CompactTablet(google::protobuf::RpcController* controller,
                                    const CompactTabletRequest* request,
                                    CompactTabletResponse* response,
@@ -396,8 +429,12 @@ void RemoteTabletNode::DoReadTablet(google::protobuf::RpcController* controller,
                                     const ReadTabletRequest* request,
                                     ReadTabletResponse* response,
                                     google::protobuf::Closure* done,
-                                    ReadRpcTimer* timer) {
+                                    ReadRpcTimer* timer,
+                                    io::RequestTrace* trace) {
     VLOG(8) << "run RPC (ReadTablet)";
+    if (trace != NULL) {
+        trace->Add(io::RequestTrace::kReadSchedule, get_micros() - start_micros);
+    }
     int32_t row_num = request->row_info_list_size();
     read_pending_counter.Sub(row_num);
 
@@ -414,7 +451,7 @@ void RemoteTabletNode::DoReadTablet(google::protobuf::RpcController* controller,
     }
 
     if (!is_read_timeout) {
-        tabletnode_impl_->ReadTablet(start_micros, request, response, done);
+        tabletnode_impl_->ReadTablet(start_micros, request, response, done, trace);
     } else {
         response->set_sequence_id(request->sequence_id());
         response->set_success_num(0);
@@ -434,11 +471,15 @@ void RemoteTabletNode::DoWriteTablet(google::protobuf::RpcController* controller
                                      const WriteTabletRequest* request,
                                      WriteTabletResponse* response,
                                      google::protobuf::Closure* done,
-                                     WriteRpcTimer* timer) {
+                                     WriteRpcTimer* timer,
+                                     io::RequestTrace* trace) {
     VLOG(8) << "run RPC (WriteTablet)";
+    if (trace != NULL) {
+        trace->Add(io::RequestTrace::kWriteQueue, get_micros() - trace->StartMicros());
+    }
     int32_t row_num = request->row_list_size();
     write_pending_counter.Sub(row_num);
-    tabletnode_impl_->WriteTablet(request, response, done, timer);
+    tabletnode_impl_->WriteTablet(request, response, done, timer, trace);
     VLOG(8) << "finish RPC (WriteTablet)";
 }
 
@@ -496,6 +537,26 @@ void RemoteTabletNode::DoComputeSplitKey(google::protobuf::RpcController* contro
     LOG(INFO) << "finish RPC (ComputeSplitKey) id: " << id;
 }
 
+void RemoteTabletNode::DoGetHotBlocks(google::protobuf::RpcController* controller,
+                                      const GetHotBlocksRequest* request,
+                                      GetHotBlocksResponse* response,
+                                      google::protobuf::Closure* done) {
+    uint64_t id = request->sequence_id();
+    LOG(INFO) << "run RPC (GetHotBlocks) id: " << id;
+    tabletnode_impl_->GetHotBlocks(request, response, done);
+    LOG(INFO) << "finish RPC (GetHotBlocks) id: " << id;
+}
+
+void RemoteTabletNode::DoPrewarmTablet(google::protobuf::RpcController* controller,
+                                       const PrewarmTabletRequest* request,
+                                       PrewarmTabletResponse* response,
+                                       google::protobuf::Closure* done) {
+    uint64_t id = request->sequence_id();
+    LOG(INFO) << "run RPC (PrewarmTablet) id: " << id;
+    tabletnode_impl_->PrewarmTablet(request, response, done);
+    LOG(INFO) << "finish RPC (PrewarmTablet) id: " << id;
+}
+
 void RemoteTabletNode::DoCompactTablet(google::protobuf::RpcController* controller,
                                      const CompactTabletRequest* request,
                                      CompactTabletResponse* response,
@@ -529,7 +590,7 @@ void RemoteTabletNode::DoScheduleRpc(RpcSchedule* rpc_schedule) {
         table_name = read_rpc->request->tablet_name();
         DoReadTablet(read_rpc->controller, read_rpc->start_micros,
                      read_rpc->request, read_rpc->response,
-                     read_rpc->done,read_rpc->timer);
+                     read_rpc->done, read_rpc->timer, read_rpc->trace);
     } break;
     case RPC_SCAN: {
         ScanRpc* scan_rpc = (ScanRpc*)rpc;
@@ -9,6 +9,7 @@
 #include "common/thread_pool.h"
 #include "common/request_done_wrapper.h"
 
+#include "io/request_trace.h"
 #include "proto/tabletnode_rpc.pb.h"
 #include "tabletnode/rpc_schedule.h"
 #include "utils/rpc_timer_list.h"
@@ -21,60 +22,74 @@ class TabletNodeImpl;
 
 class ReadDoneWrapper final : public RequestDoneWrapper {
 public:
+    // take the ownership of "trace"
     static google::protobuf::Closure* NewInstance(int64_t start_micros,
                                                   const ReadTabletRequest* request,
                                                   ReadTabletResponse* response,
-                                                  google::protobuf::Closure* done) {
-        return new ReadDoneWrapper(start_micros, request, response, done);
+                                                  google::protobuf::Closure* done,
+                                                  io::RequestTrace* trace = NULL) {
+        return new ReadDoneWrapper(start_micros, request, response, done, trace);
     }
 
     virtual void Run() override;
 
-    virtual ~ReadDoneWrapper() {}
+    virtual ~ReadDoneWrapper() {
+        delete trace_;
+    }
 
 protected:
     //Just Can Create on Heap;
     ReadDoneWrapper(int64_t start_micros,
                     const ReadTabletRequest* request,
                     ReadTabletResponse* response,
-                    google::protobuf::Closure* done):
+                    google::protobuf::Closure* done,
+                    io::RequestTrace* trace):
         RequestDoneWrapper(done),
         start_micros_(start_micros),
         request_(request),
-        response_(response) {}
+        response_(response),
+        trace_(trace) {}
 
     int64_t start_micros_;
     const ReadTabletRequest* request_;
     ReadTabletResponse* response_;
+    io::RequestTrace* trace_;
 };
 
 class WriteDoneWrapper final : public RequestDoneWrapper {
 public:
+    // take the ownership of "trace"
     static google::protobuf::Closure* NewInstance(int64_t start_micros,
                                                   const WriteTabletRequest* request,
                                                   WriteTabletResponse* response,
-                                                  google::protobuf::Closure* done) {
-        return new WriteDoneWrapper(start_micros, request, response, done);
+                                                  google::protobuf::Closure* done,
+                                                  io::RequestTrace* trace = NULL) {
+        return new WriteDoneWrapper(start_micros, request, response, done, trace);
     }
 
     virtual void Run() override;
 
-    virtual ~WriteDoneWrapper() {}
+    virtual ~WriteDoneWrapper() {
+        delete trace_;
+    }
 
 protected:
     //Just Can Create on Heap;
     WriteDoneWrapper(int64_t start_micros,
                      const WriteTabletRequest* request,
                      WriteTabletResponse* response,
-                     google::protobuf::Closure* done):
+                     google::protobuf::Closure* done,
+                     io::RequestTrace* trace):
         RequestDoneWrapper(done),
         start_micros_(start_micros),
         request_(request),
-        response_(response) {}
+        response_(response),
+        trace_(trace) {}
 
     int64_t start_micros_;
     const WriteTabletRequest* request_;
     WriteTabletResponse* response_;
+    io::RequestTrace* trace_;
 };
 
 class ScanDoneWrapper final : public RequestDoneWrapper {
@@ -151,6 +166,16 @@ public:
                      SplitTabletResponse* response,
                      google::protobuf::Closure* done);
 
+    void GetHotBlocks(google::protobuf::RpcController* controller,
+                      const GetHotBlocksRequest* request,
+                      GetHotBlocksResponse* response,
+                      google::protobuf::Closure* done);
+
+    void PrewarmTablet(google::protobuf::RpcController* controller,
+                       const PrewarmTabletRequest* request,
+                       PrewarmTabletResponse* response,
+                       google::protobuf::Closure* done);
+
     void CompactTablet(google::protobuf::RpcController* controller,
                        const CompactTabletRequest* request,
                        CompactTabletResponse* response,
@@ -182,13 +207,15 @@ private:
                       const ReadTabletRequest* request,
                       ReadTabletResponse* response,
                       google::protobuf::Closure* done,
-                      ReadRpcTimer* timer = NULL);
+                      ReadRpcTimer* timer = NULL,
+                      io::RequestTrace* trace = NULL);
 
     void DoWriteTablet(google::protobuf::RpcController* controller,
                        const WriteTabletRequest* request,
                        WriteTabletResponse* response,
                        google::protobuf::Closure* done,
-                       WriteRpcTimer* timer = NULL);
+                       WriteRpcTimer* timer = NULL,
+                       io::RequestTrace* trace = NULL);
 
     void DoQuery(google::protobuf::RpcController* controller,
                  const QueryRequest* request, QueryResponse* response,
@@ -209,6 +236,16 @@ private:
                        SplitTabletResponse* response,
                        google::protobuf::Closure* done);
 
+    void DoGetHotBlocks(google::protobuf::RpcController* controller,
+                        const GetHotBlocksRequest* request,
+                        GetHotBlocksResponse* response,
+                        google::protobuf::Closure* done);
+
+    void DoPrewarmTablet(google::protobuf::RpcController* controller,
+                         const PrewarmTabletRequest* request,
+                         PrewarmTabletResponse* response,
+                         google::protobuf::Closure* done);
+
     void DoMergeTablet(google::protobuf::RpcController* controller,
                        const MergeTabletRequest* request,
                        MergeTabletResponse* response,
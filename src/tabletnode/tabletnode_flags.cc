@@ -52,4 +52,16 @@ DEFINE_bool(tera_tabletnode_dump_running_info, true, "dump tabletnode running in
 DEFINE_string(tera_tabletnode_running_info_dump_file, "../monitor/ts.info.data", "file path for dump running info");
 DEFINE_int64(tera_refresh_tablets_status_interval_ms, 1800000, "background thread refresh tablets status interval in ms, default 0.5h");
 
+DEFINE_bool(tera_tabletnode_shared_log_enabled, false, "all tablets on a tabletnode write to a node-level shared commit log instead of their own logs");
+DEFINE_int64(tera_tabletnode_shared_log_file_size, 64, "the shared commit log file size (in MB)");
+DEFINE_int32(tera_tabletnode_shared_log_max_num, 32, "the max number of shared commit log files before tablets keeping the oldest one alive dump memtables");
+DEFINE_int32(tera_tabletnode_shared_log_flush_period, 60, "the period (in sec) to dump memtables of idle tablets keeping old shared commit logs alive");
+
+DEFINE_int32(tera_tabletnode_flush_rate_limit, 0, "the max write rate (in MB/s) of the memtable dumps of all tablets, 0 means no limit");
+DEFINE_int32(tera_tabletnode_l0_compact_rate_limit, 0, "the max write rate (in MB/s) of the level 0 compactions of all tablets, 0 means no limit");
+DEFINE_int32(tera_tabletnode_deep_compact_rate_limit, 0, "the max write rate (in MB/s) of the other compactions of all tablets, 0 means no limit");
+DEFINE_int64(tera_tabletnode_compact_rate_target_read_latency, 0, "cut the compaction rates while the read p99 latency (in us) is above it, and raise them back while it is below the half, 0 means no tuning");
+DEFINE_double(tera_tabletnode_compact_rate_busy_workload, 10.0, "the write workload (compaction score) of a tablet at which the compaction rates are raised back whatever the read latency, they are no longer cut above its half");
+DEFINE_int32(tera_tabletnode_mmap_read_budget, 4096, "the max size (in MB) of the sst files mapped by the flash and memory lgs of all tablets with --tera_leveldb_use_mmap_read");
+
 DEFINE_bool(tera_tabletnode_dump_level_size_info_enabled, false, "enable dump level size or not, it's mainly used for performance-test");
@@ -13,10 +13,12 @@
 #include <gperftools/malloc_extension.h>
 
 #include "db/filename.h"
+#include "db/shared_log.h"
 #include "db/table_cache.h"
 #include "common/base/string_ext.h"
 #include "common/metric/cache_collector.h"
 #include "common/metric/prometheus_subscriber.h"
+#include "common/metric/rate_limiter_collector.h"
 #include "common/metric/ratio_collector.h"
 #include "common/metric/metric_counter.h"
 #include "common/thread.h"
@@ -28,6 +30,7 @@
 #include "leveldb/env_flash.h"
 #include "leveldb/env_inmem.h"
 #include "leveldb/config.h"
+#include "leveldb/rate_limiter.h"
 #include "leveldb/slog.h"
 #include "leveldb/table_utils.h"
 #include "proto/kv_helper.h"
@@ -69,6 +72,20 @@ DECLARE_int32(tera_tabletnode_block_cache_size);
 DECLARE_int32(tera_tabletnode_table_cache_size);
 DECLARE_int32(tera_tabletnode_compact_thread_num);
 DECLARE_string(tera_tabletnode_path_prefix);
+DECLARE_string(tera_tabletnode_shared_log_dir);
+DECLARE_bool(tera_tabletnode_shared_log_enabled);
+DECLARE_int64(tera_tabletnode_shared_log_file_size);
+DECLARE_int32(tera_tabletnode_shared_log_max_num);
+DECLARE_int32(tera_tabletnode_shared_log_flush_period);
+DECLARE_int64(tera_tablet_write_log_time_out);
+DECLARE_int32(tera_tablet_max_block_log_number);
+DECLARE_int32(tera_tabletnode_flush_rate_limit);
+DECLARE_int32(tera_tabletnode_l0_compact_rate_limit);
+DECLARE_int32(tera_tabletnode_deep_compact_rate_limit);
+DECLARE_int64(tera_tabletnode_compact_rate_target_read_latency);
+DECLARE_double(tera_tabletnode_compact_rate_busy_workload);
+DECLARE_int32(tera_tabletnode_mmap_read_budget);
+DECLARE_bool(tera_leveldb_use_mmap_read);
 
 // cache-related
 DECLARE_int32(tera_memenv_block_cache_size);
@@ -171,6 +188,8 @@ TabletNodeImpl::TabletNodeImpl()
         leveldb::NewLRUCache(FLAGS_tera_memenv_block_cache_size * 1024UL * 1024);
     ldb_table_cache_ =
         new leveldb::TableCache(FLAGS_tera_tabletnode_table_cache_size * 1024UL * 1024);
+    ldb_shared_log_ = NULL;
+    ldb_rate_limiter_ = NULL;
     if (!s.ok()) {
         ldb_logger_ = NULL;
     }
@@ -181,6 +200,18 @@ TabletNodeImpl::TabletNodeImpl()
 
     InitCacheSystem();
 
+    if (FLAGS_tera_tabletnode_shared_log_enabled) {
+        InitSharedLog();
+    }
+    InitRateLimiter();
+
+    if (FLAGS_tera_leveldb_use_mmap_read) {
+        LOG(INFO) << "mmap sst files of flash and memory lgs up to "
+            << FLAGS_tera_tabletnode_mmap_read_budget << " MB";
+        leveldb::SetMmapReadBudget(
+            static_cast<uint64_t>(FLAGS_tera_tabletnode_mmap_read_budget) << 20);
+    }
+
     if (FLAGS_tera_tabletnode_tcm_cache_release_enabled) {
         LOG(INFO) << "enable tcmalloc cache release timer";
         EnableReleaseMallocCacheTimer();
@@ -421,6 +452,8 @@ void TabletNodeImpl::LoadTablet(const LoadTabletRequest* request,
             << ", schema: " << request->schema().ShortDebugString();
         ///TODO: User per user memery_cache according to user quota.
         tablet_io->SetMemoryCache(m_memory_cache);
+        tablet_io->SetSharedLog(ldb_shared_log_);
+        tablet_io->SetRateLimiter(ldb_rate_limiter_);
         if (!tablet_io->Load(schema, request->path(), parent_tablets,
                              ignore_err_lgs, ldb_logger_,
                              ldb_block_cache_, ldb_table_cache_, &status)) {
@@ -593,7 +626,8 @@ void TabletNodeImpl::Update(const UpdateRequest* request,
 void TabletNodeImpl::ReadTablet(int64_t start_micros,
                                 const ReadTabletRequest* request,
                                 ReadTabletResponse* response,
-                                google::protobuf::Closure* done) {
+                                google::protobuf::Closure* done,
+                                io::RequestTrace* trace) {
     bool is_timeout = false;
     int32_t row_num = request->row_info_list_size();
     uint64_t snapshot_id = request->snapshot_id() == 0 ? 0 : request->snapshot_id();
@@ -620,7 +654,7 @@ void TabletNodeImpl::ReadTablet(int64_t start_micros,
             VLOG(20) << "time_remain_ms: " << time_remain_ms;
             if (tablet_io->ReadCells(request->row_info_list(i),
                                      response->mutable_detail()->add_row_result(),
-                                     snapshot_id, &row_status, time_remain_ms)) {
+                                     snapshot_id, &row_status, time_remain_ms, trace)) {
                 read_success_num++;
             } else {
                 if (row_status != kKeyNotExist && row_status != kRPCTimeout) {
@@ -658,7 +692,8 @@ void TabletNodeImpl::ReadTablet(int64_t start_micros,
 void TabletNodeImpl::WriteTablet(const WriteTabletRequest* request,
                                  WriteTabletResponse* response,
                                  google::protobuf::Closure* done,
-                                 WriteRpcTimer* timer) {
+                                 WriteRpcTimer* timer,
+                                 io::RequestTrace* trace) {
     response->set_sequence_id(request->sequence_id());
     StatusCode status = kTabletNodeOk;
 
@@ -717,7 +752,7 @@ void TabletNodeImpl::WriteTablet(const WriteTabletRequest* request,
                                      request->is_instant(),
                                      std::bind(&TabletNodeImpl::WriteTabletCallback, this,
                                                tablet_task, _1, _2),
-                                     &status)) {
+                                     &status, trace)) {
             tablet_io->DecRef();
             WriteTabletFail(tablet_task, status);
         } else {
@@ -831,6 +866,7 @@ void TabletNodeImpl::RefreshSysInfo() {
     sysinfo_.CollectTabletNodeInfo(tablet_manager_.get(), local_addr_);
     sysinfo_.CollectHardwareInfo();
     sysinfo_.SetTimeStamp(cur_ts);
+    TuneRateLimiter();
 
     VLOG(15) << "collect sysinfo finished, time used: " << get_micros() - cur_ts << " us.";
 }
@@ -881,6 +917,16 @@ void TabletNodeImpl::SplitTablet(const SplitTabletRequest* request,
                                                 request->key_range().key_start(),
                                                 request->key_range().key_end(),
                                                 &status);
+    if (tablet_io == NULL && request->child_tablets_size() == 2
+        && OnlineSplitDone(request)) {
+        // master retries an online split whose reply was lost
+        LOG(INFO) << "[split] children already served: " << request->tablet_name()
+            << ", split key: " << DebugString(split_key);
+        response->set_status(kTabletNodeOk);
+        response->add_split_keys(split_key);
+        done->Run();
+        return;
+    }
     if (tablet_io == NULL) {
         LOG(WARNING) << "split fail to get tablet: " << request->tablet_name()
             << " [" << DebugString(request->key_range().key_start())
@@ -895,17 +941,9 @@ void TabletNodeImpl::SplitTablet(const SplitTabletRequest* request,
         LOG(ERROR) << kSms <<"SplitRequest without master_update_meta, maybe "
                 "request from old master, refuse split!" << *tablet_io;
         response->set_status(kTableNotSupport);
+        tablet_io->DecRef();
         done->Run();
-
-    }
-
-    // Master is not responsible for update children tablets to meta table, refuse to split
-    if (!request->has_master_update_meta() || !request->master_update_meta()) {
-        LOG(WARNING) <<"SplitRequest without master_update_meta, maybe "
-                "request from old master, refuse split!" << *tablet_io;
-        response->set_status(kTableNotSupport);
-        done->Run();
-
+        return;
     }
 
     if (!tablet_io->Split(&split_key, &status)) {
@@ -927,6 +965,12 @@ void TabletNodeImpl::SplitTablet(const SplitTabletRequest* request,
         << ", " << DebugString(tablet_io->GetEndKey())
         << "], split key: " << DebugString(split_key);
 
+    if (request->child_tablets_size() == 2) {
+        OnlineSplitTablet(request, split_key, tablet_io, response);
+        done->Run();
+        return;
+    }
+
     if (!tablet_io->Unload(&status)) {
         LOG(ERROR) << "fail to unload tablet: " << tablet_io->GetTablePath()
             << " [" << DebugString(tablet_io->GetStartKey())
@@ -959,6 +1003,100 @@ void TabletNodeImpl::SplitTablet(const SplitTabletRequest* request,
     done->Run();
 }
 
+// Split without unloading the tablet through master: dump the memtable and
+// load both children on this node at once. Children inherit all sst files of
+// the parent and share its opened tables and cached blocks, so the range is
+// only unavailable for the memtable dump and the opening of the children.
+// Master has written the children to meta before, so once the parent is
+// unloaded there is no way back: a child failing to load is left to master,
+// which loads the missing one, and a child loaded already keeps serving.
+void TabletNodeImpl::OnlineSplitTablet(const SplitTabletRequest* request,
+                                       const std::string& split_key,
+                                       io::TabletIO* tablet_io,
+                                       SplitTabletResponse* response) {
+    int64_t start_micros = get_micros();
+    const std::string& table_name = request->tablet_name();
+    std::string parent_path = tablet_io->GetTablePath();
+    std::string key_range[3] = {tablet_io->GetStartKey(), split_key, tablet_io->GetEndKey()};
+    TableSchema schema;
+    schema.CopyFrom(tablet_io->GetSchema());
+
+    StatusCode status = kTabletNodeOk;
+    bool unloaded = tablet_io->Unload(&status, true);
+    tablet_io->DecRef();
+    if (!unloaded) {
+        LOG(ERROR) << "[split] fail to unload tablet: " << parent_path
+            << ", status: " << StatusCodeToString(status);
+        response->set_status(status);
+        return;
+    }
+    if (!tablet_manager_->RemoveTablet(table_name, key_range[0], key_range[2], &status)) {
+        LOG(ERROR) << "[split] fail to remove tablet: " << parent_path
+            << ", status: " << StatusCodeToString(status);
+    }
+
+    std::vector<uint64_t> parent_tablets(1, leveldb::GetTabletNumFromPath(parent_path));
+    std::set<std::string> ignore_err_lgs;
+    int loaded = 0;
+    for (; loaded < 2; ++loaded) {
+        const std::string& key_start = key_range[loaded];
+        const std::string& key_end = key_range[loaded + 1];
+        std::string path = leveldb::GetChildTabletPath(parent_path,
+                                                       request->child_tablets(loaded));
+        io::TabletIO* child_io = NULL;
+        if (!tablet_manager_->AddTablet(table_name, path, key_start, key_end,
+                                        &child_io, &status)) {
+            LOG(ERROR) << "[split] fail to add tablet: " << path
+                << ", status: " << StatusCodeToString(status);
+            child_io->DecRef();
+            break;
+        }
+        child_io->SetMemoryCache(m_memory_cache);
+        child_io->SetSharedLog(ldb_shared_log_);
+        child_io->SetRateLimiter(ldb_rate_limiter_);
+        bool ok = child_io->Load(schema, path, parent_tablets, ignore_err_lgs, ldb_logger_,
+                                 ldb_block_cache_, ldb_table_cache_, &status);
+        child_io->DecRef();
+        if (!ok) {
+            LOG(ERROR) << "[split] fail to load tablet: " << path
+                << ", status: " << StatusCodeToString(status);
+            tablet_manager_->RemoveTablet(table_name, key_start, key_end, &status);
+            break;
+        }
+    }
+    if (loaded < 2) {
+        response->set_status(kIOError);
+        return;
+    }
+
+    LOG(INFO) << "[split] online split tablet: " << parent_path
+        << ", split key: " << DebugString(split_key)
+        << ", cost: " << (get_micros() - start_micros) / 1000 << "ms";
+    response->set_status(kTabletNodeOk);
+    response->add_split_keys(split_key);
+}
+
+// Both children of an online split are served by this node.
+bool TabletNodeImpl::OnlineSplitDone(const SplitTabletRequest* request) {
+    std::string key_range[3] = {request->key_range().key_start(), request->split_key(),
+                                request->key_range().key_end()};
+    for (int i = 0; i < 2; ++i) {
+        StatusCode status = kTabletNodeOk;
+        io::TabletIO* child_io = tablet_manager_->GetTablet(request->tablet_name(),
+                                                            key_range[i], key_range[i + 1],
+                                                            &status);
+        if (child_io == NULL) {
+            return false;
+        }
+        bool ready = child_io->GetStatus() == io::TabletIO::kReady;
+        child_io->DecRef();
+        if (!ready) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void TabletNodeImpl::ComputeSplitKey(const SplitTabletRequest* request,
                                  SplitTabletResponse* response,
                                  google::protobuf::Closure* done) {
@@ -980,6 +1118,10 @@ void TabletNodeImpl::ComputeSplitKey(const SplitTabletRequest* request,
         return;
     }
 
+    if (request->by_load() && !tablet_io->GetLoadSplitKey(&split_key)) {
+        LOG(INFO) << "[split] too few load samples, split by size: "
+            << tablet_io->GetTablePath();
+    }
     if (!tablet_io->Split(&split_key, &status)) {
         LOG(ERROR) << "fail to split tablet: " << tablet_io->GetTablePath()
             << " [" << DebugString(tablet_io->GetStartKey())
@@ -1004,6 +1146,88 @@ void TabletNodeImpl::ComputeSplitKey(const SplitTabletRequest* request,
     done->Run();
 }
 
+void TabletNodeImpl::GetHotBlocks(const GetHotBlocksRequest* request,
+                                  GetHotBlocksResponse* response,
+                                  google::protobuf::Closure* done) {
+    response->set_sequence_id(request->sequence_id());
+
+    StatusCode status = kTabletNodeOk;
+    io::TabletIO* tablet_io = tablet_manager_->GetTablet(request->tablet_name(),
+                                                request->key_range().key_start(),
+                                                request->key_range().key_end(),
+                                                &status);
+    if (tablet_io == NULL) {
+        LOG(WARNING) << "get hot blocks fail to get tablet: " << request->tablet_name()
+            << " [" << DebugString(request->key_range().key_start())
+            << ", " << DebugString(request->key_range().key_end())
+            << "], status: " << StatusCodeToString(status);
+        response->set_status(kKeyNotInRange);
+        done->Run();
+        return;
+    }
+
+    std::vector<leveldb::HotTableFile> files;
+    if (!tablet_io->GetHotTableFiles(request->max_bytes(), &files, &status)) {
+        response->set_status(status);
+        tablet_io->DecRef();
+        done->Run();
+        return;
+    }
+    uint64_t block_num = 0;
+    for (uint32_t i = 0; i < files.size(); ++i) {
+        HotTableFile* file = response->add_files();
+        file->set_lg_id(files[i].lg_id);
+        file->set_file_number(files[i].number);
+        file->set_file_size(files[i].size);
+        for (uint32_t j = 0; j < files[i].block_offsets.size(); ++j) {
+            file->add_block_offsets(files[i].block_offsets[j]);
+        }
+        block_num += files[i].block_offsets.size();
+    }
+    LOG(INFO) << "get hot blocks: " << tablet_io->GetTablePath()
+        << ", files: " << files.size() << ", blocks: " << block_num;
+    response->set_status(kTabletNodeOk);
+    tablet_io->DecRef();
+    done->Run();
+}
+
+void TabletNodeImpl::PrewarmTablet(const PrewarmTabletRequest* request,
+                                   PrewarmTabletResponse* response,
+                                   google::protobuf::Closure* done) {
+    response->set_sequence_id(request->sequence_id());
+
+    std::vector<leveldb::HotTableFile> files(request->files_size());
+    for (int i = 0; i < request->files_size(); ++i) {
+        const HotTableFile& file = request->files(i);
+        files[i].lg_id = file.lg_id();
+        files[i].number = file.file_number();
+        files[i].size = file.file_size();
+        files[i].block_offsets.assign(file.block_offsets().begin(),
+                                      file.block_offsets().end());
+    }
+
+    // a temporary tablet, only to set up the options the tablet is loaded with
+    int64_t start_micros = get_micros();
+    io::TabletIO tablet_io(request->key_range().key_start(),
+                           request->key_range().key_end(), request->path());
+    tablet_io.SetMemoryCache(m_memory_cache);
+    uint64_t warm_bytes = 0;
+    StatusCode status = kTabletNodeOk;
+    if (!tablet_io.Prewarm(request->schema(), request->path(), files, ldb_logger_,
+                           ldb_block_cache_, ldb_table_cache_, &warm_bytes, &status)) {
+        LOG(WARNING) << "fail to prewarm tablet: " << request->path()
+            << ", status: " << StatusCodeToString(status);
+        response->set_status(kIOError);
+    } else {
+        LOG(INFO) << "prewarm tablet: " << request->path() << ", files: " << files.size()
+            << ", bytes: " << warm_bytes
+            << ", cost: " << (get_micros() - start_micros) / 1000 << "ms";
+        response->set_status(kTabletNodeOk);
+    }
+    response->set_warm_bytes(warm_bytes);
+    done->Run();
+}
+
 
 bool TabletNodeImpl::CheckInKeyRange(const KeyList& key_list,
                                      const std::string& key_start,
@@ -1247,6 +1471,124 @@ void TabletNodeImpl::ReleaseMallocCache() {
     EnableReleaseMallocCacheTimer();
 }
 
+void TabletNodeImpl::InitSharedLog() {
+    std::string root = FLAGS_tera_tabletnode_path_prefix + "/"
+        + FLAGS_tera_tabletnode_shared_log_dir;
+    std::string dir = leveldb::SharedLogDirName(root, local_addr_, get_micros());
+    ldb_shared_log_ = new leveldb::SharedLog(io::LeveldbBaseEnv(), dir,
+        FLAGS_tera_tabletnode_shared_log_file_size << 20,
+        FLAGS_tera_tabletnode_shared_log_max_num, ldb_logger_,
+        FLAGS_tera_tablet_write_log_time_out,
+        FLAGS_tera_tablet_max_block_log_number);
+    leveldb::Status s = ldb_shared_log_->Open();
+    if (!s.ok()) {
+        LOG(ERROR) << "fail to open shared log: " << dir << ", status: "
+            << s.ToString() << ", tablets write their own logs";
+        delete ldb_shared_log_;
+        ldb_shared_log_ = NULL;
+        return;
+    }
+    LOG(INFO) << "open shared log: " << dir;
+    ThreadPool::Task task = std::bind(&TabletNodeImpl::FlushSharedLogTablets, this);
+    thread_pool_->DelayTask(FLAGS_tera_tabletnode_shared_log_flush_period * 1000LL, task);
+}
+
+// idle tablets never dump memtable by themselves,
+// dump the ones keeping the oldest shared log files alive
+void TabletNodeImpl::FlushSharedLogTablets() {
+    std::vector<std::string> tablets;
+    ldb_shared_log_->GetTabletsToFlush(&tablets);
+    std::set<std::string> flush_set(tablets.begin(), tablets.end());
+
+    std::string path_prefix = FLAGS_tera_tabletnode_path_prefix;
+    if (*path_prefix.rbegin() != '/') {
+        path_prefix.push_back('/');
+    }
+    std::vector<io::TabletIO*> tablet_ios;
+    if (!flush_set.empty()) {
+        tablet_manager_->GetAllTablets(&tablet_ios);
+    }
+    for (size_t i = 0; i < tablet_ios.size(); ++i) {
+        io::TabletIO* tablet_io = tablet_ios[i];
+        if (flush_set.find(path_prefix + tablet_io->GetTablePath()) != flush_set.end()) {
+            LOG(INFO) << "dump memtable for shared log, tablet: " << tablet_io->GetTablePath();
+            StatusCode status = kTabletNodeOk;
+            tablet_io->Compact(-1, &status, io::TabletIO::kMinorCompaction);
+        }
+        tablet_io->DecRef();
+    }
+
+    ThreadPool::Task task = std::bind(&TabletNodeImpl::FlushSharedLogTablets, this);
+    thread_pool_->DelayTask(FLAGS_tera_tabletnode_shared_log_flush_period * 1000LL, task);
+}
+
+void TabletNodeImpl::InitRateLimiter() {
+    leveldb::RateLimiterOptions opts;
+    opts.max_bytes_per_sec[leveldb::kIOFlush] =
+        static_cast<int64_t>(FLAGS_tera_tabletnode_flush_rate_limit) << 20;
+    opts.max_bytes_per_sec[leveldb::kIOL0Compaction] =
+        static_cast<int64_t>(FLAGS_tera_tabletnode_l0_compact_rate_limit) << 20;
+    opts.max_bytes_per_sec[leveldb::kIODeepCompaction] =
+        static_cast<int64_t>(FLAGS_tera_tabletnode_deep_compact_rate_limit) << 20;
+    opts.target_latency_us = FLAGS_tera_tabletnode_compact_rate_target_read_latency;
+    bool limited = false;
+    for (int i = 0; i < leveldb::kIOPriorityNum; ++i) {
+        limited = limited || opts.max_bytes_per_sec[i] > 0;
+    }
+    if (!limited) {
+        return;
+    }
+    LOG(INFO) << "limit sst writes of all tablets, flush: "
+        << FLAGS_tera_tabletnode_flush_rate_limit << " MB/s, l0 compact: "
+        << FLAGS_tera_tabletnode_l0_compact_rate_limit << " MB/s, deep compact: "
+        << FLAGS_tera_tabletnode_deep_compact_rate_limit << " MB/s, target read latency: "
+        << opts.target_latency_us << " us";
+    ldb_rate_limiter_ = leveldb::NewRateLimiter(leveldb::Env::Default(), opts);
+
+    const char* labels[leveldb::kIOPriorityNum] = {
+        kRateLimitFlushLabel, kRateLimitL0CompactLabel, kRateLimitDeepCompactLabel
+    };
+    for (int i = 0; i < leveldb::kIOPriorityNum; ++i) {
+        leveldb::IOPriority pri = static_cast<leveldb::IOPriority>(i);
+        rate_limiter_metrics_.emplace_back(new AutoCollectorRegister(
+            kRateLimitBytesMetric, labels[i], std::unique_ptr<Collector>(
+                new RateLimiterCollector(ldb_rate_limiter_, pri, RateLimiterCollectType::kBytes))));
+        rate_limiter_metrics_.emplace_back(new AutoCollectorRegister(
+            kRateLimitWaitMetric, labels[i], std::unique_ptr<Collector>(
+                new RateLimiterCollector(ldb_rate_limiter_, pri,
+                                         RateLimiterCollectType::kWaitMicros))));
+        rate_limiter_metrics_.emplace_back(new AutoCollectorRegister(
+            kRateLimitRateMetric, labels[i], std::unique_ptr<Collector>(
+                new RateLimiterCollector(ldb_rate_limiter_, pri,
+                                         RateLimiterCollectType::kBytesPerSecond))));
+    }
+}
+
+void TabletNodeImpl::TuneRateLimiter() {
+    if (ldb_rate_limiter_ == NULL) {
+        return;
+    }
+    std::shared_ptr<CollectorReport> latest_report =
+        CollectorReportPublisher::GetInstance().GetCollectorReport();
+    int64_t read_delay_percentile_99 = 0;
+    if (latest_report->FindMetricValue(kFinishedRequestCountMetric, kApiLabelRead) > 0) {
+        read_delay_percentile_99 =
+            latest_report->FindMetricValue(kRequestDelayPercentileMetric, kReadLabelPercentile99);
+    }
+    // the tablet furthest behind with its compactions decides the debt,
+    // cutting the rates while its level 0 files pile up slows down the reads
+    double compaction_debt = 0;
+    if (FLAGS_tera_tabletnode_compact_rate_busy_workload > 0) {
+        compaction_debt = sysinfo_.GetMaxWriteWorkload() /
+            FLAGS_tera_tabletnode_compact_rate_busy_workload;
+    }
+    ldb_rate_limiter_->Tune(read_delay_percentile_99, compaction_debt);
+    VLOG(15) << "tune rate limiter by read p99 " << read_delay_percentile_99
+        << " us, compaction debt " << compaction_debt << ", l0 compact: " << ldb_rate_limiter_->GetBytesPerSecond(leveldb::kIOL0Compaction)
+        << " B/s, deep compact: "
+        << ldb_rate_limiter_->GetBytesPerSecond(leveldb::kIODeepCompaction) << " B/s";
+}
+
 void TabletNodeImpl::EnableReleaseMallocCacheTimer(int32_t expand_factor) {
     assert(release_cache_timer_id_ == kInvalidTimerId);
     ThreadPool::Task task =
@@ -1419,6 +1761,7 @@ void TabletNodeImpl::RefreshLevelSize() {
                 level_size_total[level] += db_level_size[level];
             }
         }
+        tablet_io->RefreshWriteAmplification();
         tablet_io->DecRef();
         it = tablet_ios.erase(it);
     }
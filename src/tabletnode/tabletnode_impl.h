@@ -88,12 +88,14 @@ public:
     void ReadTablet(int64_t start_micros,
                     const ReadTabletRequest* request,
                     ReadTabletResponse* response,
-                    google::protobuf::Closure* done);
+                    google::protobuf::Closure* done,
+                    io::RequestTrace* trace = NULL);
 
     void WriteTablet(const WriteTabletRequest* request,
                      WriteTabletResponse* response,
                      google::protobuf::Closure* done,
-                     WriteRpcTimer* timer = NULL);
+                     WriteRpcTimer* timer = NULL,
+                     io::RequestTrace* trace = NULL);
 
     void ScanTablet(const ScanTabletRequest* request,
                     ScanTabletResponse* response,
@@ -113,6 +115,14 @@ public:
                      SplitTabletResponse* response,
                      google::protobuf::Closure* done);
 
+    void GetHotBlocks(const GetHotBlocksRequest* request,
+                      GetHotBlocksResponse* response,
+                      google::protobuf::Closure* done);
+
+    void PrewarmTablet(const PrewarmTabletRequest* request,
+                       PrewarmTabletResponse* response,
+                       google::protobuf::Closure* done);
+
     void EnterSafeMode();
     void LeaveSafeMode();
     void ExitService();
@@ -144,6 +154,15 @@ private:
                              std::vector<const RowMutationSequence*>* row_mutation_vec,
                              std::vector<StatusCode>* status_vec);
 
+    // split "tablet_io" and load the children on this node
+    void OnlineSplitTablet(const SplitTabletRequest* request,
+                           const std::string& split_key,
+                           io::TabletIO* tablet_io,
+                           SplitTabletResponse* response);
+
+    // both children of an online split are loaded on this node
+    bool OnlineSplitDone(const SplitTabletRequest* request);
+
     bool CheckInKeyRange(const KeyList& key_list,
                          const std::string& key_start,
                          const std::string& key_end);
@@ -161,6 +180,11 @@ private:
     void InitCacheSystem();
 
     void ReleaseMallocCache();
+    void InitSharedLog();
+    void FlushSharedLogTablets();
+    void InitRateLimiter();
+    // adjust the compaction rates by the read latency of the last period
+    void TuneRateLimiter();
     void EnableReleaseMallocCacheTimer(int32_t expand_factor = 1);
     void DisableReleaseMallocCacheTimer();
 
@@ -206,6 +230,8 @@ private:
     leveldb::Cache* ldb_block_cache_;
     leveldb::Cache* m_memory_cache;
     leveldb::TableCache* ldb_table_cache_;
+    leveldb::SharedLog* ldb_shared_log_;
+    leveldb::RateLimiter* ldb_rate_limiter_;
     
     // metric for caches
     struct CacheMetrics {
@@ -221,6 +247,8 @@ private:
     };
     
     scoped_ptr<CacheMetrics> cache_metrics_;
+    // bytes, wait time and rate of each class of the sst writes
+    std::vector<std::unique_ptr<tera::AutoCollectorRegister>> rate_limiter_metrics_;
     scoped_ptr<tera::AutoCollectorRegister> snappy_ratio_metric_;
 };
 
@@ -32,6 +32,7 @@ const char* const kErrorCountMetric = "tera_ts_error_count";
 const char* const kRangeErrorMetric = "tera_ts_range_error_count";
 
 const char* const kRowDelayMetric = "tera_ts_row_delay_us_total";
+const char* const kRowDelayPercentileMetric = "tera_ts_row_delay_percentile";
 const char* const kRowCountMetric = "tera_ts_row_count";
 const char* const kRowThroughPutMetric = "tera_ts_row_through_put";
 const char* const kLowLevelReadMetric = "tera_ts_low_level_read";
@@ -52,6 +53,7 @@ const char* const kFlushFinish = "flush:finish";
 
 const char* const kRequestDelayAvgMetric = "tera_ts_request_delay_us_avg";
 const char* const kRequestDelayPercentileMetric = "tera_ts_request_delay_percentile";
+const char* const kRequestStageDelayPercentileMetric = "tera_ts_request_stage_delay_percentile";
 
 const char* const kWriteLabelPercentile95 = "api:write,percentile:95";
 const char* const kWriteLabelPercentile99 = "api:write,percentile:99";
@@ -69,6 +71,15 @@ const char* const kTableCacheHitRateMetric = "tera_ts_table_cache_hit_percentage
 const char* const kTableCacheEntriesMetric = "tera_ts_table_cache_entry_count";
 const char* const kTableCacheChargeMetric = "tera_ts_table_cache_charge_bytes";
 
+// sst write rate limiter metric names
+const char* const kRateLimitBytesMetric = "tera_ts_rate_limit_bytes";
+const char* const kRateLimitWaitMetric = "tera_ts_rate_limit_wait_us";
+const char* const kRateLimitRateMetric = "tera_ts_rate_limit_bytes_per_second";
+
+const char* const kRateLimitFlushLabel = "io:flush";
+const char* const kRateLimitL0CompactLabel = "io:l0_compact";
+const char* const kRateLimitDeepCompactLabel = "io:deep_compact";
+
 // env metric names
 const char* const kDfsReadBytesThroughPut = "tera_ts_dfs_read_bytes_through_put";
 const char* const kDfsWriteBytesThroughPut = "tera_ts_dfs_write_bytes_through_put";
@@ -4,6 +4,7 @@
 //
 // Author: Xu Peilin (xupeilin@baidu.com)
 
+#include <algorithm>
 #include <cmath>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -630,6 +631,15 @@ void TabletNodeSysInfo::GetTabletMetaList(TabletMetaList* meta_list) {
     meta_list->CopyFrom(tablet_list_);
 }
 
+double TabletNodeSysInfo::GetMaxWriteWorkload() {
+    MutexLock lock(&mutex_);
+    double max_workload = 0;
+    for (int i = 0; i < tablet_list_.counter_size(); ++i) {
+        max_workload = std::max(max_workload, tablet_list_.counter(i).write_workload());
+    }
+    return max_workload;
+}
+
 void TabletNodeSysInfo::SetServerAddr(const std::string& addr) {
     MutexLock lock(&mutex_);
     info_.set_addr(addr);
@@ -43,6 +43,9 @@ public:
 
     void GetTabletMetaList(TabletMetaList* meta_list);
 
+    // the highest write workload of the tablets collected last time
+    double GetMaxWriteWorkload();
+
     void DumpLog();
 
     void SetProcessStartTime(int64_t ts);
@@ -40,6 +40,7 @@ DEFINE_int64(tera_info_log_expire_second, 2592000, "expire time (in second) of l
 DEFINE_string(tera_tabletnode_path_prefix, "../data/", "the path prefix for table storage");
 DEFINE_int32(tera_tabletnode_scan_pack_max_size, 10240, "the max size(KB) of the package for scan rpc");
 DEFINE_bool(tera_tabletnode_flash_block_cache_enabled, false, "enable flash block cache mechasism");
+DEFINE_string(tera_tabletnode_shared_log_dir, "shared_log", "the dir (under tera_tabletnode_path_prefix) for node-level shared commit logs");
 
 /////////  io  /////////
 DEFINE_int64(tera_tablet_write_block_size, 4, "the block size (in KB) for teblet write block");
@@ -85,6 +86,9 @@ DEFINE_int32(observer_read_thread_num, 20, "observer read thread num");
 DEFINE_int32(observer_ack_conflict_timeout, 3600, "(ms) timeout for ack column conflict check");
 DEFINE_int32(observer_rowlock_client_thread_num, 20, "rowlock client thread number");
 DEFINE_int32(observer_random_access_thread_num, 20, "async read and write thread number");
+DEFINE_string(observer_key_selector, "random", "random | partition, partition: workers lease tablets to scan from rowlock server");
+DEFINE_int32(observer_partition_lease_ms, 30000, "(ms) lease of a tablet taken by a worker with partition key selector, renewed while scanning");
+DEFINE_int32(observer_rowlock_batch_size, 32, "max number of scanned rows locked by one BatchLock rpc");
 
 //////// rowlock server ////////
 DEFINE_bool(rowlock_rpc_limit_enabled, false, "enable the rpc traffic limit in sdk");
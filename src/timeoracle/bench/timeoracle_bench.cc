@@ -1,54 +1,138 @@
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include "common/timer.h"
 #include "sdk/sdk_zk.h"
 
 #include "sdk/timeoracle_client_impl.h"
 #include <thread>
 
 DEFINE_int64(client_thread_num, 10, "");
+DEFINE_int64(bench_seconds, 0, "run for seconds and report latency, 0 means run forever");
+
+DECLARE_bool(tera_sdk_tso_coalesce_enabled);
 
 using namespace tera;
 using namespace tera::timeoracle;
 
 std::shared_ptr<common::ThreadPool> g_thread_pool;
+std::atomic<int64_t> g_timestamp_count(0);
+std::atomic<bool> g_stop(false);
 
-
-void worker() {
-    tera::sdk::ClusterFinder* cluster_finder = sdk::NewTimeoracleClusterFinder();
-    if (!cluster_finder) {
-        std::cerr << "Create cluster failed, use -h to see configuer items\n";
-        exit(0);
+// Without coalescing every thread has its own client, as a client only
+// has one sync rpc in flight.  With coalescing all threads share one.
+void worker(TimeoracleClientImpl* shared_client, std::vector<int64_t>* latency) {
+    std::unique_ptr<sdk::ClusterFinder> cluster_finder;
+    std::unique_ptr<TimeoracleClientImpl> own_client;
+    TimeoracleClientImpl* client = shared_client;
+    if (client == NULL) {
+        cluster_finder.reset(sdk::NewTimeoracleClusterFinder());
+        if (!cluster_finder) {
+            std::cerr << "Create cluster failed, use -h to see configuer items\n";
+            exit(0);
+        }
+        own_client.reset(new TimeoracleClientImpl(g_thread_pool.get(), cluster_finder.get()));
+        client = own_client.get();
     }
-    tera::timeoracle::TimeoracleClientImpl client(g_thread_pool.get(), cluster_finder);
 
-    while (true) {
-        int64_t st = client.GetTimestamp(1);
+    int64_t last_ts = 0;
+    while (!g_stop) {
+        int64_t start_us = get_micros();
+        int64_t st = client->GetTimestamp(1);
         if (st <= 0) {
             std::cout << "rpc failed" << std::endl;
             ThisThread::Sleep(200);
+            continue;
+        }
+        if (st <= last_ts) {
+            std::cerr << "timestamp goes back, " << st << " after " << last_ts << std::endl;
+            exit(1);
+        }
+        last_ts = st;
+        if (FLAGS_bench_seconds > 0) {
+            latency->push_back(get_micros() - start_us);
         }
+        g_timestamp_count++;
+    }
+}
+
+int64_t Percentile(const std::vector<int64_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
     }
+    size_t i = static_cast<size_t>(sorted.size() * p);
+    return sorted[std::min(i, sorted.size() - 1)];
 }
 
 int main(int argc, char** argv) {
     if (argc > 1 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "help")) {
-        std::cout << argv[0] << " --client_thread_num=<Thread Num> \n"
+        std::cout << argv[0] << " --client_thread_num=<Thread Num> --bench_seconds=<Seconds>"
+                  << " --tera_sdk_tso_coalesce_enabled=<true|false>\n"
                   << "    and zk/ins configures should be set in tera.flag or via command line" << std::endl;
         return 0;
     }
     ::google::ParseCommandLineFlags(&argc, &argv, true);
     g_thread_pool.reset(new common::ThreadPool(FLAGS_client_thread_num + 1));
 
+    std::unique_ptr<sdk::ClusterFinder> cluster_finder;
+    std::unique_ptr<TimeoracleClientImpl> shared_client;
+    if (FLAGS_tera_sdk_tso_coalesce_enabled) {
+        cluster_finder.reset(sdk::NewTimeoracleClusterFinder());
+        if (!cluster_finder) {
+            std::cerr << "Create cluster failed, use -h to see configuer items\n";
+            return 0;
+        }
+        shared_client.reset(new TimeoracleClientImpl(g_thread_pool.get(), cluster_finder.get()));
+    }
+
+    std::vector<std::vector<int64_t> > latency(FLAGS_client_thread_num);
     std::vector<std::thread>    thread_list;
     for (int64_t i = 0; i < FLAGS_client_thread_num; ++i) {
-        thread_list.push_back(std::thread(&worker));
+        thread_list.push_back(std::thread(&worker, shared_client.get(), &latency[i]));
     }
 
+    int64_t start_us = get_micros();
+    int64_t last_count = 0;
+    for (int64_t sec = 1; FLAGS_bench_seconds <= 0 || sec <= FLAGS_bench_seconds; ++sec) {
+        ThisThread::Sleep(1000);
+        int64_t count = g_timestamp_count;
+        std::cout << "[" << sec << "s] " << count - last_count << " timestamps/s";
+        if (shared_client) {
+            std::cout << ", " << shared_client->RpcCount() << " rpcs in total";
+        }
+        std::cout << std::endl;
+        last_count = count;
+    }
+    g_stop = true;
     for (auto& th : thread_list) {
         th.join();
     }
 
+    std::vector<int64_t> all;
+    for (size_t i = 0; i < latency.size(); ++i) {
+        all.insert(all.end(), latency[i].begin(), latency[i].end());
+    }
+    std::sort(all.begin(), all.end());
+    int64_t sum = 0;
+    for (size_t i = 0; i < all.size(); ++i) {
+        sum += all[i];
+    }
+    double seconds = (get_micros() - start_us) / 1000000.0;
+    std::cout << "coalesce: " << (FLAGS_tera_sdk_tso_coalesce_enabled ? "on" : "off")
+              << ", threads: " << FLAGS_client_thread_num
+              << ", throughput: " << static_cast<int64_t>(all.size() / seconds) << " timestamps/s";
+    if (shared_client) {
+        std::cout << ", rpc: " << static_cast<int64_t>(shared_client->RpcCount() / seconds) << "/s";
+    }
+    std::cout << "\nlatency(us) avg: " << (all.empty() ? 0 : sum / static_cast<int64_t>(all.size()))
+              << ", p50: " << Percentile(all, 0.5)
+              << ", p99: " << Percentile(all, 0.99)
+              << ", p999: " << Percentile(all, 0.999)
+              << ", max: " << (all.empty() ? 0 : all.back()) << std::endl;
     return 0;
 }
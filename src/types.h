@@ -51,6 +51,7 @@ const uint64_t kObserverWaitTimeMs = 10;
 
 // global transaction
 const char* const kNotifyColumnFamily = "_N_";
+const uint32_t kNotifyIndexBucketNum = 256;
 
 // stat table
 const char* const kStatTableName = "stat_table";
@@ -4,6 +4,7 @@
 
 #include "scan_filter.h"
 
+#include <string.h>
 #include <glog/logging.h>
 
 namespace tera {
@@ -158,4 +159,78 @@ bool ScanFilter::DoBinCompCheck(BinCompOp op, const string& l_value, const strin
     }
     return false;
 }
+
+// int64 values are stored in host byte order, shorter values are zero-filled
+static int64_t DecodeInt64Value(const char* data, size_t size) {
+    int64_t v = 0;
+    memcpy(&v, data, size < sizeof(v) ? size : sizeof(v));
+    return v;
+}
+
+CompiledScanFilter::CompiledScanFilter(const FilterList& filter_list) {
+    for (int i = 0; i < filter_list.filter_size(); ++i) {
+        const Filter& filter = filter_list.filter(i);
+        // CheckCell() passes every cell on the other filters
+        if (filter.type() != BinComp || filter.field() != ValueFilter) {
+            continue;
+        }
+        CompareOp op;
+        op.op = filter.bin_comp_op();
+        op.ref_value = DecodeInt64Value(filter.ref_value().data(), filter.ref_value().size());
+        op.always_fail = false;
+        if (filter.value_type() != kINT64) {
+            LOG(ERROR) << "only support int64 value.";
+            op.always_fail = true;
+        } else if (op.op < EQ || op.op > GE) {
+            LOG(ERROR) << "illegal compare operator: " << op.op;
+            op.always_fail = true;
+        }
+
+        size_t f = 0;
+        while (f < families_.size() && families_[f].family != filter.content()) {
+            ++f;
+        }
+        if (f == families_.size()) {
+            families_.push_back(FamilyFilter());
+            families_[f].family = filter.content();
+        }
+        families_[f].ops.push_back(op);
+    }
+}
+
+bool CompiledScanFilter::CheckCell(const leveldb::Slice& family,
+                                   const leveldb::Slice& value) const {
+    for (size_t i = 0; i < families_.size(); ++i) {
+        if (family == leveldb::Slice(families_[i].family)) {
+            return CheckFamily(i, value);
+        }
+    }
+    return true;
+}
+
+bool CompiledScanFilter::CheckFamily(size_t i, const leveldb::Slice& value) const {
+    const std::vector<CompareOp>& ops = families_[i].ops;
+    int64_t v = DecodeInt64Value(value.data(), value.size());
+    for (size_t j = 0; j < ops.size(); ++j) {
+        const CompareOp& op = ops[j];
+        if (op.always_fail) {
+            return false;
+        }
+        bool res = false;
+        switch (op.op) {
+        case EQ: res = v == op.ref_value; break;
+        case NE: res = v != op.ref_value; break;
+        case LT: res = v < op.ref_value; break;
+        case LE: res = v <= op.ref_value; break;
+        case GT: res = v > op.ref_value; break;
+        case GE: res = v >= op.ref_value; break;
+        default: break;
+        }
+        if (!res) {
+            return false;
+        }
+    }
+    return true;
+}
+
 } // namespace tera
@@ -6,6 +6,10 @@
 #define  TERA_UTILS_SCAN_FILTER_H_
 
 #include <set>
+#include <string>
+#include <vector>
+
+#include "leveldb/slice.h"
 #include "proto/tabletnode_rpc.pb.h"
 
 using std::string;
@@ -36,5 +40,38 @@ private:
     int _filter_num;
 };
 
+// CompiledScanFilter is a FilterList prepared once per scan request:
+// filters are grouped by their column family and the int64 reference values
+// are decoded ahead, so that a cell is checked on its raw family and value
+// slices without being copied into a KeyValuePair.
+class CompiledScanFilter {
+public:
+    CompiledScanFilter() {}
+    explicit CompiledScanFilter(const FilterList& filter_list);
+
+    // true iff no filter may drop a row
+    bool Empty() const { return families_.empty(); }
+
+    // return false if the row of a cell of `family' with `value' should be
+    // filtered out
+    bool CheckCell(const leveldb::Slice& family, const leveldb::Slice& value) const;
+
+    size_t FamilyNum() const { return families_.size(); }
+    const std::string& Family(size_t i) const { return families_[i].family; }
+    bool CheckFamily(size_t i, const leveldb::Slice& value) const;
+
+private:
+    struct CompareOp {
+        BinCompOp op;
+        int64_t ref_value;
+        bool always_fail;   // the filter can not match any value
+    };
+    struct FamilyFilter {
+        std::string family;
+        std::vector<CompareOp> ops;
+    };
+    std::vector<FamilyFilter> families_;
+};
+
 } // namespace tera
 #endif // TERA_UTILS_SCAN_FILTER_H_
@@ -6,8 +6,14 @@
 
 #include "scan_filter.h"
 
+#include <iostream>
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
 
+#include "common/timer.h"
+
 namespace tera {
 
 ScanFilter::ScanFilter() {}
@@ -101,4 +107,123 @@ TEST_F(ScanFilterTest, DoBinCompCheck) {
     EXPECT_FALSE(DoBinCompCheck(LT, "10", "10"));
     EXPECT_FALSE(DoBinCompCheck(LE, "20", "10"));
 }
+
+static std::string Int64Value(int64_t v) {
+    return std::string(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+static Filter Int64Filter(const std::string& cf, BinCompOp op, int64_t ref_value) {
+    Filter filter;
+    filter.set_type(BinComp);
+    filter.set_bin_comp_op(op);
+    filter.set_field(ValueFilter);
+    filter.set_content(cf);
+    filter.set_value_type(kINT64);
+    filter.set_ref_value(Int64Value(ref_value));
+    return filter;
+}
+
+TEST(CompiledScanFilterTest, CheckCell) {
+    FilterList filter_list;
+    filter_list.add_filter()->CopyFrom(Int64Filter("cf1", GT, 10));
+    filter_list.add_filter()->CopyFrom(Int64Filter("cf1", LE, 20));
+    filter_list.add_filter()->CopyFrom(Int64Filter("cf2", NE, -1));
+    CompiledScanFilter filter(filter_list);
+    ASSERT_FALSE(filter.Empty());
+    ASSERT_EQ(filter.FamilyNum(), 2U);
+    EXPECT_EQ(filter.Family(0), "cf1");
+    EXPECT_EQ(filter.Family(1), "cf2");
+
+    EXPECT_FALSE(filter.CheckCell("cf1", Int64Value(10)));
+    EXPECT_TRUE(filter.CheckCell("cf1", Int64Value(11)));
+    EXPECT_TRUE(filter.CheckCell("cf1", Int64Value(20)));
+    EXPECT_FALSE(filter.CheckCell("cf1", Int64Value(21)));
+    EXPECT_FALSE(filter.CheckCell("cf2", Int64Value(-1)));
+    EXPECT_TRUE(filter.CheckCell("cf2", Int64Value(0)));
+    // cells of other column families pass
+    EXPECT_TRUE(filter.CheckCell("cf", Int64Value(0)));
+    EXPECT_TRUE(filter.CheckCell("cf10", Int64Value(0)));
+    // short values are zero-filled
+    EXPECT_FALSE(filter.CheckCell("cf1", ""));
+    EXPECT_TRUE(filter.CheckCell("cf1", std::string(1, 15)));
+
+    // the same result as CheckCell() on a KeyValuePair
+    KeyValuePair kv;
+    kv.set_column_family("cf1");
+    for (int64_t v = 0; v < 30; ++v) {
+        kv.set_value(Int64Value(v));
+        bool expected = CheckCell(kv, filter_list.filter(0)) &&
+                        CheckCell(kv, filter_list.filter(1));
+        EXPECT_EQ(filter.CheckCell(kv.column_family(), kv.value()), expected);
+    }
+}
+
+TEST(CompiledScanFilterTest, Unsupported) {
+    FilterList filter_list;
+    CompiledScanFilter empty_filter(filter_list);
+    EXPECT_TRUE(empty_filter.Empty());
+
+    // only the value filters may drop rows
+    Filter filter = Int64Filter("cf1", EQ, 1);
+    filter.set_field(RowFilter);
+    filter_list.add_filter()->CopyFrom(filter);
+    EXPECT_TRUE(CompiledScanFilter(filter_list).Empty());
+
+    // an illegal operator filters every row of the family
+    filter_list.add_filter()->CopyFrom(Int64Filter("cf2", UNKNOWN, 1));
+    CompiledScanFilter compiled(filter_list);
+    ASSERT_EQ(compiled.FamilyNum(), 1U);
+    EXPECT_FALSE(compiled.CheckCell("cf2", Int64Value(1)));
+    EXPECT_TRUE(compiled.CheckCell("cf1", Int64Value(1)));
+}
+
+// cells/s of checking the cells of a low-selectivity filter on raw slices,
+// compared with building a KeyValuePair of every cell to check it
+TEST(CompiledScanFilterTest, CheckBench) {
+    const int kCfNum = 8;
+    std::vector<std::string> families;
+    std::vector<std::string> values;
+    for (int i = 0; i < 10000; ++i) {
+        families.push_back("column_family_" + std::to_string(i % kCfNum));
+        values.push_back(Int64Value(i));
+    }
+    FilterList filter_list;
+    // 1% of the cells of the last column family pass
+    filter_list.add_filter()->CopyFrom(Int64Filter(families[kCfNum - 1], GE, 9900));
+
+    const int kRounds = 100;
+    CompiledScanFilter compiled(filter_list);
+    int64_t passed = 0;
+    int64_t start_us = get_micros();
+    for (int round = 0; round < kRounds; ++round) {
+        for (size_t i = 0; i < values.size(); ++i) {
+            passed += compiled.CheckCell(families[i], values[i]) ? 1 : 0;
+        }
+    }
+    int64_t compiled_us = get_micros() - start_us + 1;
+
+    int64_t kv_passed = 0;
+    start_us = get_micros();
+    for (int round = 0; round < kRounds; ++round) {
+        for (size_t i = 0; i < values.size(); ++i) {
+            KeyValuePair kv;
+            kv.set_key("row");
+            kv.set_column_family(families[i]);
+            kv.set_qualifier("");
+            kv.set_timestamp(i);
+            kv.set_value(values[i]);
+            const Filter& filter = filter_list.filter(0);
+            if (kv.column_family() != filter.content() || CheckCell(kv, filter)) {
+                ++kv_passed;
+            }
+        }
+    }
+    int64_t kv_us = get_micros() - start_us + 1;
+    EXPECT_EQ(passed, kv_passed);
+
+    int64_t num = values.size() * kRounds;
+    std::cout << "compiled filter: " << num * 1000000 / compiled_us << " cells/s"
+              << ", KeyValuePair filter: " << num * 1000000 / kv_us << " cells/s"
+              << std::endl;
+}
 } // namespace tera